@@ -121,6 +121,26 @@ reopen (VALUE self)
     return self;
 }
 
+static VALUE
+is_asynchronous (VALUE self)
+{
+    return CBOOL2RVAL(milter_logger_is_asynchronous(SELF(self)));
+}
+
+static VALUE
+set_asynchronous (VALUE self, VALUE rb_asynchronous)
+{
+    milter_logger_set_asynchronous(SELF(self), RVAL2CBOOL(rb_asynchronous));
+    return self;
+}
+
+static VALUE
+flush (VALUE self)
+{
+    milter_logger_flush(SELF(self));
+    return self;
+}
+
 void
 Init_milter_logger (void)
 {
@@ -164,6 +184,10 @@ Init_milter_logger (void)
     rb_define_method(rb_cMilterLogger, "set_path", set_path, 1);
 
     rb_define_method(rb_cMilterLogger, "reopen", reopen, 0);
+    rb_define_method(rb_cMilterLogger, "asynchronous?", is_asynchronous, 0);
+    rb_define_method(rb_cMilterLogger, "set_asynchronous",
+                     set_asynchronous, 1);
+    rb_define_method(rb_cMilterLogger, "flush", flush, 0);
 
     G_DEF_SETTERS(rb_cMilterLogger);
 }
@@ -39,6 +39,154 @@ merge (VALUE self, VALUE other)
     return self;
 }
 
+static VALUE
+add_network (int argc, VALUE *argv, VALUE self)
+{
+    VALUE network, apply;
+    GError *error = NULL;
+
+    rb_scan_args(argc, argv, "11", &network, &apply);
+    if (!milter_manager_applicable_condition_add_network(
+            SELF(self),
+            RVAL2CSTR(network),
+            NIL_P(apply) ? TRUE : RVAL2CBOOL(apply),
+            &error))
+        RAISE_GERROR(error);
+    return self;
+}
+
+static VALUE
+add_local_network (VALUE self, VALUE network)
+{
+    GError *error = NULL;
+
+    if (!milter_manager_applicable_condition_add_local_network(
+            SELF(self), RVAL2CSTR(network), &error))
+        RAISE_GERROR(error);
+    return self;
+}
+
+static VALUE
+add_remote_network (VALUE self, VALUE network)
+{
+    GError *error = NULL;
+
+    if (!milter_manager_applicable_condition_add_remote_network(
+            SELF(self), RVAL2CSTR(network), &error))
+        RAISE_GERROR(error);
+    return self;
+}
+
+static VALUE
+add_envelope_from_domain (int argc, VALUE *argv, VALUE self)
+{
+    VALUE domain, apply;
+
+    rb_scan_args(argc, argv, "11", &domain, &apply);
+    milter_manager_applicable_condition_add_envelope_from_domain(
+        SELF(self),
+        RVAL2CSTR(domain),
+        NIL_P(apply) ? TRUE : RVAL2CBOOL(apply));
+    return self;
+}
+
+static VALUE
+add_envelope_recipient_domain (int argc, VALUE *argv, VALUE self)
+{
+    VALUE domain, apply;
+
+    rb_scan_args(argc, argv, "11", &domain, &apply);
+    milter_manager_applicable_condition_add_envelope_recipient_domain(
+        SELF(self),
+        RVAL2CSTR(domain),
+        NIL_P(apply) ? TRUE : RVAL2CBOOL(apply));
+    return self;
+}
+
+static VALUE
+add_macro_equal (int argc, VALUE *argv, VALUE self)
+{
+    VALUE command, name, value, apply;
+    GError *error = NULL;
+
+    rb_scan_args(argc, argv, "31", &command, &name, &value, &apply);
+    if (!milter_manager_applicable_condition_add_macro_equal(
+            SELF(self),
+            RVAL2GENUM(command, MILTER_TYPE_COMMAND),
+            RVAL2CSTR(name),
+            RVAL2CSTR(value),
+            NIL_P(apply) ? TRUE : RVAL2CBOOL(apply),
+            &error))
+        RAISE_GERROR(error);
+    return self;
+}
+
+static VALUE
+add_macro_regex (int argc, VALUE *argv, VALUE self)
+{
+    VALUE command, name, pattern, apply;
+    GError *error = NULL;
+
+    rb_scan_args(argc, argv, "31", &command, &name, &pattern, &apply);
+    if (RTEST(rb_obj_is_kind_of(pattern, rb_cRegexp)))
+        pattern = rb_funcall(pattern, rb_intern("source"), 0);
+    if (!milter_manager_applicable_condition_add_macro_regex(
+            SELF(self),
+            RVAL2GENUM(command, MILTER_TYPE_COMMAND),
+            RVAL2CSTR(name),
+            RVAL2CSTR(pattern),
+            NIL_P(apply) ? TRUE : RVAL2CBOOL(apply),
+            &error))
+        RAISE_GERROR(error);
+    return self;
+}
+
+static VALUE
+set_threshold_n_connections (VALUE self, VALUE threshold_n_connections)
+{
+    milter_manager_applicable_condition_set_threshold_n_connections(
+        SELF(self), NUM2UINT(threshold_n_connections));
+    return self;
+}
+
+static VALUE
+get_threshold_n_connections (VALUE self)
+{
+    return UINT2NUM(
+        milter_manager_applicable_condition_get_threshold_n_connections(
+            SELF(self)));
+}
+
+static VALUE
+set_notify_stress (VALUE self, VALUE notify_stress)
+{
+    milter_manager_applicable_condition_set_notify_stress(
+        SELF(self), RVAL2CBOOL(notify_stress));
+    return self;
+}
+
+static VALUE
+notify_stress_p (VALUE self)
+{
+    return CBOOL2RVAL(
+        milter_manager_applicable_condition_is_notify_stress(SELF(self)));
+}
+
+static VALUE
+set_authentication (VALUE self, VALUE apply)
+{
+    milter_manager_applicable_condition_set_authentication(
+        SELF(self), RVAL2CBOOL(apply));
+    return self;
+}
+
+static VALUE
+have_native_rule_p (VALUE self)
+{
+    return CBOOL2RVAL(
+        milter_manager_applicable_condition_have_native_rule(SELF(self)));
+}
+
 void
 Init_milter_manager_applicable_condition (void)
 {
@@ -52,6 +200,35 @@ Init_milter_manager_applicable_condition (void)
                      "initialize", initialize, 1);
     rb_define_method(rb_cMilterManagerApplicableCondition,
                      "merge", merge, 1);
+    rb_define_method(rb_cMilterManagerApplicableCondition,
+                     "add_network", add_network, -1);
+    rb_define_method(rb_cMilterManagerApplicableCondition,
+                     "add_local_network", add_local_network, 1);
+    rb_define_method(rb_cMilterManagerApplicableCondition,
+                     "add_remote_network", add_remote_network, 1);
+    rb_define_method(rb_cMilterManagerApplicableCondition,
+                     "add_envelope_from_domain", add_envelope_from_domain, -1);
+    rb_define_method(rb_cMilterManagerApplicableCondition,
+                     "add_envelope_recipient_domain",
+                     add_envelope_recipient_domain, -1);
+    rb_define_method(rb_cMilterManagerApplicableCondition,
+                     "add_macro_equal", add_macro_equal, -1);
+    rb_define_method(rb_cMilterManagerApplicableCondition,
+                     "add_macro_regex", add_macro_regex, -1);
+    rb_define_method(rb_cMilterManagerApplicableCondition,
+                     "set_threshold_n_connections",
+                     set_threshold_n_connections, 1);
+    rb_define_method(rb_cMilterManagerApplicableCondition,
+                     "threshold_n_connections",
+                     get_threshold_n_connections, 0);
+    rb_define_method(rb_cMilterManagerApplicableCondition,
+                     "set_notify_stress", set_notify_stress, 1);
+    rb_define_method(rb_cMilterManagerApplicableCondition,
+                     "notify_stress?", notify_stress_p, 0);
+    rb_define_method(rb_cMilterManagerApplicableCondition,
+                     "set_authentication", set_authentication, 1);
+    rb_define_method(rb_cMilterManagerApplicableCondition,
+                     "have_native_rule?", have_native_rule_p, 0);
 
     G_DEF_SETTERS(rb_cMilterManagerApplicableCondition);
 }
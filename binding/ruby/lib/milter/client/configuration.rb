@@ -227,6 +227,14 @@ module Milter
           Milter::Logger.default.path = path
         end
 
+        def asynchronous?
+          Milter::Logger.default.asynchronous?
+        end
+
+        def asynchronous=(boolean)
+          Milter::Logger.default.asynchronous = boolean
+        end
+
         def clear
           @use_syslog = false
           @syslog_facility = "mail"
@@ -746,6 +754,15 @@ module Milter
           @configuration.path = path
         end
 
+        def asynchronous?
+          @configuration.asynchronous?
+        end
+
+        def asynchronous=(boolean)
+          update_location("asynchronous", !boolean)
+          @configuration.asynchronous = boolean
+        end
+
         private
         def update_location(key, reset, deep_level=2)
           full_key = "log.#{key}"
@@ -169,6 +169,7 @@ module Milter
         level_names << "default" if level_names.empty?
         dump_item("log.level", level_names.join("|").inspect)
         dump_item("log.path", path.inspect)
+        dump_item("log.asynchronous", Milter::Logger.default.asynchronous?)
         dump_item("log.use_syslog", c.use_syslog?)
         dump_item("log.syslog_facility", c.syslog_facility.inspect)
         @result << "\n"
@@ -201,12 +202,24 @@ module Milter
         dump_item("manager.event_loop_backend",
                   c.event_loop_backend.nick.dump)
         dump_item("manager.n_workers", c.n_workers)
+        dump_item("manager.reuse_port", c.reuse_port?)
+        dump_item("manager.direct_write", c.direct_write?)
         dump_item("manager.packet_buffer_size", c.default_packet_buffer_size)
         dump_item("manager.connection_check_interval",
                   c.connection_check_interval.inspect)
+        dump_item("manager.connection_check_budget",
+                  c.connection_check_budget)
+        dump_item("manager.use_native_connection_checker",
+                  c.use_native_connection_checker?)
         dump_item("manager.chunk_size", c.chunk_size)
         dump_item("manager.max_pending_finished_sessions",
                   c.max_pending_finished_sessions)
+        dump_item("manager.max_on_memory_body_size",
+                  c.max_on_memory_body_size)
+        dump_item("manager.body_spool_memory_budget",
+                  c.body_spool_memory_budget)
+        dump_item("manager.statistics_path", c.statistics_path.inspect)
+        dump_item("manager.statistics_rotate_size", c.statistics_rotate_size)
         @result << "\n"
       end
 
@@ -327,6 +340,9 @@ module Milter
         dump_egg_item(name, "writing_timeout", egg.writing_timeout)
         dump_egg_item(name, "reading_timeout", egg.reading_timeout)
         dump_egg_item(name, "end_of_message_timeout", egg.end_of_message_timeout)
+        dump_egg_item(name, "connection_pool_size", egg.connection_pool_size)
+        dump_egg_item(name, "connection_pool_idle_timeout",
+                      egg.connection_pool_idle_timeout)
         @result << "end\n"
       end
     end
@@ -576,6 +592,17 @@ module Milter
                 if @egg_config.has_key?("evaluation_mode")
                   milter.evaluation_mode = @egg_config["evaluation_mode"]
                 end
+                if @egg_config.has_key?("parallel_group")
+                  milter.parallel_group = @egg_config["parallel_group"]
+                end
+                if @egg_config.has_key?("connection_pool_size")
+                  milter.connection_pool_size =
+                    Integer(@egg_config["connection_pool_size"])
+                end
+                if @egg_config.has_key?("connection_pool_idle_timeout")
+                  milter.connection_pool_idle_timeout =
+                    Float(@egg_config["connection_pool_idle_timeout"])
+                end
               end
               @egg_config = nil
             when "milter_applicable_condition"
@@ -639,7 +666,9 @@ module Milter
               available_locals = ["name", "description",
                                   "enabled", "connection_spec",
                                   "command", "command_options",
-                                  "fallback_status", "evaluation_mode"]
+                                  "fallback_status", "evaluation_mode",
+                                  "parallel_group", "connection_pool_size",
+                                  "connection_pool_idle_timeout"]
               case local
               when "applicable_conditions"
                 @egg_config["applicable_conditions"] = []
@@ -933,6 +962,22 @@ module Milter
             @configuration.n_workers = n_workers
           end
 
+          def reuse_port?
+            @configuration.reuse_port?
+          end
+
+          def reuse_port=(reuse_port)
+            @configuration.reuse_port = reuse_port
+          end
+
+          def direct_write?
+            @configuration.direct_write?
+          end
+
+          def direct_write=(direct_write)
+            @configuration.direct_write = direct_write
+          end
+
           def packet_buffer_size
             @configuration.default_packet_buffer_size
           end
@@ -949,6 +994,38 @@ module Milter
             @configuration.max_pending_finished_sessions = n_sessions
           end
 
+          def max_on_memory_body_size
+            @configuration.max_on_memory_body_size
+          end
+
+          def max_on_memory_body_size=(size)
+            @configuration.max_on_memory_body_size = size
+          end
+
+          def body_spool_memory_budget
+            @configuration.body_spool_memory_budget
+          end
+
+          def body_spool_memory_budget=(size)
+            @configuration.body_spool_memory_budget = size
+          end
+
+          def statistics_path
+            @configuration.statistics_path
+          end
+
+          def statistics_path=(path)
+            @configuration.statistics_path = path
+          end
+
+          def statistics_rotate_size
+            @configuration.statistics_rotate_size
+          end
+
+          def statistics_rotate_size=(size)
+            @configuration.statistics_rotate_size = size
+          end
+
           def maintained_hooks
             @configuration.maintained_hooks
           end
@@ -1006,6 +1083,25 @@ module Milter
           @raw_configuration.connection_check_interval = interval
         end
 
+        def connection_check_budget
+          @raw_configuration.connection_check_budget
+        end
+
+        def connection_check_budget=(budget)
+          update_location("connection_check_budget", budget.nil?)
+          budget ||= 10
+          @raw_configuration.connection_check_budget = budget
+        end
+
+        def use_native_connection_checker?
+          @raw_configuration.use_native_connection_checker?
+        end
+
+        def use_native_connection_checker=(boolean)
+          update_location("use_native_connection_checker", boolean.nil?)
+          @raw_configuration.use_native_connection_checker = boolean
+        end
+
         def netstat_connection_checker
           @raw_configuration.netstat_connection_checker
         end
@@ -1032,6 +1128,11 @@ module Milter
           end
         end
 
+        def use_native_connection_checker(interval=5)
+          self.connection_check_interval = interval
+          self.use_native_connection_checker = true
+        end
+
         def report_memory_statistics
           memory_reporter = MemoryReporter.new
           maintained do
@@ -47,4 +47,35 @@ class TestApplicableCondition < Test::Unit::TestCase
     merged_condition.merge(@condition)
     assert_equal("Selective SMTP Rejection", merged_condition.description)
   end
+
+  def test_native_rule
+    assert_not_predicate(@condition, :have_native_rule?)
+    @condition.add_network("192.168.0.0/16")
+    assert_predicate(@condition, :have_native_rule?)
+  end
+
+  def test_threshold_n_connections
+    assert_equal(0, @condition.threshold_n_connections)
+    @condition.threshold_n_connections = 100
+    assert_equal(100, @condition.threshold_n_connections)
+  end
+
+  def test_local_network
+    assert_not_predicate(@condition, :have_native_rule?)
+    @condition.add_local_network("192.168.0.0/16")
+    @condition.add_remote_network("192.168.1.0/24")
+    assert_predicate(@condition, :have_native_rule?)
+  end
+
+  def test_notify_stress
+    assert_not_predicate(@condition, :notify_stress?)
+    @condition.notify_stress = true
+    assert_predicate(@condition, :notify_stress?)
+  end
+
+  def test_authentication
+    assert_not_predicate(@condition, :have_native_rule?)
+    @condition.authentication = true
+    assert_predicate(@condition, :have_native_rule?)
+  end
 end
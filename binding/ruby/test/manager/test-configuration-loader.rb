@@ -228,6 +228,33 @@ class TestConfigurationLoader < Test::Unit::TestCase
     assert_equal(0, @configuration.n_workers)
   end
 
+  def test_manager_connection_check_budget
+    assert_equal(10, @configuration.connection_check_budget)
+    @loader.manager.connection_check_budget = 100
+    assert_equal(100, @configuration.connection_check_budget)
+    @loader.manager.connection_check_budget = nil
+    assert_equal(10, @configuration.connection_check_budget)
+  end
+
+  def test_manager_use_native_connection_checker
+    assert_false(@configuration.use_native_connection_checker?)
+    @loader.manager.use_native_connection_checker(1)
+    assert_true(@configuration.use_native_connection_checker?)
+    assert_equal(1, @configuration.connection_check_interval)
+  end
+
+  def test_manager_reuse_port
+    assert_false(@configuration.reuse_port?)
+    @loader.manager.reuse_port = true
+    assert_true(@configuration.reuse_port?)
+  end
+
+  def test_manager_direct_write
+    assert_false(@configuration.direct_write?)
+    @loader.manager.direct_write = true
+    assert_true(@configuration.direct_write?)
+  end
+
   def test_manager_packet_buffer_size
     assert_equal(0, @configuration.default_packet_buffer_size)
     @loader.manager.packet_buffer_size = 4096
@@ -257,6 +284,24 @@ class TestConfigurationLoader < Test::Unit::TestCase
     assert_equal(0, @configuration.max_pending_finished_sessions)
   end
 
+  def test_manager_max_on_memory_body_size
+    assert_equal(5242880, @configuration.max_on_memory_body_size)
+    @loader.manager.max_on_memory_body_size = 1024
+    assert_equal(1024, @configuration.max_on_memory_body_size)
+  end
+
+  def test_manager_body_spool_memory_budget
+    assert_equal(0, @configuration.body_spool_memory_budget)
+    @loader.manager.body_spool_memory_budget = 104857600
+    assert_equal(104857600, @configuration.body_spool_memory_budget)
+  end
+
+  def test_manager_statistics_rotate_size
+    assert_equal(104857600, @configuration.statistics_rotate_size)
+    @loader.manager.statistics_rotate_size = 1048576
+    assert_equal(1048576, @configuration.statistics_rotate_size)
+  end
+
   def test_database_type
     assert_equal(nil, @configuration.database.type)
     @loader.database.type = "mysql"
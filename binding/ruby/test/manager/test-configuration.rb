@@ -80,6 +80,18 @@ class TestConfiguration < Test::Unit::TestCase
     assert_equal(10, @configuration.n_workers)
   end
 
+  def test_reuse_port
+    assert_false(@configuration.reuse_port?)
+    @configuration.reuse_port = true
+    assert_true(@configuration.reuse_port?)
+  end
+
+  def test_direct_write
+    assert_false(@configuration.direct_write?)
+    @configuration.direct_write = true
+    assert_true(@configuration.direct_write?)
+  end
+
   def test_default_packet_buffer_size
     assert_equal(0, @configuration.default_packet_buffer_size)
     @configuration.default_packet_buffer_size = 4096
@@ -92,6 +104,25 @@ class TestConfiguration < Test::Unit::TestCase
     assert_equal(29, @configuration.max_pending_finished_sessions)
   end
 
+  def test_max_on_memory_body_size
+    assert_equal(5242880, @configuration.max_on_memory_body_size)
+    @configuration.max_on_memory_body_size = 1024
+    assert_equal(1024, @configuration.max_on_memory_body_size)
+  end
+
+  def test_body_spool_memory_budget
+    assert_equal(0, @configuration.body_spool_memory_budget)
+    @configuration.body_spool_memory_budget = 104857600
+    assert_equal(104857600, @configuration.body_spool_memory_budget)
+  end
+
+  def test_statistics_path
+    assert_nil(@configuration.statistics_path)
+    @configuration.statistics_path = "/var/log/milter-manager/statistics.json"
+    assert_equal("/var/log/milter-manager/statistics.json",
+                 @configuration.statistics_path)
+  end
+
   def test_package
     @configuration.package_platform = "pkgsrc"
     assert_equal("pkgsrc", @configuration.package_platform)
@@ -259,6 +290,8 @@ log.level = "none"
 # default
 log.path = nil
 # default
+log.asynchronous = false
+# default
 log.use_syslog = true
 # default
 log.syslog_facility = nil
@@ -296,13 +329,29 @@ manager.event_loop_backend = "glib"
 # default
 manager.n_workers = 0
 # default
+manager.reuse_port = false
+# default
+manager.direct_write = false
+# default
 manager.packet_buffer_size = 0
 # default
 manager.connection_check_interval = 0
 # default
+manager.connection_check_budget = 10
+# default
+manager.use_native_connection_checker = false
+# default
 manager.chunk_size = 65535
 # default
 manager.max_pending_finished_sessions = 0
+# default
+manager.max_on_memory_body_size = 5242880
+# default
+manager.body_spool_memory_budget = 0
+# default
+manager.statistics_path = nil
+# default
+manager.statistics_rotate_size = 104857600
 
 # default
 controller.connection_spec = nil
@@ -404,6 +453,8 @@ log.level = "none"
 # default
 log.path = nil
 # default
+log.asynchronous = false
+# default
 log.use_syslog = true
 # default
 log.syslog_facility = nil
@@ -441,13 +492,29 @@ manager.event_loop_backend = "glib"
 # default
 manager.n_workers = 0
 # default
+manager.reuse_port = false
+# default
+manager.direct_write = false
+# default
 manager.packet_buffer_size = 0
 # default
 manager.connection_check_interval = 0
 # default
+manager.connection_check_budget = 10
+# default
+manager.use_native_connection_checker = false
+# default
 manager.chunk_size = 65535
 # default
 manager.max_pending_finished_sessions = 0
+# default
+manager.max_on_memory_body_size = 5242880
+# default
+manager.body_spool_memory_budget = 0
+# default
+manager.statistics_path = nil
+# default
+manager.statistics_rotate_size = 104857600
 
 # #{__FILE__}:#{controller_connection_spec}
 controller.connection_spec = "inet:10025"
@@ -511,6 +578,10 @@ define_milter("milter1") do |milter|
   milter.reading_timeout = 7.0
   # default
   milter.end_of_message_timeout = 297.0
+  # default
+  milter.connection_pool_size = 0
+  # default
+  milter.connection_pool_idle_timeout = 60.0
 end
 
 # #{__FILE__}:#{milter2_lines[:define]}
@@ -541,6 +612,10 @@ define_milter("milter2") do |milter|
   milter.reading_timeout = 7.0
   # default
   milter.end_of_message_timeout = 297.0
+  # default
+  milter.connection_pool_size = 0
+  # default
+  milter.connection_pool_idle_timeout = 60.0
 end
 EOD
                  @configuration.dump)
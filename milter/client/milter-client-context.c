@@ -3840,8 +3840,8 @@ cb_decoder_define_macro (MilterDecoder *decoder, MilterCommand macro_context,
     MilterClientContext *context = user_data;
 
     disable_timeout(context);
-    milter_protocol_agent_set_macros_hash_table(MILTER_PROTOCOL_AGENT(context),
-                                                macro_context, macros);
+    milter_protocol_agent_share_macros_hash_table(MILTER_PROTOCOL_AGENT(context),
+                                                  macro_context, macros);
     g_signal_emit(context, signals[DEFINE_MACRO], 0, macro_context, macros);
 }
 
@@ -4083,6 +4083,25 @@ cb_decoder_quit (MilterDecoder *decoder, gpointer user_data)
     milter_agent_shutdown(MILTER_AGENT(context));
 }
 
+static void
+cb_decoder_quit_new_connection (MilterDecoder *decoder, gpointer user_data)
+{
+    MilterClientContext *context;
+
+    context = MILTER_CLIENT_CONTEXT(user_data);
+
+    /* The negotiated options are kept. The next session starts
+     * from the connect command on the same connection. */
+    disable_timeout(context);
+    milter_client_context_reset_message_related_data(context);
+    milter_protocol_agent_clear_macros(MILTER_PROTOCOL_AGENT(context),
+                                       MILTER_COMMAND_CONNECT);
+    milter_protocol_agent_clear_macros(MILTER_PROTOCOL_AGENT(context),
+                                       MILTER_COMMAND_HELO);
+    milter_client_context_set_state(
+        context, MILTER_CLIENT_CONTEXT_STATE_NEGOTIATE_REPLIED);
+}
+
 static void
 cb_decoder_abort (MilterDecoder *decoder, gpointer user_data)
 {
@@ -4130,6 +4149,7 @@ decoder_new (MilterAgent *agent)
     CONNECT(body);
     CONNECT(end_of_message);
     CONNECT(quit);
+    CONNECT(quit_new_connection);
     CONNECT(abort);
 
 #undef CONNECT
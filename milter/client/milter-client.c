@@ -84,8 +84,12 @@ struct _MilterClientPrivate
     MilterEventLoop *event_loop;
     guint accept_watch_id;
     guint accept_error_watch_id;
+    GIOFunc accept_func;
+    gint accept_priority;
+    guint accept_resume_id;
     gchar *connection_spec;
     GList *processing_data;
+    GMutex *processing_data_mutex;
     guint n_processing_sessions;
     guint n_processed_sessions;
     guint maintenance_interval;
@@ -100,15 +104,21 @@ struct _MilterClientPrivate
     gchar *default_unix_socket_group;
     gboolean default_remove_unix_socket_on_close;
     gboolean remove_unix_socket_on_create;
+    gboolean reuse_port;
+    gboolean direct_write;
     guint suspend_time_on_unacceptable;
     guint max_connections;
     gboolean multi_thread_mode;
     GThreadPool *worker_threads;
+    guint n_event_loop_threads;
+    GPtrArray *loop_threads;
+    guint next_loop_thread;
     struct {
         GIOChannel *control;
         guint n_process;
         guint id;
         GArray *pids;
+        GPtrArray *listen_channels;
     } workers;
     struct sockaddr *address;
     socklen_t address_size;
@@ -196,6 +206,8 @@ static guint        get_n_workers
 static void         set_n_workers
                            (MilterClient    *client,
                             guint            n_workers);
+static void         loop_threads_stop
+                           (MilterClient    *client);
 static const gchar *get_pid_file
                            (MilterClient    *client);
 static void         set_pid_file
@@ -491,8 +503,12 @@ _milter_client_init (MilterClient *client)
 
     priv->accept_watch_id = 0;
     priv->accept_error_watch_id = 0;
+    priv->accept_func = NULL;
+    priv->accept_priority = G_PRIORITY_DEFAULT;
+    priv->accept_resume_id = 0;
     priv->connection_spec = NULL;
     priv->processing_data = NULL;
+    priv->processing_data_mutex = g_mutex_new();
     priv->n_processing_sessions = 0;
     priv->n_processed_sessions = 0;
     priv->maintenance_interval = 0;
@@ -507,15 +523,21 @@ _milter_client_init (MilterClient *client)
     priv->default_unix_socket_group = NULL;
     priv->default_remove_unix_socket_on_close = TRUE;
     priv->remove_unix_socket_on_create = TRUE;
+    priv->reuse_port = FALSE;
+    priv->direct_write = FALSE;
     priv->suspend_time_on_unacceptable =
         MILTER_CLIENT_DEFAULT_SUSPEND_TIME_ON_UNACCEPTABLE;
     priv->max_connections = MILTER_CLIENT_DEFAULT_MAX_CONNECTIONS;
     priv->multi_thread_mode = FALSE;
+    priv->n_event_loop_threads = 0;
+    priv->loop_threads = NULL;
+    priv->next_loop_thread = 0;
     priv->worker_threads = NULL;
     priv->workers.n_process = 0;
     priv->workers.id = 0;
     priv->workers.control = NULL;
     priv->workers.pids = NULL;
+    priv->workers.listen_channels = NULL;
     priv->address = NULL;
     priv->address_size = 0;
     priv->effective_user = NULL;
@@ -560,6 +582,14 @@ process_data_free (MilterClientProcessData *data)
     g_free(data);
 }
 
+static void
+add_processing_data (MilterClientPrivate *priv, MilterClientProcessData *data)
+{
+    g_mutex_lock(priv->processing_data_mutex);
+    priv->processing_data = g_list_prepend(priv->processing_data, data);
+    g_mutex_unlock(priv->processing_data_mutex);
+}
+
 static void
 dispose_address (MilterClientPrivate *priv)
 {
@@ -591,8 +621,10 @@ finish_processing (MilterClientProcessData *data)
         milter_debug("[%u] [client][finish]", tag);
     }
 
+    g_mutex_lock(data->priv->processing_data_mutex);
     data->priv->processing_data =
         g_list_remove(data->priv->processing_data, data);
+    g_mutex_unlock(data->priv->processing_data_mutex);
     milter_client_session_finished(data->client);
 
     if (data->priv->quitting && data->priv->event_loop) {
@@ -608,7 +640,9 @@ finish_processing (MilterClientProcessData *data)
     if (milter_need_debug_log()) {
         GList *processing_data, *process_data;
 
+        g_mutex_lock(data->priv->processing_data_mutex);
         processing_data = g_list_copy(data->priv->processing_data);
+        g_mutex_unlock(data->priv->processing_data_mutex);
         rest_process = g_string_new("[");
         for (process_data = processing_data;
              process_data;
@@ -695,16 +729,74 @@ dispose_finished_data (MilterClient *client)
     }
 }
 
+static void
+unref_listen_channel (gpointer data, gpointer user_data)
+{
+    if (data)
+        g_io_channel_unref(data);
+}
+
+static void
+dispose_worker_listen_channels (MilterClientPrivate *priv)
+{
+    if (priv->workers.listen_channels) {
+        g_ptr_array_foreach(priv->workers.listen_channels,
+                            unref_listen_channel, NULL);
+        g_ptr_array_free(priv->workers.listen_channels, TRUE);
+        priv->workers.listen_channels = NULL;
+    }
+}
+
 static void
 watch_worker_process (GPid     pid,
                       gint     status,
                       gpointer data)
 {
+    MilterClient *client = data;
+    MilterClientPrivate *priv;
+    guint i;
+
+    priv = MILTER_CLIENT_GET_PRIVATE(client);
+    if (!priv->workers.pids || !priv->workers.listen_channels)
+        return;
+
+    for (i = 0; i < priv->workers.pids->len; i++) {
+        GIOChannel *channel;
+
+        if (g_array_index(priv->workers.pids, GPid, i) != pid)
+            continue;
+        if (i >= priv->workers.listen_channels->len)
+            break;
+
+        channel = g_ptr_array_index(priv->workers.listen_channels, i);
+        if (channel) {
+            milter_debug("[client][worker][exit][listen][close] "
+                         "<%d>:<%u>",
+                         pid, i + 1);
+            g_io_channel_unref(channel);
+            g_ptr_array_index(priv->workers.listen_channels, i) = NULL;
+        }
+        break;
+    }
+}
+
+static MilterEventLoop *
+get_accept_loop (MilterClientPrivate *priv)
+{
+    if (priv->accept_loop)
+        return priv->accept_loop;
+    return priv->event_loop;
 }
 
 static void
 dispose_accept_watchers (MilterClientPrivate *priv)
 {
+    if (priv->accept_resume_id > 0) {
+        milter_event_loop_remove(get_accept_loop(priv),
+                                 priv->accept_resume_id);
+        priv->accept_resume_id = 0;
+    }
+
     if (priv->accept_watch_id > 0) {
         if (priv->accept_loop) {
             milter_event_loop_remove(priv->accept_loop, priv->accept_watch_id);
@@ -752,6 +844,8 @@ dispose (GObject *object)
         priv->workers.pids = NULL;
     }
 
+    dispose_worker_listen_channels(priv);
+
     if (priv->listening_channel) {
         g_io_channel_unref(priv->listening_channel);
         priv->listening_channel = NULL;
@@ -790,6 +884,11 @@ dispose (GObject *object)
         priv->quit_mutex = NULL;
     }
 
+    if (priv->processing_data_mutex) {
+        g_mutex_free(priv->processing_data_mutex);
+        priv->processing_data_mutex = NULL;
+    }
+
     if (priv->unix_socket_group) {
         g_free(priv->unix_socket_group);
         priv->unix_socket_group = NULL;
@@ -805,6 +904,8 @@ dispose (GObject *object)
         priv->worker_threads = NULL;
     }
 
+    loop_threads_stop(MILTER_CLIENT(object));
+
     dispose_address(priv);
 
     if (priv->effective_user) {
@@ -1223,24 +1324,24 @@ static gboolean
 milter_client_start_context (MilterClient *client,
                              MilterClientContext *context,
                              GIOChannel *channel,
+                             MilterEventLoop *loop,
                              MilterGenericSocketAddress *address,
                              GError **error)
 {
-    MilterClientPrivate *priv;
     MilterAgent *agent;
     MilterWriter *writer;
     MilterReader *reader;
 
     agent = MILTER_AGENT(context);
-    priv = MILTER_CLIENT_GET_PRIVATE(client);
 
-    milter_agent_set_event_loop(agent, priv->event_loop);
+    milter_agent_set_event_loop(agent, loop);
 
-    writer = milter_writer_io_channel_new(channel);
+    writer = milter_writer_unix_io_channel_new(channel);
+    milter_writer_set_direct_write(writer, milter_client_is_direct_write(client));
     milter_agent_set_writer(agent, writer);
     g_object_unref(writer);
 
-    reader = milter_reader_io_channel_new(channel);
+    reader = milter_reader_unix_io_channel_new(channel);
     milter_agent_set_reader(agent, reader);
     g_object_unref(reader);
 
@@ -1285,9 +1386,10 @@ single_thread_client_channel_setup (MilterClient *client,
         g_signal_connect(context, "finished",
                          G_CALLBACK(single_thread_cb_finished), data);
 
-    priv->processing_data = g_list_prepend(priv->processing_data, data);
+    add_processing_data(priv, data);
 
-    if (milter_client_start_context(client, context, channel, address, &error)) {
+    if (milter_client_start_context(client, context, channel,
+                                    priv->event_loop, address, &error)) {
         g_signal_emit(client, signals[CONNECTION_ESTABLISHED], 0, context);
     } else {
         milter_error("[%u] [client][single-thread][start][error] %s",
@@ -1335,6 +1437,93 @@ single_thread_process_client_channel (MilterClient *client, GIOChannel *channel,
                                     NULL);
 }
 
+static void
+watch_accept (MilterClient *client)
+{
+    MilterClientPrivate *priv;
+
+    priv = MILTER_CLIENT_GET_PRIVATE(client);
+    priv->accept_watch_id =
+        milter_event_loop_watch_io_full(get_accept_loop(priv),
+                                        priv->accept_priority,
+                                        priv->listening_channel,
+                                        G_IO_IN | G_IO_PRI,
+                                        priv->accept_func,
+                                        client,
+                                        NULL);
+}
+
+static void
+resume_accept (MilterClient *client)
+{
+    MilterClientPrivate *priv;
+
+    priv = MILTER_CLIENT_GET_PRIVATE(client);
+
+    if (priv->accept_resume_id > 0) {
+        milter_event_loop_remove(get_accept_loop(priv),
+                                 priv->accept_resume_id);
+        priv->accept_resume_id = 0;
+    }
+
+    if (priv->quitting ||
+        !priv->listening_channel ||
+        priv->accept_watch_id > 0)
+        return;
+
+    milter_warning("[client][accept][resume] "
+                   "resume accepting connection: processing: <%u>",
+                   priv->n_processing_sessions);
+    watch_accept(client);
+}
+
+static gboolean
+cb_resume_accept (gpointer data)
+{
+    MilterClient *client = data;
+    MilterClientPrivate *priv;
+
+    priv = MILTER_CLIENT_GET_PRIVATE(client);
+    priv->accept_resume_id = 0;
+    resume_accept(client);
+
+    return FALSE;
+}
+
+static void
+suspend_accept (MilterClient *client, guint suspend_time)
+{
+    MilterClientPrivate *priv;
+    MilterEventLoop *loop;
+
+    priv = MILTER_CLIENT_GET_PRIVATE(client);
+
+    if (priv->accept_watch_id == 0)
+        return;
+
+    loop = get_accept_loop(priv);
+    milter_event_loop_remove(loop, priv->accept_watch_id);
+    priv->accept_watch_id = 0;
+    priv->accept_resume_id = milter_event_loop_add_timeout(loop,
+                                                           suspend_time,
+                                                           cb_resume_accept,
+                                                           client);
+}
+
+static gboolean
+is_below_low_water_mark (MilterClient *client)
+{
+    MilterClientPrivate *priv;
+    guint max_connections;
+
+    priv = MILTER_CLIENT_GET_PRIVATE(client);
+    max_connections = milter_client_get_max_connections(client);
+    if (max_connections == 0)
+        return TRUE;
+
+    return priv->n_processing_sessions * 4 < max_connections * 3;
+}
+
 static gint
 accept_connection_fd (MilterClient *client, gint server_fd,
                       MilterGenericSocketAddress *address,
@@ -1342,25 +1531,22 @@ accept_connection_fd (MilterClient *client, gint server_fd,
 {
     MilterClientPrivate *priv;
     gint client_fd;
-    guint n_suspend, suspend_time, max_connections;
+    guint suspend_time, max_connections;
 
     priv = MILTER_CLIENT_GET_PRIVATE(client);
 
     suspend_time = milter_client_get_suspend_time_on_unacceptable(client);
     max_connections = milter_client_get_max_connections(client);
-    for (n_suspend = 0;
-         0 < max_connections && max_connections <= priv->n_processing_sessions;
-         n_suspend++) {
+    if (0 < max_connections && max_connections <= priv->n_processing_sessions) {
         milter_warning("[client][accept][suspend] "
                        "too many processing connection: %u, max: %u; "
-                       "suspend accepting connection in %d seconds: #%u",
+                       "suspend accepting connection in %d seconds",
                        priv->n_processing_sessions,
                        max_connections,
-                       suspend_time,
-                       n_suspend);
-        g_usleep(suspend_time * G_USEC_PER_SEC);
-        milter_warning("[client][accept][resume] "
-                       "resume accepting connection: #%u", n_suspend);
+                       suspend_time);
+        suspend_accept(client, suspend_time);
+        errno = EAGAIN;
+        return -1;
     }
 
     *address_size = sizeof(*address);
@@ -1386,9 +1572,8 @@ accept_connection_fd (MilterClient *client, gint server_fd,
                            "too many file is opened. "
                            "suspend accepting connection in %d seconds",
                            suspend_time);
-            g_usleep(suspend_time * G_USEC_PER_SEC);
-            milter_warning("[client][accept][resume] "
-                           "resume accepting connection.");
+            suspend_accept(client, suspend_time);
+            errno = EMFILE;
         }
 
         return client_fd;
@@ -1566,8 +1751,9 @@ multi_thread_process_client_channel (MilterClient *client, GIOChannel *channel,
     data->context = context;
     data->finished_handler_id = 0;
 
-    priv->processing_data = g_list_prepend(priv->processing_data, data);
-    if (milter_client_start_context(client, context, channel, address, &error)) {
+    add_processing_data(priv, data);
+    if (milter_client_start_context(client, context, channel,
+                                    priv->event_loop, address, &error)) {
         g_thread_pool_push(priv->worker_threads, data, &error);
         if (error) {
             GError *client_error;
@@ -1712,6 +1898,400 @@ multi_thread_start_accept (MilterClient *client, GError **error)
     return TRUE;
 }
 
+#define LOOP_THREAD_QUEUE_SIZE 1024
+#define LOOP_THREAD_QUEUE_INDEX_SIZE (LOOP_THREAD_QUEUE_SIZE * 2)
+
+typedef struct _LoopThreadConnection
+{
+    gint fd;
+    MilterGenericSocketAddress address;
+    socklen_t address_size;
+} LoopThreadConnection;
+
+typedef struct _LoopThread
+{
+    MilterClient *client;
+    guint id;
+    GThread *thread;
+    MilterEventLoop *loop;
+    gint wakeup_fds[2];
+    GIOChannel *wakeup_channel;
+    guint wakeup_watch_id;
+    volatile gint notified;
+    volatile gint quitting;
+    volatile gint head;
+    volatile gint tail;
+    LoopThreadConnection *queue[LOOP_THREAD_QUEUE_SIZE];
+} LoopThread;
+
+static void
+loop_thread_cb_finished (MilterClientContext *context, gpointer _data)
+{
+    MilterClientProcessData *data = _data;
+
+    finish_processing(data);
+}
+
+static void
+loop_thread_process_connection (LoopThread *loop_thread,
+                                LoopThreadConnection *connection)
+{
+    MilterClient *client;
+    MilterClientPrivate *priv;
+    MilterAgent *agent;
+    MilterClientContext *context;
+    MilterClientProcessData *data;
+    GIOChannel *channel;
+    GError *error = NULL;
+
+    client = loop_thread->client;
+    priv = MILTER_CLIENT_GET_PRIVATE(client);
+
+    channel = setup_client_channel(connection->fd);
+    context = milter_client_create_context(client);
+    agent = MILTER_AGENT(context);
+
+    data = g_new(MilterClientProcessData, 1);
+    data->priv = priv;
+    data->client = client;
+    data->context = context;
+
+    milter_debug("[%u] [client][loop-thread][start] <%u>",
+                 milter_agent_get_tag(agent), loop_thread->id);
+
+    data->finished_handler_id =
+        g_signal_connect(context, "finished",
+                         G_CALLBACK(loop_thread_cb_finished), data);
+
+    add_processing_data(priv, data);
+
+    if (milter_client_start_context(client, context, channel,
+                                    loop_thread->loop,
+                                    &(connection->address), &error)) {
+        g_signal_emit(client, signals[CONNECTION_ESTABLISHED], 0, context);
+    } else {
+        milter_error("[%u] [client][loop-thread][start][error] <%u>: %s",
+                     milter_agent_get_tag(agent),
+                     loop_thread->id,
+                     error->message);
+        milter_error_emittable_emit(MILTER_ERROR_EMITTABLE(agent), error);
+        g_error_free(error);
+        milter_finished_emittable_emit(MILTER_FINISHED_EMITTABLE(context));
+    }
+
+    g_io_channel_unref(channel);
+    g_free(connection);
+}
+
+static LoopThreadConnection *
+loop_thread_pop (LoopThread *loop_thread)
+{
+    LoopThreadConnection *connection;
+    gint head;
+
+    head = loop_thread->head;
+    if (head == g_atomic_int_get(&(loop_thread->tail)))
+        return NULL;
+
+    connection = loop_thread->queue[head % LOOP_THREAD_QUEUE_SIZE];
+    g_atomic_int_set(&(loop_thread->head),
+                     (head + 1) % LOOP_THREAD_QUEUE_INDEX_SIZE);
+    return connection;
+}
+
+static gboolean
+loop_thread_push (LoopThread *loop_thread, LoopThreadConnection *connection)
+{
+    gint head, tail;
+
+    tail = loop_thread->tail;
+    head = g_atomic_int_get(&(loop_thread->head));
+    if ((tail - head + LOOP_THREAD_QUEUE_INDEX_SIZE) %
+        LOOP_THREAD_QUEUE_INDEX_SIZE == LOOP_THREAD_QUEUE_SIZE)
+        return FALSE;
+
+    loop_thread->queue[tail % LOOP_THREAD_QUEUE_SIZE] = connection;
+    g_atomic_int_set(&(loop_thread->tail),
+                     (tail + 1) % LOOP_THREAD_QUEUE_INDEX_SIZE);
+
+    if (g_atomic_int_compare_and_exchange(&(loop_thread->notified), 0, 1)) {
+        if (write(loop_thread->wakeup_fds[1], "", 1) == -1 &&
+            errno != EAGAIN) {
+            milter_error("[client][loop-thread][wakeup][error] <%u>: %s",
+                         loop_thread->id, g_strerror(errno));
+        }
+    }
+
+    return TRUE;
+}
+
+static gboolean
+loop_thread_wakeup_watch_func (GIOChannel *channel, GIOCondition condition,
+                               gpointer data)
+{
+    LoopThread *loop_thread = data;
+    LoopThreadConnection *connection;
+    gchar buffer[64];
+
+    while (read(loop_thread->wakeup_fds[0], buffer, sizeof(buffer)) > 0) {
+    }
+    g_atomic_int_set(&(loop_thread->notified), 0);
+
+    while ((connection = loop_thread_pop(loop_thread))) {
+        loop_thread_process_connection(loop_thread, connection);
+    }
+
+    if (g_atomic_int_get(&(loop_thread->quitting))) {
+        milter_debug("[client][loop-thread][quit] <%u>", loop_thread->id);
+        milter_event_loop_quit(loop_thread->loop);
+    }
+
+    return TRUE;
+}
+
+static gpointer
+loop_thread_run (gpointer data)
+{
+    LoopThread *loop_thread = data;
+
+    milter_debug("[client][loop-thread][run] <%u>", loop_thread->id);
+    milter_event_loop_run(loop_thread->loop);
+
+    return NULL;
+}
+
+static void
+loop_thread_free (LoopThread *loop_thread)
+{
+    LoopThreadConnection *connection;
+
+    if (loop_thread->wakeup_watch_id > 0)
+        milter_event_loop_remove(loop_thread->loop,
+                                 loop_thread->wakeup_watch_id);
+    if (loop_thread->wakeup_channel)
+        g_io_channel_unref(loop_thread->wakeup_channel);
+    if (loop_thread->wakeup_fds[0] != -1)
+        close(loop_thread->wakeup_fds[0]);
+    if (loop_thread->wakeup_fds[1] != -1)
+        close(loop_thread->wakeup_fds[1]);
+
+    while ((connection = loop_thread_pop(loop_thread))) {
+        close(connection->fd);
+        g_free(connection);
+        milter_client_session_finished(loop_thread->client);
+    }
+
+    if (loop_thread->loop)
+        g_object_unref(loop_thread->loop);
+    g_free(loop_thread);
+}
+
+static LoopThread *
+loop_thread_new (MilterClient *client, guint id, GError **error)
+{
+    LoopThread *loop_thread;
+    GError *local_error = NULL;
+
+    loop_thread = g_new0(LoopThread, 1);
+    loop_thread->client = client;
+    loop_thread->id = id;
+    loop_thread->wakeup_fds[0] = -1;
+    loop_thread->wakeup_fds[1] = -1;
+
+    if (pipe(loop_thread->wakeup_fds) == -1) {
+        g_set_error(error,
+                    MILTER_CLIENT_ERROR,
+                    MILTER_CLIENT_ERROR_THREAD,
+                    "failed to create a wakeup pipe for event loop thread: "
+                    "<%u>: %s",
+                    id, g_strerror(errno));
+        loop_thread->wakeup_fds[0] = -1;
+        loop_thread->wakeup_fds[1] = -1;
+        loop_thread_free(loop_thread);
+        return NULL;
+    }
+    fcntl(loop_thread->wakeup_fds[1], F_SETFL, O_NONBLOCK);
+
+    loop_thread->loop = milter_client_create_event_loop(client, FALSE);
+    loop_thread->wakeup_channel =
+        g_io_channel_unix_new(loop_thread->wakeup_fds[0]);
+    g_io_channel_set_encoding(loop_thread->wakeup_channel, NULL, NULL);
+    g_io_channel_set_flags(loop_thread->wakeup_channel,
+                           G_IO_FLAG_NONBLOCK, NULL);
+    loop_thread->wakeup_watch_id =
+        milter_event_loop_watch_io(loop_thread->loop,
+                                   loop_thread->wakeup_channel,
+                                   G_IO_IN | G_IO_PRI,
+                                   loop_thread_wakeup_watch_func,
+                                   loop_thread);
+
+    loop_thread->thread = g_thread_try_new("loop_thread",
+                                           loop_thread_run,
+                                           loop_thread,
+                                           &local_error);
+    if (!loop_thread->thread) {
+        g_set_error(error,
+                    MILTER_CLIENT_ERROR,
+                    MILTER_CLIENT_ERROR_THREAD,
+                    "failed to create event loop thread: <%u>: %s",
+                    id, local_error->message);
+        g_error_free(local_error);
+        loop_thread_free(loop_thread);
+        return NULL;
+    }
+
+    return loop_thread;
+}
+
+static void
+loop_threads_stop (MilterClient *client)
+{
+    MilterClientPrivate *priv;
+    guint i;
+
+    priv = MILTER_CLIENT_GET_PRIVATE(client);
+    if (!priv->loop_threads)
+        return;
+
+    for (i = 0; i < priv->loop_threads->len; i++) {
+        LoopThread *loop_thread;
+
+        loop_thread = g_ptr_array_index(priv->loop_threads, i);
+        g_atomic_int_set(&(loop_thread->quitting), 1);
+        if (write(loop_thread->wakeup_fds[1], "", 1) == -1 &&
+            errno != EAGAIN) {
+            milter_error("[client][loop-thread][quit][error] <%u>: %s",
+                         loop_thread->id, g_strerror(errno));
+        }
+    }
+
+    for (i = 0; i < priv->loop_threads->len; i++) {
+        LoopThread *loop_thread;
+
+        loop_thread = g_ptr_array_index(priv->loop_threads, i);
+        g_thread_join(loop_thread->thread);
+        loop_thread_free(loop_thread);
+    }
+
+    g_ptr_array_free(priv->loop_threads, TRUE);
+    priv->loop_threads = NULL;
+}
+
+static gboolean
+loop_threads_start (MilterClient *client, GError **error)
+{
+    MilterClientPrivate *priv;
+    guint i;
+
+    priv = MILTER_CLIENT_GET_PRIVATE(client);
+    priv->loop_threads = g_ptr_array_sized_new(priv->n_event_loop_threads);
+    priv->next_loop_thread = 0;
+    for (i = 0; i < priv->n_event_loop_threads; i++) {
+        LoopThread *loop_thread;
+        GError *local_error = NULL;
+
+        loop_thread = loop_thread_new(client, i, &local_error);
+        if (!loop_thread) {
+            milter_error("[client][loop-thread][start][error] %s",
+                         local_error->message);
+            g_propagate_error(error, local_error);
+            loop_threads_stop(client);
+            return FALSE;
+        }
+        g_ptr_array_add(priv->loop_threads, loop_thread);
+    }
+
+    return TRUE;
+}
+
+static gboolean
+loop_threads_dispatch (MilterClientPrivate *priv,
+                       LoopThreadConnection *connection)
+{
+    guint i, n_threads;
+
+    n_threads = priv->loop_threads->len;
+    for (i = 0; i < n_threads; i++) {
+        LoopThread *loop_thread;
+        guint index;
+
+        index = (priv->next_loop_thread + i) % n_threads;
+        loop_thread = g_ptr_array_index(priv->loop_threads, index);
+        if (loop_thread_push(loop_thread, connection)) {
+            priv->next_loop_thread = (index + 1) % n_threads;
+            return TRUE;
+        }
+    }
+
+    return FALSE;
+}
+
+static gboolean
+loop_thread_accept_watch_func (GIOChannel *channel, GIOCondition condition,
+                               gpointer data)
+{
+    MilterClient *client = data;
+    MilterClientPrivate *priv;
+    LoopThreadConnection *connection;
+    gint server_fd;
+
+    priv = MILTER_CLIENT_GET_PRIVATE(client);
+
+    server_fd = g_io_channel_unix_get_fd(channel);
+    connection = g_new(LoopThreadConnection, 1);
+    connection->fd = accept_connection_fd(client, server_fd,
+                                          &(connection->address),
+                                          &(connection->address_size));
+    if (connection->fd == -1) {
+        g_free(connection);
+        return TRUE;
+    }
+
+    if (!loop_threads_dispatch(priv, connection)) {
+        milter_warning("[client][loop-thread][dispatch][full] "
+                       "all event loop threads are busy: <%d>",
+                       connection->fd);
+        close(connection->fd);
+        g_free(connection);
+        milter_client_session_finished(client);
+    }
+
+    return TRUE;
+}
+
+static gboolean
+loop_threads_run (MilterClient *client, GError **error)
+{
+    MilterClientPrivate *priv;
+    MilterEventLoop *loop;
+
+    priv = MILTER_CLIENT_GET_PRIVATE(client);
+
+    loop = milter_client_get_event_loop(client);
+    if (!loop) {
+        loop = milter_client_create_event_loop(client, TRUE);
+        milter_client_set_event_loop(client, loop);
+    }
+
+    if (!loop_threads_start(client, error))
+        return FALSE;
+
+    if (!milter_client_prepare(client,
+                               loop,
+                               loop_thread_accept_watch_func,
+                               error)) {
+        loop_threads_stop(client);
+        return FALSE;
+    }
+
+    milter_info("[client][loop-thread][run] <%u>", priv->loop_threads->len);
+    milter_event_loop_run(loop);
+    loop_threads_stop(client);
+
+    return TRUE;
+}
+
+
 
 static GIOChannel *
 milter_client_listen_channel (MilterClient  *client, GError **error)
@@ -1725,12 +2305,13 @@ milter_client_listen_channel (MilterClient  *client, GError **error)
     dispose_address(priv);
 
     connection_spec = milter_client_get_connection_spec(client);
-    channel = milter_connection_listen(connection_spec,
-                                       priv->listen_backlog,
-                                       &(priv->address),
-                                       &(priv->address_size),
-                                       priv->remove_unix_socket_on_create,
-                                       error);
+    channel = milter_connection_listen_full(connection_spec,
+                                            priv->listen_backlog,
+                                            &(priv->address),
+                                            &(priv->address_size),
+                                            priv->remove_unix_socket_on_create,
+                                            priv->reuse_port,
+                                            error);
     if (priv->address_size > 0) {
         g_signal_emit(client, signals[LISTEN_STARTED], 0,
                       priv->address, priv->address_size);
@@ -1739,17 +2320,88 @@ milter_client_listen_channel (MilterClient  *client, GError **error)
     return channel;
 }
 
+static gboolean
+listen_worker_channels (MilterClient *client, GError **error)
+{
+    MilterClientPrivate *priv;
+    guint i, n_workers;
+    gint listen_fd;
+    MilterGenericSocketAddress address;
+    socklen_t address_size;
+    gchar *spec;
+
+    priv = MILTER_CLIENT_GET_PRIVATE(client);
+
+    dispose_worker_listen_channels(priv);
+
+    n_workers = milter_client_get_n_workers(client);
+    if (n_workers <= 1)
+        return TRUE;
+
+    listen_fd = g_io_channel_unix_get_fd(priv->listen_channel);
+    address_size = sizeof(address);
+    if (getsockname(listen_fd, &(address.address.base), &address_size) == -1) {
+        g_set_error(error,
+                    MILTER_CLIENT_ERROR,
+                    MILTER_CLIENT_ERROR_IO_ERROR,
+                    "failed to get listen address: %s",
+                    g_strerror(errno));
+        return FALSE;
+    }
+    if (address.address.base.sa_family != AF_INET &&
+        address.address.base.sa_family != AF_INET6) {
+        milter_debug("[client][listen][reuse-port][skip] "
+                     "not TCP connection spec: <%s>",
+                     milter_client_get_connection_spec(client));
+        return TRUE;
+    }
+
+    /* use the bound address to reuse the same port for "inet:0". */
+    spec = milter_connection_address_to_spec(&(address.address.base));
+    priv->workers.listen_channels = g_ptr_array_sized_new(n_workers);
+    g_io_channel_ref(priv->listen_channel);
+    g_ptr_array_add(priv->workers.listen_channels, priv->listen_channel);
+    for (i = 1; i < n_workers; i++) {
+        GIOChannel *channel;
+
+        channel = milter_connection_listen_full(spec,
+                                                priv->listen_backlog,
+                                                NULL,
+                                                NULL,
+                                                FALSE,
+                                                TRUE,
+                                                error);
+        if (!channel) {
+            dispose_worker_listen_channels(priv);
+            g_free(spec);
+            return FALSE;
+        }
+        g_ptr_array_add(priv->workers.listen_channels, channel);
+    }
+    milter_debug("[client][listen][reuse-port] <%s>:<%u>", spec, n_workers);
+    g_free(spec);
+
+    return TRUE;
+}
+
 gboolean
 milter_client_listen (MilterClient  *client, GError **error)
 {
+    MilterClientPrivate *priv;
     GIOChannel *channel;
 
+    priv = MILTER_CLIENT_GET_PRIVATE(client);
+
     channel = milter_client_listen_channel(client, error);
     if (!channel)
         return FALSE;
 
     milter_client_set_listen_channel(client, channel);
     g_io_channel_unref(channel);
+
+    if (priv->reuse_port)
+        return listen_worker_channels(client, error);
+
     return TRUE;
 }
 
@@ -2030,11 +2682,9 @@ milter_client_prepare (MilterClient *client, MilterEventLoop *loop,
         return FALSE;
     }
 
-    priv->accept_watch_id =
-        milter_event_loop_watch_io(loop,
-                                   priv->listening_channel,
-                                   G_IO_IN | G_IO_PRI,
-                                   accept_func, client);
+    priv->accept_func = accept_func;
+    priv->accept_priority = G_PRIORITY_DEFAULT;
+    watch_accept(client);
     priv->accept_error_watch_id =
         milter_event_loop_watch_io(loop,
                                    priv->listening_channel,
@@ -2173,6 +2823,12 @@ client_run_workers (MilterClient *client, guint n_workers, GError **error)
             close(pipe_fds[MILTER_UTILS_WRITE_PIPE]);
             priv->workers.control = setup_client_channel(pipe_fds[MILTER_UTILS_READ_PIPE]);
             priv->workers.id = i + 1;
+            if (priv->workers.listen_channels) {
+                milter_client_set_listen_channel(
+                    client,
+                    g_ptr_array_index(priv->workers.listen_channels, i));
+                dispose_worker_listen_channels(priv);
+            }
             milter_event_loop_watch_io(loop, priv->workers.control,
                                        G_IO_IN | G_IO_PRI | G_IO_ERR | G_IO_HUP,
                                        worker_watch_master, client);
@@ -2182,7 +2838,8 @@ client_run_workers (MilterClient *client, guint n_workers, GError **error)
             _exit(EXIT_SUCCESS);
         default:
             g_array_append_val(priv->workers.pids, pid);
-            milter_event_loop_watch_child(loop, pid, watch_worker_process, NULL);
+            milter_event_loop_watch_child(loop, pid, watch_worker_process,
+                                          client);
             break;
         case -1:
             g_set_error(error,
@@ -2197,6 +2854,11 @@ client_run_workers (MilterClient *client, guint n_workers, GError **error)
     }
     close(pipe_fds[MILTER_UTILS_READ_PIPE]);
     priv->workers.control = setup_client_channel(pipe_fds[MILTER_UTILS_WRITE_PIPE]);
+    if (priv->workers.listen_channels) {
+        /* Each worker's socket must be closed when the worker exits.
+         * Otherwise the kernel keeps queueing connections to it. */
+        milter_client_set_listen_channel(client, NULL);
+    }
 
     milter_info("[client][workers][run] <%d>", n_workers);
     return TRUE;
@@ -2282,6 +2944,9 @@ milter_client_run_loop (MilterClient *client, GError **error)
             return FALSE;
         }
         success = multi_thread_start_accept(client, error);
+    } else if (priv->n_event_loop_threads > 0) {
+        milter_debug("[client][loop-thread] <%u>", priv->n_event_loop_threads);
+        success = loop_threads_run(client, error);
     } else {
         const gchar *use_accept_loop_env;
         gboolean use_accept_loop = FALSE;
@@ -2438,7 +3103,7 @@ worker_accept_watch_func (GIOChannel *channel, GIOCondition condition,
     server_fd = g_io_channel_unix_get_fd(channel);
     client_fd = accept_connection_fd(client, server_fd, &address, &address_size);
     if (client_fd == -1) {
-        keep_callback = errno == EAGAIN;
+        keep_callback = (errno == EAGAIN || errno == EMFILE);
     } else {
         GIOChannel *client_channel;
         client_channel = setup_client_channel(client_fd);
@@ -2487,14 +3152,9 @@ run_worker (MilterClient *client, GError **error)
 
     priv->quitting = FALSE;
     loop = milter_client_get_event_loop(client);
-    priv->accept_watch_id =
-        milter_event_loop_watch_io_full(loop,
-                                        G_PRIORITY_HIGH,
-                                        priv->listening_channel,
-                                        G_IO_IN | G_IO_PRI,
-                                        worker_accept_watch_func,
-                                        client,
-                                        NULL);
+    priv->accept_func = worker_accept_watch_func;
+    priv->accept_priority = G_PRIORITY_HIGH;
+    watch_accept(client);
     priv->accept_error_watch_id =
         milter_event_loop_watch_io_full(loop,
                                         G_PRIORITY_HIGH,
@@ -2556,6 +3216,56 @@ milter_client_set_remove_unix_socket_on_create (MilterClient *client,
     MILTER_CLIENT_GET_PRIVATE(client)->remove_unix_socket_on_create = remove;
 }
 
+gboolean
+milter_client_is_reuse_port (MilterClient *client)
+{
+    return MILTER_CLIENT_GET_PRIVATE(client)->reuse_port;
+}
+
+void
+milter_client_set_reuse_port (MilterClient *client, gboolean reuse_port)
+{
+    MILTER_CLIENT_GET_PRIVATE(client)->reuse_port = reuse_port;
+}
+
+gboolean
+milter_client_is_direct_write (MilterClient *client)
+{
+    return MILTER_CLIENT_GET_PRIVATE(client)->direct_write;
+}
+
+void
+milter_client_set_direct_write (MilterClient *client, gboolean direct_write)
+{
+    MILTER_CLIENT_GET_PRIVATE(client)->direct_write = direct_write;
+}
+
+guint
+milter_client_get_n_event_loop_threads (MilterClient *client)
+{
+    return MILTER_CLIENT_GET_PRIVATE(client)->n_event_loop_threads;
+}
+
+void
+milter_client_set_n_event_loop_threads (MilterClient *client, guint n_threads)
+{
+    MILTER_CLIENT_GET_PRIVATE(client)->n_event_loop_threads = n_threads;
+}
+
+GIOChannel *
+milter_client_get_worker_listen_channel (MilterClient *client, guint worker_id)
+{
+    MilterClientPrivate *priv;
+
+    priv = MILTER_CLIENT_GET_PRIVATE(client);
+    if (!priv->workers.listen_channels)
+        return NULL;
+    if (worker_id == 0 || worker_id > priv->workers.listen_channels->len)
+        return NULL;
+
+    return g_ptr_array_index(priv->workers.listen_channels, worker_id - 1);
+}
+
 void
 milter_client_set_timeout (MilterClient *client, guint timeout)
 {
@@ -2848,13 +3558,20 @@ milter_client_processing_context_foreach (MilterClient *client,
                                           GFunc func, gpointer user_data)
 {
     MilterClientPrivate *priv;
-    GList *node;
+    GList *contexts = NULL, *node;
 
     priv = MILTER_CLIENT_GET_PRIVATE(client);
+    g_mutex_lock(priv->processing_data_mutex);
     for (node = priv->processing_data; node; node = g_list_next(node)) {
         MilterClientProcessData *data = node->data;
-        func(data->context, user_data);
+        contexts = g_list_prepend(contexts, g_object_ref(data->context));
     }
+    g_mutex_unlock(priv->processing_data_mutex);
+
+    contexts = g_list_reverse(contexts);
+    g_list_foreach(contexts, func, user_data);
+    g_list_foreach(contexts, (GFunc)g_object_unref, NULL);
+    g_list_free(contexts);
 }
 
 void
@@ -2863,7 +3580,7 @@ milter_client_session_started (MilterClient *client)
     MilterClientPrivate *priv;
 
     priv = MILTER_CLIENT_GET_PRIVATE(client);
-    priv->n_processing_sessions++;
+    g_atomic_int_inc((gint *)&(priv->n_processing_sessions));
 }
 
 void
@@ -2872,8 +3589,17 @@ milter_client_session_finished (MilterClient *client)
     MilterClientPrivate *priv;
 
     priv = MILTER_CLIENT_GET_PRIVATE(client);
-    priv->n_processing_sessions--;
-    priv->n_processed_sessions++;
+    g_atomic_int_add((gint *)&(priv->n_processing_sessions), -1);
+    g_atomic_int_inc((gint *)&(priv->n_processed_sessions));
+
+    /* Sessions on a separated accept loop may be finished in
+     * other threads. The accept loop resumes by its timer. */
+    if (priv->accept_resume_id > 0 &&
+        !priv->accept_loop &&
+        !priv->loop_threads &&
+        is_below_low_water_mark(client)) {
+        resume_accept(client);
+    }
 }
 
 guint
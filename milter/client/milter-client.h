@@ -334,6 +334,76 @@ void                 milter_client_set_remove_unix_socket_on_create
                                                      (MilterClient  *client,
                                                       gboolean       remove);
 
+/**
+ * milter_client_is_reuse_port:
+ * @client: a %MilterClient.
+ *
+ * Gets whether each worker process listens on its own
+ * socket with SO_REUSEPORT.
+ *
+ * Returns: %TRUE if each worker process uses its own
+ * socket, %FALSE otherwise.
+ */
+gboolean             milter_client_is_reuse_port     (MilterClient  *client);
+
+/**
+ * milter_client_set_reuse_port:
+ * @client: a %MilterClient.
+ * @reuse_port: %TRUE if each worker process listens on its
+ *              own socket with SO_REUSEPORT.
+ *
+ * Sets whether each worker process listens on its own
+ * socket with SO_REUSEPORT. The kernel balances new
+ * connections between the sockets instead of waking up all
+ * worker processes. It is only used for TCP connection
+ * specs and must be set before milter_client_listen().
+ */
+void                 milter_client_set_reuse_port    (MilterClient  *client,
+                                                      gboolean       reuse_port);
+
+/**
+ * milter_client_is_direct_write:
+ * @client: a %MilterClient.
+ *
+ * Gets whether replies are written to the MTA socket
+ * without waiting for the event loop.
+ *
+ * Returns: %TRUE if replies are written immediately when no
+ * data is buffered, %FALSE otherwise.
+ */
+gboolean             milter_client_is_direct_write   (MilterClient  *client);
+
+/**
+ * milter_client_set_direct_write:
+ * @client: a %MilterClient.
+ * @direct_write: %TRUE if replies are written to the MTA
+ *                socket without waiting for the event loop.
+ *
+ * Sets whether each client context writes a reply
+ * immediately when no data is buffered. It saves a poll
+ * round trip per reply. It is applied to connections
+ * accepted after this call.
+ */
+void                 milter_client_set_direct_write  (MilterClient  *client,
+                                                      gboolean       direct_write);
+
+/**
+ * milter_client_get_worker_listen_channel:
+ * @client: a %MilterClient.
+ * @worker_id: the worker ID.
+ *
+ * Gets the listen channel owned by the worker process
+ * that has @worker_id in the master process. It is closed
+ * when the worker process exits.
+ *
+ * Returns: the listen channel of the worker process or
+ * %NULL if SO_REUSEPORT isn't used or the worker process
+ * exited.
+ */
+GIOChannel          *milter_client_get_worker_listen_channel
+                                                     (MilterClient  *client,
+                                                      guint          worker_id);
+
 /**
  * milter_client_set_timeout:
  * @client: a %MilterClient.
@@ -898,6 +968,35 @@ guint                milter_client_get_n_workers     (MilterClient  *client);
 void                 milter_client_set_n_workers     (MilterClient  *client,
                                                       guint          n_workers);
 
+/**
+ * milter_client_get_n_event_loop_threads:
+ * @client: a %MilterClient.
+ *
+ * Gets the number of event loop threads of @client.
+ *
+ * Returns: the number of event loop threads of @client.
+ */
+guint                milter_client_get_n_event_loop_threads
+                                                     (MilterClient  *client);
+
+/**
+ * milter_client_set_n_event_loop_threads:
+ * @client: a %MilterClient.
+ * @n_threads: the number of event loop threads.
+ *
+ * Sets the number of event loop threads of @client. If
+ * @n_threads is greater than 0, @client accepts connections
+ * in its event loop and passes them to @n_threads threads
+ * in round-robin. Each thread runs its own event loop and
+ * a session is processed only in the thread that receives
+ * it. Callbacks of sessions are called in the threads.
+ *
+ * It is ignored when worker processes are used.
+ */
+void                 milter_client_set_n_event_loop_threads
+                                                     (MilterClient  *client,
+                                                      guint          n_threads);
+
 /**
  * milter_client_fork:
  * @client: a %MilterClient.
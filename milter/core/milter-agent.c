@@ -534,6 +534,17 @@ milter_agent_write_packet (MilterAgent *agent,
     if (!priv->writer)
         return TRUE;
 
+    if (priv->encoder) {
+        GString *encoder_buffer;
+
+        encoder_buffer = milter_encoder_get_buffer(priv->encoder);
+        if (packet == encoder_buffer->str &&
+            packet_size == encoder_buffer->len) {
+            return milter_agent_write_buffer(
+                agent, milter_encoder_steal_buffer(priv->encoder), error);
+        }
+    }
+
     success = milter_writer_write(priv->writer, packet, packet_size, error);
     if (success) {
         success = milter_agent_flush(agent, error);
@@ -542,6 +553,27 @@ milter_agent_write_packet (MilterAgent *agent,
     return success;
 }
 
+gboolean
+milter_agent_write_buffer (MilterAgent *agent, GString *buffer, GError **error)
+{
+    MilterAgentPrivate *priv;
+    gboolean success;
+
+    priv = MILTER_AGENT_GET_PRIVATE(agent);
+
+    if (!priv->writer) {
+        g_string_free(buffer, TRUE);
+        return TRUE;
+    }
+
+    success = milter_writer_write_buffer(priv->writer, buffer, error);
+    if (success) {
+        success = milter_agent_flush(agent, error);
+    }
+
+    return success;
+}
+
 gboolean
 milter_agent_flush (MilterAgent *agent, GError **error)
 {
@@ -551,6 +583,19 @@ milter_agent_flush (MilterAgent *agent, GError **error)
     return agent_class->flush(agent, error);
 }
 
+gboolean
+milter_agent_drain (MilterAgent *agent, GError **error)
+{
+    MilterAgentPrivate *priv;
+
+    priv = MILTER_AGENT_GET_PRIVATE(agent);
+
+    if (!priv->writer)
+        return TRUE;
+
+    return milter_writer_drain(priv->writer, error);
+}
+
 void
 milter_agent_set_writer (MilterAgent *agent, MilterWriter *writer)
 {
@@ -85,8 +85,13 @@ gboolean             milter_agent_write_packet      (MilterAgent *agent,
                                                      const char *packet,
                                                      gsize packet_size,
                                                      GError **error);
+gboolean             milter_agent_write_buffer      (MilterAgent *agent,
+                                                     GString *buffer,
+                                                     GError **error);
 gboolean             milter_agent_flush             (MilterAgent *agent,
                                                      GError **error);
+gboolean             milter_agent_drain             (MilterAgent *agent,
+                                                     GError **error);
 
 gboolean             milter_agent_start             (MilterAgent *agent,
                                                      GError     **error);
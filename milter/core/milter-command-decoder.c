@@ -35,6 +35,7 @@
 #include "milter-logger.h"
 #include "milter-enum-types.h"
 #include "milter-marshalers.h"
+#include "milter-utils.h"
 
 enum
 {
@@ -52,6 +53,7 @@ enum
     ABORT,
     QUIT,
     UNKNOWN,
+    QUIT_NEW_CONNECTION,
     LAST_SIGNAL
 };
 
@@ -225,6 +227,16 @@ milter_command_decoder_class_init (MilterCommandDecoderClass *klass)
                      NULL, NULL,
                      g_cclosure_marshal_VOID__STRING,
                      G_TYPE_NONE, 1, G_TYPE_STRING);
+
+    signals[QUIT_NEW_CONNECTION] =
+        g_signal_new("quit-new-connection",
+                     G_TYPE_FROM_CLASS(klass),
+                     G_SIGNAL_RUN_LAST,
+                     G_STRUCT_OFFSET(MilterCommandDecoderClass,
+                                     quit_new_connection),
+                     NULL, NULL,
+                     g_cclosure_marshal_VOID__VOID,
+                     G_TYPE_NONE, 0);
 }
 
 static void
@@ -315,7 +327,7 @@ decode_define_macros (const gchar *buffer,
     gint i;
     gboolean success = TRUE;
 
-    macros = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, g_free);
+    macros = g_hash_table_new_full(g_str_hash, g_str_equal, NULL, g_free);
 
     i = 0;
     while (i < length) {
@@ -345,16 +357,12 @@ decode_define_macros (const gchar *buffer,
         i += null_character_point + 1;
 
         if (*key) {
-            gchar *normalized_key;
-            gint key_length;
+            const gchar *interned_key;
 
-            key_length = value - key - 1;
-            if (key[0] == '{' && key[key_length - 1] == '}')
-                normalized_key = g_strndup(key + 1, key_length - 2);
-            else
-                normalized_key = g_strdup(key);
-
-            g_hash_table_insert(macros, normalized_key, g_strdup(value));
+            interned_key = milter_utils_intern_macro_name(key,
+                                                          value - key - 1);
+            g_hash_table_insert(macros, (gpointer)interned_key,
+                                g_strdup(value));
         }
     }
 
@@ -873,6 +881,29 @@ decode_quit (MilterDecoder *decoder, GError **error)
     return TRUE;
 }
 
+static gboolean
+decode_quit_new_connection (MilterDecoder *decoder, GError **error)
+{
+    const gchar *buffer;
+    gint32 command_length;
+
+    command_length = milter_decoder_get_command_length(decoder);
+    buffer = milter_decoder_get_buffer(decoder);
+
+    if (!milter_decoder_check_command_length(
+            buffer + 1, command_length - 1, 0,
+            MILTER_DECODER_COMPARE_EXACT, error,
+            "QUIT NEW CONNECTION command"))
+        return FALSE;
+
+    milter_debug("[%u] [command-decoder][quit-new-connection]",
+                 milter_decoder_get_tag(decoder));
+
+    g_signal_emit(decoder, signals[QUIT_NEW_CONNECTION], 0);
+
+    return TRUE;
+}
+
 static gboolean
 decode_unknown (MilterDecoder *decoder, GError **error)
 {
@@ -981,6 +1012,9 @@ decode (MilterDecoder *decoder, GError **error)
     case MILTER_COMMAND_QUIT:
         success = decode_quit(decoder, error);
         break;
+    case MILTER_COMMAND_QUIT_NEW_CONNECTION:
+        success = decode_quit_new_connection(decoder, error);
+        break;
     case MILTER_COMMAND_UNKNOWN:
         success = decode_unknown(decoder, error);
         break;
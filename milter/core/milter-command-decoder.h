@@ -89,6 +89,7 @@ struct _MilterCommandDecoderClass
     void (*quit)                (MilterCommandDecoder *decoder);
     void (*unknown)             (MilterCommandDecoder *decoder,
                                  const gchar *command);
+    void (*quit_new_connection) (MilterCommandDecoder *decoder);
 };
 
 GQuark         milter_command_decoder_error_quark (void);
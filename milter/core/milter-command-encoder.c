@@ -420,6 +420,22 @@ milter_command_encoder_encode_quit (MilterCommandEncoder *encoder,
     milter_encoder_pack(base_encoder, packet, packet_size);
 }
 
+void
+milter_command_encoder_encode_quit_new_connection (MilterCommandEncoder *encoder,
+                                                   const gchar **packet,
+                                                   gsize *packet_size)
+{
+    MilterEncoder *base_encoder;
+    GString *buffer;
+
+    base_encoder = MILTER_ENCODER(encoder);
+    milter_encoder_clear_buffer(base_encoder);
+    buffer = milter_encoder_get_buffer(base_encoder);
+
+    g_string_append_c(buffer, MILTER_COMMAND_QUIT_NEW_CONNECTION);
+    milter_encoder_pack(base_encoder, packet, packet_size);
+}
+
 void
 milter_command_encoder_encode_unknown (MilterCommandEncoder *encoder,
                                        const gchar **packet,
@@ -124,6 +124,10 @@ void             milter_command_encoder_encode_quit
                                             (MilterCommandEncoder *encoder,
                                              const gchar         **packet,
                                              gsize                *packet_size);
+void             milter_command_encoder_encode_quit_new_connection
+                                            (MilterCommandEncoder *encoder,
+                                             const gchar         **packet,
+                                             gsize                *packet_size);
 void             milter_command_encoder_encode_unknown
                                             (MilterCommandEncoder *encoder,
                                              const gchar         **packet,
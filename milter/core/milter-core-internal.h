@@ -28,6 +28,8 @@ void milter_logger_internal_init     (void);
 void milter_logger_internal_quit     (void);
 void milter_agent_internal_init      (void);
 void milter_agent_internal_quit      (void);
+void milter_event_loop_internal_remove_timer_wheel_driver
+                                     (MilterEventLoop *loop);
 
 G_END_DECLS
 
@@ -59,6 +59,7 @@ void
 milter_init (void)
 {
     const gchar *memory_profile_env;
+    const gchar *memory_arena_env;
 
     if (initialized) {
         remove_glib_log_handlers();
@@ -75,6 +76,11 @@ milter_init (void)
         milter_memory_profile_enable();
     }
 
+    memory_arena_env = g_getenv("MILTER_MEMORY_ARENA");
+    if (memory_arena_env && g_str_equal(memory_arena_env, "malloc")) {
+        milter_memory_arena_set_use_malloc(TRUE);
+    }
+
 #if !GLIB_CHECK_VERSION(2, 32, 0)
     if (!g_thread_supported())
         g_thread_init(NULL);
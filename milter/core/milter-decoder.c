@@ -47,10 +47,17 @@ struct _MilterDecoderPrivate
 {
     gint state;
     GString *buffer;
+    gsize buffer_offset;
+    const gchar *command;
     gint32 command_length;
     guint tag;
 };
 
+#define BUFFER_COMPACT_THRESHOLD 4096
+/* libmilter accepts 1MiB at most with smfi_setmaxdatasize(). */
+#define MAX_COMMAND_LENGTH (1024 * 1024)
+#define MAX_PREALLOCATE_SIZE (COMMAND_LENGTH_BYTES + 1 + MILTER_CHUNK_SIZE)
+
 enum
 {
     PROP_0,
@@ -122,6 +129,8 @@ milter_decoder_init (MilterDecoder *decoder)
 
     priv->state = IN_START;
     priv->buffer = g_string_new(NULL);
+    priv->buffer_offset = 0;
+    priv->command = NULL;
     priv->tag = 0;
 }
 
@@ -347,6 +356,82 @@ milter_decoder_decode_header_content (const gchar *buffer, gint length,
     return TRUE;
 }
 
+static void
+compact_buffer (MilterDecoderPrivate *priv)
+{
+    if (priv->buffer_offset == 0)
+        return;
+
+    if (priv->buffer_offset == priv->buffer->len)
+        g_string_truncate(priv->buffer, 0);
+    else
+        g_string_erase(priv->buffer, 0, priv->buffer_offset);
+    priv->buffer_offset = 0;
+}
+
+static void
+keep_rest (MilterDecoderPrivate *priv, const gchar *rest, gsize rest_size)
+{
+    gsize required_size = rest_size;
+
+    if (priv->state == IN_COMMAND_CONTENT &&
+        (gsize)priv->command_length > rest_size)
+        required_size = MIN(priv->command_length, MAX_PREALLOCATE_SIZE);
+
+    /* allocate the whole command at once to avoid reallocation for
+     * large body chunks that are split into some reads. The
+     * length is sent by the peer. So we don't trust it for larger
+     * commands and grow the buffer as the data arrives. */
+    if (priv->buffer->allocated_len <= required_size) {
+        g_string_free(priv->buffer, TRUE);
+        priv->buffer = g_string_sized_new(required_size + 1);
+    }
+    g_string_append_len(priv->buffer, rest, rest_size);
+}
+
+static gboolean
+check_command_length (MilterDecoderPrivate *priv, GError **error)
+{
+    if (priv->command_length < 1) {
+        g_set_error(error,
+                    MILTER_DECODER_ERROR,
+                    MILTER_DECODER_ERROR_SHORT_COMMAND_LENGTH,
+                    "command length should be positive: <%d>",
+                    priv->command_length);
+        return FALSE;
+    }
+
+    if (priv->command_length > MAX_COMMAND_LENGTH) {
+        g_set_error(error,
+                    MILTER_DECODER_ERROR,
+                    MILTER_DECODER_ERROR_LONG_COMMAND_LENGTH,
+                    "command length is too long: <%d> (max: <%d>)",
+                    priv->command_length, MAX_COMMAND_LENGTH);
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
+static gboolean
+emit_decode (MilterDecoder *decoder, GError **error)
+{
+    MilterDecoderClass *klass;
+    gboolean success = FALSE;
+
+    klass = MILTER_DECODER_GET_CLASS(decoder);
+    if (klass->decode &&
+        !g_signal_has_handler_pending(decoder, signals[DECODE], 0, FALSE)) {
+        g_object_ref(decoder);
+        success = klass->decode(decoder, error);
+        g_object_unref(decoder);
+        return success;
+    }
+
+    g_signal_emit(decoder, signals[DECODE], 0, error, &success);
+    return success;
+}
+
 gboolean
 milter_decoder_decode (MilterDecoder *decoder, const gchar *chunk, gsize size,
                        GError **error)
@@ -354,6 +439,9 @@ milter_decoder_decode (MilterDecoder *decoder, const gchar *chunk, gsize size,
     MilterDecoderPrivate *priv;
     gboolean loop = TRUE;
     gboolean success = TRUE;
+    gboolean in_place;
+    const gchar *data;
+    gsize data_size, consumed = 0;
 
     priv = MILTER_DECODER_GET_PRIVATE(decoder);
 
@@ -366,49 +454,79 @@ milter_decoder_decode (MilterDecoder *decoder, const gchar *chunk, gsize size,
                  "<%" G_GSIZE_FORMAT "> "
                  "(%" G_GSIZE_FORMAT ")",
                  priv->tag, size,
-                 priv->buffer->len);
-    g_string_append_len(priv->buffer, chunk, size);
+                 priv->buffer->len - priv->buffer_offset);
+
+    /*
+     * Commands are decoded in the passed chunk when no partial command
+     * is kept. Otherwise the chunk is appended to the kept bytes and the
+     * consumed bytes are just skipped by the offset. They are removed
+     * only when they are large enough.
+     */
+    in_place = (priv->buffer->len == priv->buffer_offset);
+    if (in_place) {
+        g_string_truncate(priv->buffer, 0);
+        priv->buffer_offset = 0;
+        data = chunk;
+        data_size = size;
+    } else {
+        if (priv->buffer_offset >= BUFFER_COMPACT_THRESHOLD ||
+            priv->buffer_offset * 2 >= priv->buffer->len)
+            compact_buffer(priv);
+        g_string_append_len(priv->buffer, chunk, size);
+        data = priv->buffer->str + priv->buffer_offset;
+        data_size = priv->buffer->len - priv->buffer_offset;
+    }
+
     while (loop) {
         switch (priv->state) {
         case IN_START:
             milter_trace("[%u] [decoder][decode][start]", priv->tag);
-            if (priv->buffer->len == 0) {
+            if (data_size == consumed) {
                 loop = FALSE;
             } else {
                 priv->state = IN_COMMAND_LENGTH;
             }
             break;
         case IN_COMMAND_LENGTH:
-            if (priv->buffer->len < COMMAND_LENGTH_BYTES) {
+            if (data_size - consumed < COMMAND_LENGTH_BYTES) {
                 milter_trace("[%u] [decoder][decode][length][need-more]",
                              priv->tag);
                 loop = FALSE;
             } else {
                 memcpy(&priv->command_length,
-                       priv->buffer->str,
+                       data + consumed,
                        COMMAND_LENGTH_BYTES);
                 priv->command_length = g_ntohl(priv->command_length);
                 milter_trace("[%u] [decoder][decode][length] <%d>",
                              priv->tag, priv->command_length);
-                g_string_erase(priv->buffer, 0, COMMAND_LENGTH_BYTES);
-                priv->state = IN_COMMAND_CONTENT;
+                consumed += COMMAND_LENGTH_BYTES;
+                if (check_command_length(priv, error)) {
+                    priv->state = IN_COMMAND_CONTENT;
+                } else {
+                    priv->state = IN_ERROR;
+                    success = FALSE;
+                    loop = FALSE;
+                }
             }
             break;
         case IN_COMMAND_CONTENT:
-            if (priv->buffer->len < priv->command_length) {
+            if (data_size - consumed < priv->command_length) {
                 milter_trace("[%u] [decoder][decode][content][need-more] "
                              "<%" G_GSIZE_FORMAT ">/<%d>",
                              priv->tag,
-                             priv->buffer->len, priv->command_length);
+                             data_size - consumed, priv->command_length);
                 loop = FALSE;
             } else {
                 milter_trace("[%u] [decoder][decode][content][fill] "
                              "<%d> (%" G_GSIZE_FORMAT ")",
-                             priv->tag, priv->command_length, priv->buffer->len);
-                g_signal_emit(decoder, signals[DECODE], 0, error, &success);
+                             priv->tag, priv->command_length,
+                             data_size - consumed);
+                priv->command = data + consumed;
+                success = emit_decode(decoder, error);
+                priv->command = NULL;
                 if (success) {
                     priv->state = IN_START;
-                    g_string_erase(priv->buffer, 0, priv->command_length);
+                    consumed += priv->command_length;
                 } else {
                     priv->state = IN_ERROR;
                     loop = FALSE;
@@ -418,12 +536,22 @@ milter_decoder_decode (MilterDecoder *decoder, const gchar *chunk, gsize size,
         case IN_ERROR:
             milter_error("[%u] [decoder][decode][error] "
                          "<%d> (%" G_GSIZE_FORMAT ")",
-                         priv->tag, priv->command_length, priv->buffer->len);
+                         priv->tag, priv->command_length,
+                         data_size - consumed);
             loop = FALSE;
             break;
         }
     }
 
+    if (in_place) {
+        if (consumed < data_size)
+            keep_rest(priv, data + consumed, data_size - consumed);
+    } else {
+        priv->buffer_offset += consumed;
+        if (priv->buffer_offset == priv->buffer->len)
+            compact_buffer(priv);
+    }
+
     return success;
 }
 
@@ -435,8 +563,10 @@ set_unexpected_end_error (GError **error, MilterDecoderPrivate *priv,
 
     message = g_string_new("stream is ended unexpectedly: ");
     append_need_more_bytes_for_decoding_message(message,
-                                                priv->buffer->str,
-                                                priv->buffer->len,
+                                                priv->buffer->str +
+                                                priv->buffer_offset,
+                                                priv->buffer->len -
+                                                priv->buffer_offset,
                                                 required_length,
                                                 decoding_target);
     g_set_error(error,
@@ -478,7 +608,13 @@ milter_decoder_end_decode (MilterDecoder *decoder, GError **error)
 const gchar *
 milter_decoder_get_buffer (MilterDecoder *decoder)
 {
-    return MILTER_DECODER_GET_PRIVATE(decoder)->buffer->str;
+    MilterDecoderPrivate *priv;
+
+    priv = MILTER_DECODER_GET_PRIVATE(decoder);
+    if (priv->command)
+        return priv->command;
+
+    return priv->buffer->str + priv->buffer_offset;
 }
 
 gint32
@@ -169,6 +169,19 @@ milter_encoder_clear_buffer (MilterEncoder *encoder)
     g_string_truncate(priv->buffer, 0);
 }
 
+GString *
+milter_encoder_steal_buffer (MilterEncoder *encoder)
+{
+    MilterEncoderPrivate *priv;
+    GString *buffer;
+
+    priv = MILTER_ENCODER_GET_PRIVATE(encoder);
+    buffer = priv->buffer;
+    priv->buffer = g_string_new(NULL);
+
+    return buffer;
+}
+
 void
 milter_encoder_pack (MilterEncoder *encoder, const gchar **packet,
                      gsize *packet_size)
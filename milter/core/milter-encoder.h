@@ -57,6 +57,7 @@ MilterEncoder   *milter_encoder_new            (void);
 
 GString         *milter_encoder_get_buffer     (MilterEncoder     *encoder);
 void             milter_encoder_clear_buffer   (MilterEncoder     *encoder);
+GString         *milter_encoder_steal_buffer   (MilterEncoder     *encoder);
 void             milter_encoder_pack           (MilterEncoder     *encoder,
                                                 const gchar      **packet,
                                                 gsize             *packet_size);
@@ -22,8 +22,27 @@
 #  include "../../config.h"
 #endif /* HAVE_CONFIG_H */
 
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+
 #include "milter-event-loop.h"
 #include "milter-logger.h"
+#include "milter-core-internal.h"
+
+#define MAX_JOB_THREADS 4
+
+/* Timeouts that are TIMER_WHEEL_MIN_INTERVAL seconds or longer are
+ * kept in a hierarchical timer wheel that is driven by a backend
+ * timeout. Shorter timeouts use a backend timeout each. */
+#define TIMER_WHEEL_RESOLUTION 0.1
+#define TIMER_WHEEL_MIN_INTERVAL 1.0
+#define TIMER_WHEEL_SLOT_BITS 6
+#define TIMER_WHEEL_N_SLOTS (1 << TIMER_WHEEL_SLOT_BITS)
+#define TIMER_WHEEL_SLOT_MASK (TIMER_WHEEL_N_SLOTS - 1)
+#define TIMER_WHEEL_N_LEVELS 4
+#define TIMER_WHEEL_LEVEL_TICKS(level)                  \
+    (G_GUINT64_CONSTANT(1) << (TIMER_WHEEL_SLOT_BITS * (level)))
 
 #define MILTER_EVENT_LOOP_GET_PRIVATE(obj)              \
   (G_TYPE_INSTANCE_GET_PRIVATE((obj),                   \
@@ -40,8 +59,44 @@ struct _MilterEventLoopPrivate
     gpointer custom_iterate_user_data;
     GDestroyNotify custom_iterate_destroy;
     guint depth;
+    GAsyncQueue *done_jobs;
+    gint job_notify_fds[2];
+    GIOChannel *job_notify_channel;
+    guint job_notify_watch_id;
+    guint n_pending_jobs;
+    GQueue timer_wheel[TIMER_WHEEL_N_LEVELS][TIMER_WHEEL_N_SLOTS];
+    guint64 timer_wheel_tick;
+    GTimer *timer_wheel_clock;
+    guint timer_wheel_n_timeouts;
+    guint timer_wheel_driver_id;
+    guint64 timer_wheel_driver_tick;
+};
+
+struct _MilterEventLoopTimeout
+{
+    MilterEventLoop *loop;
+    GSourceFunc function;
+    gpointer user_data;
+    gdouble interval;
+    guint id;
+    GList link;
+    GQueue *slot;
+    guint64 expire_tick;
+    gboolean dispatching;
+    gboolean destroyed;
 };
 
+typedef struct _Job
+{
+    MilterEventLoop *loop;
+    MilterEventLoopJobFunc func;
+    MilterEventLoopJobFunc done;
+    gpointer user_data;
+} Job;
+
+static GThreadPool *job_threads = NULL;
+G_LOCK_DEFINE_STATIC(job_threads);
+
 enum
 {
     PROP_0,
@@ -73,6 +128,7 @@ milter_event_loop_class_init (MilterEventLoopClass *klass)
 
     klass->quit = NULL;
     klass->watch_io_full = NULL;
+    klass->modify_io = NULL;
     klass->watch_child_full = NULL;
     klass->add_timeout_full = NULL;
     klass->add_idle_full = NULL;
@@ -91,12 +147,29 @@ static void
 milter_event_loop_init (MilterEventLoop *loop)
 {
     MilterEventLoopPrivate *priv;
+    guint i, j;
 
     priv = MILTER_EVENT_LOOP_GET_PRIVATE(loop);
     priv->depth = 0;
     priv->custom_iterate = NULL;
     priv->custom_iterate_user_data = NULL;
     priv->custom_iterate_destroy = NULL;
+    priv->done_jobs = NULL;
+    priv->job_notify_fds[0] = -1;
+    priv->job_notify_fds[1] = -1;
+    priv->job_notify_channel = NULL;
+    priv->job_notify_watch_id = 0;
+    priv->n_pending_jobs = 0;
+    for (i = 0; i < TIMER_WHEEL_N_LEVELS; i++) {
+        for (j = 0; j < TIMER_WHEEL_N_SLOTS; j++) {
+            g_queue_init(&(priv->timer_wheel[i][j]));
+        }
+    }
+    priv->timer_wheel_tick = 0;
+    priv->timer_wheel_clock = NULL;
+    priv->timer_wheel_n_timeouts = 0;
+    priv->timer_wheel_driver_id = 0;
+    priv->timer_wheel_driver_tick = 0;
 }
 
 static void
@@ -124,6 +197,29 @@ dispose (GObject *object)
     priv = MILTER_EVENT_LOOP_GET_PRIVATE(object);
     dispose_custom_iterate(priv);
 
+    /* Jobs keep their loop alive, so no job is pending here. */
+    if (priv->job_notify_channel) {
+        g_io_channel_unref(priv->job_notify_channel);
+        priv->job_notify_channel = NULL;
+        priv->job_notify_fds[0] = -1;
+    }
+    if (priv->job_notify_fds[1] != -1) {
+        close(priv->job_notify_fds[1]);
+        priv->job_notify_fds[1] = -1;
+    }
+    if (priv->done_jobs) {
+        g_async_queue_unref(priv->done_jobs);
+        priv->done_jobs = NULL;
+    }
+
+    /* Active timeouts keep their loop alive. Backends remove the
+     * driver before they release their sources. */
+    priv->timer_wheel_driver_id = 0;
+    if (priv->timer_wheel_clock) {
+        g_timer_destroy(priv->timer_wheel_clock);
+        priv->timer_wheel_clock = NULL;
+    }
+
     G_OBJECT_CLASS(milter_event_loop_parent_class)->dispose(object);
 }
 
@@ -344,6 +440,23 @@ milter_event_loop_watch_io_full (MilterEventLoop *loop,
                                      function, data, notify);
 }
 
+gboolean
+milter_event_loop_modify_io (MilterEventLoop *loop,
+                             guint            id,
+                             GIOCondition     condition)
+{
+    MilterEventLoopClass *loop_class;
+
+    g_return_val_if_fail(loop != NULL, FALSE);
+
+    /* Not all backends can change the condition of a registered
+     * watch. Callers should watch again on FALSE. */
+    loop_class = MILTER_EVENT_LOOP_GET_CLASS(loop);
+    if (!loop_class->modify_io)
+        return FALSE;
+    return loop_class->modify_io(loop, id, condition);
+}
+
 guint
 milter_event_loop_watch_child (MilterEventLoop *loop,
                                GPid             pid,
@@ -438,6 +551,459 @@ milter_event_loop_remove (MilterEventLoop *loop, guint tag)
     return loop_class->remove(loop, tag);
 }
 
+static gdouble
+timer_wheel_elapsed (MilterEventLoopPrivate *priv)
+{
+    if (!priv->timer_wheel_clock)
+        priv->timer_wheel_clock = g_timer_new();
+    return g_timer_elapsed(priv->timer_wheel_clock, NULL);
+}
+
+static void
+timer_wheel_insert (MilterEventLoopPrivate *priv,
+                    MilterEventLoopTimeout *timeout)
+{
+    guint64 expire_tick, delta;
+    guint level, index;
+
+    expire_tick = MAX(timeout->expire_tick, priv->timer_wheel_tick);
+    delta = expire_tick - priv->timer_wheel_tick;
+    for (level = 0; level < TIMER_WHEEL_N_LEVELS - 1; level++) {
+        if (delta < TIMER_WHEEL_LEVEL_TICKS(level + 1))
+            break;
+    }
+    /* Too far: park it in the last slot. It's inserted again
+     * when the slot expires. */
+    if (delta >= TIMER_WHEEL_LEVEL_TICKS(TIMER_WHEEL_N_LEVELS))
+        expire_tick = priv->timer_wheel_tick +
+            TIMER_WHEEL_LEVEL_TICKS(TIMER_WHEEL_N_LEVELS) - 1;
+
+    index = (expire_tick >> (TIMER_WHEEL_SLOT_BITS * level)) &
+        TIMER_WHEEL_SLOT_MASK;
+    timeout->slot = &(priv->timer_wheel[level][index]);
+    g_queue_push_tail_link(timeout->slot, &(timeout->link));
+}
+
+static void
+timer_wheel_cascade (MilterEventLoopPrivate *priv, guint level)
+{
+    GQueue *slot;
+    GQueue timeouts = G_QUEUE_INIT;
+    GList *link;
+    guint index;
+
+    index = (priv->timer_wheel_tick >> (TIMER_WHEEL_SLOT_BITS * level)) &
+        TIMER_WHEEL_SLOT_MASK;
+    slot = &(priv->timer_wheel[level][index]);
+    while ((link = g_queue_pop_head_link(slot))) {
+        g_queue_push_tail_link(&timeouts, link);
+    }
+    while ((link = g_queue_pop_head_link(&timeouts))) {
+        timer_wheel_insert(priv, link->data);
+    }
+}
+
+static void
+timeout_dispatch (MilterEventLoopTimeout *timeout)
+{
+    gboolean keep;
+
+    timeout->dispatching = TRUE;
+    keep = timeout->function(timeout->user_data);
+    timeout->dispatching = FALSE;
+
+    if (timeout->destroyed) {
+        g_object_unref(timeout->loop);
+        g_free(timeout);
+        return;
+    }
+
+    if (keep && !milter_event_loop_timeout_is_active(timeout))
+        milter_event_loop_timeout_start(timeout, timeout->interval);
+}
+
+static void
+timer_wheel_advance (MilterEventLoopPrivate *priv)
+{
+    guint64 now;
+
+    now = timer_wheel_elapsed(priv) / TIMER_WHEEL_RESOLUTION;
+    while (priv->timer_wheel_tick <= now) {
+        GQueue expired = G_QUEUE_INIT;
+        GQueue *slot;
+        GList *link;
+        guint64 tick;
+        guint level;
+
+        tick = priv->timer_wheel_tick;
+        for (level = 1; level < TIMER_WHEEL_N_LEVELS; level++) {
+            if (tick & (TIMER_WHEEL_LEVEL_TICKS(level) - 1))
+                break;
+        }
+        while (--level > 0) {
+            timer_wheel_cascade(priv, level);
+        }
+
+        slot = &(priv->timer_wheel[0][tick & TIMER_WHEEL_SLOT_MASK]);
+        while ((link = g_queue_pop_head_link(slot))) {
+            MilterEventLoopTimeout *timeout = link->data;
+
+            g_queue_push_tail_link(&expired, link);
+            timeout->slot = &expired;
+        }
+        priv->timer_wheel_tick++;
+
+        while ((link = g_queue_pop_head_link(&expired))) {
+            MilterEventLoopTimeout *timeout = link->data;
+
+            timeout->slot = NULL;
+            if (timeout->expire_tick > tick) {
+                timer_wheel_insert(priv, timeout);
+                continue;
+            }
+            priv->timer_wheel_n_timeouts--;
+            timeout_dispatch(timeout);
+        }
+    }
+}
+
+static gboolean cb_timer_wheel (gpointer data);
+
+static void
+timer_wheel_update_driver (MilterEventLoop *loop,
+                           MilterEventLoopPrivate *priv)
+{
+    guint64 next_tick;
+    guint i, index;
+    gdouble delay;
+
+    if (priv->timer_wheel_n_timeouts == 0) {
+        if (priv->timer_wheel_driver_id > 0) {
+            milter_event_loop_remove(loop, priv->timer_wheel_driver_id);
+            priv->timer_wheel_driver_id = 0;
+        }
+        return;
+    }
+
+    /* Wake up for the next used slot or, if there is none, for the
+     * next cascade from upper levels. */
+    index = priv->timer_wheel_tick & TIMER_WHEEL_SLOT_MASK;
+    next_tick = priv->timer_wheel_tick +
+        ((TIMER_WHEEL_N_SLOTS - index) & TIMER_WHEEL_SLOT_MASK);
+    for (i = index; priv->timer_wheel_tick + (i - index) < next_tick; i++) {
+        if (!g_queue_is_empty(&(priv->timer_wheel[0][i]))) {
+            next_tick = priv->timer_wheel_tick + (i - index);
+            break;
+        }
+    }
+
+    if (priv->timer_wheel_driver_id > 0) {
+        if (priv->timer_wheel_driver_tick <= next_tick)
+            return;
+        milter_event_loop_remove(loop, priv->timer_wheel_driver_id);
+    }
+
+    /* A bit late rather than early so that the tick has surely come. */
+    delay = next_tick * TIMER_WHEEL_RESOLUTION - timer_wheel_elapsed(priv) +
+        0.001;
+    priv->timer_wheel_driver_tick = next_tick;
+    priv->timer_wheel_driver_id =
+        milter_event_loop_add_timeout(loop, MAX(delay, 0.0),
+                                      cb_timer_wheel, loop);
+}
+
+void
+milter_event_loop_internal_remove_timer_wheel_driver (MilterEventLoop *loop)
+{
+    MilterEventLoopPrivate *priv;
+
+    priv = MILTER_EVENT_LOOP_GET_PRIVATE(loop);
+    if (priv->timer_wheel_driver_id > 0) {
+        milter_event_loop_remove(loop, priv->timer_wheel_driver_id);
+        priv->timer_wheel_driver_id = 0;
+    }
+}
+
+static gboolean
+cb_timer_wheel (gpointer data)
+{
+    MilterEventLoop *loop = data;
+    MilterEventLoopPrivate *priv;
+
+    priv = MILTER_EVENT_LOOP_GET_PRIVATE(loop);
+    priv->timer_wheel_driver_id = 0;
+
+    g_object_ref(loop);
+    timer_wheel_advance(priv);
+    timer_wheel_update_driver(loop, priv);
+    g_object_unref(loop);
+
+    return FALSE;
+}
+
+static gboolean
+cb_timeout (gpointer data)
+{
+    MilterEventLoopTimeout *timeout = data;
+
+    timeout->id = 0;
+    timeout_dispatch(timeout);
+
+    return FALSE;
+}
+
+MilterEventLoopTimeout *
+milter_event_loop_timeout_new (MilterEventLoop *loop,
+                               GSourceFunc      function,
+                               gpointer         data)
+{
+    MilterEventLoopTimeout *timeout;
+
+    g_return_val_if_fail(loop != NULL, NULL);
+    g_return_val_if_fail(function != NULL, NULL);
+
+    timeout = g_new0(MilterEventLoopTimeout, 1);
+    timeout->loop = g_object_ref(loop);
+    timeout->function = function;
+    timeout->user_data = data;
+    timeout->link.data = timeout;
+
+    return timeout;
+}
+
+void
+milter_event_loop_timeout_free (MilterEventLoopTimeout *timeout)
+{
+    g_return_if_fail(timeout != NULL);
+
+    milter_event_loop_timeout_stop(timeout);
+    if (timeout->dispatching) {
+        timeout->destroyed = TRUE;
+        return;
+    }
+    g_object_unref(timeout->loop);
+    g_free(timeout);
+}
+
+MilterEventLoop *
+milter_event_loop_timeout_get_loop (MilterEventLoopTimeout *timeout)
+{
+    g_return_val_if_fail(timeout != NULL, NULL);
+
+    return timeout->loop;
+}
+
+void
+milter_event_loop_timeout_start (MilterEventLoopTimeout *timeout,
+                                 gdouble                 interval_in_seconds)
+{
+    MilterEventLoopPrivate *priv;
+    gdouble expire_time;
+
+    g_return_if_fail(timeout != NULL);
+    g_return_if_fail(interval_in_seconds >= 0);
+
+    timeout->interval = interval_in_seconds;
+    if (interval_in_seconds < TIMER_WHEEL_MIN_INTERVAL) {
+        milter_event_loop_timeout_stop(timeout);
+        timeout->id = milter_event_loop_add_timeout(timeout->loop,
+                                                    interval_in_seconds,
+                                                    cb_timeout,
+                                                    timeout);
+        return;
+    }
+
+    priv = MILTER_EVENT_LOOP_GET_PRIVATE(timeout->loop);
+    if (timeout->id > 0) {
+        milter_event_loop_remove(timeout->loop, timeout->id);
+        timeout->id = 0;
+    }
+    if (timeout->slot) {
+        g_queue_unlink(timeout->slot, &(timeout->link));
+        timeout->slot = NULL;
+    } else {
+        if (priv->timer_wheel_n_timeouts == 0)
+            priv->timer_wheel_tick =
+                timer_wheel_elapsed(priv) / TIMER_WHEEL_RESOLUTION;
+        priv->timer_wheel_n_timeouts++;
+    }
+
+    expire_time = timer_wheel_elapsed(priv) + interval_in_seconds;
+    timeout->expire_tick = expire_time / TIMER_WHEEL_RESOLUTION;
+    if (timeout->expire_tick * TIMER_WHEEL_RESOLUTION < expire_time)
+        timeout->expire_tick++;
+    timer_wheel_insert(priv, timeout);
+
+    if (priv->timer_wheel_driver_id == 0 ||
+        timeout->expire_tick < priv->timer_wheel_driver_tick)
+        timer_wheel_update_driver(timeout->loop, priv);
+}
+
+void
+milter_event_loop_timeout_stop (MilterEventLoopTimeout *timeout)
+{
+    g_return_if_fail(timeout != NULL);
+
+    if (timeout->id > 0) {
+        milter_event_loop_remove(timeout->loop, timeout->id);
+        timeout->id = 0;
+    }
+    if (timeout->slot) {
+        MilterEventLoopPrivate *priv;
+
+        priv = MILTER_EVENT_LOOP_GET_PRIVATE(timeout->loop);
+        g_queue_unlink(timeout->slot, &(timeout->link));
+        timeout->slot = NULL;
+        priv->timer_wheel_n_timeouts--;
+        if (priv->timer_wheel_n_timeouts == 0)
+            timer_wheel_update_driver(timeout->loop, priv);
+    }
+}
+
+gboolean
+milter_event_loop_timeout_is_active (MilterEventLoopTimeout *timeout)
+{
+    g_return_val_if_fail(timeout != NULL, FALSE);
+
+    return timeout->id > 0 || timeout->slot != NULL;
+}
+
+static void
+notify_job_done (Job *job)
+{
+    MilterEventLoopPrivate *priv;
+    gssize written_size;
+
+    priv = MILTER_EVENT_LOOP_GET_PRIVATE(job->loop);
+    g_async_queue_push(priv->done_jobs, job);
+    do {
+        written_size = write(priv->job_notify_fds[1], "", 1);
+    } while (written_size == -1 && errno == EINTR);
+    /* EAGAIN means that the loop has been notified already. */
+}
+
+static void
+job_thread (gpointer data, gpointer user_data)
+{
+    Job *job = data;
+
+    job->func(job->user_data);
+    notify_job_done(job);
+}
+
+static gboolean
+cb_job_done (GIOChannel *channel, GIOCondition condition, gpointer data)
+{
+    MilterEventLoop *loop = data;
+    MilterEventLoopPrivate *priv;
+    gchar buffer[64];
+    Job *job;
+    gboolean keep_watching;
+
+    priv = MILTER_EVENT_LOOP_GET_PRIVATE(loop);
+    while (read(priv->job_notify_fds[0], buffer, sizeof(buffer)) > 0) {
+    }
+
+    g_object_ref(loop);
+    while ((job = g_async_queue_try_pop(priv->done_jobs))) {
+        priv->n_pending_jobs--;
+        if (job->done)
+            job->done(job->user_data);
+        g_object_unref(job->loop);
+        g_free(job);
+    }
+    keep_watching = priv->n_pending_jobs > 0;
+    if (!keep_watching)
+        priv->job_notify_watch_id = 0;
+    g_object_unref(loop);
+
+    return keep_watching;
+}
+
+static gboolean
+setup_job_notify (MilterEventLoop *loop, MilterEventLoopPrivate *priv)
+{
+    if (!priv->job_notify_channel) {
+        if (pipe(priv->job_notify_fds) == -1) {
+            milter_error("[event-loop][job][error] failed to create pipe: %s",
+                         g_strerror(errno));
+            return FALSE;
+        }
+        fcntl(priv->job_notify_fds[0], F_SETFL, O_NONBLOCK);
+        fcntl(priv->job_notify_fds[1], F_SETFL, O_NONBLOCK);
+        fcntl(priv->job_notify_fds[0], F_SETFD, FD_CLOEXEC);
+        fcntl(priv->job_notify_fds[1], F_SETFD, FD_CLOEXEC);
+        priv->job_notify_channel = g_io_channel_unix_new(priv->job_notify_fds[0]);
+        g_io_channel_set_close_on_unref(priv->job_notify_channel, TRUE);
+        priv->done_jobs = g_async_queue_new();
+    }
+
+    /* The watch only lives while jobs are pending. */
+    if (priv->job_notify_watch_id == 0) {
+        priv->job_notify_watch_id =
+            milter_event_loop_watch_io(loop,
+                                       priv->job_notify_channel,
+                                       G_IO_IN,
+                                       cb_job_done,
+                                       loop);
+    }
+
+    return TRUE;
+}
+
+void
+milter_event_loop_add_job (MilterEventLoop        *loop,
+                           MilterEventLoopJobFunc  func,
+                           MilterEventLoopJobFunc  done,
+                           gpointer                user_data)
+{
+    MilterEventLoopPrivate *priv;
+    Job *job;
+    GError *error = NULL;
+
+    g_return_if_fail(loop != NULL);
+    g_return_if_fail(func != NULL);
+
+    priv = MILTER_EVENT_LOOP_GET_PRIVATE(loop);
+    if (!setup_job_notify(loop, priv)) {
+        func(user_data);
+        if (done)
+            done(user_data);
+        return;
+    }
+
+    job = g_new(Job, 1);
+    job->loop = g_object_ref(loop);
+    job->func = func;
+    job->done = done;
+    job->user_data = user_data;
+    priv->n_pending_jobs++;
+
+    G_LOCK(job_threads);
+    if (!job_threads) {
+        job_threads = g_thread_pool_new(job_thread, NULL,
+                                        MAX_JOB_THREADS, FALSE,
+                                        &error);
+    }
+    G_UNLOCK(job_threads);
+
+    if (!job_threads) {
+        milter_warning("[event-loop][job][fallback] %s", error->message);
+        g_error_free(error);
+        /* The done callback is still called from the loop. */
+        func(user_data);
+        notify_job_done(job);
+        return;
+    }
+
+    g_thread_pool_push(job_threads, job, &error);
+    if (error) {
+        /* The job is queued anyway and runs on an existing thread. */
+        milter_warning("[event-loop][job][push][error] %s", error->message);
+        g_error_free(error);
+    }
+}
+
 /*
 vi:ts=4:nowrap:ai:expandtab:sw=4
 */
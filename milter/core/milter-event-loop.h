@@ -41,6 +41,7 @@ typedef enum
 
 typedef struct _MilterEventLoop         MilterEventLoop;
 typedef struct _MilterEventLoopClass    MilterEventLoopClass;
+typedef struct _MilterEventLoopTimeout  MilterEventLoopTimeout;
 
 struct _MilterEventLoop
 {
@@ -62,6 +63,9 @@ struct _MilterEventLoopClass
                                   GIOFunc          function,
                                   gpointer         data,
                                   GDestroyNotify   notify);
+    gboolean (*modify_io)        (MilterEventLoop *loop,
+                                  guint            id,
+                                  GIOCondition     condition);
     guint    (*watch_child_full) (MilterEventLoop *loop,
                                   gint             priority,
                                   GPid             pid,
@@ -84,6 +88,7 @@ struct _MilterEventLoopClass
 };
 
 typedef void        (*MilterEventLoopCustomRunFunc)      (MilterEventLoop *loop);
+typedef void        (*MilterEventLoopJobFunc)            (gpointer         user_data);
 typedef gboolean    (*MilterEventLoopCustomIterateFunc)  (MilterEventLoop *loop,
                                                           gboolean         may_block,
                                                           gpointer         user_data);
@@ -126,6 +131,9 @@ guint                milter_event_loop_watch_io_full     (MilterEventLoop *loop,
                                                           GIOFunc          function,
                                                           gpointer         data,
                                                           GDestroyNotify   notify);
+gboolean             milter_event_loop_modify_io         (MilterEventLoop *loop,
+                                                          guint            id,
+                                                          GIOCondition     condition);
 
 
 guint                milter_event_loop_watch_child       (MilterEventLoop *loop,
@@ -164,6 +172,22 @@ guint                milter_event_loop_add_idle_full     (MilterEventLoop *loop,
 gboolean             milter_event_loop_remove            (MilterEventLoop *loop,
                                                           guint            id);
 
+MilterEventLoopTimeout *
+                     milter_event_loop_timeout_new       (MilterEventLoop *loop,
+                                                          GSourceFunc      function,
+                                                          gpointer         data);
+void                 milter_event_loop_timeout_free      (MilterEventLoopTimeout *timeout);
+MilterEventLoop     *milter_event_loop_timeout_get_loop  (MilterEventLoopTimeout *timeout);
+void                 milter_event_loop_timeout_start     (MilterEventLoopTimeout *timeout,
+                                                          gdouble          interval_in_seconds);
+void                 milter_event_loop_timeout_stop      (MilterEventLoopTimeout *timeout);
+gboolean             milter_event_loop_timeout_is_active (MilterEventLoopTimeout *timeout);
+
+void                 milter_event_loop_add_job           (MilterEventLoop *loop,
+                                                          MilterEventLoopJobFunc func,
+                                                          MilterEventLoopJobFunc done,
+                                                          gpointer         user_data);
+
 G_END_DECLS
 
 #endif /* __MILTER_EVENT_LOOP_H__ */
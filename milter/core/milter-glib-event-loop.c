@@ -23,6 +23,7 @@
 #endif /* HAVE_CONFIG_H */
 
 #include "milter-glib-event-loop.h"
+#include "milter-core-internal.h"
 
 #define MILTER_GLIB_EVENT_LOOP_GET_PRIVATE(obj)                 \
     (G_TYPE_INSTANCE_GET_PRIVATE((obj),                         \
@@ -160,6 +161,11 @@ dispose (GObject *object)
 
     priv = MILTER_GLIB_EVENT_LOOP_GET_PRIVATE(object);
 
+    /* The context may be shared. Don't leave our source in it. */
+    if (priv->loop)
+        milter_event_loop_internal_remove_timer_wheel_driver(
+            MILTER_EVENT_LOOP(object));
+
     if (priv->loop) {
         g_main_loop_unref(priv->loop);
         priv->loop = NULL;
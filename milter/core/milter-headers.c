@@ -21,7 +21,10 @@
 #  include "../../config.h"
 #endif /* HAVE_CONFIG_H */
 
+#include <string.h>
+
 #include "milter-headers.h"
+#include "milter-memory-arena.h"
 #include "milter-utils.h"
 
 #define MILTER_HEADERS_GET_PRIVATE(obj)                   \
@@ -29,10 +32,21 @@
                                  MILTER_TYPE_HEADERS,     \
                                  MilterHeadersPrivate))
 
+typedef struct _MilterHeaderEntry MilterHeaderEntry;
+struct _MilterHeaderEntry
+{
+    MilterHeader header;
+    gint ref_count;
+    gboolean in_arena;
+};
+
 typedef struct _MilterHeadersPrivate MilterHeadersPrivate;
 struct _MilterHeadersPrivate
 {
+    GPtrArray *headers;
+    GHashTable *name_index;
     GList *header_list;
+    MilterMemoryArena *arena;
 };
 
 enum
@@ -52,9 +66,11 @@ static void get_property   (GObject         *object,
                             GValue          *value,
                             GParamSpec      *pspec);
 
-static void milter_header_change_value
-                           (MilterHeader *header,
-                            const gchar *new_value);
+static MilterHeader *header_entry_new   (MilterHeadersPrivate *priv,
+                                        const gchar *name,
+                                        const gchar *value);
+static MilterHeader *header_entry_ref   (MilterHeader *header);
+static void          header_entry_unref (MilterHeader *header);
 
 static void
 milter_headers_class_init (MilterHeadersClass *klass)
@@ -71,13 +87,46 @@ milter_headers_class_init (MilterHeadersClass *klass)
                              sizeof(MilterHeadersPrivate));
 }
 
+static guint
+header_name_hash (gconstpointer key)
+{
+    const gchar *name = key;
+    guint hash = 5381;
+
+    for (; *name; name++) {
+        hash = (hash << 5) + hash + g_ascii_tolower(*name);
+    }
+
+    return hash;
+}
+
+static gboolean
+header_name_equal (gconstpointer name1, gconstpointer name2)
+{
+    return g_ascii_strcasecmp(name1, name2) == 0;
+}
+
 static void
 milter_headers_init (MilterHeaders *headers)
 {
     MilterHeadersPrivate *priv;
 
     priv = MILTER_HEADERS_GET_PRIVATE(headers);
+    priv->headers = g_ptr_array_new();
+    priv->name_index =
+        g_hash_table_new_full(header_name_hash, header_name_equal,
+                              g_free, (GDestroyNotify)g_ptr_array_unref);
     priv->header_list = NULL;
+    priv->arena = NULL;
+}
+
+static void
+clear_header_list (MilterHeadersPrivate *priv)
+{
+    if (priv->header_list) {
+        g_list_free(priv->header_list);
+        priv->header_list = NULL;
+    }
 }
 
 static void
@@ -87,10 +136,17 @@ dispose (GObject *object)
 
     priv = MILTER_HEADERS_GET_PRIVATE(object);
 
-    if (priv->header_list) {
-        g_list_foreach(priv->header_list, (GFunc)milter_header_free, NULL);
-        g_list_free(priv->header_list);
-        priv->header_list = NULL;
+    clear_header_list(priv);
+
+    if (priv->name_index) {
+        g_hash_table_unref(priv->name_index);
+        priv->name_index = NULL;
+    }
+
+    if (priv->headers) {
+        g_ptr_array_foreach(priv->headers, (GFunc)header_entry_unref, NULL);
+        g_ptr_array_free(priv->headers, TRUE);
+        priv->headers = NULL;
     }
 
     G_OBJECT_CLASS(milter_headers_parent_class)->dispose(object);
@@ -122,26 +178,149 @@ get_property (GObject    *object,
     }
 }
 
+static void
+ptr_array_insert (GPtrArray *array, guint index, gpointer data)
+{
+    if (index >= array->len) {
+        g_ptr_array_add(array, data);
+        return;
+    }
+
+    g_ptr_array_add(array, NULL);
+    memmove(array->pdata + index + 1,
+            array->pdata + index,
+            sizeof(gpointer) * (array->len - index - 1));
+    array->pdata[index] = data;
+}
+
+static gint
+ptr_array_index_of (GPtrArray *array, gpointer data)
+{
+    guint i;
+
+    for (i = 0; i < array->len; i++) {
+        if (array->pdata[i] == data)
+            return i;
+    }
+
+    return -1;
+}
+
+static GPtrArray *
+lookup_same_name_headers (MilterHeadersPrivate *priv, const gchar *name)
+{
+    return g_hash_table_lookup(priv->name_index, name);
+}
+
+static GPtrArray *
+ensure_same_name_headers (MilterHeadersPrivate *priv, MilterHeader *header)
+{
+    GPtrArray *same_name_headers;
+
+    same_name_headers = lookup_same_name_headers(priv, header->name);
+    if (!same_name_headers) {
+        gchar *name;
+
+        if (priv->arena)
+            name = milter_memory_arena_strdup(priv->arena, header->name);
+        else
+            name = g_strdup(header->name);
+        same_name_headers = g_ptr_array_new();
+        g_hash_table_insert(priv->name_index, name, same_name_headers);
+    }
+
+    return same_name_headers;
+}
+
+static void
+index_remove (MilterHeadersPrivate *priv, MilterHeader *header)
+{
+    GPtrArray *same_name_headers;
+
+    if (!header->name)
+        return;
+
+    same_name_headers = lookup_same_name_headers(priv, header->name);
+    if (!same_name_headers)
+        return;
+
+    g_ptr_array_remove(same_name_headers, header);
+    if (same_name_headers->len == 0)
+        g_hash_table_remove(priv->name_index, header->name);
+}
+
+static void
+index_replace (MilterHeadersPrivate *priv,
+               MilterHeader *old_header, MilterHeader *new_header)
+{
+    GPtrArray *same_name_headers;
+    gint index;
+
+    same_name_headers = lookup_same_name_headers(priv, old_header->name);
+    index = ptr_array_index_of(same_name_headers, old_header);
+    same_name_headers->pdata[index] = new_header;
+}
+
+static void
+append_header (MilterHeadersPrivate *priv, MilterHeader *header)
+{
+    g_ptr_array_add(priv->headers, header);
+    if (header->name)
+        g_ptr_array_add(ensure_same_name_headers(priv, header), header);
+    clear_header_list(priv);
+}
+
+static void
+remove_header (MilterHeadersPrivate *priv, MilterHeader *header)
+{
+    index_remove(priv, header);
+    g_ptr_array_remove(priv->headers, header);
+    clear_header_list(priv);
+    header_entry_unref(header);
+}
+
 MilterHeaders *
 milter_headers_new (void)
 {
     return g_object_new(MILTER_TYPE_HEADERS, NULL);
 }
 
+/* Headers added to the returned object and its copies are allocated
+ * from @arena. They must not be used after @arena is reset. */
+MilterHeaders *
+milter_headers_new_with_arena (MilterMemoryArena *arena)
+{
+    MilterHeaders *headers;
+    MilterHeadersPrivate *priv;
+
+    headers = milter_headers_new();
+    priv = MILTER_HEADERS_GET_PRIVATE(headers);
+    priv->arena = arena;
+    if (arena) {
+        g_hash_table_unref(priv->name_index);
+        priv->name_index =
+            g_hash_table_new_full(header_name_hash, header_name_equal,
+                                  NULL, (GDestroyNotify)g_ptr_array_unref);
+    }
+
+    return headers;
+}
+
 MilterHeaders *
 milter_headers_copy (MilterHeaders *headers)
 {
     MilterHeaders *copied_headers;
-    GList *node;
-    MilterHeadersPrivate *priv;
+    MilterHeadersPrivate *priv, *copied_priv;
+    guint i;
 
     priv = MILTER_HEADERS_GET_PRIVATE(headers);
 
-    copied_headers = milter_headers_new();
-    for (node = priv->header_list; node; node = g_list_next(node)) {
-        MilterHeader *header = node->data;
+    copied_headers = milter_headers_new_with_arena(priv->arena);
+    copied_priv = MILTER_HEADERS_GET_PRIVATE(copied_headers);
+    for (i = 0; i < priv->headers->len; i++) {
+        MilterHeader *header = g_ptr_array_index(priv->headers, i);
 
-        milter_headers_append_header(copied_headers, header->name, header->value);
+        append_header(copied_priv, header_entry_ref(header));
     }
 
     return copied_headers;
@@ -150,7 +329,18 @@ milter_headers_copy (MilterHeaders *headers)
 const GList *
 milter_headers_get_list (MilterHeaders *headers)
 {
-    return MILTER_HEADERS_GET_PRIVATE(headers)->header_list;
+    MilterHeadersPrivate *priv;
+    gint i;
+
+    priv = MILTER_HEADERS_GET_PRIVATE(headers);
+    if (!priv->header_list) {
+        for (i = (gint)priv->headers->len - 1; i >= 0; i--) {
+            priv->header_list = g_list_prepend(priv->header_list,
+                                               priv->headers->pdata[i]);
+        }
+    }
+
+    return priv->header_list;
 }
 
 static gboolean
@@ -170,22 +360,25 @@ milter_headers_find (MilterHeaders *headers,
                      MilterHeader *header)
 {
     MilterHeadersPrivate *priv;
-    GList *found_node;
+    GPtrArray *same_name_headers;
+    guint i;
+
+    if (!header->name)
+        return NULL;
 
     priv = MILTER_HEADERS_GET_PRIVATE(headers);
-    found_node = g_list_find_custom(priv->header_list,
-                                    header,
-                                    (GCompareFunc)milter_header_compare);
-    if (!found_node)
+    same_name_headers = lookup_same_name_headers(priv, header->name);
+    if (!same_name_headers)
         return NULL;
-    return (MilterHeader *)(found_node->data);
-}
 
-static gint
-milter_header_name_compare (MilterHeader *header1,
-                            const gchar *name)
-{
-    return milter_utils_strcmp0(header1->name, name);
+    for (i = 0; i < same_name_headers->len; i++) {
+        MilterHeader *same_name_header = same_name_headers->pdata[i];
+
+        if (milter_header_compare(same_name_header, header) == 0)
+            return same_name_header;
+    }
+
+    return NULL;
 }
 
 MilterHeader *
@@ -193,16 +386,25 @@ milter_headers_lookup_by_name (MilterHeaders *headers,
                                const gchar *name)
 {
     MilterHeadersPrivate *priv;
-    GList *found_node;
+    GPtrArray *same_name_headers;
+    guint i;
 
-    priv = MILTER_HEADERS_GET_PRIVATE(headers);
+    if (!name)
+        return NULL;
 
-    found_node = g_list_find_custom(priv->header_list,
-                                    name,
-                                    (GCompareFunc)milter_header_name_compare);
-    if (!found_node)
+    priv = MILTER_HEADERS_GET_PRIVATE(headers);
+    same_name_headers = lookup_same_name_headers(priv, name);
+    if (!same_name_headers)
         return NULL;
-    return (MilterHeader*)found_node->data;
+
+    for (i = 0; i < same_name_headers->len; i++) {
+        MilterHeader *header = same_name_headers->pdata[i];
+
+        if (string_equal(header->name, name))
+            return header;
+    }
+
+    return NULL;
 }
 
 MilterHeader *
@@ -210,17 +412,15 @@ milter_headers_get_nth_header (MilterHeaders *headers,
                                guint index)
 {
     MilterHeadersPrivate *priv;
-    gpointer nth_data;
 
     if (index < 1)
         return NULL;
 
     priv = MILTER_HEADERS_GET_PRIVATE(headers);
-    nth_data = g_list_nth_data(priv->header_list, index - 1);
-    if (!nth_data)
+    if (index > priv->headers->len)
         return NULL;
 
-    return (MilterHeader*)nth_data;
+    return g_ptr_array_index(priv->headers, index - 1);
 }
 
 gint
@@ -228,13 +428,20 @@ milter_headers_index_in_same_header_name (MilterHeaders *headers,
                                           MilterHeader *target)
 {
     MilterHeadersPrivate *priv;
-    GList *node;
+    GPtrArray *same_name_headers;
+    guint i;
     guint found_count = 0;
 
+    if (!target->name)
+        return -1;
+
     priv = MILTER_HEADERS_GET_PRIVATE(headers);
+    same_name_headers = lookup_same_name_headers(priv, target->name);
+    if (!same_name_headers)
+        return -1;
 
-    for (node = priv->header_list; node; node = g_list_next(node)) {
-        MilterHeader *header = node->data;
+    for (i = 0; i < same_name_headers->len; i++) {
+        MilterHeader *header = same_name_headers->pdata[i];
 
         if (!string_equal(header->name, target->name))
             continue;
@@ -260,8 +467,7 @@ milter_headers_remove (MilterHeaders *headers,
     if (!found_header)
         return FALSE;
 
-    priv->header_list = g_list_remove(priv->header_list, found_header);
-    milter_header_free(found_header);
+    remove_header(priv, found_header);
 
     return TRUE;
 }
@@ -272,25 +478,22 @@ milter_headers_add_header (MilterHeaders *headers,
                            const gchar *value)
 {
     MilterHeadersPrivate *priv;
-    GList *node, *same_name_header = NULL;
+    GPtrArray *same_name_headers;
+    MilterHeader *header;
 
     priv = MILTER_HEADERS_GET_PRIVATE(headers);
 
-    for (node = priv->header_list; node; node = g_list_next(node)) {
-        MilterHeader *header = node->data;
-        if (g_ascii_strcasecmp(header->name, name) == 0) {
-            same_name_header = node;
-            break;
-        }
-    }
+    header = header_entry_new(priv, name, value);
+    same_name_headers = name ? lookup_same_name_headers(priv, name) : NULL;
+    if (same_name_headers) {
+        gint index;
 
-    if (same_name_header) {
-        priv->header_list = g_list_insert_before(priv->header_list,
-                                                 same_name_header,
-                                                 milter_header_new(name, value));
+        index = ptr_array_index_of(priv->headers, same_name_headers->pdata[0]);
+        ptr_array_insert(priv->headers, index, header);
+        ptr_array_insert(same_name_headers, 0, header);
+        clear_header_list(priv);
     } else {
-        priv->header_list = g_list_append(priv->header_list,
-                                          milter_header_new(name, value));
+        append_header(priv, header);
     }
 
     return TRUE;
@@ -304,8 +507,7 @@ milter_headers_append_header (MilterHeaders *headers,
     MilterHeadersPrivate *priv;
 
     priv = MILTER_HEADERS_GET_PRIVATE(headers);
-    priv->header_list = g_list_append(priv->header_list,
-                                      milter_header_new(name, value));
+    append_header(priv, header_entry_new(priv, name, value));
 
     return TRUE;
 }
@@ -317,12 +519,32 @@ milter_headers_insert_header (MilterHeaders *headers,
                               const gchar *value)
 {
     MilterHeadersPrivate *priv;
+    MilterHeader *header;
+    GPtrArray *same_name_headers;
+    guint i, n_same_name_headers_before = 0;
 
     priv = MILTER_HEADERS_GET_PRIVATE(headers);
 
-    priv->header_list = g_list_insert(priv->header_list,
-                                      milter_header_new(name, value),
-                                      position);
+    if (position >= priv->headers->len) {
+        append_header(priv, header_entry_new(priv, name, value));
+        return TRUE;
+    }
+
+    header = header_entry_new(priv, name, value);
+    ptr_array_insert(priv->headers, position, header);
+    clear_header_list(priv);
+    if (!name)
+        return TRUE;
+
+    for (i = 0; i < position; i++) {
+        MilterHeader *other_header = priv->headers->pdata[i];
+
+        if (other_header->name &&
+            header_name_equal(other_header->name, header->name))
+            n_same_name_headers_before++;
+    }
+    same_name_headers = ensure_same_name_headers(priv, header);
+    ptr_array_insert(same_name_headers, n_same_name_headers_before, header);
 
     return TRUE;
 }
@@ -333,13 +555,20 @@ milter_headers_lookup_by_name_with_index (MilterHeaders *headers,
                                           guint index)
 {
     MilterHeadersPrivate *priv;
-    GList *node;
+    GPtrArray *same_name_headers;
+    guint i;
     guint found_count = 0;
 
+    if (!name)
+        return NULL;
+
     priv = MILTER_HEADERS_GET_PRIVATE(headers);
+    same_name_headers = lookup_same_name_headers(priv, name);
+    if (!same_name_headers)
+        return NULL;
 
-    for (node = priv->header_list; node; node = g_list_next(node)) {
-        MilterHeader *header = node->data;
+    for (i = 0; i < same_name_headers->len; i++) {
+        MilterHeader *header = same_name_headers->pdata[i];
 
         if (!string_equal(header->name, name))
             continue;
@@ -353,6 +582,33 @@ milter_headers_lookup_by_name_with_index (MilterHeaders *headers,
     return NULL;
 }
 
+static void
+change_header_value (MilterHeadersPrivate *priv,
+                     MilterHeader *header,
+                     const gchar *value)
+{
+    MilterHeaderEntry *entry = (MilterHeaderEntry *)header;
+    MilterHeader *new_header;
+    gint index;
+
+    if (entry->ref_count == 1) {
+        if (entry->in_arena) {
+            header->value = milter_memory_arena_strdup(priv->arena, value);
+        } else {
+            g_free(header->value);
+            header->value = g_strdup(value);
+        }
+        return;
+    }
+
+    new_header = header_entry_new(priv, header->name, value);
+    index = ptr_array_index_of(priv->headers, header);
+    priv->headers->pdata[index] = new_header;
+    index_replace(priv, header, new_header);
+    clear_header_list(priv);
+    header_entry_unref(header);
+}
+
 gboolean
 milter_headers_change_header (MilterHeaders *headers,
                               const gchar *name,
@@ -366,7 +622,8 @@ milter_headers_change_header (MilterHeaders *headers,
 
     header = milter_headers_lookup_by_name_with_index(headers, name, index);
     if (header)
-        milter_header_change_value(header, value);
+        change_header_value(MILTER_HEADERS_GET_PRIVATE(headers),
+                            header, value);
     else
         milter_headers_add_header(headers, name, value);
 
@@ -379,15 +636,12 @@ milter_headers_delete_header (MilterHeaders *headers,
                               guint index)
 {
     MilterHeader *header;
-    MilterHeadersPrivate *priv;
 
     header = milter_headers_lookup_by_name_with_index(headers, name, index);
     if (!header)
         return FALSE;
 
-    priv = MILTER_HEADERS_GET_PRIVATE(headers);
-    priv->header_list = g_list_remove(priv->header_list, header);
-    milter_header_free(header);
+    remove_header(MILTER_HEADERS_GET_PRIVATE(headers), header);
 
     return TRUE;
 }
@@ -398,7 +652,56 @@ milter_headers_length (MilterHeaders *headers)
     MilterHeadersPrivate *priv;
 
     priv = MILTER_HEADERS_GET_PRIVATE(headers);
-    return g_list_length(priv->header_list);
+    return priv->headers->len;
+}
+
+static MilterHeader *
+header_entry_new (MilterHeadersPrivate *priv,
+                  const gchar *name, const gchar *value)
+{
+    MilterHeaderEntry *entry;
+
+    if (priv->arena) {
+        entry = milter_memory_arena_new0(priv->arena, MilterHeaderEntry);
+        entry->header.name = milter_memory_arena_strdup(priv->arena, name);
+        entry->header.value = milter_memory_arena_strdup(priv->arena, value);
+        entry->in_arena = TRUE;
+    } else {
+        entry = g_slice_new(MilterHeaderEntry);
+        entry->header.name = g_strdup(name);
+        entry->header.value = g_strdup(value);
+        entry->in_arena = FALSE;
+    }
+    entry->ref_count = 1;
+
+    return &(entry->header);
+}
+
+static MilterHeader *
+header_entry_ref (MilterHeader *header)
+{
+    MilterHeaderEntry *entry = (MilterHeaderEntry *)header;
+
+    entry->ref_count++;
+    return header;
+}
+
+static void
+header_entry_unref (MilterHeader *header)
+{
+    MilterHeaderEntry *entry = (MilterHeaderEntry *)header;
+
+    entry->ref_count--;
+    if (entry->ref_count > 0)
+        return;
+
+    /* The arena releases them at once. */
+    if (entry->in_arena)
+        return;
+
+    g_free(header->name);
+    g_free(header->value);
+    g_slice_free(MilterHeaderEntry, entry);
 }
 
 MilterHeader *
@@ -452,15 +755,6 @@ milter_header_equal (gconstpointer data1, gconstpointer data2)
         string_equal(header1->value, header2->value);
 }
 
-static void
-milter_header_change_value (MilterHeader *header,
-                            const gchar *new_value)
-{
-    if (header->value)
-        g_free(header->value);
-    header->value = g_strdup(new_value);
-}
-
 /*
 vi:ts=4:nowrap:ai:expandtab:sw=4
 */
@@ -22,6 +22,8 @@
 
 #include <glib-object.h>
 
+#include <milter/core/milter-memory-arena.h>
+
 G_BEGIN_DECLS
 
 #define MILTER_TYPE_HEADERS            (milter_headers_get_type())
@@ -66,6 +68,8 @@ struct _MilterHeadersClass
 GType          milter_headers_get_type    (void) G_GNUC_CONST;
 
 MilterHeaders *milter_headers_new         (void);
+MilterHeaders *milter_headers_new_with_arena
+                                          (MilterMemoryArena *arena);
 MilterHeaders *milter_headers_copy        (MilterHeaders *headers);
 const GList   *milter_headers_get_list    (MilterHeaders *headers);
 
@@ -24,7 +24,9 @@
 
 #include "milter-libev-event-loop.h"
 #include "milter-logger.h"
+#include "milter-core-internal.h"
 #include <math.h>
+#include <string.h>
 #include <ev.h>
 
 #define MILTER_LIBEV_EVENT_LOOP_GET_PRIVATE(obj)                \
@@ -40,8 +42,8 @@ typedef struct _MilterLibevEventLoopPrivate	MilterLibevEventLoopPrivate;
 struct _MilterLibevEventLoopPrivate
 {
     ev_loop *ev_loop;
-    guint id;
-    GHashTable *watchers;
+    GPtrArray *watcher_slabs;
+    GQueue free_watchers;
     guint n_called;
     GFunc release_func;
     GFunc acquire_func;
@@ -68,8 +70,6 @@ static void     get_property     (GObject         *object,
                                   GValue          *value,
                                   GParamSpec      *pspec);
 
-static void     destroy_watcher  (gpointer         data);
-
 static gboolean iterate          (MilterEventLoop *loop,
                                   gboolean         may_block);
 static void     quit             (MilterEventLoop *loop);
@@ -82,6 +82,10 @@ static guint    watch_io_full    (MilterEventLoop *loop,
                                   gpointer         data,
                                   GDestroyNotify   notify);
 
+static gboolean modify_io        (MilterEventLoop *loop,
+                                  guint            id,
+                                  GIOCondition     condition);
+
 static guint    watch_child_full (MilterEventLoop *loop,
                                   gint             priority,
                                   GPid             pid,
@@ -120,6 +124,7 @@ milter_libev_event_loop_class_init (MilterLibevEventLoopClass *klass)
     klass->parent_class.iterate = iterate;
     klass->parent_class.quit = quit;
     klass->parent_class.watch_io_full = watch_io_full;
+    klass->parent_class.modify_io = modify_io;
     klass->parent_class.watch_child_full = watch_child_full;
     klass->parent_class.add_timeout_full = add_timeout_full;
     klass->parent_class.add_idle_full = add_idle_full;
@@ -141,9 +146,8 @@ milter_libev_event_loop_init (MilterLibevEventLoop *loop)
 
     priv = MILTER_LIBEV_EVENT_LOOP_GET_PRIVATE(loop);
     priv->ev_loop = NULL;
-    priv->id = 0;
-    priv->watchers = g_hash_table_new_full(g_direct_hash, g_direct_equal,
-                                           NULL, destroy_watcher);
+    priv->watcher_slabs = g_ptr_array_new();
+    g_queue_init(&(priv->free_watchers));
     priv->n_called = 0;
     priv->release_func = NULL;
     priv->acquire_func = NULL;
@@ -209,10 +213,11 @@ dispose (GObject *object)
 
     priv = MILTER_LIBEV_EVENT_LOOP_GET_PRIVATE(object);
 
-    if (priv->watchers) {
-        g_hash_table_unref(priv->watchers);
-        priv->watchers = NULL;
-    }
+    if (priv->ev_loop)
+        milter_event_loop_internal_remove_timer_wheel_driver(
+            MILTER_EVENT_LOOP(object));
+    if (priv->watcher_slabs)
+        dispose_watchers(priv);
 
     dispose_ev_loop(priv);
 
@@ -285,87 +290,238 @@ milter_libev_event_loop_new (void)
 }
 
 #define WATCHER_STOP_FUNC(func)          ((WatcherStopFunc)(func))
-#define WATCHER_DESTROY_FUNC(func)       ((WatcherDestroyFunc)(func))
-#define WATCHER_PRIVATE(object)          ((WatcherPrivate *)(object))
+#define WATCHER(ev_watcher)              ((Watcher *)(ev_watcher))
+
+/* A watcher ID is the index in the watcher table plus 1 and a
+ * generation that is incremented each time the entry is reused. A
+ * stale ID never matches a newer watcher that reuses the entry. An
+ * entry whose generation is saturated is retired instead of wrapping
+ * its generation. A slab whose entries are all retired is freed and
+ * its indexes are reused only after all indexes are used up. */
+#define WATCHER_SLAB_SIZE       64
+#define WATCHER_INDEX_BITS      18
+#define WATCHER_INDEX_MASK      ((1 << WATCHER_INDEX_BITS) - 1)
+#define WATCHER_GENERATION_MASK ((1 << (32 - WATCHER_INDEX_BITS)) - 1)
+#define WATCHER_MAX_SLABS       (WATCHER_INDEX_MASK / WATCHER_SLAB_SIZE)
 
 typedef void (*WatcherStopFunc) (ev_loop *loop, ev_watcher *watcher);
-typedef void (*WatcherDestroyFunc) (ev_watcher *watcher);
 
-typedef struct _WatcherPrivate WatcherPrivate;
-struct _WatcherPrivate
+typedef struct _WatcherSlab WatcherSlab;
+
+typedef struct _Watcher Watcher;
+struct _Watcher
 {
+    union {
+        ev_watcher any;
+        ev_io io;
+        ev_child child;
+        ev_timer timer;
+        ev_idle idle;
+    } ev;
     MilterLibevEventLoop *loop;
     guint id;
+    guint index;
+    guint generation;
     WatcherStopFunc stop_func;
-    WatcherDestroyFunc destroy_func;
     GDestroyNotify notify;
     gpointer user_data;
+    union {
+        struct {
+            GIOChannel *channel;
+            GIOFunc function;
+        } io;
+        GChildWatchFunc child;
+        GSourceFunc source;
+    } function;
+    GList link;
 };
 
-static guint
-add_watcher (MilterLibevEventLoop *loop, ev_watcher *watcher,
-             WatcherStopFunc stop_func, WatcherDestroyFunc destroy_func,
+struct _WatcherSlab
+{
+    guint n_retired;
+    Watcher watchers[WATCHER_SLAB_SIZE];
+};
+
+static WatcherSlab *
+new_watcher_slab (MilterLibevEventLoopPrivate *priv, guint slab_index)
+{
+    WatcherSlab *slab;
+    guint i, base;
+
+    base = slab_index * WATCHER_SLAB_SIZE;
+    slab = g_new0(WatcherSlab, 1);
+    for (i = 0; i < WATCHER_SLAB_SIZE; i++) {
+        Watcher *watcher = &(slab->watchers[i]);
+
+        watcher->index = base + i;
+        watcher->link.data = watcher;
+        g_queue_push_tail_link(&(priv->free_watchers), &(watcher->link));
+    }
+
+    return slab;
+}
+
+static gboolean
+add_watcher_slab (MilterLibevEventLoopPrivate *priv)
+{
+    guint i;
+
+    if (priv->watcher_slabs->len < WATCHER_MAX_SLABS) {
+        g_ptr_array_add(priv->watcher_slabs,
+                        new_watcher_slab(priv, priv->watcher_slabs->len));
+        return TRUE;
+    }
+
+    for (i = 0; i < priv->watcher_slabs->len; i++) {
+        if (!g_ptr_array_index(priv->watcher_slabs, i)) {
+            milter_debug("[libev-event-loop][watcher][slab][reuse] <%u>", i);
+            g_ptr_array_index(priv->watcher_slabs, i) =
+                new_watcher_slab(priv, i);
+            return TRUE;
+        }
+    }
+
+    return FALSE;
+}
+
+static Watcher *
+add_watcher (MilterLibevEventLoop *loop, WatcherStopFunc stop_func,
              GDestroyNotify notify, gpointer user_data)
 {
     MilterLibevEventLoopPrivate *priv;
-    WatcherPrivate *watcher_priv;
+    Watcher *watcher;
 
     priv = MILTER_LIBEV_EVENT_LOOP_GET_PRIVATE(loop);
 
-    while (TRUE) {
-        priv->id++;
+    if (g_queue_is_empty(&(priv->free_watchers)) &&
+        !add_watcher_slab(priv)) {
+        milter_error("[libev-event-loop][watcher][error] "
+                     "too many watchers: <%u>",
+                     priv->watcher_slabs->len * WATCHER_SLAB_SIZE);
+        return NULL;
+    }
 
-        if (priv->id == 0) {
-            continue;
-        }
-        if (g_hash_table_lookup_extended(priv->watchers,
-                                         GUINT_TO_POINTER(priv->id),
-                                         NULL, NULL)) {
-            continue;
-        }
-        break;
+    /* Reuse the least recently freed entry so that generations of an
+     * entry are used up as slowly as possible. */
+    watcher = g_queue_pop_head_link(&(priv->free_watchers))->data;
+    watcher->loop = loop;
+    watcher->id =
+        (watcher->generation << WATCHER_INDEX_BITS) | (watcher->index + 1);
+    watcher->stop_func = stop_func;
+    watcher->notify = notify;
+    watcher->user_data = user_data;
+
+    return watcher;
+}
+
+static Watcher *
+lookup_watcher (MilterLibevEventLoopPrivate *priv, guint id)
+{
+    WatcherSlab *slab;
+    Watcher *watcher;
+    guint index;
+
+    index = id & WATCHER_INDEX_MASK;
+    if (index == 0)
+        return NULL;
+    index--;
+    if (index / WATCHER_SLAB_SIZE >= priv->watcher_slabs->len)
+        return NULL;
+
+    slab = g_ptr_array_index(priv->watcher_slabs, index / WATCHER_SLAB_SIZE);
+    if (!slab)
+        return NULL;
+    watcher = &(slab->watchers[index % WATCHER_SLAB_SIZE]);
+    if (watcher->id != id)
+        return NULL;
+
+    return watcher;
+}
+
+static void
+retire_watcher (MilterLibevEventLoopPrivate *priv, Watcher *watcher)
+{
+    WatcherSlab *slab;
+    guint slab_index;
+
+    slab_index = watcher->index / WATCHER_SLAB_SIZE;
+    milter_debug("[libev-event-loop][watcher][retire] <%u>", watcher->index);
+    slab = g_ptr_array_index(priv->watcher_slabs, slab_index);
+    slab->n_retired++;
+    if (slab->n_retired == WATCHER_SLAB_SIZE) {
+        g_free(slab);
+        g_ptr_array_index(priv->watcher_slabs, slab_index) = NULL;
     }
+}
 
-    watcher_priv = watcher->data;
-    watcher_priv->loop = loop;
-    watcher_priv->id = priv->id;
-    watcher_priv->stop_func = stop_func;
-    watcher_priv->destroy_func = destroy_func;
-    watcher_priv->notify = notify;
-    watcher_priv->user_data = user_data;
+static void
+destroy_watcher (MilterLibevEventLoopPrivate *priv, Watcher *watcher)
+{
+    GDestroyNotify notify;
+    gpointer user_data;
 
-    g_hash_table_insert(priv->watchers, GUINT_TO_POINTER(priv->id), watcher);
+    watcher->stop_func(priv->ev_loop, &(watcher->ev.any));
+    if (watcher->stop_func == WATCHER_STOP_FUNC(ev_io_stop))
+        g_io_channel_unref(watcher->function.io.channel);
+
+    notify = watcher->notify;
+    user_data = watcher->user_data;
+
+    watcher->id = 0;
+    watcher->loop = NULL;
+    watcher->stop_func = NULL;
+    watcher->notify = NULL;
+    watcher->user_data = NULL;
+    memset(&(watcher->function), 0, sizeof(watcher->function));
+    if (watcher->generation == WATCHER_GENERATION_MASK) {
+        retire_watcher(priv, watcher);
+    } else {
+        watcher->generation++;
+        g_queue_push_tail_link(&(priv->free_watchers), &(watcher->link));
+    }
 
-    return priv->id;
+    if (notify)
+        notify(user_data);
 }
 
 static void
-destroy_watcher (gpointer data)
+dispose_watchers (MilterLibevEventLoopPrivate *priv)
 {
-    ev_watcher *watcher = data;
-    WatcherPrivate *watcher_priv;
-    MilterLibevEventLoopPrivate *priv;
+    guint i, j;
 
-    watcher_priv = watcher->data;
-    priv = MILTER_LIBEV_EVENT_LOOP_GET_PRIVATE(watcher_priv->loop);
-    watcher_priv->stop_func(priv->ev_loop, watcher);
+    for (i = 0; i < priv->watcher_slabs->len; i++) {
+        for (j = 0; j < WATCHER_SLAB_SIZE; j++) {
+            WatcherSlab *slab;
 
-    if (watcher_priv->notify)
-        watcher_priv->notify(watcher_priv->user_data);
+            slab = g_ptr_array_index(priv->watcher_slabs, i);
+            if (!slab)
+                break;
+            if (slab->watchers[j].id != 0)
+                destroy_watcher(priv, &(slab->watchers[j]));
+        }
+    }
 
-    if (watcher_priv->destroy_func)
-        watcher_priv->destroy_func(watcher);
-    g_free(watcher_priv);
-    g_free(watcher);
+    g_queue_init(&(priv->free_watchers));
+    for (i = 0; i < priv->watcher_slabs->len; i++) {
+        g_free(g_ptr_array_index(priv->watcher_slabs, i));
+    }
+    g_ptr_array_free(priv->watcher_slabs, TRUE);
+    priv->watcher_slabs = NULL;
 }
 
 static gboolean
 remove_watcher (MilterLibevEventLoop *loop, guint id)
 {
     MilterLibevEventLoopPrivate *priv;
+    Watcher *watcher;
 
     priv = MILTER_LIBEV_EVENT_LOOP_GET_PRIVATE(loop);
-    return g_hash_table_remove(priv->watchers, GUINT_TO_POINTER(id));
+    watcher = lookup_watcher(priv, id);
+    if (!watcher)
+        return FALSE;
+
+    destroy_watcher(priv, watcher);
+    return TRUE;
 }
 
 static gboolean
@@ -428,39 +584,21 @@ evcond_to_g_io_condition(short event)
     return condition;
 }
 
-typedef struct _IOWatcherPrivate IOWatcherPrivate;
-struct _IOWatcherPrivate {
-    WatcherPrivate priv;
-    GIOChannel *channel;
-    GIOFunc function;
-};
-
 static void
-io_watcher_destroy (ev_watcher *watcher)
+io_func (struct ev_loop *loop, ev_io *io_watcher, int revents)
 {
-    IOWatcherPrivate *watcher_priv;
-
-    watcher_priv = watcher->data;
-    g_io_channel_unref(watcher_priv->channel);
-}
-
-static void
-io_func (struct ev_loop *loop, ev_io *watcher, int revents)
-{
-    IOWatcherPrivate *io_watcher_priv;
-    WatcherPrivate *watcher_priv;
+    Watcher *watcher;
     MilterLibevEventLoop *milter_event_loop;
     guint id;
 
-    io_watcher_priv = watcher->data;
-    watcher_priv = WATCHER_PRIVATE(io_watcher_priv);
+    watcher = WATCHER(io_watcher);
 
-    milter_event_loop = watcher_priv->loop;
+    milter_event_loop = watcher->loop;
     MILTER_LIBEV_EVENT_LOOP_GET_PRIVATE(milter_event_loop)->n_called++;
-    id = watcher_priv->id;
-    if (!io_watcher_priv->function(io_watcher_priv->channel,
-                                   evcond_to_g_io_condition(revents),
-                                   watcher_priv->user_data)) {
+    id = watcher->id;
+    if (!watcher->function.io.function(watcher->function.io.channel,
+                                       evcond_to_g_io_condition(revents),
+                                       watcher->user_data)) {
         remove_watcher(milter_event_loop, id);
     }
 }
@@ -474,10 +612,8 @@ watch_io_full (MilterEventLoop *loop,
                gpointer         user_data,
                GDestroyNotify   notify)
 {
-    guint id;
     int fd;
-    ev_io *watcher;
-    IOWatcherPrivate *watcher_priv;
+    Watcher *watcher;
     MilterLibevEventLoopPrivate *priv;
 
     fd = g_io_channel_unix_get_fd(channel);
@@ -486,48 +622,59 @@ watch_io_full (MilterEventLoop *loop,
 
     priv = MILTER_LIBEV_EVENT_LOOP_GET_PRIVATE(loop);
 
-    watcher_priv = g_new0(IOWatcherPrivate, 1);
-    watcher_priv->channel = channel;
-    g_io_channel_ref(watcher_priv->channel);
-    watcher_priv->function = function;
-
-    watcher = g_new0(ev_io, 1);
-    watcher->data = watcher_priv;
-    id = add_watcher(MILTER_LIBEV_EVENT_LOOP(loop),
-                      (ev_watcher *)watcher,
-                      WATCHER_STOP_FUNC(ev_io_stop),
-                      io_watcher_destroy,
-                      notify, user_data);
+    watcher = add_watcher(MILTER_LIBEV_EVENT_LOOP(loop),
+                          WATCHER_STOP_FUNC(ev_io_stop),
+                          notify, user_data);
+    if (!watcher)
+        return 0;
+    watcher->function.io.channel = channel;
+    g_io_channel_ref(watcher->function.io.channel);
+    watcher->function.io.function = function;
 
-    ev_io_init(watcher, io_func, fd, evcond_from_g_io_condition(condition));
-    ev_io_start(priv->ev_loop, watcher);
+    ev_io_init(&(watcher->ev.io), io_func, fd,
+               evcond_from_g_io_condition(condition));
+    ev_io_start(priv->ev_loop, &(watcher->ev.io));
 
-    return id;
+    return watcher->id;
 }
 
-typedef struct _ChildWatcherPrivate ChildWatcherPrivate;
-struct _ChildWatcherPrivate {
-    WatcherPrivate   priv;
-    GChildWatchFunc  function;
-};
+static gboolean
+modify_io (MilterEventLoop *loop,
+           guint            id,
+           GIOCondition     condition)
+{
+    Watcher *watcher;
+    MilterLibevEventLoopPrivate *priv;
+
+    priv = MILTER_LIBEV_EVENT_LOOP_GET_PRIVATE(loop);
+
+    watcher = lookup_watcher(priv, id);
+    if (!watcher || watcher->stop_func != WATCHER_STOP_FUNC(ev_io_stop))
+        return FALSE;
+
+    ev_io_stop(priv->ev_loop, &(watcher->ev.io));
+    ev_io_set(&(watcher->ev.io), watcher->ev.io.fd,
+              evcond_from_g_io_condition(condition));
+    ev_io_start(priv->ev_loop, &(watcher->ev.io));
+
+    return TRUE;
+}
 
 static void
-child_func (struct ev_loop *loop, ev_child *watcher, int revents)
+child_func (struct ev_loop *loop, ev_child *child_watcher, int revents)
 {
-    ChildWatcherPrivate *child_watcher_priv;
-    WatcherPrivate *watcher_priv;
+    Watcher *watcher;
     MilterLibevEventLoop *milter_event_loop;
     guint id;
 
-    child_watcher_priv = watcher->data;
-    watcher_priv = WATCHER_PRIVATE(child_watcher_priv);
+    watcher = WATCHER(child_watcher);
 
-    milter_event_loop = watcher_priv->loop;
+    milter_event_loop = watcher->loop;
     MILTER_LIBEV_EVENT_LOOP_GET_PRIVATE(milter_event_loop)->n_called++;
-    id = watcher_priv->id;
-    child_watcher_priv->function((GPid)(watcher->rpid),
-                                 watcher->rstatus,
-                                 watcher_priv->user_data);
+    id = watcher->id;
+    watcher->function.child((GPid)(child_watcher->rpid),
+                            child_watcher->rstatus,
+                            watcher->user_data);
     remove_watcher(milter_event_loop, id);
 }
 
@@ -539,51 +686,37 @@ watch_child_full (MilterEventLoop *loop,
                   gpointer         data,
                   GDestroyNotify   notify)
 {
-    guint id;
-    ev_child *watcher;
-    ChildWatcherPrivate *watcher_priv;
+    Watcher *watcher;
     MilterLibevEventLoopPrivate *priv;
 
     priv = MILTER_LIBEV_EVENT_LOOP_GET_PRIVATE(loop);
 
-    watcher_priv = g_new0(ChildWatcherPrivate, 1);
-    watcher_priv->function = function;
-
-    watcher = g_new0(ev_child, 1);
-    watcher->data = watcher_priv;
-    id = add_watcher(MILTER_LIBEV_EVENT_LOOP(loop),
-                      (ev_watcher *)watcher,
-                      WATCHER_STOP_FUNC(ev_child_stop),
-                      NULL,
-                      notify, data);
+    watcher = add_watcher(MILTER_LIBEV_EVENT_LOOP(loop),
+                          WATCHER_STOP_FUNC(ev_child_stop),
+                          notify, data);
+    if (!watcher)
+        return 0;
+    watcher->function.child = function;
 
-    ev_child_init(watcher, child_func, pid, FALSE);
-    ev_child_start(priv->ev_loop, watcher);
+    ev_child_init(&(watcher->ev.child), child_func, pid, FALSE);
+    ev_child_start(priv->ev_loop, &(watcher->ev.child));
 
-    return id;
+    return watcher->id;
 }
 
-typedef struct _TimerWatcherPrivate TimerWatcherPrivate;
-struct _TimerWatcherPrivate {
-    WatcherPrivate priv;
-    GSourceFunc function;
-};
-
 static void
-timer_func (struct ev_loop *loop, ev_timer *watcher, int revents)
+timer_func (struct ev_loop *loop, ev_timer *timer_watcher, int revents)
 {
-    TimerWatcherPrivate *timer_watcher_priv;
-    WatcherPrivate *watcher_priv;
+    Watcher *watcher;
     MilterLibevEventLoop *milter_event_loop;
     guint id;
 
-    timer_watcher_priv = watcher->data;
-    watcher_priv = WATCHER_PRIVATE(timer_watcher_priv);
+    watcher = WATCHER(timer_watcher);
 
-    milter_event_loop = watcher_priv->loop;
+    milter_event_loop = watcher->loop;
     MILTER_LIBEV_EVENT_LOOP_GET_PRIVATE(milter_event_loop)->n_called++;
-    id = watcher_priv->id;
-    if (!timer_watcher_priv->function(watcher_priv->user_data)) {
+    id = watcher->id;
+    if (!watcher->function.source(watcher->user_data)) {
         remove_watcher(milter_event_loop, id);
     }
 }
@@ -596,52 +729,38 @@ add_timeout_full (MilterEventLoop *loop,
                   gpointer         data,
                   GDestroyNotify   notify)
 {
-    guint id;
-    ev_timer *watcher;
-    TimerWatcherPrivate *watcher_priv;
+    Watcher *watcher;
     MilterLibevEventLoopPrivate *priv;
 
     priv = MILTER_LIBEV_EVENT_LOOP_GET_PRIVATE(loop);
 
-    watcher_priv = g_new0(TimerWatcherPrivate, 1);
-    watcher_priv->function = function;
-
-    watcher = g_new0(ev_timer, 1);
-    watcher->data = watcher_priv;
-    id = add_watcher(MILTER_LIBEV_EVENT_LOOP(loop),
-                      (ev_watcher *)watcher,
-                      WATCHER_STOP_FUNC(ev_timer_stop),
-                      NULL,
-                      notify, data);
+    watcher = add_watcher(MILTER_LIBEV_EVENT_LOOP(loop),
+                          WATCHER_STOP_FUNC(ev_timer_stop),
+                          notify, data);
+    if (!watcher)
+        return 0;
+    watcher->function.source = function;
 
-    ev_timer_init(watcher, timer_func, interval_in_seconds, interval_in_seconds);
-    ev_timer_start(priv->ev_loop, watcher);
+    ev_timer_init(&(watcher->ev.timer), timer_func,
+                  interval_in_seconds, interval_in_seconds);
+    ev_timer_start(priv->ev_loop, &(watcher->ev.timer));
 
-    return id;
+    return watcher->id;
 }
 
-typedef struct _IdleWatcherPrivate IdleWatcherPrivate;
-struct _IdleWatcherPrivate {
-    WatcherPrivate priv;
-    GSourceFunc    function;
-};
-
-
 static void
-idle_func (struct ev_loop *loop, ev_idle *watcher, int revents)
+idle_func (struct ev_loop *loop, ev_idle *idle_watcher, int revents)
 {
-    IdleWatcherPrivate *idle_watcher_priv;
-    WatcherPrivate *watcher_priv;
+    Watcher *watcher;
     MilterLibevEventLoop *milter_event_loop;
     guint id;
 
-    idle_watcher_priv = watcher->data;
-    watcher_priv = WATCHER_PRIVATE(idle_watcher_priv);
+    watcher = WATCHER(idle_watcher);
 
-    milter_event_loop = watcher_priv->loop;
+    milter_event_loop = watcher->loop;
     MILTER_LIBEV_EVENT_LOOP_GET_PRIVATE(milter_event_loop)->n_called++;
-    id = watcher_priv->id;
-    if (!idle_watcher_priv->function(watcher_priv->user_data)) {
+    id = watcher->id;
+    if (!watcher->function.source(watcher->user_data)) {
         remove_watcher(milter_event_loop, id);
     }
 }
@@ -653,28 +772,22 @@ add_idle_full (MilterEventLoop *loop,
                gpointer         data,
                GDestroyNotify   notify)
 {
-    guint id;
-    ev_idle *watcher;
-    IdleWatcherPrivate *watcher_priv;
+    Watcher *watcher;
     MilterLibevEventLoopPrivate *priv;
 
     priv = MILTER_LIBEV_EVENT_LOOP_GET_PRIVATE(loop);
 
-    watcher_priv = g_new0(IdleWatcherPrivate, 1);
-    watcher_priv->function = function;
-
-    watcher = g_new0(ev_idle, 1);
-    watcher->data = watcher_priv;
-    id = add_watcher(MILTER_LIBEV_EVENT_LOOP(loop),
-                      (ev_watcher *)watcher,
-                      WATCHER_STOP_FUNC(ev_idle_stop),
-                      NULL,
-                      notify, data);
+    watcher = add_watcher(MILTER_LIBEV_EVENT_LOOP(loop),
+                          WATCHER_STOP_FUNC(ev_idle_stop),
+                          notify, data);
+    if (!watcher)
+        return 0;
+    watcher->function.source = function;
 
-    ev_idle_init(watcher, idle_func);
-    ev_idle_start(priv->ev_loop, watcher);
+    ev_idle_init(&(watcher->ev.idle), idle_func);
+    ev_idle_start(priv->ev_loop, &(watcher->ev.idle));
 
-    return id;
+    return watcher->id;
 }
 
 static gboolean
@@ -26,6 +26,9 @@
 #include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
+#ifdef HAVE_PTHREAD_ATFORK
+#  include <pthread.h>
+#endif
 
 #include <glib.h>
 
@@ -34,6 +37,7 @@
 #include "milter-utils.h"
 #include "milter-marshalers.h"
 #include "milter-enum-types.h"
+#include "milter-glib-compatible.h"
 
 #define DEFAULT_KEY "default"
 #define DEFAULT_LEVEL                           \
@@ -44,14 +48,15 @@
      MILTER_LOG_LEVEL_STATISTICS)
 #define DEFAULT_ITEM                            \
     (MILTER_LOG_ITEM_TIME)
+#define MAX_PENDING_WRITES 65536
 
 #define MILTER_LOGGER_GET_PRIVATE(obj)                  \
     (G_TYPE_INSTANCE_GET_PRIVATE((obj),                 \
                                  MILTER_TYPE_LOGGER,    \
                                  MilterLoggerPrivate))
 
-#define INTERNAL_INTERESTING_LOG_LEVEL                                  \
-    (milter_logger_get_interesting_level(singleton_milter_logger))
+#define INTERNAL_INTERESTING_LOG_LEVEL          \
+    (milter_logger_singleton_interesting_level)
 
 #define INTERNAL_LOG(level, format, ...) do {           \
     if (INTERNAL_INTERESTING_LOG_LEVEL & (level)) {     \
@@ -66,6 +71,13 @@
 } while (0)
 
 
+typedef enum
+{
+    MILTER_LOGGER_FATAL_NONE,
+    MILTER_LOGGER_FATAL_WARNINGS,
+    MILTER_LOGGER_FATAL_CRITICALS
+} MilterLoggerFatalMode;
+
 typedef struct _MilterLoggerPrivate	MilterLoggerPrivate;
 struct _MilterLoggerPrivate
 {
@@ -75,6 +87,21 @@ struct _MilterLoggerPrivate
     MilterLogLevelFlags interesting_level;
     gchar *path;
     FILE *output;
+    MilterLogColorize colorize;
+    MilterLoggerFatalMode fatal_mode;
+    gboolean asynchronous;
+    /* Guards write_queue and output against logging threads. */
+    GMutex *write_mutex;
+    GAsyncQueue *write_queue;
+    GThread *writer;
+};
+
+typedef struct _WriteEntry WriteEntry;
+struct _WriteEntry
+{
+    MilterLoggerWriteFunc write;
+    gchar *message;
+    gpointer user_data;
 };
 
 enum
@@ -95,6 +122,7 @@ enum
 static gint signals[LAST_SIGNAL] = {0};
 
 static MilterLogger *singleton_milter_logger = NULL;
+MilterLogLevelFlags milter_logger_singleton_interesting_level = 0;
 
 G_DEFINE_TYPE(MilterLogger, milter_logger, G_TYPE_OBJECT);
 
@@ -108,12 +136,58 @@ static void get_property   (GObject         *object,
                             GValue          *value,
                             GParamSpec      *pspec);
 
+static gboolean start_writer (MilterLoggerPrivate *priv);
+static void     stop_writer  (MilterLoggerPrivate *priv);
+
+#ifdef HAVE_PTHREAD_ATFORK
+static void
+prepare_fork (void)
+{
+    MilterLoggerPrivate *priv;
+
+    if (!singleton_milter_logger)
+        return;
+
+    priv = MILTER_LOGGER_GET_PRIVATE(singleton_milter_logger);
+    stop_writer(priv);
+    /* Don't fork while another thread is writing a log. */
+    g_mutex_lock(priv->write_mutex);
+}
+
+static void
+restart_writer_after_fork (void)
+{
+    MilterLoggerPrivate *priv;
+
+    if (!singleton_milter_logger)
+        return;
+
+    priv = MILTER_LOGGER_GET_PRIVATE(singleton_milter_logger);
+    g_mutex_unlock(priv->write_mutex);
+    if (priv->asynchronous)
+        start_writer(priv);
+}
+#endif
+
 void
 milter_logger_internal_init (void)
 {
     GError *error = NULL;
+    const gchar *asynchronous_env;
+#ifdef HAVE_PTHREAD_ATFORK
+    static gboolean atfork_registered = FALSE;
+
+    if (!atfork_registered) {
+        pthread_atfork(prepare_fork,
+                       restart_writer_after_fork,
+                       restart_writer_after_fork);
+        atfork_registered = TRUE;
+    }
+#endif
 
     singleton_milter_logger = milter_logger_new();
+    milter_logger_singleton_interesting_level =
+        milter_logger_get_interesting_level(singleton_milter_logger);
     milter_logger_connect_default_handler(singleton_milter_logger);
     if (!milter_logger_set_path(singleton_milter_logger,
                                 g_getenv("MILTER_LOG_PATH"),
@@ -139,6 +213,12 @@ milter_logger_internal_init (void)
         g_error_free(error);
         error = NULL;
     }
+    asynchronous_env = g_getenv("MILTER_LOG_ASYNCHRONOUS");
+    if (asynchronous_env &&
+        (g_ascii_strcasecmp(asynchronous_env, "yes") == 0 ||
+         g_ascii_strcasecmp(asynchronous_env, "true") == 0)) {
+        milter_logger_set_asynchronous(singleton_milter_logger, TRUE);
+    }
 }
 
 void
@@ -146,6 +226,7 @@ milter_logger_internal_quit (void)
 {
     g_object_unref(singleton_milter_logger);
     singleton_milter_logger = NULL;
+    milter_logger_singleton_interesting_level = 0;
 }
 
 static void
@@ -205,6 +286,47 @@ milter_logger_class_init (MilterLoggerClass *klass)
     g_type_class_add_private(gobject_class, sizeof(MilterLoggerPrivate));
 }
 
+static void
+update_cached_configuration (MilterLoggerPrivate *priv)
+{
+    const gchar *colorize_type;
+    const gchar *milter_debug;
+
+    priv->colorize = MILTER_LOG_COLORIZE_DEFAULT;
+    colorize_type = g_getenv("MILTER_LOG_COLORIZE");
+    if (colorize_type)
+        priv->colorize = milter_utils_enum_from_string(MILTER_TYPE_LOG_COLORIZE,
+                                                       colorize_type,
+                                                       NULL);
+    if (priv->colorize == MILTER_LOG_COLORIZE_DEFAULT) {
+        int output_fileno;
+
+        if (priv->output) {
+            output_fileno = fileno(priv->output);
+        } else {
+            output_fileno = STDOUT_FILENO;
+        }
+        if (isatty(output_fileno) &&
+            milter_utils_guess_console_color_usability()) {
+            priv->colorize = MILTER_LOG_COLORIZE_CONSOLE;
+        } else {
+            priv->colorize = MILTER_LOG_COLORIZE_NONE;
+        }
+    }
+
+    priv->fatal_mode = MILTER_LOGGER_FATAL_NONE;
+    milter_debug = g_getenv("MILTER_DEBUG");
+    if (milter_debug) {
+        if (strcmp(milter_debug, "fatal-warnings") == 0 ||
+            strcmp(milter_debug, "fatal_warnings") == 0) {
+            priv->fatal_mode = MILTER_LOGGER_FATAL_WARNINGS;
+        } else if (strcmp(milter_debug, "fatal-criticals") == 0 ||
+                   strcmp(milter_debug, "fatal_criticals") == 0) {
+            priv->fatal_mode = MILTER_LOGGER_FATAL_CRITICALS;
+        }
+    }
+}
+
 static void
 milter_logger_init (MilterLogger *logger)
 {
@@ -220,6 +342,11 @@ milter_logger_init (MilterLogger *logger)
                         GUINT_TO_POINTER(priv->interesting_level));
     priv->path = NULL;
     priv->output = NULL;
+    priv->asynchronous = FALSE;
+    priv->write_mutex = g_mutex_new();
+    priv->write_queue = NULL;
+    priv->writer = NULL;
+    update_cached_configuration(priv);
 }
 
 static void
@@ -240,6 +367,12 @@ dispose (GObject *object)
 
     priv = MILTER_LOGGER_GET_PRIVATE(object);
 
+    stop_writer(priv);
+    if (priv->write_mutex) {
+        g_mutex_free(priv->write_mutex);
+        priv->write_mutex = NULL;
+    }
+
     if (priv->interesting_levels) {
         g_hash_table_unref(priv->interesting_levels);
         priv->interesting_levels = NULL;
@@ -406,32 +539,7 @@ static void
 log_message (MilterLoggerPrivate *priv, GString *log,
              MilterLogLevelFlags level, const gchar *message)
 {
-    const gchar *colorize_type;
-    MilterLogColorize colorize = MILTER_LOG_COLORIZE_DEFAULT;
-
-    colorize_type = g_getenv("MILTER_LOG_COLORIZE");
-    if (colorize_type)
-        colorize = milter_utils_enum_from_string(MILTER_TYPE_LOG_COLORIZE,
-                                                 colorize_type,
-                                                 NULL);
-
-    if (colorize == MILTER_LOG_COLORIZE_DEFAULT) {
-        int output_fileno;
-
-        if (priv->output) {
-            output_fileno = fileno(priv->output);
-        } else {
-            output_fileno = STDOUT_FILENO;
-        }
-        if (isatty(output_fileno) &&
-            milter_utils_guess_console_color_usability()) {
-            colorize = MILTER_LOG_COLORIZE_CONSOLE;
-        } else {
-            colorize = MILTER_LOG_COLORIZE_NONE;
-        }
-    }
-
-    switch (colorize) {
+    switch (priv->colorize) {
       case MILTER_LOG_COLORIZE_CONSOLE:
         log_message_colorize_console(log, level, message);
         break;
@@ -442,26 +550,32 @@ log_message (MilterLoggerPrivate *priv, GString *log,
 }
 
 static inline void
-check_milter_debug (MilterLogLevelFlags level)
+check_milter_debug (MilterLoggerPrivate *priv, MilterLogLevelFlags level)
 {
+    if (priv->fatal_mode == MILTER_LOGGER_FATAL_NONE)
+        return;
+
     if (MILTER_LOG_LEVEL_CRITICAL <= level &&
         level <= MILTER_LOG_LEVEL_WARNING) {
-        const gchar *milter_debug;
-
-        milter_debug = g_getenv("MILTER_DEBUG");
-        if (!milter_debug)
-            return;
-
-        if (strcmp(milter_debug, "fatal-warnings") == 0 ||
-            strcmp(milter_debug, "fatal_warnings") == 0) {
+        if (priv->fatal_mode == MILTER_LOGGER_FATAL_WARNINGS)
             abort();
-        }
 
         if (level == MILTER_LOG_LEVEL_CRITICAL &&
-            (strcmp(milter_debug, "fatal-criticals") == 0 ||
-             strcmp(milter_debug, "fatal_criticals") == 0)) {
+            priv->fatal_mode == MILTER_LOGGER_FATAL_CRITICALS)
             abort();
-        }
+    }
+}
+
+static void
+write_output (const gchar *message, gpointer user_data)
+{
+    MilterLoggerPrivate *priv = user_data;
+
+    if (priv->output) {
+        fputs(message, priv->output);
+        fflush(priv->output);
+    } else {
+        g_print("%s", message);
     }
 }
 
@@ -483,7 +597,7 @@ milter_logger_default_log_handler (MilterLogger *logger, const gchar *domain,
     if (!(level & target_level))
         return;
 
-    check_milter_debug(level);
+    check_milter_debug(priv, level);
 
     log = g_string_new(NULL);
 
@@ -544,13 +658,7 @@ milter_logger_default_log_handler (MilterLogger *logger, const gchar *domain,
 
     log_message(priv, log, level, message);
     g_string_append(log, "\n");
-    if (priv->output) {
-        fputs(log->str, priv->output);
-        fflush(priv->output);
-    } else {
-        g_print("%s", log->str);
-    }
-    g_string_free(log, TRUE);
+    milter_logger_write(logger, write_output, g_string_free(log, FALSE), priv);
 }
 
 MilterLogger *
@@ -597,6 +705,144 @@ milter_logger_log_va_list (MilterLogger *logger,
     g_free(message);
 }
 
+static void
+free_write_entry (WriteEntry *entry)
+{
+    g_free(entry->message);
+    g_slice_free(WriteEntry, entry);
+}
+
+static gpointer
+writer_thread (gpointer data)
+{
+    GAsyncQueue *queue = data;
+
+    while (TRUE) {
+        WriteEntry *entry;
+        gboolean stop;
+
+        entry = g_async_queue_pop(queue);
+        stop = (entry->write == NULL);
+        if (!stop)
+            entry->write(entry->message, entry->user_data);
+        free_write_entry(entry);
+        if (stop)
+            break;
+    }
+
+    return NULL;
+}
+
+static gboolean
+start_writer (MilterLoggerPrivate *priv)
+{
+    GAsyncQueue *queue;
+    GError *error = NULL;
+
+    if (priv->writer)
+        return TRUE;
+
+    queue = g_async_queue_new();
+    priv->writer = g_thread_try_new("milter-logger-writer",
+                                    writer_thread, queue,
+                                    &error);
+    if (!priv->writer) {
+        g_async_queue_unref(queue);
+        INTERNAL_LOG(MILTER_LOG_LEVEL_WARNING,
+                     "[logger][writer][start][error] %s", error->message);
+        g_error_free(error);
+        return FALSE;
+    }
+
+    g_mutex_lock(priv->write_mutex);
+    priv->write_queue = queue;
+    g_mutex_unlock(priv->write_mutex);
+
+    return TRUE;
+}
+
+static void
+stop_writer (MilterLoggerPrivate *priv)
+{
+    GAsyncQueue *queue;
+    WriteEntry *entry;
+
+    if (!priv->writer)
+        return;
+
+    /* Other threads may be logging. Entries pushed before the
+     * swap are written before the stop entry. */
+    g_mutex_lock(priv->write_mutex);
+    queue = priv->write_queue;
+    priv->write_queue = NULL;
+    g_mutex_unlock(priv->write_mutex);
+
+    entry = g_slice_new0(WriteEntry);
+    g_async_queue_push(queue, entry);
+    g_thread_join(priv->writer);
+    priv->writer = NULL;
+    g_async_queue_unref(queue);
+}
+
+void
+milter_logger_write (MilterLogger *logger,
+                     MilterLoggerWriteFunc write,
+                     gchar *message,
+                     gpointer user_data)
+{
+    MilterLoggerPrivate *priv;
+    WriteEntry *entry;
+
+    priv = MILTER_LOGGER_GET_PRIVATE(logger);
+    g_mutex_lock(priv->write_mutex);
+    if (!priv->write_queue ||
+        g_async_queue_length(priv->write_queue) >= MAX_PENDING_WRITES) {
+        write(message, user_data);
+        g_mutex_unlock(priv->write_mutex);
+        g_free(message);
+        return;
+    }
+
+    entry = g_slice_new(WriteEntry);
+    entry->write = write;
+    entry->message = message;
+    entry->user_data = user_data;
+    g_async_queue_push(priv->write_queue, entry);
+    g_mutex_unlock(priv->write_mutex);
+}
+
+gboolean
+milter_logger_is_asynchronous (MilterLogger *logger)
+{
+    return MILTER_LOGGER_GET_PRIVATE(logger)->asynchronous;
+}
+
+void
+milter_logger_set_asynchronous (MilterLogger *logger, gboolean asynchronous)
+{
+    MilterLoggerPrivate *priv;
+
+    priv = MILTER_LOGGER_GET_PRIVATE(logger);
+    priv->asynchronous = asynchronous;
+    if (asynchronous)
+        start_writer(priv);
+    else
+        stop_writer(priv);
+}
+
+void
+milter_logger_flush (MilterLogger *logger)
+{
+    MilterLoggerPrivate *priv;
+
+    priv = MILTER_LOGGER_GET_PRIVATE(logger);
+    if (!priv->writer)
+        return;
+
+    stop_writer(priv);
+    start_writer(priv);
+}
+
 void
 milter_logger_reopen (MilterLogger *logger)
 {
@@ -604,18 +850,26 @@ milter_logger_reopen (MilterLogger *logger)
 
     priv = MILTER_LOGGER_GET_PRIVATE(logger);
 
-    if (!priv->path)
+    if (!priv->path) {
+        update_cached_configuration(priv);
         return;
+    }
 
     milter_info("[logger][reopen][close]");
+    stop_writer(priv);
+    g_mutex_lock(priv->write_mutex);
     fclose(priv->output);
     priv->output = fopen(priv->path, "a");
+    g_mutex_unlock(priv->write_mutex);
     if (!priv->output) {
         milter_warning("[logger][reopen][open][warning] <%s>: %s",
                        priv->path, g_strerror(errno));
         g_free(priv->path);
         priv->path = NULL;
     }
+    update_cached_configuration(priv);
+    if (priv->asynchronous)
+        start_writer(priv);
     milter_info("[logger][reopen][open]");
 }
 
@@ -697,6 +951,8 @@ milter_logger_set_interesting_level (MilterLogger *logger,
     g_hash_table_foreach(priv->interesting_levels,
                          update_interesting_level,
                          &(priv->interesting_level));
+    if (logger == singleton_milter_logger)
+        milter_logger_singleton_interesting_level = priv->interesting_level;
 }
 
 MilterLogLevelFlags
@@ -753,28 +1009,36 @@ gboolean
 milter_logger_set_path (MilterLogger *logger, const gchar *path, GError **error)
 {
     MilterLoggerPrivate *priv;
+    gboolean success = TRUE;
 
     priv = MILTER_LOGGER_GET_PRIVATE(logger);
 
+    stop_writer(priv);
+    g_mutex_lock(priv->write_mutex);
     dispose_path(priv);
 
     if (path && strcmp(path, "-") == 0)
         path = NULL;
-    if (!path)
-        return TRUE;
-
-    priv->output = fopen(path, "a");
-    if (priv->output) {
-        priv->path = g_strdup(path);
-        return TRUE;
-    } else {
-        g_set_error(error,
-                    G_FILE_ERROR,
-                    g_file_error_from_errno(errno),
-                    "failed to set log output path: <%s>: %s",
-                    path, g_strerror(errno));
-        return FALSE;
+    if (path) {
+        priv->output = fopen(path, "a");
+        if (priv->output) {
+            priv->path = g_strdup(path);
+        } else {
+            g_set_error(error,
+                        G_FILE_ERROR,
+                        g_file_error_from_errno(errno),
+                        "failed to set log output path: <%s>: %s",
+                        path, g_strerror(errno));
+            success = FALSE;
+        }
     }
+    g_mutex_unlock(priv->write_mutex);
+
+    update_cached_configuration(priv);
+    if (priv->asynchronous)
+        start_writer(priv);
+
+    return success;
 }
 
 void
@@ -802,7 +1066,7 @@ milter_glib_log_handler (const gchar         *log_domain,
     if (!logger)
         logger = milter_logger();
 
-    check_milter_debug(log_level);
+    check_milter_debug(MILTER_LOGGER_GET_PRIVATE(logger), log_level);
 
 #define LOG(level)                                              \
     milter_logger_log(logger, "glib-log",                       \
@@ -66,8 +66,13 @@ G_BEGIN_DECLS
 #define milter_get_interesting_log_level()                      \
     milter_logger_get_interesting_level(milter_logger())
 
-#define milter_need_log(level) \
-    (milter_get_interesting_log_level() & (level))
+#ifndef MILTER_LOG_COMPILED_LEVEL
+#  define MILTER_LOG_COMPILED_LEVEL MILTER_LOG_LEVEL_ALL
+#endif
+
+#define milter_need_log(level)                                  \
+    (((level) & MILTER_LOG_COMPILED_LEVEL) &&                   \
+     (milter_logger_singleton_interesting_level & (level)))
 #define milter_need_critical_log() \
     (milter_need_log(MILTER_LOG_LEVEL_CRITICAL))
 #define milter_need_error_log() \
@@ -169,6 +174,11 @@ struct _MilterLoggerClass
                  const gchar         *message);
 };
 
+extern MilterLogLevelFlags milter_logger_singleton_interesting_level;
+
+typedef void   (*MilterLoggerWriteFunc)       (const gchar         *message,
+                                               gpointer             user_data);
+
 GQuark           milter_logger_error_quark    (void);
 
 GType            milter_logger_get_type       (void) G_GNUC_CONST;
@@ -211,6 +221,17 @@ void             milter_logger_log_va_list    (MilterLogger        *logger,
 
 void             milter_logger_reopen         (MilterLogger        *logger);
 
+void             milter_logger_write          (MilterLogger        *logger,
+                                               MilterLoggerWriteFunc write,
+                                               gchar               *message,
+                                               gpointer             user_data);
+gboolean         milter_logger_is_asynchronous
+                                              (MilterLogger        *logger);
+void             milter_logger_set_asynchronous
+                                              (MilterLogger        *logger,
+                                               gboolean             asynchronous);
+void             milter_logger_flush          (MilterLogger        *logger);
+
 MilterLogLevelFlags
                  milter_logger_get_target_level
                                               (MilterLogger        *logger);
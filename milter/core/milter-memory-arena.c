@@ -0,0 +1,230 @@
+/* -*- Mode: C; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+/*
+ *  Copyright (C) 2026  Kouhei Sutou <kou@clear-code.com>
+ *
+ *  This library is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with this library.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifdef HAVE_CONFIG_H
+#  include "../../config.h"
+#endif /* HAVE_CONFIG_H */
+
+#include <string.h>
+
+#include "milter-memory-arena.h"
+
+#define DEFAULT_BLOCK_SIZE 4096
+#define ALIGNMENT (2 * sizeof(gpointer))
+#define ALIGN(size) (((size) + ALIGNMENT - 1) & ~(ALIGNMENT - 1))
+
+typedef struct _Block Block;
+struct _Block
+{
+    Block *next;
+    gsize size;
+    gsize used;
+};
+
+#define BLOCK_HEADER_SIZE ALIGN(sizeof(Block))
+#define BLOCK_DATA(block) (((guint8 *)(block)) + BLOCK_HEADER_SIZE)
+
+struct _MilterMemoryArena
+{
+    gsize block_size;
+    Block *blocks;
+    GSList *malloced;
+    gsize used_size;
+};
+
+static gboolean use_malloc = FALSE;
+
+void
+milter_memory_arena_set_use_malloc (gboolean use)
+{
+    use_malloc = use;
+}
+
+gboolean
+milter_memory_arena_get_use_malloc (void)
+{
+    return use_malloc;
+}
+
+static Block *
+block_new (gsize size)
+{
+    Block *block;
+
+    block = g_malloc(BLOCK_HEADER_SIZE + size);
+    block->next = NULL;
+    block->size = size;
+    block->used = 0;
+
+    return block;
+}
+
+MilterMemoryArena *
+milter_memory_arena_new (gsize block_size)
+{
+    MilterMemoryArena *arena;
+
+    arena = g_new(MilterMemoryArena, 1);
+    arena->block_size = ALIGN(block_size > 0 ? block_size : DEFAULT_BLOCK_SIZE);
+    arena->blocks = NULL;
+    arena->malloced = NULL;
+    arena->used_size = 0;
+
+    return arena;
+}
+
+static void
+free_blocks (Block *block)
+{
+    while (block) {
+        Block *next = block->next;
+        g_free(block);
+        block = next;
+    }
+}
+
+static void
+free_malloced (MilterMemoryArena *arena)
+{
+    g_slist_foreach(arena->malloced, (GFunc)g_free, NULL);
+    g_slist_free(arena->malloced);
+    arena->malloced = NULL;
+}
+
+void
+milter_memory_arena_free (MilterMemoryArena *arena)
+{
+    if (!arena)
+        return;
+
+    free_blocks(arena->blocks);
+    free_malloced(arena);
+    g_free(arena);
+}
+
+void
+milter_memory_arena_reset (MilterMemoryArena *arena)
+{
+    Block *first;
+
+    free_malloced(arena);
+    arena->used_size = 0;
+
+    first = arena->blocks;
+    if (!first)
+        return;
+
+    /* Keep only a normal sized block. Large ones are rare. */
+    while (first && first->size != arena->block_size) {
+        Block *next = first->next;
+        g_free(first);
+        first = next;
+    }
+    if (first) {
+        free_blocks(first->next);
+        first->next = NULL;
+        first->used = 0;
+    }
+    arena->blocks = first;
+}
+
+gpointer
+milter_memory_arena_alloc (MilterMemoryArena *arena, gsize size)
+{
+    Block *block;
+    gpointer memory;
+
+    arena->used_size += size;
+
+    if (use_malloc) {
+        memory = g_malloc(size > 0 ? size : 1);
+        arena->malloced = g_slist_prepend(arena->malloced, memory);
+        return memory;
+    }
+
+    size = ALIGN(size > 0 ? size : 1);
+    block = arena->blocks;
+    if (!block || block->size - block->used < size) {
+        if (size > arena->block_size / 4) {
+            /* Don't waste the rest of the current block. */
+            block = block_new(size);
+            if (arena->blocks) {
+                block->next = arena->blocks->next;
+                arena->blocks->next = block;
+            } else {
+                arena->blocks = block;
+            }
+        } else {
+            block = block_new(arena->block_size);
+            block->next = arena->blocks;
+            arena->blocks = block;
+        }
+    }
+
+    memory = BLOCK_DATA(block) + block->used;
+    block->used += size;
+
+    return memory;
+}
+
+gpointer
+milter_memory_arena_alloc0 (MilterMemoryArena *arena, gsize size)
+{
+    gpointer memory;
+
+    memory = milter_memory_arena_alloc(arena, size);
+    memset(memory, 0, size);
+
+    return memory;
+}
+
+gchar *
+milter_memory_arena_strndup (MilterMemoryArena *arena,
+                             const gchar *string, gsize length)
+{
+    gchar *copied;
+
+    if (!string)
+        return NULL;
+
+    copied = milter_memory_arena_alloc(arena, length + 1);
+    strncpy(copied, string, length);
+    copied[length] = '\0';
+
+    return copied;
+}
+
+gchar *
+milter_memory_arena_strdup (MilterMemoryArena *arena, const gchar *string)
+{
+    if (!string)
+        return NULL;
+
+    return milter_memory_arena_strndup(arena, string, strlen(string));
+}
+
+gsize
+milter_memory_arena_get_used_size (MilterMemoryArena *arena)
+{
+    return arena->used_size;
+}
+
+/*
+vi:ts=4:nowrap:ai:expandtab:sw=4
+*/
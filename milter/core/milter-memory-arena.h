@@ -0,0 +1,106 @@
+/* -*- Mode: C; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+/*
+ *  Copyright (C) 2026  Kouhei Sutou <kou@clear-code.com>
+ *
+ *  This library is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with this library.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef __MILTER_MEMORY_ARENA_H__
+#define __MILTER_MEMORY_ARENA_H__
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+/**
+ * SECTION: milter-memory-arena
+ * @title: MilterMemoryArena
+ * @short_description: Bump allocator for message scoped data.
+ *
+ * The %MilterMemoryArena allocates many small objects
+ * from large blocks and releases them at once by
+ * milter_memory_arena_reset(). Objects allocated from an
+ * arena must not be freed individually.
+ *
+ * When MILTER_MEMORY_ARENA environment variable is set
+ * to "malloc", each allocation uses g_malloc() instead
+ * so that memory checkers such as valgrind can track
+ * each object.
+ */
+
+typedef struct _MilterMemoryArena MilterMemoryArena;
+
+/**
+ * milter_memory_arena_new:
+ * @block_size: the size of a block. 0 means the default size.
+ *
+ * Creates a new arena.
+ *
+ * Returns: a new %MilterMemoryArena.
+ */
+MilterMemoryArena *milter_memory_arena_new     (gsize block_size);
+
+/**
+ * milter_memory_arena_free:
+ * @arena: a %MilterMemoryArena.
+ *
+ * Frees @arena and all objects allocated from it.
+ */
+void               milter_memory_arena_free    (MilterMemoryArena *arena);
+
+/**
+ * milter_memory_arena_reset:
+ * @arena: a %MilterMemoryArena.
+ *
+ * Releases all objects allocated from @arena. The first
+ * block is kept for reuse.
+ */
+void               milter_memory_arena_reset   (MilterMemoryArena *arena);
+
+gpointer           milter_memory_arena_alloc   (MilterMemoryArena *arena,
+                                                gsize              size);
+gpointer           milter_memory_arena_alloc0  (MilterMemoryArena *arena,
+                                                gsize              size);
+gchar             *milter_memory_arena_strdup  (MilterMemoryArena *arena,
+                                                const gchar       *string);
+gchar             *milter_memory_arena_strndup (MilterMemoryArena *arena,
+                                                const gchar       *string,
+                                                gsize              length);
+
+/**
+ * milter_memory_arena_get_used_size:
+ * @arena: a %MilterMemoryArena.
+ *
+ * Returns: the number of bytes allocated from @arena
+ *          since the last reset.
+ */
+gsize              milter_memory_arena_get_used_size
+                                               (MilterMemoryArena *arena);
+
+void               milter_memory_arena_set_use_malloc
+                                               (gboolean           use_malloc);
+gboolean           milter_memory_arena_get_use_malloc
+                                               (void);
+
+#define milter_memory_arena_new0(arena, struct_type)                    \
+    ((struct_type *)milter_memory_arena_alloc0((arena), sizeof(struct_type)))
+
+G_END_DECLS
+
+#endif /* __MILTER_MEMORY_ARENA_H__ */
+
+/*
+vi:ts=4:nowrap:ai:expandtab:sw=4
+*/
@@ -25,6 +25,7 @@
 #include <stdlib.h>
 
 #include "milter-protocol-agent.h"
+#include "milter-memory-arena.h"
 #include "milter-marshalers.h"
 #include "milter-enum-types.h"
 #include "milter-utils.h"
@@ -35,19 +36,12 @@
                                  MILTER_TYPE_PROTOCOL_AGENT,            \
                                  MilterProtocolAgentPrivate))
 
-typedef struct _MilterProtocolAgentPrivate	MilterProtocolAgentPrivate;
-struct _MilterProtocolAgentPrivate
+typedef struct _MacroLayer MacroLayer;
+struct _MacroLayer
 {
     GHashTable *macros;
-    GHashTable *available_macros;
-    MilterCommand macro_context;
-    MilterMacrosRequests *macros_requests;
-};
-
-enum
-{
-    PROP_0,
-    PROP_MACRO_CONTEXT
+    gboolean shared;
+    MilterMemoryArena *arena;
 };
 
 static MilterCommand macro_search_order[] = {
@@ -63,6 +57,46 @@ static MilterCommand macro_search_order[] = {
     0,
 };
 
+#define N_SEARCH_LAYERS (G_N_ELEMENTS(macro_search_order) - 1)
+#define UNKNOWN_LAYER   N_SEARCH_LAYERS
+#define N_MACRO_LAYERS  (N_SEARCH_LAYERS + 1)
+
+static const gchar *well_known_macro_names[] = {
+    "i",
+    "j",
+    "_",
+    "v",
+    "daemon_name",
+    "if_addr",
+    "if_name",
+    "auth_authen",
+    "auth_type",
+    "auth_author",
+    "client_addr",
+    "mail_addr",
+    "rcpt_addr",
+};
+
+#define N_WELL_KNOWN_MACROS G_N_ELEMENTS(well_known_macro_names)
+
+typedef struct _MilterProtocolAgentPrivate	MilterProtocolAgentPrivate;
+struct _MilterProtocolAgentPrivate
+{
+    MacroLayer layers[N_MACRO_LAYERS];
+    GHashTable *available_macros;
+    const gchar *well_known_macro_values[N_WELL_KNOWN_MACROS];
+    guint32 resolved_well_known_macros;
+    MilterCommand macro_context;
+    MilterMacrosRequests *macros_requests;
+    MilterMemoryArena *message_macros_arena;
+};
+
+enum
+{
+    PROP_0,
+    PROP_MACRO_CONTEXT
+};
+
 G_DEFINE_ABSTRACT_TYPE(MilterProtocolAgent, milter_protocol_agent,
                        MILTER_TYPE_AGENT)
 
@@ -76,6 +110,8 @@ static void get_property   (GObject         *object,
                             guint            prop_id,
                             GValue          *value,
                             GParamSpec      *pspec);
+static gint macro_layer_index
+                           (MilterCommand    macro_context);
 
 static void
 milter_protocol_agent_class_init (MilterProtocolAgentClass *klass)
@@ -104,14 +140,23 @@ static void
 milter_protocol_agent_init (MilterProtocolAgent *agent)
 {
     MilterProtocolAgentPrivate *priv;
+    gint i;
 
     priv = MILTER_PROTOCOL_AGENT_GET_PRIVATE(agent);
-    priv->macros = g_hash_table_new_full(g_direct_hash, g_direct_equal,
-                                         NULL,
-                                         (GDestroyNotify)g_hash_table_unref);
+    memset(priv->layers, 0, sizeof(priv->layers));
     priv->available_macros = NULL;
+    priv->resolved_well_known_macros = 0;
     priv->macro_context = MILTER_COMMAND_UNKNOWN;
     priv->macros_requests = NULL;
+
+    /* Values of message scoped macros are released at once by
+     * milter_protocol_agent_clear_message_related_macros(). */
+    priv->message_macros_arena = milter_memory_arena_new(0);
+    for (i = macro_layer_index(MILTER_COMMAND_ENVELOPE_FROM);
+         i < N_SEARCH_LAYERS;
+         i++) {
+        priv->layers[i].arena = priv->message_macros_arena;
+    }
 }
 
 static void
@@ -121,18 +166,30 @@ clear_available_macros (MilterProtocolAgentPrivate *priv)
         g_hash_table_unref(priv->available_macros);
         priv->available_macros = NULL;
     }
+    priv->resolved_well_known_macros = 0;
+}
+
+static void
+macro_layer_clear (MacroLayer *layer)
+{
+    if (layer->macros) {
+        g_hash_table_unref(layer->macros);
+        layer->macros = NULL;
+    }
+    layer->shared = FALSE;
 }
 
 static void
 dispose (GObject *object)
 {
     MilterProtocolAgentPrivate *priv;
+    guint i;
 
     priv = MILTER_PROTOCOL_AGENT_GET_PRIVATE(object);
 
-    if (priv->macros) {
-        g_hash_table_unref(priv->macros);
-        priv->macros = NULL;
+    for (i = 0; i < N_MACRO_LAYERS; i++) {
+        macro_layer_clear(&(priv->layers[i]));
+        priv->layers[i].arena = NULL;
     }
 
     clear_available_macros(priv);
@@ -142,6 +199,11 @@ dispose (GObject *object)
         priv->macros_requests = NULL;
     }
 
+    if (priv->message_macros_arena) {
+        milter_memory_arena_free(priv->message_macros_arena);
+        priv->message_macros_arena = NULL;
+    }
+
     G_OBJECT_CLASS(milter_protocol_agent_parent_class)->dispose(object);
 }
 
@@ -181,27 +243,167 @@ get_property (GObject    *object,
     }
 }
 
+static gint
+macro_layer_index (MilterCommand macro_context)
+{
+    guint i;
+
+    if (macro_context == MILTER_COMMAND_UNKNOWN)
+        return UNKNOWN_LAYER;
+
+    for (i = 0; i < N_SEARCH_LAYERS; i++) {
+        if (macro_search_order[i] == macro_context)
+            return i;
+    }
+
+    return -1;
+}
+
+static MacroLayer *
+get_macro_layer (MilterProtocolAgentPrivate *priv, MilterCommand macro_context)
+{
+    gint index;
+
+    index = macro_layer_index(macro_context);
+    if (index < 0)
+        return NULL;
+    return &(priv->layers[index]);
+}
+
+static GHashTable *
+macros_new (MilterMemoryArena *arena)
+{
+    if (arena)
+        return g_hash_table_new(g_str_hash, g_str_equal);
+    else
+        return g_hash_table_new_full(g_str_hash, g_str_equal, NULL, g_free);
+}
+
+static gchar *
+macro_layer_strdup (MacroLayer *layer, const gchar *value)
+{
+    if (layer->arena)
+        return milter_memory_arena_strdup(layer->arena, value);
+    else
+        return g_strdup(value);
+}
+
+static void
+cb_copy_macro (gpointer key, gpointer value, gpointer user_data)
+{
+    MacroLayer *layer = user_data;
+    const gchar *macro_name = key;
+    const gchar *macro_value = value;
+
+    if (!macro_value)
+        return;
+
+    g_hash_table_replace(layer->macros,
+                         (gpointer)milter_utils_intern_macro_name(macro_name,
+                                                                  -1),
+                         macro_layer_strdup(layer, macro_value));
+}
+
+static GHashTable *
+ensure_writable_macros (MacroLayer *layer)
+{
+    if (!layer->macros) {
+        layer->macros = macros_new(layer->arena);
+    } else if (layer->shared) {
+        GHashTable *shared_macros = layer->macros;
+
+        layer->macros = macros_new(layer->arena);
+        g_hash_table_foreach(shared_macros, cb_copy_macro, layer);
+        g_hash_table_unref(shared_macros);
+        layer->shared = FALSE;
+    }
+    return layer->macros;
+}
+
+static const gchar *
+lookup_macro (MilterProtocolAgentPrivate *priv, const gchar *name)
+{
+    gint i, last;
+
+    last = macro_layer_index(priv->macro_context);
+    if (last < 0 || last == UNKNOWN_LAYER)
+        last = N_SEARCH_LAYERS - 1;
+
+    for (i = last; i >= 0; i--) {
+        GHashTable *macros = priv->layers[i].macros;
+        const gchar *value;
+
+        if (!macros)
+            continue;
+        value = g_hash_table_lookup(macros, name);
+        if (value)
+            return value;
+    }
+
+    return NULL;
+}
+
+static gint
+well_known_macro_index (const gchar *name, gsize length)
+{
+    guint i;
+
+    for (i = 0; i < N_WELL_KNOWN_MACROS; i++) {
+        const gchar *well_known_name = well_known_macro_names[i];
+
+        if (well_known_name[0] == name[0] &&
+            strncmp(well_known_name, name, length) == 0 &&
+            well_known_name[length] == '\0')
+            return i;
+    }
+
+    return -1;
+}
+
 const gchar *
 milter_protocol_agent_get_macro (MilterProtocolAgent *agent, const gchar *name)
 {
-    GHashTable *available_macros;
-    gchar *value;
+    MilterProtocolAgentPrivate *priv;
+    gchar buffer[256];
+    gchar *normalized_name = NULL;
+    const gchar *lookup_name;
+    const gchar *value;
+    gsize length;
+    gint index;
 
     if (!name)
         return NULL;
 
-    available_macros = milter_protocol_agent_get_available_macros(agent);
-    value = g_hash_table_lookup(available_macros, name);
-    if (!value) {
-        gchar *unbracket_name = NULL;
+    priv = MILTER_PROTOCOL_AGENT_GET_PRIVATE(agent);
+
+    lookup_name = name;
+    length = strlen(name);
+    if (length >= 2 && name[0] == '{' && name[length - 1] == '}') {
+        length -= 2;
+        if (length < sizeof(buffer)) {
+            memcpy(buffer, name + 1, length);
+            buffer[length] = '\0';
+            lookup_name = buffer;
+        } else {
+            normalized_name = g_strndup(name + 1, length);
+            lookup_name = normalized_name;
+        }
+    }
 
-        if (g_str_has_prefix(name, "{") && g_str_has_suffix(name, "}")) {
-            unbracket_name = g_strndup(name + 1, strlen(name) - 2);
-            value = g_hash_table_lookup(available_macros, unbracket_name);
-            g_free(unbracket_name);
+    index = well_known_macro_index(lookup_name, length);
+    if (index >= 0) {
+        if (!(priv->resolved_well_known_macros & (1 << index))) {
+            priv->well_known_macro_values[index] =
+                lookup_macro(priv, well_known_macro_names[index]);
+            priv->resolved_well_known_macros |= (1 << index);
         }
+        value = priv->well_known_macro_values[index];
+    } else {
+        value = lookup_macro(priv, lookup_name);
     }
 
+    g_free(normalized_name);
+
     return value;
 }
 
@@ -209,27 +411,28 @@ GHashTable *
 milter_protocol_agent_get_available_macros (MilterProtocolAgent *agent)
 {
     MilterProtocolAgentPrivate *priv;
+    MacroLayer available_layer;
     gint i;
 
     priv = MILTER_PROTOCOL_AGENT_GET_PRIVATE(agent);
     if (priv->available_macros)
         return priv->available_macros;
 
-    priv->available_macros = g_hash_table_new_full(g_str_hash, g_str_equal,
-                                                   g_free, g_free);
+    memset(&available_layer, 0, sizeof(available_layer));
+    available_layer.macros = macros_new(NULL);
     for (i = 0; macro_search_order[i] != 0; i++) {
         GHashTable *macros;
         MilterCommand context;
 
         context = macro_search_order[i];
 
-        macros = g_hash_table_lookup(priv->macros, GINT_TO_POINTER(context));
+        macros = priv->layers[i].macros;
         if (macros)
-            milter_utils_merge_hash_string_string(priv->available_macros,
-                                                  macros);
+            g_hash_table_foreach(macros, cb_copy_macro, &available_layer);
         if (context == priv->macro_context)
             break;
     }
+    priv->available_macros = available_layer.macros;
 
     return priv->available_macros;
 
@@ -239,10 +442,13 @@ GHashTable *
 milter_protocol_agent_get_macros (MilterProtocolAgent *agent)
 {
     MilterProtocolAgentPrivate *priv;
+    MacroLayer *layer;
 
     priv = MILTER_PROTOCOL_AGENT_GET_PRIVATE(agent);
-    return g_hash_table_lookup(priv->macros,
-                               GINT_TO_POINTER(priv->macro_context));
+    layer = get_macro_layer(priv, priv->macro_context);
+    if (!layer)
+        return NULL;
+    return layer->macros;
 }
 
 void
@@ -250,9 +456,12 @@ milter_protocol_agent_clear_macros (MilterProtocolAgent *agent,
                                     MilterCommand macro_context)
 {
     MilterProtocolAgentPrivate *priv;
+    MacroLayer *layer;
 
     priv = MILTER_PROTOCOL_AGENT_GET_PRIVATE(agent);
-    g_hash_table_remove(priv->macros, GINT_TO_POINTER(macro_context));
+    layer = get_macro_layer(priv, macro_context);
+    if (layer)
+        macro_layer_clear(layer);
     clear_available_macros(priv);
 }
 
@@ -263,8 +472,7 @@ milter_protocol_agent_clear_message_related_macros (MilterProtocolAgent *agent)
 
     priv = MILTER_PROTOCOL_AGENT_GET_PRIVATE(agent);
 #define CLEAR_MACRO(command)                                            \
-    g_hash_table_remove(priv->macros,                                   \
-                        GINT_TO_POINTER(MILTER_COMMAND_ ## command))
+    macro_layer_clear(get_macro_layer(priv, MILTER_COMMAND_ ## command))
 
     CLEAR_MACRO(ENVELOPE_FROM);
     CLEAR_MACRO(ENVELOPE_RECIPIENT);
@@ -276,32 +484,22 @@ milter_protocol_agent_clear_message_related_macros (MilterProtocolAgent *agent)
 
 #undef CLEAR_MACRO
     clear_available_macros(priv);
+    if (priv->message_macros_arena)
+        milter_memory_arena_reset(priv->message_macros_arena);
 }
 
 static void
-update_macro (GHashTable *macros, const gchar *name, const gchar *value)
+update_macro (MacroLayer *layer, const gchar *name, const gchar *value)
 {
+    const gchar *interned_name;
+
+    interned_name = milter_utils_intern_macro_name(name, -1);
     if (value) {
-        g_hash_table_replace(macros, g_strdup(name), g_strdup(value));
+        g_hash_table_replace(layer->macros, (gpointer)interned_name,
+                             macro_layer_strdup(layer, value));
     } else {
-        g_hash_table_remove(macros, name);
-    }
-}
-
-static GHashTable *
-ensure_macros (MilterProtocolAgentPrivate *priv, MilterCommand macro_context)
-{
-    GHashTable *macros;
-
-    macros = g_hash_table_lookup(priv->macros, GINT_TO_POINTER(macro_context));
-    if (!macros) {
-        macros = g_hash_table_new_full(g_str_hash, g_str_equal,
-                                       g_free, g_free);
-        g_hash_table_insert(priv->macros,
-                            GINT_TO_POINTER(macro_context),
-                            macros);
+        g_hash_table_remove(layer->macros, interned_name);
     }
-    return macros;
 }
 
 void
@@ -311,6 +509,8 @@ milter_protocol_agent_set_macro_context (MilterProtocolAgent *agent,
     MilterProtocolAgentPrivate *priv;
 
     priv = MILTER_PROTOCOL_AGENT_GET_PRIVATE(agent);
+    if (priv->macro_context == macro_context)
+        return;
     priv->macro_context = macro_context;
     clear_available_macros(priv);
 }
@@ -322,18 +522,22 @@ milter_protocol_agent_set_macros_valist (MilterProtocolAgent *agent,
                                          va_list var_args)
 {
     const gchar *name;
-    GHashTable *macros;
+    MacroLayer *layer;
     MilterProtocolAgentPrivate *priv;
 
     priv = MILTER_PROTOCOL_AGENT_GET_PRIVATE(agent);
-    macros = ensure_macros(priv, macro_context);
+    layer = get_macro_layer(priv, macro_context);
+    if (!layer)
+        return;
+    ensure_writable_macros(layer);
     name = macro_name;
     while (name) {
         const gchar *value;
         value = va_arg(var_args, gchar *);
-        update_macro(macros, name, value);
+        update_macro(layer, name, value);
         name = va_arg(var_args, gchar *);
     }
+    clear_available_macros(priv);
 }
 
 void
@@ -350,34 +554,40 @@ milter_protocol_agent_set_macros (MilterProtocolAgent *agent,
     va_end(var_args);
 }
 
-static void
-cb_copy_macro (gpointer key, gpointer value, gpointer user_data)
+void
+milter_protocol_agent_set_macros_hash_table (MilterProtocolAgent *agent,
+                                             MilterCommand macro_context,
+                                             GHashTable *macros)
 {
-    GHashTable *macros = user_data;
-    const gchar *macro_name = key;
-    const gchar *macro_value = value;
+    MilterProtocolAgentPrivate *priv;
+    MacroLayer *layer;
 
-    if (!macro_value)
+    priv = MILTER_PROTOCOL_AGENT_GET_PRIVATE(agent);
+    layer = get_macro_layer(priv, macro_context);
+    if (!layer)
         return;
-
-    g_hash_table_replace(macros, g_strdup(macro_name), g_strdup(macro_value));
+    macro_layer_clear(layer);
+    layer->macros = macros_new(layer->arena);
+    g_hash_table_foreach(macros, cb_copy_macro, layer);
+    clear_available_macros(priv);
 }
 
 void
-milter_protocol_agent_set_macros_hash_table (MilterProtocolAgent *agent,
-                                             MilterCommand macro_context,
-                                             GHashTable *macros)
+milter_protocol_agent_share_macros_hash_table (MilterProtocolAgent *agent,
+                                               MilterCommand macro_context,
+                                               GHashTable *macros)
 {
     MilterProtocolAgentPrivate *priv;
-    GHashTable *new_macros;
+    MacroLayer *layer;
 
     priv = MILTER_PROTOCOL_AGENT_GET_PRIVATE(agent);
-    new_macros = g_hash_table_new_full(g_str_hash, g_str_equal,
-                                       g_free, g_free);
-    g_hash_table_insert(priv->macros,
-                        GINT_TO_POINTER(macro_context),
-                        new_macros);
-    g_hash_table_foreach(macros, cb_copy_macro, new_macros);
+    layer = get_macro_layer(priv, macro_context);
+    if (!layer)
+        return;
+    g_hash_table_ref(macros);
+    macro_layer_clear(layer);
+    layer->macros = macros;
+    layer->shared = TRUE;
     clear_available_macros(priv);
 }
 
@@ -388,12 +598,15 @@ milter_protocol_agent_set_macro (MilterProtocolAgent *agent,
                                  const gchar   *macro_value)
 {
     MilterProtocolAgentPrivate *priv;
-    GHashTable *macros;
+    MacroLayer *layer;
 
     priv = MILTER_PROTOCOL_AGENT_GET_PRIVATE(agent);
 
-    macros = ensure_macros(priv, macro_context);
-    update_macro(macros, macro_name, macro_value);
+    layer = get_macro_layer(priv, macro_context);
+    if (!layer)
+        return;
+    ensure_writable_macros(layer);
+    update_macro(layer, macro_name, macro_value);
     clear_available_macros(priv);
 }
 
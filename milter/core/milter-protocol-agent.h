@@ -61,6 +61,10 @@ void                 milter_protocol_agent_set_macros_hash_table
                                                     (MilterProtocolAgent *agent,
                                                      MilterCommand  macro_context,
                                                      GHashTable    *macros);
+void                 milter_protocol_agent_share_macros_hash_table
+                                                    (MilterProtocolAgent *agent,
+                                                     MilterCommand  macro_context,
+                                                     GHashTable    *macros);
 void                 milter_protocol_agent_set_macro(MilterProtocolAgent *agent,
                                                      MilterCommand  macro_context,
                                                      const gchar   *macro_name,
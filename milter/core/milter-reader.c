@@ -23,6 +23,8 @@
 
 #include <stdlib.h>
 #include <string.h>
+#include <errno.h>
+#include <unistd.h>
 
 #include <glib.h>
 
@@ -40,6 +42,10 @@ typedef struct _MilterReaderPrivate	MilterReaderPrivate;
 struct _MilterReaderPrivate
 {
     GIOChannel *io_channel;
+    gint fd;
+    gchar *buffer;
+    gsize buffer_size;
+    guint n_small_reads;
     MilterEventLoop *loop;
     guint read_watch_id;
     guint error_watch_id;
@@ -52,6 +58,7 @@ enum
 {
     PROP_0,
     PROP_IO_CHANNEL,
+    PROP_FD,
     PROP_TAG
 };
 
@@ -70,6 +77,7 @@ G_DEFINE_TYPE_WITH_CODE(MilterReader, milter_reader, G_TYPE_OBJECT,
     G_IMPLEMENT_INTERFACE(MILTER_TYPE_FINISHED_EMITTABLE, finished_emittable_init))
 
 static void dispose        (GObject         *object);
+static void finalize       (GObject         *object);
 static void set_property   (GObject         *object,
                             guint            prop_id,
                             const GValue    *value,
@@ -88,6 +96,7 @@ milter_reader_class_init (MilterReaderClass *klass)
     gobject_class = G_OBJECT_CLASS(klass);
 
     gobject_class->dispose      = dispose;
+    gobject_class->finalize     = finalize;
     gobject_class->set_property = set_property;
     gobject_class->get_property = get_property;
 
@@ -97,6 +106,13 @@ milter_reader_class_init (MilterReaderClass *klass)
                                 G_PARAM_READWRITE | G_PARAM_CONSTRUCT_ONLY);
     g_object_class_install_property(gobject_class, PROP_IO_CHANNEL, spec);
 
+    spec = g_param_spec_int("fd",
+                            "File descriptor",
+                            "The file descriptor of the GIOChannel",
+                            -1, G_MAXINT, -1,
+                            G_PARAM_READWRITE | G_PARAM_CONSTRUCT_ONLY);
+    g_object_class_install_property(gobject_class, PROP_FD, spec);
+
     spec = g_param_spec_uint("tag",
                              "Tag",
                              "The tag of the writer",
@@ -123,6 +139,10 @@ milter_reader_init (MilterReader *reader)
 
     priv = MILTER_READER_GET_PRIVATE(reader);
     priv->io_channel = NULL;
+    priv->fd = -1;
+    priv->buffer = NULL;
+    priv->buffer_size = 0;
+    priv->n_small_reads = 0;
     priv->loop = NULL;
     priv->read_watch_id = 0;
     priv->error_watch_id = 0;
@@ -132,6 +152,77 @@ milter_reader_init (MilterReader *reader)
 }
 
 #define BUFFER_SIZE 4096
+/* length + command + MILTER_CHUNK_SIZE body chunk */
+#define MAX_BUFFER_SIZE (sizeof(guint32) + 1 + MILTER_CHUNK_SIZE)
+/* A body stream has small commands between large body
+ * chunks. Shrink only when reads stay small for a while so
+ * that the buffer isn't reallocated on each chunk. */
+#define N_SMALL_READS_TO_SHRINK 16
+
+static void
+ensure_buffer (MilterReaderPrivate *priv)
+{
+    if (!priv->buffer) {
+        priv->buffer_size = BUFFER_SIZE;
+        priv->buffer = g_malloc(priv->buffer_size);
+    }
+}
+
+static void
+adjust_buffer_size (MilterReaderPrivate *priv, gsize length)
+{
+    gsize new_size = priv->buffer_size;
+
+    if (length == priv->buffer_size) {
+        priv->n_small_reads = 0;
+        new_size = MIN(priv->buffer_size * 2, MAX_BUFFER_SIZE);
+    } else if (length < priv->buffer_size / 4) {
+        priv->n_small_reads++;
+        if (priv->n_small_reads >= N_SMALL_READS_TO_SHRINK) {
+            priv->n_small_reads = 0;
+            new_size = MAX(priv->buffer_size / 2, BUFFER_SIZE);
+        }
+    } else {
+        priv->n_small_reads = 0;
+    }
+
+    if (new_size == priv->buffer_size)
+        return;
+
+    milter_trace("[%u] [reader][buffer][resize] "
+                 "<%" G_GSIZE_FORMAT "> -> <%" G_GSIZE_FORMAT ">",
+                 priv->tag, priv->buffer_size, new_size);
+    g_free(priv->buffer);
+    priv->buffer_size = new_size;
+    priv->buffer = g_malloc(priv->buffer_size);
+}
+
+static GIOStatus
+read_from_fd (MilterReaderPrivate *priv, gsize *length, GError **error)
+{
+    gssize read_size;
+
+    do {
+        read_size = read(priv->fd, priv->buffer, priv->buffer_size);
+    } while (read_size == -1 && errno == EINTR);
+
+    if (read_size == -1) {
+        *length = 0;
+        if (errno == EAGAIN || errno == EWOULDBLOCK)
+            return G_IO_STATUS_AGAIN;
+        g_set_error(error,
+                    G_IO_CHANNEL_ERROR,
+                    g_io_channel_error_from_errno(errno),
+                    "%s", g_strerror(errno));
+        return G_IO_STATUS_ERROR;
+    }
+
+    *length = read_size;
+    if (read_size == 0)
+        return G_IO_STATUS_EOF;
+    return G_IO_STATUS_NORMAL;
+}
+
 static gboolean
 read_from_channel (MilterReader *reader, GIOChannel *channel)
 {
@@ -139,14 +230,18 @@ read_from_channel (MilterReader *reader, GIOChannel *channel)
     gboolean error_occurred = FALSE;
     gboolean eof = FALSE;
     GIOStatus status;
-    gchar stream[BUFFER_SIZE + 1];
     gsize length = 0;
     GError *io_error = NULL;
 
     priv = MILTER_READER_GET_PRIVATE(reader);
 
-    status = g_io_channel_read_chars(channel, stream, BUFFER_SIZE,
-                                     &length, &io_error);
+    ensure_buffer(priv);
+    if (priv->fd == -1)
+        status = g_io_channel_read_chars(channel,
+                                         priv->buffer, priv->buffer_size,
+                                         &length, &io_error);
+    else
+        status = read_from_fd(priv, &length, &io_error);
     if (status == G_IO_STATUS_EOF) {
         milter_trace("[%u] [reader][eof]", priv->tag);
         eof = TRUE;
@@ -177,7 +272,8 @@ read_from_channel (MilterReader *reader, GIOChannel *channel)
                          priv->tag, length,
                          (condition & G_IO_IN) ? "contain" : "empty");
         }
-        g_signal_emit(reader, signals[FLOW], 0, stream, length);
+        g_signal_emit(reader, signals[FLOW], 0, priv->buffer, length);
+        adjust_buffer_size(priv, length);
     }
 
     return !error_occurred && !eof;
@@ -364,6 +460,19 @@ dispose (GObject *object)
     G_OBJECT_CLASS(milter_reader_parent_class)->dispose(object);
 }
 
+static void
+finalize (GObject *object)
+{
+    MilterReaderPrivate *priv;
+
+    priv = MILTER_READER_GET_PRIVATE(object);
+
+    if (priv->buffer)
+        g_free(priv->buffer);
+
+    G_OBJECT_CLASS(milter_reader_parent_class)->finalize(object);
+}
+
 static void
 set_property (GObject      *object,
               guint         prop_id,
@@ -379,6 +488,9 @@ set_property (GObject      *object,
         if (priv->io_channel)
             g_io_channel_ref(priv->io_channel);
         break;
+    case PROP_FD:
+        priv->fd = g_value_get_int(value);
+        break;
     case PROP_TAG:
         milter_reader_set_tag(MILTER_READER(object), g_value_get_uint(value));
         break;
@@ -401,6 +513,9 @@ get_property (GObject    *object,
     case PROP_IO_CHANNEL:
         g_value_set_pointer(value, priv->io_channel);
         break;
+    case PROP_FD:
+        g_value_set_int(value, priv->fd);
+        break;
     case PROP_TAG:
         g_value_set_uint(value, priv->tag);
         break;
@@ -424,6 +539,15 @@ milter_reader_io_channel_new (GIOChannel *channel)
                         NULL);
 }
 
+MilterReader *
+milter_reader_unix_io_channel_new (GIOChannel *channel)
+{
+    return g_object_new(MILTER_TYPE_READER,
+                        "io-channel", channel,
+                        "fd", g_io_channel_unix_get_fd(channel),
+                        NULL);
+}
+
 void
 milter_reader_start (MilterReader *reader, MilterEventLoop *loop)
 {
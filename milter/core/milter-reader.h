@@ -67,6 +67,8 @@ GQuark           milter_reader_error_quark    (void);
 GType            milter_reader_get_type       (void) G_GNUC_CONST;
 
 MilterReader    *milter_reader_io_channel_new (GIOChannel       *channel);
+MilterReader    *milter_reader_unix_io_channel_new
+                                              (GIOChannel       *channel);
 
 void             milter_reader_start          (MilterReader     *reader,
                                                MilterEventLoop  *loop);
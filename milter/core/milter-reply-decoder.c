@@ -35,6 +35,18 @@
 #include "milter-utils.h"
 #include "milter-logger.h"
 
+#define MILTER_REPLY_DECODER_GET_PRIVATE(obj)                  \
+    (G_TYPE_INSTANCE_GET_PRIVATE((obj),                         \
+                                 MILTER_TYPE_REPLY_DECODER,     \
+                                 MilterReplyDecoderPrivate))
+
+typedef struct _MilterReplyDecoderPrivate MilterReplyDecoderPrivate;
+struct _MilterReplyDecoderPrivate
+{
+    const MilterReplyHandlers *handlers;
+    gpointer handlers_data;
+};
+
 MILTER_IMPLEMENT_REPLY_SIGNALS(reply_init)
 G_DEFINE_TYPE_WITH_CODE(MilterReplyDecoder,
                         milter_reply_decoder,
@@ -70,11 +82,18 @@ milter_reply_decoder_class_init (MilterReplyDecoderClass *klass)
     gobject_class->get_property = get_property;
 
     decoder_class->decode = decode;
+
+    g_type_class_add_private(gobject_class, sizeof(MilterReplyDecoderPrivate));
 }
 
 static void
 milter_reply_decoder_init (MilterReplyDecoder *decoder)
 {
+    MilterReplyDecoderPrivate *priv;
+
+    priv = MILTER_REPLY_DECODER_GET_PRIVATE(decoder);
+    priv->handlers = NULL;
+    priv->handlers_data = NULL;
 }
 
 static void
@@ -122,9 +141,22 @@ milter_reply_decoder_new (void)
                                        NULL));
 }
 
+void
+milter_reply_decoder_set_handlers (MilterReplyDecoder        *decoder,
+                                   const MilterReplyHandlers *handlers,
+                                   gpointer                   user_data)
+{
+    MilterReplyDecoderPrivate *priv;
+
+    priv = MILTER_REPLY_DECODER_GET_PRIVATE(decoder);
+    priv->handlers = handlers;
+    priv->handlers_data = user_data;
+}
+
 static gboolean
 decode_reply_continue (MilterDecoder *decoder, GError **error)
 {
+    MilterReplyDecoderPrivate *priv = MILTER_REPLY_DECODER_GET_PRIVATE(decoder);
     const gchar *buffer;
     gint32 command_length;
 
@@ -140,7 +172,8 @@ decode_reply_continue (MilterDecoder *decoder, GError **error)
     milter_debug("[%u] [reply-decoder][continue]",
                  milter_decoder_get_tag(decoder));
 
-    g_signal_emit_by_name(decoder, "continue");
+    milter_reply_signals_emit_continue(MILTER_REPLY_SIGNALS(decoder),
+                                       priv->handlers, priv->handlers_data);
 
     return TRUE;
 }
@@ -161,6 +194,7 @@ find_space_character (const gchar *buffer, gint length)
 static gboolean
 decode_reply_reply_code (MilterDecoder *decoder, GError **error)
 {
+    MilterReplyDecoderPrivate *priv = MILTER_REPLY_DECODER_GET_PRIVATE(decoder);
     gint null_character_point;
     gint space_character_point;
     const gchar *buffer;
@@ -226,8 +260,9 @@ decode_reply_reply_code (MilterDecoder *decoder, GError **error)
                  milter_decoder_get_tag(decoder),
                  reply_code, extended_code, message);
 
-    g_signal_emit_by_name(decoder, "reply-code",
-                          reply_code, extended_code, message);
+    milter_reply_signals_emit_reply_code(MILTER_REPLY_SIGNALS(decoder),
+                                         reply_code, extended_code, message,
+                                         priv->handlers, priv->handlers_data);
 
     if (extended_code)
         g_free(extended_code);
@@ -240,6 +275,7 @@ decode_reply_reply_code (MilterDecoder *decoder, GError **error)
 static gboolean
 decode_reply_temporary_failure (MilterDecoder *decoder, GError **error)
 {
+    MilterReplyDecoderPrivate *priv = MILTER_REPLY_DECODER_GET_PRIVATE(decoder);
     const gchar *buffer;
     gint32 command_length;
 
@@ -255,7 +291,9 @@ decode_reply_temporary_failure (MilterDecoder *decoder, GError **error)
     milter_debug("[%u] [reply-decoder][temporary-failure]",
                  milter_decoder_get_tag(decoder));
 
-    g_signal_emit_by_name(decoder, "temporary-failure");
+    milter_reply_signals_emit_temporary_failure(MILTER_REPLY_SIGNALS(decoder),
+                                                priv->handlers,
+                                                priv->handlers_data);
 
     return TRUE;
 }
@@ -263,6 +301,7 @@ decode_reply_temporary_failure (MilterDecoder *decoder, GError **error)
 static gboolean
 decode_reply_reject (MilterDecoder *decoder, GError **error)
 {
+    MilterReplyDecoderPrivate *priv = MILTER_REPLY_DECODER_GET_PRIVATE(decoder);
     const gchar *buffer;
     gint32 command_length;
 
@@ -278,7 +317,8 @@ decode_reply_reject (MilterDecoder *decoder, GError **error)
     milter_debug("[%u] [reply-decoder][reject]",
                  milter_decoder_get_tag(decoder));
 
-    g_signal_emit_by_name(decoder, "reject");
+    milter_reply_signals_emit_reject(MILTER_REPLY_SIGNALS(decoder),
+                                     priv->handlers, priv->handlers_data);
 
     return TRUE;
 }
@@ -286,6 +326,7 @@ decode_reply_reject (MilterDecoder *decoder, GError **error)
 static gboolean
 decode_reply_accept (MilterDecoder *decoder, GError **error)
 {
+    MilterReplyDecoderPrivate *priv = MILTER_REPLY_DECODER_GET_PRIVATE(decoder);
     const gchar *buffer;
     gint32 command_length;
 
@@ -301,7 +342,8 @@ decode_reply_accept (MilterDecoder *decoder, GError **error)
     milter_debug("[%u] [reply-decoder][accept]",
                  milter_decoder_get_tag(decoder));
 
-    g_signal_emit_by_name(decoder, "accept");
+    milter_reply_signals_emit_accept(MILTER_REPLY_SIGNALS(decoder),
+                                     priv->handlers, priv->handlers_data);
 
     return TRUE;
 }
@@ -309,6 +351,7 @@ decode_reply_accept (MilterDecoder *decoder, GError **error)
 static gboolean
 decode_reply_discard (MilterDecoder *decoder, GError **error)
 {
+    MilterReplyDecoderPrivate *priv = MILTER_REPLY_DECODER_GET_PRIVATE(decoder);
     const gchar *buffer;
     gint32 command_length;
 
@@ -324,7 +367,8 @@ decode_reply_discard (MilterDecoder *decoder, GError **error)
     milter_debug("[%u] [reply-decoder][discard]",
                  milter_decoder_get_tag(decoder));
 
-    g_signal_emit_by_name(decoder, "discard");
+    milter_reply_signals_emit_discard(MILTER_REPLY_SIGNALS(decoder),
+                                      priv->handlers, priv->handlers_data);
 
     return TRUE;
 }
@@ -332,6 +376,7 @@ decode_reply_discard (MilterDecoder *decoder, GError **error)
 static gboolean
 decode_reply_add_header (MilterDecoder *decoder, GError **error)
 {
+    MilterReplyDecoderPrivate *priv = MILTER_REPLY_DECODER_GET_PRIVATE(decoder);
     const gchar *name = NULL, *value = NULL;
     const gchar *buffer;
     gint32 command_length;
@@ -350,7 +395,9 @@ decode_reply_add_header (MilterDecoder *decoder, GError **error)
                  milter_decoder_get_tag(decoder),
                  name, value);
 
-    g_signal_emit_by_name(decoder, "add-header", name, value);
+    milter_reply_signals_emit_add_header(MILTER_REPLY_SIGNALS(decoder), name,
+                                         value, priv->handlers,
+                                         priv->handlers_data);
 
     return TRUE;
 }
@@ -409,6 +456,7 @@ decode_header_content_with_index (const gchar *buffer, gint length,
 static gboolean
 decode_reply_insert_header (MilterDecoder *decoder, GError **error)
 {
+    MilterReplyDecoderPrivate *priv = MILTER_REPLY_DECODER_GET_PRIVATE(decoder);
     const gchar *name = NULL, *value = NULL;
     gint index = 0;
     const gchar *buffer;
@@ -427,7 +475,9 @@ decode_reply_insert_header (MilterDecoder *decoder, GError **error)
                  milter_decoder_get_tag(decoder),
                  index, name, value);
 
-    g_signal_emit_by_name(decoder, "insert-header", index, name, value);
+    milter_reply_signals_emit_insert_header(MILTER_REPLY_SIGNALS(decoder),
+                                            index, name, value, priv->handlers,
+                                            priv->handlers_data);
 
     return TRUE;
 }
@@ -435,6 +485,7 @@ decode_reply_insert_header (MilterDecoder *decoder, GError **error)
 static gboolean
 decode_reply_change_header (MilterDecoder *decoder, GError **error)
 {
+    MilterReplyDecoderPrivate *priv = MILTER_REPLY_DECODER_GET_PRIVATE(decoder);
     const gchar *name = NULL, *value = NULL;
     gint index = 0;
     const gchar *buffer;
@@ -453,12 +504,17 @@ decode_reply_change_header (MilterDecoder *decoder, GError **error)
         milter_debug("[%u] [reply-decoder][change-header] <%s>[%i]=<%s>",
                      milter_decoder_get_tag(decoder),
                      name, index, value);
-        g_signal_emit_by_name(decoder, "change-header", name, index, value);
+        milter_reply_signals_emit_change_header(MILTER_REPLY_SIGNALS(decoder),
+                                                name, index, value,
+                                                priv->handlers,
+                                                priv->handlers_data);
     } else {
         milter_debug("[%u] [reply-decoder][delete-header] <%s>[%i]",
                      milter_decoder_get_tag(decoder),
                      name, index);
-        g_signal_emit_by_name(decoder, "delete-header", name, index);
+        milter_reply_signals_emit_delete_header(MILTER_REPLY_SIGNALS(decoder),
+                                                name, index, priv->handlers,
+                                                priv->handlers_data);
     }
 
     return TRUE;
@@ -512,6 +568,7 @@ decode_two_string (const gchar *buffer, gint length,
 static gboolean
 decode_reply_change_from (MilterDecoder *decoder, GError **error)
 {
+    MilterReplyDecoderPrivate *priv = MILTER_REPLY_DECODER_GET_PRIVATE(decoder);
     const gchar *from = NULL, *parameters = NULL;
     const gchar *buffer;
     gint32 command_length;
@@ -534,7 +591,9 @@ decode_reply_change_from (MilterDecoder *decoder, GError **error)
                  from,
                  MILTER_LOG_NULL_SAFE_STRING(parameters));
 
-    g_signal_emit_by_name(decoder, "change-from", from, parameters);
+    milter_reply_signals_emit_change_from(MILTER_REPLY_SIGNALS(decoder), from,
+                                          parameters, priv->handlers,
+                                          priv->handlers_data);
 
     return TRUE;
 }
@@ -542,6 +601,7 @@ decode_reply_change_from (MilterDecoder *decoder, GError **error)
 static gboolean
 decode_reply_add_recipient (MilterDecoder *decoder, GError **error)
 {
+    MilterReplyDecoderPrivate *priv = MILTER_REPLY_DECODER_GET_PRIVATE(decoder);
     const gchar *buffer;
     gint32 command_length;
 
@@ -556,7 +616,9 @@ decode_reply_add_recipient (MilterDecoder *decoder, GError **error)
                  milter_decoder_get_tag(decoder),
                  buffer + 1);
 
-    g_signal_emit_by_name(decoder, "add-recipient", buffer + 1, NULL);
+    milter_reply_signals_emit_add_recipient(MILTER_REPLY_SIGNALS(decoder),
+                                            buffer + 1, NULL, priv->handlers,
+                                            priv->handlers_data);
 
     return TRUE;
 }
@@ -564,6 +626,7 @@ decode_reply_add_recipient (MilterDecoder *decoder, GError **error)
 static gboolean
 decode_reply_add_recipient_with_parameters (MilterDecoder *decoder, GError **error)
 {
+    MilterReplyDecoderPrivate *priv = MILTER_REPLY_DECODER_GET_PRIVATE(decoder);
     const gchar *recipient = NULL, *parameters = NULL;
     const gchar *buffer;
     gint32 command_length;
@@ -586,7 +649,10 @@ decode_reply_add_recipient_with_parameters (MilterDecoder *decoder, GError **err
                  recipient,
                  MILTER_LOG_NULL_SAFE_STRING(parameters));
 
-    g_signal_emit_by_name(decoder, "add-recipient", recipient, parameters);
+    milter_reply_signals_emit_add_recipient(MILTER_REPLY_SIGNALS(decoder),
+                                            recipient, parameters,
+                                            priv->handlers,
+                                            priv->handlers_data);
 
     return TRUE;
 }
@@ -594,6 +660,7 @@ decode_reply_add_recipient_with_parameters (MilterDecoder *decoder, GError **err
 static gboolean
 decode_reply_delete_recipient (MilterDecoder *decoder, GError **error)
 {
+    MilterReplyDecoderPrivate *priv = MILTER_REPLY_DECODER_GET_PRIVATE(decoder);
     gint null_character_point;
     const gchar *buffer;
     gint32 command_length;
@@ -612,7 +679,9 @@ decode_reply_delete_recipient (MilterDecoder *decoder, GError **error)
                  milter_decoder_get_tag(decoder),
                  buffer + 1);
 
-    g_signal_emit_by_name(decoder, "delete-recipient", buffer + 1);
+    milter_reply_signals_emit_delete_recipient(MILTER_REPLY_SIGNALS(decoder),
+                                               buffer + 1, priv->handlers,
+                                               priv->handlers_data);
 
     return TRUE;
 }
@@ -620,6 +689,7 @@ decode_reply_delete_recipient (MilterDecoder *decoder, GError **error)
 static gboolean
 decode_reply_replace_body (MilterDecoder *decoder, GError **error)
 {
+    MilterReplyDecoderPrivate *priv = MILTER_REPLY_DECODER_GET_PRIVATE(decoder);
     const gchar *buffer;
     gint32 command_length;
 
@@ -630,8 +700,10 @@ decode_reply_replace_body (MilterDecoder *decoder, GError **error)
                  milter_decoder_get_tag(decoder),
                  command_length);
 
-    g_signal_emit_by_name(decoder, "replace-body",
-                  buffer + 1, command_length - 1);
+    milter_reply_signals_emit_replace_body(MILTER_REPLY_SIGNALS(decoder),
+                                           buffer + 1, command_length - 1,
+                                           priv->handlers,
+                                           priv->handlers_data);
 
     return TRUE;
 }
@@ -639,6 +711,7 @@ decode_reply_replace_body (MilterDecoder *decoder, GError **error)
 static gboolean
 decode_reply_progress (MilterDecoder *decoder, GError **error)
 {
+    MilterReplyDecoderPrivate *priv = MILTER_REPLY_DECODER_GET_PRIVATE(decoder);
     const gchar *buffer;
     gint32 command_length;
 
@@ -654,7 +727,8 @@ decode_reply_progress (MilterDecoder *decoder, GError **error)
     milter_debug("[%u] [reply-decoder][progress]",
                  milter_decoder_get_tag(decoder));
 
-    g_signal_emit_by_name(decoder, "progress");
+    milter_reply_signals_emit_progress(MILTER_REPLY_SIGNALS(decoder),
+                                       priv->handlers, priv->handlers_data);
 
     return TRUE;
 }
@@ -662,6 +736,7 @@ decode_reply_progress (MilterDecoder *decoder, GError **error)
 static gboolean
 decode_reply_quarantine (MilterDecoder *decoder, GError **error)
 {
+    MilterReplyDecoderPrivate *priv = MILTER_REPLY_DECODER_GET_PRIVATE(decoder);
     gint null_character_point;
     const gchar *buffer;
     gint32 command_length;
@@ -680,7 +755,9 @@ decode_reply_quarantine (MilterDecoder *decoder, GError **error)
                  milter_decoder_get_tag(decoder),
                  buffer + 1);
 
-    g_signal_emit_by_name(decoder, "quarantine", buffer + 1);
+    milter_reply_signals_emit_quarantine(MILTER_REPLY_SIGNALS(decoder),
+                                         buffer + 1, priv->handlers,
+                                         priv->handlers_data);
 
     return TRUE;
 }
@@ -688,6 +765,7 @@ decode_reply_quarantine (MilterDecoder *decoder, GError **error)
 static gboolean
 decode_reply_connection_failure (MilterDecoder *decoder, GError **error)
 {
+    MilterReplyDecoderPrivate *priv = MILTER_REPLY_DECODER_GET_PRIVATE(decoder);
     const gchar *buffer;
     gint32 command_length;
 
@@ -703,7 +781,9 @@ decode_reply_connection_failure (MilterDecoder *decoder, GError **error)
     milter_debug("[%u] [reply-decoder][connection-failure]",
                  milter_decoder_get_tag(decoder));
 
-    g_signal_emit_by_name(decoder, "connection-failure");
+    milter_reply_signals_emit_connection_failure(MILTER_REPLY_SIGNALS(decoder),
+                                                 priv->handlers,
+                                                 priv->handlers_data);
 
     return TRUE;
 }
@@ -711,6 +791,7 @@ decode_reply_connection_failure (MilterDecoder *decoder, GError **error)
 static gboolean
 decode_reply_shutdown (MilterDecoder *decoder, GError **error)
 {
+    MilterReplyDecoderPrivate *priv = MILTER_REPLY_DECODER_GET_PRIVATE(decoder);
     const gchar *buffer;
     gint32 command_length;
 
@@ -726,7 +807,8 @@ decode_reply_shutdown (MilterDecoder *decoder, GError **error)
     milter_debug("[%u] [reply-decoder][shutdown]",
                  milter_decoder_get_tag(decoder));
 
-    g_signal_emit_by_name(decoder, "shutdown");
+    milter_reply_signals_emit_shutdown(MILTER_REPLY_SIGNALS(decoder),
+                                       priv->handlers, priv->handlers_data);
 
     return TRUE;
 }
@@ -734,6 +816,7 @@ decode_reply_shutdown (MilterDecoder *decoder, GError **error)
 static gboolean
 decode_reply_skip (MilterDecoder *decoder, GError **error)
 {
+    MilterReplyDecoderPrivate *priv = MILTER_REPLY_DECODER_GET_PRIVATE(decoder);
     const gchar *buffer;
     gint32 command_length;
 
@@ -749,7 +832,8 @@ decode_reply_skip (MilterDecoder *decoder, GError **error)
     milter_debug("[%u] [reply-decoder][skip]",
                  milter_decoder_get_tag(decoder));
 
-    g_signal_emit_by_name(decoder, "skip");
+    milter_reply_signals_emit_skip(MILTER_REPLY_SIGNALS(decoder),
+                                   priv->handlers, priv->handlers_data);
 
     return TRUE;
 }
@@ -822,6 +906,7 @@ decode_macros_requests (const gchar *buffer, gsize length,
 static gboolean
 decode_reply_negotiate (MilterDecoder *decoder, GError **error)
 {
+    MilterReplyDecoderPrivate *priv = MILTER_REPLY_DECODER_GET_PRIVATE(decoder);
     const gchar *buffer;
     gint32 command_length;
     MilterOption *option;
@@ -859,7 +944,10 @@ decode_reply_negotiate (MilterDecoder *decoder, GError **error)
     milter_debug("[%u] [reply-decoder][negotiate]",
                  milter_decoder_get_tag(decoder));
 
-    g_signal_emit_by_name(decoder, "negotiate-reply", option, macros_requests);
+    milter_reply_signals_emit_negotiate_reply(MILTER_REPLY_SIGNALS(decoder),
+                                              option, macros_requests,
+                                              priv->handlers,
+                                              priv->handlers_data);
     g_object_unref(option);
     if (macros_requests)
         g_object_unref(macros_requests);
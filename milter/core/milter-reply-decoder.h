@@ -62,6 +62,9 @@ GQuark         milter_reply_decoder_error_quark (void);
 GType          milter_reply_decoder_get_type          (void) G_GNUC_CONST;
 
 MilterDecoder *milter_reply_decoder_new               (void);
+void           milter_reply_decoder_set_handlers      (MilterReplyDecoder        *decoder,
+                                                       const MilterReplyHandlers *handlers,
+                                                       gpointer                   user_data);
 
 G_END_DECLS
 
@@ -281,6 +281,395 @@ milter_reply_signals_get_type (void)
     return reply_signals_type;
 }
 
+static gboolean
+has_handler (MilterReplySignals *reply, guint signal)
+{
+    return g_signal_has_handler_pending(reply, signals[signal], 0, FALSE);
+}
+
+void
+milter_reply_signals_emit_negotiate_reply (MilterReplySignals *reply,
+                                           MilterOption *option,
+                                           MilterMacrosRequests *macros_requests,
+                                           const MilterReplyHandlers *handlers,
+                                           gpointer user_data)
+{
+    if (!handlers) {
+        g_signal_emit(reply, signals[NEGOTIATE_REPLY], 0, option, macros_requests);
+        return;
+    }
+
+    g_object_ref(reply);
+    if (handlers->negotiate_reply)
+        handlers->negotiate_reply(reply, option, macros_requests, user_data);
+    if (has_handler(reply, NEGOTIATE_REPLY))
+        g_signal_emit(reply, signals[NEGOTIATE_REPLY], 0, option, macros_requests);
+    g_object_unref(reply);
+}
+
+void
+milter_reply_signals_emit_continue (MilterReplySignals *reply,
+                                    const MilterReplyHandlers *handlers,
+                                    gpointer user_data)
+{
+    if (!handlers) {
+        g_signal_emit(reply, signals[CONTINUE], 0);
+        return;
+    }
+
+    g_object_ref(reply);
+    if (handlers->_continue)
+        handlers->_continue(reply, user_data);
+    if (has_handler(reply, CONTINUE))
+        g_signal_emit(reply, signals[CONTINUE], 0);
+    g_object_unref(reply);
+}
+
+void
+milter_reply_signals_emit_reply_code (MilterReplySignals *reply,
+                                      guint code,
+                                      const gchar *extended_code,
+                                      const gchar *message,
+                                      const MilterReplyHandlers *handlers,
+                                      gpointer user_data)
+{
+    if (!handlers) {
+        g_signal_emit(reply, signals[REPLY_CODE], 0, code, extended_code, message);
+        return;
+    }
+
+    g_object_ref(reply);
+    if (handlers->reply_code)
+        handlers->reply_code(reply, code, extended_code, message, user_data);
+    if (has_handler(reply, REPLY_CODE))
+        g_signal_emit(reply, signals[REPLY_CODE], 0, code, extended_code, message);
+    g_object_unref(reply);
+}
+
+void
+milter_reply_signals_emit_temporary_failure (MilterReplySignals *reply,
+                                             const MilterReplyHandlers *handlers,
+                                             gpointer user_data)
+{
+    if (!handlers) {
+        g_signal_emit(reply, signals[TEMPORARY_FAILURE], 0);
+        return;
+    }
+
+    g_object_ref(reply);
+    if (handlers->temporary_failure)
+        handlers->temporary_failure(reply, user_data);
+    if (has_handler(reply, TEMPORARY_FAILURE))
+        g_signal_emit(reply, signals[TEMPORARY_FAILURE], 0);
+    g_object_unref(reply);
+}
+
+void
+milter_reply_signals_emit_reject (MilterReplySignals *reply,
+                                  const MilterReplyHandlers *handlers,
+                                  gpointer user_data)
+{
+    if (!handlers) {
+        g_signal_emit(reply, signals[REJECT], 0);
+        return;
+    }
+
+    g_object_ref(reply);
+    if (handlers->reject)
+        handlers->reject(reply, user_data);
+    if (has_handler(reply, REJECT))
+        g_signal_emit(reply, signals[REJECT], 0);
+    g_object_unref(reply);
+}
+
+void
+milter_reply_signals_emit_accept (MilterReplySignals *reply,
+                                  const MilterReplyHandlers *handlers,
+                                  gpointer user_data)
+{
+    if (!handlers) {
+        g_signal_emit(reply, signals[ACCEPT], 0);
+        return;
+    }
+
+    g_object_ref(reply);
+    if (handlers->accept)
+        handlers->accept(reply, user_data);
+    if (has_handler(reply, ACCEPT))
+        g_signal_emit(reply, signals[ACCEPT], 0);
+    g_object_unref(reply);
+}
+
+void
+milter_reply_signals_emit_discard (MilterReplySignals *reply,
+                                   const MilterReplyHandlers *handlers,
+                                   gpointer user_data)
+{
+    if (!handlers) {
+        g_signal_emit(reply, signals[DISCARD], 0);
+        return;
+    }
+
+    g_object_ref(reply);
+    if (handlers->discard)
+        handlers->discard(reply, user_data);
+    if (has_handler(reply, DISCARD))
+        g_signal_emit(reply, signals[DISCARD], 0);
+    g_object_unref(reply);
+}
+
+void
+milter_reply_signals_emit_add_header (MilterReplySignals *reply,
+                                      const gchar *name,
+                                      const gchar *value,
+                                      const MilterReplyHandlers *handlers,
+                                      gpointer user_data)
+{
+    if (!handlers) {
+        g_signal_emit(reply, signals[ADD_HEADER], 0, name, value);
+        return;
+    }
+
+    g_object_ref(reply);
+    if (handlers->add_header)
+        handlers->add_header(reply, name, value, user_data);
+    if (has_handler(reply, ADD_HEADER))
+        g_signal_emit(reply, signals[ADD_HEADER], 0, name, value);
+    g_object_unref(reply);
+}
+
+void
+milter_reply_signals_emit_insert_header (MilterReplySignals *reply,
+                                         guint32 index,
+                                         const gchar *name,
+                                         const gchar *value,
+                                         const MilterReplyHandlers *handlers,
+                                         gpointer user_data)
+{
+    if (!handlers) {
+        g_signal_emit(reply, signals[INSERT_HEADER], 0, index, name, value);
+        return;
+    }
+
+    g_object_ref(reply);
+    if (handlers->insert_header)
+        handlers->insert_header(reply, index, name, value, user_data);
+    if (has_handler(reply, INSERT_HEADER))
+        g_signal_emit(reply, signals[INSERT_HEADER], 0, index, name, value);
+    g_object_unref(reply);
+}
+
+void
+milter_reply_signals_emit_change_header (MilterReplySignals *reply,
+                                         const gchar *name,
+                                         guint32 index,
+                                         const gchar *value,
+                                         const MilterReplyHandlers *handlers,
+                                         gpointer user_data)
+{
+    if (!handlers) {
+        g_signal_emit(reply, signals[CHANGE_HEADER], 0, name, index, value);
+        return;
+    }
+
+    g_object_ref(reply);
+    if (handlers->change_header)
+        handlers->change_header(reply, name, index, value, user_data);
+    if (has_handler(reply, CHANGE_HEADER))
+        g_signal_emit(reply, signals[CHANGE_HEADER], 0, name, index, value);
+    g_object_unref(reply);
+}
+
+void
+milter_reply_signals_emit_delete_header (MilterReplySignals *reply,
+                                         const gchar *name,
+                                         guint32 index,
+                                         const MilterReplyHandlers *handlers,
+                                         gpointer user_data)
+{
+    if (!handlers) {
+        g_signal_emit(reply, signals[DELETE_HEADER], 0, name, index);
+        return;
+    }
+
+    g_object_ref(reply);
+    if (handlers->delete_header)
+        handlers->delete_header(reply, name, index, user_data);
+    if (has_handler(reply, DELETE_HEADER))
+        g_signal_emit(reply, signals[DELETE_HEADER], 0, name, index);
+    g_object_unref(reply);
+}
+
+void
+milter_reply_signals_emit_change_from (MilterReplySignals *reply,
+                                       const gchar *from,
+                                       const gchar *parameters,
+                                       const MilterReplyHandlers *handlers,
+                                       gpointer user_data)
+{
+    if (!handlers) {
+        g_signal_emit(reply, signals[CHANGE_FROM], 0, from, parameters);
+        return;
+    }
+
+    g_object_ref(reply);
+    if (handlers->change_from)
+        handlers->change_from(reply, from, parameters, user_data);
+    if (has_handler(reply, CHANGE_FROM))
+        g_signal_emit(reply, signals[CHANGE_FROM], 0, from, parameters);
+    g_object_unref(reply);
+}
+
+void
+milter_reply_signals_emit_add_recipient (MilterReplySignals *reply,
+                                         const gchar *recipient,
+                                         const gchar *parameters,
+                                         const MilterReplyHandlers *handlers,
+                                         gpointer user_data)
+{
+    if (!handlers) {
+        g_signal_emit(reply, signals[ADD_RECIPIENT], 0, recipient, parameters);
+        return;
+    }
+
+    g_object_ref(reply);
+    if (handlers->add_recipient)
+        handlers->add_recipient(reply, recipient, parameters, user_data);
+    if (has_handler(reply, ADD_RECIPIENT))
+        g_signal_emit(reply, signals[ADD_RECIPIENT], 0, recipient, parameters);
+    g_object_unref(reply);
+}
+
+void
+milter_reply_signals_emit_delete_recipient (MilterReplySignals *reply,
+                                            const gchar *recipient,
+                                            const MilterReplyHandlers *handlers,
+                                            gpointer user_data)
+{
+    if (!handlers) {
+        g_signal_emit(reply, signals[DELETE_RECIPIENT], 0, recipient);
+        return;
+    }
+
+    g_object_ref(reply);
+    if (handlers->delete_recipient)
+        handlers->delete_recipient(reply, recipient, user_data);
+    if (has_handler(reply, DELETE_RECIPIENT))
+        g_signal_emit(reply, signals[DELETE_RECIPIENT], 0, recipient);
+    g_object_unref(reply);
+}
+
+void
+milter_reply_signals_emit_replace_body (MilterReplySignals *reply,
+                                        const gchar *body,
+                                        gsize body_size,
+                                        const MilterReplyHandlers *handlers,
+                                        gpointer user_data)
+{
+    if (!handlers) {
+        g_signal_emit(reply, signals[REPLACE_BODY], 0, body, body_size);
+        return;
+    }
+
+    g_object_ref(reply);
+    if (handlers->replace_body)
+        handlers->replace_body(reply, body, body_size, user_data);
+    if (has_handler(reply, REPLACE_BODY))
+        g_signal_emit(reply, signals[REPLACE_BODY], 0, body, body_size);
+    g_object_unref(reply);
+}
+
+void
+milter_reply_signals_emit_progress (MilterReplySignals *reply,
+                                    const MilterReplyHandlers *handlers,
+                                    gpointer user_data)
+{
+    if (!handlers) {
+        g_signal_emit(reply, signals[PROGRESS], 0);
+        return;
+    }
+
+    g_object_ref(reply);
+    if (handlers->progress)
+        handlers->progress(reply, user_data);
+    if (has_handler(reply, PROGRESS))
+        g_signal_emit(reply, signals[PROGRESS], 0);
+    g_object_unref(reply);
+}
+
+void
+milter_reply_signals_emit_quarantine (MilterReplySignals *reply,
+                                      const gchar *reason,
+                                      const MilterReplyHandlers *handlers,
+                                      gpointer user_data)
+{
+    if (!handlers) {
+        g_signal_emit(reply, signals[QUARANTINE], 0, reason);
+        return;
+    }
+
+    g_object_ref(reply);
+    if (handlers->quarantine)
+        handlers->quarantine(reply, reason, user_data);
+    if (has_handler(reply, QUARANTINE))
+        g_signal_emit(reply, signals[QUARANTINE], 0, reason);
+    g_object_unref(reply);
+}
+
+void
+milter_reply_signals_emit_connection_failure (MilterReplySignals *reply,
+                                              const MilterReplyHandlers *handlers,
+                                              gpointer user_data)
+{
+    if (!handlers) {
+        g_signal_emit(reply, signals[CONNECTION_FAILURE], 0);
+        return;
+    }
+
+    g_object_ref(reply);
+    if (handlers->connection_failure)
+        handlers->connection_failure(reply, user_data);
+    if (has_handler(reply, CONNECTION_FAILURE))
+        g_signal_emit(reply, signals[CONNECTION_FAILURE], 0);
+    g_object_unref(reply);
+}
+
+void
+milter_reply_signals_emit_shutdown (MilterReplySignals *reply,
+                                    const MilterReplyHandlers *handlers,
+                                    gpointer user_data)
+{
+    if (!handlers) {
+        g_signal_emit(reply, signals[SHUTDOWN], 0);
+        return;
+    }
+
+    g_object_ref(reply);
+    if (handlers->shutdown)
+        handlers->shutdown(reply, user_data);
+    if (has_handler(reply, SHUTDOWN))
+        g_signal_emit(reply, signals[SHUTDOWN], 0);
+    g_object_unref(reply);
+}
+
+void
+milter_reply_signals_emit_skip (MilterReplySignals *reply,
+                                const MilterReplyHandlers *handlers,
+                                gpointer user_data)
+{
+    if (!handlers) {
+        g_signal_emit(reply, signals[SKIP], 0);
+        return;
+    }
+
+    g_object_ref(reply);
+    if (handlers->skip)
+        handlers->skip(reply, user_data);
+    if (has_handler(reply, SKIP))
+        g_signal_emit(reply, signals[SKIP], 0);
+    g_object_unref(reply);
+}
+
 /*
 vi:ts=4:nowrap:ai:expandtab:sw=4
 */
@@ -89,8 +89,181 @@ struct _MilterReplySignalsClass
     void (*abort)               (MilterReplySignals *reply);
 };
 
+typedef struct _MilterReplyHandlers        MilterReplyHandlers;
+
+struct _MilterReplyHandlers
+{
+    void (*negotiate_reply)      (MilterReplySignals   *reply,
+                                  MilterOption         *option,
+                                  MilterMacrosRequests *macros_requests,
+                                  gpointer              user_data);
+    void (*_continue)            (MilterReplySignals   *reply,
+                                  gpointer              user_data);
+    void (*reply_code)           (MilterReplySignals   *reply,
+                                  guint                 code,
+                                  const gchar          *extended_code,
+                                  const gchar          *message,
+                                  gpointer              user_data);
+    void (*temporary_failure)    (MilterReplySignals   *reply,
+                                  gpointer              user_data);
+    void (*reject)               (MilterReplySignals   *reply,
+                                  gpointer              user_data);
+    void (*accept)               (MilterReplySignals   *reply,
+                                  gpointer              user_data);
+    void (*discard)              (MilterReplySignals   *reply,
+                                  gpointer              user_data);
+    void (*add_header)           (MilterReplySignals   *reply,
+                                  const gchar          *name,
+                                  const gchar          *value,
+                                  gpointer              user_data);
+    void (*insert_header)        (MilterReplySignals   *reply,
+                                  guint32               index,
+                                  const gchar          *name,
+                                  const gchar          *value,
+                                  gpointer              user_data);
+    void (*change_header)        (MilterReplySignals   *reply,
+                                  const gchar          *name,
+                                  guint32               index,
+                                  const gchar          *value,
+                                  gpointer              user_data);
+    void (*delete_header)        (MilterReplySignals   *reply,
+                                  const gchar          *name,
+                                  guint32               index,
+                                  gpointer              user_data);
+    void (*change_from)          (MilterReplySignals   *reply,
+                                  const gchar          *from,
+                                  const gchar          *parameters,
+                                  gpointer              user_data);
+    void (*add_recipient)        (MilterReplySignals   *reply,
+                                  const gchar          *recipient,
+                                  const gchar          *parameters,
+                                  gpointer              user_data);
+    void (*delete_recipient)     (MilterReplySignals   *reply,
+                                  const gchar          *recipient,
+                                  gpointer              user_data);
+    void (*replace_body)         (MilterReplySignals   *reply,
+                                  const gchar          *body,
+                                  gsize                 body_size,
+                                  gpointer              user_data);
+    void (*progress)             (MilterReplySignals   *reply,
+                                  gpointer              user_data);
+    void (*quarantine)           (MilterReplySignals   *reply,
+                                  const gchar          *reason,
+                                  gpointer              user_data);
+    void (*connection_failure)   (MilterReplySignals   *reply,
+                                  gpointer              user_data);
+    void (*shutdown)             (MilterReplySignals   *reply,
+                                  gpointer              user_data);
+    void (*skip)                 (MilterReplySignals   *reply,
+                                  gpointer              user_data);
+};
+
 GType    milter_reply_signals_get_type          (void) G_GNUC_CONST;
 
+void     milter_reply_signals_emit_negotiate_reply
+         (MilterReplySignals        *reply,
+          MilterOption              *option,
+          MilterMacrosRequests      *macros_requests,
+          const MilterReplyHandlers *handlers,
+          gpointer                   user_data);
+void     milter_reply_signals_emit_continue
+         (MilterReplySignals        *reply,
+          const MilterReplyHandlers *handlers,
+          gpointer                   user_data);
+void     milter_reply_signals_emit_reply_code
+         (MilterReplySignals        *reply,
+          guint                      code,
+          const gchar               *extended_code,
+          const gchar               *message,
+          const MilterReplyHandlers *handlers,
+          gpointer                   user_data);
+void     milter_reply_signals_emit_temporary_failure
+         (MilterReplySignals        *reply,
+          const MilterReplyHandlers *handlers,
+          gpointer                   user_data);
+void     milter_reply_signals_emit_reject
+         (MilterReplySignals        *reply,
+          const MilterReplyHandlers *handlers,
+          gpointer                   user_data);
+void     milter_reply_signals_emit_accept
+         (MilterReplySignals        *reply,
+          const MilterReplyHandlers *handlers,
+          gpointer                   user_data);
+void     milter_reply_signals_emit_discard
+         (MilterReplySignals        *reply,
+          const MilterReplyHandlers *handlers,
+          gpointer                   user_data);
+void     milter_reply_signals_emit_add_header
+         (MilterReplySignals        *reply,
+          const gchar               *name,
+          const gchar               *value,
+          const MilterReplyHandlers *handlers,
+          gpointer                   user_data);
+void     milter_reply_signals_emit_insert_header
+         (MilterReplySignals        *reply,
+          guint32                    index,
+          const gchar               *name,
+          const gchar               *value,
+          const MilterReplyHandlers *handlers,
+          gpointer                   user_data);
+void     milter_reply_signals_emit_change_header
+         (MilterReplySignals        *reply,
+          const gchar               *name,
+          guint32                    index,
+          const gchar               *value,
+          const MilterReplyHandlers *handlers,
+          gpointer                   user_data);
+void     milter_reply_signals_emit_delete_header
+         (MilterReplySignals        *reply,
+          const gchar               *name,
+          guint32                    index,
+          const MilterReplyHandlers *handlers,
+          gpointer                   user_data);
+void     milter_reply_signals_emit_change_from
+         (MilterReplySignals        *reply,
+          const gchar               *from,
+          const gchar               *parameters,
+          const MilterReplyHandlers *handlers,
+          gpointer                   user_data);
+void     milter_reply_signals_emit_add_recipient
+         (MilterReplySignals        *reply,
+          const gchar               *recipient,
+          const gchar               *parameters,
+          const MilterReplyHandlers *handlers,
+          gpointer                   user_data);
+void     milter_reply_signals_emit_delete_recipient
+         (MilterReplySignals        *reply,
+          const gchar               *recipient,
+          const MilterReplyHandlers *handlers,
+          gpointer                   user_data);
+void     milter_reply_signals_emit_replace_body
+         (MilterReplySignals        *reply,
+          const gchar               *body,
+          gsize                      body_size,
+          const MilterReplyHandlers *handlers,
+          gpointer                   user_data);
+void     milter_reply_signals_emit_progress
+         (MilterReplySignals        *reply,
+          const MilterReplyHandlers *handlers,
+          gpointer                   user_data);
+void     milter_reply_signals_emit_quarantine
+         (MilterReplySignals        *reply,
+          const gchar               *reason,
+          const MilterReplyHandlers *handlers,
+          gpointer                   user_data);
+void     milter_reply_signals_emit_connection_failure
+         (MilterReplySignals        *reply,
+          const MilterReplyHandlers *handlers,
+          gpointer                   user_data);
+void     milter_reply_signals_emit_shutdown
+         (MilterReplySignals        *reply,
+          const MilterReplyHandlers *handlers,
+          gpointer                   user_data);
+void     milter_reply_signals_emit_skip
+         (MilterReplySignals        *reply,
+          const MilterReplyHandlers *handlers,
+          gpointer                   user_data);
+
 G_END_DECLS
 
 #endif /* __MILTER_REPLY_SIGNALS_H__ */
@@ -105,6 +105,12 @@ milter_syslog_logger_class_init (MilterSyslogLoggerClass *klass)
                              sizeof(MilterSyslogLoggerPrivate));
 }
 
+static void
+write_syslog (const gchar *message, gpointer user_data)
+{
+    syslog(GPOINTER_TO_INT(user_data), "%s", message);
+}
+
 static gint
 milter_log_level_to_syslog_level (MilterLogLevelFlags milter_log_level)
 {
@@ -155,9 +161,10 @@ cb_log (MilterLogger *logger, const gchar *domain,
     g_string_append(log, message);
 
     syslog_level = milter_log_level_to_syslog_level(level);
-    syslog(syslog_level, "%s", log->str);
-
-    g_string_free(log, TRUE);
+    milter_logger_write(logger,
+                        write_syslog,
+                        g_string_free(log, FALSE),
+                        GINT_TO_POINTER(syslog_level));
 }
 
 static gint
@@ -236,6 +243,7 @@ teardown_logger (MilterSyslogLoggerPrivate *priv)
                                         MILTER_LOG_LEVEL_DEFAULT);
     g_signal_handlers_disconnect_by_func(priv->logger,
                                          G_CALLBACK(cb_log), priv);
+    milter_logger_flush(priv->logger);
     g_object_unref(priv->logger);
     closelog();
 }
@@ -471,6 +471,38 @@ milter_utils_merge_hash_string_string (GHashTable *dest, GHashTable *src)
                          dest);
 }
 
+const gchar *
+milter_utils_intern_macro_name (const gchar *name, gssize length)
+{
+    gchar buffer[256];
+    gchar *normalized_name;
+    const gchar *interned_name;
+    gboolean null_terminated = FALSE;
+
+    if (length < 0) {
+        length = strlen(name);
+        null_terminated = TRUE;
+    }
+
+    if (length >= 2 && name[0] == '{' && name[length - 1] == '}') {
+        name++;
+        length -= 2;
+    } else if (null_terminated) {
+        return g_intern_string(name);
+    }
+
+    if (length < sizeof(buffer)) {
+        memcpy(buffer, name, length);
+        buffer[length] = '\0';
+        return g_intern_string(buffer);
+    }
+
+    normalized_name = g_strndup(name, length);
+    interned_name = g_intern_string(normalized_name);
+    g_free(normalized_name);
+    return interned_name;
+}
+
 gchar *
 milter_utils_inspect_list_pointer (const GList *list)
 {
@@ -105,6 +105,8 @@ void      milter_utils_merge_hash_string_string
                                              (GHashTable *dest,
                                               GHashTable *src);
 gchar    *milter_utils_inspect_list_pointer  (const GList *list);
+const gchar *milter_utils_intern_macro_name  (const gchar *name,
+                                              gssize       length);
 
 MilterMacroStage milter_utils_command_to_macro_stage
                                              (MilterCommand command);
@@ -23,6 +23,9 @@
 
 #include <stdlib.h>
 #include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/uio.h>
 
 #include <glib.h>
 
@@ -40,19 +43,29 @@ struct _MilterWriterPrivate
 {
     GIOChannel *io_channel;
     MilterEventLoop *loop;
-    GString *buffer;
+    GQueue *chunks;
+    gsize chunk_offset;
+    gsize buffered_size;
+    gint fd;
+    gboolean direct_write;
     gsize flush_point;
     gboolean writing;
     guint write_watch_id;
+    gboolean write_watch_paused;
     guint flush_watch_id;
     guint error_watch_id;
     guint tag;
 };
 
+#define MAX_IO_VECTORS 64
+#define COALESCE_SIZE 4096
+
 enum
 {
     PROP_0,
     PROP_IO_CHANNEL,
+    PROP_FD,
+    PROP_DIRECT_WRITE,
     PROP_TAG
 };
 
@@ -100,6 +113,21 @@ milter_writer_class_init (MilterWriterClass *klass)
                                 G_PARAM_READWRITE | G_PARAM_CONSTRUCT_ONLY);
     g_object_class_install_property(gobject_class, PROP_IO_CHANNEL, spec);
 
+    spec = g_param_spec_int("fd",
+                            "File descriptor",
+                            "The file descriptor of the GIOChannel",
+                            -1, G_MAXINT, -1,
+                            G_PARAM_READWRITE | G_PARAM_CONSTRUCT_ONLY);
+    g_object_class_install_property(gobject_class, PROP_FD, spec);
+
+    spec = g_param_spec_boolean("direct-write",
+                                "Direct write",
+                                "Whether the writer writes data immediately "
+                                "when no data is buffered",
+                                FALSE,
+                                G_PARAM_READWRITE);
+    g_object_class_install_property(gobject_class, PROP_DIRECT_WRITE, spec);
+
     spec = g_param_spec_uint("tag",
                              "Tag",
                              "The tag of the reader",
@@ -133,10 +161,15 @@ milter_writer_init (MilterWriter *writer)
     priv = MILTER_WRITER_GET_PRIVATE(writer);
     priv->io_channel = NULL;
     priv->loop = NULL;
-    priv->buffer = g_string_new(NULL);
+    priv->chunks = g_queue_new();
+    priv->chunk_offset = 0;
+    priv->buffered_size = 0;
+    priv->fd = -1;
+    priv->direct_write = FALSE;
     priv->flush_point = 0;
     priv->writing = FALSE;
     priv->write_watch_id = 0;
+    priv->write_watch_paused = FALSE;
     priv->flush_watch_id = 0;
     priv->error_watch_id = 0;
     priv->tag = 0;
@@ -149,6 +182,7 @@ clear_write_watch_id (MilterWriterPrivate *priv)
         milter_event_loop_remove(priv->loop, priv->write_watch_id);
         priv->write_watch_id = 0;
     }
+    priv->write_watch_paused = FALSE;
 }
 
 static void
@@ -177,6 +211,21 @@ clear_watch_id (MilterWriterPrivate *priv)
     }
 }
 
+static void
+free_chunk (gpointer data, gpointer user_data)
+{
+    g_string_free(data, TRUE);
+}
+
+static void
+free_chunks (MilterWriterPrivate *priv)
+{
+    g_queue_foreach(priv->chunks, free_chunk, NULL);
+    g_queue_clear(priv->chunks);
+    priv->chunk_offset = 0;
+    priv->buffered_size = 0;
+}
+
 static void
 dispose (GObject *object)
 {
@@ -193,14 +242,15 @@ dispose (GObject *object)
         priv->io_channel = NULL;
     }
 
-    if (priv->buffer) {
-        if (priv->buffer->len > 0) {
+    if (priv->chunks) {
+        if (priv->buffered_size > 0) {
             milter_debug("[%u] [writer][dispose][buffer][unwritten] "
                          "<%" G_GSIZE_FORMAT ">",
-                         priv->tag, priv->buffer->len);
+                         priv->tag, priv->buffered_size);
         }
-        g_string_free(priv->buffer, TRUE);
-        priv->buffer = NULL;
+        free_chunks(priv);
+        g_queue_free(priv->chunks);
+        priv->chunks = NULL;
     }
 
     G_OBJECT_CLASS(milter_writer_parent_class)->dispose(object);
@@ -221,6 +271,12 @@ set_property (GObject      *object,
         if (priv->io_channel)
             g_io_channel_ref(priv->io_channel);
         break;
+    case PROP_FD:
+        priv->fd = g_value_get_int(value);
+        break;
+    case PROP_DIRECT_WRITE:
+        priv->direct_write = g_value_get_boolean(value);
+        break;
     case PROP_TAG:
         milter_writer_set_tag(MILTER_WRITER(object), g_value_get_uint(value));
         break;
@@ -243,6 +299,12 @@ get_property (GObject    *object,
     case PROP_IO_CHANNEL:
         g_value_set_pointer(value, priv->io_channel);
         break;
+    case PROP_FD:
+        g_value_set_int(value, priv->fd);
+        break;
+    case PROP_DIRECT_WRITE:
+        g_value_set_boolean(value, priv->direct_write);
+        break;
     case PROP_TAG:
         g_value_set_uint(value, priv->tag);
         break;
@@ -266,6 +328,134 @@ milter_writer_io_channel_new (GIOChannel *channel)
                         NULL);
 }
 
+MilterWriter *
+milter_writer_unix_io_channel_new (GIOChannel *channel)
+{
+    return g_object_new(MILTER_TYPE_WRITER,
+                        "io-channel", channel,
+                        "fd", g_io_channel_unix_get_fd(channel),
+                        NULL);
+}
+
+static void
+consume_chunks (MilterWriterPrivate *priv, gsize written_size)
+{
+    priv->buffered_size -= written_size;
+    written_size += priv->chunk_offset;
+    while (written_size > 0) {
+        GString *chunk;
+
+        chunk = g_queue_peek_head(priv->chunks);
+        if (written_size < chunk->len) {
+            priv->chunk_offset = written_size;
+            return;
+        }
+        written_size -= chunk->len;
+        g_string_free(g_queue_pop_head(priv->chunks), TRUE);
+    }
+    priv->chunk_offset = 0;
+}
+
+static gsize
+write_chunks_by_io_vectors (MilterWriterPrivate *priv, GError **error)
+{
+    struct iovec vectors[MAX_IO_VECTORS];
+    GList *node;
+    gint n_vectors = 0;
+    gssize written_size;
+
+    for (node = g_queue_peek_head_link(priv->chunks);
+         node && n_vectors < MAX_IO_VECTORS;
+         node = g_list_next(node)) {
+        GString *chunk = node->data;
+
+        vectors[n_vectors].iov_base = chunk->str;
+        vectors[n_vectors].iov_len = chunk->len;
+        n_vectors++;
+    }
+    vectors[0].iov_base = (gchar *)vectors[0].iov_base + priv->chunk_offset;
+    vectors[0].iov_len -= priv->chunk_offset;
+
+    do {
+        written_size = writev(priv->fd, vectors, n_vectors);
+    } while (written_size == -1 && errno == EINTR);
+
+    if (written_size == -1) {
+        if (errno != EAGAIN && errno != EWOULDBLOCK)
+            g_set_error(error,
+                        G_IO_CHANNEL_ERROR,
+                        g_io_channel_error_from_errno(errno),
+                        "%s", g_strerror(errno));
+        return 0;
+    }
+
+    return written_size;
+}
+
+static gsize
+write_chunks_by_io_channel (MilterWriterPrivate *priv, GError **error)
+{
+    GList *node;
+    gsize offset, total_written_size = 0;
+
+    offset = priv->chunk_offset;
+    for (node = g_queue_peek_head_link(priv->chunks);
+         node;
+         node = g_list_next(node)) {
+        GString *chunk = node->data;
+        gsize written_size = 0;
+
+        g_io_channel_write_chars(priv->io_channel,
+                                 chunk->str + offset,
+                                 chunk->len - offset,
+                                 &written_size,
+                                 error);
+        total_written_size += written_size;
+        if (written_size < chunk->len - offset || (error && *error))
+            break;
+        offset = 0;
+    }
+
+    return total_written_size;
+}
+
+static gsize
+write_chunks (MilterWriterPrivate *priv, GError **error)
+{
+    gsize written_size;
+
+    if (priv->buffered_size == 0)
+        return 0;
+
+    priv->writing = TRUE;
+    if (priv->fd == -1)
+        written_size = write_chunks_by_io_channel(priv, error);
+    else
+        written_size = write_chunks_by_io_vectors(priv, error);
+    priv->writing = FALSE;
+
+    if (written_size > 0)
+        consume_chunks(priv, written_size);
+
+    return written_size;
+}
+
+static void
+push_chunk (MilterWriterPrivate *priv, GString *chunk)
+{
+    GString *last_chunk;
+
+    last_chunk = g_queue_peek_tail(priv->chunks);
+    if (last_chunk &&
+        chunk->len < COALESCE_SIZE &&
+        last_chunk->len + chunk->len <= COALESCE_SIZE) {
+        g_string_append_len(last_chunk, chunk->str, chunk->len);
+        g_string_free(chunk, TRUE);
+    } else {
+        g_queue_push_tail(priv->chunks, chunk);
+    }
+}
+
 static gboolean
 flush_watch_func (GIOChannel *channel, GIOCondition condition, gpointer data)
 {
@@ -345,30 +535,33 @@ write_watch_func (GIOChannel *channel, GIOCondition condition, gpointer data)
 
     milter_trace("[%u] [writer][write-callback] [%u] "
                  "buffered: <%" G_GSIZE_FORMAT ">",
-                 priv->tag, priv->write_watch_id, priv->buffer->len);
-
-    if (priv->buffer->len == 0) {
+                 priv->tag, priv->write_watch_id, priv->buffered_size);
+
+    if (priv->buffered_size == 0) {
+        /* Keep the watch for the next write if the event loop can
+         * stop waiting for G_IO_OUT without removing it. */
+        if (milter_event_loop_modify_io(priv->loop, priv->write_watch_id, 0)) {
+            milter_trace("[%u] [writer][write-callback][empty][pause] [%u] "
+                         "pause write watch because buffer is empty",
+                         priv->tag, priv->write_watch_id);
+            priv->write_watch_paused = TRUE;
+            return TRUE;
+        }
         keep_callback = FALSE;
         milter_trace("[%u] [writer][write-callback][empty] [%u] "
                      "stop write watch because buffer is empty",
                      priv->tag, priv->write_watch_id);
     } else {
-        gsize written_size = 0;
+        gsize written_size;
         GError *channel_error = NULL;
 
-        priv->writing = TRUE;
-        g_io_channel_write_chars(priv->io_channel,
-                                 priv->buffer->str,
-                                 priv->buffer->len,
-                                 &written_size,
-                                 &channel_error);
-        priv->writing = FALSE;
+        written_size = write_chunks(priv, &channel_error);
 
         if (written_size == 0) {
             milter_trace("[%u] [writer][write-callback][unwritten] [%u] "
                          "no buffered chunks are written: "
                          "rest: <%" G_GSIZE_FORMAT ">",
-                         priv->tag, priv->write_watch_id, priv->buffer->len);
+                         priv->tag, priv->write_watch_id, priv->buffered_size);
         } else {
             gboolean need_flush = FALSE;
 
@@ -380,7 +573,6 @@ write_watch_func (GIOChannel *channel, GIOCondition condition, gpointer data)
                     priv->flush_point -= written_size;
                 }
             }
-            g_string_erase(priv->buffer, 0, written_size);
             milter_trace("[%u] [writer][write-callback][wrote] [%u] "
                          "written: <%" G_GSIZE_FORMAT "> "
                          "rest: <%" G_GSIZE_FORMAT "> "
@@ -388,7 +580,7 @@ write_watch_func (GIOChannel *channel, GIOCondition condition, gpointer data)
                          priv->tag,
                          priv->write_watch_id,
                          written_size,
-                         priv->buffer->len,
+                         priv->buffered_size,
                          need_flush ? "true" : "false");
             if (need_flush && priv->loop) {
                 request_flush(writer);
@@ -423,13 +615,9 @@ write_watch_func (GIOChannel *channel, GIOCondition condition, gpointer data)
     return keep_callback;
 }
 
-gboolean
-milter_writer_write (MilterWriter *writer, const gchar *chunk, gsize chunk_size,
-                     GError **error)
+static gboolean
+check_writable (MilterWriterPrivate *priv, GError **error)
 {
-    MilterWriterPrivate *priv;
-
-    priv = MILTER_WRITER_GET_PRIVATE(writer);
 
     if (!priv->io_channel) {
         const gchar *message = "no write channel";
@@ -451,14 +639,72 @@ milter_writer_write (MilterWriter *writer, const gchar *chunk, gsize chunk_size,
         return FALSE;
     }
 
-    if (chunk_size == 0) {
+    return TRUE;
+}
+
+static void
+write_directly (MilterWriterPrivate *priv)
+{
+    gsize written_size;
+    GError *channel_error = NULL;
+
+    written_size = write_chunks(priv, &channel_error);
+    milter_trace("[%u] [writer][write][direct] "
+                 "written: <%" G_GSIZE_FORMAT "> "
+                 "rest: <%" G_GSIZE_FORMAT ">",
+                 priv->tag, written_size, priv->buffered_size);
+    if (channel_error) {
+        milter_debug("[%u] [writer][write][direct][error] "
+                     "retry by write callback: %s",
+                     priv->tag, channel_error->message);
+        g_error_free(channel_error);
+    }
+}
+
+gboolean
+milter_writer_write_buffer (MilterWriter *writer, GString *buffer,
+                            GError **error)
+{
+    MilterWriterPrivate *priv;
+    gboolean direct_write;
+
+    priv = MILTER_WRITER_GET_PRIVATE(writer);
+
+    if (!check_writable(priv, error)) {
+        g_string_free(buffer, TRUE);
+        return FALSE;
+    }
+
+    if (buffer->len == 0) {
         milter_debug("[%u] [writer][write][empty] "
                      "ignore empty chunk write request",
                      priv->tag);
+        g_string_free(buffer, TRUE);
         return TRUE;
     }
 
-    g_string_append_len(priv->buffer, chunk, chunk_size);
+    direct_write = (priv->direct_write &&
+                    priv->buffered_size == 0 &&
+                    !priv->writing);
+    priv->buffered_size += buffer->len;
+    push_chunk(priv, buffer);
+    if (direct_write) {
+        write_directly(priv);
+        if (priv->buffered_size == 0)
+            return TRUE;
+    }
+
+    if (priv->write_watch_paused) {
+        if (milter_event_loop_modify_io(priv->loop, priv->write_watch_id,
+                                        G_IO_OUT)) {
+            milter_trace("[%u] [writer][write-callback][resume] [%u]",
+                         priv->tag, priv->write_watch_id);
+            priv->write_watch_paused = FALSE;
+            return TRUE;
+        }
+        clear_write_watch_id(priv);
+    }
+
     if (priv->write_watch_id == 0) {
         priv->write_watch_id =
             milter_event_loop_watch_io(priv->loop,
@@ -475,6 +721,15 @@ milter_writer_write (MilterWriter *writer, const gchar *chunk, gsize chunk_size,
     return TRUE;
 }
 
+gboolean
+milter_writer_write (MilterWriter *writer, const gchar *chunk, gsize chunk_size,
+                     GError **error)
+{
+    return milter_writer_write_buffer(writer,
+                                      g_string_new_len(chunk, chunk_size),
+                                      error);
+}
+
 gboolean
 milter_writer_flush (MilterWriter *writer, GError **error)
 {
@@ -502,8 +757,8 @@ milter_writer_flush (MilterWriter *writer, GError **error)
         return FALSE;
     }
 
-    if (priv->write_watch_id > 0) {
-        priv->flush_point = priv->buffer->len;
+    if (priv->write_watch_id > 0 && !priv->write_watch_paused) {
+        priv->flush_point = priv->buffered_size;
         milter_trace("[%u] [writer][flush][flush-point][set] [%u] "
                      "<%" G_GSIZE_FORMAT ">",
                      priv->tag,
@@ -516,6 +771,56 @@ milter_writer_flush (MilterWriter *writer, GError **error)
     return TRUE;
 }
 
+gboolean
+milter_writer_drain (MilterWriter *writer, GError **error)
+{
+    MilterWriterPrivate *priv;
+    GError *channel_error = NULL;
+
+    priv = MILTER_WRITER_GET_PRIVATE(writer);
+
+    if (!check_writable(priv, error))
+        return FALSE;
+
+    if (priv->writing) {
+        milter_trace("[%u] [writer][drain][skip] writing", priv->tag);
+        return FALSE;
+    }
+
+    while (priv->buffered_size > 0 && !channel_error) {
+        if (write_chunks(priv, &channel_error) == 0)
+            break;
+    }
+
+    if (!channel_error && priv->buffered_size == 0 && priv->fd == -1) {
+        if (g_io_channel_flush(priv->io_channel, &channel_error) ==
+            G_IO_STATUS_AGAIN) {
+            milter_trace("[%u] [writer][drain][flush][again]", priv->tag);
+            return FALSE;
+        }
+    }
+
+    if (channel_error) {
+        milter_error("[%u] [writer][drain][error] %s",
+                     priv->tag, channel_error->message);
+        milter_utils_set_error_with_sub_error(
+            error,
+            MILTER_WRITER_ERROR,
+            MILTER_WRITER_ERROR_IO_ERROR,
+            channel_error,
+            "failed to drain");
+        return FALSE;
+    }
+
+    milter_trace("[%u] [writer][drain] rest: <%" G_GSIZE_FORMAT ">",
+                 priv->tag, priv->buffered_size);
+    if (priv->buffered_size > 0)
+        return FALSE;
+
+    priv->flush_point = 0;
+    return TRUE;
+}
+
 static gboolean
 error_watch_func (GIOChannel *channel, GIOCondition condition, gpointer data)
 {
@@ -596,16 +901,16 @@ static void
 flush_buffer_on_shutdown (MilterWriter *writer)
 {
     MilterWriterPrivate *priv;
-    gsize written_size = 0;
+    gsize written_size;
     GError *channel_error = NULL;
 
     priv = MILTER_WRITER_GET_PRIVATE(writer);
 
     milter_trace("[%u] [writer][shutdown][flush-buffer] "
                  "<%" G_GSIZE_FORMAT ">",
-                 priv->tag, priv->buffer->len);
+                 priv->tag, priv->buffered_size);
 
-    if (priv->buffer->len == 0) {
+    if (priv->buffered_size == 0) {
         milter_trace("[%u] [writer][shutdown][flush-buffer][skip] "
                      "no buffered data",
                      priv->tag);
@@ -618,25 +923,20 @@ flush_buffer_on_shutdown (MilterWriter *writer)
         return;
     }
 
-    g_io_channel_write_chars(priv->io_channel,
-                             priv->buffer->str,
-                             priv->buffer->len,
-                             &written_size,
-                             &channel_error);
+    written_size = write_chunks(priv, &channel_error);
 
     if (written_size == 0) {
         milter_trace("[%u] [writer][shutdown][flush-buffer][unwritten] "
                      "no buffered chunks are written: "
                      "rest: <%" G_GSIZE_FORMAT ">",
-                     priv->tag, priv->buffer->len);
+                     priv->tag, priv->buffered_size);
     } else {
-        g_string_erase(priv->buffer, 0, written_size);
         milter_trace("[%u] [writer][shutdown][flush-buffer][wrote] "
                      "written: <%" G_GSIZE_FORMAT "> "
                      "rest: <%" G_GSIZE_FORMAT ">",
                      priv->tag,
                      written_size,
-                     priv->buffer->len);
+                     priv->buffered_size);
     }
 
     if (channel_error) {
@@ -695,6 +995,18 @@ milter_writer_shutdown (MilterWriter *writer)
     }
 }
 
+void
+milter_writer_set_direct_write (MilterWriter *writer, gboolean direct_write)
+{
+    MILTER_WRITER_GET_PRIVATE(writer)->direct_write = direct_write;
+}
+
+gboolean
+milter_writer_get_direct_write (MilterWriter *writer)
+{
+    return MILTER_WRITER_GET_PRIVATE(writer)->direct_write;
+}
+
 guint
 milter_writer_get_tag (MilterWriter *writer)
 {
@@ -64,19 +64,32 @@ GQuark           milter_writer_error_quark    (void);
 GType            milter_writer_get_type       (void) G_GNUC_CONST;
 
 MilterWriter    *milter_writer_io_channel_new (GIOChannel       *channel);
+MilterWriter    *milter_writer_unix_io_channel_new
+                                              (GIOChannel       *channel);
 
 gboolean         milter_writer_write          (MilterWriter     *writer,
                                                const gchar      *chunk,
                                                gsize             chunk_size,
                                                GError          **error);
+gboolean         milter_writer_write_buffer   (MilterWriter     *writer,
+                                               GString          *buffer,
+                                               GError          **error);
 gboolean         milter_writer_flush          (MilterWriter     *writer,
                                                GError          **error);
+gboolean         milter_writer_drain          (MilterWriter     *writer,
+                                               GError          **error);
 
 void             milter_writer_start          (MilterWriter     *writer,
                                                MilterEventLoop  *loop);
 gboolean         milter_writer_is_watching    (MilterWriter     *writer);
 void             milter_writer_shutdown       (MilterWriter     *writer);
 
+void             milter_writer_set_direct_write
+                                              (MilterWriter     *writer,
+                                               gboolean          direct_write);
+gboolean         milter_writer_get_direct_write
+                                              (MilterWriter     *writer);
+
 guint            milter_writer_get_tag        (MilterWriter     *writer);
 void             milter_writer_set_tag        (MilterWriter     *writer,
                                                guint             tag);
@@ -21,6 +21,12 @@
 #  include "../../config.h"
 #endif /* HAVE_CONFIG_H */
 
+#include <string.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
 #include "milter-manager-applicable-condition.h"
 #include "milter-manager-enum-types.h"
 #include <milter/core/milter-marshalers.h>
@@ -30,12 +36,52 @@
                                  MILTER_TYPE_MANAGER_APPLICABLE_CONDITION, \
                                  MilterManagerApplicableConditionPrivate))
 
+#define STAGE_BIT(stage) (1 << (stage))
+
+typedef struct _Network Network;
+struct _Network
+{
+    gint family;
+    guint8 address[16];
+    guint prefix_length;
+};
+
+typedef struct _MacroRule MacroRule;
+struct _MacroRule
+{
+    MilterMacroStage stage;
+    gchar *name;
+    gchar *value;
+    GRegex *regex;
+    gboolean apply;
+};
+
+typedef struct _DomainSet DomainSet;
+struct _DomainSet
+{
+    GHashTable *apply;
+    GHashTable *skip;
+};
+
 typedef struct _MilterManagerApplicableConditionPrivate MilterManagerApplicableConditionPrivate;
 struct _MilterManagerApplicableConditionPrivate
 {
     gchar *name;
     gchar *description;
     gchar *data;
+
+    GArray *apply_networks;
+    GArray *skip_networks;
+    GArray *local_networks;
+    GArray *remote_networks;
+    DomainSet envelope_from_domains;
+    DomainSet envelope_recipient_domains;
+    GList *macro_rules;
+    guint macro_stages;
+    guint threshold_n_connections;
+    gboolean notify_stress;
+    gboolean have_authentication_rule;
+    gboolean authentication_apply;
 };
 
 enum
@@ -127,6 +173,45 @@ milter_manager_applicable_condition_init (MilterManagerApplicableCondition *appl
     priv->name = NULL;
     priv->description = NULL;
     priv->data = NULL;
+
+    priv->apply_networks = NULL;
+    priv->skip_networks = NULL;
+    priv->local_networks = NULL;
+    priv->remote_networks = NULL;
+    priv->envelope_from_domains.apply = NULL;
+    priv->envelope_from_domains.skip = NULL;
+    priv->envelope_recipient_domains.apply = NULL;
+    priv->envelope_recipient_domains.skip = NULL;
+    priv->macro_rules = NULL;
+    priv->macro_stages = 0;
+    priv->threshold_n_connections = 0;
+    priv->notify_stress = FALSE;
+    priv->have_authentication_rule = FALSE;
+    priv->authentication_apply = FALSE;
+}
+
+static void
+macro_rule_free (MacroRule *rule)
+{
+    g_free(rule->name);
+    g_free(rule->value);
+    if (rule->regex)
+        g_regex_unref(rule->regex);
+    g_free(rule);
+}
+
+static void
+domain_set_clear (DomainSet *set)
+{
+    if (set->apply) {
+        g_hash_table_unref(set->apply);
+        set->apply = NULL;
+    }
+
+    if (set->skip) {
+        g_hash_table_unref(set->skip);
+        set->skip = NULL;
+    }
 }
 
 static void
@@ -151,6 +236,36 @@ dispose (GObject *object)
         priv->data = NULL;
     }
 
+    if (priv->apply_networks) {
+        g_array_free(priv->apply_networks, TRUE);
+        priv->apply_networks = NULL;
+    }
+
+    if (priv->skip_networks) {
+        g_array_free(priv->skip_networks, TRUE);
+        priv->skip_networks = NULL;
+    }
+
+    if (priv->local_networks) {
+        g_array_free(priv->local_networks, TRUE);
+        priv->local_networks = NULL;
+    }
+
+    if (priv->remote_networks) {
+        g_array_free(priv->remote_networks, TRUE);
+        priv->remote_networks = NULL;
+    }
+
+    domain_set_clear(&(priv->envelope_from_domains));
+    domain_set_clear(&(priv->envelope_recipient_domains));
+
+    if (priv->macro_rules) {
+        g_list_foreach(priv->macro_rules, (GFunc)macro_rule_free, NULL);
+        g_list_free(priv->macro_rules);
+        priv->macro_rules = NULL;
+    }
+    priv->macro_stages = 0;
+
     G_OBJECT_CLASS(milter_manager_applicable_condition_parent_class)->dispose(object);
 }
 
@@ -208,6 +323,12 @@ get_property (GObject    *object,
     }
 }
 
+GQuark
+milter_manager_applicable_condition_error_quark (void)
+{
+    return g_quark_from_static_string("milter-manager-applicable-condition-error-quark");
+}
+
 MilterManagerApplicableCondition *
 milter_manager_applicable_condition_new (const gchar *name)
 {
@@ -285,12 +406,612 @@ milter_manager_applicable_condition_merge (MilterManagerApplicableCondition *con
         milter_manager_applicable_condition_set_data(condition, data);
 }
 
+static gboolean
+parse_network (Network *network, const gchar *spec, GError **error)
+{
+    const gchar *slash;
+    gchar *address;
+    guint max_prefix_length;
+    guint i;
+
+    slash = strchr(spec, '/');
+    if (slash)
+        address = g_strndup(spec, slash - spec);
+    else
+        address = g_strdup(spec);
+
+    memset(network->address, 0, sizeof(network->address));
+    if (inet_pton(AF_INET, address, network->address) == 1) {
+        network->family = AF_INET;
+        max_prefix_length = 32;
+    } else if (inet_pton(AF_INET6, address, network->address) == 1) {
+        network->family = AF_INET6;
+        max_prefix_length = 128;
+    } else {
+        g_set_error(error,
+                    MILTER_MANAGER_APPLICABLE_CONDITION_ERROR,
+                    MILTER_MANAGER_APPLICABLE_CONDITION_ERROR_INVALID_NETWORK,
+                    "invalid network address: <%s>", spec);
+        g_free(address);
+        return FALSE;
+    }
+    g_free(address);
+
+    network->prefix_length = max_prefix_length;
+    if (slash) {
+        gchar *end = NULL;
+        guint64 prefix_length;
+
+        prefix_length = g_ascii_strtoull(slash + 1, &end, 10);
+        if (slash[1] == '\0' || *end != '\0' ||
+            prefix_length > max_prefix_length) {
+            g_set_error(error,
+                        MILTER_MANAGER_APPLICABLE_CONDITION_ERROR,
+                        MILTER_MANAGER_APPLICABLE_CONDITION_ERROR_INVALID_NETWORK,
+                        "invalid network prefix length: <%s>", spec);
+            return FALSE;
+        }
+        network->prefix_length = prefix_length;
+    }
+
+    for (i = 0; i < max_prefix_length / 8; i++) {
+        guint n_bits = i * 8;
+
+        if (n_bits >= network->prefix_length)
+            network->address[i] = 0;
+        else if (n_bits + 8 > network->prefix_length)
+            network->address[i] &= 0xff << (8 - (network->prefix_length - n_bits));
+    }
+
+    return TRUE;
+}
+
+static gboolean
+network_include (const Network *network, gint family, const guint8 *address)
+{
+    guint n_bytes, n_rest_bits;
+
+    if (network->family != family)
+        return FALSE;
+
+    n_bytes = network->prefix_length / 8;
+    if (memcmp(network->address, address, n_bytes) != 0)
+        return FALSE;
+
+    n_rest_bits = network->prefix_length % 8;
+    if (n_rest_bits > 0) {
+        guint8 mask = 0xff << (8 - n_rest_bits);
+        if ((network->address[n_bytes] & mask) != (address[n_bytes] & mask))
+            return FALSE;
+    }
+
+    return TRUE;
+}
+
+static gboolean
+networks_include (GArray *networks, MilterGenericSocketAddress *address)
+{
+    gint family;
+    const guint8 *raw_address;
+    guint i;
+
+    switch (address->address.base.sa_family) {
+    case AF_INET:
+        family = AF_INET;
+        raw_address = (const guint8 *)&(address->address.inet.sin_addr);
+        break;
+    case AF_INET6:
+        raw_address = address->address.inet6.sin6_addr.s6_addr;
+        if (IN6_IS_ADDR_V4MAPPED(&(address->address.inet6.sin6_addr))) {
+            family = AF_INET;
+            raw_address += 12;
+        } else {
+            family = AF_INET6;
+        }
+        break;
+    default:
+        return FALSE;
+    }
+
+    for (i = 0; i < networks->len; i++) {
+        if (network_include(&g_array_index(networks, Network, i),
+                            family, raw_address))
+            return TRUE;
+    }
+
+    return FALSE;
+}
+
+static gboolean
+add_network (GArray **networks, const gchar *network, GError **error)
+{
+    Network parsed_network;
+
+    if (!parse_network(&parsed_network, network, error))
+        return FALSE;
+
+    if (!*networks)
+        *networks = g_array_new(FALSE, FALSE, sizeof(Network));
+    g_array_append_val(*networks, parsed_network);
+
+    return TRUE;
+}
+
+gboolean
+milter_manager_applicable_condition_add_network (MilterManagerApplicableCondition *condition,
+                                                 const gchar *network,
+                                                 gboolean apply,
+                                                 GError **error)
+{
+    MilterManagerApplicableConditionPrivate *priv;
+
+    priv = MILTER_MANAGER_APPLICABLE_CONDITION_GET_PRIVATE(condition);
+    if (apply)
+        return add_network(&(priv->apply_networks), network, error);
+    else
+        return add_network(&(priv->skip_networks), network, error);
+}
+
+gboolean
+milter_manager_applicable_condition_add_local_network (MilterManagerApplicableCondition *condition,
+                                                       const gchar *network,
+                                                       GError **error)
+{
+    MilterManagerApplicableConditionPrivate *priv;
+
+    priv = MILTER_MANAGER_APPLICABLE_CONDITION_GET_PRIVATE(condition);
+    return add_network(&(priv->local_networks), network, error);
+}
+
+gboolean
+milter_manager_applicable_condition_add_remote_network (MilterManagerApplicableCondition *condition,
+                                                        const gchar *network,
+                                                        GError **error)
+{
+    MilterManagerApplicableConditionPrivate *priv;
+
+    priv = MILTER_MANAGER_APPLICABLE_CONDITION_GET_PRIVATE(condition);
+    return add_network(&(priv->remote_networks), network, error);
+}
+
+static void
+domain_set_add (DomainSet *set, const gchar *domain, gboolean apply)
+{
+    GHashTable **domains;
+
+    if (apply)
+        domains = &(set->apply);
+    else
+        domains = &(set->skip);
+    if (!*domains)
+        *domains = g_hash_table_new_full(g_str_hash, g_str_equal,
+                                         g_free, NULL);
+    g_hash_table_insert(*domains,
+                        g_ascii_strdown(domain, -1),
+                        GINT_TO_POINTER(TRUE));
+}
+
+static gboolean
+domain_set_is_empty (DomainSet *set)
+{
+    return !set->apply && !set->skip;
+}
+
+static gchar *
+extract_domain (const gchar *address)
+{
+    const gchar *at, *end;
+
+    if (!address)
+        return NULL;
+
+    at = strrchr(address, '@');
+    if (!at)
+        return NULL;
+
+    for (end = at + 1; *end && *end != '>'; end++)
+        ;
+    return g_ascii_strdown(at + 1, end - (at + 1));
+}
+
+static gboolean
+domain_set_should_stop (DomainSet *set, const gchar *address)
+{
+    gchar *domain;
+    gboolean stop = FALSE;
+
+    domain = extract_domain(address);
+    if (domain) {
+        if (set->skip && g_hash_table_lookup(set->skip, domain))
+            stop = TRUE;
+        else if (set->apply && !g_hash_table_lookup(set->apply, domain))
+            stop = TRUE;
+        g_free(domain);
+    } else {
+        stop = (set->apply != NULL);
+    }
+
+    return stop;
+}
+
+void
+milter_manager_applicable_condition_add_envelope_from_domain (MilterManagerApplicableCondition *condition,
+                                                              const gchar *domain,
+                                                              gboolean apply)
+{
+    MilterManagerApplicableConditionPrivate *priv;
+
+    priv = MILTER_MANAGER_APPLICABLE_CONDITION_GET_PRIVATE(condition);
+    domain_set_add(&(priv->envelope_from_domains), domain, apply);
+}
+
+void
+milter_manager_applicable_condition_add_envelope_recipient_domain (MilterManagerApplicableCondition *condition,
+                                                                   const gchar *domain,
+                                                                   gboolean apply)
+{
+    MilterManagerApplicableConditionPrivate *priv;
+
+    priv = MILTER_MANAGER_APPLICABLE_CONDITION_GET_PRIVATE(condition);
+    domain_set_add(&(priv->envelope_recipient_domains), domain, apply);
+}
+
+static gboolean
+command_to_stage (MilterCommand command, MilterMacroStage *stage,
+                  GError **error)
+{
+    switch (command) {
+    case MILTER_COMMAND_CONNECT:
+        *stage = MILTER_MACRO_STAGE_CONNECT;
+        break;
+    case MILTER_COMMAND_HELO:
+        *stage = MILTER_MACRO_STAGE_HELO;
+        break;
+    case MILTER_COMMAND_ENVELOPE_FROM:
+        *stage = MILTER_MACRO_STAGE_ENVELOPE_FROM;
+        break;
+    case MILTER_COMMAND_ENVELOPE_RECIPIENT:
+        *stage = MILTER_MACRO_STAGE_ENVELOPE_RECIPIENT;
+        break;
+    case MILTER_COMMAND_DATA:
+        *stage = MILTER_MACRO_STAGE_DATA;
+        break;
+    case MILTER_COMMAND_END_OF_HEADER:
+        *stage = MILTER_MACRO_STAGE_END_OF_HEADER;
+        break;
+    case MILTER_COMMAND_END_OF_MESSAGE:
+        *stage = MILTER_MACRO_STAGE_END_OF_MESSAGE;
+        break;
+    default:
+        g_set_error(error,
+                    MILTER_MANAGER_APPLICABLE_CONDITION_ERROR,
+                    MILTER_MANAGER_APPLICABLE_CONDITION_ERROR_UNSUPPORTED_COMMAND,
+                    "unsupported command for macro rule: <%c>", command);
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
+static void
+add_macro_rule (MilterManagerApplicableCondition *condition,
+                MilterMacroStage stage, const gchar *name,
+                gchar *value, GRegex *regex, gboolean apply)
+{
+    MilterManagerApplicableConditionPrivate *priv;
+    MacroRule *rule;
+
+    priv = MILTER_MANAGER_APPLICABLE_CONDITION_GET_PRIVATE(condition);
+    rule = g_new0(MacroRule, 1);
+    rule->stage = stage;
+    rule->name = g_strdup(name);
+    rule->value = value;
+    rule->regex = regex;
+    rule->apply = apply;
+    priv->macro_rules = g_list_append(priv->macro_rules, rule);
+    priv->macro_stages |= STAGE_BIT(stage);
+}
+
+gboolean
+milter_manager_applicable_condition_add_macro_equal (MilterManagerApplicableCondition *condition,
+                                                     MilterCommand command,
+                                                     const gchar *name,
+                                                     const gchar *value,
+                                                     gboolean apply,
+                                                     GError **error)
+{
+    MilterMacroStage stage;
+
+    if (!command_to_stage(command, &stage, error))
+        return FALSE;
+
+    add_macro_rule(condition, stage, name, g_strdup(value), NULL, apply);
+    return TRUE;
+}
+
+gboolean
+milter_manager_applicable_condition_add_macro_regex (MilterManagerApplicableCondition *condition,
+                                                     MilterCommand command,
+                                                     const gchar *name,
+                                                     const gchar *pattern,
+                                                     gboolean apply,
+                                                     GError **error)
+{
+    MilterMacroStage stage;
+    GRegex *regex;
+    GError *regex_error = NULL;
+
+    if (!command_to_stage(command, &stage, error))
+        return FALSE;
+
+    regex = g_regex_new(pattern, G_REGEX_OPTIMIZE, 0, &regex_error);
+    if (!regex) {
+        g_set_error(error,
+                    MILTER_MANAGER_APPLICABLE_CONDITION_ERROR,
+                    MILTER_MANAGER_APPLICABLE_CONDITION_ERROR_INVALID_PATTERN,
+                    "invalid macro pattern: <%s>: %s",
+                    pattern, regex_error->message);
+        g_error_free(regex_error);
+        return FALSE;
+    }
+
+    add_macro_rule(condition, stage, name, NULL, regex, apply);
+    return TRUE;
+}
+
+void
+milter_manager_applicable_condition_set_threshold_n_connections (MilterManagerApplicableCondition *condition,
+                                                                 guint threshold_n_connections)
+{
+    MILTER_MANAGER_APPLICABLE_CONDITION_GET_PRIVATE(condition)->threshold_n_connections =
+        threshold_n_connections;
+}
+
+guint
+milter_manager_applicable_condition_get_threshold_n_connections (MilterManagerApplicableCondition *condition)
+{
+    return MILTER_MANAGER_APPLICABLE_CONDITION_GET_PRIVATE(condition)->threshold_n_connections;
+}
+
+void
+milter_manager_applicable_condition_set_notify_stress (MilterManagerApplicableCondition *condition,
+                                                       gboolean notify_stress)
+{
+    MILTER_MANAGER_APPLICABLE_CONDITION_GET_PRIVATE(condition)->notify_stress =
+        notify_stress;
+}
+
+gboolean
+milter_manager_applicable_condition_is_notify_stress (MilterManagerApplicableCondition *condition)
+{
+    return MILTER_MANAGER_APPLICABLE_CONDITION_GET_PRIVATE(condition)->notify_stress;
+}
+
+void
+milter_manager_applicable_condition_set_authentication (MilterManagerApplicableCondition *condition,
+                                                        gboolean apply)
+{
+    MilterManagerApplicableConditionPrivate *priv;
+
+    priv = MILTER_MANAGER_APPLICABLE_CONDITION_GET_PRIVATE(condition);
+    priv->have_authentication_rule = TRUE;
+    priv->authentication_apply = apply;
+}
+
+gboolean
+milter_manager_applicable_condition_have_native_rule (MilterManagerApplicableCondition *condition)
+{
+    MilterManagerApplicableConditionPrivate *priv;
+
+    priv = MILTER_MANAGER_APPLICABLE_CONDITION_GET_PRIVATE(condition);
+    return priv->apply_networks ||
+        priv->skip_networks ||
+        priv->local_networks ||
+        priv->remote_networks ||
+        priv->have_authentication_rule ||
+        !domain_set_is_empty(&(priv->envelope_from_domains)) ||
+        !domain_set_is_empty(&(priv->envelope_recipient_domains)) ||
+        priv->macro_rules ||
+        priv->threshold_n_connections > 0;
+}
+
+static gboolean
+macro_rules_should_stop (MilterManagerApplicableCondition *condition,
+                         MilterManagerChild *child,
+                         MilterMacroStage stage)
+{
+    MilterManagerApplicableConditionPrivate *priv;
+    GList *node;
+
+    priv = MILTER_MANAGER_APPLICABLE_CONDITION_GET_PRIVATE(condition);
+    if (!(priv->macro_stages & STAGE_BIT(stage)))
+        return FALSE;
+
+    for (node = priv->macro_rules; node; node = g_list_next(node)) {
+        MacroRule *rule = node->data;
+        const gchar *value;
+        gboolean matched = FALSE;
+
+        if (rule->stage != stage)
+            continue;
+
+        value = milter_protocol_agent_get_macro(MILTER_PROTOCOL_AGENT(child),
+                                                rule->name);
+        if (value) {
+            if (rule->regex)
+                matched = g_regex_match(rule->regex, value, 0, NULL);
+            else
+                matched = (strcmp(rule->value, value) == 0);
+        }
+
+        if (matched != rule->apply) {
+            milter_debug("[applicable-condition][native][stop][macro] "
+                         "<%s>:<%s>=<%s>",
+                         priv->name, rule->name, value ? value : "(null)");
+            return TRUE;
+        }
+    }
+
+    return FALSE;
+}
+
+static gboolean
+is_remote_address (MilterManagerApplicableConditionPrivate *priv,
+                   MilterGenericSocketAddress *address)
+{
+    if (!address)
+        return FALSE;
+
+    switch (address->address.base.sa_family) {
+    case AF_INET:
+    case AF_INET6:
+        break;
+    default:
+        return FALSE;
+    }
+
+    if (priv->remote_networks &&
+        networks_include(priv->remote_networks, address))
+        return TRUE;
+    if (priv->local_networks &&
+        networks_include(priv->local_networks, address))
+        return FALSE;
+    return TRUE;
+}
+
+static gboolean
+is_authenticated (MilterManagerChild *child)
+{
+    MilterProtocolAgent *agent;
+
+    agent = MILTER_PROTOCOL_AGENT(child);
+    return milter_protocol_agent_get_macro(agent, "auth_type") ||
+        milter_protocol_agent_get_macro(agent, "auth_authen");
+}
+
+gboolean
+milter_manager_applicable_condition_should_stop_on_connect (MilterManagerApplicableCondition *condition,
+                                                            MilterManagerChild *child,
+                                                            MilterClientContext *context,
+                                                            const gchar *host_name,
+                                                            MilterGenericSocketAddress *address)
+{
+    MilterManagerApplicableConditionPrivate *priv;
+
+    priv = MILTER_MANAGER_APPLICABLE_CONDITION_GET_PRIVATE(condition);
+    if (priv->threshold_n_connections > 0 && context) {
+        guint n_processing_sessions;
+
+        n_processing_sessions =
+            milter_client_context_get_n_processing_sessions(context);
+        if (priv->threshold_n_connections <= n_processing_sessions) {
+            if (!priv->notify_stress) {
+                milter_debug("[applicable-condition][native][stop][stress] "
+                             "<%s>: %u <= %u",
+                             priv->name,
+                             priv->threshold_n_connections,
+                             n_processing_sessions);
+                return TRUE;
+            }
+            milter_debug("[applicable-condition][native][stress][notify] "
+                         "<%s>: %u <= %u",
+                         priv->name,
+                         priv->threshold_n_connections,
+                         n_processing_sessions);
+            milter_protocol_agent_set_macro(MILTER_PROTOCOL_AGENT(child),
+                                            MILTER_COMMAND_CONNECT,
+                                            "stress", "yes");
+        }
+    }
+
+    if ((priv->local_networks || priv->remote_networks) &&
+        !is_remote_address(priv, address)) {
+        milter_debug("[applicable-condition][native][stop][network][local] "
+                     "<%s>:<%s>", priv->name, host_name);
+        return TRUE;
+    }
+    if (priv->skip_networks && address &&
+        networks_include(priv->skip_networks, address)) {
+        milter_debug("[applicable-condition][native][stop][network][skip] "
+                     "<%s>:<%s>", priv->name, host_name);
+        return TRUE;
+    }
+    if (priv->apply_networks &&
+        !(address && networks_include(priv->apply_networks, address))) {
+        milter_debug("[applicable-condition][native][stop][network][apply] "
+                     "<%s>:<%s>", priv->name, host_name);
+        return TRUE;
+    }
+
+    return macro_rules_should_stop(condition, child,
+                                   MILTER_MACRO_STAGE_CONNECT);
+}
+
+gboolean
+milter_manager_applicable_condition_should_stop (MilterManagerApplicableCondition *condition,
+                                                 MilterManagerChild *child,
+                                                 MilterServerContextState state,
+                                                 const gchar *argument)
+{
+    MilterManagerApplicableConditionPrivate *priv;
+
+    priv = MILTER_MANAGER_APPLICABLE_CONDITION_GET_PRIVATE(condition);
+    switch (state) {
+    case MILTER_SERVER_CONTEXT_STATE_HELO:
+        return macro_rules_should_stop(condition, child,
+                                       MILTER_MACRO_STAGE_HELO);
+    case MILTER_SERVER_CONTEXT_STATE_ENVELOPE_FROM:
+        if (!domain_set_is_empty(&(priv->envelope_from_domains)) &&
+            domain_set_should_stop(&(priv->envelope_from_domains), argument)) {
+            milter_debug("[applicable-condition][native][stop][envelope-from] "
+                         "<%s>:<%s>", priv->name, argument);
+            return TRUE;
+        }
+        if (priv->have_authentication_rule &&
+            is_authenticated(child) != priv->authentication_apply) {
+            milter_debug("[applicable-condition][native][stop][authentication] "
+                         "<%s>:<%s>", priv->name, argument);
+            return TRUE;
+        }
+        return macro_rules_should_stop(condition, child,
+                                       MILTER_MACRO_STAGE_ENVELOPE_FROM);
+    case MILTER_SERVER_CONTEXT_STATE_ENVELOPE_RECIPIENT:
+        if (!domain_set_is_empty(&(priv->envelope_recipient_domains)) &&
+            domain_set_should_stop(&(priv->envelope_recipient_domains),
+                                   argument)) {
+            milter_debug("[applicable-condition][native][stop]"
+                         "[envelope-recipient] <%s>:<%s>",
+                         priv->name, argument);
+            return TRUE;
+        }
+        return macro_rules_should_stop(condition, child,
+                                       MILTER_MACRO_STAGE_ENVELOPE_RECIPIENT);
+    case MILTER_SERVER_CONTEXT_STATE_DATA:
+        return macro_rules_should_stop(condition, child,
+                                       MILTER_MACRO_STAGE_DATA);
+    case MILTER_SERVER_CONTEXT_STATE_END_OF_HEADER:
+        return macro_rules_should_stop(condition, child,
+                                       MILTER_MACRO_STAGE_END_OF_HEADER);
+    case MILTER_SERVER_CONTEXT_STATE_END_OF_MESSAGE:
+        return macro_rules_should_stop(condition, child,
+                                       MILTER_MACRO_STAGE_END_OF_MESSAGE);
+    default:
+        break;
+    }
+
+    return FALSE;
+}
+
 void
 milter_manager_applicable_condition_attach_to (MilterManagerApplicableCondition *condition,
                                                MilterManagerChild               *child,
                                                MilterManagerChildren            *children,
                                                MilterClientContext              *context)
 {
+    if (children &&
+        milter_manager_applicable_condition_have_native_rule(condition))
+        milter_manager_children_add_native_condition(children, child,
+                                                     condition, context);
     g_signal_emit(condition, signals[ATTACH_TO], 0, child, children, context);
 }
 
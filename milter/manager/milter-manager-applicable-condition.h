@@ -30,6 +30,8 @@
 
 G_BEGIN_DECLS
 
+#define MILTER_MANAGER_APPLICABLE_CONDITION_ERROR           (milter_manager_applicable_condition_error_quark())
+
 #define MILTER_TYPE_MANAGER_APPLICABLE_CONDITION            (milter_manager_applicable_condition_get_type())
 #define MILTER_MANAGER_APPLICABLE_CONDITION(obj)            (G_TYPE_CHECK_INSTANCE_CAST((obj), MILTER_TYPE_MANAGER_APPLICABLE_CONDITION, MilterManagerApplicableCondition))
 #define MILTER_MANAGER_APPLICABLE_CONDITION_CLASS(klass)    (G_TYPE_CHECK_CLASS_CAST((klass), MILTER_TYPE_MANAGER_APPLICABLE_CONDITION, MilterManagerApplicableConditionClass))
@@ -37,6 +39,13 @@ G_BEGIN_DECLS
 #define MILTER_MANAGER_IS_APPLICABLE_CONDITION_CLASS(klass) (G_TYPE_CHECK_CLASS_TYPE((klass), MILTER_TYPE_MANAGER_APPLICABLE_CONDITION))
 #define MILTER_MANAGER_APPLICABLE_CONDITION_GET_CLASS(obj)  (G_TYPE_INSTANCE_GET_CLASS((obj), MILTER_TYPE_MANAGER_APPLICABLE_CONDITION, MilterManagerApplicableConditionClass))
 
+typedef enum
+{
+    MILTER_MANAGER_APPLICABLE_CONDITION_ERROR_INVALID_NETWORK,
+    MILTER_MANAGER_APPLICABLE_CONDITION_ERROR_INVALID_PATTERN,
+    MILTER_MANAGER_APPLICABLE_CONDITION_ERROR_UNSUPPORTED_COMMAND
+} MilterManagerApplicableConditionError;
+
 typedef struct _MilterManagerApplicableConditionClass    MilterManagerApplicableConditionClass;
 
 struct _MilterManagerApplicableCondition
@@ -54,6 +63,8 @@ struct _MilterManagerApplicableConditionClass
                        MilterClientContext              *context);
 };
 
+GQuark       milter_manager_applicable_condition_error_quark (void);
+
 GType        milter_manager_applicable_condition_get_type (void) G_GNUC_CONST;
 
 MilterManagerApplicableCondition *milter_manager_applicable_condition_new
@@ -79,6 +90,69 @@ void         milter_manager_applicable_condition_merge
                                    (MilterManagerApplicableCondition *condition,
                                     MilterManagerApplicableCondition *other_condition);
 
+gboolean     milter_manager_applicable_condition_add_network
+                                   (MilterManagerApplicableCondition *condition,
+                                    const gchar *network,
+                                    gboolean apply,
+                                    GError **error);
+gboolean     milter_manager_applicable_condition_add_local_network
+                                   (MilterManagerApplicableCondition *condition,
+                                    const gchar *network,
+                                    GError **error);
+gboolean     milter_manager_applicable_condition_add_remote_network
+                                   (MilterManagerApplicableCondition *condition,
+                                    const gchar *network,
+                                    GError **error);
+void         milter_manager_applicable_condition_add_envelope_from_domain
+                                   (MilterManagerApplicableCondition *condition,
+                                    const gchar *domain,
+                                    gboolean apply);
+void         milter_manager_applicable_condition_add_envelope_recipient_domain
+                                   (MilterManagerApplicableCondition *condition,
+                                    const gchar *domain,
+                                    gboolean apply);
+gboolean     milter_manager_applicable_condition_add_macro_equal
+                                   (MilterManagerApplicableCondition *condition,
+                                    MilterCommand command,
+                                    const gchar *name,
+                                    const gchar *value,
+                                    gboolean apply,
+                                    GError **error);
+gboolean     milter_manager_applicable_condition_add_macro_regex
+                                   (MilterManagerApplicableCondition *condition,
+                                    MilterCommand command,
+                                    const gchar *name,
+                                    const gchar *pattern,
+                                    gboolean apply,
+                                    GError **error);
+void         milter_manager_applicable_condition_set_threshold_n_connections
+                                   (MilterManagerApplicableCondition *condition,
+                                    guint threshold_n_connections);
+guint        milter_manager_applicable_condition_get_threshold_n_connections
+                                   (MilterManagerApplicableCondition *condition);
+void         milter_manager_applicable_condition_set_notify_stress
+                                   (MilterManagerApplicableCondition *condition,
+                                    gboolean notify_stress);
+gboolean     milter_manager_applicable_condition_is_notify_stress
+                                   (MilterManagerApplicableCondition *condition);
+void         milter_manager_applicable_condition_set_authentication
+                                   (MilterManagerApplicableCondition *condition,
+                                    gboolean apply);
+gboolean     milter_manager_applicable_condition_have_native_rule
+                                   (MilterManagerApplicableCondition *condition);
+
+gboolean     milter_manager_applicable_condition_should_stop_on_connect
+                                   (MilterManagerApplicableCondition *condition,
+                                    MilterManagerChild *child,
+                                    MilterClientContext *context,
+                                    const gchar *host_name,
+                                    MilterGenericSocketAddress *address);
+gboolean     milter_manager_applicable_condition_should_stop
+                                   (MilterManagerApplicableCondition *condition,
+                                    MilterManagerChild *child,
+                                    MilterServerContextState state,
+                                    const gchar *argument);
+
 void         milter_manager_applicable_condition_attach_to
                                    (MilterManagerApplicableCondition *condition,
                                     MilterManagerChild               *child,
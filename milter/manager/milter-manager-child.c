@@ -44,6 +44,8 @@ struct _MilterManagerChildPrivate
     gboolean search_path;
     MilterStatus fallback_status;
     gboolean evaluation_mode;
+    MilterOption *negotiate_reply_option;
+    gchar *parallel_group;
 };
 
 enum
@@ -55,7 +57,8 @@ enum
     PROP_WORKING_DIRECTORY,
     PROP_SEARCH_PATH,
     PROP_FALLBACK_STATUS,
-    PROP_REPUTATION_MODE
+    PROP_REPUTATION_MODE,
+    PROP_PARALLEL_GROUP
 };
 
 MILTER_DEFINE_ERROR_EMITTABLE_TYPE(MilterManagerChild,
@@ -135,6 +138,14 @@ milter_manager_child_class_init (MilterManagerChildClass *klass)
                                 G_PARAM_READWRITE);
     g_object_class_install_property(gobject_class, PROP_REPUTATION_MODE, spec);
 
+    spec = g_param_spec_string("parallel-group",
+                               "Parallel group",
+                               "The name of the group of children that "
+                               "process a message concurrently",
+                               NULL,
+                               G_PARAM_READWRITE);
+    g_object_class_install_property(gobject_class, PROP_PARALLEL_GROUP, spec);
+
     g_type_class_add_private(gobject_class,
                              sizeof(MilterManagerChildPrivate));
 }
@@ -152,6 +163,8 @@ milter_manager_child_init (MilterManagerChild *milter)
     priv->search_path = TRUE;
     priv->fallback_status = MILTER_STATUS_ACCEPT;
     priv->evaluation_mode = FALSE;
+    priv->negotiate_reply_option = NULL;
+    priv->parallel_group = NULL;
 }
 
 static void
@@ -181,6 +194,16 @@ dispose (GObject *object)
         priv->command_options = NULL;
     }
 
+    if (priv->negotiate_reply_option) {
+        g_object_unref(priv->negotiate_reply_option);
+        priv->negotiate_reply_option = NULL;
+    }
+
+    if (priv->parallel_group) {
+        g_free(priv->parallel_group);
+        priv->parallel_group = NULL;
+    }
+
     G_OBJECT_CLASS(milter_manager_child_parent_class)->dispose(object);
 }
 
@@ -223,6 +246,11 @@ set_property (GObject      *object,
     case PROP_REPUTATION_MODE:
         priv->evaluation_mode = g_value_get_boolean(value);
         break;
+    case PROP_PARALLEL_GROUP:
+        if (priv->parallel_group)
+            g_free(priv->parallel_group);
+        priv->parallel_group = g_value_dup_string(value);
+        break;
     default:
         G_OBJECT_WARN_INVALID_PROPERTY_ID(object, prop_id, pspec);
         break;
@@ -260,6 +288,9 @@ get_property (GObject    *object,
     case PROP_REPUTATION_MODE:
         g_value_set_boolean(value, priv->evaluation_mode);
         break;
+    case PROP_PARALLEL_GROUP:
+        g_value_set_string(value, priv->parallel_group);
+        break;
     default:
         G_OBJECT_WARN_INVALID_PROPERTY_ID(object, prop_id, pspec);
         break;
@@ -332,6 +363,32 @@ milter_manager_child_is_evaluation_mode (MilterManagerChild *milter)
     return MILTER_MANAGER_CHILD_GET_PRIVATE(milter)->evaluation_mode;
 }
 
+const gchar *
+milter_manager_child_get_parallel_group (MilterManagerChild *milter)
+{
+    return MILTER_MANAGER_CHILD_GET_PRIVATE(milter)->parallel_group;
+}
+
+void
+milter_manager_child_set_negotiate_reply_option (MilterManagerChild *milter,
+                                                 MilterOption *option)
+{
+    MilterManagerChildPrivate *priv;
+
+    priv = MILTER_MANAGER_CHILD_GET_PRIVATE(milter);
+    if (priv->negotiate_reply_option)
+        g_object_unref(priv->negotiate_reply_option);
+    priv->negotiate_reply_option = NULL;
+    if (option)
+        priv->negotiate_reply_option = milter_option_copy(option);
+}
+
+MilterOption *
+milter_manager_child_get_negotiate_reply_option (MilterManagerChild *milter)
+{
+    return MILTER_MANAGER_CHILD_GET_PRIVATE(milter)->negotiate_reply_option;
+}
+
 /*
 vi:ts=4:nowrap:ai:expandtab:sw=4
 */
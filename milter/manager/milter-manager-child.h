@@ -82,6 +82,14 @@ void                  milter_manager_child_set_evaluation_mode
                                                         gboolean evaluation_mode);
 gboolean              milter_manager_child_is_evaluation_mode
                                                        (MilterManagerChild *milter);
+const gchar          *milter_manager_child_get_parallel_group
+                                                       (MilterManagerChild *milter);
+
+void                  milter_manager_child_set_negotiate_reply_option
+                                                       (MilterManagerChild *milter,
+                                                        MilterOption       *option);
+MilterOption         *milter_manager_child_get_negotiate_reply_option
+                                                       (MilterManagerChild *milter);
 
 #endif /* __MILTER_MANAGER_CHILD_H__ */
 
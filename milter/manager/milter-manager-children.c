@@ -21,15 +21,25 @@
 #  include "../../config.h"
 #endif /* HAVE_CONFIG_H */
 
+#if defined(HAVE_MEMFD_CREATE) && !defined(_GNU_SOURCE)
+#  define _GNU_SOURCE
+#endif
+
 #include "milter-manager-children.h"
+#include "milter-manager-applicable-condition.h"
+
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
 
 #include <glib/gstdio.h>
 #include "milter-manager-configuration.h"
+#include "milter-manager-metrics.h"
+#include "milter-manager-statistics.h"
 #include "milter/core.h"
 #include "milter-manager-launch-command-encoder.h"
 
-#define MAX_ON_MEMORY_BODY_SIZE 5242880 /* 5Mbyte */
-
 #define MAX_SUPPORTED_MILTER_PROTOCOL_VERSION 6
 
 #define MILTER_MANAGER_CHILDREN_GET_PRIVATE(obj)                    \
@@ -65,10 +75,14 @@ struct _MilterManagerChildrenPrivate
     GList *command_waiting_child_queue; /* storing child milters which is waiting for commands after DATA command */
     GList *command_queue; /* storing commands after DATA command */
     PendingMessageRequest *pending_message_request;
+    MilterMemoryArena *message_arena;
+    guint n_message_arena_users;
+    gboolean message_arena_reset_pending;
     GHashTable *try_negotiate_ids;
     MilterManagerConfiguration *configuration;
     MilterMacrosRequests *macros_requests;
     MilterOption *option;
+    MilterOption *negotiate_option;
     MilterStepFlags initial_yes_steps;
     MilterStepFlags requested_yes_steps;
     gboolean negotiated;
@@ -87,8 +101,17 @@ struct _MilterManagerChildrenPrivate
     MilterHeaders *headers;
     gint processing_header_index;
     GString *body;
-    GIOChannel *body_file;
-    gchar *body_file_name;
+    gint body_fd;
+    gboolean body_file_on_memory;
+    gsize body_file_size;
+    gchar *body_map;
+    gsize body_map_size;
+    gboolean body_streaming;
+    gboolean body_writing;
+    guint body_generation;
+    gsize body_forward_size;
+    GQueue *body_write_queue;
+    gboolean end_of_message_waiting_body;
     gchar *end_of_message_chunk;
     gsize end_of_message_size;
     guint sending_body;
@@ -109,6 +132,101 @@ struct _MilterManagerChildrenPrivate
     MilterEventLoop *event_loop;
 
     guint lazy_reply_negotiate_id;
+    GList *pooled_negotiate_replies;
+    guint pooled_negotiate_reply_id;
+
+    GList *parallel_tasks;
+    MilterServerContext *parallel_group_leader;
+    guint parallel_group_lock;
+
+    GList *body_followers;
+    guint body_follower_lock;
+    gboolean body_followers_dispose_pending;
+    gboolean body_reply_pending;
+
+    GList *native_conditions;
+};
+
+typedef struct _NativeCondition NativeCondition;
+struct _NativeCondition
+{
+    MilterManagerChild *child;
+    MilterManagerApplicableCondition *condition;
+    MilterClientContext *context;
+};
+
+typedef struct _PooledNegotiateReply PooledNegotiateReply;
+struct _PooledNegotiateReply
+{
+    MilterManagerChild *child;
+    MilterOption *option;
+    MilterMacrosRequests *macros_requests;
+};
+
+typedef enum
+{
+    PARALLEL_MODIFICATION_ADD_HEADER,
+    PARALLEL_MODIFICATION_INSERT_HEADER,
+    PARALLEL_MODIFICATION_CHANGE_HEADER,
+    PARALLEL_MODIFICATION_DELETE_HEADER,
+    PARALLEL_MODIFICATION_CHANGE_FROM,
+    PARALLEL_MODIFICATION_ADD_RECIPIENT,
+    PARALLEL_MODIFICATION_DELETE_RECIPIENT,
+    PARALLEL_MODIFICATION_QUARANTINE
+} ParallelModificationType;
+
+typedef struct _ParallelModification ParallelModification;
+struct _ParallelModification
+{
+    ParallelModificationType type;
+    guint32 index;
+    gchar *name;
+    gchar *value;
+};
+
+/* a child in a parallel group replays the message with its own cursor
+ * and keeps its modifications until the whole group replies. */
+typedef struct _ParallelTask ParallelTask;
+struct _ParallelTask
+{
+    MilterServerContext *context;
+    GList *command_node;
+    gboolean command_sent;
+    gint header_index;
+    gsize body_offset;
+    gboolean finished;
+    MilterServerContextState state;
+    MilterStatus status;
+    GList *modifications;
+    GString *replaced_body;
+    guint reply_code;
+    gchar *reply_extended_code;
+    gchar *reply_message;
+};
+
+#define BODY_FOLLOWER_MAX_QUEUED_CHUNKS 8
+
+/* a later serial child that reads headers and body while an earlier
+ * child is still reading them. It gets end-of-message, and its reply
+ * takes effect, only when its turn comes. */
+typedef struct _BodyFollower BodyFollower;
+struct _BodyFollower
+{
+    MilterServerContext *context;
+    GList *command_node;
+    gboolean command_sent;
+    gint header_index;
+    GQueue *chunks;
+    gboolean waiting_reply;
+    gboolean skip_body;
+    gboolean turn;
+    gboolean released;
+    gboolean finished;
+    MilterServerContextState state;
+    MilterStatus status;
+    guint reply_code;
+    gchar *reply_extended_code;
+    gchar *reply_message;
 };
 
 typedef struct _NegotiateData NegotiateData;
@@ -184,7 +302,57 @@ static MilterServerContext *get_first_child_in_command_waiting_child_queue
                            (MilterManagerChildren *children);
 static gboolean write_body (MilterManagerChildren *children,
                             const gchar *chunk,
-                            gsize size);
+                            gsize size,
+                            gboolean asynchronous);
+static gboolean is_parallel_child
+                           (MilterServerContext *context);
+static MilterStatus send_command_to_parallel_group
+                           (MilterManagerChildren *children,
+                            MilterServerContext *leader);
+static ParallelTask *find_parallel_task
+                           (MilterManagerChildren *children,
+                            MilterServerContext *context);
+static void parallel_task_continue
+                           (MilterManagerChildren *children,
+                            ParallelTask *task,
+                            MilterServerContextState state);
+static void parallel_task_skip
+                           (MilterManagerChildren *children,
+                            ParallelTask *task);
+static gboolean handle_parallel_task_reply
+                           (MilterManagerChildren *children,
+                            MilterServerContext *context,
+                            MilterServerContextState state,
+                            MilterStatus status);
+static gboolean expire_parallel_task
+                           (MilterManagerChildren *children,
+                            MilterServerContext *context,
+                            MilterServerContextState state,
+                            MilterStatus status);
+static BodyFollower *find_body_follower
+                           (MilterManagerChildren *children,
+                            MilterServerContext *context);
+static void body_follower_continue
+                           (MilterManagerChildren *children,
+                            BodyFollower *follower);
+static void body_follower_skip
+                           (MilterManagerChildren *children,
+                            BodyFollower *follower);
+static void body_follower_start_turn
+                           (MilterManagerChildren *children,
+                            BodyFollower *follower);
+static gboolean handle_body_follower_reply
+                           (MilterManagerChildren *children,
+                            MilterServerContext *context,
+                            MilterServerContextState state,
+                            MilterStatus status);
+static gboolean expire_body_follower
+                           (MilterManagerChildren *children,
+                            MilterServerContext *context,
+                            MilterServerContextState state,
+                            MilterStatus status);
+static void reply_body_continue
+                           (MilterManagerChildren *children);
 static MilterStatus init_child_for_body
                            (MilterManagerChildren *children,
                             MilterServerContext *context);
@@ -262,6 +430,9 @@ milter_manager_children_init (MilterManagerChildren *milter)
     priv->command_waiting_child_queue = NULL;
     priv->command_queue = NULL;
     priv->pending_message_request = NULL;
+    priv->message_arena = milter_memory_arena_new(0);
+    priv->n_message_arena_users = 0;
+    priv->message_arena_reset_pending = FALSE;
     priv->try_negotiate_ids =
         g_hash_table_new_full(g_direct_hash, g_direct_equal,
                               negotiate_data_hash_key_free,
@@ -269,6 +440,7 @@ milter_manager_children_init (MilterManagerChildren *milter)
     priv->milters = NULL;
     priv->macros_requests = milter_macros_requests_new();
     priv->option = NULL;
+    priv->negotiate_option = NULL;
     priv->initial_yes_steps = MILTER_STEP_NONE;
     priv->requested_yes_steps = MILTER_STEP_NONE;
     priv->negotiated = FALSE;
@@ -281,8 +453,18 @@ milter_manager_children_init (MilterManagerChildren *milter)
     priv->headers = NULL;
     priv->processing_header_index = 0;
     priv->body = NULL;
-    priv->body_file = NULL;
-    priv->body_file_name = NULL;
+    priv->body_fd = -1;
+    priv->body_file_on_memory = FALSE;
+    priv->body_file_size = 0;
+    priv->body_map = NULL;
+    priv->body_map_size = 0;
+    priv->body_streaming = FALSE;
+    priv->body_writing = FALSE;
+    priv->body_generation = 0;
+    priv->body_forward_size = 0;
+    priv->body_write_queue = g_queue_new();
+    priv->native_conditions = NULL;
+    priv->end_of_message_waiting_body = FALSE;
     priv->end_of_message_chunk = NULL;
     priv->end_of_message_size = 0;
     priv->sending_body = FALSE;
@@ -312,6 +494,17 @@ milter_manager_children_init (MilterManagerChildren *milter)
     priv->event_loop = NULL;
 
     priv->lazy_reply_negotiate_id = 0;
+    priv->pooled_negotiate_replies = NULL;
+    priv->pooled_negotiate_reply_id = 0;
+
+    priv->parallel_tasks = NULL;
+    priv->parallel_group_leader = NULL;
+    priv->parallel_group_lock = 0;
+
+    priv->body_followers = NULL;
+    priv->body_follower_lock = 0;
+    priv->body_followers_dispose_pending = FALSE;
+    priv->body_reply_pending = FALSE;
 }
 
 static void
@@ -325,112 +518,427 @@ dispose_lazy_reply_negotiate_id (MilterManagerChildrenPrivate *priv)
     priv->lazy_reply_negotiate_id = 0;
 }
 
+static void
+pooled_negotiate_reply_free (PooledNegotiateReply *reply)
+{
+    g_object_unref(reply->child);
+    g_object_unref(reply->option);
+    if (reply->macros_requests)
+        g_object_unref(reply->macros_requests);
+    g_free(reply);
+}
+
+static void
+dispose_pooled_negotiate_replies (MilterManagerChildrenPrivate *priv)
+{
+    if (priv->pooled_negotiate_reply_id > 0) {
+        milter_event_loop_remove(priv->event_loop,
+                                 priv->pooled_negotiate_reply_id);
+        priv->pooled_negotiate_reply_id = 0;
+    }
+
+    if (priv->pooled_negotiate_replies) {
+        g_list_foreach(priv->pooled_negotiate_replies,
+                       (GFunc)pooled_negotiate_reply_free, NULL);
+        g_list_free(priv->pooled_negotiate_replies);
+        priv->pooled_negotiate_replies = NULL;
+    }
+}
+
+/*
+ * Message scoped data below are allocated from priv->message_arena
+ * and released at once by dispose_message_related_data().
+ */
 static PendingMessageRequest *
-pending_message_request_new (MilterCommand command)
+pending_message_request_new (MilterMemoryArena *arena, MilterCommand command)
 {
     PendingMessageRequest *request;
 
-    request = g_new0(PendingMessageRequest, 1);
+    request = milter_memory_arena_new0(arena, PendingMessageRequest);
     request->command = command;
 
     return request;
 }
 
 static PendingMessageRequest *
-pending_header_request_new (const gchar *name, const gchar *value)
+pending_header_request_new (MilterMemoryArena *arena,
+                            const gchar *name, const gchar *value)
 {
     PendingMessageRequest *request;
 
-    request = pending_message_request_new(MILTER_COMMAND_HEADER);
-    request->arguments.header.name = g_strdup(name);
-    request->arguments.header.value = g_strdup(value);
+    request = pending_message_request_new(arena, MILTER_COMMAND_HEADER);
+    request->arguments.header.name = milter_memory_arena_strdup(arena, name);
+    request->arguments.header.value = milter_memory_arena_strdup(arena, value);
 
     return request;
 }
 
 static PendingMessageRequest *
-pending_end_of_header_request_new (void)
+pending_end_of_header_request_new (MilterMemoryArena *arena)
 {
     PendingMessageRequest *request;
 
-    request = pending_message_request_new(MILTER_COMMAND_END_OF_HEADER);
+    request = pending_message_request_new(arena, MILTER_COMMAND_END_OF_HEADER);
 
     return request;
 }
 
 static PendingMessageRequest *
-pending_body_request_new (const gchar *chunk, gsize size)
+pending_body_request_new (MilterMemoryArena *arena,
+                          const gchar *chunk, gsize size)
 {
     PendingMessageRequest *request;
 
-    request = pending_message_request_new(MILTER_COMMAND_BODY);
-    request->arguments.body.chunk = g_strndup(chunk, size);
+    request = pending_message_request_new(arena, MILTER_COMMAND_BODY);
+    request->arguments.body.chunk =
+        milter_memory_arena_strndup(arena, chunk, size);
     request->arguments.body.size = size;
 
     return request;
 }
 
 static PendingMessageRequest *
-pending_end_of_message_request_new (const gchar *chunk, gsize size)
+pending_end_of_message_request_new (MilterMemoryArena *arena,
+                                    const gchar *chunk, gsize size)
 {
     PendingMessageRequest *request;
 
-    request = pending_message_request_new(MILTER_COMMAND_END_OF_MESSAGE);
-    request->arguments.end_of_message.chunk = g_strndup(chunk, size);
+    request = pending_message_request_new(arena, MILTER_COMMAND_END_OF_MESSAGE);
+    request->arguments.end_of_message.chunk =
+        milter_memory_arena_strndup(arena, chunk, size);
     request->arguments.end_of_message.size = size;
 
     return request;
 }
 
+static ParallelModification *
+parallel_modification_new (MilterMemoryArena *arena,
+                           ParallelModificationType type,
+                           guint32 index,
+                           const gchar *name,
+                           const gchar *value)
+{
+    ParallelModification *modification;
+
+    modification = milter_memory_arena_new0(arena, ParallelModification);
+    modification->type = type;
+    modification->index = index;
+    modification->name = milter_memory_arena_strdup(arena, name);
+    modification->value = milter_memory_arena_strdup(arena, value);
+
+    return modification;
+}
+
+static ParallelTask *
+parallel_task_new (MilterServerContext *context, GList *command_queue)
+{
+    ParallelTask *task;
+
+    task = g_new0(ParallelTask, 1);
+    task->context = context;
+    task->command_node = command_queue;
+    task->command_sent = FALSE;
+    task->header_index = 0;
+    task->body_offset = 0;
+    task->finished = FALSE;
+    task->state = MILTER_SERVER_CONTEXT_STATE_END_OF_MESSAGE;
+    task->status = MILTER_STATUS_NOT_CHANGE;
+    task->modifications = NULL;
+    task->replaced_body = NULL;
+    task->reply_code = 0;
+    task->reply_extended_code = NULL;
+    task->reply_message = NULL;
+
+    return task;
+}
+
 static void
-pending_message_request_free (PendingMessageRequest *request)
+parallel_task_free (ParallelTask *task)
 {
-    switch (request->command) {
-    case MILTER_COMMAND_HEADER:
-        g_free(request->arguments.header.name);
-        g_free(request->arguments.header.value);
-        break;
-    case MILTER_COMMAND_BODY:
-        g_free(request->arguments.body.chunk);
-        break;
-    case MILTER_COMMAND_END_OF_MESSAGE:
-        g_free(request->arguments.end_of_message.chunk);
-        break;
-    default:
-        break;
+    g_list_free(task->modifications);
+    if (task->replaced_body)
+        g_string_free(task->replaced_body, TRUE);
+    if (task->reply_extended_code)
+        g_free(task->reply_extended_code);
+    if (task->reply_message)
+        g_free(task->reply_message);
+    g_free(task);
+}
+
+static void
+dispose_parallel_tasks (MilterManagerChildrenPrivate *priv)
+{
+    if (priv->parallel_tasks) {
+        g_list_foreach(priv->parallel_tasks, (GFunc)parallel_task_free, NULL);
+        g_list_free(priv->parallel_tasks);
+        priv->parallel_tasks = NULL;
     }
-    g_free(request);
+    priv->parallel_group_leader = NULL;
+}
+
+static BodyFollower *
+body_follower_new (MilterServerContext *context, GList *command_queue)
+{
+    BodyFollower *follower;
+
+    follower = g_new0(BodyFollower, 1);
+    follower->context = context;
+    follower->command_node = command_queue;
+    follower->command_sent = FALSE;
+    follower->header_index = 0;
+    follower->chunks = g_queue_new();
+    follower->waiting_reply = FALSE;
+    follower->skip_body = FALSE;
+    follower->turn = FALSE;
+    follower->released = FALSE;
+    follower->finished = FALSE;
+    follower->state = MILTER_SERVER_CONTEXT_STATE_BODY;
+    follower->status = MILTER_STATUS_NOT_CHANGE;
+    follower->reply_code = 0;
+    follower->reply_extended_code = NULL;
+    follower->reply_message = NULL;
+
+    return follower;
+}
+
+static void
+body_follower_clear_chunks (BodyFollower *follower)
+{
+    GString *chunk;
+
+    while ((chunk = g_queue_pop_head(follower->chunks)))
+        g_string_free(chunk, TRUE);
+}
+
+static void
+body_follower_free (BodyFollower *follower)
+{
+    body_follower_clear_chunks(follower);
+    g_queue_free(follower->chunks);
+    if (follower->reply_extended_code)
+        g_free(follower->reply_extended_code);
+    if (follower->reply_message)
+        g_free(follower->reply_message);
+    g_free(follower);
+}
+
+static void
+free_body_followers (MilterManagerChildrenPrivate *priv)
+{
+    priv->body_followers_dispose_pending = FALSE;
+    if (priv->body_followers) {
+        g_list_foreach(priv->body_followers, (GFunc)body_follower_free, NULL);
+        g_list_free(priv->body_followers);
+        priv->body_followers = NULL;
+    }
+}
+
+static void
+dispose_body_followers (MilterManagerChildrenPrivate *priv)
+{
+    GList *node;
+
+    priv->body_reply_pending = FALSE;
+
+    /* followers must be alive while one of them is being processed. */
+    if (priv->body_follower_lock > 0) {
+        for (node = priv->body_followers; node; node = g_list_next(node)) {
+            BodyFollower *follower = node->data;
+
+            follower->released = TRUE;
+        }
+        priv->body_followers_dispose_pending = TRUE;
+        return;
+    }
+
+    free_body_followers(priv);
+}
+
+static void
+lock_body_followers (MilterManagerChildrenPrivate *priv)
+{
+    priv->body_follower_lock++;
+}
+
+static void
+unlock_body_followers (MilterManagerChildrenPrivate *priv)
+{
+    priv->body_follower_lock--;
+    if (priv->body_follower_lock == 0 &&
+        priv->body_followers_dispose_pending)
+        free_body_followers(priv);
 }
 
 static void
 dispose_pending_message_request (MilterManagerChildrenPrivate *priv)
 {
-    if (priv->pending_message_request) {
-        pending_message_request_free(priv->pending_message_request);
-        priv->pending_message_request = NULL;
+    priv->pending_message_request = NULL;
+}
+
+static void
+reset_message_arena (MilterManagerChildrenPrivate *priv)
+{
+    if (!priv->message_arena)
+        return;
+
+    /* A pending request being processed still refers to the arena. */
+    if (priv->n_message_arena_users > 0) {
+        priv->message_arena_reset_pending = TRUE;
+        return;
+    }
+
+    milter_memory_arena_reset(priv->message_arena);
+    priv->message_arena_reset_pending = FALSE;
+}
+
+/* gsize shared by all children. Loop threads update it concurrently. */
+static volatile gpointer body_memory_files_size = NULL;
+
+static gboolean
+reserve_body_memory (gsize size, guint64 budget)
+{
+    gsize current_size;
+
+    do {
+        current_size =
+            GPOINTER_TO_SIZE(g_atomic_pointer_get(&body_memory_files_size));
+        if (current_size + size > budget)
+            return FALSE;
+    } while (!g_atomic_pointer_compare_and_exchange(
+                 &body_memory_files_size,
+                 GSIZE_TO_POINTER(current_size),
+                 GSIZE_TO_POINTER(current_size + size)));
+
+    return TRUE;
+}
+
+static void
+release_body_memory (gsize size)
+{
+    gsize current_size;
+
+    do {
+        current_size =
+            GPOINTER_TO_SIZE(g_atomic_pointer_get(&body_memory_files_size));
+    } while (!g_atomic_pointer_compare_and_exchange(
+                 &body_memory_files_size,
+                 GSIZE_TO_POINTER(current_size),
+                 GSIZE_TO_POINTER(current_size - size)));
+}
+
+static void
+emit_body_file_error (MilterManagerChildren *children,
+                      const gchar *action,
+                      gint error_number)
+{
+    MilterManagerChildrenPrivate *priv;
+    GError *error = NULL;
+
+    priv = MILTER_MANAGER_CHILDREN_GET_PRIVATE(children);
+    g_set_error(&error,
+                G_FILE_ERROR,
+                g_file_error_from_errno(error_number),
+                "failed to %s body file: %s",
+                action, g_strerror(error_number));
+    milter_error("[%u] [children][error][body][%s] %s",
+                 priv->tag, action, error->message);
+    milter_error_emittable_emit(MILTER_ERROR_EMITTABLE(children), error);
+    g_error_free(error);
+}
+
+static void
+dispose_body_map (MilterManagerChildrenPrivate *priv)
+{
+    if (priv->body_map) {
+        munmap(priv->body_map, priv->body_map_size);
+        priv->body_map = NULL;
+        priv->body_map_size = 0;
+    }
+}
+
+static void
+clear_body_write_queue (MilterManagerChildrenPrivate *priv)
+{
+    GString *chunk;
+
+    while ((chunk = g_queue_pop_head(priv->body_write_queue)))
+        g_string_free(chunk, TRUE);
+    priv->end_of_message_waiting_body = FALSE;
+}
+
+static void
+dispose_body_file (MilterManagerChildrenPrivate *priv)
+{
+    dispose_body_map(priv);
+
+    /* Ignore the result of the in-flight write if any. */
+    priv->body_generation++;
+    priv->body_writing = FALSE;
+    priv->body_forward_size = 0;
+    clear_body_write_queue(priv);
+
+    if (priv->body_fd != -1) {
+        close(priv->body_fd);
+        priv->body_fd = -1;
+    }
+
+    if (priv->body_file_on_memory) {
+        release_body_memory(priv->body_file_size);
+        priv->body_file_on_memory = FALSE;
+    }
+    if (priv->body_file_size > 0)
+        milter_manager_metrics_add_body_spool_size(-(gssize)priv->body_file_size);
+    priv->body_file_size = 0;
+}
+
+static gboolean
+get_body (MilterManagerChildren *children, const gchar **body, gsize *size)
+{
+    MilterManagerChildrenPrivate *priv;
+    gpointer map;
+
+    priv = MILTER_MANAGER_CHILDREN_GET_PRIVATE(children);
+
+    if (priv->body) {
+        *body = priv->body->str;
+        *size = priv->body->len;
+        return TRUE;
+    }
+
+    *body = NULL;
+    *size = 0;
+    if (priv->body_fd == -1 || priv->body_file_size == 0)
+        return TRUE;
+
+    if (!priv->body_map || priv->body_map_size != priv->body_file_size) {
+        dispose_body_map(priv);
+        map = mmap(NULL, priv->body_file_size, PROT_READ, MAP_SHARED,
+                   priv->body_fd, 0);
+        if (map == MAP_FAILED) {
+            emit_body_file_error(children, "map", errno);
+            return FALSE;
+        }
+        priv->body_map = map;
+        priv->body_map_size = priv->body_file_size;
     }
+
+    *body = priv->body_map;
+    *size = priv->body_map_size;
+    return TRUE;
 }
 
 static void
 dispose_body_related_data (MilterManagerChildrenPrivate *priv)
 {
     priv->emitted_reply_for_message_oriented_command = FALSE;
+    priv->body_streaming = FALSE;
 
     if (priv->body) {
         g_string_free(priv->body, TRUE);
         priv->body = NULL;
     }
 
-    if (priv->body_file) {
-        g_io_channel_unref(priv->body_file);
-        priv->body_file = NULL;
-    }
-
-    if (priv->body_file_name) {
-        g_unlink(priv->body_file_name);
-        g_free(priv->body_file_name);
-        priv->body_file_name = NULL;
-    }
+    dispose_body_file(priv);
 }
 
 static void
@@ -453,6 +961,8 @@ static void
 dispose_message_related_data (MilterManagerChildrenPrivate *priv)
 {
     dispose_pending_message_request(priv);
+    dispose_parallel_tasks(priv);
+    dispose_body_followers(priv);
 
     if (priv->command_waiting_child_queue) {
         g_list_free(priv->command_waiting_child_queue);
@@ -476,10 +986,7 @@ dispose_message_related_data (MilterManagerChildrenPrivate *priv)
 
     dispose_body_related_data(priv);
 
-    if (priv->end_of_message_chunk) {
-        g_free(priv->end_of_message_chunk);
-        priv->end_of_message_chunk = NULL;
-    }
+    priv->end_of_message_chunk = NULL;
 
     if (priv->change_from) {
         g_free(priv->change_from);
@@ -495,6 +1002,8 @@ dispose_message_related_data (MilterManagerChildrenPrivate *priv)
         g_free(priv->quarantine_reason);
         priv->quarantine_reason = NULL;
     }
+
+    reset_message_arena(priv);
 }
 
 static void
@@ -507,6 +1016,16 @@ dispose_smtp_client_address (MilterManagerChildrenPrivate *priv)
     priv->smtp_client_address_length = 0;
 }
 
+static void
+native_condition_free (NativeCondition *native_condition)
+{
+    milter_server_context_set_stop_checker(
+        MILTER_SERVER_CONTEXT(native_condition->child), NULL, NULL);
+    g_object_unref(native_condition->child);
+    g_object_unref(native_condition->condition);
+    g_free(native_condition);
+}
+
 static void
 dispose (GObject *object)
 {
@@ -517,6 +1036,7 @@ dispose (GObject *object)
     milter_debug("[%u] [children][dispose]", priv->tag);
 
     dispose_lazy_reply_negotiate_id(priv);
+    dispose_pooled_negotiate_replies(priv);
 
     if (priv->reply_queue) {
         g_queue_free(priv->reply_queue);
@@ -535,6 +1055,13 @@ dispose (GObject *object)
         priv->configuration = NULL;
     }
 
+    if (priv->native_conditions) {
+        g_list_foreach(priv->native_conditions,
+                       (GFunc)native_condition_free, NULL);
+        g_list_free(priv->native_conditions);
+        priv->native_conditions = NULL;
+    }
+
     if (priv->milters) {
         g_list_foreach(priv->milters,
                        (GFunc)teardown_server_context_signals, object);
@@ -553,6 +1080,11 @@ dispose (GObject *object)
         priv->option = NULL;
     }
 
+    if (priv->negotiate_option) {
+        g_object_unref(priv->negotiate_option);
+        priv->negotiate_option = NULL;
+    }
+
     if (priv->reply_statuses) {
         g_hash_table_unref(priv->reply_statuses);
         priv->reply_statuses = NULL;
@@ -561,6 +1093,16 @@ dispose (GObject *object)
     dispose_reply_related_data(priv);
     dispose_message_related_data(priv);
 
+    if (priv->body_write_queue) {
+        g_queue_free(priv->body_write_queue);
+        priv->body_write_queue = NULL;
+    }
+
+    if (priv->message_arena) {
+        milter_memory_arena_free(priv->message_arena);
+        priv->message_arena = NULL;
+    }
+
     milter_manager_children_set_launcher_channel(MILTER_MANAGER_CHILDREN(object),
                                                  NULL, NULL);
 
@@ -670,6 +1212,10 @@ milter_manager_children_add_child (MilterManagerChildren *children,
 
     priv->milters = g_list_append(priv->milters, g_object_ref(child));
     milter_agent_set_event_loop(MILTER_AGENT(child), priv->event_loop);
+    if (priv->configuration)
+        milter_server_context_set_direct_write(
+            MILTER_SERVER_CONTEXT(child),
+            milter_manager_configuration_is_direct_write(priv->configuration));
 }
 
 guint
@@ -694,6 +1240,65 @@ milter_manager_children_foreach (MilterManagerChildren *children,
     g_list_foreach(milters, func, user_data);
 }
 
+static gboolean
+check_native_conditions (MilterServerContext *context,
+                         MilterServerContextState state,
+                         const gchar *argument,
+                         gpointer user_data)
+{
+    MilterManagerChildren *children = user_data;
+    MilterManagerChildrenPrivate *priv;
+    MilterManagerChild *child;
+    GList *node;
+
+    priv = MILTER_MANAGER_CHILDREN_GET_PRIVATE(children);
+    child = MILTER_MANAGER_CHILD(context);
+    for (node = priv->native_conditions; node; node = g_list_next(node)) {
+        NativeCondition *native_condition = node->data;
+        gboolean stop;
+
+        if (native_condition->child != child)
+            continue;
+
+        if (state == MILTER_SERVER_CONTEXT_STATE_CONNECT)
+            stop = milter_manager_applicable_condition_should_stop_on_connect(
+                native_condition->condition,
+                child,
+                native_condition->context,
+                argument,
+                (MilterGenericSocketAddress *)(priv->smtp_client_address));
+        else
+            stop = milter_manager_applicable_condition_should_stop(
+                native_condition->condition, child, state, argument);
+        if (stop)
+            return TRUE;
+    }
+
+    return FALSE;
+}
+
+void
+milter_manager_children_add_native_condition (MilterManagerChildren *children,
+                                              MilterManagerChild *child,
+                                              MilterManagerApplicableCondition *condition,
+                                              MilterClientContext *context)
+{
+    MilterManagerChildrenPrivate *priv;
+    NativeCondition *native_condition;
+
+    priv = MILTER_MANAGER_CHILDREN_GET_PRIVATE(children);
+
+    native_condition = g_new0(NativeCondition, 1);
+    native_condition->child = g_object_ref(child);
+    native_condition->condition = g_object_ref(condition);
+    native_condition->context = context;
+    priv->native_conditions = g_list_append(priv->native_conditions,
+                                            native_condition);
+    milter_server_context_set_stop_checker(MILTER_SERVER_CONTEXT(child),
+                                           check_native_conditions,
+                                           children);
+}
+
 static const gchar *
 status_to_signal_name (MilterStatus status)
 {
@@ -808,14 +1413,39 @@ cb_ready (MilterServerContext *context, gpointer user_data)
 }
 
 static void
-cb_negotiate_reply (MilterServerContext *context, MilterOption *option,
-                    MilterMacrosRequests *macros_requests, gpointer user_data)
+record_reply (MilterServerContext *context, MilterStatus status)
 {
-    MilterManagerChildren *children = user_data;
-    MilterManagerChildrenPrivate *priv;
+    milter_manager_metrics_record_reply(
+        milter_server_context_get_name(context),
+        milter_server_context_get_state(context),
+        status,
+        milter_server_context_get_reply_elapsed(context));
+}
+
+static void
+record_timeout (MilterServerContext *context,
+                MilterManagerMetricsTimeout timeout)
+{
+    milter_manager_metrics_record_timeout(
+        milter_server_context_get_name(context),
+        timeout);
+}
+
+static void
+cb_negotiate_reply (MilterReplySignals *reply, MilterOption *option,
+                    MilterMacrosRequests *macros_requests, gpointer user_data)
+{
+    MilterServerContext *context = MILTER_SERVER_CONTEXT(reply);
+    MilterManagerChildren *children = user_data;
+    MilterManagerChildrenPrivate *priv;
+
+    record_reply(context, MILTER_STATUS_CONTINUE);
 
     priv = MILTER_MANAGER_CHILDREN_GET_PRIVATE(children);
 
+    milter_manager_child_set_negotiate_reply_option(MILTER_MANAGER_CHILD(context),
+                                                    option);
+
     if (macros_requests)
         milter_macros_requests_merge(priv->macros_requests, macros_requests);
 
@@ -888,6 +1518,10 @@ report_result (MilterManagerChildren *children,
     milter_statistics("[milter][end][%s][%s][%g](%u): %s",
                       last_state_name, statistic_status_name,
                       elapsed, tag, child_name);
+    milter_manager_statistics_record_milter(child_name,
+                                            last_state_name,
+                                            statistic_status_name,
+                                            elapsed);
     g_free(status_name);
     g_free(state_name);
     g_free(last_state_name);
@@ -949,6 +1583,9 @@ milter_manager_children_is_waiting_reply (MilterManagerChildren *children)
     MilterServerContext *current_child;
 
     priv = MILTER_MANAGER_CHILDREN_GET_PRIVATE(children);
+    if (priv->body_writing || priv->body_reply_pending)
+        return TRUE;
+
     switch (priv->state) {
     case MILTER_SERVER_CONTEXT_STATE_NEGOTIATE:
     case MILTER_SERVER_CONTEXT_STATE_CONNECT:
@@ -963,6 +1600,8 @@ milter_manager_children_is_waiting_reply (MilterManagerChildren *children)
     case MILTER_SERVER_CONTEXT_STATE_END_OF_HEADER:
     case MILTER_SERVER_CONTEXT_STATE_BODY:
     case MILTER_SERVER_CONTEXT_STATE_END_OF_MESSAGE:
+        if (priv->parallel_tasks)
+            return TRUE;
         current_child = get_first_child_in_command_waiting_child_queue(children);
         if (!current_child)
             return FALSE;
@@ -984,6 +1623,7 @@ process_pending_message_request (MilterManagerChildren *children)
 
     priv = MILTER_MANAGER_CHILDREN_GET_PRIVATE(children);
     request = priv->pending_message_request;
+    priv->n_message_arena_users++;
 
     if (milter_need_debug_log()) {
         command_name = milter_utils_get_enum_nick_name(
@@ -1031,6 +1671,10 @@ process_pending_message_request (MilterManagerChildren *children)
     if (command_name)
         g_free(command_name);
 
+    priv->n_message_arena_users--;
+    if (priv->message_arena_reset_pending)
+        reset_message_arena(priv);
+
     return processed;
 }
 
@@ -1079,85 +1723,29 @@ remove_child_from_queue (MilterManagerChildren *children,
 }
 
 static gboolean
-emit_replace_body_signal_file (MilterManagerChildren *children)
+emit_replace_body_signal (MilterManagerChildren *children)
 {
     MilterManagerChildrenPrivate *priv;
-    GError *error = NULL;
-    GIOStatus status = G_IO_STATUS_NORMAL;
-    gsize chunk_size;
+    const gchar *body;
+    gsize body_size, offset, chunk_size, write_size;
 
     priv = MILTER_MANAGER_CHILDREN_GET_PRIVATE(children);
 
-    g_io_channel_seek_position(priv->body_file, 0, G_SEEK_SET, &error);
-    if (error) {
-        milter_error("[%u] [children][error][body][read][seek] %s",
-                     priv->tag, error->message);
-        milter_error_emittable_emit(MILTER_ERROR_EMITTABLE(children),
-                                    error);
-        g_error_free(error);
-
-        return FALSE;
-    }
-
-    chunk_size =
-        milter_manager_configuration_get_chunk_size(priv->configuration);
-    while (status == G_IO_STATUS_NORMAL) {
-        gchar buffer[MILTER_CHUNK_SIZE + 1];
-        gsize read_size;
-
-        status = g_io_channel_read_chars(priv->body_file,
-                                         buffer, chunk_size,
-                                         &read_size, &error);
-
-        if (status == G_IO_STATUS_NORMAL)
-            g_signal_emit_by_name(children, "replace-body", buffer, read_size);
-    }
-
-    if (error) {
-        milter_error("[%u] [children][error][body][read] %s",
-                     priv->tag, error->message);
-        milter_error_emittable_emit(MILTER_ERROR_EMITTABLE(children),
-                                    error);
-        g_error_free(error);
-
+    if (!get_body(children, &body, &body_size))
         return FALSE;
-    }
-
-    return TRUE;
-}
-
-static gboolean
-emit_replace_body_signal_string (MilterManagerChildren *children)
-{
-    MilterManagerChildrenPrivate *priv;
-    gsize offset, chunk_size, write_size;
-
-    priv = MILTER_MANAGER_CHILDREN_GET_PRIVATE(children);
 
     chunk_size =
         milter_manager_configuration_get_chunk_size(priv->configuration);
-    for (offset = 0; offset < priv->body->len; offset += write_size) {
-        write_size = MIN(priv->body->len - offset, chunk_size);
+    for (offset = 0; offset < body_size; offset += write_size) {
+        write_size = MIN(body_size - offset, chunk_size);
         g_signal_emit_by_name(children, "replace-body",
-                              priv->body->str + offset,
+                              body + offset,
                               write_size);
     }
 
     return TRUE;
 }
 
-static gboolean
-emit_replace_body_signal (MilterManagerChildren *children)
-{
-    MilterManagerChildrenPrivate *priv;
-
-    priv = MILTER_MANAGER_CHILDREN_GET_PRIVATE(children);
-    if (priv->body)
-        return emit_replace_body_signal_string(children);
-    else
-        return emit_replace_body_signal_file(children);
-}
-
 static MilterStatus
 send_command_to_child (MilterManagerChildren *children,
                        MilterServerContext *context,
@@ -1328,6 +1916,7 @@ send_first_command_to_next_child (MilterManagerChildren *children,
     MilterManagerChildrenPrivate *priv;
     MilterServerContext *next_child;
     MilterCommand first_command;
+    BodyFollower *follower;
 
     /* FIXME: don't want to return PROGRESS. */
     priv = MILTER_MANAGER_CHILDREN_GET_PRIVATE(children);
@@ -1342,10 +1931,18 @@ send_first_command_to_next_child (MilterManagerChildren *children,
         return MILTER_STATUS_PROGRESS;
     }
 
+    follower = find_body_follower(children, next_child);
+    if (follower) {
+        body_follower_start_turn(children, follower);
+        return MILTER_STATUS_PROGRESS;
+    }
+
     first_command = fetch_first_command_for_child_in_queue(next_child,
                                                            &priv->command_queue);
     if (first_command == -1)
         g_signal_emit_by_name(children, "continue");
+    else if (is_parallel_child(next_child))
+        send_command_to_parallel_group(children, next_child);
     else
         send_command_to_child(children, next_child, first_command);
 
@@ -1363,16 +1960,31 @@ handle_status (MilterManagerChildren *children,
 }
 
 static void
-cb_continue (MilterServerContext *context, gpointer user_data)
+cb_continue (MilterReplySignals *reply, gpointer user_data)
 {
+    MilterServerContext *context = MILTER_SERVER_CONTEXT(reply);
     MilterManagerChildren *children = user_data;
     MilterServerContextState state;
     MilterManagerChildrenPrivate *priv;
     MilterStatus status = MILTER_STATUS_NOT_CHANGE;
+    ParallelTask *task;
+    BodyFollower *follower;
+
+    record_reply(context, MILTER_STATUS_CONTINUE);
 
     priv = MILTER_MANAGER_CHILDREN_GET_PRIVATE(children);
 
     state = milter_server_context_get_state(context);
+    task = find_parallel_task(children, context);
+    if (task) {
+        parallel_task_continue(children, task, state);
+        return;
+    }
+    follower = find_body_follower(children, context);
+    if (follower) {
+        body_follower_continue(children, follower);
+        return;
+    }
     compile_reply_status(children, state, MILTER_STATUS_CONTINUE);
 
     switch (state) {
@@ -1399,6 +2011,11 @@ cb_continue (MilterServerContext *context, gpointer user_data)
                 status = send_body_to_child(children, context);
             if (status == MILTER_STATUS_NOT_CHANGE)
                 status = send_next_command(children, context, state);
+            if (status == MILTER_STATUS_NOT_CHANGE &&
+                priv->state == MILTER_SERVER_CONTEXT_STATE_BODY) {
+                reply_body_continue(children);
+                status = MILTER_STATUS_PROGRESS;
+            }
         }
         break;
     case MILTER_SERVER_CONTEXT_STATE_END_OF_MESSAGE:
@@ -1413,14 +2030,17 @@ cb_continue (MilterServerContext *context, gpointer user_data)
 }
 
 static void
-cb_temporary_failure (MilterServerContext *context, gpointer user_data)
+cb_temporary_failure (MilterReplySignals *reply, gpointer user_data)
 {
+    MilterServerContext *context = MILTER_SERVER_CONTEXT(reply);
     MilterManagerChildren *children = user_data;
     MilterManagerChildrenPrivate *priv;
     MilterServerContextState state;
     MilterStatus status = MILTER_STATUS_TEMPORARY_FAILURE;
     gboolean evaluation_mode;
 
+    record_reply(context, MILTER_STATUS_TEMPORARY_FAILURE);
+
     priv = MILTER_MANAGER_CHILDREN_GET_PRIVATE(children);
     state = milter_server_context_get_state(context);
 
@@ -1441,6 +2061,10 @@ cb_temporary_failure (MilterServerContext *context, gpointer user_data)
             g_free(state_name);
         }
     }
+    if (handle_parallel_task_reply(children, context, state, status))
+        return;
+    if (handle_body_follower_reply(children, context, state, status))
+        return;
     compile_reply_status(children, state, status);
 
     switch (state) {
@@ -1484,14 +2108,17 @@ cb_temporary_failure (MilterServerContext *context, gpointer user_data)
 }
 
 static void
-cb_reject (MilterServerContext *context, gpointer user_data)
+cb_reject (MilterReplySignals *reply, gpointer user_data)
 {
+    MilterServerContext *context = MILTER_SERVER_CONTEXT(reply);
     MilterManagerChildren *children = user_data;
     MilterManagerChildrenPrivate *priv;
     MilterServerContextState state;
     MilterStatus status = MILTER_STATUS_REJECT;
     gboolean evaluation_mode;
 
+    record_reply(context, MILTER_STATUS_REJECT);
+
     priv = MILTER_MANAGER_CHILDREN_GET_PRIVATE(children);
     state = milter_server_context_get_state(context);
 
@@ -1511,6 +2138,10 @@ cb_reject (MilterServerContext *context, gpointer user_data)
             g_free(state_name);
         }
     }
+    if (handle_parallel_task_reply(children, context, state, status))
+        return;
+    if (handle_body_follower_reply(children, context, state, status))
+        return;
     compile_reply_status(children, state, status);
 
     switch (state) {
@@ -1554,39 +2185,71 @@ cb_reject (MilterServerContext *context, gpointer user_data)
 }
 
 static void
-cb_reply_code (MilterServerContext *context,
+cb_reply_code (MilterReplySignals *reply,
                guint code,
                const gchar *extended_code,
                const gchar *message,
                gpointer user_data)
 {
+    MilterServerContext *context = MILTER_SERVER_CONTEXT(reply);
     MilterManagerChildren *children = user_data;
     MilterManagerChildrenPrivate *priv;
+    ParallelTask *task;
+    BodyFollower *follower;
 
     priv = MILTER_MANAGER_CHILDREN_GET_PRIVATE(children);
 
-    dispose_reply_related_data(priv);
-    priv->reply_code = code;
-    priv->reply_extended_code = g_strdup(extended_code);
-    priv->reply_message = g_strdup(message);
+    task = find_parallel_task(children, context);
+    follower = find_body_follower(children, context);
+    if (task) {
+        if (task->reply_extended_code)
+            g_free(task->reply_extended_code);
+        if (task->reply_message)
+            g_free(task->reply_message);
+        task->reply_code = code;
+        task->reply_extended_code = g_strdup(extended_code);
+        task->reply_message = g_strdup(message);
+    } else if (follower) {
+        if (follower->reply_extended_code)
+            g_free(follower->reply_extended_code);
+        if (follower->reply_message)
+            g_free(follower->reply_message);
+        follower->reply_code = code;
+        follower->reply_extended_code = g_strdup(extended_code);
+        follower->reply_message = g_strdup(message);
+    } else {
+        dispose_reply_related_data(priv);
+        priv->reply_code = code;
+        priv->reply_extended_code = g_strdup(extended_code);
+        priv->reply_message = g_strdup(message);
+    }
 
-    if ((priv->reply_code / 100) == 4) {
-        cb_temporary_failure(context, user_data);
+    if ((code / 100) == 4) {
+        cb_temporary_failure(reply, user_data);
     } else {
-        cb_reject(context, user_data);
+        cb_reject(reply, user_data);
     }
 }
 
 static void
-cb_accept (MilterServerContext *context, gpointer user_data)
+cb_accept (MilterReplySignals *reply, gpointer user_data)
 {
+    MilterServerContext *context = MILTER_SERVER_CONTEXT(reply);
     MilterManagerChildren *children = user_data;
     MilterManagerChildrenPrivate *priv;
     MilterServerContextState state;
 
+    record_reply(context, MILTER_STATUS_ACCEPT);
+
     priv = MILTER_MANAGER_CHILDREN_GET_PRIVATE(children);
     state = milter_server_context_get_state(context);
 
+    if (handle_parallel_task_reply(children, context, state,
+                                   MILTER_STATUS_ACCEPT))
+        return;
+    if (handle_body_follower_reply(children, context, state,
+                                   MILTER_STATUS_ACCEPT))
+        return;
     compile_reply_status(children, state, MILTER_STATUS_ACCEPT);
     switch (state) {
     case MILTER_SERVER_CONTEXT_STATE_CONNECT:
@@ -1628,14 +2291,17 @@ cb_accept (MilterServerContext *context, gpointer user_data)
 }
 
 static void
-cb_discard (MilterServerContext *context, gpointer user_data)
+cb_discard (MilterReplySignals *reply, gpointer user_data)
 {
+    MilterServerContext *context = MILTER_SERVER_CONTEXT(reply);
     MilterManagerChildren *children = user_data;
     MilterManagerChildrenPrivate *priv;
     MilterServerContextState state;
     MilterStatus status = MILTER_STATUS_DISCARD;
     gboolean evaluation_mode;
 
+    record_reply(context, MILTER_STATUS_DISCARD);
+
     priv = MILTER_MANAGER_CHILDREN_GET_PRIVATE(children);
     state = milter_server_context_get_state(context);
 
@@ -1656,6 +2322,10 @@ cb_discard (MilterServerContext *context, gpointer user_data)
             g_free(state_name);
         }
     }
+    if (handle_parallel_task_reply(children, context, state, status))
+        return;
+    if (handle_body_follower_reply(children, context, state, status))
+        return;
     compile_reply_status(children, state, status);
 
     switch (state) {
@@ -1694,19 +2364,34 @@ cb_discard (MilterServerContext *context, gpointer user_data)
 }
 
 static void
-cb_skip (MilterServerContext *context, gpointer user_data)
+cb_skip (MilterReplySignals *reply, gpointer user_data)
 {
+    MilterServerContext *context = MILTER_SERVER_CONTEXT(reply);
     MilterManagerChildren *children = user_data;
     MilterServerContextState state;
     MilterManagerChildrenPrivate *priv;
+    ParallelTask *task;
+    BodyFollower *follower;
+
+    record_reply(context, MILTER_STATUS_SKIP);
 
     state = milter_server_context_get_state(context);
 
+    task = find_parallel_task(children, context);
+    if (task) {
+        parallel_task_skip(children, task);
+        return;
+    }
+    follower = find_body_follower(children, context);
+    if (follower) {
+        body_follower_skip(children, follower);
+        return;
+    }
     compile_reply_status(children, state, MILTER_STATUS_SKIP);
 
     priv = MILTER_MANAGER_CHILDREN_GET_PRIVATE(children);
     if (priv->state < MILTER_SERVER_CONTEXT_STATE_END_OF_MESSAGE) {
-        g_signal_emit_by_name(children, "continue");
+        reply_body_continue(children);
     } else {
         send_next_command(children, context, state);
     }
@@ -1833,206 +2518,1278 @@ is_evaluation_mode (MilterManagerChildren *children,
     return TRUE;
 }
 
-static void
-cb_add_header (MilterServerContext *context,
-               const gchar *name, const gchar *value,
-               gpointer user_data)
+static gboolean
+is_parallel_child (MilterServerContext *context)
 {
-    MilterManagerChildren *children = user_data;
-    MilterManagerChildrenPrivate *priv;
-    gchar *normalized_value = NULL;
+    MilterManagerChild *child;
 
-    priv = MILTER_MANAGER_CHILDREN_GET_PRIVATE(children);
+    child = MILTER_MANAGER_CHILD(context);
+    return milter_manager_child_get_parallel_group(child) != NULL;
+}
 
-    if (!is_end_of_message_state(children, context, "add-header",
-                                 "<%s>=<%s>",
-                                 name,
-                                 MILTER_LOG_NULL_SAFE_STRING(value)))
-        return;
+static gboolean
+is_same_parallel_group (MilterServerContext *context, const gchar *group)
+{
+    const gchar *context_group;
 
-    if (value) {
-        milter_statistics("[milter][header][add](%u): <%s>=<%s>: %s",
-                          milter_agent_get_tag(MILTER_AGENT(context)),
-                          name,
-                          value,
-                          milter_server_context_get_name(context));
-    }
+    context_group =
+        milter_manager_child_get_parallel_group(MILTER_MANAGER_CHILD(context));
+    return context_group && g_str_equal(context_group, group);
+}
 
-    if (is_evaluation_mode(children, context, "add-header",
-                           "<%s>=<%s>",
-                           name,
-                           MILTER_LOG_NULL_SAFE_STRING(value)))
-        return;
+static ParallelTask *
+find_parallel_task (MilterManagerChildren *children,
+                    MilterServerContext *context)
+{
+    MilterManagerChildrenPrivate *priv;
+    GList *node;
 
-    normalized_value = normalize_header_value(children, context, value);
-    milter_headers_add_header(priv->headers, name,
-                              normalized_value ? normalized_value : value);
+    priv = MILTER_MANAGER_CHILDREN_GET_PRIVATE(children);
+    for (node = priv->parallel_tasks; node; node = g_list_next(node)) {
+        ParallelTask *task = node->data;
 
-    if (normalized_value)
-        g_free(normalized_value);
+        if (task->context == context)
+            return task;
+    }
+
+    return NULL;
 }
 
-static void
-cb_insert_header (MilterServerContext *context,
-                  guint32 index, const gchar *name, const gchar *value,
-                  gpointer user_data)
+static gboolean
+record_parallel_modification (MilterManagerChildren *children,
+                              MilterServerContext *context,
+                              ParallelModificationType type,
+                              guint32 index,
+                              const gchar *name,
+                              const gchar *value)
 {
-    MilterManagerChildren *children = user_data;
     MilterManagerChildrenPrivate *priv;
-    gchar *normalized_value = NULL;
+    ParallelTask *task;
+    ParallelModification *modification;
 
     priv = MILTER_MANAGER_CHILDREN_GET_PRIVATE(children);
 
-    if (!is_end_of_message_state(children, context, "insert-header",
-                                 "[%u]<%s>=<%s>",
-                                 index,
-                                 name,
-                                 MILTER_LOG_NULL_SAFE_STRING(value)))
-        return;
-
-    if (value) {
-        milter_statistics("[milter][header][add](%u): <%s>=<%s>: %s",
-                          milter_agent_get_tag(MILTER_AGENT(context)),
-                          name,
-                          value,
-                          milter_server_context_get_name(context));
-    }
-
-    if (is_evaluation_mode(children, context, "insert-header",
-                           "[%u]<%s>=<%s>",
-                           index,
-                           name,
-                           MILTER_LOG_NULL_SAFE_STRING(value)))
-        return;
+    task = find_parallel_task(children, context);
+    if (!task)
+        return FALSE;
 
-    normalized_value = normalize_header_value(children, context, value);
-    milter_headers_insert_header(priv->headers, index, name,
-                                 normalized_value ? normalized_value : value);
+    modification = parallel_modification_new(priv->message_arena,
+                                             type, index, name, value);
+    task->modifications = g_list_append(task->modifications, modification);
 
-    if (normalized_value)
-        g_free(normalized_value);
+    return TRUE;
 }
 
 static void
-cb_change_header (MilterServerContext *context,
-                  const gchar *name, guint32 index, const gchar *value,
-                  gpointer user_data)
+apply_parallel_modifications (MilterManagerChildren *children,
+                              ParallelTask *task)
 {
-    MilterManagerChildren *children = user_data;
     MilterManagerChildrenPrivate *priv;
-    gchar *normalized_value = NULL;
+    GList *node;
 
     priv = MILTER_MANAGER_CHILDREN_GET_PRIVATE(children);
 
-    if (!is_end_of_message_state(children, context, "change-header",
-                                 "<%s>[%u]=<%s>",
-                                 name,
-                                 index,
-                                 MILTER_LOG_NULL_SAFE_STRING(value)))
-        return;
+    for (node = task->modifications; node; node = g_list_next(node)) {
+        ParallelModification *modification = node->data;
 
-    if (value) {
-        milter_statistics("[milter][header][add](%u): <%s>=<%s>: %s",
-                          milter_agent_get_tag(MILTER_AGENT(context)),
-                          name,
-                          value,
-                          milter_server_context_get_name(context));
+        switch (modification->type) {
+        case PARALLEL_MODIFICATION_ADD_HEADER:
+            milter_headers_add_header(priv->headers,
+                                      modification->name,
+                                      modification->value);
+            break;
+        case PARALLEL_MODIFICATION_INSERT_HEADER:
+            milter_headers_insert_header(priv->headers,
+                                         modification->index,
+                                         modification->name,
+                                         modification->value);
+            break;
+        case PARALLEL_MODIFICATION_CHANGE_HEADER:
+            milter_headers_change_header(priv->headers,
+                                         modification->name,
+                                         modification->index,
+                                         modification->value);
+            break;
+        case PARALLEL_MODIFICATION_DELETE_HEADER:
+            milter_headers_delete_header(priv->headers,
+                                         modification->name,
+                                         modification->index);
+            break;
+        case PARALLEL_MODIFICATION_CHANGE_FROM:
+            if (priv->change_from)
+                g_free(priv->change_from);
+            if (priv->change_from_parameters)
+                g_free(priv->change_from_parameters);
+            priv->change_from = g_strdup(modification->name);
+            priv->change_from_parameters = g_strdup(modification->value);
+            break;
+        case PARALLEL_MODIFICATION_ADD_RECIPIENT:
+            g_signal_emit_by_name(children, "add-recipient",
+                                  modification->name, modification->value);
+            break;
+        case PARALLEL_MODIFICATION_DELETE_RECIPIENT:
+            g_signal_emit_by_name(children, "delete-recipient",
+                                  modification->name);
+            break;
+        case PARALLEL_MODIFICATION_QUARANTINE:
+            if (priv->quarantine_reason)
+                g_free(priv->quarantine_reason);
+            priv->quarantine_reason = g_strdup(modification->name);
+            break;
+        }
     }
 
-    if (is_evaluation_mode(children, context, "change-header",
-                           "<%s>[%u]=<%s>",
-                           name,
-                           index,
-                           MILTER_LOG_NULL_SAFE_STRING(value)))
-        return;
+    if (task->replaced_body) {
+        dispose_body_related_data(priv);
+        if (write_body(children,
+                       task->replaced_body->str,
+                       task->replaced_body->len,
+                       FALSE))
+            priv->replaced_body = TRUE;
+    }
+}
 
-    normalized_value = normalize_header_value(children, context, value);
-    milter_headers_change_header(priv->headers,
-                                 name, index,
-                                 normalized_value ? normalized_value : value);
+static gboolean
+is_parallel_group_finished (MilterManagerChildrenPrivate *priv)
+{
+    GList *node;
 
-    if (normalized_value)
-        g_free(normalized_value);
+    for (node = priv->parallel_tasks; node; node = g_list_next(node)) {
+        ParallelTask *task = node->data;
+
+        if (!task->finished)
+            return FALSE;
+    }
+
+    return TRUE;
 }
 
 static void
-cb_delete_header (MilterServerContext *context,
-                  const gchar *name, guint32 index,
-                  gpointer user_data)
+merge_parallel_group (MilterManagerChildren *children)
 {
-    MilterManagerChildren *children = user_data;
     MilterManagerChildrenPrivate *priv;
+    MilterServerContext *leader;
+    ParallelTask *stopped_task = NULL;
+    GList *tasks, *node;
 
     priv = MILTER_MANAGER_CHILDREN_GET_PRIVATE(children);
 
-    if (!is_end_of_message_state(children, context, "delete-header",
-                                 "<%s>[%u]", name, index))
-        return;
+    tasks = priv->parallel_tasks;
+    leader = priv->parallel_group_leader;
+    priv->parallel_tasks = NULL;
+    priv->parallel_group_leader = NULL;
+
+    milter_debug("[%u] [children][parallel][merge] %u",
+                 priv->tag, g_list_length(tasks));
+
+    /* apply results in configuration order as if the group members
+     * were processed one by one. */
+    for (node = tasks; node; node = g_list_next(node)) {
+        ParallelTask *task = node->data;
+
+        apply_parallel_modifications(children, task);
+        compile_reply_status(children, task->state, task->status);
+        if (task->status == MILTER_STATUS_REJECT ||
+            task->status == MILTER_STATUS_TEMPORARY_FAILURE ||
+            task->status == MILTER_STATUS_DISCARD) {
+            stopped_task = task;
+            break;
+        }
+    }
 
-    if (is_evaluation_mode(children, context, "delete-header",
-                           "<%s>[%u]", name, index))
-        return;
+    if (stopped_task) {
+        if (stopped_task->reply_code > 0) {
+            dispose_reply_related_data(priv);
+            priv->reply_code = stopped_task->reply_code;
+            priv->reply_extended_code = stopped_task->reply_extended_code;
+            priv->reply_message = stopped_task->reply_message;
+            stopped_task->reply_extended_code = NULL;
+            stopped_task->reply_message = NULL;
+        }
+        emit_reply_for_message_oriented_command(children, stopped_task->state);
+        milter_manager_children_abort(children);
+    } else {
+        send_first_command_to_next_child(children, leader);
+    }
 
-    milter_headers_delete_header(priv->headers, name, index);
+    g_list_foreach(tasks, (GFunc)parallel_task_free, NULL);
+    g_list_free(tasks);
 }
 
 static void
-cb_change_from (MilterServerContext *context,
-                const gchar *from, const gchar *parameters,
-                gpointer user_data)
+merge_parallel_group_if_finished (MilterManagerChildren *children)
 {
-    MilterManagerChildren *children = user_data;
     MilterManagerChildrenPrivate *priv;
 
     priv = MILTER_MANAGER_CHILDREN_GET_PRIVATE(children);
 
-    if (!is_end_of_message_state(children, context, "change-from",
-                                 "<<%s> <%s>>",
-                                 from,
-                                 MILTER_LOG_NULL_SAFE_STRING(parameters)))
-        return;
-
-    if (is_evaluation_mode(children, context, "change-from",
-                           "<<%s> <%s>>",
-                           from,
-                           MILTER_LOG_NULL_SAFE_STRING(parameters)))
+    /* tasks must be alive while a command is being sent to a member. */
+    if (priv->parallel_group_lock > 0)
         return;
 
-    if (priv->change_from)
-        g_free(priv->change_from);
-    if (priv->change_from_parameters)
-        g_free(priv->change_from_parameters);
-    priv->change_from = g_strdup(from);
-    priv->change_from_parameters = g_strdup(parameters);
+    if (priv->parallel_tasks && is_parallel_group_finished(priv))
+        merge_parallel_group(children);
 }
 
 static void
-cb_add_recipient (MilterServerContext *context,
-                  const gchar *recipient, const gchar *parameters,
-                  gpointer user_data)
+finish_parallel_task (MilterManagerChildren *children,
+                      ParallelTask *task,
+                      MilterServerContextState state,
+                      MilterStatus status)
 {
-    MilterManagerChildren *children = user_data;
+    MilterManagerChildrenPrivate *priv;
 
-    if (!is_end_of_message_state(children, context, "add-recipient",
-                                 "<<%s> <%s>>",
-                                 recipient,
-                                 MILTER_LOG_NULL_SAFE_STRING(parameters)))
+    if (task->finished)
         return;
 
-    if (is_evaluation_mode(children, context, "add-recipient",
+    priv = MILTER_MANAGER_CHILDREN_GET_PRIVATE(children);
+
+    task->finished = TRUE;
+    task->state = state;
+    task->status = status;
+
+    if (milter_need_debug_log()) {
+        gchar *state_name;
+        gchar *status_name;
+
+        state_name =
+            milter_utils_get_enum_nick_name(MILTER_TYPE_SERVER_CONTEXT_STATE,
+                                            state);
+        status_name = milter_utils_get_enum_nick_name(MILTER_TYPE_STATUS,
+                                                      status);
+        milter_debug("[%u] [children][parallel][finish][%s][%s] [%u] %s",
+                     priv->tag,
+                     state_name,
+                     status_name,
+                     milter_agent_get_tag(MILTER_AGENT(task->context)),
+                     milter_server_context_get_name(task->context));
+        g_free(state_name);
+        g_free(status_name);
+    }
+
+    merge_parallel_group_if_finished(children);
+}
+
+static void
+parallel_task_next_command (ParallelTask *task)
+{
+    task->command_node = g_list_next(task->command_node);
+    task->command_sent = FALSE;
+    task->header_index = 0;
+    task->body_offset = 0;
+}
+
+static MilterStatus
+parallel_task_send_header (MilterManagerChildren *children,
+                           ParallelTask *task)
+{
+    MilterManagerChildrenPrivate *priv;
+    MilterServerContext *context;
+    MilterHeader *header;
+    gint value_offset = 0;
+
+    priv = MILTER_MANAGER_CHILDREN_GET_PRIVATE(children);
+    context = task->context;
+
+    task->header_index++;
+    header = milter_headers_get_nth_header(priv->headers, task->header_index);
+    if (!header)
+        return MILTER_STATUS_NOT_CHANGE;
+
+    if (need_header_value_leading_space_conversion(children, context)) {
+        if (header->value && header->value[0] == ' ')
+            value_offset = 1;
+    }
+
+    if (!milter_server_context_header(context,
+                                      header->name,
+                                      header->value + value_offset))
+        return milter_manager_child_get_fallback_status(
+            MILTER_MANAGER_CHILD(context));
+
+    if (!milter_server_context_need_reply(context,
+                                          MILTER_SERVER_CONTEXT_STATE_HEADER))
+        g_signal_emit_by_name(context, "continue");
+
+    return MILTER_STATUS_PROGRESS;
+}
+
+static MilterStatus
+parallel_task_send_body (MilterManagerChildren *children,
+                         ParallelTask *task)
+{
+    MilterManagerChildrenPrivate *priv;
+    MilterServerContext *context;
+    const gchar *body;
+    gsize body_size, chunk_size, size;
+
+    priv = MILTER_MANAGER_CHILDREN_GET_PRIVATE(children);
+    context = task->context;
+
+    if (milter_server_context_get_skip_body(context))
+        return MILTER_STATUS_NOT_CHANGE;
+
+    /* each member has its own offset into the shared body. */
+    if (!get_body(children, &body, &body_size))
+        return milter_manager_child_get_fallback_status(
+            MILTER_MANAGER_CHILD(context));
+    if (task->body_offset >= body_size)
+        return MILTER_STATUS_NOT_CHANGE;
+
+    chunk_size =
+        milter_manager_configuration_get_chunk_size(priv->configuration);
+    size = MIN(body_size - task->body_offset, chunk_size);
+    if (!milter_server_context_body(context, body + task->body_offset, size))
+        return milter_manager_child_get_fallback_status(
+            MILTER_MANAGER_CHILD(context));
+
+    task->body_offset += size;
+    if (!milter_server_context_need_reply(context,
+                                          MILTER_SERVER_CONTEXT_STATE_BODY))
+        g_signal_emit_by_name(context, "continue");
+
+    return MILTER_STATUS_PROGRESS;
+}
+
+static void
+parallel_task_send_command (MilterManagerChildren *children,
+                            ParallelTask *task)
+{
+    MilterManagerChildrenPrivate *priv;
+    MilterServerContext *context;
+    MilterStatus status = MILTER_STATUS_NOT_CHANGE;
+
+    priv = MILTER_MANAGER_CHILDREN_GET_PRIVATE(children);
+    context = task->context;
+
+    priv->parallel_group_lock++;
+    while (task->command_node) {
+        MilterCommand command;
+
+        command = GPOINTER_TO_INT(task->command_node->data);
+        switch (command) {
+        case MILTER_COMMAND_HEADER:
+            status = parallel_task_send_header(children, task);
+            break;
+        case MILTER_COMMAND_END_OF_HEADER:
+            if (task->command_sent) {
+                status = MILTER_STATUS_NOT_CHANGE;
+                break;
+            }
+            task->command_sent = TRUE;
+            if (milter_server_context_end_of_header(context)) {
+                status = MILTER_STATUS_PROGRESS;
+                if (!milter_server_context_need_reply(
+                        context, MILTER_SERVER_CONTEXT_STATE_END_OF_HEADER))
+                    g_signal_emit_by_name(context, "continue");
+            } else {
+                status = milter_manager_child_get_fallback_status(
+                    MILTER_MANAGER_CHILD(context));
+            }
+            break;
+        case MILTER_COMMAND_BODY:
+            status = parallel_task_send_body(children, task);
+            break;
+        case MILTER_COMMAND_END_OF_MESSAGE:
+            if (task->command_sent) {
+                status = MILTER_STATUS_NOT_CHANGE;
+                break;
+            }
+            task->command_sent = TRUE;
+            if (milter_server_context_end_of_message(
+                    context,
+                    priv->end_of_message_chunk,
+                    priv->end_of_message_size))
+                status = MILTER_STATUS_PROGRESS;
+            else
+                status = milter_manager_child_get_fallback_status(
+                    MILTER_MANAGER_CHILD(context));
+            break;
+        default:
+            status = MILTER_STATUS_NOT_CHANGE;
+            break;
+        }
+
+        if (status != MILTER_STATUS_NOT_CHANGE)
+            break;
+        parallel_task_next_command(task);
+    }
+
+    if (status != MILTER_STATUS_PROGRESS) {
+        if (status == MILTER_STATUS_NOT_CHANGE)
+            status = MILTER_STATUS_CONTINUE;
+        finish_parallel_task(children, task,
+                             milter_server_context_get_state(context),
+                             status);
+    }
+    priv->parallel_group_lock--;
+
+    merge_parallel_group_if_finished(children);
+}
+
+static void
+parallel_task_continue (MilterManagerChildren *children,
+                        ParallelTask *task,
+                        MilterServerContextState state)
+{
+    if (task->finished)
+        return;
+
+    if (state == MILTER_SERVER_CONTEXT_STATE_END_OF_MESSAGE) {
+        finish_parallel_task(children, task, state, MILTER_STATUS_CONTINUE);
+        return;
+    }
+
+    parallel_task_send_command(children, task);
+}
+
+static void
+parallel_task_skip (MilterManagerChildren *children, ParallelTask *task)
+{
+    if (task->finished)
+        return;
+
+    if (task->command_node &&
+        GPOINTER_TO_INT(task->command_node->data) == MILTER_COMMAND_BODY)
+        parallel_task_next_command(task);
+
+    parallel_task_send_command(children, task);
+}
+
+static gboolean
+handle_parallel_task_reply (MilterManagerChildren *children,
+                            MilterServerContext *context,
+                            MilterServerContextState state,
+                            MilterStatus status)
+{
+    ParallelTask *task;
+
+    task = find_parallel_task(children, context);
+    if (!task)
+        return FALSE;
+
+    if (!task->finished) {
+        milter_server_context_set_processing_message(context, FALSE);
+        finish_parallel_task(children, task, state, status);
+    }
+
+    return TRUE;
+}
+
+static gboolean
+expire_parallel_task (MilterManagerChildren *children,
+                      MilterServerContext *context,
+                      MilterServerContextState state,
+                      MilterStatus status)
+{
+    if (!find_parallel_task(children, context))
+        return FALSE;
+
+    expire_child(children, context);
+    handle_parallel_task_reply(children, context, state, status);
+
+    return TRUE;
+}
+
+static MilterStatus
+start_parallel_group (MilterManagerChildren *children,
+                      MilterServerContext *leader)
+{
+    MilterManagerChildrenPrivate *priv;
+    const gchar *group;
+    GList *node, *tasks;
+
+    priv = MILTER_MANAGER_CHILDREN_GET_PRIVATE(children);
+
+    group = milter_manager_child_get_parallel_group(MILTER_MANAGER_CHILD(leader));
+    for (node = priv->milters; node; node = g_list_next(node)) {
+        MilterServerContext *context = MILTER_SERVER_CONTEXT(node->data);
+        ParallelTask *task;
+
+        if (context != leader) {
+            if (!is_same_parallel_group(context, group))
+                continue;
+            if (milter_server_context_is_quitted(context))
+                continue;
+            if (!milter_server_context_is_processing_message(context))
+                continue;
+            if (!milter_server_context_has_accepted_recipient(context))
+                continue;
+        }
+
+        task = parallel_task_new(context, priv->command_queue);
+        priv->parallel_tasks = g_list_prepend(priv->parallel_tasks, task);
+    }
+    priv->parallel_tasks = g_list_reverse(priv->parallel_tasks);
+    priv->parallel_group_leader = leader;
+
+    milter_debug("[%u] [children][parallel][start][%s] %u",
+                 priv->tag, group, g_list_length(priv->parallel_tasks));
+
+    priv->processing_state = MILTER_SERVER_CONTEXT_STATE_END_OF_MESSAGE;
+
+    priv->parallel_group_lock++;
+    tasks = g_list_copy(priv->parallel_tasks);
+    for (node = tasks; node; node = g_list_next(node)) {
+        parallel_task_send_command(children, node->data);
+    }
+    g_list_free(tasks);
+    priv->parallel_group_lock--;
+
+    merge_parallel_group_if_finished(children);
+
+    return MILTER_STATUS_PROGRESS;
+}
+
+static MilterStatus
+send_command_to_parallel_group (MilterManagerChildren *children,
+                                MilterServerContext *leader)
+{
+    MilterManagerChildrenPrivate *priv;
+
+    priv = MILTER_MANAGER_CHILDREN_GET_PRIVATE(children);
+
+    /*
+     * Group members receive the whole message at once at end of
+     * message. Until then reply "continue" on behalf of them.
+     */
+    if (priv->state != MILTER_SERVER_CONTEXT_STATE_END_OF_MESSAGE) {
+        g_signal_emit_by_name(children, "continue");
+        return MILTER_STATUS_PROGRESS;
+    }
+
+    if (priv->parallel_tasks)
+        return MILTER_STATUS_PROGRESS;
+
+    return start_parallel_group(children, leader);
+}
+
+static gboolean
+child_receives_body (MilterServerContext *context)
+{
+    if (milter_server_context_get_skip_body(context))
+        return FALSE;
+    return !milter_server_context_is_enable_step(context, MILTER_STEP_NO_BODY);
+}
+
+static BodyFollower *
+find_body_follower (MilterManagerChildren *children,
+                    MilterServerContext *context)
+{
+    MilterManagerChildrenPrivate *priv;
+    GList *node;
+
+    priv = MILTER_MANAGER_CHILDREN_GET_PRIVATE(children);
+    for (node = priv->body_followers; node; node = g_list_next(node)) {
+        BodyFollower *follower = node->data;
+
+        if (follower->context == context && !follower->released)
+            return follower;
+    }
+
+    return NULL;
+}
+
+static gboolean
+body_followers_are_backlogged (MilterManagerChildrenPrivate *priv)
+{
+    GList *node;
+
+    for (node = priv->body_followers; node; node = g_list_next(node)) {
+        BodyFollower *follower = node->data;
+
+        if (follower->released || follower->finished)
+            continue;
+        if (g_queue_get_length(follower->chunks) >=
+            BODY_FOLLOWER_MAX_QUEUED_CHUNKS)
+            return TRUE;
+    }
+
+    return FALSE;
+}
+
+static void
+reply_body_continue (MilterManagerChildren *children)
+{
+    MilterManagerChildrenPrivate *priv;
+
+    priv = MILTER_MANAGER_CHILDREN_GET_PRIVATE(children);
+
+    /* the MTA sends the next chunk only after this reply, so holding
+     * it keeps the follower queues bounded. */
+    if (body_followers_are_backlogged(priv)) {
+        if (!priv->body_reply_pending)
+            milter_debug("[%u] [children][body][follower][hold]", priv->tag);
+        priv->body_reply_pending = TRUE;
+        return;
+    }
+
+    priv->body_reply_pending = FALSE;
+    g_signal_emit_by_name(children, "continue");
+}
+
+static void
+release_body_reply (MilterManagerChildren *children)
+{
+    MilterManagerChildrenPrivate *priv;
+
+    priv = MILTER_MANAGER_CHILDREN_GET_PRIVATE(children);
+    if (!priv->body_reply_pending)
+        return;
+    if (body_followers_are_backlogged(priv))
+        return;
+
+    milter_debug("[%u] [children][body][follower][release]", priv->tag);
+    reply_body_continue(children);
+}
+
+static MilterStatus
+body_follower_send_header (MilterManagerChildren *children,
+                           BodyFollower *follower)
+{
+    MilterManagerChildrenPrivate *priv;
+    MilterServerContext *context;
+    MilterHeader *header;
+    gint value_offset = 0;
+
+    priv = MILTER_MANAGER_CHILDREN_GET_PRIVATE(children);
+    context = follower->context;
+
+    follower->header_index++;
+    header = milter_headers_get_nth_header(priv->headers,
+                                           follower->header_index);
+    if (!header)
+        return MILTER_STATUS_NOT_CHANGE;
+
+    if (need_header_value_leading_space_conversion(children, context)) {
+        if (header->value && header->value[0] == ' ')
+            value_offset = 1;
+    }
+
+    follower->waiting_reply = TRUE;
+    if (!milter_server_context_header(context,
+                                      header->name,
+                                      header->value + value_offset)) {
+        follower->waiting_reply = FALSE;
+        return milter_manager_child_get_fallback_status(
+            MILTER_MANAGER_CHILD(context));
+    }
+
+    if (!milter_server_context_need_reply(context,
+                                          MILTER_SERVER_CONTEXT_STATE_HEADER))
+        g_signal_emit_by_name(context, "continue");
+
+    return MILTER_STATUS_PROGRESS;
+}
+
+static MilterStatus
+body_follower_send_end_of_header (BodyFollower *follower)
+{
+    MilterServerContext *context;
+
+    if (follower->command_sent)
+        return MILTER_STATUS_NOT_CHANGE;
+
+    context = follower->context;
+    follower->command_sent = TRUE;
+    follower->waiting_reply = TRUE;
+    if (!milter_server_context_end_of_header(context)) {
+        follower->waiting_reply = FALSE;
+        return milter_manager_child_get_fallback_status(
+            MILTER_MANAGER_CHILD(context));
+    }
+
+    if (!milter_server_context_need_reply(
+            context, MILTER_SERVER_CONTEXT_STATE_END_OF_HEADER))
+        g_signal_emit_by_name(context, "continue");
+
+    return MILTER_STATUS_PROGRESS;
+}
+
+static MilterStatus
+body_follower_send_body (BodyFollower *follower)
+{
+    MilterServerContext *context;
+    GString *chunk;
+    gboolean success;
+
+    if (follower->skip_body || g_queue_is_empty(follower->chunks))
+        return MILTER_STATUS_NOT_CHANGE;
+
+    context = follower->context;
+    chunk = g_queue_pop_head(follower->chunks);
+    follower->waiting_reply = TRUE;
+    success = milter_server_context_body(context, chunk->str, chunk->len);
+    g_string_free(chunk, TRUE);
+    if (!success) {
+        follower->waiting_reply = FALSE;
+        return milter_manager_child_get_fallback_status(
+            MILTER_MANAGER_CHILD(context));
+    }
+
+    if (!milter_server_context_need_reply(context,
+                                          MILTER_SERVER_CONTEXT_STATE_BODY))
+        g_signal_emit_by_name(context, "continue");
+
+    return MILTER_STATUS_PROGRESS;
+}
+
+static void finish_body_follower (MilterManagerChildren *children,
+                                  BodyFollower *follower,
+                                  MilterServerContextState state,
+                                  MilterStatus status);
+
+static void
+body_follower_send_command (MilterManagerChildren *children,
+                            BodyFollower *follower)
+{
+    MilterManagerChildrenPrivate *priv;
+    MilterStatus status = MILTER_STATUS_NOT_CHANGE;
+
+    priv = MILTER_MANAGER_CHILDREN_GET_PRIVATE(children);
+
+    if (follower->finished || follower->released || follower->waiting_reply)
+        return;
+
+    lock_body_followers(priv);
+    while (follower->command_node) {
+        MilterCommand command;
+
+        command = GPOINTER_TO_INT(follower->command_node->data);
+        switch (command) {
+        case MILTER_COMMAND_HEADER:
+            status = body_follower_send_header(children, follower);
+            break;
+        case MILTER_COMMAND_END_OF_HEADER:
+            status = body_follower_send_end_of_header(follower);
+            break;
+        case MILTER_COMMAND_BODY:
+            /* stay on body: more chunks may come until the turn. */
+            status = body_follower_send_body(follower);
+            if (status == MILTER_STATUS_NOT_CHANGE)
+                status = MILTER_STATUS_PROGRESS;
+            break;
+        default:
+            status = MILTER_STATUS_NOT_CHANGE;
+            break;
+        }
+
+        if (status != MILTER_STATUS_NOT_CHANGE)
+            break;
+        follower->command_node = g_list_next(follower->command_node);
+        follower->command_sent = FALSE;
+        follower->header_index = 0;
+    }
+
+    if (status != MILTER_STATUS_PROGRESS && status != MILTER_STATUS_NOT_CHANGE)
+        finish_body_follower(children, follower,
+                             milter_server_context_get_state(follower->context),
+                             status);
+    unlock_body_followers(priv);
+}
+
+static void
+body_follower_push_chunk (MilterManagerChildren *children,
+                          const gchar *chunk,
+                          gsize size)
+{
+    MilterManagerChildrenPrivate *priv;
+    GList *node, *followers;
+
+    priv = MILTER_MANAGER_CHILDREN_GET_PRIVATE(children);
+    if (!priv->body_followers)
+        return;
+
+    lock_body_followers(priv);
+    followers = g_list_copy(priv->body_followers);
+    for (node = followers; node; node = g_list_next(node)) {
+        BodyFollower *follower = node->data;
+
+        if (follower->released || follower->finished || follower->skip_body)
+            continue;
+        g_queue_push_tail(follower->chunks, g_string_new_len(chunk, size));
+        body_follower_send_command(children, follower);
+    }
+    g_list_free(followers);
+    unlock_body_followers(priv);
+}
+
+static void
+body_follower_apply_result (MilterManagerChildren *children,
+                            BodyFollower *follower)
+{
+    MilterManagerChildrenPrivate *priv;
+
+    priv = MILTER_MANAGER_CHILDREN_GET_PRIVATE(children);
+
+    follower->released = TRUE;
+    compile_reply_status(children, follower->state, follower->status);
+    switch (follower->status) {
+    case MILTER_STATUS_REJECT:
+    case MILTER_STATUS_TEMPORARY_FAILURE:
+    case MILTER_STATUS_DISCARD:
+        if (follower->reply_code > 0) {
+            dispose_reply_related_data(priv);
+            priv->reply_code = follower->reply_code;
+            priv->reply_extended_code = follower->reply_extended_code;
+            priv->reply_message = follower->reply_message;
+            follower->reply_extended_code = NULL;
+            follower->reply_message = NULL;
+        }
+        emit_reply_for_message_oriented_command(children, follower->state);
+        milter_manager_children_abort(children);
+        break;
+    default:
+        send_first_command_to_next_child(children, follower->context);
+        break;
+    }
+}
+
+static void
+body_follower_end_turn (MilterManagerChildren *children,
+                        BodyFollower *follower)
+{
+    MilterManagerChildrenPrivate *priv;
+
+    priv = MILTER_MANAGER_CHILDREN_GET_PRIVATE(children);
+
+    milter_debug("[%u] [children][body][follower][end] [%u] %s",
+                 priv->tag,
+                 milter_agent_get_tag(MILTER_AGENT(follower->context)),
+                 milter_server_context_get_name(follower->context));
+
+    /* it has read the whole body so far; from now on it is served as
+     * the current child. */
+    follower->released = TRUE;
+    priv->replaced_body_for_each_child = FALSE;
+    if (priv->state == MILTER_SERVER_CONTEXT_STATE_END_OF_MESSAGE)
+        send_command_to_child(children, follower->context,
+                              MILTER_COMMAND_END_OF_MESSAGE);
+    else
+        reply_body_continue(children);
+}
+
+static void
+body_follower_check_progress (MilterManagerChildren *children,
+                              BodyFollower *follower)
+{
+    if (follower->released)
+        return;
+
+    if (follower->turn && !follower->finished &&
+        !follower->waiting_reply && g_queue_is_empty(follower->chunks)) {
+        body_follower_end_turn(children, follower);
+        return;
+    }
+
+    release_body_reply(children);
+}
+
+static void
+finish_body_follower (MilterManagerChildren *children,
+                      BodyFollower *follower,
+                      MilterServerContextState state,
+                      MilterStatus status)
+{
+    MilterManagerChildrenPrivate *priv;
+
+    if (follower->finished)
+        return;
+
+    priv = MILTER_MANAGER_CHILDREN_GET_PRIVATE(children);
+
+    follower->finished = TRUE;
+    follower->waiting_reply = FALSE;
+    follower->state = state;
+    follower->status = status;
+    body_follower_clear_chunks(follower);
+
+    if (milter_need_debug_log()) {
+        gchar *state_name;
+        gchar *status_name;
+
+        state_name =
+            milter_utils_get_enum_nick_name(MILTER_TYPE_SERVER_CONTEXT_STATE,
+                                            state);
+        status_name = milter_utils_get_enum_nick_name(MILTER_TYPE_STATUS,
+                                                      status);
+        milter_debug("[%u] [children][body][follower][finish][%s][%s] [%u] %s",
+                     priv->tag,
+                     state_name,
+                     status_name,
+                     milter_agent_get_tag(MILTER_AGENT(follower->context)),
+                     milter_server_context_get_name(follower->context));
+        g_free(state_name);
+        g_free(status_name);
+    }
+
+    if (follower->turn)
+        body_follower_apply_result(children, follower);
+    else
+        release_body_reply(children);
+}
+
+static void
+body_follower_continue (MilterManagerChildren *children,
+                        BodyFollower *follower)
+{
+    MilterManagerChildrenPrivate *priv;
+
+    if (follower->finished)
+        return;
+
+    priv = MILTER_MANAGER_CHILDREN_GET_PRIVATE(children);
+
+    lock_body_followers(priv);
+    follower->waiting_reply = FALSE;
+    body_follower_send_command(children, follower);
+    body_follower_check_progress(children, follower);
+    unlock_body_followers(priv);
+}
+
+static void
+body_follower_skip (MilterManagerChildren *children, BodyFollower *follower)
+{
+    MilterManagerChildrenPrivate *priv;
+
+    if (follower->finished)
+        return;
+
+    priv = MILTER_MANAGER_CHILDREN_GET_PRIVATE(children);
+
+    lock_body_followers(priv);
+    follower->skip_body = TRUE;
+    body_follower_clear_chunks(follower);
+    follower->waiting_reply = FALSE;
+    body_follower_send_command(children, follower);
+    body_follower_check_progress(children, follower);
+    unlock_body_followers(priv);
+}
+
+static void
+body_follower_start_turn (MilterManagerChildren *children,
+                          BodyFollower *follower)
+{
+    MilterManagerChildrenPrivate *priv;
+
+    priv = MILTER_MANAGER_CHILDREN_GET_PRIVATE(children);
+
+    milter_debug("[%u] [children][body][follower][turn] [%u] %s",
+                 priv->tag,
+                 milter_agent_get_tag(MILTER_AGENT(follower->context)),
+                 milter_server_context_get_name(follower->context));
+
+    lock_body_followers(priv);
+    follower->turn = TRUE;
+    if (follower->finished)
+        body_follower_apply_result(children, follower);
+    else
+        body_follower_check_progress(children, follower);
+    unlock_body_followers(priv);
+}
+
+static gboolean
+handle_body_follower_reply (MilterManagerChildren *children,
+                            MilterServerContext *context,
+                            MilterServerContextState state,
+                            MilterStatus status)
+{
+    MilterManagerChildrenPrivate *priv;
+    BodyFollower *follower;
+
+    follower = find_body_follower(children, context);
+    if (!follower)
+        return FALSE;
+
+    priv = MILTER_MANAGER_CHILDREN_GET_PRIVATE(children);
+
+    lock_body_followers(priv);
+    if (!follower->finished) {
+        milter_server_context_set_processing_message(context, FALSE);
+        finish_body_follower(children, follower, state, status);
+    }
+    unlock_body_followers(priv);
+
+    return TRUE;
+}
+
+static gboolean
+expire_body_follower (MilterManagerChildren *children,
+                      MilterServerContext *context,
+                      MilterServerContextState state,
+                      MilterStatus status)
+{
+    if (!find_body_follower(children, context))
+        return FALSE;
+
+    expire_child(children, context);
+    handle_body_follower_reply(children, context, state, status);
+
+    return TRUE;
+}
+
+static void
+start_body_followers (MilterManagerChildren *children)
+{
+    MilterManagerChildrenPrivate *priv;
+    GList *node;
+
+    priv = MILTER_MANAGER_CHILDREN_GET_PRIVATE(children);
+
+    if (!priv->command_waiting_child_queue)
+        return;
+
+    for (node = g_list_next(priv->command_waiting_child_queue);
+         node;
+         node = g_list_next(node)) {
+        MilterServerContext *context = node->data;
+
+        if (!child_receives_body(context))
+            continue;
+        priv->body_followers =
+            g_list_prepend(priv->body_followers,
+                           body_follower_new(context, priv->command_queue));
+    }
+    priv->body_followers = g_list_reverse(priv->body_followers);
+
+    milter_debug("[%u] [children][body][follower][start] %u",
+                 priv->tag, g_list_length(priv->body_followers));
+}
+
+static void
+cb_add_header (MilterReplySignals *reply,
+               const gchar *name, const gchar *value,
+               gpointer user_data)
+{
+    MilterServerContext *context = MILTER_SERVER_CONTEXT(reply);
+    MilterManagerChildren *children = user_data;
+    MilterManagerChildrenPrivate *priv;
+    gchar *normalized_value = NULL;
+
+    priv = MILTER_MANAGER_CHILDREN_GET_PRIVATE(children);
+
+    if (!is_end_of_message_state(children, context, "add-header",
+                                 "<%s>=<%s>",
+                                 name,
+                                 MILTER_LOG_NULL_SAFE_STRING(value)))
+        return;
+
+    if (value) {
+        milter_statistics("[milter][header][add](%u): <%s>=<%s>: %s",
+                          milter_agent_get_tag(MILTER_AGENT(context)),
+                          name,
+                          value,
+                          milter_server_context_get_name(context));
+    }
+
+    if (is_evaluation_mode(children, context, "add-header",
+                           "<%s>=<%s>",
+                           name,
+                           MILTER_LOG_NULL_SAFE_STRING(value)))
+        return;
+
+    normalized_value = normalize_header_value(children, context, value);
+    if (!record_parallel_modification(children, context,
+                                      PARALLEL_MODIFICATION_ADD_HEADER,
+                                      0, name,
+                                      normalized_value ? normalized_value : value))
+        milter_headers_add_header(priv->headers, name,
+                                  normalized_value ? normalized_value : value);
+
+    if (normalized_value)
+        g_free(normalized_value);
+}
+
+static void
+cb_insert_header (MilterReplySignals *reply,
+                  guint32 index, const gchar *name, const gchar *value,
+                  gpointer user_data)
+{
+    MilterServerContext *context = MILTER_SERVER_CONTEXT(reply);
+    MilterManagerChildren *children = user_data;
+    MilterManagerChildrenPrivate *priv;
+    gchar *normalized_value = NULL;
+
+    priv = MILTER_MANAGER_CHILDREN_GET_PRIVATE(children);
+
+    if (!is_end_of_message_state(children, context, "insert-header",
+                                 "[%u]<%s>=<%s>",
+                                 index,
+                                 name,
+                                 MILTER_LOG_NULL_SAFE_STRING(value)))
+        return;
+
+    if (value) {
+        milter_statistics("[milter][header][add](%u): <%s>=<%s>: %s",
+                          milter_agent_get_tag(MILTER_AGENT(context)),
+                          name,
+                          value,
+                          milter_server_context_get_name(context));
+    }
+
+    if (is_evaluation_mode(children, context, "insert-header",
+                           "[%u]<%s>=<%s>",
+                           index,
+                           name,
+                           MILTER_LOG_NULL_SAFE_STRING(value)))
+        return;
+
+    normalized_value = normalize_header_value(children, context, value);
+    if (!record_parallel_modification(children, context,
+                                      PARALLEL_MODIFICATION_INSERT_HEADER,
+                                      index, name,
+                                      normalized_value ? normalized_value : value))
+        milter_headers_insert_header(priv->headers, index, name,
+                                     normalized_value ? normalized_value : value);
+
+    if (normalized_value)
+        g_free(normalized_value);
+}
+
+static void
+cb_change_header (MilterReplySignals *reply,
+                  const gchar *name, guint32 index, const gchar *value,
+                  gpointer user_data)
+{
+    MilterServerContext *context = MILTER_SERVER_CONTEXT(reply);
+    MilterManagerChildren *children = user_data;
+    MilterManagerChildrenPrivate *priv;
+    gchar *normalized_value = NULL;
+
+    priv = MILTER_MANAGER_CHILDREN_GET_PRIVATE(children);
+
+    if (!is_end_of_message_state(children, context, "change-header",
+                                 "<%s>[%u]=<%s>",
+                                 name,
+                                 index,
+                                 MILTER_LOG_NULL_SAFE_STRING(value)))
+        return;
+
+    if (value) {
+        milter_statistics("[milter][header][add](%u): <%s>=<%s>: %s",
+                          milter_agent_get_tag(MILTER_AGENT(context)),
+                          name,
+                          value,
+                          milter_server_context_get_name(context));
+    }
+
+    if (is_evaluation_mode(children, context, "change-header",
+                           "<%s>[%u]=<%s>",
+                           name,
+                           index,
+                           MILTER_LOG_NULL_SAFE_STRING(value)))
+        return;
+
+    normalized_value = normalize_header_value(children, context, value);
+    if (!record_parallel_modification(children, context,
+                                      PARALLEL_MODIFICATION_CHANGE_HEADER,
+                                      index, name,
+                                      normalized_value ? normalized_value : value))
+        milter_headers_change_header(priv->headers,
+                                     name, index,
+                                     normalized_value ? normalized_value : value);
+
+    if (normalized_value)
+        g_free(normalized_value);
+}
+
+static void
+cb_delete_header (MilterReplySignals *reply,
+                  const gchar *name, guint32 index,
+                  gpointer user_data)
+{
+    MilterServerContext *context = MILTER_SERVER_CONTEXT(reply);
+    MilterManagerChildren *children = user_data;
+    MilterManagerChildrenPrivate *priv;
+
+    priv = MILTER_MANAGER_CHILDREN_GET_PRIVATE(children);
+
+    if (!is_end_of_message_state(children, context, "delete-header",
+                                 "<%s>[%u]", name, index))
+        return;
+
+    if (is_evaluation_mode(children, context, "delete-header",
+                           "<%s>[%u]", name, index))
+        return;
+
+    if (record_parallel_modification(children, context,
+                                     PARALLEL_MODIFICATION_DELETE_HEADER,
+                                     index, name, NULL))
+        return;
+
+    milter_headers_delete_header(priv->headers, name, index);
+}
+
+static void
+cb_change_from (MilterReplySignals *reply,
+                const gchar *from, const gchar *parameters,
+                gpointer user_data)
+{
+    MilterServerContext *context = MILTER_SERVER_CONTEXT(reply);
+    MilterManagerChildren *children = user_data;
+    MilterManagerChildrenPrivate *priv;
+
+    priv = MILTER_MANAGER_CHILDREN_GET_PRIVATE(children);
+
+    if (!is_end_of_message_state(children, context, "change-from",
+                                 "<<%s> <%s>>",
+                                 from,
+                                 MILTER_LOG_NULL_SAFE_STRING(parameters)))
+        return;
+
+    if (is_evaluation_mode(children, context, "change-from",
+                           "<<%s> <%s>>",
+                           from,
+                           MILTER_LOG_NULL_SAFE_STRING(parameters)))
+        return;
+
+    if (record_parallel_modification(children, context,
+                                     PARALLEL_MODIFICATION_CHANGE_FROM,
+                                     0, from, parameters))
+        return;
+
+    if (priv->change_from)
+        g_free(priv->change_from);
+    if (priv->change_from_parameters)
+        g_free(priv->change_from_parameters);
+    priv->change_from = g_strdup(from);
+    priv->change_from_parameters = g_strdup(parameters);
+}
+
+static void
+cb_add_recipient (MilterReplySignals *reply,
+                  const gchar *recipient, const gchar *parameters,
+                  gpointer user_data)
+{
+    MilterServerContext *context = MILTER_SERVER_CONTEXT(reply);
+    MilterManagerChildren *children = user_data;
+
+    if (!is_end_of_message_state(children, context, "add-recipient",
+                                 "<<%s> <%s>>",
+                                 recipient,
+                                 MILTER_LOG_NULL_SAFE_STRING(parameters)))
+        return;
+
+    if (is_evaluation_mode(children, context, "add-recipient",
                            "<<%s> <%s>>",
                            recipient,
                            MILTER_LOG_NULL_SAFE_STRING(parameters)))
         return;
 
+    if (record_parallel_modification(children, context,
+                                     PARALLEL_MODIFICATION_ADD_RECIPIENT,
+                                     0, recipient, parameters))
+        return;
+
     g_signal_emit_by_name(children, "add-recipient", recipient, parameters);
 }
 
 static void
-cb_delete_recipient (MilterServerContext *context,
+cb_delete_recipient (MilterReplySignals *reply,
                      const gchar *recipient,
                      gpointer user_data)
 {
+    MilterServerContext *context = MILTER_SERVER_CONTEXT(reply);
     MilterManagerChildren *children = user_data;
 
     if (!is_end_of_message_state(children, context, "delete-recipient",
@@ -2043,16 +3800,23 @@ cb_delete_recipient (MilterServerContext *context,
                            "<%s>", recipient))
         return;
 
+    if (record_parallel_modification(children, context,
+                                     PARALLEL_MODIFICATION_DELETE_RECIPIENT,
+                                     0, recipient, NULL))
+        return;
+
     g_signal_emit_by_name(children, "delete-recipient", recipient);
 }
 
 static void
-cb_replace_body (MilterServerContext *context,
+cb_replace_body (MilterReplySignals *reply,
                  const gchar *chunk, gsize chunk_size,
                  gpointer user_data)
 {
+    MilterServerContext *context = MILTER_SERVER_CONTEXT(reply);
     MilterManagerChildren *children = user_data;
     MilterManagerChildrenPrivate *priv;
+    ParallelTask *task;
 
     priv = MILTER_MANAGER_CHILDREN_GET_PRIVATE(children);
 
@@ -2064,10 +3828,19 @@ cb_replace_body (MilterServerContext *context,
                            "<%" G_GSIZE_FORMAT ">", chunk_size))
         return;
 
+    task = find_parallel_task(children, context);
+    if (task) {
+        if (!task->replaced_body)
+            task->replaced_body = g_string_new_len(chunk, chunk_size);
+        else
+            g_string_append_len(task->replaced_body, chunk, chunk_size);
+        return;
+    }
+
     if (!priv->replaced_body_for_each_child)
         dispose_body_related_data(priv);
 
-    if (!write_body(children, chunk, chunk_size))
+    if (!write_body(children, chunk, chunk_size, FALSE))
         return;
 
     priv->replaced_body_for_each_child = TRUE;
@@ -2075,8 +3848,9 @@ cb_replace_body (MilterServerContext *context,
 }
 
 static void
-cb_progress (MilterServerContext *context, gpointer user_data)
+cb_progress (MilterReplySignals *reply, gpointer user_data)
 {
+    MilterServerContext *context = MILTER_SERVER_CONTEXT(reply);
     MilterManagerChildren *children = user_data;
 
     if (!is_end_of_message_state(children, context, "progress", NULL))
@@ -2098,10 +3872,11 @@ cb_progress (MilterServerContext *context, gpointer user_data)
 }
 
 static void
-cb_quarantine (MilterServerContext *context,
+cb_quarantine (MilterReplySignals *reply,
                const gchar *reason,
                gpointer user_data)
 {
+    MilterServerContext *context = MILTER_SERVER_CONTEXT(reply);
     MilterManagerChildren *children = user_data;
     MilterManagerChildrenPrivate *priv;
 
@@ -2115,20 +3890,26 @@ cb_quarantine (MilterServerContext *context,
                            "<%s>", reason))
         return;
 
+    if (record_parallel_modification(children, context,
+                                     PARALLEL_MODIFICATION_QUARANTINE,
+                                     0, reason, NULL))
+        return;
+
     if (priv->quarantine_reason)
         g_free(priv->quarantine_reason);
     priv->quarantine_reason = g_strdup(reason);
 }
 
 static void
-cb_connection_failure (MilterServerContext *context, gpointer user_data)
+cb_connection_failure (MilterReplySignals *reply, gpointer user_data)
 {
     g_signal_emit_by_name(user_data, "connection-failure");
 }
 
 static void
-cb_shutdown (MilterServerContext *context, gpointer user_data)
+cb_shutdown (MilterReplySignals *reply, gpointer user_data)
 {
+    MilterServerContext *context = MILTER_SERVER_CONTEXT(reply);
     MilterManagerChildren *children = user_data;
 
     g_signal_emit_by_name(children, "shutdown");
@@ -2144,6 +3925,19 @@ cb_stopped (MilterServerContext *context, gpointer user_data)
     priv = MILTER_MANAGER_CHILDREN_GET_PRIVATE(children);
     state = milter_server_context_get_state(context);
 
+    if (find_parallel_task(children, context)) {
+        milter_server_context_abort(context);
+        handle_parallel_task_reply(children, context, state,
+                                   MILTER_STATUS_ACCEPT);
+        return;
+    }
+    if (find_body_follower(children, context)) {
+        milter_server_context_abort(context);
+        handle_body_follower_reply(children, context, state,
+                                   MILTER_STATUS_ACCEPT);
+        return;
+    }
+
     switch (state) {
     case MILTER_SERVER_CONTEXT_STATE_CONNECT:
     case MILTER_SERVER_CONTEXT_STATE_HELO:
@@ -2153,11 +3947,11 @@ cb_stopped (MilterServerContext *context, gpointer user_data)
         break;
     case MILTER_SERVER_CONTEXT_STATE_ENVELOPE_FROM:
         compile_reply_status(children, state, MILTER_STATUS_ACCEPT);
-        cb_continue(context, user_data);
+        cb_continue(MILTER_REPLY_SIGNALS(context), user_data);
         break;
     case MILTER_SERVER_CONTEXT_STATE_ENVELOPE_RECIPIENT:
         milter_server_context_set_status(context, MILTER_STATUS_NOT_CHANGE);
-        cb_continue(context, user_data);
+        cb_continue(MILTER_REPLY_SIGNALS(context), user_data);
         break;
     case MILTER_SERVER_CONTEXT_STATE_DATA:
     case MILTER_SERVER_CONTEXT_STATE_HEADER:
@@ -2199,6 +3993,8 @@ cb_writing_timeout (MilterServerContext *context, gpointer user_data)
     MilterServerContextState state;
     MilterStatus fallback_status;
 
+    record_timeout(context, MILTER_MANAGER_METRICS_TIMEOUT_WRITING);
+
     children = MILTER_MANAGER_CHILDREN(user_data);
     priv = MILTER_MANAGER_CHILDREN_GET_PRIVATE(children);
     state = milter_server_context_get_state(context);
@@ -2225,6 +4021,10 @@ cb_writing_timeout (MilterServerContext *context, gpointer user_data)
         g_free(fallback_status_name);
     }
 
+    if (expire_parallel_task(children, context, state, fallback_status))
+        return;
+    if (expire_body_follower(children, context, state, fallback_status))
+        return;
     compile_reply_status(children, state, fallback_status);
     expire_child(children, context);
     remove_child_from_queue(children, context);
@@ -2239,6 +4039,8 @@ cb_reading_timeout (MilterServerContext *context, gpointer user_data)
     MilterServerContextState state;
     MilterStatus fallback_status;
 
+    record_timeout(context, MILTER_MANAGER_METRICS_TIMEOUT_READING);
+
     children = MILTER_MANAGER_CHILDREN(user_data);
     priv = MILTER_MANAGER_CHILDREN_GET_PRIVATE(children);
     state = milter_server_context_get_state(context);
@@ -2265,6 +4067,10 @@ cb_reading_timeout (MilterServerContext *context, gpointer user_data)
         g_free(fallback_status_name);
     }
 
+    if (expire_parallel_task(children, context, state, fallback_status))
+        return;
+    if (expire_body_follower(children, context, state, fallback_status))
+        return;
     compile_reply_status(children, state, fallback_status);
     expire_child(children, context);
     remove_child_from_queue(children, context);
@@ -2279,6 +4085,8 @@ cb_end_of_message_timeout (MilterServerContext *context, gpointer user_data)
     MilterServerContextState state;
     MilterStatus fallback_status;
 
+    record_timeout(context, MILTER_MANAGER_METRICS_TIMEOUT_END_OF_MESSAGE);
+
     children = MILTER_MANAGER_CHILDREN(user_data);
     priv = MILTER_MANAGER_CHILDREN_GET_PRIVATE(children);
     state = milter_server_context_get_state(context);
@@ -2306,6 +4114,10 @@ cb_end_of_message_timeout (MilterServerContext *context, gpointer user_data)
         g_free(fallback_status_name);
     }
 
+    if (expire_parallel_task(children, context, state, fallback_status))
+        return;
+    if (expire_body_follower(children, context, state, fallback_status))
+        return;
     compile_reply_status(children, state, fallback_status);
     expire_child(children, context);
     remove_child_from_queue(children, context);
@@ -2349,6 +4161,10 @@ cb_error (MilterErrorEmittable *emittable, GError *error, gpointer user_data)
         g_free(fallback_status_name);
     }
 
+    if (expire_parallel_task(children, context, state, fallback_status))
+        return;
+    if (expire_body_follower(children, context, state, fallback_status))
+        return;
     compile_reply_status(children, state, fallback_status);
     expire_child(children, context);
     remove_child_from_queue(children, context);
@@ -2393,6 +4209,19 @@ cb_finished (MilterAgent *agent, gpointer user_data)
         g_free(state_name);
     }
 
+    if (handle_parallel_task_reply(
+            children, context,
+            milter_server_context_get_state(context),
+            milter_manager_child_get_fallback_status(
+                MILTER_MANAGER_CHILD(context))))
+        return;
+    if (handle_body_follower_reply(
+            children, context,
+            milter_server_context_get_state(context),
+            milter_manager_child_get_fallback_status(
+                MILTER_MANAGER_CHILD(context))))
+        return;
+
     switch (priv->processing_state) {
     case MILTER_SERVER_CONTEXT_STATE_NEGOTIATE:
         remove_queue_in_negotiate(children, MILTER_MANAGER_CHILD(context));
@@ -2417,35 +4246,41 @@ cb_finished (MilterAgent *agent, gpointer user_data)
     }
 }
 
+static const MilterReplyHandlers server_context_reply_handlers = {
+    cb_negotiate_reply,
+    cb_continue,
+    cb_reply_code,
+    cb_temporary_failure,
+    cb_reject,
+    cb_accept,
+    cb_discard,
+    cb_add_header,
+    cb_insert_header,
+    cb_change_header,
+    cb_delete_header,
+    cb_change_from,
+    cb_add_recipient,
+    cb_delete_recipient,
+    cb_replace_body,
+    cb_progress,
+    cb_quarantine,
+    cb_connection_failure,
+    cb_shutdown,
+    cb_skip
+};
+
 static void
 setup_server_context_signals (MilterManagerChildren *children,
                               MilterServerContext *server_context)
 {
+    milter_server_context_set_reply_handlers(server_context,
+                                             &server_context_reply_handlers,
+                                             children);
+
 #define CONNECT(name)                                           \
     g_signal_connect(server_context, #name,                     \
                      G_CALLBACK(cb_ ## name), children)
 
-    CONNECT(negotiate_reply);
-    CONNECT(continue);
-    CONNECT(reply_code);
-    CONNECT(temporary_failure);
-    CONNECT(reject);
-    CONNECT(accept);
-    CONNECT(discard);
-    CONNECT(add_header);
-    CONNECT(insert_header);
-    CONNECT(change_header);
-    CONNECT(delete_header);
-    CONNECT(change_from);
-    CONNECT(add_recipient);
-    CONNECT(delete_recipient);
-    CONNECT(replace_body);
-    CONNECT(progress);
-    CONNECT(quarantine);
-    CONNECT(connection_failure);
-    CONNECT(shutdown);
-    CONNECT(skip);
-
     CONNECT(stopped);
 
     CONNECT(writing_timeout);
@@ -2466,26 +4301,8 @@ teardown_server_context_signals (MilterManagerChild *child,
                                          G_CALLBACK(cb_ ## name),       \
                                          user_data)
 
-    DISCONNECT(negotiate_reply);
-    DISCONNECT(continue);
-    DISCONNECT(reply_code);
-    DISCONNECT(temporary_failure);
-    DISCONNECT(reject);
-    DISCONNECT(accept);
-    DISCONNECT(discard);
-    DISCONNECT(add_header);
-    DISCONNECT(insert_header);
-    DISCONNECT(change_header);
-    DISCONNECT(delete_header);
-    DISCONNECT(change_from);
-    DISCONNECT(add_recipient);
-    DISCONNECT(delete_recipient);
-    DISCONNECT(replace_body);
-    DISCONNECT(progress);
-    DISCONNECT(quarantine);
-    DISCONNECT(connection_failure);
-    DISCONNECT(shutdown);
-    DISCONNECT(skip);
+    milter_server_context_set_reply_handlers(MILTER_SERVER_CONTEXT(child),
+                                             NULL, NULL);
 
     DISCONNECT(stopped);
 
@@ -2983,6 +4800,24 @@ send_next_command (MilterManagerChildren *children,
     return send_command_to_child(children, context, next_command);
 }
 
+static gboolean
+has_parallel_group_leader (GList *queue, MilterServerContext *context)
+{
+    const gchar *group;
+    GList *node;
+
+    group = milter_manager_child_get_parallel_group(MILTER_MANAGER_CHILD(context));
+    if (!group)
+        return FALSE;
+
+    for (node = queue; node; node = g_list_next(node)) {
+        if (is_same_parallel_group(MILTER_SERVER_CONTEXT(node->data), group))
+            return TRUE;
+    }
+
+    return FALSE;
+}
+
 static void
 init_command_waiting_child_queue (MilterManagerChildren *children, MilterCommand command)
 {
@@ -3004,6 +4839,10 @@ init_command_waiting_child_queue (MilterManagerChildren *children, MilterCommand
         context = MILTER_SERVER_CONTEXT(node->data);
         if (milter_server_context_is_processing_message(context)) {
             if (milter_server_context_has_accepted_recipient(context)) {
+                /* only the first member stands for its parallel group. */
+                if (has_parallel_group_leader(priv->command_waiting_child_queue,
+                                              context))
+                    continue;
                 priv->command_waiting_child_queue =
                     g_list_append(priv->command_waiting_child_queue, context);
             } else {
@@ -3070,6 +4909,159 @@ init_reply_queue (MilterManagerChildren *children,
                         GINT_TO_POINTER(MILTER_STATUS_NOT_CHANGE));
 }
 
+static MilterManagerEgg *
+find_poolable_egg (MilterManagerChildren *children, MilterManagerChild *child)
+{
+    MilterManagerChildrenPrivate *priv;
+    MilterManagerEgg *egg;
+    const gchar *name;
+
+    priv = MILTER_MANAGER_CHILDREN_GET_PRIVATE(children);
+    if (!priv->configuration || !priv->negotiate_option)
+        return NULL;
+
+    name = milter_server_context_get_name(MILTER_SERVER_CONTEXT(child));
+    egg = milter_manager_configuration_find_egg(priv->configuration, name);
+    if (!egg || milter_manager_egg_get_connection_pool_size(egg) == 0)
+        return NULL;
+
+    return egg;
+}
+
+static gboolean
+cb_idle_reply_pooled_negotiate (gpointer user_data)
+{
+    MilterManagerChildren *children = user_data;
+    MilterManagerChildrenPrivate *priv;
+    GList *node, *replies;
+
+    priv = MILTER_MANAGER_CHILDREN_GET_PRIVATE(children);
+
+    priv->pooled_negotiate_reply_id = 0;
+    replies = priv->pooled_negotiate_replies;
+    priv->pooled_negotiate_replies = NULL;
+    for (node = replies; node; node = g_list_next(node)) {
+        PooledNegotiateReply *reply = node->data;
+
+        if (milter_server_context_is_quitted(MILTER_SERVER_CONTEXT(reply->child)))
+            continue;
+        cb_negotiate_reply(MILTER_REPLY_SIGNALS(reply->child),
+                           reply->option,
+                           reply->macros_requests,
+                           children);
+    }
+    g_list_foreach(replies, (GFunc)pooled_negotiate_reply_free, NULL);
+    g_list_free(replies);
+
+    return FALSE;
+}
+
+static gboolean
+child_attach_pooled_connection (MilterManagerChild *child,
+                                MilterManagerChildren *children)
+{
+    MilterManagerChildrenPrivate *priv;
+    MilterServerContext *context;
+    MilterManagerEgg *egg;
+    GIOChannel *channel = NULL;
+    MilterOption *reply_option = NULL;
+    MilterMacrosRequests *macros_requests = NULL;
+    PooledNegotiateReply *reply;
+    GError *error = NULL;
+
+    priv = MILTER_MANAGER_CHILDREN_GET_PRIVATE(children);
+    context = MILTER_SERVER_CONTEXT(child);
+
+    egg = find_poolable_egg(children, child);
+    if (!egg)
+        return FALSE;
+
+    if (!milter_manager_egg_lease_connection(egg, priv->negotiate_option,
+                                             &channel, &reply_option,
+                                             &macros_requests))
+        return FALSE;
+
+    if (!milter_server_context_attach_connection(context, channel,
+                                                 priv->negotiate_option,
+                                                 reply_option,
+                                                 macros_requests,
+                                                 &error)) {
+        milter_error("[%u] [children][error][connection][pool][attach] "
+                     "[%u] %s: %s",
+                     priv->tag,
+                     milter_agent_get_tag(MILTER_AGENT(context)),
+                     error->message,
+                     milter_server_context_get_name(context));
+        g_error_free(error);
+        g_io_channel_unref(channel);
+        g_object_unref(reply_option);
+        if (macros_requests)
+            g_object_unref(macros_requests);
+        return FALSE;
+    }
+    g_io_channel_unref(channel);
+
+    milter_debug("[%u] [children][milter][start][pooled] [%u] %s",
+                 priv->tag,
+                 milter_agent_get_tag(MILTER_AGENT(context)),
+                 milter_server_context_get_name(context));
+
+    setup_server_context_signals(children, context);
+
+    reply = g_new0(PooledNegotiateReply, 1);
+    reply->child = g_object_ref(child);
+    reply->option = reply_option;
+    reply->macros_requests = macros_requests;
+    priv->pooled_negotiate_replies =
+        g_list_append(priv->pooled_negotiate_replies, reply);
+    if (priv->pooled_negotiate_reply_id == 0) {
+        priv->pooled_negotiate_reply_id =
+            milter_event_loop_add_idle_full(priv->event_loop,
+                                            G_PRIORITY_DEFAULT,
+                                            cb_idle_reply_pooled_negotiate,
+                                            children,
+                                            NULL);
+    }
+
+    return TRUE;
+}
+
+static gboolean
+child_release_pooled_connection (MilterManagerChild *child,
+                                 MilterManagerChildren *children)
+{
+    MilterManagerChildrenPrivate *priv;
+    MilterManagerEgg *egg;
+    MilterOption *reply_option;
+    MilterMacrosRequests *macros_requests;
+    GIOChannel *channel;
+
+    priv = MILTER_MANAGER_CHILDREN_GET_PRIVATE(children);
+
+    reply_option = milter_manager_child_get_negotiate_reply_option(child);
+    if (!reply_option)
+        return FALSE;
+
+    egg = find_poolable_egg(children, child);
+    if (!egg || !milter_manager_egg_is_connection_pool_available(egg))
+        return FALSE;
+
+    channel =
+        milter_server_context_detach_connection(MILTER_SERVER_CONTEXT(child));
+    if (!channel)
+        return FALSE;
+
+    macros_requests =
+        milter_protocol_agent_get_macros_requests(MILTER_PROTOCOL_AGENT(child));
+    milter_manager_egg_release_connection(egg, channel,
+                                          priv->negotiate_option,
+                                          reply_option,
+                                          macros_requests);
+    g_io_channel_unref(channel);
+
+    return TRUE;
+}
+
 static gboolean
 cb_idle_reply_negotiate_on_no_child (gpointer user_data)
 {
@@ -3104,6 +5096,12 @@ milter_manager_children_negotiate (MilterManagerChildren *children,
         priv->initial_yes_steps = milter_option_get_step_yes(priv->option);
     }
 
+    if (priv->negotiate_option)
+        g_object_unref(priv->negotiate_option);
+    priv->negotiate_option = NULL;
+    if (priv->option)
+        priv->negotiate_option = milter_option_copy(priv->option);
+
     if (!priv->milters) {
         priv->negotiated = TRUE;
         dispose_lazy_reply_negotiate_id(priv);
@@ -3129,6 +5127,9 @@ milter_manager_children_negotiate (MilterManagerChildren *children,
     for (node = copied_milters; node; node = g_list_next(node)) {
         MilterManagerChild *child = MILTER_MANAGER_CHILD(node->data);
 
+        if (child_attach_pooled_connection(child, children))
+            continue;
+
         if (!child_establish_connection(child, option, children, FALSE)) {
             if (privilege &&
                 milter_manager_children_start_child(children, child)) {
@@ -3185,7 +5186,7 @@ milter_manager_children_define_macro (MilterManagerChildren *children,
         default:
             break;
         }
-        milter_protocol_agent_set_macros_hash_table(agent, command, macros);
+        milter_protocol_agent_share_macros_hash_table(agent, command, macros);
     }
     return TRUE;
 }
@@ -3300,7 +5301,7 @@ milter_manager_children_connect (MilterManagerChildren *children,
     for (child = targets; child; child = g_list_next(child)) {
         MilterServerContext *context = MILTER_SERVER_CONTEXT(child->data);
         if (!milter_server_context_need_reply(context, state)) {
-            cb_continue(context, children);
+            cb_continue(MILTER_REPLY_SIGNALS(context), children);
         }
     }
     g_list_free(targets);
@@ -3343,7 +5344,7 @@ milter_manager_children_helo (MilterManagerChildren *children,
     for (child = targets; child; child = g_list_next(child)) {
         MilterServerContext *context = MILTER_SERVER_CONTEXT(child->data);
         if (!milter_server_context_need_reply(context, state)) {
-            cb_continue(context, children);
+            cb_continue(MILTER_REPLY_SIGNALS(context), children);
         }
     }
     g_list_free(targets);
@@ -3386,7 +5387,7 @@ milter_manager_children_envelope_from (MilterManagerChildren *children,
     for (child = targets; child; child = g_list_next(child)) {
         MilterServerContext *context = MILTER_SERVER_CONTEXT(child->data);
         if (!milter_server_context_need_reply(context, state)) {
-            cb_continue(context, children);
+            cb_continue(MILTER_REPLY_SIGNALS(context), children);
         }
     }
     g_list_free(targets);
@@ -3430,7 +5431,7 @@ milter_manager_children_envelope_recipient (MilterManagerChildren *children,
     for (child = targets; child; child = g_list_next(child)) {
         MilterServerContext *context = MILTER_SERVER_CONTEXT(child->data);
         if (!milter_server_context_need_reply(context, state)) {
-            cb_continue(context, children);
+            cb_continue(MILTER_REPLY_SIGNALS(context), children);
         }
     }
     g_list_free(targets);
@@ -3476,7 +5477,7 @@ milter_manager_children_data (MilterManagerChildren *children)
     for (child = targets; child; child = g_list_next(child)) {
         MilterServerContext *context = MILTER_SERVER_CONTEXT(child->data);
         if (!milter_server_context_need_reply(context, state)) {
-            cb_continue(context, children);
+            cb_continue(MILTER_REPLY_SIGNALS(context), children);
         }
     }
     g_list_free(targets);
@@ -3494,6 +5495,9 @@ send_command_to_first_waiting_child (MilterManagerChildren *children,
     if (!first_child)
         return MILTER_STATUS_NOT_CHANGE;
 
+    if (is_parallel_child(first_child))
+        return send_command_to_parallel_group(children, first_child);
+
     return send_command_to_child(children, first_child, command);
 }
 
@@ -3532,7 +5536,7 @@ milter_manager_children_unknown (MilterManagerChildren *children,
     for (child = targets; child; child = g_list_next(child)) {
         MilterServerContext *context = MILTER_SERVER_CONTEXT(child->data);
         if (!milter_server_context_need_reply(context, state)) {
-            cb_continue(context, children);
+            cb_continue(MILTER_REPLY_SIGNALS(context), children);
         }
     }
     g_list_free(targets);
@@ -3607,7 +5611,7 @@ milter_manager_children_header (MilterManagerChildren *children,
                          priv->tag, name, value);
             dispose_pending_message_request(priv);
             priv->pending_message_request =
-                pending_header_request_new(name, value);
+                pending_header_request_new(priv->message_arena, name, value);
         }
         return success;
     }
@@ -3615,79 +5619,322 @@ milter_manager_children_header (MilterManagerChildren *children,
     priv->state = MILTER_SERVER_CONTEXT_STATE_HEADER;
     priv->processing_state = priv->state;
     if (!priv->headers)
-        priv->headers = milter_headers_new();
+        priv->headers = milter_headers_new_with_arena(priv->message_arena);
     milter_headers_append_header(priv->headers, name, value);
     init_command_waiting_child_queue(children, MILTER_COMMAND_HEADER);
 
-    return MILTER_STATUS_PROGRESS ==
-        send_command_to_first_waiting_child(children, MILTER_COMMAND_HEADER);
+    return MILTER_STATUS_PROGRESS ==
+        send_command_to_first_waiting_child(children, MILTER_COMMAND_HEADER);
+}
+
+gboolean
+milter_manager_children_end_of_header (MilterManagerChildren *children)
+{
+    MilterManagerChildrenPrivate *priv;
+
+    if (!milter_manager_children_check_processing_message(children))
+        return FALSE;
+
+    priv = MILTER_MANAGER_CHILDREN_GET_PRIVATE(children);
+
+    if (need_data_commmand_emulation(priv)) {
+        gboolean success;
+        milter_debug("[%u] [children][data-command-emulation][end-of-header]",
+                     priv->tag);
+        success = milter_manager_children_data(children);
+        if (success) {
+            milter_debug("[%u] [children][pending-message-request]"
+                         "[end-of-header][keep]",
+                         priv->tag);
+            dispose_pending_message_request(priv);
+            priv->pending_message_request =
+                pending_end_of_header_request_new(priv->message_arena);
+        }
+        return success;
+    }
+
+    priv->state = MILTER_SERVER_CONTEXT_STATE_END_OF_HEADER;
+    priv->processing_state = priv->state;
+    init_command_waiting_child_queue(children, MILTER_COMMAND_END_OF_HEADER);
+
+    return MILTER_STATUS_PROGRESS ==
+        send_command_to_first_waiting_child(children,
+                                            MILTER_COMMAND_END_OF_HEADER);
+}
+
+static gint
+open_body_disk_file (MilterManagerChildren *children)
+{
+    gint fd;
+    gchar *file_name = NULL;
+    GError *error = NULL;
+    MilterManagerChildrenPrivate *priv;
+
+    priv = MILTER_MANAGER_CHILDREN_GET_PRIVATE(children);
+
+    fd = g_file_open_tmp(NULL, &file_name, &error);
+    if (error) {
+        milter_error("[%u] [children][error][body][open] %s",
+                     priv->tag, error->message);
+        milter_error_emittable_emit(MILTER_ERROR_EMITTABLE(children),
+                                    error);
+        g_error_free(error);
+        return -1;
+    }
+    g_unlink(file_name);
+    g_free(file_name);
+
+    return fd;
+}
+
+static gboolean
+open_body_file (MilterManagerChildren *children, gsize size)
+{
+    gint fd;
+    MilterManagerChildrenPrivate *priv;
+
+    priv = MILTER_MANAGER_CHILDREN_GET_PRIVATE(children);
+
+#ifdef HAVE_MEMFD_CREATE
+    {
+        guint64 budget;
+        gsize current_size;
+
+        budget = milter_manager_configuration_get_body_spool_memory_budget(
+            priv->configuration);
+        current_size =
+            GPOINTER_TO_SIZE(g_atomic_pointer_get(&body_memory_files_size));
+        /* Each write reserves its size. See reserve_body_file_memory(). */
+        if (current_size + size <= budget) {
+            fd = memfd_create("milter-manager-body", MFD_CLOEXEC);
+            if (fd != -1) {
+                priv->body_fd = fd;
+                priv->body_file_on_memory = TRUE;
+                return TRUE;
+            }
+            milter_warning("[%u] [children][body][open][memory][fallback] %s",
+                           priv->tag, g_strerror(errno));
+        }
+    }
+#endif
+
+    fd = open_body_disk_file(children);
+    if (fd == -1)
+        return FALSE;
+    priv->body_fd = fd;
+
+    return TRUE;
+}
+
+static gboolean
+spill_body_file (MilterManagerChildren *children)
+{
+    MilterManagerChildrenPrivate *priv;
+    gint fd;
+    gpointer map = NULL;
+    const gchar *data;
+    gsize rest_size;
+
+    priv = MILTER_MANAGER_CHILDREN_GET_PRIVATE(children);
+
+    fd = open_body_disk_file(children);
+    if (fd == -1)
+        return FALSE;
+
+    if (priv->body_file_size > 0) {
+        map = mmap(NULL, priv->body_file_size, PROT_READ, MAP_SHARED,
+                   priv->body_fd, 0);
+        if (map == MAP_FAILED) {
+            emit_body_file_error(children, "map", errno);
+            close(fd);
+            return FALSE;
+        }
+    }
+
+    data = map;
+    rest_size = priv->body_file_size;
+    while (rest_size > 0) {
+        gssize written_size;
+
+        written_size = write(fd, data, rest_size);
+        if (written_size == -1) {
+            if (errno == EINTR)
+                continue;
+            emit_body_file_error(children, "write", errno);
+            if (map)
+                munmap(map, priv->body_file_size);
+            close(fd);
+            return FALSE;
+        }
+        data += written_size;
+        rest_size -= written_size;
+    }
+    if (map)
+        munmap(map, priv->body_file_size);
+
+    milter_debug("[%u] [children][body][spill] <%" G_GSIZE_FORMAT ">",
+                 priv->tag, priv->body_file_size);
+
+    dispose_body_map(priv);
+    close(priv->body_fd);
+    priv->body_fd = fd;
+    release_body_memory(priv->body_file_size);
+    priv->body_file_on_memory = FALSE;
+
+    return TRUE;
+}
+
+static gboolean
+reserve_body_file_memory (MilterManagerChildren *children, gsize size)
+{
+    MilterManagerChildrenPrivate *priv;
+    guint64 budget;
+
+    priv = MILTER_MANAGER_CHILDREN_GET_PRIVATE(children);
+
+    if (!priv->body_file_on_memory)
+        return TRUE;
+
+    budget = milter_manager_configuration_get_body_spool_memory_budget(
+        priv->configuration);
+    if (reserve_body_memory(size, budget))
+        return TRUE;
+
+    return spill_body_file(children);
+}
+
+typedef struct _BodyWriteJob
+{
+    MilterManagerChildren *children;
+    guint generation;
+    gint fd;
+    gchar *data;
+    gsize size;
+    gsize written_size;
+    gint error_number;
+} BodyWriteJob;
+
+static gboolean send_body_to_first_child (MilterManagerChildren *children,
+                                          const gchar *chunk,
+                                          gsize size);
+static gboolean process_body_write_queue (MilterManagerChildren *children);
+
+static void
+body_write_job_run (gpointer user_data)
+{
+    BodyWriteJob *job = user_data;
+
+    while (job->written_size < job->size) {
+        gssize written_size;
+
+        written_size = write(job->fd,
+                             job->data + job->written_size,
+                             job->size - job->written_size);
+        if (written_size == -1) {
+            if (errno == EINTR)
+                continue;
+            job->error_number = errno;
+            break;
+        }
+        job->written_size += written_size;
+    }
+    close(job->fd);
+}
+
+static void
+reply_body_fallback_status (MilterManagerChildren *children)
+{
+    MilterManagerChildrenPrivate *priv;
+    MilterStatus status;
+
+    priv = MILTER_MANAGER_CHILDREN_GET_PRIVATE(children);
+    status = milter_manager_configuration_get_fallback_status(
+        priv->configuration);
+    g_signal_emit_by_name(children, status_to_signal_name(status));
 }
 
-gboolean
-milter_manager_children_end_of_header (MilterManagerChildren *children)
+static void
+body_write_job_done (gpointer user_data)
 {
+    BodyWriteJob *job = user_data;
+    MilterManagerChildren *children;
     MilterManagerChildrenPrivate *priv;
+    gsize forward_size;
 
-    if (!milter_manager_children_check_processing_message(children))
-        return FALSE;
-
+    children = job->children;
     priv = MILTER_MANAGER_CHILDREN_GET_PRIVATE(children);
-
-    if (need_data_commmand_emulation(priv)) {
-        gboolean success;
-        milter_debug("[%u] [children][data-command-emulation][end-of-header]",
-                     priv->tag);
-        success = milter_manager_children_data(children);
-        if (success) {
-            milter_debug("[%u] [children][pending-message-request]"
-                         "[end-of-header][keep]",
-                         priv->tag);
-            dispose_pending_message_request(priv);
-            priv->pending_message_request =
-                pending_end_of_header_request_new();
+    if (job->generation == priv->body_generation) {
+        priv->body_writing = FALSE;
+        priv->body_file_size += job->written_size;
+        milter_manager_metrics_add_body_spool_size(job->written_size);
+
+        forward_size = priv->body_forward_size;
+        priv->body_forward_size = 0;
+        if (job->error_number != 0) {
+            emit_body_file_error(children, "write", job->error_number);
+            clear_body_write_queue(priv);
+            if (forward_size > 0)
+                reply_body_fallback_status(children);
+        } else {
+            gboolean success = TRUE;
+
+            if (forward_size > 0) {
+                milter_debug("[%u] [children][body][written] "
+                             "size=%" G_GSIZE_FORMAT,
+                             priv->tag, job->written_size);
+                success =
+                    send_body_to_first_child(children,
+                                             job->data + job->size -
+                                             forward_size,
+                                             forward_size);
+            }
+            if (success)
+                success = process_body_write_queue(children);
+            if (!success) {
+                clear_body_write_queue(priv);
+                reply_body_fallback_status(children);
+            }
         }
-        return success;
     }
 
-    priv->state = MILTER_SERVER_CONTEXT_STATE_END_OF_HEADER;
-    priv->processing_state = priv->state;
-    init_command_waiting_child_queue(children, MILTER_COMMAND_END_OF_HEADER);
-
-    return MILTER_STATUS_PROGRESS ==
-        send_command_to_first_waiting_child(children,
-                                            MILTER_COMMAND_END_OF_HEADER);
+    g_object_unref(children);
+    g_free(job->data);
+    g_free(job);
 }
 
 static gboolean
-open_body_file (MilterManagerChildren *children)
+write_body_to_file_async (MilterManagerChildren *children,
+                          const gchar *chunk,
+                          gsize size)
 {
-    gint fd;
-    GError *error = NULL;
     MilterManagerChildrenPrivate *priv;
+    BodyWriteJob *job;
+    gint fd;
 
     priv = MILTER_MANAGER_CHILDREN_GET_PRIVATE(children);
 
-    fd = g_file_open_tmp(NULL, &priv->body_file_name, &error);
-    if (error) {
-        milter_error("[%u] [children][error][body][open] %s",
-                     priv->tag, error->message);
-        milter_error_emittable_emit(MILTER_ERROR_EMITTABLE(children),
-                                    error);
-        g_error_free(error);
+    /* The job owns its descriptor because the body file may be
+     * disposed before the write finishes. */
+    fd = dup(priv->body_fd);
+    if (fd == -1) {
+        emit_body_file_error(children, "write", errno);
         return FALSE;
     }
-    priv->body_file = g_io_channel_unix_new(fd);
-    g_io_channel_set_close_on_unref(priv->body_file, TRUE);
 
-    g_io_channel_set_encoding(priv->body_file, NULL, &error);
-    if (error) {
-        milter_error("[%u] [children][error][body][encoding] %s",
-                     priv->tag, error->message);
-        milter_error_emittable_emit(MILTER_ERROR_EMITTABLE(children),
-                                    error);
-        g_error_free(error);
-        return FALSE;
-    }
+    job = g_new0(BodyWriteJob, 1);
+    job->children = g_object_ref(children);
+    job->generation = priv->body_generation;
+    job->fd = fd;
+    job->data = g_malloc(size);
+    memcpy(job->data, chunk, size);
+    job->size = size;
+
+    priv->body_writing = TRUE;
+    priv->body_forward_size = 0;
+    milter_event_loop_add_job(priv->event_loop,
+                              body_write_job_run,
+                              body_write_job_done,
+                              job);
 
     return TRUE;
 }
@@ -3695,32 +5942,42 @@ open_body_file (MilterManagerChildren *children)
 static gboolean
 write_body_to_file (MilterManagerChildren *children,
                     const gchar *chunk,
-                    gsize size)
+                    gsize size,
+                    gboolean asynchronous)
 {
-    GError *error = NULL;
-    gsize written_size;
     MilterManagerChildrenPrivate *priv;
 
     priv = MILTER_MANAGER_CHILDREN_GET_PRIVATE(children);
 
-    if (!priv->body_file && !open_body_file(children))
+    if (priv->body_fd == -1 && !open_body_file(children, size))
         return FALSE;
 
-    if (!priv->body_file)
-        return TRUE;
-
     if (!chunk || size == 0)
         return TRUE;
 
-    g_io_channel_write_chars(priv->body_file, chunk, size, &written_size, &error);
-    if (error) {
-        milter_error("[%u] [children][error][body][write] %s",
-                     priv->tag,
-                     error->message);
-        milter_error_emittable_emit(MILTER_ERROR_EMITTABLE(children),
-                                    error);
-        g_error_free(error);
+    if (!reserve_body_file_memory(children, size))
         return FALSE;
+
+    /* Disk may be slow. Don't block other sessions on the loop. */
+    if (asynchronous && !priv->body_file_on_memory)
+        return write_body_to_file_async(children, chunk, size);
+
+    while (size > 0) {
+        gssize written_size;
+
+        written_size = write(priv->body_fd, chunk, size);
+        if (written_size == -1) {
+            if (errno == EINTR)
+                continue;
+            if (priv->body_file_on_memory)
+                release_body_memory(size);
+            emit_body_file_error(children, "write", errno);
+            return FALSE;
+        }
+        chunk += written_size;
+        size -= written_size;
+        priv->body_file_size += written_size;
+        milter_manager_metrics_add_body_spool_size(written_size);
     }
 
     return TRUE;
@@ -3729,9 +5986,11 @@ write_body_to_file (MilterManagerChildren *children,
 static gboolean
 write_body_to_string (MilterManagerChildren *children,
                       const gchar *chunk,
-                      gsize size)
+                      gsize size,
+                      gboolean asynchronous)
 {
     MilterManagerChildrenPrivate *priv;
+    guint max_on_memory_body_size;
 
     priv = MILTER_MANAGER_CHILDREN_GET_PRIVATE(children);
 
@@ -3740,10 +5999,15 @@ write_body_to_string (MilterManagerChildren *children,
     else
         g_string_append_len(priv->body, chunk, size);
 
-    if (priv->body->len > MAX_ON_MEMORY_BODY_SIZE) {
+    max_on_memory_body_size =
+        milter_manager_configuration_get_max_on_memory_body_size(
+            priv->configuration);
+    if (priv->body->len > max_on_memory_body_size) {
         gboolean success;
 
-        success = write_body_to_file(children, priv->body->str, priv->body->len);
+        success = write_body_to_file(children,
+                                     priv->body->str, priv->body->len,
+                                     asynchronous);
         g_string_free(priv->body, TRUE);
         priv->body = NULL;
 
@@ -3755,66 +6019,95 @@ write_body_to_string (MilterManagerChildren *children,
 
 static gboolean
 write_body (MilterManagerChildren *children,
-            const gchar *chunk, gsize size)
+            const gchar *chunk, gsize size,
+            gboolean asynchronous)
 {
     MilterManagerChildrenPrivate *priv;
 
     priv = MILTER_MANAGER_CHILDREN_GET_PRIVATE(children);
 
-    if (priv->body_file)
-        return write_body_to_file(children, chunk, size);
+    if (priv->body_fd != -1)
+        return write_body_to_file(children, chunk, size, asynchronous);
     else
-        return write_body_to_string(children, chunk, size);
+        return write_body_to_string(children, chunk, size, asynchronous);
 }
 
-gboolean
-milter_manager_children_body (MilterManagerChildren *children,
-                              const gchar           *chunk,
-                              gsize                  size)
+static gboolean
+child_may_change_message (MilterServerContext *context)
 {
-    MilterManagerChildrenPrivate *priv;
-    MilterServerContext *first_child;
-    MilterServerContextState state = MILTER_SERVER_CONTEXT_STATE_BODY;
+    MilterOption *option;
 
-    if (!milter_manager_children_check_processing_message(children))
-        return FALSE;
+    option = milter_manager_child_get_negotiate_reply_option(
+        MILTER_MANAGER_CHILD(context));
+    if (!option)
+        return TRUE;
+
+    return (milter_option_get_action(option) &
+            (MILTER_ACTION_ADD_HEADERS |
+             MILTER_ACTION_CHANGE_HEADERS |
+             MILTER_ACTION_CHANGE_BODY));
+}
+
+static gboolean
+need_body_spool (MilterManagerChildren *children)
+{
+    MilterManagerChildrenPrivate *priv;
+    GList *node;
+    gboolean changeable = FALSE;
 
     priv = MILTER_MANAGER_CHILDREN_GET_PRIVATE(children);
 
-    if (need_data_commmand_emulation(priv)) {
-        gboolean success;
-        milter_debug("[%u] [children][data-command-emulation][body] "
-                     "size=%" G_GSIZE_FORMAT,
-                     priv->tag, size);
-        success = milter_manager_children_data(children);
-        if (success) {
-            milter_debug("[%u] [children][pending-message-request][body][keep] "
-                         "size=%" G_GSIZE_FORMAT,
-                         priv->tag, size);
-            dispose_pending_message_request(priv);
-            priv->pending_message_request =
-                pending_body_request_new(chunk, size);
-        }
-        return success;
+    /* the MTA doesn't wait for body replies, so followers can't hold
+     * it back. */
+    if (milter_option_get_step(priv->option) & MILTER_STEP_NO_REPLY_BODY)
+        return TRUE;
+
+    /*
+     * Later children read headers and body as they arrive, so nothing
+     * before a body receiver may change them. Parallel group members
+     * read the stored body at their own pace.
+     */
+    for (node = priv->command_waiting_child_queue;
+         node;
+         node = g_list_next(node)) {
+        MilterServerContext *context = node->data;
+
+        if (is_parallel_child(context))
+            return TRUE;
+        if (changeable && child_receives_body(context))
+            return TRUE;
+        if (child_may_change_message(context))
+            changeable = TRUE;
     }
 
-    milter_debug("[%u] [children][body] size=%" G_GSIZE_FORMAT,
-                 priv->tag, size);
+    return FALSE;
+}
 
-    init_command_waiting_child_queue(children, MILTER_COMMAND_BODY);
+static gboolean
+send_body_to_first_child (MilterManagerChildren *children,
+                          const gchar *chunk,
+                          gsize size)
+{
+    MilterManagerChildrenPrivate *priv;
+    MilterServerContext *first_child;
+    MilterServerContextState state = MILTER_SERVER_CONTEXT_STATE_BODY;
+
+    priv = MILTER_MANAGER_CHILDREN_GET_PRIVATE(children);
 
     first_child = get_first_child_in_command_waiting_child_queue(children);
     if (!first_child)
         return FALSE;
 
-    if (!write_body(children, chunk, size))
-        return FALSE;
-
     priv->state = state;
     priv->processing_state = state;
     priv->replaced_body_for_each_child = FALSE;
     priv->sending_body = FALSE;
 
+    if (is_parallel_child(first_child)) {
+        send_command_to_parallel_group(children, first_child);
+        return TRUE;
+    }
+
     if (milter_server_context_get_skip_body(first_child)) {
         /*
          * If the first child is not needed the command,
@@ -3826,49 +6119,120 @@ milter_manager_children_body (MilterManagerChildren *children,
     } else {
         return milter_server_context_body(first_child, chunk, size);
     }
+}
+
+static gboolean
+spool_body_chunk (MilterManagerChildren *children,
+                  const gchar *chunk,
+                  gsize size)
+{
+    MilterManagerChildrenPrivate *priv;
+
+    priv = MILTER_MANAGER_CHILDREN_GET_PRIVATE(children);
+
+    if (!write_body(children, chunk, size, TRUE))
+        return FALSE;
+
+    if (priv->body_writing) {
+        /* Forwarded to the first child when the chunk is spooled. */
+        priv->body_forward_size = size;
+        return TRUE;
+    }
 
+    return send_body_to_first_child(children, chunk, size);
 }
 
-static MilterStatus
-init_child_for_body_string (MilterManagerChildren *children,
-                            MilterServerContext *context)
+static gboolean start_end_of_message (MilterManagerChildren *children);
+
+static gboolean
+process_body_write_queue (MilterManagerChildren *children)
 {
     MilterManagerChildrenPrivate *priv;
+    GString *chunk;
 
     priv = MILTER_MANAGER_CHILDREN_GET_PRIVATE(children);
-    priv->sent_body_offset = 0;
 
-    return MILTER_STATUS_NOT_CHANGE;
+    while (!priv->body_writing &&
+           (chunk = g_queue_pop_head(priv->body_write_queue))) {
+        gboolean success;
+
+        milter_debug("[%u] [children][body][dequeue] size=%" G_GSIZE_FORMAT,
+                     priv->tag, chunk->len);
+        success = spool_body_chunk(children, chunk->str, chunk->len);
+        g_string_free(chunk, TRUE);
+        if (!success)
+            return FALSE;
+    }
+
+    if (priv->body_writing || !priv->end_of_message_waiting_body)
+        return TRUE;
+
+    priv->end_of_message_waiting_body = FALSE;
+    milter_debug("[%u] [children][end-of-message][body-written]", priv->tag);
+    return start_end_of_message(children);
 }
 
-static MilterStatus
-init_child_for_body_file (MilterManagerChildren *children,
-                          MilterServerContext *context)
+gboolean
+milter_manager_children_body (MilterManagerChildren *children,
+                              const gchar           *chunk,
+                              gsize                  size)
 {
     MilterManagerChildrenPrivate *priv;
-    GError *error = NULL;
+    MilterServerContext *first_child;
+
+    if (!milter_manager_children_check_processing_message(children))
+        return FALSE;
 
     priv = MILTER_MANAGER_CHILDREN_GET_PRIVATE(children);
-    if (!priv->body_file)
-        return MILTER_STATUS_NOT_CHANGE;
 
-    g_io_channel_seek_position(priv->body_file, 0, G_SEEK_SET, &error);
-    if (error) {
-        MilterManagerChild *child;
+    if (need_data_commmand_emulation(priv)) {
+        gboolean success;
+        milter_debug("[%u] [children][data-command-emulation][body] "
+                     "size=%" G_GSIZE_FORMAT,
+                     priv->tag, size);
+        success = milter_manager_children_data(children);
+        if (success) {
+            milter_debug("[%u] [children][pending-message-request][body][keep] "
+                         "size=%" G_GSIZE_FORMAT,
+                         priv->tag, size);
+            dispose_pending_message_request(priv);
+            priv->pending_message_request =
+                pending_body_request_new(priv->message_arena, chunk, size);
+        }
+        return success;
+    }
 
-        milter_error("[%u] [children][error][body][send][seek] [%u] %s: %s",
-                     priv->tag,
-                     milter_agent_get_tag(MILTER_AGENT(context)),
-                     error->message,
-                     milter_server_context_get_name(context));
-        milter_error_emittable_emit(MILTER_ERROR_EMITTABLE(children), error);
-        g_error_free(error);
+    milter_debug("[%u] [children][body] size=%" G_GSIZE_FORMAT,
+                 priv->tag, size);
 
-        child = MILTER_MANAGER_CHILD(context);
-        return milter_manager_child_get_fallback_status(child);
+    init_command_waiting_child_queue(children, MILTER_COMMAND_BODY);
+
+    first_child = get_first_child_in_command_waiting_child_queue(children);
+    if (!first_child)
+        return FALSE;
+
+    if (priv->body_writing) {
+        /* The MTA doesn't wait for our reply with no-reply-body. */
+        milter_debug("[%u] [children][body][queue] size=%" G_GSIZE_FORMAT,
+                     priv->tag, size);
+        g_queue_push_tail(priv->body_write_queue, g_string_new_len(chunk, size));
+        return TRUE;
     }
 
-    return MILTER_STATUS_NOT_CHANGE;
+    if (priv->state != MILTER_SERVER_CONTEXT_STATE_BODY) {
+        priv->body_streaming = !need_body_spool(children);
+        if (priv->body_streaming) {
+            milter_debug("[%u] [children][body][streaming]", priv->tag);
+            start_body_followers(children);
+        }
+    }
+
+    if (priv->body_streaming) {
+        body_follower_push_chunk(children, chunk, size);
+        return send_body_to_first_child(children, chunk, size);
+    }
+
+    return spool_body_chunk(children, chunk, size);
 }
 
 static MilterStatus
@@ -3888,70 +6252,38 @@ init_child_for_body (MilterManagerChildren *children,
 
     priv->replaced_body_for_each_child = FALSE;
     priv->sending_body = TRUE;
-    if (priv->body)
-        return init_child_for_body_string(children, context);
-    else
-        return init_child_for_body_file(children, context);
+    priv->sent_body_offset = 0;
+
+    return MILTER_STATUS_NOT_CHANGE;
 }
 
 static MilterStatus
 send_body_to_child_file (MilterManagerChildren *children,
                          MilterServerContext *context)
 {
-    MilterStatus status = MILTER_STATUS_PROGRESS;
-    GError *error = NULL;
-    GIOStatus io_status = G_IO_STATUS_NORMAL;
     MilterManagerChildrenPrivate *priv;
-    gchar buffer[MILTER_CHUNK_SIZE + 1];
-    gsize read_size, chunk_size;
     MilterManagerChild *child;
+    const gchar *body;
+    gsize body_size, chunk_size, write_size;
 
     priv = MILTER_MANAGER_CHILDREN_GET_PRIVATE(children);
-    if (!priv->body_file)
+    child = MILTER_MANAGER_CHILD(context);
+
+    if (!get_body(children, &body, &body_size))
+        return milter_manager_child_get_fallback_status(child);
+    if (priv->sent_body_offset >= body_size)
         return MILTER_STATUS_NOT_CHANGE;
 
     chunk_size =
         milter_manager_configuration_get_chunk_size(priv->configuration);
-    io_status = g_io_channel_read_chars(priv->body_file,
-                                        buffer, chunk_size,
-                                        &read_size, &error);
-
-    child = MILTER_MANAGER_CHILD(context);
-    switch (io_status) {
-    case G_IO_STATUS_ERROR:
-        status = milter_manager_child_get_fallback_status(child);
-        break;
-    case G_IO_STATUS_NORMAL:
-        if (milter_server_context_body(context, buffer, read_size)) {
-            status = MILTER_STATUS_PROGRESS;
-        } else {
-            status = milter_manager_child_get_fallback_status(child);
-        }
-        break;
-    case G_IO_STATUS_EOF:
-        status = MILTER_STATUS_NOT_CHANGE;
-        break;
-    case G_IO_STATUS_AGAIN:
-        status = MILTER_STATUS_PROGRESS;
-        break;
-    default:
-        status = milter_manager_child_get_fallback_status(child);
-        break;
-    }
-
-    if (error) {
-        milter_error("[%u] [children][error][body][send] [%u] %s: %s",
-                     priv->tag,
-                     milter_agent_get_tag(MILTER_AGENT(context)),
-                     error->message,
-                     milter_server_context_get_name(context));
-        milter_error_emittable_emit(MILTER_ERROR_EMITTABLE(children), error);
-        g_error_free(error);
-
-        status = milter_manager_child_get_fallback_status(child);
-    }
+    write_size = MIN(body_size - priv->sent_body_offset, chunk_size);
+    if (!milter_server_context_body(context,
+                                    body + priv->sent_body_offset,
+                                    write_size))
+        return milter_manager_child_get_fallback_status(child);
 
-    return status;
+    priv->sent_body_offset += write_size;
+    return MILTER_STATUS_PROGRESS;
 }
 
 static MilterStatus
@@ -4038,26 +6370,41 @@ milter_manager_children_end_of_message (MilterManagerChildren *children,
                          priv->tag, size);
             dispose_pending_message_request(priv);
             priv->pending_message_request =
-                pending_end_of_message_request_new(chunk, size);
+                pending_end_of_message_request_new(priv->message_arena,
+                                                   chunk, size);
         }
         return success;
     }
 
+    priv->end_of_message_chunk =
+        milter_memory_arena_strdup(priv->message_arena, chunk);
+    priv->end_of_message_size = size;
+
+    /* Spooled body chunks must reach children before end-of-message. */
+    if (priv->body_writing) {
+        milter_debug("[%u] [children][end-of-message][wait-body]", priv->tag);
+        priv->end_of_message_waiting_body = TRUE;
+        return TRUE;
+    }
+
+    return start_end_of_message(children);
+}
+
+static gboolean
+start_end_of_message (MilterManagerChildren *children)
+{
+    MilterManagerChildrenPrivate *priv;
+
+    priv = MILTER_MANAGER_CHILDREN_GET_PRIVATE(children);
+
     init_command_waiting_child_queue(children, MILTER_COMMAND_END_OF_MESSAGE);
 
     priv->processing_header_index = 0;
     if (!priv->headers)
-        priv->headers = milter_headers_new();
+        priv->headers = milter_headers_new_with_arena(priv->message_arena);
     if (!priv->original_headers)
         priv->original_headers = milter_headers_copy(priv->headers);
 
-    if (priv->end_of_message_chunk)
-        g_free(priv->end_of_message_chunk);
-    priv->end_of_message_chunk = g_strdup(chunk);
-    priv->end_of_message_size = size;
-    if (priv->body_file)
-        g_io_channel_seek_position(priv->body_file, 0, G_SEEK_SET, NULL);
-
     priv->state = MILTER_SERVER_CONTEXT_STATE_END_OF_MESSAGE;
     priv->processing_state = priv->state;
     return MILTER_STATUS_PROGRESS ==
@@ -4088,6 +6435,13 @@ milter_manager_children_quit (MilterManagerChildren *children)
         if (state == MILTER_SERVER_CONTEXT_STATE_QUIT)
             continue;
 
+        if (child_release_pooled_connection(MILTER_MANAGER_CHILD(context),
+                                            children))
+            continue;
+        /* QUIT_NC was sent but the connection was closed. */
+        if (milter_server_context_is_quitted(context))
+            continue;
+
         if (!milter_server_context_quit(context))
             success = FALSE;
     }
@@ -25,6 +25,7 @@
 #include <milter/manager/milter-manager-objects.h>
 #include <milter/manager/milter-manager-child.h>
 #include <milter/core/milter-reply-signals.h>
+#include <milter/client.h>
 
 G_BEGIN_DECLS
 
@@ -72,6 +73,11 @@ GList                 *milter_manager_children_get_children(MilterManagerChildre
 void                   milter_manager_children_foreach     (MilterManagerChildren *children,
                                                             GFunc                  func,
                                                             gpointer               user_data);
+void                   milter_manager_children_add_native_condition
+                                                           (MilterManagerChildren *children,
+                                                            MilterManagerChild    *child,
+                                                            MilterManagerApplicableCondition *condition,
+                                                            MilterClientContext   *context);
 
 gboolean               milter_manager_children_negotiate   (MilterManagerChildren *children,
                                                             MilterOption          *option,
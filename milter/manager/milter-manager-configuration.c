@@ -37,6 +37,9 @@
 #define DEFAULT_FALLBACK_STATUS_AT_DISCONNECT MILTER_STATUS_TEMPORARY_FAILURE
 #define DEFAULT_MAINTENANCE_INTERVAL 10
 #define DEFAULT_CONNECTION_CHECK_INTERVAL 0
+#define DEFAULT_CONNECTION_CHECK_BUDGET 10
+#define DEFAULT_MAX_ON_MEMORY_BODY_SIZE 5242880 /* 5Mbyte */
+#define DEFAULT_STATISTICS_ROTATE_SIZE 104857600 /* 100Mbyte */
 
 #define MILTER_MANAGER_CONFIGURATION_GET_PRIVATE(obj)                   \
     (G_TYPE_INSTANCE_GET_PRIVATE((obj),                                 \
@@ -75,13 +78,21 @@ struct _MilterManagerConfigurationPrivate
     gchar *custom_configuration_directory;
     GHashTable *locations;
     guint connection_check_interval;
+    guint connection_check_budget;
+    gboolean use_native_connection_checker;
     MilterClientEventLoopBackend event_loop_backend;
     guint n_workers;
+    gboolean reuse_port;
+    gboolean direct_write;
     guint default_packet_buffer_size;
     gboolean use_syslog;
     gchar *syslog_facility;
     guint chunk_size;
     guint max_pending_finished_sessions;
+    guint max_on_memory_body_size;
+    guint64 body_spool_memory_budget;
+    gchar *statistics_path;
+    guint64 statistics_rotate_size;
 };
 
 enum
@@ -112,14 +123,22 @@ enum
     PROP_MAX_FILE_DESCRIPTORS,
     PROP_CUSTOM_CONFIGURATION_DIRECTORY,
     PROP_CONNECTION_CHECK_INTERVAL,
+    PROP_CONNECTION_CHECK_BUDGET,
+    PROP_USE_NATIVE_CONNECTION_CHECKER,
     PROP_EVENT_LOOP_BACKEND,
     PROP_N_WORKERS,
+    PROP_REUSE_PORT,
+    PROP_DIRECT_WRITE,
     PROP_DEFAULT_PACKET_BUFFER_SIZE,
     PROP_PREFIX,
     PROP_USE_SYSLOG,
     PROP_SYSLOG_FACILITY,
     PROP_CHUNK_SIZE,
-    PROP_MAX_PENDING_FINISHED_SESSIONS
+    PROP_MAX_PENDING_FINISHED_SESSIONS,
+    PROP_MAX_ON_MEMORY_BODY_SIZE,
+    PROP_BODY_SPOOL_MEMORY_BUDGET,
+    PROP_STATISTICS_PATH,
+    PROP_STATISTICS_ROTATE_SIZE
 };
 
 enum
@@ -399,6 +418,28 @@ milter_manager_configuration_class_init (MilterManagerConfigurationClass *klass)
                                     PROP_CONNECTION_CHECK_INTERVAL,
                                     spec);
 
+    spec = g_param_spec_uint("connection-check-budget",
+                             "Connection check budget",
+                             "The maximum time in milliseconds spent on "
+                             "connection checks in a round",
+                             0,
+                             G_MAXUINT,
+                             DEFAULT_CONNECTION_CHECK_BUDGET,
+                             G_PARAM_READWRITE);
+    g_object_class_install_property(gobject_class,
+                                    PROP_CONNECTION_CHECK_BUDGET,
+                                    spec);
+
+    spec = g_param_spec_boolean("use-native-connection-checker",
+                                "Use native connection checker",
+                                "Whether disconnected SMTP clients are "
+                                "detected by asking the kernel directly",
+                                FALSE,
+                                G_PARAM_READWRITE);
+    g_object_class_install_property(gobject_class,
+                                    PROP_USE_NATIVE_CONNECTION_CHECKER,
+                                    spec);
+
 
     spec = g_param_spec_enum("event-loop-backend",
                              "Event loop backend",
@@ -417,6 +458,22 @@ milter_manager_configuration_class_init (MilterManagerConfigurationClass *klass)
                              G_PARAM_READWRITE);
     g_object_class_install_property(gobject_class, PROP_N_WORKERS, spec);
 
+    spec = g_param_spec_boolean("reuse-port",
+                                "Reuse port",
+                                "Whether each worker process listens on "
+                                "its own socket with SO_REUSEPORT",
+                                FALSE,
+                                G_PARAM_READWRITE);
+    g_object_class_install_property(gobject_class, PROP_REUSE_PORT, spec);
+
+    spec = g_param_spec_boolean("direct-write",
+                                "Direct write",
+                                "Whether commands and replies are written "
+                                "without waiting for the event loop",
+                                FALSE,
+                                G_PARAM_READWRITE);
+    g_object_class_install_property(gobject_class, PROP_DIRECT_WRITE, spec);
+
     spec = g_param_spec_uint("default-packet-buffer-size",
                              "Default packet buffer size",
                              "The default packet buffer size of client contexts "
@@ -466,6 +523,46 @@ milter_manager_configuration_class_init (MilterManagerConfigurationClass *klass)
                                     PROP_MAX_PENDING_FINISHED_SESSIONS,
                                     spec);
 
+    spec = g_param_spec_uint("max-on-memory-body-size",
+                             "Maximum on memory body size",
+                             "The maximum body size kept on memory "
+                             "of milter-manager",
+                             0, G_MAXUINT, DEFAULT_MAX_ON_MEMORY_BODY_SIZE,
+                             G_PARAM_READWRITE);
+    g_object_class_install_property(gobject_class,
+                                    PROP_MAX_ON_MEMORY_BODY_SIZE,
+                                    spec);
+
+    spec = g_param_spec_uint64("body-spool-memory-budget",
+                               "Body spool memory budget",
+                               "The total size of bodies spooled on "
+                               "anonymous memory files of milter-manager",
+                               0, G_MAXUINT64, 0,
+                               G_PARAM_READWRITE);
+    g_object_class_install_property(gobject_class,
+                                    PROP_BODY_SPOOL_MEMORY_BUDGET,
+                                    spec);
+
+    spec = g_param_spec_string("statistics-path",
+                               "Statistics path",
+                               "The path of structured statistics records "
+                               "of milter-manager",
+                               NULL,
+                               G_PARAM_READWRITE);
+    g_object_class_install_property(gobject_class,
+                                    PROP_STATISTICS_PATH,
+                                    spec);
+
+    spec = g_param_spec_uint64("statistics-rotate-size",
+                               "Statistics rotate size",
+                               "The size to rotate structured statistics "
+                               "records of milter-manager",
+                               0, G_MAXUINT64, DEFAULT_STATISTICS_ROTATE_SIZE,
+                               G_PARAM_READWRITE);
+    g_object_class_install_property(gobject_class,
+                                    PROP_STATISTICS_ROTATE_SIZE,
+                                    spec);
+
     signals[CONNECTED] =
         g_signal_new("connected",
                      G_TYPE_FROM_CLASS(klass),
@@ -515,11 +612,19 @@ milter_manager_configuration_init (MilterManagerConfiguration *configuration)
                                             g_free,
                                             (GDestroyNotify)g_dataset_destroy);
     priv->connection_check_interval = DEFAULT_CONNECTION_CHECK_INTERVAL;
+    priv->connection_check_budget = DEFAULT_CONNECTION_CHECK_BUDGET;
+    priv->use_native_connection_checker = FALSE;
     priv->n_workers = 0;
+    priv->reuse_port = FALSE;
+    priv->direct_write = FALSE;
     priv->default_packet_buffer_size = 0;
     priv->syslog_facility = NULL;
     priv->chunk_size = MILTER_CHUNK_SIZE;
     priv->max_pending_finished_sessions = 0;
+    priv->max_on_memory_body_size = DEFAULT_MAX_ON_MEMORY_BODY_SIZE;
+    priv->body_spool_memory_budget = 0;
+    priv->statistics_path = NULL;
+    priv->statistics_rotate_size = DEFAULT_STATISTICS_ROTATE_SIZE;
 
     config_dir_env = g_getenv("MILTER_MANAGER_CONFIG_DIR");
     if (config_dir_env)
@@ -669,6 +774,14 @@ set_property (GObject      *object,
         milter_manager_configuration_set_connection_check_interval(
             config, g_value_get_uint(value));
         break;
+    case PROP_CONNECTION_CHECK_BUDGET:
+        milter_manager_configuration_set_connection_check_budget(
+            config, g_value_get_uint(value));
+        break;
+    case PROP_USE_NATIVE_CONNECTION_CHECKER:
+        milter_manager_configuration_set_use_native_connection_checker(
+            config, g_value_get_boolean(value));
+        break;
     case PROP_EVENT_LOOP_BACKEND:
         milter_manager_configuration_set_event_loop_backend(
             config, g_value_get_enum(value));
@@ -676,6 +789,14 @@ set_property (GObject      *object,
     case PROP_N_WORKERS:
         milter_manager_configuration_set_n_workers(config, g_value_get_uint(value));
         break;
+    case PROP_REUSE_PORT:
+        milter_manager_configuration_set_reuse_port(config,
+                                                    g_value_get_boolean(value));
+        break;
+    case PROP_DIRECT_WRITE:
+        milter_manager_configuration_set_direct_write(config,
+                                                      g_value_get_boolean(value));
+        break;
     case PROP_DEFAULT_PACKET_BUFFER_SIZE:
         milter_manager_configuration_set_default_packet_buffer_size(
             config,
@@ -697,6 +818,22 @@ set_property (GObject      *object,
         milter_manager_configuration_set_max_pending_finished_sessions(
             config, g_value_get_uint(value));
         break;
+    case PROP_MAX_ON_MEMORY_BODY_SIZE:
+        milter_manager_configuration_set_max_on_memory_body_size(
+            config, g_value_get_uint(value));
+        break;
+    case PROP_BODY_SPOOL_MEMORY_BUDGET:
+        milter_manager_configuration_set_body_spool_memory_budget(
+            config, g_value_get_uint64(value));
+        break;
+    case PROP_STATISTICS_PATH:
+        milter_manager_configuration_set_statistics_path(
+            config, g_value_get_string(value));
+        break;
+    case PROP_STATISTICS_ROTATE_SIZE:
+        milter_manager_configuration_set_statistics_rotate_size(
+            config, g_value_get_uint64(value));
+        break;
     default:
         G_OBJECT_WARN_INVALID_PROPERTY_ID(object, prop_id, pspec);
         break;
@@ -788,12 +925,24 @@ get_property (GObject    *object,
     case PROP_CONNECTION_CHECK_INTERVAL:
         g_value_set_uint(value, priv->connection_check_interval);
         break;
+    case PROP_CONNECTION_CHECK_BUDGET:
+        g_value_set_uint(value, priv->connection_check_budget);
+        break;
+    case PROP_USE_NATIVE_CONNECTION_CHECKER:
+        g_value_set_boolean(value, priv->use_native_connection_checker);
+        break;
     case PROP_EVENT_LOOP_BACKEND:
         g_value_set_enum(value, priv->event_loop_backend);
         break;
     case PROP_N_WORKERS:
         g_value_set_uint(value, priv->n_workers);
         break;
+    case PROP_REUSE_PORT:
+        g_value_set_boolean(value, priv->reuse_port);
+        break;
+    case PROP_DIRECT_WRITE:
+        g_value_set_boolean(value, priv->direct_write);
+        break;
     case PROP_DEFAULT_PACKET_BUFFER_SIZE:
         g_value_set_uint(value, priv->default_packet_buffer_size);
         break;
@@ -812,6 +961,18 @@ get_property (GObject    *object,
     case PROP_MAX_PENDING_FINISHED_SESSIONS:
         g_value_set_uint(value, priv->max_pending_finished_sessions);
         break;
+    case PROP_MAX_ON_MEMORY_BODY_SIZE:
+        g_value_set_uint(value, priv->max_on_memory_body_size);
+        break;
+    case PROP_BODY_SPOOL_MEMORY_BUDGET:
+        g_value_set_uint64(value, priv->body_spool_memory_budget);
+        break;
+    case PROP_STATISTICS_PATH:
+        g_value_set_string(value, priv->statistics_path);
+        break;
+    case PROP_STATISTICS_ROTATE_SIZE:
+        g_value_set_uint64(value, priv->statistics_rotate_size);
+        break;
     default:
         G_OBJECT_WARN_INVALID_PROPERTY_ID(object, prop_id, pspec);
         break;
@@ -1863,6 +2024,35 @@ milter_manager_configuration_get_applicable_conditions (MilterManagerConfigurati
     return priv->applicable_conditions;
 }
 
+gboolean
+milter_manager_configuration_have_session_hook (MilterManagerConfiguration *configuration)
+{
+    MilterManagerConfigurationPrivate *priv;
+    GList *egg_node;
+    guint attach_to_signal_id;
+
+    if (g_signal_has_handler_pending(configuration, signals[CONNECTED],
+                                     0, TRUE))
+        return TRUE;
+
+    priv = MILTER_MANAGER_CONFIGURATION_GET_PRIVATE(configuration);
+    attach_to_signal_id =
+        g_signal_lookup("attach-to", MILTER_TYPE_MANAGER_APPLICABLE_CONDITION);
+    for (egg_node = priv->eggs; egg_node; egg_node = g_list_next(egg_node)) {
+        MilterManagerEgg *egg = egg_node->data;
+        const GList *node;
+
+        node = milter_manager_egg_get_applicable_conditions(egg);
+        for (; node; node = g_list_next(node)) {
+            if (g_signal_has_handler_pending(node->data,
+                                             attach_to_signal_id, 0, TRUE))
+                return TRUE;
+        }
+    }
+
+    return FALSE;
+}
+
 void
 milter_manager_configuration_remove_applicable_condition (MilterManagerConfiguration *configuration,
                                                           MilterManagerApplicableCondition *condition)
@@ -1945,11 +2135,22 @@ clear_manager (MilterManagerConfigurationPrivate *priv)
     priv->max_connections = 0;
     priv->max_file_descriptors = 0;
     priv->connection_check_interval = DEFAULT_CONNECTION_CHECK_INTERVAL;
+    priv->connection_check_budget = DEFAULT_CONNECTION_CHECK_BUDGET;
+    priv->use_native_connection_checker = FALSE;
     priv->event_loop_backend = MILTER_CLIENT_EVENT_LOOP_BACKEND_GLIB;
     priv->n_workers = 0;
+    priv->reuse_port = FALSE;
+    priv->direct_write = FALSE;
     priv->default_packet_buffer_size = 0;
     priv->chunk_size = MILTER_CHUNK_SIZE;
     priv->max_pending_finished_sessions = 0;
+    priv->max_on_memory_body_size = DEFAULT_MAX_ON_MEMORY_BODY_SIZE;
+    priv->body_spool_memory_budget = 0;
+    if (priv->statistics_path) {
+        g_free(priv->statistics_path);
+        priv->statistics_path = NULL;
+    }
+    priv->statistics_rotate_size = DEFAULT_STATISTICS_ROTATE_SIZE;
 }
 
 static void
@@ -2292,6 +2493,44 @@ milter_manager_configuration_set_connection_check_interval (MilterManagerConfigu
     priv->connection_check_interval = interval_in_seconds;
 }
 
+guint
+milter_manager_configuration_get_connection_check_budget (MilterManagerConfiguration *configuration)
+{
+    MilterManagerConfigurationPrivate *priv;
+
+    priv = MILTER_MANAGER_CONFIGURATION_GET_PRIVATE(configuration);
+    return priv->connection_check_budget;
+}
+
+void
+milter_manager_configuration_set_connection_check_budget (MilterManagerConfiguration *configuration,
+                                                          guint                       budget_in_milliseconds)
+{
+    MilterManagerConfigurationPrivate *priv;
+
+    priv = MILTER_MANAGER_CONFIGURATION_GET_PRIVATE(configuration);
+    priv->connection_check_budget = budget_in_milliseconds;
+}
+
+gboolean
+milter_manager_configuration_get_use_native_connection_checker (MilterManagerConfiguration *configuration)
+{
+    MilterManagerConfigurationPrivate *priv;
+
+    priv = MILTER_MANAGER_CONFIGURATION_GET_PRIVATE(configuration);
+    return priv->use_native_connection_checker;
+}
+
+void
+milter_manager_configuration_set_use_native_connection_checker (MilterManagerConfiguration *configuration,
+                                                                gboolean                    use_native_connection_checker)
+{
+    MilterManagerConfigurationPrivate *priv;
+
+    priv = MILTER_MANAGER_CONFIGURATION_GET_PRIVATE(configuration);
+    priv->use_native_connection_checker = use_native_connection_checker;
+}
+
 MilterClientEventLoopBackend
 milter_manager_configuration_get_event_loop_backend (MilterManagerConfiguration *configuration)
 {
@@ -2330,6 +2569,44 @@ milter_manager_configuration_set_n_workers (MilterManagerConfiguration *configur
     priv->n_workers = n_workers;
 }
 
+gboolean
+milter_manager_configuration_is_reuse_port (MilterManagerConfiguration *configuration)
+{
+    MilterManagerConfigurationPrivate *priv;
+
+    priv = MILTER_MANAGER_CONFIGURATION_GET_PRIVATE(configuration);
+    return priv->reuse_port;
+}
+
+void
+milter_manager_configuration_set_reuse_port (MilterManagerConfiguration *configuration,
+                                             gboolean                    reuse_port)
+{
+    MilterManagerConfigurationPrivate *priv;
+
+    priv = MILTER_MANAGER_CONFIGURATION_GET_PRIVATE(configuration);
+    priv->reuse_port = reuse_port;
+}
+
+gboolean
+milter_manager_configuration_is_direct_write (MilterManagerConfiguration *configuration)
+{
+    MilterManagerConfigurationPrivate *priv;
+
+    priv = MILTER_MANAGER_CONFIGURATION_GET_PRIVATE(configuration);
+    return priv->direct_write;
+}
+
+void
+milter_manager_configuration_set_direct_write (MilterManagerConfiguration *configuration,
+                                               gboolean                    direct_write)
+{
+    MilterManagerConfigurationPrivate *priv;
+
+    priv = MILTER_MANAGER_CONFIGURATION_GET_PRIVATE(configuration);
+    priv->direct_write = direct_write;
+}
+
 guint
 milter_manager_configuration_get_default_packet_buffer_size (MilterManagerConfiguration *configuration)
 {
@@ -2434,6 +2711,84 @@ milter_manager_configuration_set_max_pending_finished_sessions (MilterManagerCon
     priv->max_pending_finished_sessions = n_sessions;
 }
 
+guint
+milter_manager_configuration_get_max_on_memory_body_size (MilterManagerConfiguration *configuration)
+{
+    MilterManagerConfigurationPrivate *priv;
+
+    priv = MILTER_MANAGER_CONFIGURATION_GET_PRIVATE(configuration);
+    return priv->max_on_memory_body_size;
+}
+
+void
+milter_manager_configuration_set_max_on_memory_body_size (MilterManagerConfiguration *configuration,
+                                                          guint                       size)
+{
+    MilterManagerConfigurationPrivate *priv;
+
+    priv = MILTER_MANAGER_CONFIGURATION_GET_PRIVATE(configuration);
+    priv->max_on_memory_body_size = size;
+}
+
+guint64
+milter_manager_configuration_get_body_spool_memory_budget (MilterManagerConfiguration *configuration)
+{
+    MilterManagerConfigurationPrivate *priv;
+
+    priv = MILTER_MANAGER_CONFIGURATION_GET_PRIVATE(configuration);
+    return priv->body_spool_memory_budget;
+}
+
+void
+milter_manager_configuration_set_body_spool_memory_budget (MilterManagerConfiguration *configuration,
+                                                           guint64                     budget)
+{
+    MilterManagerConfigurationPrivate *priv;
+
+    priv = MILTER_MANAGER_CONFIGURATION_GET_PRIVATE(configuration);
+    priv->body_spool_memory_budget = budget;
+}
+
+const gchar *
+milter_manager_configuration_get_statistics_path (MilterManagerConfiguration *configuration)
+{
+    MilterManagerConfigurationPrivate *priv;
+
+    priv = MILTER_MANAGER_CONFIGURATION_GET_PRIVATE(configuration);
+    return priv->statistics_path;
+}
+
+void
+milter_manager_configuration_set_statistics_path (MilterManagerConfiguration *configuration,
+                                                  const gchar                *path)
+{
+    MilterManagerConfigurationPrivate *priv;
+
+    priv = MILTER_MANAGER_CONFIGURATION_GET_PRIVATE(configuration);
+    if (priv->statistics_path)
+        g_free(priv->statistics_path);
+    priv->statistics_path = g_strdup(path);
+}
+
+guint64
+milter_manager_configuration_get_statistics_rotate_size (MilterManagerConfiguration *configuration)
+{
+    MilterManagerConfigurationPrivate *priv;
+
+    priv = MILTER_MANAGER_CONFIGURATION_GET_PRIVATE(configuration);
+    return priv->statistics_rotate_size;
+}
+
+void
+milter_manager_configuration_set_statistics_rotate_size (MilterManagerConfiguration *configuration,
+                                                         guint64                     size)
+{
+    MilterManagerConfigurationPrivate *priv;
+
+    priv = MILTER_MANAGER_CONFIGURATION_GET_PRIVATE(configuration);
+    priv->statistics_rotate_size = size;
+}
+
 /*
 vi:ts=4:nowrap:ai:expandtab:sw=4
 */
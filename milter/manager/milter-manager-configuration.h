@@ -298,6 +298,8 @@ MilterManagerApplicableCondition *
                                       const gchar *name);
 const GList  *milter_manager_configuration_get_applicable_conditions
                                      (MilterManagerConfiguration *configuration);
+gboolean      milter_manager_configuration_have_session_hook
+                                     (MilterManagerConfiguration *configuration);
 void          milter_manager_configuration_remove_applicable_condition
                                      (MilterManagerConfiguration *configuration,
                                       MilterManagerApplicableCondition *condition);
@@ -350,6 +352,16 @@ guint         milter_manager_configuration_get_connection_check_interval
 void          milter_manager_configuration_set_connection_check_interval
                                      (MilterManagerConfiguration *configuration,
                                       guint                       interval_in_seconds);
+guint         milter_manager_configuration_get_connection_check_budget
+                                     (MilterManagerConfiguration *configuration);
+void          milter_manager_configuration_set_connection_check_budget
+                                     (MilterManagerConfiguration *configuration,
+                                      guint                       budget_in_milliseconds);
+gboolean      milter_manager_configuration_get_use_native_connection_checker
+                                     (MilterManagerConfiguration *configuration);
+void          milter_manager_configuration_set_use_native_connection_checker
+                                     (MilterManagerConfiguration *configuration,
+                                      gboolean                    use_native_connection_checker);
 MilterClientEventLoopBackend
               milter_manager_configuration_get_event_loop_backend
                                      (MilterManagerConfiguration *configuration);
@@ -362,6 +374,16 @@ guint         milter_manager_configuration_get_n_workers
 void          milter_manager_configuration_set_n_workers
                                      (MilterManagerConfiguration *configuration,
                                       guint                       n_workers);
+gboolean      milter_manager_configuration_is_reuse_port
+                                     (MilterManagerConfiguration *configuration);
+void          milter_manager_configuration_set_reuse_port
+                                     (MilterManagerConfiguration *configuration,
+                                      gboolean                    reuse_port);
+gboolean      milter_manager_configuration_is_direct_write
+                                     (MilterManagerConfiguration *configuration);
+void          milter_manager_configuration_set_direct_write
+                                     (MilterManagerConfiguration *configuration,
+                                      gboolean                    direct_write);
 
 guint         milter_manager_configuration_get_default_packet_buffer_size
                                      (MilterManagerConfiguration *configuration);
@@ -390,6 +412,30 @@ void          milter_manager_configuration_set_chunk_size
                                      (MilterManagerConfiguration *configuration,
                                       guint                       size);
 
+guint         milter_manager_configuration_get_max_on_memory_body_size
+                                     (MilterManagerConfiguration *configuration);
+void          milter_manager_configuration_set_max_on_memory_body_size
+                                     (MilterManagerConfiguration *configuration,
+                                      guint                       size);
+
+guint64       milter_manager_configuration_get_body_spool_memory_budget
+                                     (MilterManagerConfiguration *configuration);
+void          milter_manager_configuration_set_body_spool_memory_budget
+                                     (MilterManagerConfiguration *configuration,
+                                      guint64                     budget);
+
+const gchar  *milter_manager_configuration_get_statistics_path
+                                     (MilterManagerConfiguration *configuration);
+void          milter_manager_configuration_set_statistics_path
+                                     (MilterManagerConfiguration *configuration,
+                                      const gchar                *path);
+
+guint64       milter_manager_configuration_get_statistics_rotate_size
+                                     (MilterManagerConfiguration *configuration);
+void          milter_manager_configuration_set_statistics_rotate_size
+                                     (MilterManagerConfiguration *configuration,
+                                      guint64                     size);
+
 guint         milter_manager_configuration_get_max_pending_finished_sessions
                                      (MilterManagerConfiguration *configuration);
 void          milter_manager_configuration_set_max_pending_finished_sessions
@@ -0,0 +1,263 @@
+/* -*- Mode: C; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+/*
+ *  Copyright (C) 2026  Kouhei Sutou <kou@clear-code.com>
+ *
+ *  This library is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with this library.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifdef HAVE_CONFIG_H
+#  include "../../config.h"
+#endif /* HAVE_CONFIG_H */
+
+#include "milter-manager-connection-check-scheduler.h"
+
+#define N_BUCKETS 64
+
+struct _MilterManagerConnectionCheckEntry
+{
+    GList link;
+    GQueue *bucket;
+    gpointer data;
+    guint check_tick;
+    guint waiting_start_tick;
+    gboolean waiting;
+    gboolean removed;
+};
+
+struct _MilterManagerConnectionCheckScheduler
+{
+    MilterManagerConnectionCheckSchedulerFuncs funcs;
+    gpointer user_data;
+    GQueue buckets[N_BUCKETS];
+    guint tick;
+    guint next_tick;
+    guint n_entries;
+    MilterManagerConnectionCheckEntry *checking_entry;
+    gboolean prepared;
+    GTimer *timer;
+};
+
+MilterManagerConnectionCheckScheduler *
+milter_manager_connection_check_scheduler_new
+                          (const MilterManagerConnectionCheckSchedulerFuncs *funcs,
+                           gpointer user_data)
+{
+    MilterManagerConnectionCheckScheduler *scheduler;
+    guint i;
+
+    scheduler = g_new0(MilterManagerConnectionCheckScheduler, 1);
+    scheduler->funcs = *funcs;
+    scheduler->user_data = user_data;
+    for (i = 0; i < N_BUCKETS; i++) {
+        g_queue_init(&(scheduler->buckets[i]));
+    }
+    scheduler->tick = 0;
+    scheduler->next_tick = 1;
+    scheduler->n_entries = 0;
+    scheduler->checking_entry = NULL;
+    scheduler->prepared = FALSE;
+    scheduler->timer = g_timer_new();
+
+    return scheduler;
+}
+
+void
+milter_manager_connection_check_scheduler_free
+                          (MilterManagerConnectionCheckScheduler *scheduler)
+{
+    milter_manager_connection_check_scheduler_clear(scheduler);
+    g_timer_destroy(scheduler->timer);
+    g_free(scheduler);
+}
+
+static void
+schedule (MilterManagerConnectionCheckScheduler *scheduler,
+          MilterManagerConnectionCheckEntry *entry,
+          guint tick)
+{
+    entry->check_tick = tick;
+    entry->bucket = &(scheduler->buckets[tick % N_BUCKETS]);
+    g_queue_push_tail_link(entry->bucket, &(entry->link));
+}
+
+MilterManagerConnectionCheckEntry *
+milter_manager_connection_check_scheduler_add
+                          (MilterManagerConnectionCheckScheduler *scheduler,
+                           gpointer data)
+{
+    MilterManagerConnectionCheckEntry *entry;
+
+    entry = g_new0(MilterManagerConnectionCheckEntry, 1);
+    entry->link.data = entry;
+    entry->data = data;
+    schedule(scheduler, entry, scheduler->tick + 1);
+    scheduler->n_entries++;
+
+    return entry;
+}
+
+void
+milter_manager_connection_check_scheduler_remove
+                          (MilterManagerConnectionCheckScheduler *scheduler,
+                           MilterManagerConnectionCheckEntry *entry)
+{
+    if (entry->removed)
+        return;
+
+    entry->removed = TRUE;
+    scheduler->n_entries--;
+    if (entry == scheduler->checking_entry)
+        return;
+
+    if (entry->bucket)
+        g_queue_unlink(entry->bucket, &(entry->link));
+    g_free(entry);
+}
+
+void
+milter_manager_connection_check_scheduler_clear
+                          (MilterManagerConnectionCheckScheduler *scheduler)
+{
+    guint i;
+
+    for (i = 0; i < N_BUCKETS; i++) {
+        GList *link;
+
+        while ((link = g_queue_pop_head_link(&(scheduler->buckets[i])))) {
+            g_free(link->data);
+        }
+    }
+    if (scheduler->checking_entry)
+        scheduler->checking_entry->removed = TRUE;
+    scheduler->n_entries = 0;
+}
+
+static void
+check_entry (MilterManagerConnectionCheckScheduler *scheduler,
+             MilterManagerConnectionCheckEntry *entry,
+             guint interval)
+{
+    guint tick;
+    gboolean waiting;
+
+    tick = scheduler->tick;
+    scheduler->checking_entry = entry;
+    waiting = scheduler->funcs.is_waiting(entry->data, scheduler->user_data);
+    scheduler->checking_entry = NULL;
+    if (entry->removed) {
+        g_free(entry);
+        return;
+    }
+
+    if (!waiting) {
+        entry->waiting = FALSE;
+        schedule(scheduler, entry, tick + 1);
+        return;
+    }
+
+    if (!entry->waiting) {
+        entry->waiting = TRUE;
+        entry->waiting_start_tick = tick;
+    }
+    if (tick - entry->waiting_start_tick < interval) {
+        schedule(scheduler, entry, entry->waiting_start_tick + interval);
+        return;
+    }
+
+    if (!scheduler->prepared) {
+        scheduler->prepared = TRUE;
+        if (scheduler->funcs.prepare)
+            scheduler->funcs.prepare(scheduler->user_data);
+    }
+
+    scheduler->checking_entry = entry;
+    scheduler->funcs.check(entry->data, scheduler->user_data);
+    scheduler->checking_entry = NULL;
+
+    if (entry->removed)
+        g_free(entry);
+    else
+        schedule(scheduler, entry, tick + interval);
+}
+
+gboolean
+milter_manager_connection_check_scheduler_run
+                          (MilterManagerConnectionCheckScheduler *scheduler,
+                           guint interval,
+                           guint budget)
+{
+    if (interval == 0)
+        interval = 1;
+
+    scheduler->tick++;
+    scheduler->prepared = FALSE;
+    g_timer_start(scheduler->timer);
+    while ((gint)(scheduler->tick - scheduler->next_tick) >= 0) {
+        GQueue *bucket;
+        guint i, n_entries;
+
+        bucket = &(scheduler->buckets[scheduler->next_tick % N_BUCKETS]);
+        n_entries = g_queue_get_length(bucket);
+        for (i = 0; i < n_entries; i++) {
+            GList *link;
+            MilterManagerConnectionCheckEntry *entry;
+
+            if (budget > 0 &&
+                g_timer_elapsed(scheduler->timer, NULL) * 1000 >= budget)
+                return FALSE;
+
+            /* A check may remove other entries in this bucket. */
+            link = g_queue_pop_head_link(bucket);
+            if (!link)
+                break;
+
+            entry = link->data;
+            entry->bucket = NULL;
+            if (entry->check_tick == scheduler->next_tick) {
+                check_entry(scheduler, entry, interval);
+            } else {
+                schedule(scheduler, entry, entry->check_tick);
+            }
+        }
+        scheduler->next_tick++;
+    }
+
+    return TRUE;
+}
+
+guint
+milter_manager_connection_check_scheduler_get_tick
+                          (MilterManagerConnectionCheckScheduler *scheduler)
+{
+    return scheduler->tick;
+}
+
+guint
+milter_manager_connection_check_scheduler_get_n_behind_ticks
+                          (MilterManagerConnectionCheckScheduler *scheduler)
+{
+    return scheduler->tick - scheduler->next_tick + 1;
+}
+
+guint
+milter_manager_connection_check_scheduler_get_n_entries
+                          (MilterManagerConnectionCheckScheduler *scheduler)
+{
+    return scheduler->n_entries;
+}
+
+/*
+vi:ts=4:nowrap:ai:expandtab:sw=4
+*/
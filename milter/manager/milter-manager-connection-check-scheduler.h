@@ -0,0 +1,81 @@
+/* -*- Mode: C; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+/*
+ *  Copyright (C) 2026  Kouhei Sutou <kou@clear-code.com>
+ *
+ *  This library is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with this library.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef __MILTER_MANAGER_CONNECTION_CHECK_SCHEDULER_H__
+#define __MILTER_MANAGER_CONNECTION_CHECK_SCHEDULER_H__
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+typedef struct _MilterManagerConnectionCheckScheduler MilterManagerConnectionCheckScheduler;
+typedef struct _MilterManagerConnectionCheckEntry MilterManagerConnectionCheckEntry;
+
+typedef struct _MilterManagerConnectionCheckSchedulerFuncs MilterManagerConnectionCheckSchedulerFuncs;
+struct _MilterManagerConnectionCheckSchedulerFuncs
+{
+    /* Called once per round before the first due check. */
+    void     (*prepare)    (gpointer user_data);
+    gboolean (*is_waiting) (gpointer data, gpointer user_data);
+    /* An entry that isn't connected should be removed here. */
+    void     (*check)      (gpointer data, gpointer user_data);
+};
+
+/*
+ * The scheduler keeps entries in a timer wheel of per-tick
+ * buckets. A round only visits the buckets that are due, and
+ * an entry is checked after it has been waiting for a reply
+ * for interval ticks.
+ */
+MilterManagerConnectionCheckScheduler *
+         milter_manager_connection_check_scheduler_new
+                                    (const MilterManagerConnectionCheckSchedulerFuncs *funcs,
+                                     gpointer                                    user_data);
+void     milter_manager_connection_check_scheduler_free
+                                    (MilterManagerConnectionCheckScheduler *scheduler);
+
+MilterManagerConnectionCheckEntry *
+         milter_manager_connection_check_scheduler_add
+                                    (MilterManagerConnectionCheckScheduler *scheduler,
+                                     gpointer                               data);
+void     milter_manager_connection_check_scheduler_remove
+                                    (MilterManagerConnectionCheckScheduler *scheduler,
+                                     MilterManagerConnectionCheckEntry     *entry);
+void     milter_manager_connection_check_scheduler_clear
+                                    (MilterManagerConnectionCheckScheduler *scheduler);
+
+gboolean milter_manager_connection_check_scheduler_run
+                                    (MilterManagerConnectionCheckScheduler *scheduler,
+                                     guint                                  interval,
+                                     guint                                  budget);
+
+guint    milter_manager_connection_check_scheduler_get_tick
+                                    (MilterManagerConnectionCheckScheduler *scheduler);
+guint    milter_manager_connection_check_scheduler_get_n_behind_ticks
+                                    (MilterManagerConnectionCheckScheduler *scheduler);
+guint    milter_manager_connection_check_scheduler_get_n_entries
+                                    (MilterManagerConnectionCheckScheduler *scheduler);
+
+G_END_DECLS
+
+#endif /* __MILTER_MANAGER_CONNECTION_CHECK_SCHEDULER_H__ */
+
+/*
+vi:ts=4:nowrap:ai:expandtab:sw=4
+*/
@@ -0,0 +1,451 @@
+/* -*- Mode: C; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+/*
+ *  Copyright (C) 2026  Kouhei Sutou <kou@clear-code.com>
+ *
+ *  This library is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with this library.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifdef HAVE_CONFIG_H
+#  include "../../config.h"
+#endif /* HAVE_CONFIG_H */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <netinet/in.h>
+
+#ifdef HAVE_LINUX_INET_DIAG_H
+#  include <linux/netlink.h>
+#  include <linux/sock_diag.h>
+#  include <linux/inet_diag.h>
+#endif
+
+#include <milter/core.h>
+#include "milter-manager-connection-checker.h"
+
+/* The same values as TCP_* in the kernel's include/net/tcp_states.h. */
+#define TCP_STATE_CLOSE_WAIT 8
+#define TCP_STATE_LAST_ACK   9
+#define TCP_STATE_CLOSING    11
+
+#define CLOSED_STATES                           \
+    ((1 << TCP_STATE_CLOSE_WAIT) |              \
+     (1 << TCP_STATE_LAST_ACK) |                \
+     (1 << TCP_STATE_CLOSING))
+
+#define PROC_NET_TCP  "/proc/net/tcp"
+#define PROC_NET_TCP6 "/proc/net/tcp6"
+
+typedef struct _Endpoint Endpoint;
+struct _Endpoint
+{
+    guint16 family;
+    guint16 port;
+    guint8 address[16];
+};
+
+struct _MilterManagerConnectionChecker
+{
+    gint ref_count;
+    gboolean use_sock_diag;
+    GHashTable *closed_endpoints;
+};
+
+GQuark
+milter_manager_connection_checker_error_quark (void)
+{
+    return g_quark_from_static_string("milter-manager-connection-checker-error-quark");
+}
+
+static guint
+endpoint_hash (gconstpointer key)
+{
+    const guint8 *bytes = key;
+    guint hash = 5381;
+    gsize i;
+
+    for (i = 0; i < sizeof(Endpoint); i++) {
+        hash = hash * 33 + bytes[i];
+    }
+
+    return hash;
+}
+
+static gboolean
+endpoint_equal (gconstpointer a, gconstpointer b)
+{
+    return memcmp(a, b, sizeof(Endpoint)) == 0;
+}
+
+static const guint8 ipv4_mapped_prefix[] = {
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0xff, 0xff
+};
+
+static void
+endpoint_init (Endpoint *endpoint, gint family,
+               const guint8 *address, guint16 port)
+{
+    memset(endpoint, 0, sizeof(*endpoint));
+    endpoint->port = port;
+
+    /* Dual stack sockets report IPv4 clients as ::ffff:a.b.c.d. */
+    if (family == AF_INET6 &&
+        memcmp(address, ipv4_mapped_prefix, sizeof(ipv4_mapped_prefix)) == 0) {
+        family = AF_INET;
+        address += sizeof(ipv4_mapped_prefix);
+    }
+
+    endpoint->family = family;
+    if (family == AF_INET)
+        memcpy(endpoint->address, address, 4);
+    else
+        memcpy(endpoint->address, address, 16);
+}
+
+static void
+add_closed_endpoint (MilterManagerConnectionChecker *checker,
+                     gint family, const guint8 *address, guint16 port)
+{
+    Endpoint *endpoint;
+
+    endpoint = g_new(Endpoint, 1);
+    endpoint_init(endpoint, family, address, port);
+    g_hash_table_replace(checker->closed_endpoints, endpoint, endpoint);
+}
+
+MilterManagerConnectionChecker *
+milter_manager_connection_checker_new (void)
+{
+    MilterManagerConnectionChecker *checker;
+
+    checker = g_new0(MilterManagerConnectionChecker, 1);
+    checker->ref_count = 1;
+#ifdef HAVE_LINUX_INET_DIAG_H
+    checker->use_sock_diag = TRUE;
+#else
+    checker->use_sock_diag = FALSE;
+#endif
+    checker->closed_endpoints = g_hash_table_new_full(endpoint_hash,
+                                                      endpoint_equal,
+                                                      g_free,
+                                                      NULL);
+
+    return checker;
+}
+
+MilterManagerConnectionChecker *
+milter_manager_connection_checker_ref (MilterManagerConnectionChecker *checker)
+{
+    checker->ref_count++;
+    return checker;
+}
+
+void
+milter_manager_connection_checker_unref (MilterManagerConnectionChecker *checker)
+{
+    checker->ref_count--;
+    if (checker->ref_count > 0)
+        return;
+
+    g_hash_table_unref(checker->closed_endpoints);
+    g_free(checker);
+}
+
+#ifdef HAVE_LINUX_INET_DIAG_H
+static gboolean
+receive_sock_diag (MilterManagerConnectionChecker *checker,
+                   gint fd, GError **error)
+{
+    guint8 buffer[8192];
+
+    while (TRUE) {
+        struct nlmsghdr *header;
+        ssize_t size;
+
+        size = recv(fd, buffer, sizeof(buffer), 0);
+        if (size == -1) {
+            if (errno == EINTR)
+                continue;
+            g_set_error(error,
+                        MILTER_MANAGER_CONNECTION_CHECKER_ERROR,
+                        MILTER_MANAGER_CONNECTION_CHECKER_ERROR_QUERY,
+                        "failed to receive sock_diag reply: %s",
+                        g_strerror(errno));
+            return FALSE;
+        }
+
+        for (header = (struct nlmsghdr *)buffer;
+             NLMSG_OK(header, size);
+             header = NLMSG_NEXT(header, size)) {
+            struct inet_diag_msg *message;
+
+            if (header->nlmsg_type == NLMSG_DONE)
+                return TRUE;
+            if (header->nlmsg_type == NLMSG_ERROR) {
+                struct nlmsgerr *nl_error = NLMSG_DATA(header);
+                g_set_error(error,
+                            MILTER_MANAGER_CONNECTION_CHECKER_ERROR,
+                            MILTER_MANAGER_CONNECTION_CHECKER_ERROR_QUERY,
+                            "sock_diag returns an error: %s",
+                            g_strerror(-nl_error->error));
+                return FALSE;
+            }
+
+            message = NLMSG_DATA(header);
+            add_closed_endpoint(checker,
+                                message->idiag_family,
+                                (const guint8 *)message->id.idiag_dst,
+                                g_ntohs(message->id.idiag_dport));
+        }
+    }
+}
+
+static gboolean
+query_sock_diag (MilterManagerConnectionChecker *checker,
+                 gint fd, gint family, GError **error)
+{
+    struct {
+        struct nlmsghdr header;
+        struct inet_diag_req_v2 request;
+    } message;
+    struct sockaddr_nl address;
+
+    memset(&address, 0, sizeof(address));
+    address.nl_family = AF_NETLINK;
+
+    memset(&message, 0, sizeof(message));
+    message.header.nlmsg_len = sizeof(message);
+    message.header.nlmsg_type = SOCK_DIAG_BY_FAMILY;
+    message.header.nlmsg_flags = NLM_F_REQUEST | NLM_F_DUMP;
+    message.request.sdiag_family = family;
+    message.request.sdiag_protocol = IPPROTO_TCP;
+    /* Let the kernel skip established and listening sockets. */
+    message.request.idiag_states = CLOSED_STATES;
+
+    if (sendto(fd, &message, sizeof(message), 0,
+               (struct sockaddr *)&address, sizeof(address)) == -1) {
+        g_set_error(error,
+                    MILTER_MANAGER_CONNECTION_CHECKER_ERROR,
+                    MILTER_MANAGER_CONNECTION_CHECKER_ERROR_QUERY,
+                    "failed to send sock_diag request: %s",
+                    g_strerror(errno));
+        return FALSE;
+    }
+
+    return receive_sock_diag(checker, fd, error);
+}
+
+static gboolean
+update_by_sock_diag (MilterManagerConnectionChecker *checker, GError **error)
+{
+    gint fd;
+    gboolean success;
+
+    fd = socket(AF_NETLINK, SOCK_DGRAM, NETLINK_SOCK_DIAG);
+    if (fd == -1) {
+        g_set_error(error,
+                    MILTER_MANAGER_CONNECTION_CHECKER_ERROR,
+                    MILTER_MANAGER_CONNECTION_CHECKER_ERROR_NOT_SUPPORTED,
+                    "failed to create NETLINK_SOCK_DIAG socket: %s",
+                    g_strerror(errno));
+        return FALSE;
+    }
+
+    success = query_sock_diag(checker, fd, AF_INET, error) &&
+        query_sock_diag(checker, fd, AF_INET6, error);
+    close(fd);
+
+    return success;
+}
+#endif
+
+static gboolean
+parse_proc_address (const gchar *text, gint family,
+                    guint8 *address, guint16 *port)
+{
+    gint i, n_words;
+    const gchar *port_text;
+    gchar *end;
+
+    /* Each 32bit word is printed in host byte order. */
+    n_words = family == AF_INET ? 1 : 4;
+    if (strlen(text) < n_words * 8 + 2)
+        return FALSE;
+    for (i = 0; i < n_words; i++) {
+        gchar word_text[9];
+        guint32 word;
+
+        memcpy(word_text, text + i * 8, 8);
+        word_text[8] = '\0';
+        word = strtoul(word_text, &end, 16);
+        if (*end != '\0')
+            return FALSE;
+        memcpy(address + i * 4, &word, 4);
+    }
+
+    port_text = text + n_words * 8;
+    if (*port_text != ':')
+        return FALSE;
+    *port = strtoul(port_text + 1, &end, 16);
+
+    return end != port_text + 1;
+}
+
+static gboolean
+parse_proc_line (MilterManagerConnectionChecker *checker,
+                 const gchar *line, gint family)
+{
+    gchar local_address[64], remote_address[64];
+    guint8 address[16];
+    guint16 port;
+    guint state;
+
+    /* sl local_address rem_address st ... */
+    if (sscanf(line, " %*u: %63[0-9A-Fa-f:] %63[0-9A-Fa-f:] %x",
+               local_address, remote_address, &state) != 3)
+        return FALSE;
+
+    if (state >= 32 || !(CLOSED_STATES & (1 << state)))
+        return TRUE;
+
+    if (!parse_proc_address(remote_address, family, address, &port))
+        return FALSE;
+    add_closed_endpoint(checker, family, address, port);
+
+    return TRUE;
+}
+
+static gboolean
+parse_proc_file (MilterManagerConnectionChecker *checker,
+                 const gchar *path, gint family, GError **error)
+{
+    gchar *content;
+    gchar **lines;
+    gint i;
+    GError *read_error = NULL;
+
+    if (!g_file_get_contents(path, &content, NULL, &read_error)) {
+        g_set_error(error,
+                    MILTER_MANAGER_CONNECTION_CHECKER_ERROR,
+                    MILTER_MANAGER_CONNECTION_CHECKER_ERROR_NOT_SUPPORTED,
+                    "failed to read <%s>: %s",
+                    path, read_error->message);
+        g_error_free(read_error);
+        return FALSE;
+    }
+
+    lines = g_strsplit(content, "\n", -1);
+    g_free(content);
+    /* The first line is the header. */
+    for (i = 1; lines[i]; i++) {
+        if (lines[i][0] == '\0')
+            continue;
+        if (!parse_proc_line(checker, lines[i], family))
+            milter_debug("[connection-checker][proc][ignore] <%s>", lines[i]);
+    }
+    g_strfreev(lines);
+
+    return TRUE;
+}
+
+gboolean
+milter_manager_connection_checker_update_from_proc (MilterManagerConnectionChecker *checker,
+                                                    const gchar *tcp_path,
+                                                    const gchar *tcp6_path,
+                                                    GError **error)
+{
+    g_hash_table_remove_all(checker->closed_endpoints);
+
+    if (!parse_proc_file(checker, tcp_path, AF_INET, error))
+        return FALSE;
+
+    /* IPv6 may be disabled. */
+    if (g_file_test(tcp6_path, G_FILE_TEST_EXISTS) &&
+        !parse_proc_file(checker, tcp6_path, AF_INET6, error))
+        return FALSE;
+
+    return TRUE;
+}
+
+gboolean
+milter_manager_connection_checker_update (MilterManagerConnectionChecker *checker,
+                                          GError **error)
+{
+#ifdef HAVE_LINUX_INET_DIAG_H
+    if (checker->use_sock_diag) {
+        GError *sock_diag_error = NULL;
+
+        g_hash_table_remove_all(checker->closed_endpoints);
+        if (update_by_sock_diag(checker, &sock_diag_error))
+            return TRUE;
+
+        milter_info("[connection-checker][sock-diag][fallback] "
+                    "use <%s>: %s",
+                    PROC_NET_TCP, sock_diag_error->message);
+        g_error_free(sock_diag_error);
+        checker->use_sock_diag = FALSE;
+    }
+#endif
+
+    return milter_manager_connection_checker_update_from_proc(checker,
+                                                              PROC_NET_TCP,
+                                                              PROC_NET_TCP6,
+                                                              error);
+}
+
+gboolean
+milter_manager_connection_checker_is_connected (MilterManagerConnectionChecker *checker,
+                                                const struct sockaddr *address,
+                                                socklen_t address_length)
+{
+    Endpoint endpoint;
+
+    switch (address->sa_family) {
+    case AF_INET:
+    {
+        const struct sockaddr_in *address_inet;
+
+        address_inet = (const struct sockaddr_in *)address;
+        endpoint_init(&endpoint, AF_INET,
+                      (const guint8 *)&(address_inet->sin_addr),
+                      g_ntohs(address_inet->sin_port));
+        break;
+    }
+    case AF_INET6:
+    {
+        const struct sockaddr_in6 *address_inet6;
+
+        address_inet6 = (const struct sockaddr_in6 *)address;
+        endpoint_init(&endpoint, AF_INET6,
+                      (const guint8 *)&(address_inet6->sin6_addr),
+                      g_ntohs(address_inet6->sin6_port));
+        break;
+    }
+    default:
+        return TRUE;
+    }
+
+    /* Unknown port means we can't identify the connection. */
+    if (endpoint.port == 0)
+        return TRUE;
+
+    return !g_hash_table_lookup(checker->closed_endpoints, &endpoint);
+}
+
+/*
+vi:ts=4:nowrap:ai:expandtab:sw=4
+*/
@@ -0,0 +1,73 @@
+/* -*- Mode: C; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+/*
+ *  Copyright (C) 2026  Kouhei Sutou <kou@clear-code.com>
+ *
+ *  This library is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with this library.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef __MILTER_MANAGER_CONNECTION_CHECKER_H__
+#define __MILTER_MANAGER_CONNECTION_CHECKER_H__
+
+#include <sys/types.h>
+#include <sys/socket.h>
+
+#include <glib-object.h>
+
+G_BEGIN_DECLS
+
+#define MILTER_MANAGER_CONNECTION_CHECKER_ERROR           (milter_manager_connection_checker_error_quark())
+
+typedef enum
+{
+    MILTER_MANAGER_CONNECTION_CHECKER_ERROR_NOT_SUPPORTED,
+    MILTER_MANAGER_CONNECTION_CHECKER_ERROR_QUERY
+} MilterManagerConnectionCheckerError;
+
+typedef struct _MilterManagerConnectionChecker MilterManagerConnectionChecker;
+
+GQuark   milter_manager_connection_checker_error_quark (void);
+
+/*
+ * The checker asks the kernel which TCP connections have been
+ * closed by the peer. It uses NETLINK_SOCK_DIAG and falls back to
+ * /proc/net/tcp and /proc/net/tcp6.
+ */
+MilterManagerConnectionChecker *
+         milter_manager_connection_checker_new   (void);
+MilterManagerConnectionChecker *
+         milter_manager_connection_checker_ref   (MilterManagerConnectionChecker *checker);
+void     milter_manager_connection_checker_unref (MilterManagerConnectionChecker *checker);
+
+gboolean milter_manager_connection_checker_update
+                                    (MilterManagerConnectionChecker *checker,
+                                     GError                        **error);
+gboolean milter_manager_connection_checker_is_connected
+                                    (MilterManagerConnectionChecker *checker,
+                                     const struct sockaddr          *address,
+                                     socklen_t                       address_length);
+
+gboolean milter_manager_connection_checker_update_from_proc
+                                    (MilterManagerConnectionChecker *checker,
+                                     const gchar                    *tcp_path,
+                                     const gchar                    *tcp6_path,
+                                     GError                        **error);
+
+G_END_DECLS
+
+#endif /* __MILTER_MANAGER_CONNECTION_CHECKER_H__ */
+
+/*
+vi:ts=4:nowrap:ai:expandtab:sw=4
+*/
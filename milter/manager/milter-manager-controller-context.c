@@ -27,6 +27,7 @@
 #include "milter-manager-enum-types.h"
 #include "milter-manager-control-command-decoder.h"
 #include "milter-manager-control-reply-encoder.h"
+#include "milter-manager-metrics.h"
 
 #define MILTER_MANAGER_CONTROLLER_CONTEXT_GET_PRIVATE(obj)              \
     (G_TYPE_INSTANCE_GET_PRIVATE((obj),                                 \
@@ -214,7 +215,7 @@ cb_decoder_reload (MilterManagerControlCommandDecoder *decoder,
 static void
 collect_status (MilterManagerControllerContext *context, GString *status)
 {
-    g_string_append(status, "FIXME");
+    milter_manager_metrics_format(status);
 }
 
 static void
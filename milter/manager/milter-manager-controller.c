@@ -273,11 +273,11 @@ process_connection(MilterManagerController *controller,
     context = milter_manager_controller_context_new(priv->manager);
     milter_agent_set_event_loop(MILTER_AGENT(context), priv->event_loop);
 
-    writer = milter_writer_io_channel_new(agent_channel);
+    writer = milter_writer_unix_io_channel_new(agent_channel);
     milter_agent_set_writer(MILTER_AGENT(context), writer);
     g_object_unref(writer);
 
-    reader = milter_reader_io_channel_new(agent_channel);
+    reader = milter_reader_unix_io_channel_new(agent_channel);
     milter_agent_set_reader(MILTER_AGENT(context), reader);
     g_object_unref(reader);
 
@@ -21,7 +21,12 @@
 #  include "../../config.h"
 #endif /* HAVE_CONFIG_H */
 
+#include <errno.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+
 #include <milter/core/milter-marshalers.h>
+#include "../core/milter-glib-compatible.h"
 #include "milter-manager-egg.h"
 #include "milter-manager-enum-types.h"
 
@@ -34,6 +39,7 @@
     (MILTER_SERVER_CONTEXT_DEFAULT_READING_TIMEOUT - TIMEOUT_LEEWAY)
 #define DEFAULT_END_OF_MESSAGE_TIMEOUT \
     (MILTER_SERVER_CONTEXT_DEFAULT_END_OF_MESSAGE_TIMEOUT - TIMEOUT_LEEWAY)
+#define DEFAULT_CONNECTION_POOL_IDLE_TIMEOUT 60.0
 
 #define MILTER_MANAGER_EGG_GET_PRIVATE(obj)                     \
     (G_TYPE_INSTANCE_GET_PRIVATE((obj),                         \
@@ -57,6 +63,21 @@ struct _MilterManagerEggPrivate
     GList *applicable_conditions;
     MilterStatus fallback_status;
     gboolean evaluation_mode;
+    guint connection_pool_size;
+    gdouble connection_pool_idle_timeout;
+    GQueue *pooled_connections;
+    GMutex *pool_mutex;
+    gchar *parallel_group;
+};
+
+typedef struct _PooledConnection PooledConnection;
+struct _PooledConnection
+{
+    GIOChannel *channel;
+    MilterOption *option;
+    MilterOption *reply_option;
+    MilterMacrosRequests *macros_requests;
+    GTimer *idle_timer;
 };
 
 enum
@@ -74,7 +95,10 @@ enum
     PROP_COMMAND,
     PROP_COMMAND_OPTIONS,
     PROP_FALLBACK_STATUS,
-    PROP_REPUTATION_MODE
+    PROP_REPUTATION_MODE,
+    PROP_CONNECTION_POOL_SIZE,
+    PROP_CONNECTION_POOL_IDLE_TIMEOUT,
+    PROP_PARALLEL_GROUP
 };
 
 enum
@@ -216,6 +240,36 @@ milter_manager_egg_class_init (MilterManagerEggClass *klass)
                                 G_PARAM_READWRITE);
     g_object_class_install_property(gobject_class, PROP_REPUTATION_MODE, spec);
 
+    spec = g_param_spec_uint("connection-pool-size",
+                             "Connection pool size",
+                             "The max number of idle negotiated connections "
+                             "to be reused. 0 means no pooling.",
+                             0,
+                             G_MAXUINT,
+                             0,
+                             G_PARAM_READWRITE);
+    g_object_class_install_property(gobject_class, PROP_CONNECTION_POOL_SIZE,
+                                    spec);
+
+    spec = g_param_spec_double("connection-pool-idle-timeout",
+                               "Connection pool idle timeout",
+                               "The max idle time of a pooled connection",
+                               0,
+                               G_MAXDOUBLE,
+                               DEFAULT_CONNECTION_POOL_IDLE_TIMEOUT,
+                               G_PARAM_READWRITE);
+    g_object_class_install_property(gobject_class,
+                                    PROP_CONNECTION_POOL_IDLE_TIMEOUT,
+                                    spec);
+
+    spec = g_param_spec_string("parallel-group",
+                               "Parallel group",
+                               "The name of the group of milters that "
+                               "process a message concurrently",
+                               NULL,
+                               G_PARAM_READWRITE);
+    g_object_class_install_property(gobject_class, PROP_PARALLEL_GROUP, spec);
+
     signals[HATCHED] =
         g_signal_new("hatched",
                      G_TYPE_FROM_CLASS(klass),
@@ -259,6 +313,11 @@ milter_manager_egg_init (MilterManagerEgg *egg)
     priv->applicable_conditions = NULL;
     priv->fallback_status = MILTER_STATUS_ACCEPT;
     priv->evaluation_mode = FALSE;
+    priv->connection_pool_size = 0;
+    priv->connection_pool_idle_timeout = DEFAULT_CONNECTION_POOL_IDLE_TIMEOUT;
+    priv->pooled_connections = g_queue_new();
+    priv->pool_mutex = g_mutex_new();
+    priv->parallel_group = NULL;
 }
 
 static void
@@ -300,8 +359,24 @@ dispose (GObject *object)
         priv->command_options = NULL;
     }
 
+    if (priv->parallel_group) {
+        g_free(priv->parallel_group);
+        priv->parallel_group = NULL;
+    }
+
     milter_manager_egg_clear_applicable_conditions(egg);
 
+    if (priv->pooled_connections) {
+        milter_manager_egg_clear_connection_pool(egg);
+        g_queue_free(priv->pooled_connections);
+        priv->pooled_connections = NULL;
+    }
+
+    if (priv->pool_mutex) {
+        g_mutex_free(priv->pool_mutex);
+        priv->pool_mutex = NULL;
+    }
+
     G_OBJECT_CLASS(milter_manager_egg_parent_class)->dispose(object);
 }
 
@@ -356,6 +431,16 @@ set_property (GObject      *object,
     case PROP_REPUTATION_MODE:
         milter_manager_egg_set_evaluation_mode(egg, g_value_get_boolean(value));
         break;
+    case PROP_CONNECTION_POOL_SIZE:
+        milter_manager_egg_set_connection_pool_size(egg,
+                                                    g_value_get_uint(value));
+        break;
+    case PROP_CONNECTION_POOL_IDLE_TIMEOUT:
+        priv->connection_pool_idle_timeout = g_value_get_double(value);
+        break;
+    case PROP_PARALLEL_GROUP:
+        milter_manager_egg_set_parallel_group(egg, g_value_get_string(value));
+        break;
     default:
         G_OBJECT_WARN_INVALID_PROPERTY_ID(object, prop_id, pspec);
         break;
@@ -411,6 +496,15 @@ get_property (GObject    *object,
     case PROP_REPUTATION_MODE:
         g_value_set_boolean(value, priv->evaluation_mode);
         break;
+    case PROP_CONNECTION_POOL_SIZE:
+        g_value_set_uint(value, priv->connection_pool_size);
+        break;
+    case PROP_CONNECTION_POOL_IDLE_TIMEOUT:
+        g_value_set_double(value, priv->connection_pool_idle_timeout);
+        break;
+    case PROP_PARALLEL_GROUP:
+        g_value_set_string(value, priv->parallel_group);
+        break;
     default:
         G_OBJECT_WARN_INVALID_PROPERTY_ID(object, prop_id, pspec);
         break;
@@ -462,6 +556,7 @@ milter_manager_egg_hatch (MilterManagerEgg *egg)
                   "command-options", priv->command_options,
                   "fallback-status", priv->fallback_status,
                   "evaluation-mode", priv->evaluation_mode,
+                  "parallel-group", priv->parallel_group,
                   NULL);
 
     if (priv->connection_spec) {
@@ -732,6 +827,258 @@ milter_manager_egg_is_evaluation_mode (MilterManagerEgg *egg)
     return MILTER_MANAGER_EGG_GET_PRIVATE(egg)->evaluation_mode;
 }
 
+void
+milter_manager_egg_set_parallel_group (MilterManagerEgg *egg,
+                                       const gchar      *group)
+{
+    MilterManagerEggPrivate *priv;
+
+    priv = MILTER_MANAGER_EGG_GET_PRIVATE(egg);
+    if (priv->parallel_group)
+        g_free(priv->parallel_group);
+    priv->parallel_group = g_strdup(group);
+}
+
+const gchar *
+milter_manager_egg_get_parallel_group (MilterManagerEgg *egg)
+{
+    return MILTER_MANAGER_EGG_GET_PRIVATE(egg)->parallel_group;
+}
+
+static PooledConnection *
+pooled_connection_new (GIOChannel *channel,
+                       MilterOption *option,
+                       MilterOption *reply_option,
+                       MilterMacrosRequests *macros_requests)
+{
+    PooledConnection *connection;
+
+    connection = g_new0(PooledConnection, 1);
+    connection->channel = channel;
+    g_io_channel_ref(connection->channel);
+    connection->option = milter_option_copy(option);
+    connection->reply_option = milter_option_copy(reply_option);
+    connection->macros_requests = macros_requests;
+    if (connection->macros_requests)
+        g_object_ref(connection->macros_requests);
+    connection->idle_timer = g_timer_new();
+
+    return connection;
+}
+
+static void
+pooled_connection_free (PooledConnection *connection)
+{
+    g_io_channel_unref(connection->channel);
+    g_object_unref(connection->option);
+    g_object_unref(connection->reply_option);
+    if (connection->macros_requests)
+        g_object_unref(connection->macros_requests);
+    g_timer_destroy(connection->idle_timer);
+    g_free(connection);
+}
+
+static gboolean
+pooled_connection_is_alive (PooledConnection *connection)
+{
+    gint fd;
+    gchar buffer[1];
+    ssize_t size;
+
+    fd = g_io_channel_unix_get_fd(connection->channel);
+    size = recv(fd, buffer, sizeof(buffer), MSG_PEEK | MSG_DONTWAIT);
+    if (size == -1)
+        return errno == EAGAIN || errno == EWOULDBLOCK;
+
+    /* 0 means closed. Data before our command means broken stream. */
+    return FALSE;
+}
+
+void
+milter_manager_egg_set_connection_pool_size (MilterManagerEgg *egg,
+                                             guint             size)
+{
+    MilterManagerEggPrivate *priv;
+    GList *expired_connections = NULL;
+
+    priv = MILTER_MANAGER_EGG_GET_PRIVATE(egg);
+
+    g_mutex_lock(priv->pool_mutex);
+    priv->connection_pool_size = size;
+    while (g_queue_get_length(priv->pooled_connections) > size) {
+        expired_connections =
+            g_list_prepend(expired_connections,
+                           g_queue_pop_head(priv->pooled_connections));
+    }
+    g_mutex_unlock(priv->pool_mutex);
+
+    g_list_foreach(expired_connections, (GFunc)pooled_connection_free, NULL);
+    g_list_free(expired_connections);
+}
+
+guint
+milter_manager_egg_get_connection_pool_size (MilterManagerEgg *egg)
+{
+    return MILTER_MANAGER_EGG_GET_PRIVATE(egg)->connection_pool_size;
+}
+
+void
+milter_manager_egg_set_connection_pool_idle_timeout (MilterManagerEgg *egg,
+                                                     gdouble           timeout)
+{
+    MILTER_MANAGER_EGG_GET_PRIVATE(egg)->connection_pool_idle_timeout = timeout;
+}
+
+gdouble
+milter_manager_egg_get_connection_pool_idle_timeout (MilterManagerEgg *egg)
+{
+    return MILTER_MANAGER_EGG_GET_PRIVATE(egg)->connection_pool_idle_timeout;
+}
+
+guint
+milter_manager_egg_get_n_pooled_connections (MilterManagerEgg *egg)
+{
+    MilterManagerEggPrivate *priv;
+    guint n_connections;
+
+    priv = MILTER_MANAGER_EGG_GET_PRIVATE(egg);
+    g_mutex_lock(priv->pool_mutex);
+    n_connections = g_queue_get_length(priv->pooled_connections);
+    g_mutex_unlock(priv->pool_mutex);
+
+    return n_connections;
+}
+
+gboolean
+milter_manager_egg_is_connection_pool_available (MilterManagerEgg *egg)
+{
+    MilterManagerEggPrivate *priv;
+
+    priv = MILTER_MANAGER_EGG_GET_PRIVATE(egg);
+    if (priv->connection_pool_size == 0)
+        return FALSE;
+
+    return milter_manager_egg_get_n_pooled_connections(egg) <
+        priv->connection_pool_size;
+}
+
+gboolean
+milter_manager_egg_lease_connection (MilterManagerEgg      *egg,
+                                     MilterOption          *option,
+                                     GIOChannel           **channel,
+                                     MilterOption         **reply_option,
+                                     MilterMacrosRequests **macros_requests)
+{
+    MilterManagerEggPrivate *priv;
+    PooledConnection *connection = NULL;
+    GList *node, *expired_connections = NULL;
+
+    priv = MILTER_MANAGER_EGG_GET_PRIVATE(egg);
+    if (priv->connection_pool_size == 0)
+        return FALSE;
+
+    g_mutex_lock(priv->pool_mutex);
+    node = priv->pooled_connections->tail;
+    while (node) {
+        PooledConnection *candidate = node->data;
+        GList *previous = g_list_previous(node);
+
+        if (g_timer_elapsed(candidate->idle_timer, NULL) >
+            priv->connection_pool_idle_timeout) {
+            g_queue_delete_link(priv->pooled_connections, node);
+            expired_connections = g_list_prepend(expired_connections,
+                                                 candidate);
+        } else if (!connection &&
+                   milter_option_equal(candidate->option, option)) {
+            g_queue_delete_link(priv->pooled_connections, node);
+            if (pooled_connection_is_alive(candidate)) {
+                connection = candidate;
+            } else {
+                expired_connections = g_list_prepend(expired_connections,
+                                                     candidate);
+            }
+        }
+        node = previous;
+    }
+    g_mutex_unlock(priv->pool_mutex);
+
+    if (expired_connections) {
+        milter_debug("[egg][connection-pool][expire] <%s>: %u",
+                     priv->name ? priv->name : "(null)",
+                     g_list_length(expired_connections));
+        g_list_foreach(expired_connections,
+                       (GFunc)pooled_connection_free, NULL);
+        g_list_free(expired_connections);
+    }
+
+    if (!connection)
+        return FALSE;
+
+    milter_debug("[egg][connection-pool][lease] <%s>: %d",
+                 priv->name ? priv->name : "(null)",
+                 g_io_channel_unix_get_fd(connection->channel));
+
+    *channel = connection->channel;
+    g_io_channel_ref(*channel);
+    *reply_option = connection->reply_option;
+    g_object_ref(*reply_option);
+    *macros_requests = connection->macros_requests;
+    if (*macros_requests)
+        g_object_ref(*macros_requests);
+    pooled_connection_free(connection);
+
+    return TRUE;
+}
+
+gboolean
+milter_manager_egg_release_connection (MilterManagerEgg     *egg,
+                                       GIOChannel           *channel,
+                                       MilterOption         *option,
+                                       MilterOption         *reply_option,
+                                       MilterMacrosRequests *macros_requests)
+{
+    MilterManagerEggPrivate *priv;
+    gboolean pooled = FALSE;
+
+    priv = MILTER_MANAGER_EGG_GET_PRIVATE(egg);
+
+    g_mutex_lock(priv->pool_mutex);
+    if (g_queue_get_length(priv->pooled_connections) <
+        priv->connection_pool_size) {
+        PooledConnection *connection;
+
+        connection = pooled_connection_new(channel, option, reply_option,
+                                           macros_requests);
+        g_queue_push_tail(priv->pooled_connections, connection);
+        pooled = TRUE;
+    }
+    g_mutex_unlock(priv->pool_mutex);
+
+    milter_debug("[egg][connection-pool][release] <%s>: %d: %s",
+                 priv->name ? priv->name : "(null)",
+                 g_io_channel_unix_get_fd(channel),
+                 pooled ? "pooled" : "full");
+
+    return pooled;
+}
+
+void
+milter_manager_egg_clear_connection_pool (MilterManagerEgg *egg)
+{
+    MilterManagerEggPrivate *priv;
+    GList *connections;
+
+    priv = MILTER_MANAGER_EGG_GET_PRIVATE(egg);
+
+    g_mutex_lock(priv->pool_mutex);
+    connections = priv->pooled_connections->head;
+    g_queue_init(priv->pooled_connections);
+    g_mutex_unlock(priv->pool_mutex);
+
+    g_list_foreach(connections, (GFunc)pooled_connection_free, NULL);
+    g_list_free(connections);
+}
+
 void
 milter_manager_egg_add_applicable_condition (MilterManagerEgg *egg,
                                              MilterManagerApplicableCondition *condition)
@@ -790,6 +1137,7 @@ milter_manager_egg_merge (MilterManagerEgg *egg,
     const gchar *description;
     const gchar *user_name;
     const gchar *command;
+    const gchar *parallel_group;
     const GList *node;
 
     connection_spec = milter_manager_egg_get_connection_spec(other_egg);
@@ -806,9 +1154,17 @@ milter_manager_egg_merge (MilterManagerEgg *egg,
     MERGE_TIMEOUT(writing);
     MERGE_TIMEOUT(reading);
     MERGE_TIMEOUT(end_of_message);
+    MERGE_TIMEOUT(connection_pool_idle);
 
 #undef MERGE_TIMEOUT
 
+    milter_manager_egg_set_connection_pool_size(
+        egg, milter_manager_egg_get_connection_pool_size(other_egg));
+
+    parallel_group = milter_manager_egg_get_parallel_group(other_egg);
+    if (parallel_group)
+        milter_manager_egg_set_parallel_group(egg, parallel_group);
+
     description = milter_manager_egg_get_description(other_egg);
     if (description)
         milter_manager_egg_set_description(egg, description);
@@ -895,6 +1251,21 @@ milter_manager_egg_to_xml_string (MilterManagerEgg *egg,
                                              "command-options",
                                              priv->command_options,
                                              indent + 2);
+    if (priv->connection_pool_size > 0) {
+        gchar *size;
+
+        size = g_strdup_printf("%u", priv->connection_pool_size);
+        milter_utils_xml_append_text_element(string,
+                                             "connection-pool-size",
+                                             size,
+                                             indent + 2);
+        g_free(size);
+    }
+    if (priv->parallel_group)
+        milter_utils_xml_append_text_element(string,
+                                             "parallel-group",
+                                             priv->parallel_group,
+                                             indent + 2);
 
     if (priv->applicable_conditions) {
         GList *node = priv->applicable_conditions;
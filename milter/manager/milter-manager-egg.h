@@ -134,6 +134,39 @@ void                milter_manager_egg_set_evaluation_mode
                                                  gboolean          evaluation_mode);
 gboolean            milter_manager_egg_is_evaluation_mode
                                                 (MilterManagerEgg *egg);
+void                milter_manager_egg_set_parallel_group
+                                                (MilterManagerEgg *egg,
+                                                 const gchar      *group);
+const gchar        *milter_manager_egg_get_parallel_group
+                                                (MilterManagerEgg *egg);
+void                milter_manager_egg_set_connection_pool_size
+                                                (MilterManagerEgg *egg,
+                                                 guint             size);
+guint               milter_manager_egg_get_connection_pool_size
+                                                (MilterManagerEgg *egg);
+void                milter_manager_egg_set_connection_pool_idle_timeout
+                                                (MilterManagerEgg *egg,
+                                                 gdouble           timeout);
+gdouble             milter_manager_egg_get_connection_pool_idle_timeout
+                                                (MilterManagerEgg *egg);
+guint               milter_manager_egg_get_n_pooled_connections
+                                                (MilterManagerEgg *egg);
+gboolean            milter_manager_egg_is_connection_pool_available
+                                                (MilterManagerEgg *egg);
+gboolean            milter_manager_egg_lease_connection
+                                                (MilterManagerEgg      *egg,
+                                                 MilterOption          *option,
+                                                 GIOChannel           **channel,
+                                                 MilterOption         **reply_option,
+                                                 MilterMacrosRequests **macros_requests);
+gboolean            milter_manager_egg_release_connection
+                                                (MilterManagerEgg     *egg,
+                                                 GIOChannel           *channel,
+                                                 MilterOption         *option,
+                                                 MilterOption         *reply_option,
+                                                 MilterMacrosRequests *macros_requests);
+void                milter_manager_egg_clear_connection_pool
+                                                (MilterManagerEgg *egg);
 
 void                milter_manager_egg_add_applicable_condition
                                                 (MilterManagerEgg *egg,
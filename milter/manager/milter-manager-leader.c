@@ -25,6 +25,7 @@
 #include "milter-manager-leader.h"
 #include "milter-manager-enum-types.h"
 #include "milter-manager-children.h"
+#include "milter-manager-connection-checker.h"
 
 #define MILTER_MANAGER_LEADER_GET_PRIVATE(obj)                   \
     (G_TYPE_INSTANCE_GET_PRIVATE((obj),                          \
@@ -43,6 +44,7 @@ struct _MilterManagerLeaderPrivate
     GIOChannel *launcher_write_channel;
     gboolean processing;
     guint tag;
+    MilterManagerConnectionChecker *connection_checker;
 };
 
 enum
@@ -155,6 +157,21 @@ milter_manager_leader_init (MilterManagerLeader *leader)
     priv->launcher_write_channel = NULL;
     priv->processing = FALSE;
     priv->tag = 0;
+    priv->connection_checker = NULL;
+}
+
+gboolean
+milter_manager_leader_is_waiting_reply (MilterManagerLeader *leader)
+{
+    MilterManagerLeaderPrivate *priv;
+
+    priv = MILTER_MANAGER_LEADER_GET_PRIVATE(leader);
+    if (!priv->processing)
+        return FALSE;
+    if (priv->children &&
+        !milter_manager_children_is_waiting_reply(priv->children))
+        return FALSE;
+    return TRUE;
 }
 
 gboolean
@@ -272,6 +289,7 @@ dispose (GObject *object)
         priv->children = NULL;
     }
     milter_manager_leader_set_launcher_channel(leader, NULL, NULL);
+    milter_manager_leader_set_connection_checker(leader, NULL);
 
 
     G_OBJECT_CLASS(milter_manager_leader_parent_class)->dispose(object);
@@ -335,10 +353,64 @@ get_property (GObject    *object,
     }
 }
 
+static gboolean
+is_local_socket_address (MilterGenericSocketAddress *address)
+{
+    switch (address->address.base.sa_family) {
+    case AF_UNIX:
+        return TRUE;
+    case AF_INET:
+    {
+        const guint8 *bytes;
+
+        bytes = (const guint8 *)&(address->address.inet.sin_addr);
+        return bytes[0] == 127 ||
+            bytes[0] == 10 ||
+            (bytes[0] == 172 && (bytes[1] & 0xf0) == 16) ||
+            (bytes[0] == 192 && bytes[1] == 168);
+    }
+    case AF_INET6:
+    {
+        const struct in6_addr *inet6;
+
+        inet6 = &(address->address.inet6.sin6_addr);
+        return IN6_IS_ADDR_LOOPBACK(inet6) || IN6_IS_ADDR_LINKLOCAL(inet6);
+    }
+    default:
+        return FALSE;
+    }
+}
+
 static gboolean
 connection_check_default (MilterManagerLeader *leader)
 {
+    MilterManagerLeaderPrivate *priv;
+    MilterGenericSocketAddress *server_address;
+    struct sockaddr *client_address;
+    socklen_t client_address_length;
     gboolean connecting = TRUE;
+
+    priv = MILTER_MANAGER_LEADER_GET_PRIVATE(leader);
+    if (!priv->connection_checker || !priv->children)
+        return connecting;
+
+    /* The kernel knows only connections of the MTA on this host. */
+    server_address =
+        milter_client_context_get_socket_address(priv->client_context);
+    if (!server_address || !is_local_socket_address(server_address))
+        return connecting;
+
+    if (!milter_manager_children_get_smtp_client_address(priv->children,
+                                                         &client_address,
+                                                         &client_address_length))
+        return connecting;
+
+    connecting =
+        milter_manager_connection_checker_is_connected(priv->connection_checker,
+                                                       client_address,
+                                                       client_address_length);
+    g_free(client_address);
+
     return connecting;
 }
 
@@ -1364,6 +1436,20 @@ milter_manager_leader_get_children (MilterManagerLeader *leader)
     return MILTER_MANAGER_LEADER_GET_PRIVATE(leader)->children;
 }
 
+void
+milter_manager_leader_set_connection_checker (MilterManagerLeader *leader,
+                                              MilterManagerConnectionChecker *checker)
+{
+    MilterManagerLeaderPrivate *priv;
+
+    priv = MILTER_MANAGER_LEADER_GET_PRIVATE(leader);
+    if (priv->connection_checker)
+        milter_manager_connection_checker_unref(priv->connection_checker);
+    priv->connection_checker = checker;
+    if (priv->connection_checker)
+        milter_manager_connection_checker_ref(priv->connection_checker);
+}
+
 /*
 vi:ts=4:nowrap:ai:expandtab:sw=4
 */
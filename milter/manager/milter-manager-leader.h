@@ -25,6 +25,7 @@
 #include <milter/client.h>
 #include <milter/server.h>
 #include <milter/manager/milter-manager-configuration.h>
+#include <milter/manager/milter-manager-connection-checker.h>
 
 G_BEGIN_DECLS
 
@@ -106,6 +107,8 @@ void                  milter_manager_leader_set_launcher_channel
 
 gboolean              milter_manager_leader_check_connection
                                           (MilterManagerLeader *leader);
+gboolean              milter_manager_leader_is_waiting_reply
+                                          (MilterManagerLeader *leader);
 
 MilterStatus          milter_manager_leader_negotiate
                                           (MilterManagerLeader *leader,
@@ -163,6 +166,9 @@ void                  milter_manager_leader_set_tag
 
 MilterManagerChildren *milter_manager_leader_get_children
                                           (MilterManagerLeader *leader);
+void                  milter_manager_leader_set_connection_checker
+                                          (MilterManagerLeader            *leader,
+                                           MilterManagerConnectionChecker *checker);
 
 G_END_DECLS
 
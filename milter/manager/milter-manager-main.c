@@ -216,8 +216,19 @@ static gboolean
 cb_idle_reload_configuration (gpointer user_data)
 {
     if (the_manager) {
+        MilterClient *client;
         GError *error = NULL;
 
+        client = MILTER_CLIENT(the_manager);
+        if (milter_client_get_n_event_loop_threads(client) > 0 &&
+            milter_client_get_n_workers(client) == 0) {
+            milter_warning("[manager][reload][signal][event-loop-threads] "
+                           "configuration can't be reloaded while sessions "
+                           "are processed in event loop threads: <%u>",
+                           milter_client_get_n_event_loop_threads(client));
+            return FALSE;
+        }
+
         if (!milter_manager_reload(the_manager, &error)) {
             milter_error("[manager][reload][signal][error] %s",
                          error->message);
@@ -361,10 +372,10 @@ start_process_launcher (GIOChannel *read_channel, GIOChannel *write_channel,
     logger = milter_syslog_logger_new("milter-manager-process-launcher",
                                       NULL);
 
-    reader = milter_reader_io_channel_new(read_channel);
+    reader = milter_reader_unix_io_channel_new(read_channel);
     g_io_channel_unref(read_channel);
 
-    writer = milter_writer_io_channel_new(write_channel);
+    writer = milter_writer_unix_io_channel_new(write_channel);
 
     launcher = milter_manager_process_launcher_new();
     milter_agent_set_reader(MILTER_AGENT(launcher), reader);
@@ -643,6 +654,12 @@ milter_manager_main (void)
 
     remove_socket = milter_manager_configuration_is_remove_manager_unix_socket_on_create(config);
     milter_client_set_remove_unix_socket_on_create(client, remove_socket);
+    milter_client_set_reuse_port(client,
+                                 milter_manager_configuration_is_reuse_port(config));
+    if (milter_client_is_direct_write(client))
+        milter_manager_configuration_set_direct_write(config, TRUE);
+    milter_client_set_direct_write(client,
+                                   milter_manager_configuration_is_direct_write(config));
 
     if (!milter_client_listen(client, &error)) {
         milter_manager_error("failed to listen: %s", error->message);
@@ -656,6 +673,28 @@ milter_manager_main (void)
         return FALSE;
     }
 
+    if (!milter_manager_metrics_init(milter_client_get_n_workers(client),
+                                     &error)) {
+        milter_manager_error("failed to initialize metrics: %s",
+                             error->message);
+        g_error_free(error);
+        error = NULL;
+    }
+
+    if (milter_client_get_n_workers(client) == 0 &&
+        milter_manager_configuration_get_statistics_path(config)) {
+        if (!milter_manager_statistics_open(
+                milter_manager_configuration_get_statistics_path(config),
+                milter_manager_configuration_get_statistics_rotate_size(config),
+                0,
+                &error)) {
+            milter_manager_error("failed to start statistics: %s",
+                                 error->message);
+            g_error_free(error);
+            error = NULL;
+        }
+    }
+
     loop = milter_client_get_event_loop(client);
     controller = milter_manager_controller_new(manager, loop);
     if (controller && !milter_manager_controller_listen(controller, &error)) {
@@ -680,6 +719,17 @@ milter_manager_main (void)
         }
     }
 
+    /* Hooks such as Ruby connection checkers and applicable
+     * condition stoppers must be called in the main event loop. */
+    if (milter_client_get_n_event_loop_threads(client) > 0 &&
+        milter_manager_configuration_have_session_hook(config)) {
+        milter_warning("[manager][event-loop-threads][disable] "
+                       "sessions are processed in the main event loop "
+                       "because session hooks are configured: <%u>",
+                       milter_client_get_n_event_loop_threads(client));
+        milter_client_set_n_event_loop_threads(client, 0);
+    }
+
     the_manager = manager;
 
 #define SETUP_SIGNAL_ACTION(handler)            \
@@ -724,6 +774,8 @@ milter_manager_main (void)
 
     if (controller)
         g_object_unref(controller);
+    milter_manager_metrics_quit();
+    milter_manager_statistics_close();
 
     return TRUE;
 }
@@ -0,0 +1,590 @@
+/* -*- Mode: C; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+/*
+ *  Copyright (C) 2026  Kouhei Sutou <kou@clear-code.com>
+ *
+ *  This library is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with this library.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifdef HAVE_CONFIG_H
+#  include "../../config.h"
+#endif /* HAVE_CONFIG_H */
+
+#include <string.h>
+#include <errno.h>
+#include <sys/mman.h>
+
+#include "milter-manager-metrics.h"
+
+/*
+ * All counters live in one anonymous shared mapping that is
+ * created by the master process before workers are forked.
+ * Each worker writes only its own slot by atomic operations
+ * and the controller reads all slots without locks.
+ */
+
+#define MAX_CHILDREN 64
+#define CHILD_NAME_SIZE 64
+#define N_STATUSES (MILTER_STATUS_ERROR + 1)
+#define N_TIMEOUTS (MILTER_MANAGER_METRICS_TIMEOUT_END_OF_MESSAGE + 1)
+
+static const gchar *stage_names[] = {
+    "negotiate",
+    "connect",
+    "helo",
+    "envelope-from",
+    "envelope-recipient",
+    "data",
+    "unknown",
+    "header",
+    "end-of-header",
+    "body",
+    "end-of-message"
+};
+#define N_STAGES G_N_ELEMENTS(stage_names)
+
+static const gchar *timeout_names[] = {
+    "writing",
+    "reading",
+    "end-of-message"
+};
+
+static const gdouble latency_bounds[] = {
+    0.001, 0.005, 0.01, 0.05, 0.1, 0.5, 1.0, 5.0, 10.0, 30.0
+};
+#define N_BUCKETS (G_N_ELEMENTS(latency_bounds) + 1)
+
+typedef enum {
+    CHILD_NAME_FREE,
+    CHILD_NAME_CLAIMING,
+    CHILD_NAME_READY
+} ChildNameState;
+
+typedef struct _ChildName
+{
+    volatile gint state;
+    gchar name[CHILD_NAME_SIZE];
+} ChildName;
+
+typedef struct _Histogram
+{
+    volatile gint buckets[N_BUCKETS];
+    volatile gint sum_usec_low;
+    volatile gint sum_usec_high;
+} Histogram;
+
+typedef struct _ChildMetrics
+{
+    Histogram latencies[N_STAGES];
+    volatile gint statuses[N_STATUSES];
+    volatile gint timeouts[N_TIMEOUTS];
+} ChildMetrics;
+
+typedef struct _WorkerMetrics
+{
+    volatile gint n_processing_sessions;
+    volatile gint sessions[N_STATUSES];
+    volatile gint body_spool_size;
+    ChildMetrics children[MAX_CHILDREN];
+} WorkerMetrics;
+
+typedef struct _Segment
+{
+    guint n_workers;
+    ChildName child_names[MAX_CHILDREN];
+    WorkerMetrics workers[1];
+} Segment;
+
+G_LOCK_DEFINE_STATIC(segment);
+static Segment *segment = NULL;
+static gsize segment_size = 0;
+static gboolean segment_shared = FALSE;
+static guint current_worker_id = 0;
+
+static gsize
+compute_segment_size (guint n_workers)
+{
+    return sizeof(Segment) + sizeof(WorkerMetrics) * n_workers;
+}
+
+static void
+free_segment (void)
+{
+    if (!segment)
+        return;
+
+    if (segment_shared)
+        munmap(segment, segment_size);
+    else
+        g_free(segment);
+    segment = NULL;
+    segment_size = 0;
+    segment_shared = FALSE;
+}
+
+gboolean
+milter_manager_metrics_init (guint n_workers, GError **error)
+{
+    gpointer map;
+    gsize size;
+
+    size = compute_segment_size(n_workers);
+    map = mmap(NULL, size, PROT_READ | PROT_WRITE,
+               MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (map == MAP_FAILED) {
+        g_set_error(error,
+                    G_FILE_ERROR,
+                    g_file_error_from_errno(errno),
+                    "failed to map metrics: %s",
+                    g_strerror(errno));
+        return FALSE;
+    }
+
+    free_segment();
+    segment = map;
+    segment_size = size;
+    segment_shared = TRUE;
+    segment->n_workers = n_workers;
+    current_worker_id = 0;
+
+    milter_debug("[metrics][init] <%u> <%" G_GSIZE_FORMAT ">",
+                 n_workers, size);
+
+    return TRUE;
+}
+
+void
+milter_manager_metrics_quit (void)
+{
+    free_segment();
+    current_worker_id = 0;
+}
+
+static Segment *
+get_segment (void)
+{
+    Segment *current_segment;
+
+    current_segment = g_atomic_pointer_get(&segment);
+    if (G_UNLIKELY(!current_segment)) {
+        G_LOCK(segment);
+        if (!segment) {
+            segment_size = compute_segment_size(0);
+            g_atomic_pointer_set(&segment, g_malloc0(segment_size));
+        }
+        current_segment = segment;
+        G_UNLOCK(segment);
+    }
+
+    return current_segment;
+}
+
+void
+milter_manager_metrics_reset (void)
+{
+    Segment *current_segment;
+    guint n_workers;
+
+    current_segment = get_segment();
+    n_workers = current_segment->n_workers;
+    memset(current_segment, 0, segment_size);
+    current_segment->n_workers = n_workers;
+}
+
+void
+milter_manager_metrics_set_worker_id (guint worker_id)
+{
+    current_worker_id = worker_id;
+}
+
+static WorkerMetrics *
+get_worker (Segment *current_segment)
+{
+    guint worker_id = current_worker_id;
+
+    if (worker_id > current_segment->n_workers)
+        worker_id = 0;
+    return &(current_segment->workers[worker_id]);
+}
+
+static gint
+lookup_child (Segment *current_segment, const gchar *name)
+{
+    guint i;
+
+    if (!name)
+        return -1;
+
+    for (i = 0; i < MAX_CHILDREN; i++) {
+        ChildName *child_name = &(current_segment->child_names[i]);
+        gint state;
+
+        state = g_atomic_int_get(&(child_name->state));
+        if (state == CHILD_NAME_FREE) {
+            if (g_atomic_int_compare_and_exchange(&(child_name->state),
+                                                  CHILD_NAME_FREE,
+                                                  CHILD_NAME_CLAIMING)) {
+                g_strlcpy(child_name->name, name, CHILD_NAME_SIZE);
+                g_atomic_int_set(&(child_name->state), CHILD_NAME_READY);
+                return i;
+            }
+            state = g_atomic_int_get(&(child_name->state));
+        }
+        while (state == CHILD_NAME_CLAIMING) {
+            state = g_atomic_int_get(&(child_name->state));
+        }
+        if (strncmp(child_name->name, name, CHILD_NAME_SIZE - 1) == 0)
+            return i;
+    }
+
+    return -1;
+}
+
+static gint
+stage_from_state (MilterServerContextState state)
+{
+    switch (state) {
+    case MILTER_SERVER_CONTEXT_STATE_NEGOTIATE:
+        return 0;
+    case MILTER_SERVER_CONTEXT_STATE_CONNECT:
+        return 1;
+    case MILTER_SERVER_CONTEXT_STATE_HELO:
+        return 2;
+    case MILTER_SERVER_CONTEXT_STATE_ENVELOPE_FROM:
+        return 3;
+    case MILTER_SERVER_CONTEXT_STATE_ENVELOPE_RECIPIENT:
+        return 4;
+    case MILTER_SERVER_CONTEXT_STATE_DATA:
+        return 5;
+    case MILTER_SERVER_CONTEXT_STATE_UNKNOWN:
+        return 6;
+    case MILTER_SERVER_CONTEXT_STATE_HEADER:
+        return 7;
+    case MILTER_SERVER_CONTEXT_STATE_END_OF_HEADER:
+        return 8;
+    case MILTER_SERVER_CONTEXT_STATE_BODY:
+        return 9;
+    case MILTER_SERVER_CONTEXT_STATE_END_OF_MESSAGE:
+        return 10;
+    default:
+        return -1;
+    }
+}
+
+static void
+histogram_observe (Histogram *histogram, gdouble elapsed)
+{
+    guint i;
+    guint usec, old_low;
+
+    for (i = 0; i < G_N_ELEMENTS(latency_bounds); i++) {
+        if (elapsed <= latency_bounds[i])
+            break;
+    }
+    g_atomic_int_inc(&(histogram->buckets[i]));
+
+    if (elapsed < 0)
+        elapsed = 0;
+    usec = (guint)(elapsed * G_USEC_PER_SEC);
+    do {
+        old_low = g_atomic_int_get(&(histogram->sum_usec_low));
+    } while (!g_atomic_int_compare_and_exchange(&(histogram->sum_usec_low),
+                                                old_low,
+                                                old_low + usec));
+    if (old_low + usec < old_low)
+        g_atomic_int_inc(&(histogram->sum_usec_high));
+}
+
+void
+milter_manager_metrics_record_reply (const gchar *child_name,
+                                     MilterServerContextState state,
+                                     MilterStatus status,
+                                     gdouble elapsed)
+{
+    Segment *current_segment;
+    ChildMetrics *child;
+    gint index, stage;
+
+    current_segment = get_segment();
+    index = lookup_child(current_segment, child_name);
+    if (index < 0)
+        return;
+
+    child = &(get_worker(current_segment)->children[index]);
+    stage = stage_from_state(state);
+    if (stage >= 0)
+        histogram_observe(&(child->latencies[stage]), elapsed);
+    if ((guint)status < N_STATUSES)
+        g_atomic_int_inc(&(child->statuses[status]));
+}
+
+void
+milter_manager_metrics_record_timeout (const gchar *child_name,
+                                       MilterManagerMetricsTimeout timeout)
+{
+    Segment *current_segment;
+    ChildMetrics *child;
+    gint index;
+
+    current_segment = get_segment();
+    index = lookup_child(current_segment, child_name);
+    if (index < 0)
+        return;
+
+    child = &(get_worker(current_segment)->children[index]);
+    g_atomic_int_inc(&(child->timeouts[timeout]));
+}
+
+void
+milter_manager_metrics_session_started (void)
+{
+    WorkerMetrics *worker;
+
+    worker = get_worker(get_segment());
+    g_atomic_int_inc(&(worker->n_processing_sessions));
+}
+
+void
+milter_manager_metrics_session_finished (MilterStatus status)
+{
+    WorkerMetrics *worker;
+
+    worker = get_worker(get_segment());
+    g_atomic_int_add(&(worker->n_processing_sessions), -1);
+    if ((guint)status < N_STATUSES)
+        g_atomic_int_inc(&(worker->sessions[status]));
+}
+
+void
+milter_manager_metrics_add_body_spool_size (gssize size)
+{
+    WorkerMetrics *worker;
+
+    worker = get_worker(get_segment());
+    g_atomic_int_add(&(worker->body_spool_size), (gint)size);
+}
+
+static void
+format_histograms (GString *output, Segment *current_segment)
+{
+    const gchar *metric = "milter_manager_child_reply_duration_seconds";
+    guint worker_id, i, stage, bucket;
+
+    g_string_append_printf(output,
+                           "# HELP %s Round trip time of child milter replies.\n"
+                           "# TYPE %s histogram\n",
+                           metric, metric);
+    for (worker_id = 0; worker_id <= current_segment->n_workers; worker_id++) {
+        WorkerMetrics *worker = &(current_segment->workers[worker_id]);
+
+        for (i = 0; i < MAX_CHILDREN; i++) {
+            ChildName *child_name = &(current_segment->child_names[i]);
+            gchar *escaped_name;
+
+            if (g_atomic_int_get(&(child_name->state)) != CHILD_NAME_READY)
+                continue;
+            escaped_name = g_strescape(child_name->name, NULL);
+            for (stage = 0; stage < N_STAGES; stage++) {
+                Histogram *histogram;
+                guint64 count = 0, sum_usec;
+                gchar *labels;
+
+                histogram = &(worker->children[i].latencies[stage]);
+                for (bucket = 0; bucket < N_BUCKETS; bucket++) {
+                    count += (guint)g_atomic_int_get(&(histogram->buckets[bucket]));
+                }
+                if (count == 0)
+                    continue;
+
+                labels = g_strdup_printf("worker=\"%u\",child=\"%s\","
+                                         "stage=\"%s\"",
+                                         worker_id, escaped_name,
+                                         stage_names[stage]);
+                count = 0;
+                for (bucket = 0; bucket < N_BUCKETS; bucket++) {
+                    count += (guint)g_atomic_int_get(&(histogram->buckets[bucket]));
+                    if (bucket < G_N_ELEMENTS(latency_bounds)) {
+                        g_string_append_printf(output,
+                                               "%s_bucket{%s,le=\"%g\"} "
+                                               "%" G_GUINT64_FORMAT "\n",
+                                               metric, labels,
+                                               latency_bounds[bucket],
+                                               count);
+                    } else {
+                        g_string_append_printf(output,
+                                               "%s_bucket{%s,le=\"+Inf\"} "
+                                               "%" G_GUINT64_FORMAT "\n",
+                                               metric, labels, count);
+                    }
+                }
+                sum_usec =
+                    ((guint64)(guint)g_atomic_int_get(&(histogram->sum_usec_high)) << 32) +
+                    (guint)g_atomic_int_get(&(histogram->sum_usec_low));
+                g_string_append_printf(output,
+                                       "%s_sum{%s} %g\n"
+                                       "%s_count{%s} %" G_GUINT64_FORMAT "\n",
+                                       metric, labels,
+                                       sum_usec / (gdouble)G_USEC_PER_SEC,
+                                       metric, labels, count);
+                g_free(labels);
+            }
+            g_free(escaped_name);
+        }
+    }
+}
+
+static void
+format_child_counters (GString *output, Segment *current_segment)
+{
+    guint worker_id, i, status, timeout;
+
+    g_string_append(output,
+                    "# HELP milter_manager_child_replies_total "
+                    "Replies from child milters by status.\n"
+                    "# TYPE milter_manager_child_replies_total counter\n");
+    for (worker_id = 0; worker_id <= current_segment->n_workers; worker_id++) {
+        WorkerMetrics *worker = &(current_segment->workers[worker_id]);
+
+        for (i = 0; i < MAX_CHILDREN; i++) {
+            ChildName *child_name = &(current_segment->child_names[i]);
+            gchar *escaped_name;
+
+            if (g_atomic_int_get(&(child_name->state)) != CHILD_NAME_READY)
+                continue;
+            escaped_name = g_strescape(child_name->name, NULL);
+            for (status = 0; status < N_STATUSES; status++) {
+                guint count;
+                gchar *status_name;
+
+                count = g_atomic_int_get(&(worker->children[i].statuses[status]));
+                if (count == 0)
+                    continue;
+                status_name = milter_utils_get_enum_nick_name(MILTER_TYPE_STATUS,
+                                                              status);
+                g_string_append_printf(output,
+                                       "milter_manager_child_replies_total"
+                                       "{worker=\"%u\",child=\"%s\","
+                                       "status=\"%s\"} %u\n",
+                                       worker_id, escaped_name,
+                                       status_name, count);
+                g_free(status_name);
+            }
+            g_free(escaped_name);
+        }
+    }
+
+    g_string_append(output,
+                    "# HELP milter_manager_child_timeouts_total "
+                    "Timeouts of child milters.\n"
+                    "# TYPE milter_manager_child_timeouts_total counter\n");
+    for (worker_id = 0; worker_id <= current_segment->n_workers; worker_id++) {
+        WorkerMetrics *worker = &(current_segment->workers[worker_id]);
+
+        for (i = 0; i < MAX_CHILDREN; i++) {
+            ChildName *child_name = &(current_segment->child_names[i]);
+            gchar *escaped_name;
+
+            if (g_atomic_int_get(&(child_name->state)) != CHILD_NAME_READY)
+                continue;
+            escaped_name = g_strescape(child_name->name, NULL);
+            for (timeout = 0; timeout < N_TIMEOUTS; timeout++) {
+                guint count;
+
+                count = g_atomic_int_get(&(worker->children[i].timeouts[timeout]));
+                if (count == 0)
+                    continue;
+                g_string_append_printf(output,
+                                       "milter_manager_child_timeouts_total"
+                                       "{worker=\"%u\",child=\"%s\","
+                                       "type=\"%s\"} %u\n",
+                                       worker_id, escaped_name,
+                                       timeout_names[timeout], count);
+            }
+            g_free(escaped_name);
+        }
+    }
+}
+
+static void
+format_worker_counters (GString *output, Segment *current_segment)
+{
+    guint worker_id, status;
+
+    g_string_append(output,
+                    "# HELP milter_manager_sessions_in_flight "
+                    "Sessions being processed.\n"
+                    "# TYPE milter_manager_sessions_in_flight gauge\n");
+    for (worker_id = 0; worker_id <= current_segment->n_workers; worker_id++) {
+        WorkerMetrics *worker = &(current_segment->workers[worker_id]);
+
+        g_string_append_printf(output,
+                               "milter_manager_sessions_in_flight"
+                               "{worker=\"%u\"} %d\n",
+                               worker_id,
+                               g_atomic_int_get(&(worker->n_processing_sessions)));
+    }
+
+    g_string_append(output,
+                    "# HELP milter_manager_sessions_total "
+                    "Finished sessions by status.\n"
+                    "# TYPE milter_manager_sessions_total counter\n");
+    for (worker_id = 0; worker_id <= current_segment->n_workers; worker_id++) {
+        WorkerMetrics *worker = &(current_segment->workers[worker_id]);
+
+        for (status = 0; status < N_STATUSES; status++) {
+            guint count;
+            gchar *status_name;
+
+            count = g_atomic_int_get(&(worker->sessions[status]));
+            if (count == 0)
+                continue;
+            status_name = milter_utils_get_enum_nick_name(MILTER_TYPE_STATUS,
+                                                          status);
+            g_string_append_printf(output,
+                                   "milter_manager_sessions_total"
+                                   "{worker=\"%u\",status=\"%s\"} %u\n",
+                                   worker_id, status_name, count);
+            g_free(status_name);
+        }
+    }
+
+    g_string_append(output,
+                    "# HELP milter_manager_body_spool_bytes "
+                    "Bytes of spooled message bodies.\n"
+                    "# TYPE milter_manager_body_spool_bytes gauge\n");
+    for (worker_id = 0; worker_id <= current_segment->n_workers; worker_id++) {
+        WorkerMetrics *worker = &(current_segment->workers[worker_id]);
+
+        g_string_append_printf(output,
+                               "milter_manager_body_spool_bytes"
+                               "{worker=\"%u\"} %d\n",
+                               worker_id,
+                               g_atomic_int_get(&(worker->body_spool_size)));
+    }
+}
+
+void
+milter_manager_metrics_format (GString *output)
+{
+    Segment *current_segment;
+
+    current_segment = get_segment();
+    format_histograms(output, current_segment);
+    format_child_counters(output, current_segment);
+    format_worker_counters(output, current_segment);
+}
+
+/*
+vi:ts=4:nowrap:ai:expandtab:sw=4
+*/
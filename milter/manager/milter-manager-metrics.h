@@ -0,0 +1,66 @@
+/* -*- Mode: C; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+/*
+ *  Copyright (C) 2026  Kouhei Sutou <kou@clear-code.com>
+ *
+ *  This library is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with this library.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef __MILTER_MANAGER_METRICS_H__
+#define __MILTER_MANAGER_METRICS_H__
+
+#include <glib-object.h>
+
+#include <milter/server.h>
+
+G_BEGIN_DECLS
+
+typedef enum
+{
+    MILTER_MANAGER_METRICS_TIMEOUT_WRITING,
+    MILTER_MANAGER_METRICS_TIMEOUT_READING,
+    MILTER_MANAGER_METRICS_TIMEOUT_END_OF_MESSAGE
+} MilterManagerMetricsTimeout;
+
+gboolean milter_manager_metrics_init       (guint n_workers,
+                                            GError **error);
+void     milter_manager_metrics_quit       (void);
+void     milter_manager_metrics_reset      (void);
+void     milter_manager_metrics_set_worker_id
+                                           (guint worker_id);
+
+void     milter_manager_metrics_record_reply
+                                           (const gchar *child_name,
+                                            MilterServerContextState state,
+                                            MilterStatus status,
+                                            gdouble elapsed);
+void     milter_manager_metrics_record_timeout
+                                           (const gchar *child_name,
+                                            MilterManagerMetricsTimeout timeout);
+void     milter_manager_metrics_session_started
+                                           (void);
+void     milter_manager_metrics_session_finished
+                                           (MilterStatus status);
+void     milter_manager_metrics_add_body_spool_size
+                                           (gssize size);
+
+void     milter_manager_metrics_format     (GString *output);
+
+G_END_DECLS
+
+#endif /* __MILTER_MANAGER_METRICS_H__ */
+
+/*
+vi:ts=4:nowrap:ai:expandtab:sw=4
+*/
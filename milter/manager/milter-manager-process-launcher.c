@@ -114,7 +114,7 @@ create_reader (GPid pid ,gint fd)
     g_io_channel_set_encoding(channel, NULL, NULL);
     g_io_channel_set_flags(channel, G_IO_FLAG_NONBLOCK, NULL);
     g_io_channel_set_close_on_unref(channel, TRUE);
-    reader = milter_reader_io_channel_new(channel);
+    reader = milter_reader_unix_io_channel_new(channel);
     g_io_channel_unref(channel);
 
     milter_reader_set_tag(reader, (gint)pid);
@@ -0,0 +1,803 @@
+/* -*- Mode: C; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+/*
+ *  Copyright (C) 2026  Kouhei Sutou <kou@clear-code.com>
+ *
+ *  This library is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with this library.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifdef HAVE_CONFIG_H
+#  include "../../config.h"
+#endif /* HAVE_CONFIG_H */
+
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#include <glib/gstdio.h>
+
+#include <milter/core/milter-glib-compatible.h>
+
+#include "milter-manager-statistics.h"
+
+/*
+ * Records are written as newline-delimited JSON objects by a
+ * background thread. Each worker process writes its own file.
+ */
+
+#define MAX_PENDING_RECORDS 100000
+#define N_ROTATED_FILES 10
+#define READ_BUFFER_SIZE 65536
+
+typedef struct _Writer
+{
+    gchar *base_path;
+    gchar *path;
+    guint64 rotate_size;
+    FILE *output;
+    guint64 size;
+    GAsyncQueue *queue;
+    GThread *thread;
+    guint n_dropped_records;
+} Writer;
+
+G_LOCK_DEFINE_STATIC(writer);
+static Writer *writer = NULL;
+static guint current_worker_id = 0;
+static gchar stop_marker[] = "stop";
+
+GQuark
+milter_manager_statistics_error_quark (void)
+{
+    return g_quark_from_static_string("milter-manager-statistics-error-quark");
+}
+
+static void
+rotate (Writer *current_writer)
+{
+    gint i;
+    gchar *old_path, *new_path;
+
+    fclose(current_writer->output);
+    current_writer->output = NULL;
+
+    for (i = N_ROTATED_FILES - 1; i > 0; i--) {
+        old_path = g_strdup_printf("%s.%d", current_writer->path, i);
+        new_path = g_strdup_printf("%s.%d", current_writer->path, i + 1);
+        g_rename(old_path, new_path);
+        g_free(old_path);
+        g_free(new_path);
+    }
+    new_path = g_strdup_printf("%s.1", current_writer->path);
+    if (g_rename(current_writer->path, new_path) == -1) {
+        milter_warning("[statistics][rotate][error] <%s>: %s",
+                       current_writer->path, g_strerror(errno));
+    }
+    g_free(new_path);
+
+    current_writer->output = fopen(current_writer->path, "a");
+    current_writer->size = 0;
+    if (!current_writer->output) {
+        milter_warning("[statistics][rotate][open][error] <%s>: %s",
+                       current_writer->path, g_strerror(errno));
+    }
+}
+
+static void
+write_record (Writer *current_writer, const gchar *line)
+{
+    gsize length;
+
+    length = strlen(line);
+    if (current_writer->rotate_size > 0 &&
+        current_writer->size > 0 &&
+        current_writer->size + length > current_writer->rotate_size) {
+        rotate(current_writer);
+    }
+
+    if (!current_writer->output)
+        return;
+
+    if (fwrite(line, 1, length, current_writer->output) != length) {
+        milter_warning("[statistics][write][error] <%s>: %s",
+                       current_writer->path, g_strerror(errno));
+        return;
+    }
+    current_writer->size += length;
+}
+
+static gpointer
+writer_thread (gpointer data)
+{
+    Writer *current_writer = data;
+
+    while (TRUE) {
+        gchar *line;
+
+        line = g_async_queue_pop(current_writer->queue);
+        if (line == stop_marker)
+            break;
+        write_record(current_writer, line);
+        g_free(line);
+        if (current_writer->output &&
+            g_async_queue_length(current_writer->queue) <= 0)
+            fflush(current_writer->output);
+    }
+
+    if (current_writer->output)
+        fflush(current_writer->output);
+
+    return NULL;
+}
+
+static void
+free_writer (Writer *current_writer)
+{
+    if (current_writer->thread) {
+        g_async_queue_push(current_writer->queue, stop_marker);
+        g_thread_join(current_writer->thread);
+    }
+    if (current_writer->n_dropped_records > 0) {
+        milter_warning("[statistics][dropped] <%s>: <%u>",
+                       current_writer->path,
+                       current_writer->n_dropped_records);
+    }
+    if (current_writer->queue)
+        g_async_queue_unref(current_writer->queue);
+    if (current_writer->output)
+        fclose(current_writer->output);
+    g_free(current_writer->base_path);
+    g_free(current_writer->path);
+    g_free(current_writer);
+}
+
+gboolean
+milter_manager_statistics_open (const gchar *path,
+                                guint64 rotate_size,
+                                guint worker_id,
+                                GError **error)
+{
+    Writer *new_writer;
+    struct stat status;
+    GError *thread_error = NULL;
+
+    new_writer = g_new0(Writer, 1);
+    new_writer->base_path = g_strdup(path);
+    if (worker_id > 0)
+        new_writer->path = g_strdup_printf("%s-%u", path, worker_id);
+    else
+        new_writer->path = g_strdup(path);
+    new_writer->rotate_size = rotate_size;
+
+    new_writer->output = fopen(new_writer->path, "a");
+    if (!new_writer->output) {
+        g_set_error(error,
+                    MILTER_MANAGER_STATISTICS_ERROR,
+                    MILTER_MANAGER_STATISTICS_ERROR_OPEN,
+                    "failed to open statistics file: <%s>: %s",
+                    new_writer->path, g_strerror(errno));
+        free_writer(new_writer);
+        return FALSE;
+    }
+    if (fstat(fileno(new_writer->output), &status) == 0)
+        new_writer->size = status.st_size;
+
+    new_writer->queue = g_async_queue_new();
+    new_writer->thread = g_thread_try_new("milter-manager-statistics",
+                                          writer_thread, new_writer,
+                                          &thread_error);
+    if (!new_writer->thread) {
+        g_set_error(error,
+                    MILTER_MANAGER_STATISTICS_ERROR,
+                    MILTER_MANAGER_STATISTICS_ERROR_OPEN,
+                    "failed to start statistics writer: <%s>: %s",
+                    new_writer->path, thread_error->message);
+        g_error_free(thread_error);
+        free_writer(new_writer);
+        return FALSE;
+    }
+
+    milter_manager_statistics_close();
+
+    G_LOCK(writer);
+    writer = new_writer;
+    current_worker_id = worker_id;
+    G_UNLOCK(writer);
+
+    milter_debug("[statistics][open] <%s>", new_writer->path);
+
+    return TRUE;
+}
+
+void
+milter_manager_statistics_close (void)
+{
+    Writer *current_writer;
+
+    G_LOCK(writer);
+    current_writer = writer;
+    writer = NULL;
+    G_UNLOCK(writer);
+
+    if (current_writer)
+        free_writer(current_writer);
+}
+
+gboolean
+milter_manager_statistics_is_opened (void)
+{
+    return writer != NULL;
+}
+
+void
+milter_manager_statistics_flush (void)
+{
+    gchar *path;
+    guint64 rotate_size;
+    guint worker_id;
+    GError *error = NULL;
+
+    G_LOCK(writer);
+    if (!writer) {
+        G_UNLOCK(writer);
+        return;
+    }
+    path = g_strdup(writer->base_path);
+    rotate_size = writer->rotate_size;
+    worker_id = current_worker_id;
+    G_UNLOCK(writer);
+
+    milter_manager_statistics_close();
+    if (!milter_manager_statistics_open(path, rotate_size, worker_id,
+                                        &error)) {
+        milter_warning("[statistics][flush][error] %s", error->message);
+        g_error_free(error);
+    }
+    g_free(path);
+}
+
+static void
+push_record (GString *record)
+{
+    g_string_append(record, "}\n");
+
+    G_LOCK(writer);
+    if (!writer) {
+        G_UNLOCK(writer);
+        g_string_free(record, TRUE);
+        return;
+    }
+    if (g_async_queue_length(writer->queue) >= MAX_PENDING_RECORDS) {
+        writer->n_dropped_records++;
+        G_UNLOCK(writer);
+        g_string_free(record, TRUE);
+        return;
+    }
+    g_async_queue_push(writer->queue, g_string_free(record, FALSE));
+    G_UNLOCK(writer);
+}
+
+static void
+append_json_string (GString *record, const gchar *string)
+{
+    const gchar *p;
+
+    if (!string) {
+        g_string_append(record, "null");
+        return;
+    }
+
+    g_string_append_c(record, '"');
+    for (p = string; *p; p++) {
+        switch (*p) {
+        case '"':
+            g_string_append(record, "\\\"");
+            break;
+        case '\\':
+            g_string_append(record, "\\\\");
+            break;
+        case '\n':
+            g_string_append(record, "\\n");
+            break;
+        case '\r':
+            g_string_append(record, "\\r");
+            break;
+        case '\t':
+            g_string_append(record, "\\t");
+            break;
+        default:
+            if ((guchar)*p < 0x20)
+                g_string_append_printf(record, "\\u%04x", (guchar)*p);
+            else
+                g_string_append_c(record, *p);
+            break;
+        }
+    }
+    g_string_append_c(record, '"');
+}
+
+static void
+append_json_double (GString *record, const gchar *format, gdouble value)
+{
+    gchar buffer[G_ASCII_DTOSTR_BUF_SIZE];
+
+    g_string_append(record, g_ascii_formatd(buffer, sizeof(buffer),
+                                            format, value));
+}
+
+static GString *
+start_record (const gchar *type, GTimeVal *time_value)
+{
+    GString *record;
+    GTimeVal current_time;
+
+    if (!time_value) {
+        g_get_current_time(&current_time);
+        time_value = &current_time;
+    }
+
+    record = g_string_new("{\"type\":");
+    append_json_string(record, type);
+    g_string_append(record, ",\"time\":");
+    append_json_double(record, "%.6f",
+                       time_value->tv_sec + time_value->tv_usec / 1000000.0);
+    g_string_append_printf(record, ",\"worker\":%u", current_worker_id);
+    return record;
+}
+
+void
+milter_manager_statistics_record_session (const gchar *state,
+                                          const gchar *status,
+                                          gdouble elapsed)
+{
+    GString *record;
+
+    if (!writer)
+        return;
+
+    record = start_record("session", NULL);
+    g_string_append(record, ",\"state\":");
+    append_json_string(record, state);
+    g_string_append(record, ",\"status\":");
+    append_json_string(record, status);
+    g_string_append(record, ",\"elapsed\":");
+    append_json_double(record, "%g", elapsed);
+    push_record(record);
+}
+
+void
+milter_manager_statistics_record_milter (const gchar *name,
+                                         const gchar *state,
+                                         const gchar *status,
+                                         gdouble elapsed)
+{
+    GString *record;
+
+    if (!writer)
+        return;
+
+    record = start_record("milter", NULL);
+    g_string_append(record, ",\"name\":");
+    append_json_string(record, name);
+    g_string_append(record, ",\"state\":");
+    append_json_string(record, state);
+    g_string_append(record, ",\"status\":");
+    append_json_string(record, status);
+    g_string_append(record, ",\"elapsed\":");
+    append_json_double(record, "%g", elapsed);
+    push_record(record);
+}
+
+void
+milter_manager_statistics_record_message (MilterMessageResult *result)
+{
+    GString *record;
+    gchar *state_name, *status_name;
+    MilterHeaders *added_headers, *removed_headers;
+
+    if (!writer)
+        return;
+
+    state_name =
+        milter_utils_get_enum_nick_name(MILTER_TYPE_STATE,
+                                        milter_message_result_get_state(result));
+    status_name =
+        milter_utils_get_enum_nick_name(MILTER_TYPE_STATUS,
+                                        milter_message_result_get_status(result));
+    added_headers = milter_message_result_get_added_headers(result);
+    removed_headers = milter_message_result_get_removed_headers(result);
+
+    record = start_record("message",
+                          milter_message_result_get_end_time(result));
+    g_string_append(record, ",\"state\":");
+    append_json_string(record, state_name);
+    g_string_append(record, ",\"status\":");
+    append_json_string(record, status_name);
+    g_string_append(record, ",\"elapsed\":");
+    append_json_double(record, "%g",
+                       milter_message_result_get_elapsed_time(result));
+    g_string_append(record, ",\"from\":");
+    append_json_string(record, milter_message_result_get_from(result));
+    g_string_append_printf(
+        record,
+        ",\"recipients\":%u"
+        ",\"rejected_recipients\":%u"
+        ",\"temporary_failed_recipients\":%u"
+        ",\"body_size\":%" G_GUINT64_FORMAT
+        ",\"added_headers\":%u"
+        ",\"removed_headers\":%u"
+        ",\"quarantine\":%s",
+        g_list_length(milter_message_result_get_recipients(result)),
+        g_list_length(milter_message_result_get_rejected_recipients(result)),
+        g_list_length(
+            milter_message_result_get_temporary_failed_recipients(result)),
+        milter_message_result_get_body_size(result),
+        added_headers ? milter_headers_length(added_headers) : 0,
+        removed_headers ? milter_headers_length(removed_headers) : 0,
+        milter_message_result_is_quarantine(result) ? "true" : "false");
+    push_record(record);
+
+    g_free(state_name);
+    g_free(status_name);
+}
+
+static void
+set_parse_error (GError **error, const gchar *line, const gchar *position,
+                 const gchar *reason)
+{
+    g_set_error(error,
+                MILTER_MANAGER_STATISTICS_ERROR,
+                MILTER_MANAGER_STATISTICS_ERROR_PARSE,
+                "invalid statistics record: %s: at %" G_GSIZE_FORMAT,
+                reason, (gsize)(position - line));
+}
+
+static void
+skip_spaces (gchar **cursor)
+{
+    while (**cursor == ' ' || **cursor == '\t' || **cursor == '\r')
+        (*cursor)++;
+}
+
+static gint
+parse_hex (const gchar *string)
+{
+    gint i, value = 0;
+
+    for (i = 0; i < 4; i++) {
+        if (!g_ascii_isxdigit(string[i]))
+            return -1;
+        value = value * 16 + g_ascii_xdigit_value(string[i]);
+    }
+    return value;
+}
+
+static gchar *
+parse_string (gchar **cursor)
+{
+    gchar *start, *read, *write;
+
+    start = write = read = *cursor + 1;
+    while (*read != '"') {
+        if (*read == '\0')
+            return NULL;
+        if (*read != '\\') {
+            *write++ = *read++;
+            continue;
+        }
+
+        read++;
+        switch (*read) {
+        case '"':
+        case '\\':
+        case '/':
+            *write++ = *read;
+            break;
+        case 'b':
+            *write++ = '\b';
+            break;
+        case 'f':
+            *write++ = '\f';
+            break;
+        case 'n':
+            *write++ = '\n';
+            break;
+        case 'r':
+            *write++ = '\r';
+            break;
+        case 't':
+            *write++ = '\t';
+            break;
+        case 'u':
+        {
+            gint code;
+
+            code = parse_hex(read + 1);
+            if (code < 0)
+                return NULL;
+            write += g_unichar_to_utf8(code, write);
+            read += 4;
+            break;
+        }
+        default:
+            return NULL;
+        }
+        read++;
+    }
+
+    *write = '\0';
+    *cursor = read + 1;
+    return start;
+}
+
+static gboolean
+parse_value (gchar **cursor, gchar **string, gdouble *number,
+             gboolean *boolean)
+{
+    gchar *end;
+
+    *string = NULL;
+    *number = 0.0;
+    *boolean = FALSE;
+
+    switch (**cursor) {
+    case '"':
+        *string = parse_string(cursor);
+        return *string != NULL;
+    case 't':
+        if (strncmp(*cursor, "true", 4) != 0)
+            return FALSE;
+        *boolean = TRUE;
+        *number = 1.0;
+        *cursor += 4;
+        return TRUE;
+    case 'f':
+        if (strncmp(*cursor, "false", 5) != 0)
+            return FALSE;
+        *cursor += 5;
+        return TRUE;
+    case 'n':
+        if (strncmp(*cursor, "null", 4) != 0)
+            return FALSE;
+        *cursor += 4;
+        return TRUE;
+    default:
+        *number = g_ascii_strtod(*cursor, &end);
+        if (end == *cursor)
+            return FALSE;
+        *cursor = end;
+        return TRUE;
+    }
+}
+
+static void
+set_record_value (MilterManagerStatisticsRecord *record,
+                  const gchar *key, gchar *string, gdouble number,
+                  gboolean boolean)
+{
+    switch (key[0]) {
+    case 'a':
+        if (strcmp(key, "added_headers") == 0)
+            record->n_added_headers = number;
+        break;
+    case 'b':
+        if (strcmp(key, "body_size") == 0)
+            record->body_size = number;
+        break;
+    case 'e':
+        if (strcmp(key, "elapsed") == 0)
+            record->elapsed = number;
+        break;
+    case 'f':
+        if (strcmp(key, "from") == 0)
+            record->from = string;
+        break;
+    case 'n':
+        if (strcmp(key, "name") == 0)
+            record->name = string;
+        break;
+    case 'q':
+        if (strcmp(key, "quarantine") == 0)
+            record->quarantine = boolean;
+        break;
+    case 'r':
+        if (strcmp(key, "recipients") == 0)
+            record->n_recipients = number;
+        else if (strcmp(key, "rejected_recipients") == 0)
+            record->n_rejected_recipients = number;
+        else if (strcmp(key, "removed_headers") == 0)
+            record->n_removed_headers = number;
+        break;
+    case 's':
+        if (strcmp(key, "state") == 0)
+            record->state = string;
+        else if (strcmp(key, "status") == 0)
+            record->status = string;
+        break;
+    case 't':
+        if (strcmp(key, "time") == 0) {
+            record->time = number;
+        } else if (strcmp(key, "type") == 0) {
+            if (!string)
+                break;
+            if (strcmp(string, "session") == 0)
+                record->type = MILTER_MANAGER_STATISTICS_RECORD_SESSION;
+            else if (strcmp(string, "milter") == 0)
+                record->type = MILTER_MANAGER_STATISTICS_RECORD_MILTER;
+            else if (strcmp(string, "message") == 0)
+                record->type = MILTER_MANAGER_STATISTICS_RECORD_MESSAGE;
+        } else if (strcmp(key, "temporary_failed_recipients") == 0) {
+            record->n_temporary_failed_recipients = number;
+        }
+        break;
+    case 'w':
+        if (strcmp(key, "worker") == 0)
+            record->worker = number;
+        break;
+    default:
+        break;
+    }
+}
+
+gboolean
+milter_manager_statistics_parse_record (gchar *line,
+                                        MilterManagerStatisticsRecord *record,
+                                        GError **error)
+{
+    gchar *cursor = line;
+
+    memset(record, 0, sizeof(*record));
+
+    skip_spaces(&cursor);
+    if (*cursor != '{') {
+        set_parse_error(error, line, cursor, "'{' is expected");
+        return FALSE;
+    }
+    cursor++;
+    skip_spaces(&cursor);
+    if (*cursor == '}')
+        return TRUE;
+
+    while (TRUE) {
+        gchar *key, *string;
+        gdouble number;
+        gboolean boolean;
+
+        if (*cursor != '"') {
+            set_parse_error(error, line, cursor, "key is expected");
+            return FALSE;
+        }
+        key = parse_string(&cursor);
+        if (!key) {
+            set_parse_error(error, line, cursor, "invalid key");
+            return FALSE;
+        }
+        skip_spaces(&cursor);
+        if (*cursor != ':') {
+            set_parse_error(error, line, cursor, "':' is expected");
+            return FALSE;
+        }
+        cursor++;
+        skip_spaces(&cursor);
+        if (!parse_value(&cursor, &string, &number, &boolean)) {
+            set_parse_error(error, line, cursor, "invalid value");
+            return FALSE;
+        }
+        set_record_value(record, key, string, number, boolean);
+
+        skip_spaces(&cursor);
+        if (*cursor == '}')
+            break;
+        if (*cursor != ',') {
+            set_parse_error(error, line, cursor, "',' or '}' is expected");
+            return FALSE;
+        }
+        cursor++;
+        skip_spaces(&cursor);
+    }
+
+    return TRUE;
+}
+
+gboolean
+milter_manager_statistics_read (const gchar *path,
+                                MilterManagerStatisticsReadFunc func,
+                                gpointer user_data,
+                                GError **error)
+{
+    FILE *input;
+    gchar *buffer;
+    gsize buffer_size = READ_BUFFER_SIZE;
+    gsize used = 0;
+    gsize n_read;
+    guint line_number = 0;
+    gboolean success = TRUE;
+    gboolean stopped = FALSE;
+
+    if (strcmp(path, "-") == 0) {
+        input = stdin;
+    } else {
+        input = fopen(path, "rb");
+        if (!input) {
+            g_set_error(error,
+                        MILTER_MANAGER_STATISTICS_ERROR,
+                        MILTER_MANAGER_STATISTICS_ERROR_READ,
+                        "failed to open statistics file: <%s>: %s",
+                        path, g_strerror(errno));
+            return FALSE;
+        }
+    }
+
+    buffer = g_malloc(buffer_size);
+    while (!stopped &&
+           (n_read = fread(buffer + used, 1, buffer_size - used, input)) > 0) {
+        gchar *start, *end, *newline;
+
+        used += n_read;
+        start = buffer;
+        end = buffer + used;
+        while (!stopped && (newline = memchr(start, '\n', end - start))) {
+            MilterManagerStatisticsRecord record;
+            GError *parse_error = NULL;
+
+            *newline = '\0';
+            line_number++;
+            if (start != newline) {
+                if (!milter_manager_statistics_parse_record(start, &record,
+                                                            &parse_error)) {
+                    g_set_error(error,
+                                MILTER_MANAGER_STATISTICS_ERROR,
+                                MILTER_MANAGER_STATISTICS_ERROR_PARSE,
+                                "<%s>:%u: %s",
+                                path, line_number, parse_error->message);
+                    g_error_free(parse_error);
+                    success = FALSE;
+                    stopped = TRUE;
+                } else if (!func(&record, user_data)) {
+                    stopped = TRUE;
+                }
+            }
+            start = newline + 1;
+        }
+
+        /* An unterminated last line may be being written. */
+        used = end - start;
+        memmove(buffer, start, used);
+        if (used == buffer_size) {
+            buffer_size *= 2;
+            buffer = g_realloc(buffer, buffer_size);
+        }
+    }
+
+    if (success && ferror(input)) {
+        g_set_error(error,
+                    MILTER_MANAGER_STATISTICS_ERROR,
+                    MILTER_MANAGER_STATISTICS_ERROR_READ,
+                    "failed to read statistics file: <%s>: %s",
+                    path, g_strerror(errno));
+        success = FALSE;
+    }
+
+    g_free(buffer);
+    if (input != stdin)
+        fclose(input);
+
+    return success;
+}
+
+/*
+vi:ts=4:nowrap:ai:expandtab:sw=4
+*/
@@ -0,0 +1,108 @@
+/* -*- Mode: C; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+/*
+ *  Copyright (C) 2026  Kouhei Sutou <kou@clear-code.com>
+ *
+ *  This library is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with this library.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef __MILTER_MANAGER_STATISTICS_H__
+#define __MILTER_MANAGER_STATISTICS_H__
+
+#include <glib-object.h>
+
+#include <milter/core.h>
+
+G_BEGIN_DECLS
+
+#define MILTER_MANAGER_STATISTICS_ERROR           (milter_manager_statistics_error_quark())
+
+typedef enum
+{
+    MILTER_MANAGER_STATISTICS_ERROR_OPEN,
+    MILTER_MANAGER_STATISTICS_ERROR_READ,
+    MILTER_MANAGER_STATISTICS_ERROR_PARSE
+} MilterManagerStatisticsError;
+
+typedef enum
+{
+    MILTER_MANAGER_STATISTICS_RECORD_UNKNOWN,
+    MILTER_MANAGER_STATISTICS_RECORD_SESSION,
+    MILTER_MANAGER_STATISTICS_RECORD_MILTER,
+    MILTER_MANAGER_STATISTICS_RECORD_MESSAGE
+} MilterManagerStatisticsRecordType;
+
+typedef struct _MilterManagerStatisticsRecord MilterManagerStatisticsRecord;
+struct _MilterManagerStatisticsRecord
+{
+    MilterManagerStatisticsRecordType type;
+    gdouble time;
+    guint worker;
+    const gchar *name;
+    const gchar *state;
+    const gchar *status;
+    gdouble elapsed;
+    const gchar *from;
+    guint n_recipients;
+    guint n_rejected_recipients;
+    guint n_temporary_failed_recipients;
+    guint64 body_size;
+    guint n_added_headers;
+    guint n_removed_headers;
+    gboolean quarantine;
+};
+
+typedef gboolean (*MilterManagerStatisticsReadFunc)
+                                     (const MilterManagerStatisticsRecord *record,
+                                      gpointer user_data);
+
+GQuark       milter_manager_statistics_error_quark (void);
+
+gboolean     milter_manager_statistics_open   (const gchar *path,
+                                               guint64 rotate_size,
+                                               guint worker_id,
+                                               GError **error);
+void         milter_manager_statistics_close  (void);
+gboolean     milter_manager_statistics_is_opened
+                                              (void);
+void         milter_manager_statistics_flush  (void);
+
+void         milter_manager_statistics_record_session
+                                              (const gchar *state,
+                                               const gchar *status,
+                                               gdouble elapsed);
+void         milter_manager_statistics_record_milter
+                                              (const gchar *name,
+                                               const gchar *state,
+                                               const gchar *status,
+                                               gdouble elapsed);
+void         milter_manager_statistics_record_message
+                                              (MilterMessageResult *result);
+
+gboolean     milter_manager_statistics_parse_record
+                                              (gchar *line,
+                                               MilterManagerStatisticsRecord *record,
+                                               GError **error);
+gboolean     milter_manager_statistics_read   (const gchar *path,
+                                               MilterManagerStatisticsReadFunc func,
+                                               gpointer user_data,
+                                               GError **error);
+
+G_END_DECLS
+
+#endif /* __MILTER_MANAGER_STATISTICS_H__ */
+
+/*
+vi:ts=4:nowrap:ai:expandtab:sw=4
+*/
@@ -31,25 +31,46 @@
 
 #include "milter-manager.h"
 #include "milter-manager-leader.h"
+#include "milter-manager-connection-check-scheduler.h"
+#include "milter-manager-metrics.h"
+#include "milter-manager-statistics.h"
 
 #define MILTER_MANAGER_GET_PRIVATE(obj)                 \
     (G_TYPE_INSTANCE_GET_PRIVATE((obj),                 \
                                  MILTER_TYPE_MANAGER,   \
                                  MilterManagerPrivate))
 
+#define CONNECTION_CHECK_TICK 1.0
+
+typedef struct _LeaderEntry LeaderEntry;
+struct _LeaderEntry
+{
+    /* link must be the first member: a node in the leaders
+     * queue is cast back to its LeaderEntry. */
+    GList link;
+    MilterManagerConnectionCheckEntry *check_entry;
+    MilterManager *manager;
+    MilterClientContext *client_context;
+    gboolean registered;
+    gboolean finished;
+    gboolean on_loop_thread;
+};
+
 typedef struct _MilterManagerPrivate MilterManagerPrivate;
 struct _MilterManagerPrivate
 {
     MilterManagerConfiguration *configuration;
-    GList *leaders;
-    GList *next_connection_checked_leader;
-    gboolean connection_checking;
+    GQueue leaders;
+    MilterManagerConnectionCheckScheduler *connection_check_scheduler;
+    LeaderEntry *checking_leader_entry;
 
     GIOChannel *launcher_read_channel;
     GIOChannel *launcher_write_channel;
 
     guint periodical_connection_checker_id;
     guint current_periodical_connection_check_interval;
+    MilterManagerConnectionChecker *connection_checker;
+    gboolean connection_checker_unavailable;
 
     GList *finished_leaders;
 
@@ -215,15 +236,17 @@ milter_manager_init (MilterManager *manager)
     priv = MILTER_MANAGER_GET_PRIVATE(manager);
 
     priv->configuration = NULL;
-    priv->leaders = NULL;
-    priv->next_connection_checked_leader = NULL;
-    priv->connection_checking = FALSE;
+    g_queue_init(&(priv->leaders));
+    priv->connection_check_scheduler = NULL;
+    priv->checking_leader_entry = NULL;
 
     priv->launcher_read_channel = NULL;
     priv->launcher_write_channel = NULL;
 
     priv->periodical_connection_checker_id = 0;
     priv->current_periodical_connection_check_interval = 0;
+    priv->connection_checker = NULL;
+    priv->connection_checker_unavailable = FALSE;
 
     priv->finished_leaders = NULL;
 }
@@ -252,6 +275,25 @@ dispose_periodical_connection_checker (MilterManager *manager)
     priv->periodical_connection_checker_id = 0;
 }
 
+static gboolean
+is_event_loop_threads_mode (MilterManager *manager)
+{
+    MilterClient *client;
+
+    client = MILTER_CLIENT(manager);
+    return milter_client_get_n_event_loop_threads(client) > 0 &&
+        milter_client_get_n_workers(client) == 0;
+}
+
+static gboolean
+cb_idle_dispose_leader (gpointer user_data)
+{
+    MilterManagerLeader *leader = user_data;
+
+    g_object_unref(leader);
+    return FALSE;
+}
+
 static void
 dispose_finished_leaders (MilterManagerPrivate *priv)
 {
@@ -272,6 +314,25 @@ dispose_finished_leaders (MilterManagerPrivate *priv)
     milter_debug("[manager][dispose][leaders] %u", n_leaders);
 }
 
+static void
+clear_leaders (MilterManagerPrivate *priv)
+{
+    GList *node;
+
+    for (node = priv->leaders.head; node; node = g_list_next(node)) {
+        LeaderEntry *entry = (LeaderEntry *)node;
+
+        entry->registered = FALSE;
+        entry->check_entry = NULL;
+    }
+    g_queue_init(&(priv->leaders));
+    if (priv->connection_check_scheduler) {
+        milter_manager_connection_check_scheduler_free(
+            priv->connection_check_scheduler);
+        priv->connection_check_scheduler = NULL;
+    }
+}
+
 static void
 dispose (GObject *object)
 {
@@ -284,17 +345,18 @@ dispose (GObject *object)
     dispose_periodical_connection_checker(manager);
     dispose_finished_leaders(priv);
 
+    if (priv->connection_checker) {
+        milter_manager_connection_checker_unref(priv->connection_checker);
+        priv->connection_checker = NULL;
+    }
+
     if (priv->configuration) {
         configuration_set_manager(priv->configuration, NULL);
         g_object_unref(priv->configuration);
         priv->configuration = NULL;
     }
 
-    if (priv->leaders) {
-        g_list_free(priv->leaders);
-        priv->leaders = NULL;
-    }
-    priv->next_connection_checked_leader = NULL;
+    clear_leaders(priv);
 
     milter_manager_set_launcher_channel(MILTER_MANAGER(object), NULL, NULL);
 
@@ -360,37 +422,104 @@ milter_manager_new (MilterManagerConfiguration *configuration)
                         NULL);
 }
 
+static void
+unregister_leader (MilterManagerPrivate *priv, LeaderEntry *entry)
+{
+    if (entry->check_entry) {
+        milter_manager_connection_check_scheduler_remove(
+            priv->connection_check_scheduler, entry->check_entry);
+        entry->check_entry = NULL;
+    }
+    if (entry->registered) {
+        g_queue_unlink(&(priv->leaders), &(entry->link));
+        entry->registered = FALSE;
+    }
+}
+
+static void
+cb_connection_check_prepare (gpointer user_data)
+{
+    MilterManagerPrivate *priv = user_data;
+    GError *error = NULL;
+
+    /* One kernel query serves all leaders checked in this round. */
+    if (!priv->connection_checker)
+        return;
+
+    if (!milter_manager_connection_checker_update(priv->connection_checker,
+                                                  &error)) {
+        milter_error("[manager][connection-check][native][error] %s",
+                     error->message);
+        g_error_free(error);
+        milter_manager_connection_checker_unref(priv->connection_checker);
+        priv->connection_checker = NULL;
+        priv->connection_checker_unavailable = TRUE;
+    }
+}
+
+static gboolean
+cb_connection_check_is_waiting (gpointer data, gpointer user_data)
+{
+    LeaderEntry *entry = data;
+
+    return milter_manager_leader_is_waiting_reply(entry->link.data);
+}
+
+static void
+cb_connection_check (gpointer data, gpointer user_data)
+{
+    LeaderEntry *entry = data;
+    MilterManagerPrivate *priv = user_data;
+    gboolean connected;
+
+    priv->checking_leader_entry = entry;
+    connected = milter_manager_leader_check_connection(entry->link.data);
+    priv->checking_leader_entry = NULL;
+
+    if (entry->finished)
+        g_free(entry);
+    else if (!connected)
+        unregister_leader(priv, entry);
+}
+
+static const MilterManagerConnectionCheckSchedulerFuncs connection_check_funcs = {
+    cb_connection_check_prepare,
+    cb_connection_check_is_waiting,
+    cb_connection_check
+};
+
 static gboolean
 connection_check (gpointer data)
 {
     MilterManager *manager = data;
     MilterManagerPrivate *priv;
-    GList *node, *next_node;
-    guint i;
-    guint n_leaders_per_connection_check = 30; /* FIXME: make customizable */
+    guint interval, budget;
 
     priv = MILTER_MANAGER_GET_PRIVATE(manager);
 
-    priv->connection_checking = TRUE;
-
-    if (!priv->next_connection_checked_leader)
-        priv->next_connection_checked_leader = priv->leaders;
-    node = priv->next_connection_checked_leader;
-    i = 0;
-    while (node && i < n_leaders_per_connection_check) {
-        MilterManagerLeader *leader = node->data;
-        next_node = g_list_next(node);
-        if (!milter_manager_leader_check_connection(leader)) {
-            priv->leaders = g_list_delete_link(priv->leaders, node);
-        }
-        node = next_node;
-        i++;
+    interval =
+        milter_manager_configuration_get_connection_check_interval(
+            priv->configuration);
+    budget =
+        milter_manager_configuration_get_connection_check_budget(
+            priv->configuration);
+    if (!milter_manager_connection_check_scheduler_run(
+            priv->connection_check_scheduler, interval, budget)) {
+        milter_debug("[manager][connection-check][budget] "
+                     "<%u>ms: <%u> tick(s) behind",
+                     budget,
+                     milter_manager_connection_check_scheduler_get_n_behind_ticks(
+                         priv->connection_check_scheduler));
     }
-    priv->next_connection_checked_leader = node;
 
-    priv->connection_checking = FALSE;
+    if (g_queue_is_empty(&(priv->leaders))) {
+        milter_debug("[manager][connection-check][stop] no leaders");
+        priv->periodical_connection_checker_id = 0;
+        priv->current_periodical_connection_check_interval = 0;
+        return FALSE;
+    }
 
-    return priv->leaders != NULL;
+    return TRUE;
 }
 
 static void
@@ -416,7 +545,7 @@ start_periodical_connection_checker (MilterManager *manager)
             priv->current_periodical_connection_check_interval = interval;
             loop = milter_client_get_event_loop(MILTER_CLIENT(manager));
             priv->periodical_connection_checker_id =
-                milter_event_loop_add_timeout(loop, interval,
+                milter_event_loop_add_timeout(loop, CONNECTION_CHECK_TICK,
                                               connection_check, manager);
         }
     } else {
@@ -634,13 +763,22 @@ cb_client_timeout (MilterClientContext *context, gpointer user_data)
     milter_manager_leader_timeout(leader);
 }
 
+static void
+cb_client_message_processed (MilterClientContext *context,
+                             MilterMessageResult *result,
+                             gpointer user_data)
+{
+    milter_manager_statistics_record_message(result);
+}
+
 static void
 cb_client_finished (MilterClientContext *context, gpointer user_data)
 {
     MilterManagerLeader *leader = user_data;
 
     if (milter_need_log(MILTER_LOG_LEVEL_DEBUG |
-                        MILTER_LOG_LEVEL_STATISTICS)) {
+                        MILTER_LOG_LEVEL_STATISTICS) ||
+        milter_manager_statistics_is_opened()) {
         MilterAgent *agent;
         guint tag;
         gdouble elapsed;
@@ -666,7 +804,8 @@ cb_client_finished (MilterClientContext *context, gpointer user_data)
             g_free(state_name);
         }
 
-        if (milter_need_statistics_log()) {
+        if (milter_need_statistics_log() ||
+            milter_manager_statistics_is_opened()) {
             MilterClientContextState last_state;
             gchar *last_state_name;
 
@@ -682,6 +821,9 @@ cb_client_finished (MilterClientContext *context, gpointer user_data)
             milter_statistics("[session][end][%s][%s][%g](%u)",
                               last_state_name, statistics_status_name,
                               elapsed, tag);
+            milter_manager_statistics_record_session(last_state_name,
+                                                     statistics_status_name,
+                                                     elapsed);
             g_free(last_state_name);
         }
         g_free(status_name);
@@ -690,16 +832,10 @@ cb_client_finished (MilterClientContext *context, gpointer user_data)
     milter_manager_leader_quit(leader);
 }
 
-typedef struct _LeaderFinishData
-{
-    MilterManager *manager;
-    MilterClientContext *client_context;
-} LeaderFinishData;
-
 static void
 teardown_client_context_signals (MilterClientContext *context,
                                  MilterManagerLeader *leader,
-                                 LeaderFinishData *finished_data)
+                                 LeaderEntry *entry)
 {
 #define DISCONNECT(name)                                                \
     g_signal_handlers_disconnect_by_func(context,                       \
@@ -726,40 +862,50 @@ teardown_client_context_signals (MilterClientContext *context,
 #undef DISCONNECT
     g_signal_handlers_disconnect_by_func(leader,
                                          G_CALLBACK(cb_leader_finished),
-                                         finished_data);
+                                         entry);
 }
 
 static void
 cb_leader_finished (MilterFinishedEmittable *emittable, gpointer user_data)
 {
-    LeaderFinishData *finish_data = user_data;
+    LeaderEntry *entry = user_data;
     MilterClientContext *client_context;
     MilterManagerLeader *leader;
     MilterManagerPrivate *priv;
 
-    client_context = finish_data->client_context;
+    client_context = entry->client_context;
 
     leader = MILTER_MANAGER_LEADER(emittable);
-    teardown_client_context_signals(client_context, leader, finish_data);
-
-    priv = MILTER_MANAGER_GET_PRIVATE(finish_data->manager);
-    if (!priv->connection_checking) {
-        GList *node;
-        node = g_list_find(priv->leaders, leader);
-        if (node) {
-            if (priv->next_connection_checked_leader == node)
-                priv->next_connection_checked_leader = g_list_next(node);
-            priv->leaders = g_list_delete_link(priv->leaders, node);
-        }
-        if (!priv->leaders) {
-            milter_debug("[manager][connection-check][dispose] no leaders");
-            dispose_periodical_connection_checker(finish_data->manager);
-        }
+    teardown_client_context_signals(client_context, leader, entry);
+    milter_manager_metrics_session_finished(
+        milter_client_context_get_status(client_context));
+
+    if (entry->on_loop_thread) {
+        MilterEventLoop *loop;
+
+        loop = milter_agent_get_event_loop(MILTER_AGENT(client_context));
+        milter_event_loop_add_idle_full(loop,
+                                        G_PRIORITY_DEFAULT,
+                                        cb_idle_dispose_leader,
+                                        leader,
+                                        NULL);
+        g_free(entry);
+        return;
+    }
+
+    priv = MILTER_MANAGER_GET_PRIVATE(entry->manager);
+    unregister_leader(priv, entry);
+    if (g_queue_is_empty(&(priv->leaders)) && !priv->checking_leader_entry) {
+        milter_debug("[manager][connection-check][dispose] no leaders");
+        dispose_periodical_connection_checker(entry->manager);
     }
 
     priv->finished_leaders = g_list_prepend(priv->finished_leaders, leader);
 
-    g_free(finish_data);
+    if (priv->checking_leader_entry == entry)
+        entry->finished = TRUE;
+    else
+        g_free(entry);
 }
 
 static void
@@ -768,12 +914,29 @@ setup_context_signals (MilterClientContext *context,
 {
     MilterManagerLeader *leader;
     MilterManagerPrivate *priv;
-    LeaderFinishData *finish_data;
+    LeaderEntry *entry;
 
     priv = MILTER_MANAGER_GET_PRIVATE(manager);
 
     leader = milter_manager_leader_new(priv->configuration, context);
-    priv->leaders = g_list_prepend(priv->leaders, leader);
+    entry = g_new0(LeaderEntry, 1);
+    entry->link.data = leader;
+    entry->manager = manager;
+    entry->client_context = context;
+    /* Sessions on event loop threads don't share the leader queue,
+     * the connection checker and the launcher with the main loop. */
+    entry->on_loop_thread = is_event_loop_threads_mode(manager);
+    if (!entry->on_loop_thread) {
+        entry->registered = TRUE;
+        g_queue_push_head_link(&(priv->leaders), &(entry->link));
+        if (!priv->connection_check_scheduler)
+            priv->connection_check_scheduler =
+                milter_manager_connection_check_scheduler_new(
+                    &connection_check_funcs, priv);
+        entry->check_entry =
+            milter_manager_connection_check_scheduler_add(
+                priv->connection_check_scheduler, entry);
+    }
 
 #define CONNECT(name)                                   \
     g_signal_connect(context, #name,                    \
@@ -794,19 +957,29 @@ setup_context_signals (MilterClientContext *context,
     CONNECT(abort);
     CONNECT(define_macro);
     CONNECT(timeout);
+    if (milter_manager_statistics_is_opened())
+        CONNECT(message_processed);
 
     CONNECT(finished);
 
 #undef CONNECT
 
-    finish_data = g_new(LeaderFinishData, 1);
-    finish_data->manager = manager;
-    finish_data->client_context = context;
     g_signal_connect(leader, "finished",
-                     G_CALLBACK(cb_leader_finished), finish_data);
-    milter_manager_leader_set_launcher_channel(leader,
-                                               priv->launcher_read_channel,
-                                               priv->launcher_write_channel);
+                     G_CALLBACK(cb_leader_finished), entry);
+    if (!entry->on_loop_thread) {
+        milter_manager_leader_set_launcher_channel(leader,
+                                                   priv->launcher_read_channel,
+                                                   priv->launcher_write_channel);
+        if (!priv->connection_checker_unavailable &&
+            milter_manager_configuration_get_use_native_connection_checker(
+                priv->configuration)) {
+            if (!priv->connection_checker)
+                priv->connection_checker =
+                    milter_manager_connection_checker_new();
+            milter_manager_leader_set_connection_checker(
+                leader, priv->connection_checker);
+        }
+    }
 
     g_signal_emit_by_name(priv->configuration, "connected", leader);
 }
@@ -818,11 +991,13 @@ connection_established (MilterClient *client, MilterClientContext *context)
 
     manager = MILTER_MANAGER(client);
     setup_context_signals(context, MILTER_MANAGER(client));
+    milter_manager_metrics_session_started();
 
     milter_debug("[%u] [manager][session][start]",
                  milter_agent_get_tag(MILTER_AGENT(context)));
 
-    start_periodical_connection_checker(manager);
+    if (!is_event_loop_threads_mode(manager))
+        start_periodical_connection_checker(manager);
 }
 
 static const gchar *
@@ -1404,7 +1579,30 @@ workers_created (MilterClient *client, guint n_workers)
 static void
 worker_created (MilterClient *client)
 {
+    MilterManagerConfiguration *configuration;
+    const gchar *statistics_path;
+    guint worker_id;
+
     milter_debug("[manager][worker-created] pid=<%d>", getpid());
+    worker_id = milter_client_get_worker_id(client);
+    milter_manager_metrics_set_worker_id(worker_id);
+
+    configuration = MILTER_MANAGER_GET_PRIVATE(client)->configuration;
+    statistics_path =
+        milter_manager_configuration_get_statistics_path(configuration);
+    if (statistics_path) {
+        GError *error = NULL;
+        guint64 rotate_size;
+
+        rotate_size =
+            milter_manager_configuration_get_statistics_rotate_size(configuration);
+        if (!milter_manager_statistics_open(statistics_path, rotate_size,
+                                            worker_id, &error)) {
+            milter_error("[manager][worker-created][statistics][error] %s",
+                         error->message);
+            g_error_free(error);
+        }
+    }
 }
 
 MilterManagerConfiguration *
@@ -1416,7 +1614,7 @@ milter_manager_get_configuration (MilterManager *manager)
 const GList *
 milter_manager_get_leaders (MilterManager *manager)
 {
-    return MILTER_MANAGER_GET_PRIVATE(manager)->leaders;
+    return MILTER_MANAGER_GET_PRIVATE(manager)->leaders.head;
 }
 
 static void
@@ -66,6 +66,14 @@ enum
 
 static gint signals[LAST_SIGNAL] = {0};
 
+typedef enum {
+    TIMEOUT_NONE,
+    TIMEOUT_CONNECTION,
+    TIMEOUT_WRITING,
+    TIMEOUT_READING,
+    TIMEOUT_END_OF_MESSAGE
+} TimeoutType;
+
 static gboolean    stop_on_accumulator(GSignalInvocationHint *hint,
                                        GValue *return_accumulator,
                                        const GValue *context_return,
@@ -97,7 +105,11 @@ struct _MilterServerContextPrivate
     gdouble writing_timeout;
     gdouble reading_timeout;
     gdouble end_of_message_timeout;
-    guint timeout_id;
+    gboolean direct_write;
+    MilterServerContextStopChecker stop_checker;
+    gpointer stop_checker_user_data;
+    MilterEventLoopTimeout *timeout;
+    TimeoutType timeout_type;
     guint connect_watch_id;
 
     gboolean skip_body;
@@ -109,6 +121,7 @@ struct _MilterServerContextPrivate
     gboolean sent_end_of_message;
 
     GTimer *elapsed;
+    GTimer *reply_elapsed;
 
     gboolean negotiated;
     gboolean processing_message;
@@ -117,6 +130,9 @@ struct _MilterServerContextPrivate
     gchar *current_recipient;
 
     MilterMessageResult *message_result;
+
+    const MilterReplyHandlers *reply_handlers;
+    gpointer reply_handlers_data;
 };
 
 enum
@@ -170,6 +186,7 @@ static gboolean write_packet         (MilterServerContext      *context,
                                       const gchar              *packet,
                                       gsize                     packet_size,
                                       MilterServerContextState  next_state);
+static gboolean cb_connection_timeout(gpointer data);
 
 static MilterDecoder *decoder_new    (MilterAgent *agent);
 static MilterEncoder *encoder_new    (MilterAgent *agent);
@@ -473,12 +490,16 @@ milter_server_context_init (MilterServerContext *context)
     priv->process_body_count = 0;
     priv->sent_end_of_message = FALSE;
 
-    priv->timeout_id = 0;
+    priv->timeout = NULL;
+    priv->timeout_type = TIMEOUT_NONE;
     priv->connection_timeout = MILTER_SERVER_CONTEXT_DEFAULT_CONNECTION_TIMEOUT;
     priv->writing_timeout = MILTER_SERVER_CONTEXT_DEFAULT_WRITING_TIMEOUT;
     priv->reading_timeout = MILTER_SERVER_CONTEXT_DEFAULT_READING_TIMEOUT;
     priv->end_of_message_timeout =
         MILTER_SERVER_CONTEXT_DEFAULT_END_OF_MESSAGE_TIMEOUT;
+    priv->direct_write = FALSE;
+    priv->stop_checker = NULL;
+    priv->stop_checker_user_data = NULL;
 
     priv->skip_body = FALSE;
     priv->body = g_string_new(NULL);
@@ -486,6 +507,9 @@ milter_server_context_init (MilterServerContext *context)
     priv->elapsed = g_timer_new();
     g_timer_stop(priv->elapsed);
     g_timer_reset(priv->elapsed);
+    priv->reply_elapsed = g_timer_new();
+    g_timer_stop(priv->reply_elapsed);
+    g_timer_reset(priv->reply_elapsed);
 
     priv->negotiated = FALSE;
     priv->processing_message = FALSE;
@@ -494,6 +518,9 @@ milter_server_context_init (MilterServerContext *context)
     priv->current_recipient = NULL;
 
     priv->message_result = NULL;
+
+    priv->reply_handlers = NULL;
+    priv->reply_handlers_data = NULL;
 }
 
 static void
@@ -506,18 +533,14 @@ disable_timeout (MilterServerContext *context)
         const gchar *name;
 
         name = milter_server_context_get_name(context);
-        milter_debug("[%u] [server][timeout][disable] [%s] [%u] (%p)",
+        milter_debug("[%u] [server][timeout][disable] [%s] (%p)",
                      milter_agent_get_tag(MILTER_AGENT(context)),
                      NULL_SAFE_NAME(name),
-                     priv->timeout_id,
                      context);
     }
-    if (priv->timeout_id > 0) {
-        MilterEventLoop *loop;
-        loop = milter_agent_get_event_loop(MILTER_AGENT(context));
-        milter_event_loop_remove(loop, priv->timeout_id);
-        priv->timeout_id = 0;
-    }
+    if (priv->timeout)
+        milter_event_loop_timeout_stop(priv->timeout);
+    priv->timeout_type = TIMEOUT_NONE;
 }
 
 static void
@@ -613,6 +636,10 @@ dispose (GObject *object)
                  context);
 
     disable_timeout(context);
+    if (priv->timeout) {
+        milter_event_loop_timeout_free(priv->timeout);
+        priv->timeout = NULL;
+    }
     dispose_connect_watch(context);
     dispose_client_channel(priv);
 
@@ -660,6 +687,11 @@ dispose (GObject *object)
         priv->elapsed = NULL;
     }
 
+    if (priv->reply_elapsed) {
+        g_timer_destroy(priv->reply_elapsed);
+        priv->reply_elapsed = NULL;
+    }
+
     if (priv->current_recipient) {
         g_free(priv->current_recipient);
         priv->current_recipient = NULL;
@@ -894,10 +926,9 @@ cb_writing_timeout (gpointer data)
         priv = MILTER_SERVER_CONTEXT_GET_PRIVATE(context);
         if (priv)
             name = milter_server_context_get_name(context);
-        milter_debug("[%u] [server][timeout][writing] [%s] [%u] (%p)",
+        milter_debug("[%u] [server][timeout][writing] [%s] (%p)",
                      priv ? milter_agent_get_tag(agent) : 0,
                      NULL_SAFE_NAME(name),
-                     priv ? priv->timeout_id : 0,
                      context);
     }
     g_signal_emit(context, signals[WRITING_TIMEOUT], 0);
@@ -920,10 +951,9 @@ cb_end_of_message_timeout (gpointer data)
         priv = MILTER_SERVER_CONTEXT_GET_PRIVATE(context);
         if (priv)
             name = milter_server_context_get_name(context);
-        milter_debug("[%u] [server][timeout][end-of-message] [%s] [%u] (%p)",
+        milter_debug("[%u] [server][timeout][end-of-message] [%s] (%p)",
                      priv ? milter_agent_get_tag(agent) : 0,
                      NULL_SAFE_NAME(name),
-                     priv ? priv->timeout_id : 0,
                      context);
     }
     g_signal_emit(context, signals[END_OF_MESSAGE_TIMEOUT], 0);
@@ -946,10 +976,9 @@ cb_reading_timeout (gpointer data)
         priv = MILTER_SERVER_CONTEXT_GET_PRIVATE(context);
         if (priv)
             name = milter_server_context_get_name(context);
-        milter_debug("[%u] [server][timeout][reading] [%s] [%u] (%p)",
+        milter_debug("[%u] [server][timeout][reading] [%s] (%p)",
                      priv ? milter_agent_get_tag(agent) : 0,
                      NULL_SAFE_NAME(name),
-                     priv ? priv->timeout_id : 0,
                      context);
     }
     g_signal_emit(context, signals[READING_TIMEOUT], 0);
@@ -958,6 +987,50 @@ cb_reading_timeout (gpointer data)
     return FALSE;
 }
 
+static gboolean
+cb_timeout (gpointer data)
+{
+    MilterServerContext *context = data;
+    MilterServerContextPrivate *priv;
+
+    priv = MILTER_SERVER_CONTEXT_GET_PRIVATE(context);
+    switch (priv->timeout_type) {
+    case TIMEOUT_CONNECTION:
+        return cb_connection_timeout(data);
+    case TIMEOUT_WRITING:
+        return cb_writing_timeout(data);
+    case TIMEOUT_READING:
+        return cb_reading_timeout(data);
+    case TIMEOUT_END_OF_MESSAGE:
+        return cb_end_of_message_timeout(data);
+    default:
+        break;
+    }
+
+    return FALSE;
+}
+
+static void
+start_timeout (MilterServerContext *context, TimeoutType type, gdouble interval)
+{
+    MilterServerContextPrivate *priv;
+    MilterEventLoop *loop;
+
+    priv = MILTER_SERVER_CONTEXT_GET_PRIVATE(context);
+    loop = milter_agent_get_event_loop(MILTER_AGENT(context));
+    /* The handle is reused for every state so that re-arming on each
+     * command doesn't allocate anything. */
+    if (priv->timeout &&
+        milter_event_loop_timeout_get_loop(priv->timeout) != loop) {
+        milter_event_loop_timeout_free(priv->timeout);
+        priv->timeout = NULL;
+    }
+    if (!priv->timeout)
+        priv->timeout = milter_event_loop_timeout_new(loop, cb_timeout, context);
+    priv->timeout_type = type;
+    milter_event_loop_timeout_start(priv->timeout, interval);
+}
+
 gboolean
 milter_server_context_is_processing (MilterServerContext *context)
 {
@@ -965,7 +1038,7 @@ milter_server_context_is_processing (MilterServerContext *context)
 
     priv = MILTER_SERVER_CONTEXT_GET_PRIVATE(context);
 
-    return priv->timeout_id != 0;
+    return priv->timeout_type != TIMEOUT_NONE;
 }
 
 static GHashTable *
@@ -979,7 +1052,9 @@ filter_macros (GHashTable *macros, GList *request_symbols)
 
     for (symbol = request_symbols; symbol; symbol = g_list_next(symbol)) {
         const gchar *value;
-        value = g_hash_table_lookup(macros, symbol->data);
+        value = g_hash_table_lookup(macros,
+                                    milter_utils_intern_macro_name(symbol->data,
+                                                                   -1));
         if (value) {
             g_hash_table_insert(filtered_macros,
                                 g_strdup(symbol->data),
@@ -1154,29 +1229,23 @@ static void
 reset_end_of_message_timeout (MilterServerContext *context)
 {
     MilterAgent *agent;
-    MilterEventLoop *loop;
     MilterServerContextPrivate *priv;
 
     disable_timeout(context);
 
     priv = MILTER_SERVER_CONTEXT_GET_PRIVATE(context);
     agent = MILTER_AGENT(context);
-    loop = milter_agent_get_event_loop(agent);
-    priv->timeout_id =
-        milter_event_loop_add_timeout(loop,
-                                      priv->end_of_message_timeout,
-                                      cb_end_of_message_timeout,
-                                      context);
+    start_timeout(context, TIMEOUT_END_OF_MESSAGE,
+                  priv->end_of_message_timeout);
     if (milter_need_debug_log()) {
         const gchar *name;
 
         name = milter_server_context_get_name(context);
         milter_debug("[%u] [server][timeout][end-of-message][registered][%g] "
-                     "[%s] <%u> (%p)",
+                     "[%s] (%p)",
                      milter_agent_get_tag(agent),
                      priv->end_of_message_timeout,
                      NULL_SAFE_NAME(name),
-                     priv->timeout_id,
                      context);
     }
 }
@@ -1263,7 +1332,6 @@ process_next_state_body (MilterServerContext *context)
     guint tag = 0;
     const gchar *name = NULL;
     MilterServerContextState state = MILTER_SERVER_CONTEXT_STATE_BODY;
-    MilterEventLoop *loop;
 
     priv = MILTER_SERVER_CONTEXT_GET_PRIVATE(context);
 
@@ -1282,18 +1350,12 @@ process_next_state_body (MilterServerContext *context)
         return flush_body(context);
 
     disable_timeout(context);
-    loop = milter_agent_get_event_loop(MILTER_AGENT(context));
-    priv->timeout_id =
-        milter_event_loop_add_timeout(loop,
-                                      priv->reading_timeout,
-                                      cb_reading_timeout,
-                                      context);
+    start_timeout(context, TIMEOUT_READING, priv->reading_timeout);
     milter_debug("[%u] [server][timeout][reading][registered][%g] "
-                 "[%s] <%u> (%p)",
+                 "[%s] (%p)",
                  tag,
                  priv->reading_timeout,
                  NULL_SAFE_NAME(name),
-                 priv->timeout_id,
                  context);
 
     return TRUE;
@@ -1391,20 +1453,12 @@ process_next_state (MilterServerContext *context,
     default:
         milter_server_context_set_state(context, next_state);
         if (milter_server_context_need_reply(context, next_state)) {
-            MilterEventLoop *loop;
-
-            loop = milter_agent_get_event_loop(agent);
-            priv->timeout_id =
-                milter_event_loop_add_timeout(loop,
-                                              priv->reading_timeout,
-                                              cb_reading_timeout,
-                                              context);
+            start_timeout(context, TIMEOUT_READING, priv->reading_timeout);
             milter_debug("[%u] [server][timeout][reading][registered][%g] "
-                         "[%s] <%u> (%p)",
+                         "[%s] (%p)",
                          tag,
                          priv->reading_timeout,
                          NULL_SAFE_NAME(name),
-                         priv->timeout_id,
                          context);
         } else {
             g_timer_stop(priv->elapsed);
@@ -1483,8 +1537,8 @@ write_packet (MilterServerContext *context,
     GError *agent_error = NULL;
     MilterServerContextPrivate *priv;
     GString *packed_packet;
+    MilterEncoder *encoder;
     guint tag;
-    MilterEventLoop *loop;
     const gchar *name;
 
     if (!packet)
@@ -1493,7 +1547,6 @@ write_packet (MilterServerContext *context,
     priv = MILTER_SERVER_CONTEXT_GET_PRIVATE(context);
 
     tag = milter_agent_get_tag(MILTER_AGENT(context));
-    loop = milter_agent_get_event_loop(MILTER_AGENT(context));
     name = milter_server_context_get_name(context);
 
     milter_debug("[%u] [server][write] [%s] (%p)",
@@ -1535,27 +1588,29 @@ write_packet (MilterServerContext *context,
                          tag, g_timer_elapsed(priv->elapsed, NULL), name);
             g_timer_continue(priv->elapsed);
         }
+        g_timer_start(priv->reply_elapsed);
         disable_timeout(context);
-        priv->timeout_id = milter_event_loop_add_timeout(loop,
-                                                         priv->writing_timeout,
-                                                         cb_writing_timeout,
-                                                         context);
+        start_timeout(context, TIMEOUT_WRITING, priv->writing_timeout);
         if (milter_need_debug_log()) {
             const gchar *name;
 
             name = milter_server_context_get_name(context);
             milter_debug("[%u] [server][timeout][writing][registered][%g] "
-                         "[%s] <%u> (%p)",
+                         "[%s] (%p)",
                          tag,
                          priv->writing_timeout,
                          NULL_SAFE_NAME(name),
-                         priv->timeout_id,
                          context);
         }
         break;
     }
 
-    packed_packet = g_string_new_len(packet, packet_size);
+    encoder = milter_agent_get_encoder(MILTER_AGENT(context));
+    if (packet == milter_encoder_get_buffer(encoder)->str &&
+        packet_size == milter_encoder_get_buffer(encoder)->len)
+        packed_packet = milter_encoder_steal_buffer(encoder);
+    else
+        packed_packet = g_string_new_len(packet, packet_size);
     switch (next_state) {
     case MILTER_SERVER_CONTEXT_STATE_HELO:
         prepend_macro(context, packed_packet, MILTER_COMMAND_HELO);
@@ -1588,10 +1643,8 @@ write_packet (MilterServerContext *context,
         break;
     }
 
-    milter_agent_write_packet(MILTER_AGENT(context),
-                              packed_packet->str, packed_packet->len,
+    milter_agent_write_buffer(MILTER_AGENT(context), packed_packet,
                               &agent_error);
-    g_string_free(packed_packet, TRUE);
 
     if (agent_error) {
         GError *error = NULL;
@@ -1622,6 +1675,19 @@ write_packet (MilterServerContext *context,
     return TRUE;
 }
 
+static gboolean
+check_stop (MilterServerContext *context, MilterServerContextState state,
+            const gchar *argument)
+{
+    MilterServerContextPrivate *priv;
+
+    priv = MILTER_SERVER_CONTEXT_GET_PRIVATE(context);
+    if (!priv->stop_checker)
+        return FALSE;
+    return priv->stop_checker(context, state, argument,
+                              priv->stop_checker_user_data);
+}
+
 static void
 stop_on_state (MilterServerContext *context, MilterServerContextState state)
 {
@@ -1702,6 +1768,9 @@ milter_server_context_helo (MilterServerContext *context,
     gboolean stop = FALSE;
     guint tag = 0;
     const gchar *name = NULL;
+    MilterServerContextPrivate *priv;
+
+    priv = MILTER_SERVER_CONTEXT_GET_PRIVATE(context);
 
     if (milter_need_debug_log()) {
         tag = milter_agent_get_tag(MILTER_AGENT(context));
@@ -1710,7 +1779,9 @@ milter_server_context_helo (MilterServerContext *context,
 
     milter_debug("[%u] [server][send][helo] <%s>: %s", tag, fqdn, name);
 
-    g_signal_emit(context, signals[STOP_ON_HELO], 0, fqdn, &stop);
+    stop = check_stop(context, MILTER_SERVER_CONTEXT_STATE_HELO, fqdn);
+    if (!stop)
+        g_signal_emit(context, signals[STOP_ON_HELO], 0, fqdn, &stop);
     if (stop) {
         stop_on_state(context, MILTER_SERVER_CONTEXT_STATE_HELO);
         return TRUE;
@@ -1720,7 +1791,9 @@ milter_server_context_helo (MilterServerContext *context,
         milter_debug("[%u] [server][helo][skip] %s", tag, name);
         milter_server_context_set_state(context,
                                         MILTER_SERVER_CONTEXT_STATE_HELO);
-        g_signal_emit_by_name(context, "continue");
+        milter_reply_signals_emit_continue(MILTER_REPLY_SIGNALS(context),
+                                           priv->reply_handlers,
+                                           priv->reply_handlers_data);
         return TRUE;
     }
 
@@ -1778,6 +1851,9 @@ milter_server_context_connect (MilterServerContext *context,
     gboolean stop = FALSE;
     guint tag = 0;
     const gchar *name = NULL;
+    MilterServerContextPrivate *priv;
+
+    priv = MILTER_SERVER_CONTEXT_GET_PRIVATE(context);
 
     if (milter_need_debug_log()) {
         tag = milter_agent_get_tag(MILTER_AGENT(context));
@@ -1790,8 +1866,10 @@ milter_server_context_connect (MilterServerContext *context,
     milter_protocol_agent_set_macro_context(MILTER_PROTOCOL_AGENT(context),
                                             MILTER_COMMAND_CONNECT);
     milter_debug("[%u] [server][stop-on-connect][start] %s", tag, name);
-    g_signal_emit(context, signals[STOP_ON_CONNECT], 0,
-                  host_name, address, address_length, &stop);
+    stop = check_stop(context, MILTER_SERVER_CONTEXT_STATE_CONNECT, host_name);
+    if (!stop)
+        g_signal_emit(context, signals[STOP_ON_CONNECT], 0,
+                      host_name, address, address_length, &stop);
     milter_debug("[%u] [server][stop-on-connect][end] %s: stop=<%s>",
                  tag, name, stop ? "true" : "false");
     if (stop) {
@@ -1803,7 +1881,9 @@ milter_server_context_connect (MilterServerContext *context,
         milter_debug("[%u] [server][connect][skip] %s", tag, name);
         milter_server_context_set_state(context,
                                         MILTER_SERVER_CONTEXT_STATE_CONNECT);
-        g_signal_emit_by_name(context, "continue");
+        milter_reply_signals_emit_continue(MILTER_REPLY_SIGNALS(context),
+                                           priv->reply_handlers,
+                                           priv->reply_handlers_data);
         return TRUE;
     }
 
@@ -1887,7 +1967,9 @@ milter_server_context_envelope_from (MilterServerContext *context,
     milter_protocol_agent_set_macro_context(MILTER_PROTOCOL_AGENT(context),
                                             MILTER_COMMAND_ENVELOPE_FROM);
     milter_debug("[%u] [server][stop-on-envelope-from][start] %s", tag, name);
-    g_signal_emit(context, signals[STOP_ON_ENVELOPE_FROM], 0, from, &stop);
+    stop = check_stop(context, MILTER_SERVER_CONTEXT_STATE_ENVELOPE_FROM, from);
+    if (!stop)
+        g_signal_emit(context, signals[STOP_ON_ENVELOPE_FROM], 0, from, &stop);
     milter_debug("[%u] [server][stop-on-envelope-from][end] %s: stop=<%s>",
                  tag, name, stop ? "true" : "false");
     if (stop) {
@@ -1901,7 +1983,9 @@ milter_server_context_envelope_from (MilterServerContext *context,
         milter_debug("[%u] [server][envelope-from][skip] %s", tag, name);
         milter_server_context_set_state(
             context, MILTER_SERVER_CONTEXT_STATE_ENVELOPE_FROM);
-        g_signal_emit_by_name(context, "continue");
+        milter_reply_signals_emit_continue(MILTER_REPLY_SIGNALS(context),
+                                           priv->reply_handlers,
+                                           priv->reply_handlers_data);
         return TRUE;
     }
 
@@ -1949,8 +2033,11 @@ milter_server_context_envelope_recipient (MilterServerContext *context,
                                             MILTER_COMMAND_ENVELOPE_RECIPIENT);
     milter_debug("[%u] [server][stop-on-envelope-recipient][start] %s",
                  tag, name);
-    g_signal_emit(context, signals[STOP_ON_ENVELOPE_RECIPIENT], 0,
-                  recipient, &stop);
+    stop = check_stop(context, MILTER_SERVER_CONTEXT_STATE_ENVELOPE_RECIPIENT,
+                      recipient);
+    if (!stop)
+        g_signal_emit(context, signals[STOP_ON_ENVELOPE_RECIPIENT], 0,
+                      recipient, &stop);
     milter_debug("[%u] [server][stop-on-envelope-recipient][end] %s: stop=<%s>",
                  tag, name, stop ? "true" : "false");
     if (stop) {
@@ -1963,7 +2050,9 @@ milter_server_context_envelope_recipient (MilterServerContext *context,
         milter_debug("[%u] [server][envelope-recipient][skip] %s", tag, name);
         milter_server_context_set_state(
             context, MILTER_SERVER_CONTEXT_STATE_ENVELOPE_RECIPIENT);
-        g_signal_emit_by_name(context, "continue");
+        milter_reply_signals_emit_continue(MILTER_REPLY_SIGNALS(context),
+                                           priv->reply_handlers,
+                                           priv->reply_handlers_data);
         return TRUE;
     }
 
@@ -2003,7 +2092,9 @@ milter_server_context_data (MilterServerContext *context)
     milter_protocol_agent_set_macro_context(MILTER_PROTOCOL_AGENT(context),
                                             MILTER_COMMAND_DATA);
     milter_debug("[%u] [server][stop-on-data][start] %s", tag, name);
-    g_signal_emit(context, signals[STOP_ON_DATA], 0, &stop);
+    stop = check_stop(context, MILTER_SERVER_CONTEXT_STATE_DATA, NULL);
+    if (!stop)
+        g_signal_emit(context, signals[STOP_ON_DATA], 0, &stop);
     milter_debug("[%u] [server][stop-on-data][end] %s: stop=<%s>",
                  tag, name, stop ? "true" : "false");
     if (stop) {
@@ -2016,7 +2107,9 @@ milter_server_context_data (MilterServerContext *context)
         milter_debug("[%u] [server][data][skip] %s", tag, name);
         milter_server_context_set_state(context,
                                         MILTER_SERVER_CONTEXT_STATE_DATA);
-        g_signal_emit_by_name(context, "continue");
+        milter_reply_signals_emit_continue(MILTER_REPLY_SIGNALS(context),
+                                           priv->reply_handlers,
+                                           priv->reply_handlers_data);
         return TRUE;
     }
 
@@ -2037,6 +2130,9 @@ milter_server_context_unknown (MilterServerContext *context,
     MilterEncoder *encoder;
     guint tag = 0;
     const gchar *name = NULL;
+    MilterServerContextPrivate *priv;
+
+    priv = MILTER_SERVER_CONTEXT_GET_PRIVATE(context);
 
     if (milter_need_debug_log()) {
         tag = milter_agent_get_tag(MILTER_AGENT(context));
@@ -2051,7 +2147,9 @@ milter_server_context_unknown (MilterServerContext *context,
                      tag, NULL_SAFE_NAME(name));
         milter_server_context_set_state(context,
                                         MILTER_SERVER_CONTEXT_STATE_UNKNOWN);
-        g_signal_emit_by_name(context, "continue");
+        milter_reply_signals_emit_continue(MILTER_REPLY_SIGNALS(context),
+                                           priv->reply_handlers,
+                                           priv->reply_handlers_data);
         return TRUE;
     }
 
@@ -2107,7 +2205,9 @@ milter_server_context_header (MilterServerContext *context,
                      tag, NULL_SAFE_NAME(name));
         milter_server_context_set_state(context,
                                         MILTER_SERVER_CONTEXT_STATE_HEADER);
-        g_signal_emit_by_name(context, "continue");
+        milter_reply_signals_emit_continue(MILTER_REPLY_SIGNALS(context),
+                                           priv->reply_handlers,
+                                           priv->reply_handlers_data);
         return TRUE;
     }
 
@@ -2149,7 +2249,9 @@ milter_server_context_end_of_header (MilterServerContext *context)
                                             MILTER_COMMAND_END_OF_HEADER);
     milter_debug("[%u] [server][stop-on-end-of-header][start] [%s]",
                  tag, NULL_SAFE_NAME(name));
-    g_signal_emit(context, signals[STOP_ON_END_OF_HEADER], 0, &stop);
+    stop = check_stop(context, MILTER_SERVER_CONTEXT_STATE_END_OF_HEADER, NULL);
+    if (!stop)
+        g_signal_emit(context, signals[STOP_ON_END_OF_HEADER], 0, &stop);
     milter_debug("[%u] [server][stop-on-end-of-header][end] [%s] stop=<%s>",
                  tag, NULL_SAFE_NAME(name), stop ? "true" : "false");
     if (stop) {
@@ -2163,7 +2265,9 @@ milter_server_context_end_of_header (MilterServerContext *context)
                      tag, NULL_SAFE_NAME(name));
         milter_server_context_set_state(
             context, MILTER_SERVER_CONTEXT_STATE_END_OF_HEADER);
-        g_signal_emit_by_name(context, "continue");
+        milter_reply_signals_emit_continue(MILTER_REPLY_SIGNALS(context),
+                                           priv->reply_handlers,
+                                           priv->reply_handlers_data);
         return TRUE;
     }
 
@@ -2216,7 +2320,9 @@ milter_server_context_body (MilterServerContext *context,
         milter_debug("[%u] [server][body][skip] [%s]",
                      tag, NULL_SAFE_NAME(name));
         milter_server_context_set_state(context, state);
-        g_signal_emit_by_name(context, "skip");
+        milter_reply_signals_emit_skip(MILTER_REPLY_SIGNALS(context),
+                                       priv->reply_handlers,
+                                       priv->reply_handlers_data);
         return TRUE;
     }
 
@@ -2254,8 +2360,10 @@ milter_server_context_end_of_message (MilterServerContext *context,
     milter_protocol_agent_set_macro_context(MILTER_PROTOCOL_AGENT(context),
                                             MILTER_COMMAND_END_OF_MESSAGE);
     milter_debug("[%u] [server][stop-on-end-of-message][start] %s", tag, name);
-    g_signal_emit(context, signals[STOP_ON_END_OF_MESSAGE], 0,
-                  chunk, size, &stop);
+    stop = check_stop(context, MILTER_SERVER_CONTEXT_STATE_END_OF_MESSAGE, NULL);
+    if (!stop)
+        g_signal_emit(context, signals[STOP_ON_END_OF_MESSAGE], 0,
+                      chunk, size, &stop);
     milter_debug("[%u] [server][stop-on-end-of-message][end] %s: stop=<%s>",
                  tag, name, stop ? "true" : "false");
     if (stop) {
@@ -2385,7 +2493,7 @@ invalid_state (MilterServerContext *context,
 }
 
 static void
-cb_decoder_negotiate_reply (MilterDecoder *decoder,
+cb_decoder_negotiate_reply (MilterReplySignals *reply,
                             MilterOption *option,
                             MilterMacrosRequests *macros_requests,
                             gpointer user_data)
@@ -2446,8 +2554,10 @@ cb_decoder_negotiate_reply (MilterDecoder *decoder,
             agent = MILTER_PROTOCOL_AGENT(context);
             priv->negotiated = TRUE;
             milter_protocol_agent_set_macros_requests(agent, macros_requests);
-            g_signal_emit_by_name(context, "negotiate-reply",
-                                  option, macros_requests);
+            milter_reply_signals_emit_negotiate_reply(MILTER_REPLY_SIGNALS(context),
+                                                      option, macros_requests,
+                                                      priv->reply_handlers,
+                                                      priv->reply_handlers_data);
         }
     } else {
         invalid_state(context, state, "negotiate-reply", "negotiate");
@@ -2504,7 +2614,9 @@ decrement_process_body_count (MilterServerContext *context)
         g_timer_stop(priv->elapsed);
         milter_debug("[%u] [server][timer][stop] [%s] <%g>",
                      tag, name, g_timer_elapsed(priv->elapsed, NULL));
-        g_signal_emit_by_name(context, "continue");
+        milter_reply_signals_emit_continue(MILTER_REPLY_SIGNALS(context),
+                                           priv->reply_handlers,
+                                           priv->reply_handlers_data);
         if (priv->sent_end_of_message)
             milter_server_context_set_state(
                 context, MILTER_SERVER_CONTEXT_STATE_END_OF_MESSAGE);
@@ -2514,7 +2626,7 @@ decrement_process_body_count (MilterServerContext *context)
 }
 
 static void
-cb_decoder_continue (MilterReplyDecoder *decoder, gpointer user_data)
+cb_decoder_continue (MilterReplySignals *reply, gpointer user_data)
 {
     MilterServerContext *context;
     MilterServerContextPrivate *priv;
@@ -2565,7 +2677,9 @@ cb_decoder_continue (MilterReplyDecoder *decoder, gpointer user_data)
         milter_debug("[%u] [server][timer][stop] [%s] <%g>",
                      tag, name, g_timer_elapsed(priv->elapsed, NULL));
         if (check_reply_after_quit(context, priv->state, "continue")) {
-            g_signal_emit_by_name(context, "continue");
+            milter_reply_signals_emit_continue(MILTER_REPLY_SIGNALS(context),
+                                               priv->reply_handlers,
+                                               priv->reply_handlers_data);
             if (priv->state == MILTER_SERVER_CONTEXT_STATE_END_OF_MESSAGE)
                 emit_message_processed_signal(context);
         }
@@ -2580,7 +2694,7 @@ cb_decoder_continue (MilterReplyDecoder *decoder, gpointer user_data)
 }
 
 static void
-cb_decoder_reply_code (MilterReplyDecoder *decoder,
+cb_decoder_reply_code (MilterReplySignals *reply,
                        guint code,
                        const gchar *extended_code,
                        const gchar *message,
@@ -2649,8 +2763,10 @@ cb_decoder_reply_code (MilterReplyDecoder *decoder,
         milter_debug("[%u] [server][timer][stop] [%s] %g",
                      tag, name, g_timer_elapsed(priv->elapsed, NULL));
         if (check_reply_after_quit(context, state, "reply-code")) {
-            g_signal_emit_by_name(context, "reply-code",
-                                  code, extended_code, message);
+            milter_reply_signals_emit_reply_code(MILTER_REPLY_SIGNALS(context),
+                                                 code, extended_code, message,
+                                                 priv->reply_handlers,
+                                                 priv->reply_handlers_data);
             if (MILTER_SERVER_CONTEXT_STATE_ENVELOPE_FROM <= priv->state &&
                 priv->state <= MILTER_SERVER_CONTEXT_STATE_END_OF_MESSAGE &&
                 priv->state != MILTER_SERVER_CONTEXT_STATE_ENVELOPE_RECIPIENT) {
@@ -2668,7 +2784,7 @@ cb_decoder_reply_code (MilterReplyDecoder *decoder,
 }
 
 static void
-cb_decoder_temporary_failure (MilterReplyDecoder *decoder, gpointer user_data)
+cb_decoder_temporary_failure (MilterReplySignals *reply, gpointer user_data)
 {
     MilterServerContext *context = user_data;
     MilterServerContextPrivate *priv;
@@ -2713,7 +2829,9 @@ cb_decoder_temporary_failure (MilterReplyDecoder *decoder, gpointer user_data)
     if (!check_reply_after_quit(context, priv->state, "temporary-failure"))
         return;
 
-    g_signal_emit_by_name(context, "temporary-failure");
+    milter_reply_signals_emit_temporary_failure(MILTER_REPLY_SIGNALS(context),
+                                                priv->reply_handlers,
+                                                priv->reply_handlers_data);
     if (MILTER_SERVER_CONTEXT_STATE_ENVELOPE_FROM <= priv->state &&
         priv->state <= MILTER_SERVER_CONTEXT_STATE_END_OF_MESSAGE &&
         priv->state != MILTER_SERVER_CONTEXT_STATE_ENVELOPE_RECIPIENT) {
@@ -2730,7 +2848,7 @@ cb_decoder_temporary_failure (MilterReplyDecoder *decoder, gpointer user_data)
 }
 
 static void
-cb_decoder_reject (MilterReplyDecoder *decoder, gpointer user_data)
+cb_decoder_reject (MilterReplySignals *reply, gpointer user_data)
 {
     MilterServerContext *context = user_data;
     MilterServerContextPrivate *priv;
@@ -2775,7 +2893,9 @@ cb_decoder_reject (MilterReplyDecoder *decoder, gpointer user_data)
     if (!check_reply_after_quit(context, priv->state, "reject"))
         return;
 
-    g_signal_emit_by_name(context, "reject");
+    milter_reply_signals_emit_reject(MILTER_REPLY_SIGNALS(context),
+                                     priv->reply_handlers,
+                                     priv->reply_handlers_data);
     if (MILTER_SERVER_CONTEXT_STATE_ENVELOPE_FROM <= priv->state &&
         priv->state <= MILTER_SERVER_CONTEXT_STATE_END_OF_MESSAGE &&
         priv->state != MILTER_SERVER_CONTEXT_STATE_ENVELOPE_RECIPIENT) {
@@ -2792,7 +2912,7 @@ cb_decoder_reject (MilterReplyDecoder *decoder, gpointer user_data)
 }
 
 static void
-cb_decoder_accept (MilterReplyDecoder *decoder, gpointer user_data)
+cb_decoder_accept (MilterReplySignals *reply, gpointer user_data)
 {
     MilterServerContext *context = user_data;
     MilterServerContextPrivate *priv;
@@ -2825,7 +2945,9 @@ cb_decoder_accept (MilterReplyDecoder *decoder, gpointer user_data)
     if (!check_reply_after_quit(context, priv->state, "accept"))
         return;
 
-    g_signal_emit_by_name(context, "accept");
+    milter_reply_signals_emit_accept(MILTER_REPLY_SIGNALS(context),
+                                     priv->reply_handlers,
+                                     priv->reply_handlers_data);
     if (MILTER_SERVER_CONTEXT_STATE_ENVELOPE_FROM <= priv->state &&
         priv->state <= MILTER_SERVER_CONTEXT_STATE_END_OF_MESSAGE) {
         emit_message_processed_signal(context);
@@ -2841,7 +2963,7 @@ cb_decoder_accept (MilterReplyDecoder *decoder, gpointer user_data)
 }
 
 static void
-cb_decoder_discard (MilterReplyDecoder *decoder, gpointer user_data)
+cb_decoder_discard (MilterReplySignals *reply, gpointer user_data)
 {
     MilterServerContext *context = user_data;
     MilterServerContextPrivate *priv;
@@ -2873,7 +2995,9 @@ cb_decoder_discard (MilterReplyDecoder *decoder, gpointer user_data)
     if (!check_reply_after_quit(context, priv->state, "discard"))
         return;
 
-    g_signal_emit_by_name(context, "discard");
+    milter_reply_signals_emit_discard(MILTER_REPLY_SIGNALS(context),
+                                      priv->reply_handlers,
+                                      priv->reply_handlers_data);
     if (MILTER_SERVER_CONTEXT_STATE_ENVELOPE_FROM <= priv->state &&
         priv->state <= MILTER_SERVER_CONTEXT_STATE_END_OF_MESSAGE) {
         emit_message_processed_signal(context);
@@ -2889,7 +3013,7 @@ cb_decoder_discard (MilterReplyDecoder *decoder, gpointer user_data)
 }
 
 static void
-cb_decoder_add_header (MilterReplyDecoder *decoder,
+cb_decoder_add_header (MilterReplySignals *reply,
                        const gchar *name, const gchar *value,
                        gpointer user_data)
 {
@@ -2910,7 +3034,9 @@ cb_decoder_add_header (MilterReplyDecoder *decoder,
         if (!check_reply_after_quit(context, priv->state, "add-header"))
             return;
 
-        g_signal_emit_by_name(context, "add-header", name, value);
+        milter_reply_signals_emit_add_header(MILTER_REPLY_SIGNALS(context),
+                                             name, value, priv->reply_handlers,
+                                             priv->reply_handlers_data);
 
         ensure_message_result(priv);
         headers = milter_message_result_get_added_headers(priv->message_result);
@@ -2921,7 +3047,7 @@ cb_decoder_add_header (MilterReplyDecoder *decoder,
 }
 
 static void
-cb_decoder_insert_header (MilterReplyDecoder *decoder,
+cb_decoder_insert_header (MilterReplySignals *reply,
                           guint32 index,
                           const gchar *name,
                           const gchar *value,
@@ -2945,7 +3071,10 @@ cb_decoder_insert_header (MilterReplyDecoder *decoder,
         if (!check_reply_after_quit(context, priv->state, "insert-header"))
             return;
 
-        g_signal_emit_by_name(context, "insert-header", index, name, value);
+        milter_reply_signals_emit_insert_header(MILTER_REPLY_SIGNALS(context),
+                                                index, name, value,
+                                                priv->reply_handlers,
+                                                priv->reply_handlers_data);
 
         ensure_message_result(priv);
         headers = milter_message_result_get_added_headers(priv->message_result);
@@ -2956,9 +3085,9 @@ cb_decoder_insert_header (MilterReplyDecoder *decoder,
 }
 
 static void
-cb_decoder_change_header (MilterReplyDecoder *decoder,
+cb_decoder_change_header (MilterReplySignals *reply,
                           const gchar *name,
-                          gint index,
+                          guint32 index,
                           const gchar *value,
                           gpointer user_data)
 {
@@ -2980,7 +3109,10 @@ cb_decoder_change_header (MilterReplyDecoder *decoder,
         if (!check_reply_after_quit(context, priv->state, "change-header"))
             return;
 
-        g_signal_emit_by_name(context, "change-header", name, index, value);
+        milter_reply_signals_emit_change_header(MILTER_REPLY_SIGNALS(context),
+                                                name, index, value,
+                                                priv->reply_handlers,
+                                                priv->reply_handlers_data);
 
         ensure_message_result(priv);
         headers = milter_message_result_get_added_headers(priv->message_result);
@@ -2991,9 +3123,9 @@ cb_decoder_change_header (MilterReplyDecoder *decoder,
 }
 
 static void
-cb_decoder_delete_header (MilterReplyDecoder *decoder,
+cb_decoder_delete_header (MilterReplySignals *reply,
                           const gchar *name,
-                          gint index,
+                          guint32 index,
                           gpointer user_data)
 {
     MilterServerContext *context = user_data;
@@ -3013,7 +3145,10 @@ cb_decoder_delete_header (MilterReplyDecoder *decoder,
         if (!check_reply_after_quit(context, priv->state, "delete-header"))
             return;
 
-        g_signal_emit_by_name(context, "delete-header", name, index);
+        milter_reply_signals_emit_delete_header(MILTER_REPLY_SIGNALS(context),
+                                                name, index,
+                                                priv->reply_handlers,
+                                                priv->reply_handlers_data);
 
         ensure_message_result(priv);
         headers = milter_message_result_get_removed_headers(priv->message_result);
@@ -3024,7 +3159,7 @@ cb_decoder_delete_header (MilterReplyDecoder *decoder,
 }
 
 static void
-cb_decoder_change_from (MilterReplyDecoder *decoder,
+cb_decoder_change_from (MilterReplySignals *reply,
                         const gchar *from,
                         const gchar *parameters,
                         gpointer user_data)
@@ -3043,14 +3178,17 @@ cb_decoder_change_from (MilterReplyDecoder *decoder,
     if (priv->state == MILTER_SERVER_CONTEXT_STATE_END_OF_MESSAGE) {
         if (!check_reply_after_quit(context, priv->state, "change-from"))
             return;
-        g_signal_emit_by_name(context, "change-from", from, parameters);
+        milter_reply_signals_emit_change_from(MILTER_REPLY_SIGNALS(context),
+                                              from, parameters,
+                                              priv->reply_handlers,
+                                              priv->reply_handlers_data);
     } else {
         invalid_state(context, priv->state, "change-from", "end-of-message");
     }
 }
 
 static void
-cb_decoder_add_recipient (MilterReplyDecoder *decoder,
+cb_decoder_add_recipient (MilterReplySignals *reply,
                           const gchar *recipient,
                           const gchar *parameters,
                           gpointer user_data)
@@ -3069,14 +3207,17 @@ cb_decoder_add_recipient (MilterReplyDecoder *decoder,
     if (priv->state == MILTER_SERVER_CONTEXT_STATE_END_OF_MESSAGE) {
         if (!check_reply_after_quit(context, priv->state, "add-recipient"))
             return;
-        g_signal_emit_by_name(context, "add-recipient", recipient, parameters);
+        milter_reply_signals_emit_add_recipient(MILTER_REPLY_SIGNALS(context),
+                                                recipient, parameters,
+                                                priv->reply_handlers,
+                                                priv->reply_handlers_data);
     } else {
         invalid_state(context, priv->state, "add-recipient", "end-of-message");
     }
 }
 
 static void
-cb_decoder_delete_recipient (MilterReplyDecoder *decoder,
+cb_decoder_delete_recipient (MilterReplySignals *reply,
                              const gchar *recipient,
                              gpointer user_data)
 {
@@ -3093,7 +3234,10 @@ cb_decoder_delete_recipient (MilterReplyDecoder *decoder,
     if (priv->state == MILTER_SERVER_CONTEXT_STATE_END_OF_MESSAGE) {
         if (!check_reply_after_quit(context, priv->state, "delete-recipient"))
             return;
-        g_signal_emit_by_name(user_data, "delete-recipient", recipient);
+        milter_reply_signals_emit_delete_recipient(MILTER_REPLY_SIGNALS(context),
+                                                   recipient,
+                                                   priv->reply_handlers,
+                                                   priv->reply_handlers_data);
     } else {
         invalid_state(context, priv->state,
                       "delete-recipient", "end-of-message");
@@ -3101,7 +3245,7 @@ cb_decoder_delete_recipient (MilterReplyDecoder *decoder,
 }
 
 static void
-cb_decoder_replace_body (MilterReplyDecoder *decoder,
+cb_decoder_replace_body (MilterReplySignals *reply,
                          const gchar *body,
                          gsize body_size,
                          gpointer user_data)
@@ -3120,14 +3264,17 @@ cb_decoder_replace_body (MilterReplyDecoder *decoder,
     if (priv->state == MILTER_SERVER_CONTEXT_STATE_END_OF_MESSAGE) {
         if (!check_reply_after_quit(context, priv->state, "replace-body"))
             return;
-        g_signal_emit_by_name(context, "replace-body", body, body_size);
+        milter_reply_signals_emit_replace_body(MILTER_REPLY_SIGNALS(context),
+                                               body, body_size,
+                                               priv->reply_handlers,
+                                               priv->reply_handlers_data);
     } else {
         invalid_state(context, priv->state, "replace-body", "end-of-message");
     }
 }
 
 static void
-cb_decoder_progress (MilterReplyDecoder *decoder, gpointer user_data)
+cb_decoder_progress (MilterReplySignals *reply, gpointer user_data)
 {
     MilterServerContext *context = user_data;
     MilterServerContextPrivate *priv;
@@ -3142,14 +3289,16 @@ cb_decoder_progress (MilterReplyDecoder *decoder, gpointer user_data)
         if (!check_reply_after_quit(context, priv->state, "progress"))
             return;
         reset_end_of_message_timeout(context);
-        g_signal_emit_by_name(context, "progress");
+        milter_reply_signals_emit_progress(MILTER_REPLY_SIGNALS(context),
+                                           priv->reply_handlers,
+                                           priv->reply_handlers_data);
     } else {
         invalid_state(context, priv->state, "progress", "end-of-message");
     }
 }
 
 static void
-cb_decoder_quarantine (MilterReplyDecoder *decoder,
+cb_decoder_quarantine (MilterReplySignals *reply,
                        const gchar *reason,
                        gpointer user_data)
 {
@@ -3168,7 +3317,9 @@ cb_decoder_quarantine (MilterReplyDecoder *decoder,
         if (!check_reply_after_quit(context, priv->state, "quarantine"))
             return;
 
-        g_signal_emit_by_name(user_data, "quarantine", reason);
+        milter_reply_signals_emit_quarantine(MILTER_REPLY_SIGNALS(context),
+                                             reason, priv->reply_handlers,
+                                             priv->reply_handlers_data);
 
         ensure_message_result(priv);
         milter_message_result_set_quarantine(priv->message_result, TRUE);
@@ -3178,7 +3329,7 @@ cb_decoder_quarantine (MilterReplyDecoder *decoder,
 }
 
 static void
-cb_decoder_connection_failure (MilterReplyDecoder *decoder, gpointer user_data)
+cb_decoder_connection_failure (MilterReplySignals *reply, gpointer user_data)
 {
     MilterServerContext *context = user_data;
     MilterServerContextPrivate *priv;
@@ -3205,11 +3356,13 @@ cb_decoder_connection_failure (MilterReplyDecoder *decoder, gpointer user_data)
 
     if (!check_reply_after_quit(context, priv->state, "connection-failure"))
         return;
-    g_signal_emit_by_name(user_data, "connection-failure");
+    milter_reply_signals_emit_connection_failure(MILTER_REPLY_SIGNALS(context),
+                                                 priv->reply_handlers,
+                                                 priv->reply_handlers_data);
 }
 
 static void
-cb_decoder_shutdown (MilterReplyDecoder *decoder, gpointer user_data)
+cb_decoder_shutdown (MilterReplySignals *reply, gpointer user_data)
 {
     MilterServerContext *context = user_data;
     MilterServerContextPrivate *priv;
@@ -3233,11 +3386,13 @@ cb_decoder_shutdown (MilterReplyDecoder *decoder, gpointer user_data)
 
     if (!check_reply_after_quit(context, priv->state, "shutdown"))
         return;
-    g_signal_emit_by_name(user_data, "shutdown");
+    milter_reply_signals_emit_shutdown(MILTER_REPLY_SIGNALS(context),
+                                       priv->reply_handlers,
+                                       priv->reply_handlers_data);
 }
 
 static void
-cb_decoder_skip (MilterReplyDecoder *decoder, gpointer user_data)
+cb_decoder_skip (MilterReplySignals *reply, gpointer user_data)
 {
     MilterServerContext *context = user_data;
     MilterServerContextPrivate *priv;
@@ -3261,7 +3416,9 @@ cb_decoder_skip (MilterReplyDecoder *decoder, gpointer user_data)
                      tag, name, g_timer_elapsed(priv->elapsed, NULL));
         if (!check_reply_after_quit(context, priv->state, "skip"))
             return;
-        g_signal_emit_by_name(context, "skip");
+        milter_reply_signals_emit_skip(MILTER_REPLY_SIGNALS(context),
+                                       priv->reply_handlers,
+                                       priv->reply_handlers_data);
         clear_process_body_count(context);
         priv->skip_body = TRUE;
     } else {
@@ -3269,39 +3426,37 @@ cb_decoder_skip (MilterReplyDecoder *decoder, gpointer user_data)
     }
 }
 
+static const MilterReplyHandlers decoder_reply_handlers = {
+    cb_decoder_negotiate_reply,
+    cb_decoder_continue,
+    cb_decoder_reply_code,
+    cb_decoder_temporary_failure,
+    cb_decoder_reject,
+    cb_decoder_accept,
+    cb_decoder_discard,
+    cb_decoder_add_header,
+    cb_decoder_insert_header,
+    cb_decoder_change_header,
+    cb_decoder_delete_header,
+    cb_decoder_change_from,
+    cb_decoder_add_recipient,
+    cb_decoder_delete_recipient,
+    cb_decoder_replace_body,
+    cb_decoder_progress,
+    cb_decoder_quarantine,
+    cb_decoder_connection_failure,
+    cb_decoder_shutdown,
+    cb_decoder_skip
+};
+
 static MilterDecoder *
 decoder_new (MilterAgent *agent)
 {
     MilterDecoder *decoder;
 
     decoder = milter_reply_decoder_new();
-
-#define CONNECT(name)                                                   \
-    g_signal_connect(decoder, #name, G_CALLBACK(cb_decoder_ ## name),   \
-                     agent)
-
-    CONNECT(negotiate_reply);
-    CONNECT(continue);
-    CONNECT(reply_code);
-    CONNECT(temporary_failure);
-    CONNECT(reject);
-    CONNECT(accept);
-    CONNECT(discard);
-    CONNECT(add_header);
-    CONNECT(insert_header);
-    CONNECT(change_header);
-    CONNECT(delete_header);
-    CONNECT(change_from);
-    CONNECT(add_recipient);
-    CONNECT(delete_recipient);
-    CONNECT(replace_body);
-    CONNECT(progress);
-    CONNECT(quarantine);
-    CONNECT(connection_failure);
-    CONNECT(shutdown);
-    CONNECT(skip);
-
-#undef CONNECT
+    milter_reply_decoder_set_handlers(MILTER_REPLY_DECODER(decoder),
+                                      &decoder_reply_handlers, agent);
 
     return decoder;
 }
@@ -3352,10 +3507,9 @@ cb_connection_timeout (gpointer data)
     if (priv)
         name = milter_server_context_get_name(context);
     agent = MILTER_AGENT(context);
-    milter_debug("[%u] [server][timeout][connection] [%s] [%u] (%p)",
+    milter_debug("[%u] [server][timeout][connection] [%s] (%p)",
                  priv ? milter_agent_get_tag(agent) : 0,
                  NULL_SAFE_NAME(name),
-                 priv ? priv->timeout_id : 0,
                  context);
     milter_error("[%u] [server][timeout][connection] [%s]",
                  priv ? milter_agent_get_tag(agent) : 0,
@@ -3373,7 +3527,7 @@ prepare_reader (MilterServerContext *context)
 
     priv = MILTER_SERVER_CONTEXT_GET_PRIVATE(context);
 
-    reader = milter_reader_io_channel_new(priv->client_channel);
+    reader = milter_reader_unix_io_channel_new(priv->client_channel);
     milter_agent_set_reader(MILTER_AGENT(context), reader);
     g_object_unref(reader);
 
@@ -3388,7 +3542,8 @@ prepare_writer (MilterServerContext *context)
 
     priv = MILTER_SERVER_CONTEXT_GET_PRIVATE(context);
 
-    writer = milter_writer_io_channel_new(priv->client_channel);
+    writer = milter_writer_unix_io_channel_new(priv->client_channel);
+    milter_writer_set_direct_write(writer, priv->direct_write);
     milter_agent_set_writer(MILTER_AGENT(context), writer);
     g_object_unref(writer);
 
@@ -3523,21 +3678,17 @@ milter_server_context_establish_connection (MilterServerContext *context,
                                    connect_watch_func, context);
 
     disable_timeout(context);
-    priv->timeout_id = milter_event_loop_add_timeout(loop,
-                                                     priv->connection_timeout,
-                                                     cb_connection_timeout,
-                                                     context);
+    start_timeout(context, TIMEOUT_CONNECTION, priv->connection_timeout);
     if (milter_need_debug_log()) {
         const gchar *name = NULL;
 
         if (priv)
             name = milter_server_context_get_name(context);
         milter_debug("[%u] [server][timeout][connection][registered][%g] "
-                     "[%s] <%u> (%p)",
+                     "[%s] (%p)",
                      milter_agent_get_tag(agent),
                      priv->connection_timeout,
                      NULL_SAFE_NAME(name),
-                     priv->timeout_id,
                      context);
     }
 
@@ -3572,6 +3723,130 @@ milter_server_context_establish_connection (MilterServerContext *context,
     return TRUE;
 }
 
+GIOChannel *
+milter_server_context_detach_connection (MilterServerContext *context)
+{
+    MilterServerContextPrivate *priv;
+    GIOChannel *channel;
+    const gchar *packet = NULL;
+    gsize packet_size;
+    MilterEncoder *encoder;
+    GError *error = NULL;
+    guint tag;
+    const gchar *name;
+
+    priv = MILTER_SERVER_CONTEXT_GET_PRIVATE(context);
+
+    tag = milter_agent_get_tag(MILTER_AGENT(context));
+    name = milter_server_context_get_name(context);
+
+    /* QUIT_NC is available since protocol version 6. */
+    if (!priv->client_channel ||
+        !priv->negotiated ||
+        !priv->option ||
+        milter_option_get_version(priv->option) < 6 ||
+        priv->quitted ||
+        priv->next_states ||
+        milter_server_context_is_processing(context)) {
+        milter_debug("[%u] [server][detach][skip] [%s]",
+                     tag, NULL_SAFE_NAME(name));
+        return NULL;
+    }
+
+    milter_debug("[%u] [server][send][quit-new-connection] [%s]",
+                 tag, NULL_SAFE_NAME(name));
+    priv->quitted = TRUE;
+    encoder = milter_agent_get_encoder(MILTER_AGENT(context));
+    milter_command_encoder_encode_quit_new_connection(
+        MILTER_COMMAND_ENCODER(encoder), &packet, &packet_size);
+    if (!milter_agent_write_packet(MILTER_AGENT(context),
+                                   packet, packet_size, &error)) {
+        milter_error("[%u] [server][error][detach] [%s] %s",
+                     tag, NULL_SAFE_NAME(name), error->message);
+        milter_error_emittable_emit(MILTER_ERROR_EMITTABLE(context), error);
+        g_error_free(error);
+        return NULL;
+    }
+
+    /* The next session's commands must not follow a truncated
+     * QUIT_NC. Close the connection instead of reusing it. */
+    if (!milter_agent_drain(MILTER_AGENT(context), &error)) {
+        if (error) {
+            milter_error("[%u] [server][error][detach][drain] [%s] %s",
+                         tag, NULL_SAFE_NAME(name), error->message);
+            g_error_free(error);
+        } else {
+            milter_debug("[%u] [server][detach][close] [%s] "
+                         "QUIT_NC isn't written yet",
+                         tag, NULL_SAFE_NAME(name));
+        }
+        dispose_client_channel(priv);
+        milter_agent_shutdown(MILTER_AGENT(context));
+        milter_server_context_set_state(context,
+                                        MILTER_SERVER_CONTEXT_STATE_QUIT);
+        return NULL;
+    }
+
+    channel = priv->client_channel;
+    priv->client_channel = NULL;
+    milter_agent_shutdown(MILTER_AGENT(context));
+    milter_server_context_set_state(context, MILTER_SERVER_CONTEXT_STATE_QUIT);
+
+    return channel;
+}
+
+gboolean
+milter_server_context_attach_connection (MilterServerContext *context,
+                                         GIOChannel *channel,
+                                         MilterOption *option,
+                                         MilterOption *reply_option,
+                                         MilterMacrosRequests *macros_requests,
+                                         GError **error)
+{
+    MilterServerContextPrivate *priv;
+
+    priv = MILTER_SERVER_CONTEXT_GET_PRIVATE(context);
+
+    disable_timeout(context);
+    dispose_connect_watch(context);
+    dispose_client_channel(priv);
+
+    if (priv->option)
+        g_object_unref(priv->option);
+    priv->option = milter_option_copy(option);
+    if (!milter_option_combine(priv->option, reply_option)) {
+        g_set_error(error,
+                    MILTER_SERVER_CONTEXT_ERROR,
+                    MILTER_SERVER_CONTEXT_ERROR_NEWER_VERSION_REQUESTED,
+                    "unsupported newer version is requested: %d < %d",
+                    milter_option_get_version(priv->option),
+                    milter_option_get_version(reply_option));
+        return FALSE;
+    }
+
+    g_io_channel_ref(channel);
+    priv->client_channel = channel;
+    prepare_reader(context);
+    prepare_writer(context);
+    if (!milter_agent_start(MILTER_AGENT(context), error)) {
+        dispose_client_channel(priv);
+        return FALSE;
+    }
+
+    priv->negotiated = TRUE;
+    milter_protocol_agent_set_macros_requests(MILTER_PROTOCOL_AGENT(context),
+                                              macros_requests);
+    milter_server_context_set_state(context,
+                                    MILTER_SERVER_CONTEXT_STATE_NEGOTIATE);
+
+    milter_debug("[%u] [server][attached] [%s] %d",
+                 milter_agent_get_tag(MILTER_AGENT(context)),
+                 milter_server_context_get_name(context),
+                 g_io_channel_unix_get_fd(channel));
+
+    return TRUE;
+}
+
 void
 milter_server_context_set_connection_timeout (MilterServerContext *context,
                                               gdouble timeout)
@@ -3614,6 +3889,31 @@ milter_server_context_set_all_timeouts (MilterServerContext *context,
     priv->end_of_message_timeout = timeout;
 }
 
+void
+milter_server_context_set_direct_write (MilterServerContext *context,
+                                        gboolean direct_write)
+{
+    MILTER_SERVER_CONTEXT_GET_PRIVATE(context)->direct_write = direct_write;
+}
+
+gboolean
+milter_server_context_is_direct_write (MilterServerContext *context)
+{
+    return MILTER_SERVER_CONTEXT_GET_PRIVATE(context)->direct_write;
+}
+
+void
+milter_server_context_set_stop_checker (MilterServerContext *context,
+                                        MilterServerContextStopChecker checker,
+                                        gpointer user_data)
+{
+    MilterServerContextPrivate *priv;
+
+    priv = MILTER_SERVER_CONTEXT_GET_PRIVATE(context);
+    priv->stop_checker = checker;
+    priv->stop_checker_user_data = user_data;
+}
+
 gboolean
 milter_server_context_get_skip_body (MilterServerContext *context)
 {
@@ -3658,6 +3958,14 @@ milter_server_context_get_elapsed (MilterServerContext *context)
                            NULL);
 }
 
+gdouble
+milter_server_context_get_reply_elapsed (MilterServerContext *context)
+{
+    return g_timer_elapsed(
+        MILTER_SERVER_CONTEXT_GET_PRIVATE(context)->reply_elapsed,
+        NULL);
+}
+
 gboolean
 milter_server_context_is_negotiated (MilterServerContext *context)
 {
@@ -3725,6 +4033,18 @@ milter_server_context_set_message_result (MilterServerContext *context,
         g_object_ref(priv->message_result);
 }
 
+void
+milter_server_context_set_reply_handlers (MilterServerContext       *context,
+                                          const MilterReplyHandlers *handlers,
+                                          gpointer                   user_data)
+{
+    MilterServerContextPrivate *priv;
+
+    priv = MILTER_SERVER_CONTEXT_GET_PRIVATE(context);
+    priv->reply_handlers = handlers;
+    priv->reply_handlers_data = user_data;
+}
+
 gboolean
 milter_server_context_has_accepted_recipient (MilterServerContext *context)
 {
@@ -159,6 +159,26 @@ typedef enum
 typedef struct _MilterServerContext         MilterServerContext;
 typedef struct _MilterServerContextClass    MilterServerContextClass;
 
+/**
+ * MilterServerContextStopChecker:
+ * @context: a %MilterServerContext.
+ * @state: the state that is about to be sent.
+ * @argument: the host name for %MILTER_SERVER_CONTEXT_STATE_CONNECT,
+ *            the FQDN for %MILTER_SERVER_CONTEXT_STATE_HELO,
+ *            the address for
+ *            %MILTER_SERVER_CONTEXT_STATE_ENVELOPE_FROM and
+ *            %MILTER_SERVER_CONTEXT_STATE_ENVELOPE_RECIPIENT,
+ *            %NULL otherwise.
+ * @user_data: the data passed to
+ *             milter_server_context_set_stop_checker().
+ *
+ * Returns: %TRUE if @context should be stopped at @state.
+ */
+typedef gboolean (*MilterServerContextStopChecker) (MilterServerContext      *context,
+                                                    MilterServerContextState  state,
+                                                    const gchar              *argument,
+                                                    gpointer                  user_data);
+
 struct _MilterServerContext
 {
     MilterProtocolAgent object;
@@ -300,6 +320,52 @@ void                 milter_server_context_set_end_of_message_timeout
 void                 milter_server_context_set_all_timeouts
                                                        (MilterServerContext *context,
                                                         gdouble timeout);
+
+/**
+ * milter_server_context_set_direct_write:
+ * @context: a %MilterServerContext.
+ * @direct_write: %TRUE if commands are written to the
+ *                client socket without waiting for the
+ *                event loop.
+ *
+ * Sets whether commands are written to the client socket
+ * immediately when no data is buffered. It is applied to
+ * the writer created on the next connection. See
+ * milter_writer_set_direct_write() for details.
+ */
+void                 milter_server_context_set_direct_write
+                                                       (MilterServerContext *context,
+                                                        gboolean direct_write);
+
+/**
+ * milter_server_context_is_direct_write:
+ * @context: a %MilterServerContext.
+ *
+ * Returns: %TRUE if commands are written to the client
+ * socket immediately when no data is buffered.
+ */
+gboolean             milter_server_context_is_direct_write
+                                                       (MilterServerContext *context);
+
+/**
+ * milter_server_context_set_stop_checker:
+ * @context: a %MilterServerContext.
+ * @checker: the function to decide whether @context stops,
+ *           or %NULL.
+ * @user_data: the data passed to @checker.
+ *
+ * Sets a function that is called before stop-on-* signals
+ * are emitted on connect, helo, envelope-from,
+ * envelope-recipient, data, end-of-header and
+ * end-of-message. If @checker returns %TRUE, @context is
+ * stopped without emitting the signal.
+ *
+ * Since: 2.1.3
+ */
+void                 milter_server_context_set_stop_checker
+                                                       (MilterServerContext *context,
+                                                        MilterServerContextStopChecker checker,
+                                                        gpointer user_data);
 /**
  * milter_server_context_set_connection_spec:
  * @context: a %MilterServerContext.
@@ -551,6 +617,52 @@ gboolean             milter_server_context_end_of_message
  */
 gboolean             milter_server_context_quit        (MilterServerContext *context);
 
+/**
+ * milter_server_context_detach_connection:
+ * @context: a %MilterServerContext.
+ *
+ * Sends QUIT_NC to client and detaches the negotiated
+ * connection from @context. The detached connection can be
+ * reused by another %MilterServerContext with
+ * milter_server_context_attach_connection(). @context is
+ * quitted after this. The connection isn't detached when
+ * the negotiated protocol version is older than 6 because
+ * QUIT_NC isn't available. If QUIT_NC can't be written
+ * completely without waiting, the connection is closed
+ * instead of being detached and @context is quitted.
+ *
+ * Returns: the detached connection on success, %NULL
+ * otherwise. It should be freed by g_io_channel_unref().
+ */
+GIOChannel          *milter_server_context_detach_connection
+                                                       (MilterServerContext *context);
+
+/**
+ * milter_server_context_attach_connection:
+ * @context: a %MilterServerContext.
+ * @channel: the connection detached by
+ *           milter_server_context_detach_connection().
+ * @option: the option that was sent on negotiation.
+ * @reply_option: the option that was replied on negotiation.
+ * @macros_requests: the macros requests that was replied on
+ *                   negotiation. maybe %NULL.
+ * @error: return location for an error, or %NULL.
+ *
+ * Attaches an already negotiated connection to
+ * @context. milter_server_context_establish_connection()
+ * and milter_server_context_negotiate() aren't needed after
+ * this. "negotiate-reply" signal isn't emitted.
+ *
+ * Returns: %TRUE on success.
+ */
+gboolean             milter_server_context_attach_connection
+                                                       (MilterServerContext  *context,
+                                                        GIOChannel           *channel,
+                                                        MilterOption         *option,
+                                                        MilterOption         *reply_option,
+                                                        MilterMacrosRequests *macros_requests,
+                                                        GError              **error);
+
 /**
  * milter_server_context_abort:
  * @context: a %MilterServerContext.
@@ -636,6 +748,22 @@ void                 milter_server_context_set_name    (MilterServerContext *con
  */
 gdouble              milter_server_context_get_elapsed (MilterServerContext *context);
 
+/**
+ * milter_server_context_get_reply_elapsed:
+ * @context: a %MilterServerContext.
+ *
+ * Gets the elapsed time since the last command was
+ * written. It is the round trip time of the command when
+ * it is called on receiving the reply.
+ *
+ * Returns: the elapsed time since the last command of
+ * @context was written.
+ *
+ * Since: 2.1.3
+ */
+gdouble              milter_server_context_get_reply_elapsed
+                                                       (MilterServerContext *context);
+
 /**
  * milter_server_context_is_negotiated:
  * @context: a %MilterServerContext.
@@ -724,6 +852,22 @@ void                 milter_server_context_set_message_result
                                                        (MilterServerContext *context,
                                                         MilterMessageResult *result);
 
+/**
+ * milter_server_context_set_reply_handlers:
+ * @context: a %MilterServerContext.
+ * @handlers: the handlers to be called for replies from
+ *            the milter, or %NULL.
+ * @user_data: the data passed to @handlers.
+ *
+ * Sets handlers that are called directly for each reply
+ * from the milter. Reply signals are still emitted when
+ * they have connected handlers.
+ */
+void                 milter_server_context_set_reply_handlers
+                                                       (MilterServerContext       *context,
+                                                        const MilterReplyHandlers *handlers,
+                                                        gpointer                   user_data);
+
 /**
  * milter_server_context_need_reply:
  * @context: a %MilterServerContext.
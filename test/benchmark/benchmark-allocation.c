@@ -0,0 +1,95 @@
+/* -*- Mode: C; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+/*
+ *  Copyright (C) 2026  Kouhei Sutou <kou@clear-code.com>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifdef HAVE_CONFIG_H
+#  include "../../config.h"
+#endif /* HAVE_CONFIG_H */
+
+#include <stdlib.h>
+
+#include "milter-manager-benchmark.h"
+
+#ifdef __GLIBC__
+/* malloc() and friends defined in the executable are used by libc and
+ * all shared libraries instead of the ones in libc. They count calls
+ * and forward to the glibc implementation. */
+extern void *__libc_malloc  (size_t size);
+extern void *__libc_calloc  (size_t n_members, size_t size);
+extern void *__libc_realloc (void *pointer, size_t size);
+extern void  __libc_free    (void *pointer);
+
+static volatile gsize total_n_allocations = 0;
+static volatile gsize total_allocated_bytes = 0;
+
+static void
+count_allocation (size_t size)
+{
+    __sync_fetch_and_add(&total_n_allocations, 1);
+    __sync_fetch_and_add(&total_allocated_bytes, size);
+}
+
+void *
+malloc (size_t size)
+{
+    count_allocation(size);
+    return __libc_malloc(size);
+}
+
+void *
+calloc (size_t n_members, size_t size)
+{
+    count_allocation(n_members * size);
+    return __libc_calloc(n_members, size);
+}
+
+void *
+realloc (void *pointer, size_t size)
+{
+    count_allocation(size);
+    return __libc_realloc(pointer, size);
+}
+
+void
+free (void *pointer)
+{
+    __libc_free(pointer);
+}
+
+gboolean
+milter_benchmark_allocation_get_counts (gsize *n_allocations,
+                                        gsize *n_allocated_bytes)
+{
+    *n_allocations = __sync_fetch_and_add(&total_n_allocations, 0);
+    *n_allocated_bytes = __sync_fetch_and_add(&total_allocated_bytes, 0);
+    return TRUE;
+}
+#else
+gboolean
+milter_benchmark_allocation_get_counts (gsize *n_allocations,
+                                        gsize *n_allocated_bytes)
+{
+    *n_allocations = 0;
+    *n_allocated_bytes = 0;
+    return FALSE;
+}
+#endif
+
+/*
+vi:ts=4:nowrap:ai:expandtab:sw=4
+*/
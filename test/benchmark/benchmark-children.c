@@ -0,0 +1,525 @@
+/* -*- Mode: C; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+/*
+ *  Copyright (C) 2026  Kouhei Sutou <kou@clear-code.com>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#include <glib/gstdio.h>
+
+#include "milter-manager-benchmark.h"
+
+#define N_CHILDREN 2
+#define BODY_SIZE 4096
+#define REPLY_TIMEOUT 5.0
+#define N_DRAIN_ITERATIONS 100
+
+static const gchar *header_names[] = {
+    "Received",
+    "Received",
+    "Message-ID",
+    "Date",
+    "From",
+    "To",
+    "Subject",
+    "Content-Type",
+    NULL
+};
+
+static const gchar *recipients[] = {
+    "<alice@example.com>",
+    "<bob@example.com>",
+    "<charlie@example.com>",
+    NULL
+};
+
+typedef struct _ChildrenFixture ChildrenFixture;
+
+typedef struct _FakeChild
+{
+    ChildrenFixture *fixture;
+    gchar *spec;
+    gchar *path;
+    GIOChannel *listen_channel;
+    guint watch_id;
+    MilterManagerEgg *egg;
+} FakeChild;
+
+struct _ChildrenFixture
+{
+    MilterEventLoop *loop;
+    MilterManagerConfiguration *configuration;
+    MilterClient *client;
+    gchar *tmp_dir;
+    FakeChild fake_children[N_CHILDREN];
+    MilterOption *option;
+    struct sockaddr_in address;
+    gchar *body;
+    guint n_replies;
+    gboolean finished;
+    gboolean timed_out;
+    GError *error;
+};
+
+static gboolean
+cb_idle_unref_context (gpointer user_data)
+{
+    g_object_unref(user_data);
+    return FALSE;
+}
+
+static void
+cb_fake_child_finished (MilterFinishedEmittable *emittable, gpointer user_data)
+{
+    ChildrenFixture *fixture = user_data;
+
+    milter_event_loop_add_idle(fixture->loop, cb_idle_unref_context, emittable);
+}
+
+static MilterStatus
+cb_fake_child_negotiate (MilterClientContext *context, MilterOption *option,
+                         gpointer user_data)
+{
+    milter_option_remove_step(option,
+                              MILTER_STEP_ENVELOPE_RECIPIENT_REJECTED |
+                              MILTER_STEP_HEADER_VALUE_WITH_LEADING_SPACE |
+                              MILTER_STEP_NO_MASK);
+    return MILTER_STATUS_CONTINUE;
+}
+
+static MilterStatus
+cb_fake_child_connect (MilterClientContext *context, const gchar *host_name,
+                       const struct sockaddr *address, socklen_t address_length,
+                       gpointer user_data)
+{
+    return MILTER_STATUS_CONTINUE;
+}
+
+static MilterStatus
+cb_fake_child_string (MilterClientContext *context, const gchar *value,
+                      gpointer user_data)
+{
+    return MILTER_STATUS_CONTINUE;
+}
+
+static MilterStatus
+cb_fake_child_header (MilterClientContext *context,
+                      const gchar *name, const gchar *value,
+                      gpointer user_data)
+{
+    return MILTER_STATUS_CONTINUE;
+}
+
+static MilterStatus
+cb_fake_child_chunk (MilterClientContext *context,
+                     const gchar *chunk, gsize size,
+                     gpointer user_data)
+{
+    return MILTER_STATUS_CONTINUE;
+}
+
+static MilterStatus
+cb_fake_child_no_argument (MilterClientContext *context, gpointer user_data)
+{
+    return MILTER_STATUS_CONTINUE;
+}
+
+static void
+setup_fake_child_signals (ChildrenFixture *fixture,
+                          MilterClientContext *context)
+{
+#define CONNECT(name, callback)                                         \
+    g_signal_connect(context, name, G_CALLBACK(callback), fixture)
+
+    CONNECT("negotiate", cb_fake_child_negotiate);
+    CONNECT("connect", cb_fake_child_connect);
+    CONNECT("helo", cb_fake_child_string);
+    CONNECT("envelope-from", cb_fake_child_string);
+    CONNECT("envelope-recipient", cb_fake_child_string);
+    CONNECT("data", cb_fake_child_no_argument);
+    CONNECT("header", cb_fake_child_header);
+    CONNECT("end-of-header", cb_fake_child_no_argument);
+    CONNECT("body", cb_fake_child_chunk);
+    CONNECT("end-of-message", cb_fake_child_chunk);
+    CONNECT("finished", cb_fake_child_finished);
+
+#undef CONNECT
+}
+
+static gboolean
+cb_fake_child_accept (GIOChannel *channel, GIOCondition condition,
+                      gpointer user_data)
+{
+    FakeChild *fake_child = user_data;
+    ChildrenFixture *fixture = fake_child->fixture;
+    MilterClientContext *context;
+    MilterAgent *agent;
+    MilterWriter *writer;
+    MilterReader *reader;
+    GIOChannel *client_channel;
+    gint client_fd;
+    GError *error = NULL;
+
+    client_fd = accept(g_io_channel_unix_get_fd(channel), NULL, NULL);
+    if (client_fd == -1) {
+        if (errno != EAGAIN && errno != EINTR)
+            milter_error("[benchmark][children][accept][error] %s: %s",
+                         fake_child->spec, g_strerror(errno));
+        return TRUE;
+    }
+
+    client_channel = g_io_channel_unix_new(client_fd);
+    g_io_channel_set_encoding(client_channel, NULL, NULL);
+    g_io_channel_set_flags(client_channel, G_IO_FLAG_NONBLOCK, NULL);
+    g_io_channel_set_close_on_unref(client_channel, TRUE);
+
+    context = milter_client_create_context(fixture->client);
+    setup_fake_child_signals(fixture, context);
+
+    agent = MILTER_AGENT(context);
+    milter_agent_set_event_loop(agent, fixture->loop);
+    writer = milter_writer_unix_io_channel_new(client_channel);
+    milter_agent_set_writer(agent, writer);
+    g_object_unref(writer);
+    reader = milter_reader_unix_io_channel_new(client_channel);
+    milter_agent_set_reader(agent, reader);
+    g_object_unref(reader);
+    g_io_channel_unref(client_channel);
+
+    if (!milter_agent_start(agent, &error)) {
+        milter_error("[benchmark][children][start][error] %s: %s",
+                     fake_child->spec, error->message);
+        g_error_free(error);
+        g_object_unref(context);
+    }
+
+    return TRUE;
+}
+
+static gboolean
+fake_child_init (ChildrenFixture *fixture, FakeChild *fake_child, guint i,
+                 GError **error)
+{
+    gchar *name;
+
+    fake_child->fixture = fixture;
+    fake_child->path = g_strdup_printf("%s/child%u.sock", fixture->tmp_dir, i);
+    fake_child->spec = g_strdup_printf("unix:%s", fake_child->path);
+    fake_child->listen_channel = milter_connection_listen(fake_child->spec,
+                                                          N_CHILDREN * 16,
+                                                          NULL, NULL,
+                                                          TRUE,
+                                                          error);
+    if (!fake_child->listen_channel)
+        return FALSE;
+    fake_child->watch_id =
+        milter_event_loop_watch_io(fixture->loop,
+                                   fake_child->listen_channel,
+                                   G_IO_IN | G_IO_PRI,
+                                   cb_fake_child_accept,
+                                   fake_child);
+
+    name = g_strdup_printf("benchmark%u", i);
+    fake_child->egg = milter_manager_egg_new(name);
+    g_free(name);
+    return milter_manager_egg_set_connection_spec(fake_child->egg,
+                                                  fake_child->spec,
+                                                  error);
+}
+
+static void
+fake_child_fin (ChildrenFixture *fixture, FakeChild *fake_child)
+{
+    if (fake_child->watch_id > 0)
+        milter_event_loop_remove(fixture->loop, fake_child->watch_id);
+    if (fake_child->listen_channel)
+        g_io_channel_unref(fake_child->listen_channel);
+    if (fake_child->egg)
+        g_object_unref(fake_child->egg);
+    if (fake_child->path)
+        g_unlink(fake_child->path);
+    g_free(fake_child->path);
+    g_free(fake_child->spec);
+}
+
+static void
+children_teardown (gpointer data)
+{
+    ChildrenFixture *fixture = data;
+    guint i;
+
+    for (i = 0; i < N_DRAIN_ITERATIONS; i++) {
+        milter_event_loop_iterate(fixture->loop, FALSE);
+    }
+    for (i = 0; i < N_CHILDREN; i++) {
+        fake_child_fin(fixture, &(fixture->fake_children[i]));
+    }
+    if (fixture->tmp_dir) {
+        g_rmdir(fixture->tmp_dir);
+        g_free(fixture->tmp_dir);
+    }
+    g_object_unref(fixture->option);
+    g_object_unref(fixture->client);
+    g_object_unref(fixture->configuration);
+    g_object_unref(fixture->loop);
+    g_free(fixture->body);
+    g_free(fixture);
+}
+
+static gpointer
+children_setup (gpointer user_data, GError **error)
+{
+    ChildrenFixture *fixture;
+    guint i;
+
+    fixture = g_new0(ChildrenFixture, 1);
+    fixture->loop = milter_libev_event_loop_new();
+    fixture->configuration = milter_manager_configuration_new(NULL);
+    fixture->client = milter_client_new();
+    fixture->option = milter_option_new(6,
+                                        MILTER_ACTION_ADD_HEADERS |
+                                        MILTER_ACTION_CHANGE_HEADERS,
+                                        MILTER_STEP_NONE);
+    fixture->address.sin_family = AF_INET;
+    fixture->address.sin_port = g_htons(50443);
+    inet_pton(AF_INET, "192.0.2.1", &(fixture->address.sin_addr));
+    fixture->body = g_malloc(BODY_SIZE);
+    memset(fixture->body, 'a', BODY_SIZE);
+
+    fixture->tmp_dir = g_build_filename(g_get_tmp_dir(),
+                                        "milter-manager-benchmark-XXXXXX",
+                                        NULL);
+    if (!mkdtemp(fixture->tmp_dir)) {
+        g_set_error(error,
+                    MILTER_BENCHMARK_ERROR,
+                    MILTER_BENCHMARK_ERROR_SETUP,
+                    "failed to create temporary directory: %s: %s",
+                    fixture->tmp_dir, g_strerror(errno));
+        g_free(fixture->tmp_dir);
+        fixture->tmp_dir = NULL;
+        children_teardown(fixture);
+        return NULL;
+    }
+
+    for (i = 0; i < N_CHILDREN; i++) {
+        if (!fake_child_init(fixture, &(fixture->fake_children[i]), i, error)) {
+            children_teardown(fixture);
+            return NULL;
+        }
+    }
+
+    return fixture;
+}
+
+static void
+cb_reply (MilterManagerChildren *children, gpointer user_data)
+{
+    ChildrenFixture *fixture = user_data;
+
+    fixture->n_replies++;
+}
+
+static void
+cb_negotiate_reply (MilterManagerChildren *children,
+                    MilterOption *option, MilterMacrosRequests *macros_requests,
+                    gpointer user_data)
+{
+    cb_reply(children, user_data);
+}
+
+static void
+cb_error (MilterManagerChildren *children, GError *error, gpointer user_data)
+{
+    ChildrenFixture *fixture = user_data;
+
+    if (!fixture->error)
+        fixture->error = g_error_copy(error);
+}
+
+static void
+cb_finished (MilterManagerChildren *children, gpointer user_data)
+{
+    ChildrenFixture *fixture = user_data;
+
+    fixture->finished = TRUE;
+}
+
+static gboolean
+cb_timeout (gpointer user_data)
+{
+    ChildrenFixture *fixture = user_data;
+
+    fixture->timed_out = TRUE;
+    return FALSE;
+}
+
+static gboolean
+wait_reply (ChildrenFixture *fixture, guint n_expected_replies,
+            const gchar *stage, GError **error)
+{
+    guint timeout_id;
+
+    fixture->timed_out = FALSE;
+    timeout_id = milter_event_loop_add_timeout(fixture->loop, REPLY_TIMEOUT,
+                                               cb_timeout, fixture);
+    while (!fixture->timed_out &&
+           !fixture->error &&
+           fixture->n_replies < n_expected_replies) {
+        milter_event_loop_iterate(fixture->loop, TRUE);
+    }
+    if (!fixture->timed_out)
+        milter_event_loop_remove(fixture->loop, timeout_id);
+
+    if (fixture->error) {
+        g_propagate_error(error, fixture->error);
+        fixture->error = NULL;
+        return FALSE;
+    }
+    if (fixture->timed_out) {
+        g_set_error(error,
+                    MILTER_BENCHMARK_ERROR,
+                    MILTER_BENCHMARK_ERROR_TIMEOUT,
+                    "timed out waiting for reply to %s", stage);
+        return FALSE;
+    }
+    return TRUE;
+}
+
+static gboolean
+run_session (ChildrenFixture *fixture, MilterManagerChildren *children,
+             GError **error)
+{
+    guint i;
+
+#define STEP(stage, command) do {                                       \
+        guint n_expected_replies = fixture->n_replies + 1;              \
+        if (!(command)) {                                               \
+            g_set_error(error,                                          \
+                        MILTER_BENCHMARK_ERROR,                         \
+                        MILTER_BENCHMARK_ERROR_UNEXPECTED,              \
+                        "failed to send %s", stage);                    \
+            return FALSE;                                               \
+        }                                                               \
+        if (!wait_reply(fixture, n_expected_replies, stage, error))     \
+            return FALSE;                                               \
+    } while (0)
+
+    STEP("negotiate",
+         milter_manager_children_negotiate(children, fixture->option, NULL));
+    STEP("connect",
+         milter_manager_children_connect(children,
+                                         "mx.example.net",
+                                         (struct sockaddr *)&(fixture->address),
+                                         sizeof(fixture->address)));
+    STEP("helo",
+         milter_manager_children_helo(children, "mx.example.net"));
+    STEP("envelope-from",
+         milter_manager_children_envelope_from(children,
+                                               "<sender@example.net>"));
+    for (i = 0; recipients[i]; i++) {
+        STEP("envelope-recipient",
+             milter_manager_children_envelope_recipient(children,
+                                                        recipients[i]));
+    }
+    STEP("data", milter_manager_children_data(children));
+    for (i = 0; header_names[i]; i++) {
+        STEP("header",
+             milter_manager_children_header(children,
+                                            header_names[i],
+                                            "by mx.example.net (Postfix) "
+                                            "with ESMTP id 4A2B3C4D5E"));
+    }
+    STEP("end-of-header", milter_manager_children_end_of_header(children));
+    STEP("body",
+         milter_manager_children_body(children, fixture->body, BODY_SIZE));
+    STEP("end-of-message",
+         milter_manager_children_end_of_message(children, NULL, 0));
+
+#undef STEP
+
+    milter_manager_children_quit(children);
+    if (!fixture->finished) {
+        g_set_error(error,
+                    MILTER_BENCHMARK_ERROR,
+                    MILTER_BENCHMARK_ERROR_UNEXPECTED,
+                    "children aren't finished after quit");
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
+static gboolean
+run_children_session (gpointer data, GError **error)
+{
+    ChildrenFixture *fixture = data;
+    MilterManagerChildren *children;
+    gboolean success;
+    guint i;
+
+    children = milter_manager_children_new(fixture->configuration,
+                                           fixture->loop);
+    for (i = 0; i < N_CHILDREN; i++) {
+        MilterManagerChild *child;
+
+        child = milter_manager_egg_hatch(fixture->fake_children[i].egg);
+        milter_manager_children_add_child(children, child);
+        g_object_unref(child);
+    }
+
+#define CONNECT(name, callback)                                         \
+    g_signal_connect(children, name, G_CALLBACK(callback), fixture)
+
+    CONNECT("negotiate-reply", cb_negotiate_reply);
+    CONNECT("continue", cb_reply);
+    CONNECT("temporary-failure", cb_reply);
+    CONNECT("reject", cb_reply);
+    CONNECT("accept", cb_reply);
+    CONNECT("discard", cb_reply);
+    CONNECT("skip", cb_reply);
+    CONNECT("error", cb_error);
+    CONNECT("finished", cb_finished);
+
+#undef CONNECT
+
+    fixture->n_replies = 0;
+    fixture->finished = FALSE;
+    success = run_session(fixture, children, error);
+    g_signal_handlers_disconnect_matched(children, G_SIGNAL_MATCH_DATA,
+                                         0, 0, NULL, NULL, fixture);
+    g_object_unref(children);
+
+    return success;
+}
+
+void
+milter_benchmark_children_register (void)
+{
+    milter_benchmark_register("children/session",
+                              children_setup, run_children_session,
+                              children_teardown, NULL, NULL);
+}
+
+/*
+vi:ts=4:nowrap:ai:expandtab:sw=4
+*/
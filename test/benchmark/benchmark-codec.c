@@ -0,0 +1,287 @@
+/* -*- Mode: C; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+/*
+ *  Copyright (C) 2026  Kouhei Sutou <kou@clear-code.com>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <string.h>
+
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#include "milter-manager-benchmark.h"
+
+#define BODY_SIZE 4096
+
+/*
+ * One operation encodes or decodes all packets of a typical SMTP
+ * session: negotiation, a connection with macros, three recipients,
+ * a 4KiB body and the headers below.
+ */
+static const gchar *header_names[] = {
+    "Return-Path",
+    "Received",
+    "Received",
+    "Received",
+    "DKIM-Signature",
+    "Message-ID",
+    "Date",
+    "From",
+    "To",
+    "Subject",
+    "MIME-Version",
+    "Content-Type",
+    NULL
+};
+
+static const gchar *recipients[] = {
+    "<alice@example.com>",
+    "<bob@example.com>",
+    "<charlie@example.com>",
+    NULL
+};
+
+typedef struct _CodecFixture
+{
+    MilterEncoder *command_encoder;
+    MilterEncoder *reply_encoder;
+    MilterDecoder *command_decoder;
+    MilterDecoder *reply_decoder;
+    MilterOption *option;
+    MilterMacrosRequests *macros_requests;
+    GHashTable *connect_macros;
+    struct sockaddr_in address;
+    gchar *body;
+    GString *command_packets;
+    GString *reply_packets;
+} CodecFixture;
+
+static void
+encode_commands (CodecFixture *fixture, GString *output)
+{
+    MilterCommandEncoder *encoder;
+    const gchar *packet;
+    gsize packet_size, packed_size;
+    gint i;
+
+    encoder = MILTER_COMMAND_ENCODER(fixture->command_encoder);
+
+#define APPEND() do {                                           \
+        if (output)                                             \
+            g_string_append_len(output, packet, packet_size);   \
+    } while (0)
+
+    milter_command_encoder_encode_negotiate(encoder, &packet, &packet_size,
+                                            fixture->option);
+    APPEND();
+    milter_command_encoder_encode_define_macro(encoder, &packet, &packet_size,
+                                               MILTER_COMMAND_CONNECT,
+                                               fixture->connect_macros);
+    APPEND();
+    milter_command_encoder_encode_connect(encoder, &packet, &packet_size,
+                                          "mx.example.net",
+                                          (struct sockaddr *)&(fixture->address),
+                                          sizeof(fixture->address));
+    APPEND();
+    milter_command_encoder_encode_helo(encoder, &packet, &packet_size,
+                                       "mx.example.net");
+    APPEND();
+    milter_command_encoder_encode_envelope_from(encoder,
+                                                &packet, &packet_size,
+                                                "<sender@example.net>");
+    APPEND();
+    for (i = 0; recipients[i]; i++) {
+        milter_command_encoder_encode_envelope_recipient(encoder,
+                                                         &packet, &packet_size,
+                                                         recipients[i]);
+        APPEND();
+    }
+    milter_command_encoder_encode_data(encoder, &packet, &packet_size);
+    APPEND();
+    for (i = 0; header_names[i]; i++) {
+        milter_command_encoder_encode_header(encoder, &packet, &packet_size,
+                                             header_names[i],
+                                             "by mx.example.net (Postfix) "
+                                             "with ESMTP id 4A2B3C4D5E");
+        APPEND();
+    }
+    milter_command_encoder_encode_end_of_header(encoder,
+                                                &packet, &packet_size);
+    APPEND();
+    milter_command_encoder_encode_body(encoder, &packet, &packet_size,
+                                       fixture->body, BODY_SIZE,
+                                       &packed_size);
+    APPEND();
+    milter_command_encoder_encode_end_of_message(encoder,
+                                                 &packet, &packet_size,
+                                                 NULL, 0);
+    APPEND();
+    milter_command_encoder_encode_quit(encoder, &packet, &packet_size);
+    APPEND();
+}
+
+static void
+encode_replies (CodecFixture *fixture, GString *output)
+{
+    MilterReplyEncoder *encoder;
+    const gchar *packet;
+    gsize packet_size;
+    gint i, n_continues;
+
+    encoder = MILTER_REPLY_ENCODER(fixture->reply_encoder);
+
+    milter_reply_encoder_encode_negotiate(encoder, &packet, &packet_size,
+                                          fixture->option,
+                                          fixture->macros_requests);
+    APPEND();
+    /* connect, helo, envelope-from, recipients, data, headers,
+     * end-of-header and body */
+    n_continues = 3 + G_N_ELEMENTS(recipients) - 1 + 1 +
+        G_N_ELEMENTS(header_names) - 1 + 2;
+    for (i = 0; i < n_continues; i++) {
+        milter_reply_encoder_encode_continue(encoder, &packet, &packet_size);
+        APPEND();
+    }
+    milter_reply_encoder_encode_add_header(encoder, &packet, &packet_size,
+                                           "X-Virus-Status", "Clean");
+    APPEND();
+    milter_reply_encoder_encode_change_header(encoder, &packet, &packet_size,
+                                              "Subject", 1,
+                                              "[SPAM] Subject");
+    APPEND();
+    milter_reply_encoder_encode_accept(encoder, &packet, &packet_size);
+    APPEND();
+
+#undef APPEND
+}
+
+static gpointer
+codec_setup (gpointer user_data, GError **error)
+{
+    CodecFixture *fixture;
+
+    fixture = g_new0(CodecFixture, 1);
+    fixture->command_encoder = milter_command_encoder_new();
+    fixture->reply_encoder = milter_reply_encoder_new();
+    fixture->command_decoder = milter_command_decoder_new();
+    fixture->reply_decoder = milter_reply_decoder_new();
+    fixture->option = milter_option_new(6,
+                                        MILTER_ACTION_ADD_HEADERS |
+                                        MILTER_ACTION_CHANGE_HEADERS,
+                                        MILTER_STEP_NO_UNKNOWN);
+    fixture->macros_requests = milter_macros_requests_new();
+    milter_macros_requests_set_symbols(fixture->macros_requests,
+                                       MILTER_COMMAND_ENVELOPE_FROM,
+                                       "{auth_authen}", "{mail_addr}",
+                                       NULL);
+    fixture->connect_macros = g_hash_table_new(g_str_hash, g_str_equal);
+    g_hash_table_insert(fixture->connect_macros,
+                        "j", "mx.example.net");
+    g_hash_table_insert(fixture->connect_macros,
+                        "daemon_name", "mx.example.net");
+    g_hash_table_insert(fixture->connect_macros,
+                        "v", "Postfix 3.7.3");
+    g_hash_table_insert(fixture->connect_macros,
+                        "{client_addr}", "192.0.2.1");
+    fixture->address.sin_family = AF_INET;
+    fixture->address.sin_port = g_htons(50443);
+    inet_pton(AF_INET, "192.0.2.1", &(fixture->address.sin_addr));
+    fixture->body = g_malloc(BODY_SIZE);
+    memset(fixture->body, 'a', BODY_SIZE);
+
+    fixture->command_packets = g_string_new(NULL);
+    encode_commands(fixture, fixture->command_packets);
+    fixture->reply_packets = g_string_new(NULL);
+    encode_replies(fixture, fixture->reply_packets);
+
+    return fixture;
+}
+
+static void
+codec_teardown (gpointer data)
+{
+    CodecFixture *fixture = data;
+
+    g_object_unref(fixture->command_encoder);
+    g_object_unref(fixture->reply_encoder);
+    g_object_unref(fixture->command_decoder);
+    g_object_unref(fixture->reply_decoder);
+    g_object_unref(fixture->option);
+    g_object_unref(fixture->macros_requests);
+    g_hash_table_unref(fixture->connect_macros);
+    g_free(fixture->body);
+    g_string_free(fixture->command_packets, TRUE);
+    g_string_free(fixture->reply_packets, TRUE);
+    g_free(fixture);
+}
+
+static gboolean
+run_command_encoder (gpointer data, GError **error)
+{
+    encode_commands(data, NULL);
+    return TRUE;
+}
+
+static gboolean
+run_command_decoder (gpointer data, GError **error)
+{
+    CodecFixture *fixture = data;
+
+    return milter_decoder_decode(fixture->command_decoder,
+                                 fixture->command_packets->str,
+                                 fixture->command_packets->len,
+                                 error);
+}
+
+static gboolean
+run_reply_encoder (gpointer data, GError **error)
+{
+    encode_replies(data, NULL);
+    return TRUE;
+}
+
+static gboolean
+run_reply_decoder (gpointer data, GError **error)
+{
+    CodecFixture *fixture = data;
+
+    return milter_decoder_decode(fixture->reply_decoder,
+                                 fixture->reply_packets->str,
+                                 fixture->reply_packets->len,
+                                 error);
+}
+
+void
+milter_benchmark_codec_register (void)
+{
+    milter_benchmark_register("command-encoder/session",
+                              codec_setup, run_command_encoder,
+                              codec_teardown, NULL, NULL);
+    milter_benchmark_register("command-decoder/session",
+                              codec_setup, run_command_decoder,
+                              codec_teardown, NULL, NULL);
+    milter_benchmark_register("reply-encoder/session",
+                              codec_setup, run_reply_encoder,
+                              codec_teardown, NULL, NULL);
+    milter_benchmark_register("reply-decoder/session",
+                              codec_setup, run_reply_decoder,
+                              codec_teardown, NULL, NULL);
+}
+
+/*
+vi:ts=4:nowrap:ai:expandtab:sw=4
+*/
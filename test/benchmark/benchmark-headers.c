@@ -0,0 +1,166 @@
+/* -*- Mode: C; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+/*
+ *  Copyright (C) 2026  Kouhei Sutou <kou@clear-code.com>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "milter-manager-benchmark.h"
+
+static const gchar *fixed_names[] = {
+    "From",
+    "To",
+    "Subject",
+    "Date",
+    "Message-ID",
+    NULL
+};
+
+typedef struct _HeadersFixture
+{
+    guint n_headers;
+    gchar **names;
+    gchar **values;
+    MilterHeaders *headers;
+    guint n_lookups;
+} HeadersFixture;
+
+static gpointer
+headers_setup (gpointer user_data, GError **error)
+{
+    HeadersFixture *fixture;
+    guint i, n_fixed_names;
+
+    fixture = g_new0(HeadersFixture, 1);
+    fixture->n_headers = GPOINTER_TO_UINT(user_data);
+    fixture->names = g_new0(gchar *, fixture->n_headers + 1);
+    fixture->values = g_new0(gchar *, fixture->n_headers + 1);
+
+    /* Real messages repeat Received: many times. */
+    n_fixed_names = G_N_ELEMENTS(fixed_names) - 1;
+    for (i = 0; i < fixture->n_headers; i++) {
+        if (i < n_fixed_names)
+            fixture->names[i] = g_strdup(fixed_names[i]);
+        else if (i % 3 == 0)
+            fixture->names[i] = g_strdup("Received");
+        else
+            fixture->names[i] = g_strdup_printf("X-Benchmark-%u", i);
+        fixture->values[i] =
+            g_strdup_printf("from mx%u.example.net (mx%u.example.net "
+                            "[192.0.2.%u]) by mx.example.com", i, i, i % 256);
+    }
+
+    fixture->headers = milter_headers_new();
+    for (i = 0; i < fixture->n_headers; i++) {
+        milter_headers_append_header(fixture->headers,
+                                     fixture->names[i], fixture->values[i]);
+    }
+
+    return fixture;
+}
+
+static void
+headers_teardown (gpointer data)
+{
+    HeadersFixture *fixture = data;
+
+    g_strfreev(fixture->names);
+    g_strfreev(fixture->values);
+    g_object_unref(fixture->headers);
+    g_free(fixture);
+}
+
+static gboolean
+run_append (gpointer data, GError **error)
+{
+    HeadersFixture *fixture = data;
+    MilterHeaders *headers;
+    guint i;
+
+    headers = milter_headers_new();
+    for (i = 0; i < fixture->n_headers; i++) {
+        milter_headers_append_header(headers,
+                                     fixture->names[i], fixture->values[i]);
+    }
+    g_object_unref(headers);
+
+    return TRUE;
+}
+
+static gboolean
+run_lookup (gpointer data, GError **error)
+{
+    HeadersFixture *fixture = data;
+    const gchar *name;
+    guint i;
+
+    i = fixture->n_lookups++ % (fixture->n_headers + 1);
+    if (i == fixture->n_headers)
+        name = "X-Nonexistent";
+    else
+        name = fixture->names[i];
+    milter_headers_lookup_by_name(fixture->headers, name);
+
+    return TRUE;
+}
+
+static gboolean
+run_copy_change (gpointer data, GError **error)
+{
+    HeadersFixture *fixture = data;
+    MilterHeaders *headers;
+
+    /* What the leader does for each child that modifies headers. */
+    headers = milter_headers_copy(fixture->headers);
+    milter_headers_change_header(headers, "Subject", 1, "[SPAM] Subject");
+    milter_headers_add_header(headers, "X-Spam-Flag", "YES");
+    milter_headers_delete_header(headers, "Received", 1);
+    g_object_unref(headers);
+
+    return TRUE;
+}
+
+void
+milter_benchmark_headers_register (void)
+{
+    static const guint sizes[] = {10, 100, 500};
+    guint i;
+
+    for (i = 0; i < G_N_ELEMENTS(sizes); i++) {
+        gchar *name;
+        gpointer size;
+
+        size = GUINT_TO_POINTER(sizes[i]);
+
+        name = g_strdup_printf("headers/append/%u", sizes[i]);
+        milter_benchmark_register(name, headers_setup, run_append,
+                                  headers_teardown, size, NULL);
+        g_free(name);
+
+        name = g_strdup_printf("headers/lookup/%u", sizes[i]);
+        milter_benchmark_register(name, headers_setup, run_lookup,
+                                  headers_teardown, size, NULL);
+        g_free(name);
+
+        name = g_strdup_printf("headers/copy-change/%u", sizes[i]);
+        milter_benchmark_register(name, headers_setup, run_copy_change,
+                                  headers_teardown, size, NULL);
+        g_free(name);
+    }
+}
+
+/*
+vi:ts=4:nowrap:ai:expandtab:sw=4
+*/
@@ -0,0 +1,122 @@
+/* -*- Mode: C; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+/*
+ *  Copyright (C) 2026  Kouhei Sutou <kou@clear-code.com>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "milter-manager-benchmark.h"
+
+typedef struct _MacrosFixture
+{
+    MilterProtocolAgent *agent;
+    gboolean in_end_of_message;
+} MacrosFixture;
+
+static gpointer
+macros_setup (gpointer user_data, GError **error)
+{
+    MacrosFixture *fixture;
+    MilterProtocolAgent *agent;
+
+    fixture = g_new0(MacrosFixture, 1);
+    fixture->agent = MILTER_PROTOCOL_AGENT(milter_server_context_new());
+    agent = fixture->agent;
+
+    /* Macros that Postfix sends by default. */
+    milter_protocol_agent_set_macros(agent, MILTER_COMMAND_CONNECT,
+                                     "j", "mx.example.net",
+                                     "{daemon_name}", "mx.example.net",
+                                     "v", "Postfix 3.7.3",
+                                     "{client_addr}", "192.0.2.1",
+                                     "{client_name}", "mx.example.org",
+                                     NULL);
+    milter_protocol_agent_set_macros(agent, MILTER_COMMAND_HELO,
+                                     "{tls_version}", "TLSv1.3",
+                                     "{cipher}", "TLS_AES_256_GCM_SHA384",
+                                     "{cipher_bits}", "256",
+                                     NULL);
+    milter_protocol_agent_set_macros(agent, MILTER_COMMAND_ENVELOPE_FROM,
+                                     "i", "4A2B3C4D5E",
+                                     "{mail_mailer}", "smtp",
+                                     "{mail_host}", "example.org",
+                                     "{mail_addr}", "sender@example.org",
+                                     NULL);
+    milter_protocol_agent_set_macros(agent, MILTER_COMMAND_ENVELOPE_RECIPIENT,
+                                     "{rcpt_mailer}", "local",
+                                     "{rcpt_host}", "example.com",
+                                     "{rcpt_addr}", "alice@example.com",
+                                     NULL);
+    milter_protocol_agent_set_macros(agent, MILTER_COMMAND_END_OF_MESSAGE,
+                                     "{msg_id}", "<1234@example.org>",
+                                     NULL);
+    milter_protocol_agent_set_macro_context(agent,
+                                            MILTER_COMMAND_END_OF_MESSAGE);
+    fixture->in_end_of_message = TRUE;
+
+    return fixture;
+}
+
+static void
+macros_teardown (gpointer data)
+{
+    MacrosFixture *fixture = data;
+
+    g_object_unref(fixture->agent);
+    g_free(fixture);
+}
+
+static gboolean
+run_cached (gpointer data, GError **error)
+{
+    MacrosFixture *fixture = data;
+
+    milter_protocol_agent_get_available_macros(fixture->agent);
+
+    return TRUE;
+}
+
+static gboolean
+run_rebuild (gpointer data, GError **error)
+{
+    MacrosFixture *fixture = data;
+    MilterCommand context;
+
+    /* Changing the context invalidates the merged macros. */
+    fixture->in_end_of_message = !fixture->in_end_of_message;
+    if (fixture->in_end_of_message)
+        context = MILTER_COMMAND_END_OF_MESSAGE;
+    else
+        context = MILTER_COMMAND_ENVELOPE_RECIPIENT;
+    milter_protocol_agent_set_macro_context(fixture->agent, context);
+    milter_protocol_agent_get_available_macros(fixture->agent);
+
+    return TRUE;
+}
+
+void
+milter_benchmark_macros_register (void)
+{
+    milter_benchmark_register("available-macros/cached",
+                              macros_setup, run_cached, macros_teardown,
+                              NULL, NULL);
+    milter_benchmark_register("available-macros/rebuild",
+                              macros_setup, run_rebuild, macros_teardown,
+                              NULL, NULL);
+}
+
+/*
+vi:ts=4:nowrap:ai:expandtab:sw=4
+*/
@@ -0,0 +1,288 @@
+/* -*- Mode: C; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+/*
+ *  Copyright (C) 2026  Kouhei Sutou <kou@clear-code.com>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifdef HAVE_CONFIG_H
+#  include "../../config.h"
+#endif /* HAVE_CONFIG_H */
+
+#include <stdlib.h>
+#include <glib/gi18n.h>
+
+#ifdef HAVE_LOCALE_H
+#  include <locale.h>
+#endif
+
+#include "milter-manager-benchmark.h"
+
+#define DEFAULT_TIME 1.0
+#define MAX_ITERATIONS_GROWTH 100
+
+typedef struct _Benchmark
+{
+    gchar *name;
+    MilterBenchmarkSetupFunc setup;
+    MilterBenchmarkRunFunc run;
+    MilterBenchmarkTeardownFunc teardown;
+    gpointer user_data;
+    GDestroyNotify destroy;
+} Benchmark;
+
+typedef struct _Measurement
+{
+    guint64 n_iterations;
+    gdouble elapsed;
+    gboolean have_allocation_counts;
+    gsize n_allocations;
+    gsize allocated_bytes;
+} Measurement;
+
+static GList *benchmarks = NULL;
+
+static gdouble min_time = DEFAULT_TIME;
+static gchar *filter = NULL;
+static gboolean list_only = FALSE;
+
+GQuark
+milter_benchmark_error_quark (void)
+{
+    return g_quark_from_static_string("milter-benchmark-error-quark");
+}
+
+void
+milter_benchmark_register (const gchar *name,
+                           MilterBenchmarkSetupFunc setup,
+                           MilterBenchmarkRunFunc run,
+                           MilterBenchmarkTeardownFunc teardown,
+                           gpointer user_data,
+                           GDestroyNotify destroy)
+{
+    Benchmark *benchmark;
+
+    benchmark = g_new0(Benchmark, 1);
+    benchmark->name = g_strdup(name);
+    benchmark->setup = setup;
+    benchmark->run = run;
+    benchmark->teardown = teardown;
+    benchmark->user_data = user_data;
+    benchmark->destroy = destroy;
+    benchmarks = g_list_append(benchmarks, benchmark);
+}
+
+static void
+benchmark_free (Benchmark *benchmark)
+{
+    if (benchmark->destroy)
+        benchmark->destroy(benchmark->user_data);
+    g_free(benchmark->name);
+    g_free(benchmark);
+}
+
+static gboolean
+measure (Benchmark *benchmark, gpointer fixture, guint64 n_iterations,
+         Measurement *measurement, GError **error)
+{
+    GTimer *timer;
+    gsize n_allocations_before, n_allocations_after;
+    gsize allocated_before, allocated_after;
+    guint64 i;
+    gboolean success = TRUE;
+
+    timer = g_timer_new();
+    measurement->have_allocation_counts =
+        milter_benchmark_allocation_get_counts(&n_allocations_before,
+                                               &allocated_before);
+    g_timer_start(timer);
+    for (i = 0; success && i < n_iterations; i++) {
+        success = benchmark->run(fixture, error);
+    }
+    g_timer_stop(timer);
+    milter_benchmark_allocation_get_counts(&n_allocations_after,
+                                           &allocated_after);
+
+    measurement->n_iterations = n_iterations;
+    measurement->elapsed = g_timer_elapsed(timer, NULL);
+    measurement->n_allocations = n_allocations_after - n_allocations_before;
+    measurement->allocated_bytes = allocated_after - allocated_before;
+    g_timer_destroy(timer);
+
+    return success;
+}
+
+static guint64
+next_n_iterations (const Measurement *measurement)
+{
+    gdouble estimated;
+    guint64 n_iterations;
+
+    n_iterations = measurement->n_iterations;
+    if (measurement->elapsed <= 0.0)
+        return n_iterations * MAX_ITERATIONS_GROWTH;
+
+    estimated = n_iterations * (min_time / measurement->elapsed) * 1.2;
+    if (estimated < n_iterations * 2)
+        return n_iterations * 2;
+    if (estimated > n_iterations * MAX_ITERATIONS_GROWTH)
+        return n_iterations * MAX_ITERATIONS_GROWTH;
+    return (guint64)estimated;
+}
+
+static void
+print_measurement (Benchmark *benchmark, const Measurement *measurement)
+{
+    gdouble n_iterations;
+
+    n_iterations = (gdouble)measurement->n_iterations;
+    g_print("%s\t%" G_GUINT64_FORMAT "\t%.1f\t%.1f",
+            benchmark->name,
+            measurement->n_iterations,
+            measurement->elapsed * 1000000000.0 / n_iterations,
+            measurement->elapsed > 0.0 ?
+            n_iterations / measurement->elapsed : 0.0);
+    if (measurement->have_allocation_counts) {
+        g_print("\t%.2f\t%.1f\n",
+                measurement->n_allocations / n_iterations,
+                measurement->allocated_bytes / n_iterations);
+    } else {
+        g_print("\t-\t-\n");
+    }
+}
+
+static gboolean
+run_benchmark (Benchmark *benchmark)
+{
+    gpointer fixture;
+    Measurement measurement;
+    GError *error = NULL;
+    gboolean success;
+
+    fixture = benchmark->setup(benchmark->user_data, &error);
+    if (!fixture) {
+        g_printerr("%s: %s\n", benchmark->name, error->message);
+        g_error_free(error);
+        return FALSE;
+    }
+
+    success = measure(benchmark, fixture, 1, &measurement, &error);
+    while (success) {
+        success = measure(benchmark, fixture,
+                          next_n_iterations(&measurement),
+                          &measurement, &error);
+        if (success && measurement.elapsed >= min_time)
+            break;
+    }
+
+    if (success) {
+        print_measurement(benchmark, &measurement);
+    } else {
+        g_printerr("%s: %s\n", benchmark->name, error->message);
+        g_error_free(error);
+    }
+    benchmark->teardown(fixture);
+
+    return success;
+}
+
+static const GOptionEntry option_entries[] =
+{
+    {"time", 0, 0, G_OPTION_ARG_DOUBLE, &min_time,
+     N_("Run each benchmark at least SECONDS seconds. "
+        "(" G_STRINGIFY(DEFAULT_TIME) ")"),
+     "SECONDS"},
+    {"filter", 0, 0, G_OPTION_ARG_STRING, &filter,
+     N_("Run only benchmarks whose name matches REGEXP."), "REGEXP"},
+    {"list", 0, 0, G_OPTION_ARG_NONE, &list_only,
+     N_("List benchmark names and exit."), NULL},
+    {NULL}
+};
+
+int
+main (int argc, char *argv[])
+{
+    gboolean success = TRUE;
+    GError *error = NULL;
+    GOptionContext *option_context;
+    GRegex *filter_regex = NULL;
+    GList *node;
+
+#ifdef HAVE_LOCALE_H
+    setlocale(LC_ALL, "");
+#endif
+
+    /* Count GSlice allocations by malloc(). */
+    if (!g_getenv("G_SLICE"))
+        g_setenv("G_SLICE", "always-malloc", TRUE);
+
+    milter_init();
+
+    option_context = g_option_context_new(NULL);
+    g_option_context_add_main_entries(option_context, option_entries, NULL);
+    if (!g_option_context_parse(option_context, &argc, &argv, &error)) {
+        g_print("%s\n", error->message);
+        g_error_free(error);
+        g_option_context_free(option_context);
+        milter_quit();
+        exit(EXIT_FAILURE);
+    }
+    g_option_context_free(option_context);
+
+    if (filter) {
+        filter_regex = g_regex_new(filter, 0, 0, &error);
+        if (!filter_regex) {
+            g_print("%s\n", error->message);
+            g_error_free(error);
+            milter_quit();
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    milter_benchmark_codec_register();
+    milter_benchmark_headers_register();
+    milter_benchmark_macros_register();
+    milter_benchmark_children_register();
+
+    if (!list_only)
+        g_print("# name\titerations\tns/op\tops/s\tallocations/op\tbytes/op\n");
+    for (node = benchmarks; node; node = g_list_next(node)) {
+        Benchmark *benchmark = node->data;
+
+        if (filter_regex &&
+            !g_regex_match(filter_regex, benchmark->name, 0, NULL))
+            continue;
+        if (list_only) {
+            g_print("%s\n", benchmark->name);
+            continue;
+        }
+        if (!run_benchmark(benchmark))
+            success = FALSE;
+    }
+
+    g_list_foreach(benchmarks, (GFunc)benchmark_free, NULL);
+    g_list_free(benchmarks);
+    if (filter_regex)
+        g_regex_unref(filter_regex);
+    g_free(filter);
+
+    milter_quit();
+
+    return success ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+/*
+vi:ts=4:nowrap:ai:expandtab:sw=4
+*/
@@ -0,0 +1,66 @@
+/* -*- Mode: C; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+/*
+ *  Copyright (C) 2026  Kouhei Sutou <kou@clear-code.com>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef __MILTER_MANAGER_BENCHMARK_H__
+#define __MILTER_MANAGER_BENCHMARK_H__
+
+#include <milter/manager.h>
+
+G_BEGIN_DECLS
+
+#define MILTER_BENCHMARK_ERROR           (milter_benchmark_error_quark())
+
+typedef enum
+{
+    MILTER_BENCHMARK_ERROR_SETUP,
+    MILTER_BENCHMARK_ERROR_TIMEOUT,
+    MILTER_BENCHMARK_ERROR_UNEXPECTED
+} MilterBenchmarkError;
+
+typedef gpointer (*MilterBenchmarkSetupFunc)    (gpointer user_data,
+                                                 GError **error);
+typedef gboolean (*MilterBenchmarkRunFunc)      (gpointer fixture,
+                                                 GError **error);
+typedef void     (*MilterBenchmarkTeardownFunc) (gpointer fixture);
+
+GQuark   milter_benchmark_error_quark       (void);
+
+gboolean milter_benchmark_allocation_get_counts
+                                            (gsize *n_allocations,
+                                             gsize *n_allocated_bytes);
+
+void     milter_benchmark_register          (const gchar *name,
+                                             MilterBenchmarkSetupFunc setup,
+                                             MilterBenchmarkRunFunc run,
+                                             MilterBenchmarkTeardownFunc teardown,
+                                             gpointer user_data,
+                                             GDestroyNotify destroy);
+
+void     milter_benchmark_codec_register    (void);
+void     milter_benchmark_headers_register  (void);
+void     milter_benchmark_macros_register   (void);
+void     milter_benchmark_children_register (void);
+
+G_END_DECLS
+
+#endif /* __MILTER_MANAGER_BENCHMARK_H__ */
+
+/*
+vi:ts=4:nowrap:ai:expandtab:sw=4
+*/
@@ -37,6 +37,7 @@
 
 void test_negotiate (void);
 void test_helo (void);
+void test_helo_on_event_loop_thread (void);
 void test_listen_started (void);
 void test_unix_socket_mode (void);
 void test_unix_socket_group (void);
@@ -53,6 +54,7 @@ void test_syslog_identify_accessor (void);
 void test_syslog_facility_accessor (void);
 void test_suspend_time_on_unacceptable (void);
 void test_max_connections (void);
+void test_max_connections_suspend_accept (void);
 void test_effective_user (void);
 void test_effective_group (void);
 void test_event_loop_backend (void);
@@ -66,15 +68,19 @@ void test_need_maintain_no_processing_sessions (void);
 void test_need_maintain_no_processing_sessions_below_processed_sessions (void);
 void test_need_maintain_no_processing_sessions_no_interval (void);
 void test_n_workers (void);
+void test_n_event_loop_threads (void);
 void test_custom_fork (void);
 void test_default_packet_buffer_size (void);
 void test_worker_id (void);
 void test_max_pending_finished_sessions (void);
+void test_reuse_port_accessor (void);
+void test_reuse_port_listen (void);
 
 static MilterEventLoop *loop;
 
 static MilterClient *client;
 static MilterTestServer *server;
+static MilterTestServer *second_server;
 
 static MilterDecoder *decoder;
 static MilterCommandEncoder *encoder;
@@ -96,6 +102,8 @@ static gint n_finished_emissions;
 static guint idle_id;
 static guint idle_shutdown_id;
 static guint shutdown_count;
+static guint n_suspended_checks;
+static gint n_helos_on_max_connections;
 
 static const gchar *spec;
 
@@ -111,6 +119,7 @@ static socklen_t connect_address_length;
 
 static const gchar fqdn[] = "delian";
 static gchar *helo_fqdn;
+static GThread *helo_thread;
 
 static gchar *envelope_from;
 
@@ -163,9 +172,12 @@ cb_connect (MilterClientContext *context, const gchar *host_name,
 static void
 cb_helo (MilterClientContext *context, const gchar *fqdn, gpointer user_data)
 {
-    n_helos++;
+    g_atomic_int_inc(&n_helos);
 
+    if (helo_fqdn)
+        g_free(helo_fqdn);
     helo_fqdn = g_strdup(fqdn);
+    helo_thread = g_thread_self();
 }
 
 static void
@@ -345,6 +357,7 @@ cut_setup (void)
     milter_event_loop_set_custom_run_func(loop, loop_run);
     setup_client_signals();
     server = NULL;
+    second_server = NULL;
 
     decoder = milter_reply_decoder_new();
     encoder = MILTER_COMMAND_ENCODER(milter_command_encoder_new());
@@ -358,6 +371,8 @@ cut_setup (void)
     idle_id = 0;
     idle_shutdown_id = 0;
     shutdown_count = 10;
+    n_suspended_checks = 0;
+    n_helos_on_max_connections = 0;
 
     n_negotiates = 0;
     n_connects = 0;
@@ -379,6 +394,7 @@ cut_setup (void)
     connect_address_length = 0;
 
     helo_fqdn = NULL;
+    helo_thread = NULL;
 
     envelope_from = NULL;
 
@@ -414,6 +430,8 @@ cut_teardown (void)
 
     if (server)
         g_object_unref(server);
+    if (second_server)
+        g_object_unref(second_server);
     if (client)
         g_object_unref(client);
 
@@ -592,6 +610,48 @@ test_helo (void)
     cut_assert_true(loop_run_count > 0);
 }
 
+static gboolean
+cb_timeout_shutdown_after_helo (gpointer user_data)
+{
+    if (g_atomic_int_get(&n_helos) == 0 && --shutdown_count > 0)
+        return TRUE;
+
+    idle_shutdown_id = 0;
+    milter_client_shutdown(client);
+    if (server) {
+        g_object_unref(server);
+        server = NULL;
+    }
+
+    return FALSE;
+}
+
+void
+test_helo_on_event_loop_thread (void)
+{
+    GError *error = NULL;
+
+    if (n_workers > 0)
+        cut_omit("event loop threads aren't used with worker processes");
+
+    milter_client_set_n_event_loop_threads(client, 2);
+    idle_id = milter_event_loop_add_idle(loop, cb_idle_helo, NULL);
+
+    milter_client_set_connection_spec(client, spec, &error);
+    gcut_assert_error(error);
+    shutdown_count = 500;
+    idle_shutdown_id = milter_event_loop_add_timeout(loop, 0.01,
+                                                     cb_timeout_shutdown_after_helo,
+                                                     NULL);
+    milter_client_run(client, &error);
+    gcut_assert_error(error);
+
+    cut_assert_equal_int(1, n_helos);
+    cut_assert_equal_string(fqdn, helo_fqdn);
+    cut_assert_true(helo_thread != g_thread_self());
+    cut_assert_equal_uint(0, milter_client_get_n_processing_sessions(client));
+}
+
 void
 test_listen_started (void)
 {
@@ -780,6 +840,37 @@ test_remove_unix_socket_on_create_accessor (void)
     cut_assert_false(milter_client_is_remove_unix_socket_on_create(client));
 }
 
+void
+test_reuse_port_accessor (void)
+{
+    cut_assert_false(milter_client_is_reuse_port(client));
+    milter_client_set_reuse_port(client, TRUE);
+    cut_assert_true(milter_client_is_reuse_port(client));
+}
+
+void
+test_reuse_port_listen (void)
+{
+    GIOChannel *first_channel, *second_channel;
+    GError *error = NULL;
+
+    milter_client_set_connection_spec(client, "inet:9999@127.0.0.1", &error);
+    gcut_assert_error(error);
+    milter_client_set_n_workers(client, 2);
+    milter_client_set_reuse_port(client, TRUE);
+
+    milter_client_listen(client, &error);
+    gcut_assert_error(error);
+
+    first_channel = milter_client_get_worker_listen_channel(client, 1);
+    second_channel = milter_client_get_worker_listen_channel(client, 2);
+    cut_assert_not_null(first_channel);
+    cut_assert_not_null(second_channel);
+    cut_assert_not_equal_int(g_io_channel_unix_get_fd(first_channel),
+                             g_io_channel_unix_get_fd(second_channel));
+    cut_assert_null(milter_client_get_worker_listen_channel(client, 3));
+}
+
 void
 test_remove_unix_socket_on_create (void)
 {
@@ -916,6 +1007,80 @@ test_max_connections (void)
         10, milter_client_get_max_connections(client));
 }
 
+static gboolean
+cb_timeout_max_connections (gpointer user_data)
+{
+    const gchar *packet;
+    gsize packet_size;
+
+    if (--shutdown_count == 0)
+        goto shutdown;
+
+    if (!second_server) {
+        if (g_atomic_int_get(&n_helos) == 0)
+            return TRUE;
+
+        second_server = milter_test_server_new(spec, decoder, loop);
+        milter_command_encoder_encode_helo(encoder,
+                                           &packet, &packet_size, fqdn);
+        milter_test_server_write(second_server, packet, packet_size);
+        n_suspended_checks = 20;
+        return TRUE;
+    }
+
+    if (server) {
+        if (--n_suspended_checks > 0)
+            return TRUE;
+
+        n_helos_on_max_connections = g_atomic_int_get(&n_helos);
+        g_object_unref(server);
+        server = NULL;
+        return TRUE;
+    }
+
+    if (g_atomic_int_get(&n_helos) < 2)
+        return TRUE;
+
+shutdown:
+    idle_shutdown_id = 0;
+    milter_client_shutdown(client);
+    if (server) {
+        g_object_unref(server);
+        server = NULL;
+    }
+    if (second_server) {
+        g_object_unref(second_server);
+        second_server = NULL;
+    }
+
+    return FALSE;
+}
+
+void
+test_max_connections_suspend_accept (void)
+{
+    GError *error = NULL;
+
+    if (n_workers > 0)
+        cut_omit("can't obtain the result from callbacks in child process");
+
+    milter_client_set_max_connections(client, 1);
+    milter_client_set_suspend_time_on_unacceptable(client, 60);
+    idle_id = milter_event_loop_add_idle(loop, cb_idle_helo, NULL);
+
+    milter_client_set_connection_spec(client, spec, &error);
+    gcut_assert_error(error);
+    shutdown_count = 500;
+    idle_shutdown_id = milter_event_loop_add_timeout(loop, 0.01,
+                                                     cb_timeout_max_connections,
+                                                     NULL);
+    milter_client_run(client, &error);
+    gcut_assert_error(error);
+
+    cut_assert_equal_int(1, n_helos_on_max_connections);
+    cut_assert_equal_int(2, n_helos);
+}
+
 void
 test_effective_user (void)
 {
@@ -1047,6 +1212,14 @@ test_n_workers (void)
         10, milter_client_get_n_workers(client));
 }
 
+void
+test_n_event_loop_threads (void)
+{
+    cut_assert_equal_uint(0, milter_client_get_n_event_loop_threads(client));
+    milter_client_set_n_event_loop_threads(client, 4);
+    cut_assert_equal_uint(4, milter_client_get_n_event_loop_threads(client));
+}
+
 static GPid
 worker_fork (MilterClient *loop)
 {
@@ -25,6 +25,7 @@
 #include <arpa/inet.h>
 
 #include <milter/core/milter-command-decoder.h>
+#include <milter/core/milter-command-encoder.h>
 #include <milter/core/milter-enum-types.h>
 
 #include <gcutter.h>
@@ -34,9 +35,16 @@ void test_end_decode_immediately (void);
 void test_end_decode_in_command_length_decoding (void);
 void test_end_decode_in_command_content_decoding (void);
 void test_tag (void);
+void test_decode_commands_in_one_chunk (void);
+void test_decode_command_in_some_chunks (void);
+void test_decode_body_in_some_chunks (void);
+void test_decode_negative_command_length (void);
+void test_decode_too_long_command_length (void);
 
 static MilterDecoder *decoder;
+static MilterEncoder *encoder;
 static GString *buffer;
+static GString *decoded;
 
 static GError *expected_error;
 static GError *actual_error;
@@ -45,11 +53,13 @@ void
 cut_setup (void)
 {
     decoder = milter_command_decoder_new();
+    encoder = milter_command_encoder_new();
 
     expected_error = NULL;
     actual_error = NULL;
 
     buffer = g_string_new(NULL);
+    decoded = g_string_new(NULL);
 }
 
 void
@@ -59,8 +69,13 @@ cut_teardown (void)
         g_object_unref(decoder);
     }
 
+    if (encoder)
+        g_object_unref(encoder);
+
     if (buffer)
         g_string_free(buffer, TRUE);
+    if (decoded)
+        g_string_free(decoded, TRUE);
 
     if (expected_error)
         g_error_free(expected_error);
@@ -124,6 +139,135 @@ test_tag (void)
     cut_assert_equal_uint(29, milter_decoder_get_tag(decoder));
 }
 
+static void
+cb_header (MilterCommandDecoder *decoder,
+           const gchar *name, const gchar *value,
+           gpointer user_data)
+{
+    g_string_append_printf(decoded, "%s=%s\n", name, value);
+}
+
+static void
+cb_body (MilterCommandDecoder *decoder,
+         const gchar *chunk, gsize size,
+         gpointer user_data)
+{
+    g_string_append_len(decoded, chunk, size);
+}
+
+static void
+append_header_packet (const gchar *name, const gchar *value)
+{
+    const gchar *packet;
+    gsize packet_size;
+
+    milter_command_encoder_encode_header(MILTER_COMMAND_ENCODER(encoder),
+                                         &packet, &packet_size,
+                                         name, value);
+    g_string_append_len(buffer, packet, packet_size);
+}
+
+void
+test_decode_commands_in_one_chunk (void)
+{
+    g_signal_connect(decoder, "header", G_CALLBACK(cb_header), NULL);
+
+    append_header_packet("From", "<kou@example.com>");
+    append_header_packet("To", "<user@example.com>");
+    append_header_packet("Subject", "Hello");
+
+    cut_assert_true(milter_decoder_decode(decoder, buffer->str, buffer->len,
+                                          &actual_error));
+    gcut_assert_error(actual_error);
+    cut_assert_true(milter_decoder_end_decode(decoder, &actual_error));
+    cut_assert_equal_string("From=<kou@example.com>\n"
+                            "To=<user@example.com>\n"
+                            "Subject=Hello\n",
+                            decoded->str);
+}
+
+void
+test_decode_command_in_some_chunks (void)
+{
+    gsize i;
+
+    g_signal_connect(decoder, "header", G_CALLBACK(cb_header), NULL);
+
+    append_header_packet("From", "<kou@example.com>");
+    append_header_packet("To", "<user@example.com>");
+
+    for (i = 0; i < buffer->len; i++) {
+        cut_assert_true(milter_decoder_decode(decoder, buffer->str + i, 1,
+                                              &actual_error));
+        gcut_assert_error(actual_error);
+    }
+    cut_assert_true(milter_decoder_end_decode(decoder, &actual_error));
+    cut_assert_equal_string("From=<kou@example.com>\n"
+                            "To=<user@example.com>\n",
+                            decoded->str);
+}
+
+void
+test_decode_body_in_some_chunks (void)
+{
+    const gchar *packet;
+    gsize packet_size, packed_size, half;
+    GString *body;
+    gint i;
+
+    g_signal_connect(decoder, "body", G_CALLBACK(cb_body), NULL);
+
+    body = g_string_new(NULL);
+    for (i = 0; i < 1000; i++)
+        g_string_append_printf(body, "line %d\n", i);
+    milter_command_encoder_encode_body(MILTER_COMMAND_ENCODER(encoder),
+                                       &packet, &packet_size,
+                                       body->str, body->len,
+                                       &packed_size);
+    g_string_append_len(buffer, packet, packet_size);
+    append_header_packet("X-Next", "value");
+
+    half = buffer->len / 2;
+    cut_assert_true(milter_decoder_decode(decoder, buffer->str, half,
+                                          &actual_error));
+    gcut_assert_error(actual_error);
+    cut_assert_equal_string("", decoded->str);
+    cut_assert_true(milter_decoder_decode(decoder, buffer->str + half,
+                                          buffer->len - half,
+                                          &actual_error));
+    gcut_assert_error(actual_error);
+    cut_assert_true(milter_decoder_end_decode(decoder, &actual_error));
+    cut_assert_equal_string(body->str, decoded->str);
+    g_string_free(body, TRUE);
+}
+
+void
+test_decode_negative_command_length (void)
+{
+    cut_assert_false(milter_decoder_decode(decoder,
+                                           "\xff\xff\xff\xfe" "B", 5,
+                                           &actual_error));
+
+    expected_error = g_error_new(MILTER_DECODER_ERROR,
+                                 MILTER_DECODER_ERROR_SHORT_COMMAND_LENGTH,
+                                 "command length should be positive: <-2>");
+    gcut_assert_equal_error(expected_error, actual_error);
+}
+
+void
+test_decode_too_long_command_length (void)
+{
+    cut_assert_false(milter_decoder_decode(decoder,
+                                           "\x7f\xff\xff\xff" "B", 5,
+                                           &actual_error));
+
+    expected_error = g_error_new(MILTER_DECODER_ERROR,
+                                 MILTER_DECODER_ERROR_LONG_COMMAND_LENGTH,
+                                 "command length is too long: "
+                                 "<2147483647> (max: <1048576>)");
+    gcut_assert_equal_error(expected_error, actual_error);
+}
+
 /*
 vi:ts=4:nowrap:ai:expandtab:sw=4
 */
@@ -1,6 +1,8 @@
 /* -*- Mode: C; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
 
+#include <errno.h>
 #include <string.h>
+#include <unistd.h>
 
 #include <milter/core/milter-enum-types.h>
 #include <milter/core/milter-event-loop.h>
@@ -13,9 +15,29 @@ void data_add_timeout (void);
 void test_add_timeout (gconstpointer data);
 void data_add_timeout_negative (void);
 void test_add_timeout_negative (gconstpointer data);
+void data_timeout_restart (void);
+void test_timeout_restart (gconstpointer data);
+void data_timeout_stop (void);
+void test_timeout_stop (gconstpointer data);
+void data_timeout_cascade (void);
+void test_timeout_cascade (gconstpointer data);
+void test_timeout_free_before_dispose (void);
+void data_modify_io (void);
+void test_modify_io (gconstpointer data);
+void data_remove_stale_id (void);
+void test_remove_stale_id (gconstpointer data);
+void test_libev_watcher_generation_saturated (void);
+void data_add_job (void);
+void test_add_job (gconstpointer data);
 
 static gboolean timeout_waiting;
 static guint n_timeouts;
+static GThread *job_thread;
+static GList *done_jobs;
+static MilterEventLoopTimeout *timeout;
+static GIOChannel *read_channel;
+static GIOChannel *write_channel;
+static guint n_io_calls;
 
 static gboolean
 cb_timeout (gpointer data)
@@ -32,6 +54,44 @@ cut_setup (void)
 {
     timeout_waiting = TRUE;
     n_timeouts = 0;
+    job_thread = NULL;
+    done_jobs = NULL;
+    timeout = NULL;
+    read_channel = NULL;
+    write_channel = NULL;
+    n_io_calls = 0;
+}
+
+void
+cut_teardown (void)
+{
+    g_list_free(done_jobs);
+    if (timeout)
+        milter_event_loop_timeout_free(timeout);
+    if (read_channel)
+        g_io_channel_unref(read_channel);
+    if (write_channel)
+        g_io_channel_unref(write_channel);
+}
+
+static void
+setup_pipe (void)
+{
+    int fds[2];
+
+    if (pipe(fds) == -1)
+        cut_fail("failed to create pipe: %s", g_strerror(errno));
+    read_channel = g_io_channel_unix_new(fds[0]);
+    g_io_channel_set_close_on_unref(read_channel, TRUE);
+    write_channel = g_io_channel_unix_new(fds[1]);
+    g_io_channel_set_close_on_unref(write_channel, TRUE);
+}
+
+static gboolean
+cb_io (GIOChannel *channel, GIOCondition condition, gpointer data)
+{
+    n_io_calls++;
+    return TRUE;
 }
 
 void data_add_timeout (void)
@@ -104,3 +164,352 @@ void test_add_timeout_negative (gconstpointer data)
     cut_assert_equal_uint(0, id);
     milter_event_loop_quit(loop);
 }
+
+void
+data_timeout_restart (void)
+{
+#define ADD_DATUM(label, event_loop_type, interval)                     \
+    gcut_add_datum(label,                                               \
+                   "event-loop-type", G_TYPE_GTYPE,                     \
+                   MILTER_TYPE_ ## event_loop_type ## _EVENT_LOOP,      \
+                   "interval", G_TYPE_DOUBLE, interval,                 \
+                   NULL)
+
+    ADD_DATUM("glib short", GLIB, 0.1);
+    ADD_DATUM("glib wheel", GLIB, 1.0);
+    ADD_DATUM("libev short", LIBEV, 0.1);
+    ADD_DATUM("libev wheel", LIBEV, 1.0);
+
+#undef ADD_DATUM
+}
+
+void
+test_timeout_restart (gconstpointer data)
+{
+    MilterEventLoop *loop = NULL;
+    GType event_loop_type = gcut_data_get_type(data, "event-loop-type");
+    gdouble interval = gcut_data_get_double(data, "interval");
+
+    if (event_loop_type == MILTER_TYPE_GLIB_EVENT_LOOP) {
+        loop = milter_glib_event_loop_new(NULL);
+    } else if (event_loop_type == MILTER_TYPE_LIBEV_EVENT_LOOP) {
+        loop = milter_libev_event_loop_new();
+    }
+    gcut_take_object(G_OBJECT(loop));
+
+    timeout = milter_event_loop_timeout_new(loop, cb_timeout, &timeout_waiting);
+    cut_assert_false(milter_event_loop_timeout_is_active(timeout));
+
+    milter_event_loop_timeout_start(timeout, interval);
+    milter_event_loop_timeout_start(timeout, interval);
+    cut_assert_true(milter_event_loop_timeout_is_active(timeout));
+    while (timeout_waiting) {
+        milter_event_loop_iterate(loop, TRUE);
+    }
+    cut_assert_equal_uint(1, n_timeouts);
+    cut_assert_false(milter_event_loop_timeout_is_active(timeout));
+
+    timeout_waiting = TRUE;
+    milter_event_loop_timeout_start(timeout, interval);
+    while (timeout_waiting) {
+        milter_event_loop_iterate(loop, TRUE);
+    }
+    cut_assert_equal_uint(2, n_timeouts);
+}
+
+void
+data_timeout_stop (void)
+{
+#define ADD_DATUM(label, event_loop_type)                               \
+    gcut_add_datum(label,                                               \
+                   "event-loop-type", G_TYPE_GTYPE,                     \
+                   MILTER_TYPE_ ## event_loop_type ## _EVENT_LOOP,      \
+                   NULL)
+
+    ADD_DATUM("glib", GLIB);
+    ADD_DATUM("libev", LIBEV);
+
+#undef ADD_DATUM
+}
+
+static gboolean
+cb_guard (gpointer data)
+{
+    gboolean *waiting = data;
+
+    *waiting = FALSE;
+    return FALSE;
+}
+
+void
+test_timeout_stop (gconstpointer data)
+{
+    MilterEventLoop *loop = NULL;
+    GType event_loop_type = gcut_data_get_type(data, "event-loop-type");
+    gboolean guard_waiting = TRUE;
+
+    if (event_loop_type == MILTER_TYPE_GLIB_EVENT_LOOP) {
+        loop = milter_glib_event_loop_new(NULL);
+    } else if (event_loop_type == MILTER_TYPE_LIBEV_EVENT_LOOP) {
+        loop = milter_libev_event_loop_new();
+    }
+    gcut_take_object(G_OBJECT(loop));
+
+    timeout = milter_event_loop_timeout_new(loop, cb_timeout, &timeout_waiting);
+    milter_event_loop_timeout_start(timeout, 1.0);
+    milter_event_loop_timeout_stop(timeout);
+    cut_assert_false(milter_event_loop_timeout_is_active(timeout));
+
+    milter_event_loop_add_timeout(loop, 1.5, cb_guard, &guard_waiting);
+    while (guard_waiting) {
+        milter_event_loop_iterate(loop, TRUE);
+    }
+    cut_assert_equal_uint(0, n_timeouts);
+}
+
+void
+data_timeout_cascade (void)
+{
+#define ADD_DATUM(label, event_loop_type)                               \
+    gcut_add_datum(label,                                               \
+                   "event-loop-type", G_TYPE_GTYPE,                     \
+                   MILTER_TYPE_ ## event_loop_type ## _EVENT_LOOP,      \
+                   NULL)
+
+    ADD_DATUM("glib", GLIB);
+    ADD_DATUM("libev", LIBEV);
+
+#undef ADD_DATUM
+}
+
+void
+test_timeout_cascade (gconstpointer data)
+{
+    MilterEventLoop *loop = NULL;
+    GType event_loop_type = gcut_data_get_type(data, "event-loop-type");
+    GTimer *timer;
+    gdouble elapsed;
+
+    if (event_loop_type == MILTER_TYPE_GLIB_EVENT_LOOP) {
+        loop = milter_glib_event_loop_new(NULL);
+    } else if (event_loop_type == MILTER_TYPE_LIBEV_EVENT_LOOP) {
+        loop = milter_libev_event_loop_new();
+    }
+    gcut_take_object(G_OBJECT(loop));
+
+    /* Longer than the 64 slots of the first level. */
+    timeout = milter_event_loop_timeout_new(loop, cb_timeout, &timeout_waiting);
+    timer = g_timer_new();
+    milter_event_loop_timeout_start(timeout, 6.5);
+    while (timeout_waiting) {
+        milter_event_loop_iterate(loop, TRUE);
+    }
+    elapsed = g_timer_elapsed(timer, NULL);
+    g_timer_destroy(timer);
+
+    cut_assert_equal_uint(1, n_timeouts);
+    cut_assert_operator_double(elapsed, >=, 6.5);
+    cut_assert_operator_double(elapsed, <, 7.5);
+}
+
+void
+test_timeout_free_before_dispose (void)
+{
+    MilterEventLoop *loop;
+    gboolean guard_waiting = TRUE;
+
+    loop = milter_glib_event_loop_new(NULL);
+    timeout = milter_event_loop_timeout_new(loop, cb_timeout, &timeout_waiting);
+    milter_event_loop_timeout_start(timeout, 1.0);
+    milter_event_loop_timeout_free(timeout);
+    timeout = NULL;
+    g_object_unref(loop);
+
+    /* The wheel's driver must not fire on the default context after
+     * the loop is gone. */
+    g_timeout_add(1500, cb_guard, &guard_waiting);
+    while (guard_waiting) {
+        g_main_context_iteration(NULL, TRUE);
+    }
+    cut_assert_equal_uint(0, n_timeouts);
+}
+
+void
+data_modify_io (void)
+{
+#define ADD_DATUM(label, event_loop_type, supported)                    \
+    gcut_add_datum(label,                                               \
+                   "event-loop-type", G_TYPE_GTYPE,                     \
+                   MILTER_TYPE_ ## event_loop_type ## _EVENT_LOOP,      \
+                   "supported", G_TYPE_BOOLEAN, supported,              \
+                   NULL)
+
+    ADD_DATUM("glib", GLIB, FALSE);
+    ADD_DATUM("libev", LIBEV, TRUE);
+
+#undef ADD_DATUM
+}
+
+void
+test_modify_io (gconstpointer data)
+{
+    MilterEventLoop *loop = NULL;
+    GType event_loop_type = gcut_data_get_type(data, "event-loop-type");
+    gboolean supported = gcut_data_get_boolean(data, "supported");
+    guint id;
+
+    if (event_loop_type == MILTER_TYPE_GLIB_EVENT_LOOP) {
+        loop = milter_glib_event_loop_new(NULL);
+    } else if (event_loop_type == MILTER_TYPE_LIBEV_EVENT_LOOP) {
+        loop = milter_libev_event_loop_new();
+    }
+    gcut_take_object(G_OBJECT(loop));
+
+    setup_pipe();
+    id = milter_event_loop_watch_io(loop, write_channel, G_IO_OUT,
+                                    cb_io, NULL);
+    milter_event_loop_iterate(loop, FALSE);
+    cut_assert_equal_uint(1, n_io_calls);
+
+    cut_assert_equal_boolean(supported,
+                             milter_event_loop_modify_io(loop, id, 0));
+    if (!supported)
+        return;
+    milter_event_loop_iterate(loop, FALSE);
+    cut_assert_equal_uint(1, n_io_calls);
+
+    cut_assert_true(milter_event_loop_modify_io(loop, id, G_IO_OUT));
+    milter_event_loop_iterate(loop, FALSE);
+    cut_assert_equal_uint(2, n_io_calls);
+
+    cut_assert_true(milter_event_loop_remove(loop, id));
+    cut_assert_false(milter_event_loop_modify_io(loop, id, G_IO_OUT));
+}
+
+void
+data_remove_stale_id (void)
+{
+#define ADD_DATUM(label, event_loop_type)                               \
+    gcut_add_datum(label,                                               \
+                   "event-loop-type", G_TYPE_GTYPE,                     \
+                   MILTER_TYPE_ ## event_loop_type ## _EVENT_LOOP,      \
+                   NULL)
+
+    ADD_DATUM("glib", GLIB);
+    ADD_DATUM("libev", LIBEV);
+
+#undef ADD_DATUM
+}
+
+void
+test_remove_stale_id (gconstpointer data)
+{
+    MilterEventLoop *loop = NULL;
+    GType event_loop_type = gcut_data_get_type(data, "event-loop-type");
+    guint stale_id, id, i;
+
+    if (event_loop_type == MILTER_TYPE_GLIB_EVENT_LOOP) {
+        loop = milter_glib_event_loop_new(NULL);
+    } else if (event_loop_type == MILTER_TYPE_LIBEV_EVENT_LOOP) {
+        loop = milter_libev_event_loop_new();
+    }
+    gcut_take_object(G_OBJECT(loop));
+
+    stale_id = milter_event_loop_add_timeout(loop, 60, cb_timeout,
+                                             &timeout_waiting);
+    cut_assert_true(milter_event_loop_remove(loop, stale_id));
+    for (i = 0; i < 1000; i++) {
+        id = milter_event_loop_add_timeout(loop, 60, cb_timeout,
+                                           &timeout_waiting);
+        cut_assert_operator_uint(stale_id, !=, id);
+        cut_assert_false(milter_event_loop_remove(loop, stale_id));
+        cut_assert_true(milter_event_loop_remove(loop, id));
+    }
+}
+
+void
+test_libev_watcher_generation_saturated (void)
+{
+    MilterEventLoop *loop;
+    guint first_id, id, i, n_reissued = 0;
+    guint n_watchers_per_slab = 64, n_generations = 1 << 14;
+
+    loop = milter_libev_event_loop_new();
+    gcut_take_object(G_OBJECT(loop));
+
+    first_id = milter_event_loop_add_timeout(loop, 60, cb_timeout,
+                                             &timeout_waiting);
+    cut_assert_true(milter_event_loop_remove(loop, first_id));
+    for (i = 0; i < n_watchers_per_slab * n_generations; i++) {
+        id = milter_event_loop_add_timeout(loop, 60, cb_timeout,
+                                           &timeout_waiting);
+        if (id == first_id)
+            n_reissued++;
+        milter_event_loop_remove(loop, id);
+    }
+    cut_assert_equal_uint(0, n_reissued);
+
+    id = milter_event_loop_add_timeout(loop, 60, cb_timeout,
+                                       &timeout_waiting);
+    cut_assert_operator_uint(0, <, id);
+    cut_assert_false(milter_event_loop_remove(loop, first_id));
+    cut_assert_true(milter_event_loop_remove(loop, id));
+}
+
+void
+data_add_job (void)
+{
+#define ADD_DATUM(label, event_loop_type)                               \
+    gcut_add_datum(label,                                               \
+                   "event-loop-type", G_TYPE_GTYPE,                     \
+                   MILTER_TYPE_ ## event_loop_type ## _EVENT_LOOP,      \
+                   NULL)
+
+    ADD_DATUM("glib", GLIB);
+    ADD_DATUM("libev", LIBEV);
+
+#undef ADD_DATUM
+}
+
+static void
+cb_job (gpointer user_data)
+{
+    job_thread = g_thread_self();
+}
+
+static void
+cb_job_done (gpointer user_data)
+{
+    done_jobs = g_list_append(done_jobs, user_data);
+}
+
+void
+test_add_job (gconstpointer data)
+{
+    MilterEventLoop *loop = NULL;
+    GType event_loop_type = gcut_data_get_type(data, "event-loop-type");
+    guint id;
+
+    if (event_loop_type == MILTER_TYPE_GLIB_EVENT_LOOP) {
+        loop = milter_glib_event_loop_new(NULL);
+    } else if (event_loop_type == MILTER_TYPE_LIBEV_EVENT_LOOP) {
+        loop = milter_libev_event_loop_new();
+    }
+    gcut_take_object(G_OBJECT(loop));
+
+    milter_event_loop_add_job(loop, cb_job, cb_job_done, GINT_TO_POINTER(1));
+    milter_event_loop_add_job(loop, cb_job, cb_job_done, GINT_TO_POINTER(2));
+    cut_assert_null(done_jobs);
+
+    id = milter_event_loop_add_timeout(loop, 1, cb_timeout, &timeout_waiting);
+    while (timeout_waiting && g_list_length(done_jobs) < 2) {
+        milter_event_loop_iterate(loop, TRUE);
+    }
+    if (timeout_waiting)
+        milter_event_loop_remove(loop, id);
+    cut_assert_true(timeout_waiting, cut_message("timeout"));
+
+    cut_assert_not_null(job_thread);
+    cut_assert_false(job_thread == g_thread_self());
+    cut_assert_equal_uint(2, g_list_length(done_jobs));
+}
@@ -30,23 +30,29 @@ void test_find (void);
 void test_lookup_by_name (void);
 void test_index_in_same_header_name (void);
 void test_copy (void);
+void test_copy_on_write (void);
 void test_remove (void);
 void test_add_header (void);
 void test_add_header_same_name (void);
 void test_append_header (void);
 void test_insert_header (void);
+void test_insert_header_same_name (void);
 void test_change_header (void);
 void test_delete_header_with_change_header (void);
 void test_delete_header (void);
+void test_delete_header_first_same_name (void);
+void test_arena (void);
 
 static MilterHeaders *headers;
 static GList *expected_list;
+static MilterMemoryArena *arena;
 
 void
 setup (void)
 {
     headers = milter_headers_new();
     expected_list = NULL;
+    arena = NULL;
 }
 
 void
@@ -54,6 +60,8 @@ teardown (void)
 {
     if (headers)
         g_object_unref(headers);
+    if (arena)
+        milter_memory_arena_free(arena);
     if (expected_list) {
         g_list_foreach(expected_list, (GFunc)milter_header_free, NULL);
         g_list_free(expected_list);
@@ -243,6 +251,40 @@ test_copy (void)
             NULL);
 }
 
+void
+test_copy_on_write (void)
+{
+    MilterHeaders *copied_headers;
+
+    expected_list = g_list_append(expected_list,
+                                  milter_header_new("X-Header1", "Value1"));
+    expected_list = g_list_append(expected_list,
+                                  milter_header_new("X-Header2", "Value2"));
+
+    cut_assert_true(milter_headers_append_header(headers,
+                                                 "X-Header1", "Value1"));
+    cut_assert_true(milter_headers_append_header(headers,
+                                                 "X-Header2", "Value2"));
+    copied_headers = milter_headers_copy(headers);
+    gcut_take_object(G_OBJECT(copied_headers));
+
+    cut_assert_true(milter_headers_change_header(copied_headers,
+                                                 "X-Header1", 1,
+                                                 "Changed value"));
+    cut_assert_true(milter_headers_delete_header(copied_headers,
+                                                 "X-Header2", 1));
+    gcut_assert_equal_list(
+            expected_list,
+            milter_headers_get_list(headers),
+            milter_header_equal,
+            (GCutInspectFunction)milter_header_inspect,
+            NULL);
+    cut_assert_equal_string(
+        "Changed value",
+        milter_headers_lookup_by_name(copied_headers, "X-Header1")->value);
+    cut_assert_equal_uint(1, milter_headers_length(copied_headers));
+}
+
 void
 test_remove (void)
 {
@@ -532,6 +574,100 @@ test_delete_header (void)
 }
 
 
+void
+test_insert_header_same_name (void)
+{
+    expected_list = g_list_append(expected_list,
+                                  milter_header_new("Received", "by mx1"));
+    expected_list = g_list_append(expected_list,
+                                  milter_header_new("Subject", "Hello"));
+    expected_list = g_list_append(expected_list,
+                                  milter_header_new("Received", "by mx2"));
+    expected_list = g_list_append(expected_list,
+                                  milter_header_new("Received", "by mx3"));
+
+    cut_assert_true(milter_headers_append_header(headers,
+                                                 "Received", "by mx1"));
+    cut_assert_true(milter_headers_append_header(headers,
+                                                 "Subject", "Hello"));
+    cut_assert_true(milter_headers_append_header(headers,
+                                                 "Received", "by mx3"));
+    cut_assert_true(milter_headers_insert_header(headers, 2,
+                                                 "Received", "by mx0"));
+    cut_assert_true(milter_headers_change_header(headers,
+                                                 "Received", 2,
+                                                 "by mx2"));
+    gcut_assert_equal_list(
+            expected_list,
+            milter_headers_get_list(headers),
+            milter_header_equal,
+            (GCutInspectFunction)milter_header_inspect,
+            NULL);
+    cut_assert_equal_int(
+        3,
+        milter_headers_index_in_same_header_name(headers,
+                                                 expected_list->next->next->next->data));
+}
+
+void
+test_delete_header_first_same_name (void)
+{
+    cut_assert_true(milter_headers_append_header(headers,
+                                                 "Received", "by mx1"));
+    cut_assert_true(milter_headers_append_header(headers,
+                                                 "Received", "by mx2"));
+    cut_assert_true(milter_headers_delete_header(headers, "Received", 1));
+    cut_assert_equal_string(
+        "by mx2",
+        milter_headers_lookup_by_name(headers, "Received")->value);
+    cut_assert_true(milter_headers_append_header(headers,
+                                                 "Received", "by mx3"));
+    cut_assert_equal_int(2,
+                         milter_headers_index_in_same_header_name(
+                             headers,
+                             milter_headers_get_nth_header(headers, 2)));
+}
+
+void
+test_arena (void)
+{
+    MilterHeaders *copied_headers;
+
+    expected_list = g_list_append(expected_list,
+                                  milter_header_new("Received", "by mx1"));
+    expected_list = g_list_append(expected_list,
+                                  milter_header_new("Subject", "Hello"));
+
+    g_object_unref(headers);
+    arena = milter_memory_arena_new(0);
+    headers = milter_headers_new_with_arena(arena);
+    cut_assert_true(milter_headers_append_header(headers,
+                                                 "Received", "by mx0"));
+    cut_assert_true(milter_headers_append_header(headers,
+                                                 "Subject", "Hello"));
+    cut_assert_true(milter_headers_change_header(headers,
+                                                 "Received", 1,
+                                                 "by mx1"));
+    cut_assert_operator_uint(0, <, milter_memory_arena_get_used_size(arena));
+
+    copied_headers = milter_headers_copy(headers);
+    cut_assert_true(milter_headers_change_header(copied_headers,
+                                                 "Subject", 1,
+                                                 "Changed"));
+    cut_assert_true(milter_headers_delete_header(copied_headers,
+                                                 "Received", 1));
+    gcut_assert_equal_list(
+            expected_list,
+            milter_headers_get_list(headers),
+            milter_header_equal,
+            (GCutInspectFunction)milter_header_inspect,
+            NULL);
+    cut_assert_equal_string(
+        "Changed",
+        milter_headers_lookup_by_name(copied_headers, "Subject")->value);
+    g_object_unref(copied_headers);
+}
+
 /*
 vi:ts=4:nowrap:ai:expandtab:sw=4
 */
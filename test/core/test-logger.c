@@ -28,6 +28,7 @@
 #include <milter-test-utils.h>
 #include <milter/core/milter-logger.h>
 #include <milter/core/milter-enum-types.h>
+#include <milter/core/milter-glib-compatible.h>
 #undef shutdown
 
 #define MILTER_LOG_DOMAIN "logger-test"
@@ -43,9 +44,12 @@ void test_info (void);
 void test_console_output (void);
 void test_target_level (void);
 void test_interesting_level (void);
+void test_need_log (void);
 void test_path_success (void);
 void test_path_null (void);
 void test_path_nonexistent (void);
+void test_asynchronous (void);
+void test_asynchronous_reopen_while_logging (void);
 
 static MilterLogger *logger;
 
@@ -350,6 +354,18 @@ test_interesting_level (void)
                             milter_logger_get_interesting_level(logger));
 }
 
+void
+test_need_log (void)
+{
+    milter_set_log_level(MILTER_LOG_LEVEL_INFO);
+    cut_assert_true(milter_need_info_log());
+    cut_assert_false(milter_need_debug_log());
+
+    milter_set_log_level(MILTER_LOG_LEVEL_DEBUG);
+    cut_assert_false(milter_need_info_log());
+    cut_assert_true(milter_need_debug_log());
+}
+
 void
 test_path_success (void)
 {
@@ -400,6 +416,93 @@ test_path_nonexistent (void)
     cut_assert_equal_string(NULL, milter_logger_get_path(logger));
 }
 
+void
+test_asynchronous (void)
+{
+    const gchar *path;
+    gchar *content = NULL;
+    GError *error = NULL;
+
+    logger = milter_logger_new();
+    milter_logger_connect_default_handler(logger);
+    milter_logger_set_target_level(logger, MILTER_LOG_LEVEL_INFO);
+
+    path = cut_build_path(tmp_dir, "output.log", NULL);
+    cut_assert_true(milter_logger_set_path(logger, path, &error));
+    gcut_assert_error(error);
+
+    cut_assert_false(milter_logger_is_asynchronous(logger));
+    milter_logger_set_asynchronous(logger, TRUE);
+    cut_assert_true(milter_logger_is_asynchronous(logger));
+
+    milter_logger_log(logger, "domain", MILTER_LOG_LEVEL_INFO,
+                      "file", 29, "function",
+                      "first message");
+    milter_logger_log(logger, "domain", MILTER_LOG_LEVEL_INFO,
+                      "file", 29, "function",
+                      "second message");
+    milter_logger_flush(logger);
+
+    g_file_get_contents(path, &content, NULL, &error);
+    gcut_assert_error(error);
+    cut_take_string(content);
+    cut_assert_match("first message\n.*second message\n$", content);
+}
+
+#define N_THREAD_MESSAGES 1000
+
+static gpointer
+log_in_thread (gpointer data)
+{
+    gboolean *finished = data;
+    gint i;
+
+    for (i = 0; i < N_THREAD_MESSAGES; i++) {
+        milter_logger_log(logger, "domain", MILTER_LOG_LEVEL_INFO,
+                          "file", 29, "function",
+                          "message from thread");
+    }
+    g_atomic_int_set(finished, TRUE);
+
+    return NULL;
+}
+
+void
+test_asynchronous_reopen_while_logging (void)
+{
+    const gchar *path;
+    gchar *content = NULL;
+    gchar **lines;
+    GThread *thread;
+    gboolean finished = FALSE;
+    GError *error = NULL;
+
+    logger = milter_logger_new();
+    milter_logger_connect_default_handler(logger);
+    milter_logger_set_target_level(logger, MILTER_LOG_LEVEL_INFO);
+
+    path = cut_build_path(tmp_dir, "output.log", NULL);
+    cut_assert_true(milter_logger_set_path(logger, path, &error));
+    gcut_assert_error(error);
+    milter_logger_set_asynchronous(logger, TRUE);
+
+    thread = g_thread_try_new("log-in-thread", log_in_thread, &finished,
+                              &error);
+    gcut_assert_error(error);
+    while (!g_atomic_int_get(&finished)) {
+        milter_logger_reopen(logger);
+    }
+    g_thread_join(thread);
+    milter_logger_flush(logger);
+
+    g_file_get_contents(path, &content, NULL, &error);
+    gcut_assert_error(error);
+    cut_take_string(content);
+    lines = g_regex_split_simple("message from thread\n", content, 0, 0);
+    gcut_take_string_array(lines);
+    cut_assert_equal_uint(N_THREAD_MESSAGES + 1, g_strv_length(lines));
+}
+
 /*
 vi:ts=4:nowrap:ai:expandtab:sw=4
 */
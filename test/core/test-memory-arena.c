@@ -0,0 +1,128 @@
+/* -*- Mode: C; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+/*
+ *  Copyright (C) 2026  Kouhei Sutou <kou@clear-code.com>
+ *
+ *  This library is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with this library.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <string.h>
+
+#include <milter/core/milter-memory-arena.h>
+
+#include <gcutter.h>
+
+void data_strdup (void);
+void test_strdup (gconstpointer data);
+void data_large (void);
+void test_large (gconstpointer data);
+void data_reset (void);
+void test_reset (gconstpointer data);
+
+static MilterMemoryArena *arena;
+static gboolean original_use_malloc;
+
+void
+setup (void)
+{
+    original_use_malloc = milter_memory_arena_get_use_malloc();
+    arena = NULL;
+}
+
+void
+teardown (void)
+{
+    if (arena)
+        milter_memory_arena_free(arena);
+    milter_memory_arena_set_use_malloc(original_use_malloc);
+}
+
+static void
+data_use_malloc (void)
+{
+    cut_add_data("arena", GINT_TO_POINTER(FALSE), NULL,
+                 "malloc", GINT_TO_POINTER(TRUE), NULL);
+}
+
+void
+data_strdup (void)
+{
+    data_use_malloc();
+}
+
+void
+test_strdup (gconstpointer data)
+{
+    gchar *name, *value;
+
+    milter_memory_arena_set_use_malloc(GPOINTER_TO_INT(data));
+    arena = milter_memory_arena_new(64);
+    name = milter_memory_arena_strdup(arena, "X-Virus-Status");
+    value = milter_memory_arena_strndup(arena, "Clean; scanned", 5);
+
+    cut_assert_equal_string("X-Virus-Status", name);
+    cut_assert_equal_string("Clean", value);
+    cut_assert_null(milter_memory_arena_strdup(arena, NULL));
+    cut_assert_equal_uint(strlen("X-Virus-Status") + 1 + strlen("Clean") + 1,
+                          milter_memory_arena_get_used_size(arena));
+}
+
+void
+data_large (void)
+{
+    data_use_malloc();
+}
+
+void
+test_large (gconstpointer data)
+{
+    gchar *small, *large;
+
+    milter_memory_arena_set_use_malloc(GPOINTER_TO_INT(data));
+    arena = milter_memory_arena_new(64);
+    small = milter_memory_arena_strdup(arena, "small");
+    large = milter_memory_arena_alloc0(arena, 1024);
+    memset(large, 'x', 1023);
+
+    cut_assert_equal_string("small", small);
+    cut_assert_equal_uint(1023, strlen(large));
+}
+
+void
+data_reset (void)
+{
+    data_use_malloc();
+}
+
+void
+test_reset (gconstpointer data)
+{
+    gint i;
+
+    milter_memory_arena_set_use_malloc(GPOINTER_TO_INT(data));
+    arena = milter_memory_arena_new(64);
+    for (i = 0; i < 100; i++) {
+        milter_memory_arena_strdup(arena, "Received");
+    }
+    milter_memory_arena_alloc(arena, 1024);
+    milter_memory_arena_reset(arena);
+    cut_assert_equal_uint(0, milter_memory_arena_get_used_size(arena));
+
+    cut_assert_equal_string("Subject",
+                            milter_memory_arena_strdup(arena, "Subject"));
+}
+
+/*
+vi:ts=4:nowrap:ai:expandtab:sw=4
+*/
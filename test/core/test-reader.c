@@ -25,8 +25,10 @@
 #define shutdown inet_shutdown
 #include <milter-test-utils.h>
 #include <milter/core/milter-reader.h>
+#include <milter/core/milter-protocol.h>
 #undef shutdown
 #include <unistd.h>
+#include <sys/socket.h>
 
 void test_reader_io_channel (void);
 void test_reader_io_channel_binary (void);
@@ -35,6 +37,9 @@ void test_io_error (void);
 void test_finished_signal (void);
 void test_shutdown (void);
 void test_tag (void);
+void test_unix_reader_grow_buffer (void);
+void test_unix_reader_keep_buffer_on_small_reads (void);
+void test_unix_reader_shrink_buffer (void);
 
 static MilterEventLoop *loop;
 
@@ -43,6 +48,8 @@ static MilterReader *reader;
 static GIOChannel *channel;
 
 static gsize actual_read_size;
+static gsize max_flow_size;
+static gint peer_fd;
 static GString *actual_read_string;
 
 static guint signal_id;
@@ -69,6 +76,8 @@ cut_setup (void)
 
     actual_read_string = g_string_new(NULL);
     actual_read_size = 0;
+    max_flow_size = 0;
+    peer_fd = -1;
 
     actual_error = NULL;
     expected_error = NULL;
@@ -90,6 +99,9 @@ cut_teardown (void)
     if (channel)
         g_io_channel_unref(channel);
 
+    if (peer_fd != -1)
+        close(peer_fd);
+
     if (loop)
         g_object_unref(loop);
 
@@ -107,6 +119,7 @@ cb_flow (MilterReader *reader, const gchar *data, gsize data_size)
 {
     g_string_append_len(actual_read_string, data, data_size);
     actual_read_size += data_size;
+    max_flow_size = MAX(max_flow_size, data_size);
 }
 
 static void
@@ -252,6 +265,107 @@ test_tag (void)
     cut_assert_equal_uint(29, milter_reader_get_tag(reader));
 }
 
+static void
+setup_unix_reader (void)
+{
+    gint fds[2];
+
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds) == -1)
+        cut_error_errno();
+    peer_fd = fds[1];
+
+    g_object_unref(reader);
+    g_io_channel_unref(channel);
+    channel = g_io_channel_unix_new(fds[0]);
+    g_io_channel_set_close_on_unref(channel, TRUE);
+    g_io_channel_set_encoding(channel, NULL, NULL);
+    reader = milter_reader_unix_io_channel_new(channel);
+    milter_reader_start(reader, loop);
+    signal_id = g_signal_connect(reader, "flow", G_CALLBACK(cb_flow), NULL);
+}
+
+static void
+write_to_peer (const gchar *data, gsize data_size)
+{
+    gsize expected_read_size;
+    gint i;
+
+    expected_read_size = actual_read_size + data_size;
+    cut_assert_equal_int(data_size, write(peer_fd, data, data_size));
+    for (i = 0; i < 100 && actual_read_size < expected_read_size; i++)
+        milter_event_loop_iterate(loop, FALSE);
+    cut_assert_equal_uint(expected_read_size, actual_read_size);
+}
+
+static const gchar *
+large_data (gsize data_size)
+{
+    gchar *binary_data;
+
+    binary_data = g_new(gchar, data_size);
+    cut_take_memory(binary_data);
+    memset(binary_data, 'X', data_size);
+    return binary_data;
+}
+
+void
+test_unix_reader_grow_buffer (void)
+{
+    const gchar *binary_data;
+    gsize data_size = 32 * 4096;
+
+    setup_unix_reader();
+
+    binary_data = large_data(data_size);
+    write_to_peer(binary_data, data_size);
+    cut_assert_equal_memory(binary_data, data_size,
+                            actual_read_string->str, actual_read_size);
+    cut_assert_operator_uint(4096, <, max_flow_size);
+}
+
+void
+test_unix_reader_keep_buffer_on_small_reads (void)
+{
+    const gchar *binary_data;
+    gsize max_buffer_size = sizeof(guint32) + 1 + MILTER_CHUNK_SIZE;
+    gsize data_size = 2 * max_buffer_size;
+    gint i;
+
+    setup_unix_reader();
+
+    binary_data = large_data(data_size);
+    write_to_peer(binary_data, 32 * 4096);
+
+    for (i = 0; i < 3; i++)
+        write_to_peer("small", strlen("small"));
+
+    max_flow_size = 0;
+    write_to_peer(binary_data, data_size);
+    cut_assert_equal_uint(max_buffer_size, max_flow_size);
+}
+
+void
+test_unix_reader_shrink_buffer (void)
+{
+    const gchar *binary_data;
+    gsize max_buffer_size = sizeof(guint32) + 1 + MILTER_CHUNK_SIZE;
+    gsize data_size = 2 * max_buffer_size;
+    gint i;
+
+    setup_unix_reader();
+
+    binary_data = large_data(data_size);
+    write_to_peer(binary_data, data_size);
+
+    for (i = 0; i < 100; i++)
+        write_to_peer("small", strlen("small"));
+
+    max_flow_size = 0;
+    cut_assert_equal_int(data_size, write(peer_fd, binary_data, data_size));
+    milter_event_loop_iterate(loop, FALSE);
+    cut_assert_operator_uint(max_buffer_size, >, max_flow_size);
+}
+
 /*
 vi:ts=4:nowrap:ai:expandtab:sw=4
 */
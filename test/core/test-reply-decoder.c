@@ -80,6 +80,9 @@ void test_decode_insert_header (void);
 void test_decode_change_header (void);
 void test_decode_delete_header (void);
 
+void test_decode_continue_with_handlers (void);
+void test_decode_continue_with_handlers_only (void);
+
 static MilterDecoder *decoder;
 
 static GString *buffer;
@@ -107,6 +110,7 @@ static gint n_bodies;
 static gint n_insert_headers;
 static gint n_change_headers;
 static gint n_delete_headers;
+static gint n_handler_continues;
 
 static guint reply_code;
 static gchar *reply_extended_code;
@@ -319,6 +323,17 @@ cb_replace_body (MilterDecoder *decoder,
     actual_body_chunk_length = length;
 }
 
+static void
+handler_continue (MilterReplySignals *reply, gpointer user_data)
+{
+    n_handler_continues++;
+}
+
+static const MilterReplyHandlers handlers = {
+    NULL,
+    handler_continue
+};
+
 static void
 setup_signals (MilterDecoder *decoder)
 {
@@ -375,6 +390,7 @@ setup (void)
     n_add_recipients = 0;
     n_change_froms = 0;
     n_bodies = 0;
+    n_handler_continues = 0;
 
     buffer = g_string_new(NULL);
 
@@ -1250,6 +1266,34 @@ test_decode_replace_body (void)
     cut_assert_equal_uint(strlen(body), actual_body_chunk_length);
 }
 
+void
+test_decode_continue_with_handlers (void)
+{
+    milter_reply_decoder_set_handlers(MILTER_REPLY_DECODER(decoder),
+                                      &handlers, NULL);
+
+    g_string_append(buffer, "c");
+    gcut_assert_error(decode());
+
+    cut_assert_equal_int(1, n_handler_continues);
+    cut_assert_equal_int(1, n_continues);
+}
+
+void
+test_decode_continue_with_handlers_only (void)
+{
+    milter_reply_decoder_set_handlers(MILTER_REPLY_DECODER(decoder),
+                                      &handlers, NULL);
+    g_signal_handlers_disconnect_by_func(decoder,
+                                         G_CALLBACK(cb_continue), NULL);
+
+    g_string_append(buffer, "c");
+    gcut_assert_error(decode());
+
+    cut_assert_equal_int(1, n_handler_continues);
+    cut_assert_equal_int(0, n_continues);
+}
+
 /*
 vi:ts=4:nowrap:ai:expandtab:sw=4
 */
@@ -31,6 +31,7 @@ void test_inspect_object (void);
 void test_inspect_hash_string_string (void);
 void test_merge_hash_string_string (void);
 void test_inspect_list_pointer (void);
+void test_intern_macro_name (void);
 void data_command_to_macro_stage (void);
 void test_command_to_macro_stage (gconstpointer data);
 void data_macro_stage_to_command (void);
@@ -274,6 +275,23 @@ test_merge_hash_string_string (void)
     gcut_assert_equal_hash_table_string_string(expected, dest);
 }
 
+void
+test_intern_macro_name (void)
+{
+    const gchar *interned_name;
+
+    interned_name = milter_utils_intern_macro_name("{daemon_name}", -1);
+    cut_assert_equal_string("daemon_name", interned_name);
+    cut_assert_equal_pointer(g_intern_string("daemon_name"), interned_name);
+    cut_assert_equal_pointer(interned_name,
+                             milter_utils_intern_macro_name("daemon_name", -1));
+    cut_assert_equal_pointer(interned_name,
+                             milter_utils_intern_macro_name("{daemon_name}XXX",
+                                                            13));
+    cut_assert_equal_string("i", milter_utils_intern_macro_name("i", -1));
+    cut_assert_equal_string("{", milter_utils_intern_macro_name("{", -1));
+}
+
 void
 test_inspect_list_pointer (void)
 {
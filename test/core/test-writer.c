@@ -24,17 +24,26 @@
 #include <milter/core/milter-writer.h>
 #undef shutdown
 #include <errno.h>
+#include <unistd.h>
+#include <sys/socket.h>
 
 void test_writer (void);
 void test_writer_huge_data (void);
 void test_writer_error (void);
 void test_tag (void);
+void test_write_buffer (void);
+void test_direct_write (void);
+void test_drain (void);
+void test_drain_partial_write (void);
 
 static MilterEventLoop *loop;
 
 static MilterWriter *writer;
 
 static GIOChannel *channel;
+static GIOChannel *unix_channel;
+static MilterWriter *unix_writer;
+static gint peer_fd;
 
 static GError *expected_error;
 static GError *actual_error;
@@ -63,6 +72,10 @@ cut_setup (void)
     milter_writer_start(writer, loop);
     setup_error_callback();
 
+    unix_channel = NULL;
+    unix_writer = NULL;
+    peer_fd = -1;
+
     expected_error = NULL;
     actual_error = NULL;
 }
@@ -76,6 +89,13 @@ cut_teardown (void)
     if (writer)
         g_object_unref(writer);
 
+    if (unix_writer)
+        g_object_unref(unix_writer);
+    if (unix_channel)
+        g_io_channel_unref(unix_channel);
+    if (peer_fd != -1)
+        close(peer_fd);
+
     if (loop)
         g_object_unref(loop);
 
@@ -205,6 +225,161 @@ test_tag (void)
     cut_assert_equal_uint(29, milter_writer_get_tag(writer));
 }
 
+void
+test_write_buffer (void)
+{
+    GString *buffer;
+    GString *actual_data;
+    GError *error = NULL;
+
+    buffer = g_string_new("first\n");
+    milter_writer_write_buffer(writer, buffer, &error);
+    gcut_assert_error(error);
+
+    buffer = g_string_new("second\n");
+    milter_writer_write_buffer(writer, buffer, &error);
+    gcut_assert_error(error);
+
+    milter_writer_flush(writer, &error);
+    gcut_assert_error(error);
+
+    pump_all_events();
+
+    actual_data = gcut_string_io_channel_get_string(channel);
+    cut_assert_equal_string("first\nsecond\n", actual_data->str);
+}
+
+void
+test_direct_write (void)
+{
+    gint fds[2];
+    gchar data[64];
+    gssize read_size;
+    GError *error = NULL;
+
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds) == -1)
+        cut_error_errno();
+    peer_fd = fds[1];
+    unix_channel = g_io_channel_unix_new(fds[0]);
+    g_io_channel_set_close_on_unref(unix_channel, TRUE);
+    g_io_channel_set_encoding(unix_channel, NULL, NULL);
+
+    unix_writer = milter_writer_unix_io_channel_new(unix_channel);
+    milter_writer_set_direct_write(unix_writer, TRUE);
+    milter_writer_start(unix_writer, loop);
+
+    milter_writer_write(unix_writer, "direct\n", strlen("direct\n"), &error);
+    gcut_assert_error(error);
+
+    read_size = read(peer_fd, data, sizeof(data));
+    cut_assert_equal_memory("direct\n", strlen("direct\n"),
+                            data, read_size);
+}
+
+static void
+setup_unix_writer (void)
+{
+    gint fds[2];
+    GError *error = NULL;
+
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds) == -1)
+        cut_error_errno();
+    peer_fd = fds[1];
+    unix_channel = g_io_channel_unix_new(fds[0]);
+    g_io_channel_set_close_on_unref(unix_channel, TRUE);
+    g_io_channel_set_encoding(unix_channel, NULL, NULL);
+    g_io_channel_set_flags(unix_channel, G_IO_FLAG_NONBLOCK, &error);
+    gcut_assert_error(error);
+
+    unix_writer = milter_writer_unix_io_channel_new(unix_channel);
+    milter_writer_start(unix_writer, loop);
+}
+
+static gsize
+fill_socket_buffer (gint fd)
+{
+    gchar data[4096];
+    gsize filled_size = 0;
+
+    memset(data, 'x', sizeof(data));
+    while (TRUE) {
+        gssize written_size;
+
+        written_size = write(fd, data, sizeof(data));
+        if (written_size == -1) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK)
+                break;
+            cut_error_errno();
+        }
+        filled_size += written_size;
+    }
+
+    return filled_size;
+}
+
+static void
+read_all (gint fd, gsize size)
+{
+    gchar data[4096];
+
+    while (size > 0) {
+        gssize read_size;
+
+        read_size = read(fd, data, MIN(size, sizeof(data)));
+        if (read_size <= 0)
+            cut_error_errno();
+        size -= read_size;
+    }
+}
+
+void
+test_drain (void)
+{
+    gchar data[64];
+    gssize read_size;
+    GError *error = NULL;
+
+    cut_trace(setup_unix_writer());
+
+    milter_writer_write(unix_writer, "drained\n", strlen("drained\n"),
+                        &error);
+    gcut_assert_error(error);
+
+    cut_assert_true(milter_writer_drain(unix_writer, &error));
+    gcut_assert_error(error);
+
+    read_size = read(peer_fd, data, sizeof(data));
+    cut_assert_equal_memory("drained\n", strlen("drained\n"),
+                            data, read_size);
+}
+
+void
+test_drain_partial_write (void)
+{
+    gchar data[64];
+    gssize read_size;
+    gsize filled_size;
+    GError *error = NULL;
+
+    cut_trace(setup_unix_writer());
+    filled_size =
+        fill_socket_buffer(g_io_channel_unix_get_fd(unix_channel));
+
+    milter_writer_write(unix_writer, "rest\n", strlen("rest\n"), &error);
+    gcut_assert_error(error);
+
+    cut_assert_false(milter_writer_drain(unix_writer, &error));
+    gcut_assert_error(error);
+
+    read_all(peer_fd, filled_size);
+    cut_assert_true(milter_writer_drain(unix_writer, &error));
+    gcut_assert_error(error);
+
+    read_size = read(peer_fd, data, sizeof(data));
+    cut_assert_equal_memory("rest\n", strlen("rest\n"),
+                            data, read_size);
+}
+
 /*
 vi:ts=4:nowrap:ai:expandtab:sw=4
 */
@@ -112,6 +112,12 @@ class MilterTestClient
         @negotiate_flags += flag.split(/\|/)
       end
 
+      opts.on("--negotiate-actions=ACTION1|ACTION2|..",
+              "Restrict action flags of negotiate option") do |action|
+        @negotiate_actions ||= []
+        @negotiate_actions += action.split(/\|/)
+      end
+
       opts.on("--quarantine=REASON",
               "Send quarantine with REASON on end-of-message") do |reason|
         @end_of_message_actions << ["quarantine", reason]
@@ -215,6 +221,11 @@ class MilterTestClient
         @body_chunks << [@current_action, chunk]
       end
 
+      opts.on("--body-wait-second=SECOND", Float,
+              "Wait in SECOND before replying to body") do |second|
+        @body_wait_second = second
+      end
+
       opts.on("--body-regexp=CHUNK_REGEXP",
               "Add CHUNK_REGEXP targets to be applied ACTION") do |chunk_regexp|
         @body_chunks << [@current_action, Regexp.new(chunk_regexp)]
@@ -278,6 +289,8 @@ class MilterTestClient
     @end_of_message_chunks = []
     @negotiate_version = nil
     @negotiate_flags = ["none"]
+    @negotiate_actions = nil
+    @body_wait_second = 0
     @quit_without_reply_action = nil
   end
 
@@ -419,6 +432,9 @@ class MilterTestClient
     @option = option
     @option.version = @negotiate_version || @option.version
     @option.step &= resolve_flags(Milter::StepFlags, @negotiate_flags)
+    if @negotiate_actions
+      @option.action &= resolve_flags(Milter::ActionFlags, @negotiate_actions)
+    end
 
     write(:negotiated, :negotiate, @option)
   end
@@ -541,6 +557,7 @@ class MilterTestClient
   def do_body(chunk)
     invalid_state(:body) unless valid_state?(:body)
     @content << chunk
+    sleep(@body_wait_second) if @body_wait_second > 0
 
     @body_chunks.each do |action, body_chunk|
       if body_chunk === chunk
@@ -18,6 +18,9 @@
  */
 
 #include <string.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
 
 #include <milter/manager/milter-manager-applicable-condition.h>
 
@@ -30,15 +33,33 @@ void test_name (void);
 void test_description (void);
 void test_data (void);
 void test_merge (void);
+void test_network (void);
+void test_network_invalid (void);
+void test_remote_network (void);
+void test_remote_network_unix (void);
+void test_authenticated (void);
+void test_unauthenticated (void);
+void test_envelope_from_domain (void);
+void test_macro_equal (void);
+void test_macro_regex (void);
+void test_macro_unsupported_command (void);
+void test_threshold_n_connections (void);
+void test_notify_stress (void);
 
 static MilterManagerApplicableCondition *condition;
 static MilterManagerApplicableCondition *merged_condition;
+static MilterManagerChild *child;
+static GError *actual_error;
+static GError *expected_error;
 
 void
 setup (void)
 {
     condition = NULL;
     merged_condition = NULL;
+    child = NULL;
+    actual_error = NULL;
+    expected_error = NULL;
 }
 
 void
@@ -48,6 +69,46 @@ teardown (void)
         g_object_unref(condition);
     if (merged_condition)
         g_object_unref(merged_condition);
+    if (child)
+        g_object_unref(child);
+    if (actual_error)
+        g_error_free(actual_error);
+    if (expected_error)
+        g_error_free(expected_error);
+}
+
+static gboolean
+stop_on_connect (const gchar *ip_address)
+{
+    MilterGenericSocketAddress address;
+
+    memset(&address, 0, sizeof(address));
+    if (strchr(ip_address, ':')) {
+        address.address.inet6.sin6_family = AF_INET6;
+        address.address.inet6.sin6_port = htons(50443);
+        inet_pton(AF_INET6, ip_address,
+                  &(address.address.inet6.sin6_addr));
+    } else {
+        address.address.inet.sin_family = AF_INET;
+        address.address.inet.sin_port = htons(50443);
+        inet_pton(AF_INET, ip_address, &(address.address.inet.sin_addr));
+    }
+    return milter_manager_applicable_condition_should_stop_on_connect(
+        condition, child, NULL, "mx.example.com", &address);
+}
+
+static gboolean
+stop_on_envelope_from (const gchar *from)
+{
+    return milter_manager_applicable_condition_should_stop(
+        condition, child, MILTER_SERVER_CONTEXT_STATE_ENVELOPE_FROM, from);
+}
+
+static gboolean
+stop_on_helo (const gchar *fqdn)
+{
+    return milter_manager_applicable_condition_should_stop(
+        condition, child, MILTER_SERVER_CONTEXT_STATE_HELO, fqdn);
 }
 
 void
@@ -162,6 +223,238 @@ test_merge (void)
         milter_manager_applicable_condition_get_data(merged_condition));
 }
 
+void
+test_network (void)
+{
+    condition = milter_manager_applicable_condition_new("Local Network");
+    cut_assert_false(milter_manager_applicable_condition_have_native_rule(condition));
+    milter_manager_applicable_condition_add_network(condition,
+                                                    "192.168.0.0/16",
+                                                    TRUE,
+                                                    &actual_error);
+    gcut_assert_error(actual_error);
+    milter_manager_applicable_condition_add_network(condition,
+                                                    "192.168.1.1",
+                                                    FALSE,
+                                                    &actual_error);
+    gcut_assert_error(actual_error);
+    cut_assert_true(milter_manager_applicable_condition_have_native_rule(condition));
+
+    child = milter_manager_child_new("child-milter");
+
+    cut_assert_false(stop_on_connect("192.168.2.29"));
+    cut_assert_true(stop_on_connect("192.168.1.1"));
+    cut_assert_true(stop_on_connect("10.0.0.1"));
+}
+
+void
+test_network_invalid (void)
+{
+    condition = milter_manager_applicable_condition_new("Local Network");
+
+    expected_error =
+        g_error_new(MILTER_MANAGER_APPLICABLE_CONDITION_ERROR,
+                    MILTER_MANAGER_APPLICABLE_CONDITION_ERROR_INVALID_NETWORK,
+                    "invalid network prefix length: <192.168.0.0/33>");
+    cut_assert_false(
+        milter_manager_applicable_condition_add_network(condition,
+                                                        "192.168.0.0/33",
+                                                        TRUE,
+                                                        &actual_error));
+    gcut_assert_equal_error(expected_error, actual_error);
+    cut_assert_false(milter_manager_applicable_condition_have_native_rule(condition));
+}
+
+static void
+setup_remote_network_condition (void)
+{
+    condition = milter_manager_applicable_condition_new("Remote Network");
+    milter_manager_applicable_condition_add_local_network(condition,
+                                                          "192.168.0.0/16",
+                                                          &actual_error);
+    gcut_assert_error(actual_error);
+    milter_manager_applicable_condition_add_local_network(condition,
+                                                          "fe80::/16",
+                                                          &actual_error);
+    gcut_assert_error(actual_error);
+    milter_manager_applicable_condition_add_remote_network(condition,
+                                                           "192.168.1.0/24",
+                                                           &actual_error);
+    gcut_assert_error(actual_error);
+    cut_assert_true(milter_manager_applicable_condition_have_native_rule(condition));
+
+    child = milter_manager_child_new("child-milter");
+}
+
+void
+test_remote_network (void)
+{
+    cut_trace(setup_remote_network_condition());
+
+    cut_assert_true(stop_on_connect("192.168.2.29"));
+    cut_assert_false(stop_on_connect("192.168.1.29"));
+    cut_assert_false(stop_on_connect("160.29.167.10"));
+    cut_assert_true(stop_on_connect("fe80::1"));
+    cut_assert_true(stop_on_connect("::ffff:192.168.2.29"));
+    cut_assert_false(stop_on_connect("2001:2f8:c2:201::fff0"));
+}
+
+void
+test_remote_network_unix (void)
+{
+    MilterGenericSocketAddress address;
+
+    cut_trace(setup_remote_network_condition());
+
+    memset(&address, 0, sizeof(address));
+    address.address.un.sun_family = AF_UNIX;
+    cut_assert_true(milter_manager_applicable_condition_should_stop_on_connect(
+                        condition, child, NULL, "localhost", &address));
+    cut_assert_true(milter_manager_applicable_condition_should_stop_on_connect(
+                        condition, child, NULL, "unknown", NULL));
+}
+
+void
+test_authenticated (void)
+{
+    condition = milter_manager_applicable_condition_new("Authenticated");
+    milter_manager_applicable_condition_set_authentication(condition, TRUE);
+    cut_assert_true(milter_manager_applicable_condition_have_native_rule(condition));
+
+    child = milter_manager_child_new("child-milter");
+
+    cut_assert_true(stop_on_envelope_from("<user@example.com>"));
+    milter_protocol_agent_set_macro(MILTER_PROTOCOL_AGENT(child),
+                                    MILTER_COMMAND_ENVELOPE_FROM,
+                                    "auth_authen", "user");
+    cut_assert_false(stop_on_envelope_from("<user@example.com>"));
+}
+
+void
+test_unauthenticated (void)
+{
+    condition = milter_manager_applicable_condition_new("Unauthenticated");
+    milter_manager_applicable_condition_set_authentication(condition, FALSE);
+
+    child = milter_manager_child_new("child-milter");
+
+    cut_assert_false(stop_on_envelope_from("<user@example.com>"));
+    milter_protocol_agent_set_macro(MILTER_PROTOCOL_AGENT(child),
+                                    MILTER_COMMAND_ENVELOPE_FROM,
+                                    "auth_type", "PLAIN");
+    cut_assert_true(stop_on_envelope_from("<user@example.com>"));
+}
+
+void
+test_envelope_from_domain (void)
+{
+    condition = milter_manager_applicable_condition_new("Internal");
+    milter_manager_applicable_condition_add_envelope_from_domain(condition,
+                                                                 "Example.COM",
+                                                                 FALSE);
+
+    child = milter_manager_child_new("child-milter");
+
+    cut_assert_true(stop_on_envelope_from("<user@example.com>"));
+    cut_assert_false(stop_on_envelope_from("<user@example.net>"));
+    cut_assert_false(stop_on_envelope_from("<>"));
+}
+
+void
+test_macro_equal (void)
+{
+    condition = milter_manager_applicable_condition_new("Daemon");
+    milter_manager_applicable_condition_add_macro_equal(condition,
+                                                        MILTER_COMMAND_HELO,
+                                                        "{daemon_name}",
+                                                        "MTA-v4",
+                                                        TRUE,
+                                                        &actual_error);
+    gcut_assert_error(actual_error);
+
+    child = milter_manager_child_new("child-milter");
+
+    cut_assert_true(stop_on_helo("mx.example.com"));
+    milter_protocol_agent_set_macro(MILTER_PROTOCOL_AGENT(child),
+                                    MILTER_COMMAND_HELO,
+                                    "daemon_name", "MTA-v4");
+    cut_assert_false(stop_on_helo("mx.example.com"));
+}
+
+void
+test_macro_regex (void)
+{
+    condition = milter_manager_applicable_condition_new("Unauthenticated");
+    milter_manager_applicable_condition_add_macro_regex(condition,
+                                                        MILTER_COMMAND_HELO,
+                                                        "{auth_type}",
+                                                        "\\A(?:PLAIN|LOGIN)\\z",
+                                                        FALSE,
+                                                        &actual_error);
+    gcut_assert_error(actual_error);
+
+    child = milter_manager_child_new("child-milter");
+
+    cut_assert_false(stop_on_helo("mx.example.com"));
+    milter_protocol_agent_set_macro(MILTER_PROTOCOL_AGENT(child),
+                                    MILTER_COMMAND_HELO,
+                                    "auth_type", "PLAIN");
+    cut_assert_true(stop_on_helo("mx.example.com"));
+}
+
+void
+test_macro_unsupported_command (void)
+{
+    condition = milter_manager_applicable_condition_new("Header");
+
+    expected_error =
+        g_error_new(MILTER_MANAGER_APPLICABLE_CONDITION_ERROR,
+                    MILTER_MANAGER_APPLICABLE_CONDITION_ERROR_UNSUPPORTED_COMMAND,
+                    "unsupported command for macro rule: <L>");
+    cut_assert_false(
+        milter_manager_applicable_condition_add_macro_equal(condition,
+                                                            MILTER_COMMAND_HEADER,
+                                                            "i",
+                                                            "1234",
+                                                            TRUE,
+                                                            &actual_error));
+    gcut_assert_equal_error(expected_error, actual_error);
+}
+
+void
+test_threshold_n_connections (void)
+{
+    condition = milter_manager_applicable_condition_new("No Stress");
+    cut_assert_equal_uint(
+        0,
+        milter_manager_applicable_condition_get_threshold_n_connections(condition));
+    milter_manager_applicable_condition_set_threshold_n_connections(condition,
+                                                                    100);
+    cut_assert_equal_uint(
+        100,
+        milter_manager_applicable_condition_get_threshold_n_connections(condition));
+    cut_assert_true(milter_manager_applicable_condition_have_native_rule(condition));
+}
+
+void
+test_notify_stress (void)
+{
+    condition = milter_manager_applicable_condition_new("Stress Notify");
+    cut_assert_false(milter_manager_applicable_condition_is_notify_stress(condition));
+    milter_manager_applicable_condition_set_notify_stress(condition, TRUE);
+    cut_assert_true(milter_manager_applicable_condition_is_notify_stress(condition));
+    milter_manager_applicable_condition_set_threshold_n_connections(condition,
+                                                                    1);
+
+    child = milter_manager_child_new("child-milter");
+
+    cut_assert_false(stop_on_connect("192.168.1.1"));
+    cut_assert_equal_string(
+        NULL,
+        milter_protocol_agent_get_macro(MILTER_PROTOCOL_AGENT(child),
+                                        "stress"));
+}
+
 /*
 vi:ts=4:nowrap:ai:expandtab:sw=4
 */
@@ -25,6 +25,7 @@
 #include <errno.h>
 
 #include <milter/manager/milter-manager-children.h>
+#include <milter/manager/milter-manager-applicable-condition.h>
 #include <milter/manager/milter-manager-enum-types.h>
 #include <milter/manager/milter-manager-process-launcher.h>
 
@@ -45,6 +46,7 @@ void test_connect (void);
 void test_connect_with_macro (void);
 void test_connect_stop (void);
 void test_connect_half_stop (void);
+void test_connect_native_stop (void);
 void test_connect_no_reply (void);
 void test_helo (void);
 void test_helo_no_reply (void);
@@ -61,8 +63,16 @@ void test_end_of_header (void);
 void test_end_of_header_with_protocol_version2 (void);
 void test_end_of_header_no_reply (void);
 void test_body (void);
+void test_body_on_file (void);
+void test_body_on_memory_file (void);
+void test_body_over_memory_budget (void);
 void test_body_with_protocol_version2 (void);
 void test_body_no_reply (void);
+void test_body_on_file_no_reply (void);
+void test_body_streaming (void);
+void test_body_streaming_after_body_changer (void);
+void test_body_streaming_backpressure (void);
+void test_body_streaming_reject (void);
 void data_important_status (void);
 void test_important_status (gconstpointer data);
 void data_not_important_status (void);
@@ -72,6 +82,8 @@ void test_connection_timeout (void);
 void test_end_of_message_timeout (void);
 void test_writing_timeout (void);
 void test_end_of_message_with_protocol_version2 (void);
+void test_pooled_connection (void);
+void test_pooled_connection_with_protocol_version2 (void);
 
 static gchar *scenario_dir;
 static MilterManagerTestScenario *main_scenario;
@@ -137,6 +149,12 @@ static gboolean default_handler_disconnected;
         test_clients,                                                   \
         milter_manager_test_client_get_n_ ## event ## _received)
 
+#define wait_n_received(event, n_received)                              \
+    milter_manager_test_clients_wait_n_replies(                         \
+        test_clients,                                                   \
+        milter_manager_test_client_get_n_ ## event ## _received,        \
+        n_received)
+
 void
 cut_startup (void)
 {
@@ -1298,6 +1316,46 @@ test_connect_stop (void)
     wait_reply(1, n_accept_emitted);
 }
 
+static void
+attach_native_condition (gpointer data, gpointer user_data)
+{
+    MilterManagerChild *child = data;
+    MilterManagerApplicableCondition *condition = user_data;
+
+    milter_manager_applicable_condition_attach_to(condition, child,
+                                                  children, NULL);
+}
+
+void
+test_connect_native_stop (void)
+{
+    MilterManagerApplicableCondition *condition;
+    struct sockaddr_in address;
+    const gchar host_name[] = "mx.local.net";
+    const gchar ip_address[] = "192.168.123.123";
+
+    cut_trace(test_negotiate());
+
+    condition = milter_manager_applicable_condition_new("Remote Network");
+    gcut_take_object(G_OBJECT(condition));
+    milter_manager_applicable_condition_add_local_network(condition,
+                                                          "192.168.0.0/16",
+                                                          NULL);
+    milter_manager_children_foreach(children, attach_native_condition,
+                                    condition);
+
+    address.sin_family = AF_INET;
+    address.sin_port = g_htons(50443);
+    inet_pton(AF_INET, ip_address, &(address.sin_addr));
+
+    milter_manager_children_connect(children,
+                                    host_name,
+                                    (struct sockaddr *)(&address),
+                                    sizeof(address));
+    wait_reply(1, n_accept_emitted);
+    cut_assert_equal_uint(0, n_continue_emitted);
+}
+
 static gboolean
 have_quitted_context (GList *child_list)
 {
@@ -1591,6 +1649,36 @@ test_body (void)
     wait_reply(8, n_continue_emitted);
 }
 
+void
+test_body_on_file (void)
+{
+    milter_manager_configuration_set_max_on_memory_body_size(config, 1);
+    cut_trace(test_body());
+}
+
+void
+test_body_on_memory_file (void)
+{
+    milter_manager_configuration_set_max_on_memory_body_size(config, 1);
+    milter_manager_configuration_set_body_spool_memory_budget(config, 1024);
+    cut_trace(test_body());
+}
+
+void
+test_body_over_memory_budget (void)
+{
+    const gchar chunk[] = "message body";
+
+    milter_manager_configuration_set_max_on_memory_body_size(config, 1);
+    milter_manager_configuration_set_body_spool_memory_budget(config,
+                                                              strlen(chunk));
+    cut_trace(test_body());
+
+    milter_manager_children_body(children, chunk, strlen(chunk));
+    wait_reply(9, n_continue_emitted);
+    cut_assert_equal_uint(0, n_error_emitted);
+}
+
 void
 test_body_with_protocol_version2 (void)
 {
@@ -1628,6 +1716,136 @@ test_body_no_reply (void)
     cut_assert_false(milter_manager_children_is_waiting_reply(children));
 }
 
+void
+test_body_on_file_no_reply (void)
+{
+    const gchar chunk[] = "message body";
+    const GList *expected_chunks;
+    guint i, n_chunks = 3;
+
+    step |= MILTER_STEP_NO_REPLY_BODY;
+    arguments_append(arguments1,
+                     "--negotiate-flags", "no-reply-body",
+                     NULL);
+    arguments_append(arguments2,
+                     "--negotiate-flags", "no-reply-body",
+                     NULL);
+    milter_manager_configuration_set_max_on_memory_body_size(config, 1);
+    cut_trace(test_end_of_header());
+    milter_test_pump_all_events(loop);
+
+    /* The MTA sends the next chunk without waiting for a reply. */
+    for (i = 0; i < n_chunks; i++) {
+        cut_assert_true(milter_manager_children_body(children,
+                                                     chunk, strlen(chunk)));
+    }
+    cut_assert_true(milter_manager_children_end_of_message(children, NULL, 0));
+    wait_reply(8, n_continue_emitted);
+    cut_trace(wait_n_received(end_of_message, 2));
+
+    cut_assert_equal_uint(n_chunks + 1, collect_n_received(body));
+    expected_chunks = gcut_take_new_list_string("message body"
+                                                "message body"
+                                                "message body",
+                                                "message body"
+                                                "message body"
+                                                "message body",
+                                                NULL);
+    gcut_assert_equal_list_string(
+        expected_chunks,
+        milter_manager_test_clients_collect_strings(
+            test_clients,
+            milter_manager_test_client_get_body_chunk));
+    cut_assert_equal_uint(0, n_error_emitted);
+}
+
+void
+test_body_streaming (void)
+{
+    const gchar chunk[] = "message body";
+
+    arguments_append(arguments1,
+                     "--negotiate-actions", "none",
+                     NULL);
+    cut_trace(test_end_of_header());
+
+    milter_manager_children_body(children, chunk, strlen(chunk));
+    wait_reply(8, n_continue_emitted);
+    cut_trace(wait_n_received(body, 2));
+    cut_assert_equal_uint(0, collect_n_received(end_of_message));
+
+    milter_manager_children_end_of_message(children, NULL, 0);
+    wait_reply(9, n_continue_emitted);
+    cut_trace(wait_n_received(end_of_message, 2));
+}
+
+void
+test_body_streaming_after_body_changer (void)
+{
+    cut_trace(test_body());
+    milter_test_pump_all_events(loop);
+    cut_assert_equal_uint(1, collect_n_received(body));
+
+    milter_manager_children_end_of_message(children, NULL, 0);
+    wait_reply(9, n_continue_emitted);
+    cut_trace(wait_n_received(body, 2));
+}
+
+void
+test_body_streaming_backpressure (void)
+{
+    const gchar chunk[] = "message body";
+    GTimer *timer;
+    gdouble elapsed;
+    guint i, n_chunks = 12;
+
+    arguments_append(arguments1,
+                     "--negotiate-actions", "none",
+                     NULL);
+    arguments_append(arguments2,
+                     "--body-wait-second", "0.03",
+                     NULL);
+    cut_trace(test_end_of_header());
+
+    timer = g_timer_new();
+    for (i = 0; i < n_chunks; i++) {
+        milter_manager_children_body(children, chunk, strlen(chunk));
+        wait_reply(8 + i, n_continue_emitted);
+    }
+    elapsed = g_timer_elapsed(timer, NULL);
+    g_timer_destroy(timer);
+    /* the second child can fall behind by at most 8 chunks. */
+    cut_assert_operator_double(elapsed, >=, 0.1);
+
+    milter_manager_children_end_of_message(children, NULL, 0);
+    wait_reply(8 + n_chunks, n_continue_emitted);
+    cut_trace(wait_n_received(body, n_chunks * 2));
+}
+
+void
+test_body_streaming_reject (void)
+{
+    const gchar chunk[] = "message body";
+
+    arguments_append(arguments1,
+                     "--negotiate-actions", "none",
+                     NULL);
+    arguments_append(arguments2,
+                     "--body", chunk,
+                     NULL);
+    cut_trace(test_end_of_header());
+
+    milter_manager_children_body(children, chunk, strlen(chunk));
+    wait_reply(8, n_continue_emitted);
+    cut_trace(wait_n_received(body, 2));
+    milter_test_pump_all_events(loop);
+    cut_assert_equal_uint(0, n_reject_emitted);
+
+    milter_manager_children_end_of_message(children, NULL, 0);
+    wait_reply(1, n_reject_emitted);
+    cut_trace(wait_n_received(end_of_message, 1));
+}
+
 #define is_important_status(children, state, next_status)                    \
     milter_manager_children_is_important_status(children, state, next_status)
 
@@ -2112,6 +2330,103 @@ test_end_of_message_with_protocol_version2 (void)
     cut_assert_equal_uint(1, collect_n_received(data));
 }
 
+static MilterManagerEgg *
+add_pooled_child (const gchar *name, const gchar *connection_spec)
+{
+    MilterManagerEgg *egg;
+    MilterManagerChild *child;
+
+    egg = milter_manager_configuration_find_egg(config, name);
+    if (!egg) {
+        egg = egg_new(name, connection_spec);
+        cut_assert_not_null(egg);
+        milter_manager_egg_set_connection_pool_size(egg, 1);
+        milter_manager_configuration_add_egg(config, egg);
+        g_object_unref(egg);
+    }
+
+    child = milter_manager_egg_hatch(egg);
+    milter_manager_children_add_child(children, child);
+    g_object_unref(child);
+
+    return egg;
+}
+
+static void
+start_pooled_session (void)
+{
+    struct sockaddr_in address;
+    const gchar host_name[] = "mx.local.net";
+    const gchar ip_address[] = "192.168.123.123";
+
+    address.sin_family = AF_INET;
+    address.sin_port = g_htons(50443);
+    inet_pton(AF_INET, ip_address, &(address.sin_addr));
+
+    milter_manager_children_negotiate(children, option, NULL);
+    wait_reply(1, n_negotiate_reply_emitted);
+
+    milter_manager_children_connect(children,
+                                    host_name,
+                                    (struct sockaddr *)(&address),
+                                    sizeof(address));
+    wait_reply(1, n_continue_emitted);
+}
+
+static void
+renew_children (void)
+{
+    g_object_unref(children);
+    clear_n_emitted();
+    children = milter_manager_children_new(config, loop);
+    setup_signals(children);
+}
+
+void
+test_pooled_connection (void)
+{
+    MilterManagerEgg *egg;
+
+    option = milter_option_new(6, MILTER_ACTION_ADD_HEADERS, step);
+
+    start_client(10026, arguments1);
+
+    egg = add_pooled_child("milter@10026", "inet:10026@localhost");
+    cut_trace(start_pooled_session());
+    cut_assert_equal_uint(0, milter_manager_egg_get_n_pooled_connections(egg));
+
+    cut_assert_true(milter_manager_children_quit(children));
+    cut_assert_equal_uint(1, milter_manager_egg_get_n_pooled_connections(egg));
+
+    cut_trace(renew_children());
+    add_pooled_child("milter@10026", "inet:10026@localhost");
+    cut_trace(start_pooled_session());
+    cut_assert_equal_uint(0, milter_manager_egg_get_n_pooled_connections(egg));
+    cut_assert_equal_uint(1, collect_n_received(negotiate));
+
+    cut_assert_true(milter_manager_children_quit(children));
+    cut_assert_equal_uint(1, milter_manager_egg_get_n_pooled_connections(egg));
+}
+
+void
+test_pooled_connection_with_protocol_version2 (void)
+{
+    MilterManagerEgg *egg;
+
+    option = milter_option_new(2, MILTER_ACTION_ADD_HEADERS, step);
+    arguments_append(arguments1,
+                     "--negotiate-version", "2",
+                     NULL);
+
+    start_client(10026, arguments1);
+
+    egg = add_pooled_child("milter@10026", "inet:10026@localhost");
+    cut_trace(start_pooled_session());
+
+    cut_assert_true(milter_manager_children_quit(children));
+    cut_assert_equal_uint(0, milter_manager_egg_get_n_pooled_connections(egg));
+}
+
 /*
 vi:ts=4:nowrap:ai:expandtab:sw=4
 */
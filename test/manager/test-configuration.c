@@ -52,8 +52,12 @@ void test_package_platform (void);
 void test_package_options (void);
 void test_event_loop_backend (void);
 void test_connection_check_interval (void);
+void test_connection_check_budget (void);
+void test_use_native_connection_checker (void);
 void test_location (void);
 void test_n_workers (void);
+void test_reuse_port (void);
+void test_direct_write (void);
 void test_default_packet_buffer_size (void);
 void test_prefix (void);
 void test_use_syslog (void);
@@ -61,12 +65,18 @@ void test_syslog_facility (void);
 void test_chunk_size (void);
 void test_chunk_size_over (void);
 void test_max_pending_finished_sessions (void);
+void test_max_on_memory_body_size (void);
+void test_body_spool_memory_budget (void);
+void test_statistics_path (void);
+void test_statistics_rotate_size (void);
 void test_egg (void);
 void test_find_egg (void);
 void test_remove_egg (void);
 void test_applicable_condition (void);
 void test_find_applicable_condition (void);
 void test_remove_applicable_condition (void);
+void test_have_session_hook_connected (void);
+void test_have_session_hook_attach_to (void);
 void test_clear (void);
 void test_load_paths (void);
 void test_load_absolute_path (void);
@@ -555,6 +565,29 @@ test_connection_check_interval (void)
         milter_manager_configuration_get_connection_check_interval(config));
 }
 
+void
+test_connection_check_budget (void)
+{
+    cut_assert_equal_uint(
+        10,
+        milter_manager_configuration_get_connection_check_budget(config));
+    milter_manager_configuration_set_connection_check_budget(config, 100);
+    cut_assert_equal_uint(
+        100,
+        milter_manager_configuration_get_connection_check_budget(config));
+}
+
+void
+test_use_native_connection_checker (void)
+{
+    cut_assert_false(
+        milter_manager_configuration_get_use_native_connection_checker(config));
+    milter_manager_configuration_set_use_native_connection_checker(config,
+                                                                   TRUE);
+    cut_assert_true(
+        milter_manager_configuration_get_use_native_connection_checker(config));
+}
+
 void
 test_n_workers (void)
 {
@@ -567,6 +600,22 @@ test_n_workers (void)
         milter_manager_configuration_get_n_workers(config));
 }
 
+void
+test_reuse_port (void)
+{
+    cut_assert_false(milter_manager_configuration_is_reuse_port(config));
+    milter_manager_configuration_set_reuse_port(config, TRUE);
+    cut_assert_true(milter_manager_configuration_is_reuse_port(config));
+}
+
+void
+test_direct_write (void)
+{
+    cut_assert_false(milter_manager_configuration_is_direct_write(config));
+    milter_manager_configuration_set_direct_write(config, TRUE);
+    cut_assert_true(milter_manager_configuration_is_direct_write(config));
+}
+
 void
 test_default_packet_buffer_size (void)
 {
@@ -643,6 +692,57 @@ test_max_pending_finished_sessions (void)
         milter_manager_configuration_get_max_pending_finished_sessions(config));
 }
 
+void
+test_max_on_memory_body_size (void)
+{
+    cut_assert_equal_uint(
+        5242880,
+        milter_manager_configuration_get_max_on_memory_body_size(config));
+    milter_manager_configuration_set_max_on_memory_body_size(config, 1024);
+    cut_assert_equal_uint(
+        1024,
+        milter_manager_configuration_get_max_on_memory_body_size(config));
+}
+
+void
+test_body_spool_memory_budget (void)
+{
+    gcut_assert_equal_uint64(
+        0,
+        milter_manager_configuration_get_body_spool_memory_budget(config));
+    milter_manager_configuration_set_body_spool_memory_budget(config,
+                                                              G_GUINT64_CONSTANT(104857600));
+    gcut_assert_equal_uint64(
+        G_GUINT64_CONSTANT(104857600),
+        milter_manager_configuration_get_body_spool_memory_budget(config));
+}
+
+void
+test_statistics_path (void)
+{
+    cut_assert_equal_string(
+        NULL,
+        milter_manager_configuration_get_statistics_path(config));
+    milter_manager_configuration_set_statistics_path(
+        config, "/var/log/milter-manager/statistics.json");
+    cut_assert_equal_string(
+        "/var/log/milter-manager/statistics.json",
+        milter_manager_configuration_get_statistics_path(config));
+}
+
+void
+test_statistics_rotate_size (void)
+{
+    gcut_assert_equal_uint64(
+        G_GUINT64_CONSTANT(104857600),
+        milter_manager_configuration_get_statistics_rotate_size(config));
+    milter_manager_configuration_set_statistics_rotate_size(config,
+                                                            G_GUINT64_CONSTANT(1048576));
+    gcut_assert_equal_uint64(
+        G_GUINT64_CONSTANT(1048576),
+        milter_manager_configuration_get_statistics_rotate_size(config));
+}
+
 static void
 milter_assert_default_configuration_helper (MilterManagerConfiguration *config)
 {
@@ -714,6 +814,11 @@ milter_assert_default_configuration_helper (MilterManagerConfiguration *config)
     cut_assert_equal_uint(
         0,
         milter_manager_configuration_get_connection_check_interval(config));
+    cut_assert_equal_uint(
+        10,
+        milter_manager_configuration_get_connection_check_budget(config));
+    cut_assert_false(
+        milter_manager_configuration_get_use_native_connection_checker(config));
 
     gcut_assert_equal_enum(
         MILTER_TYPE_CLIENT_EVENT_LOOP_BACKEND,
@@ -742,6 +847,19 @@ milter_assert_default_configuration_helper (MilterManagerConfiguration *config)
         0,
         milter_manager_configuration_get_max_pending_finished_sessions(config));
 
+    cut_assert_equal_uint(
+        5242880,
+        milter_manager_configuration_get_max_on_memory_body_size(config));
+    gcut_assert_equal_uint64(
+        0,
+        milter_manager_configuration_get_body_spool_memory_budget(config));
+    cut_assert_equal_string(
+        NULL,
+        milter_manager_configuration_get_statistics_path(config));
+    gcut_assert_equal_uint64(
+        G_GUINT64_CONSTANT(104857600),
+        milter_manager_configuration_get_statistics_rotate_size(config));
+
     if (expected_children)
         g_object_unref(expected_children);
     expected_children = milter_manager_children_new(config, loop);
@@ -884,6 +1002,50 @@ test_find_applicable_condition (void)
                                                                "nonexistent"));
 }
 
+static void
+cb_connected (MilterManagerConfiguration *configuration,
+              MilterManagerLeader *leader, gpointer user_data)
+{
+}
+
+static void
+cb_attach_to (MilterManagerApplicableCondition *condition,
+              MilterManagerChild *child,
+              MilterManagerChildren *children,
+              MilterClientContext *context,
+              gpointer user_data)
+{
+}
+
+void
+test_have_session_hook_connected (void)
+{
+    cut_assert_false(milter_manager_configuration_have_session_hook(config));
+    g_signal_connect(config, "connected", G_CALLBACK(cb_connected), NULL);
+    cut_assert_true(milter_manager_configuration_have_session_hook(config));
+}
+
+void
+test_have_session_hook_attach_to (void)
+{
+    MilterManagerEgg *milter;
+    MilterManagerApplicableCondition *stopper;
+
+    milter = milter_manager_egg_new("child-milter");
+    gcut_take_object(G_OBJECT(milter));
+    stopper = milter_manager_applicable_condition_new("Remote Network");
+    gcut_take_object(G_OBJECT(stopper));
+    milter_manager_applicable_condition_add_local_network(stopper,
+                                                          "192.168.0.0/16",
+                                                          NULL);
+    milter_manager_egg_add_applicable_condition(milter, stopper);
+    milter_manager_configuration_add_egg(config, milter);
+    cut_assert_false(milter_manager_configuration_have_session_hook(config));
+
+    g_signal_connect(stopper, "attach-to", G_CALLBACK(cb_attach_to), NULL);
+    cut_assert_true(milter_manager_configuration_have_session_hook(config));
+}
+
 void
 test_remove_applicable_condition (void)
 {
@@ -960,12 +1122,18 @@ test_clear (void)
     test_max_file_descriptors();
     test_event_loop_backend();
     test_connection_check_interval();
+    test_connection_check_budget();
+    test_use_native_connection_checker();
     test_n_workers();
     test_default_packet_buffer_size();
     test_use_syslog();
     test_syslog_facility();
     test_chunk_size();
     test_max_pending_finished_sessions();
+    test_max_on_memory_body_size();
+    test_body_spool_memory_budget();
+    test_statistics_path();
+    test_statistics_rotate_size();
 
     handler_id = g_signal_connect(config, "connected",
                                   G_CALLBACK(cb_connected), NULL);
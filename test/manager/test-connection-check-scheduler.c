@@ -0,0 +1,281 @@
+/* -*- Mode: C; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+/*
+ *  Copyright (C) 2026  Kouhei Sutou <kou@clear-code.com>
+ *
+ *  This library is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with this library.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <milter/manager/milter-manager-connection-check-scheduler.h>
+
+#include <gcutter.h>
+
+void test_check_after_interval (void);
+void test_not_waiting (void);
+void test_interval_longer_than_wheel (void);
+void test_budget_carry_over (void);
+void test_remove_self_while_checking (void);
+void test_remove_rest_of_bucket_while_checking (void);
+
+typedef struct _Leader Leader;
+struct _Leader
+{
+    const gchar *name;
+    gboolean waiting;
+    gulong check_usec;
+    GList *remove_on_check;
+    MilterManagerConnectionCheckEntry *entry;
+};
+
+static MilterManagerConnectionCheckScheduler *scheduler;
+static GList *leaders;
+static GString *checked;
+static guint n_prepared;
+
+static void
+cb_prepare (gpointer user_data)
+{
+    n_prepared++;
+}
+
+static gboolean
+cb_is_waiting (gpointer data, gpointer user_data)
+{
+    Leader *leader = data;
+
+    return leader->waiting;
+}
+
+static void
+cb_check (gpointer data, gpointer user_data)
+{
+    Leader *leader = data;
+    GList *node;
+
+    g_string_append_printf(checked, "%s@%u ",
+                           leader->name,
+                           milter_manager_connection_check_scheduler_get_tick(
+                               scheduler));
+    if (leader->check_usec > 0)
+        g_usleep(leader->check_usec);
+
+    for (node = leader->remove_on_check; node; node = g_list_next(node)) {
+        Leader *removed = node->data;
+
+        milter_manager_connection_check_scheduler_remove(scheduler,
+                                                         removed->entry);
+        removed->entry = NULL;
+    }
+}
+
+static const MilterManagerConnectionCheckSchedulerFuncs funcs = {
+    cb_prepare,
+    cb_is_waiting,
+    cb_check
+};
+
+void
+setup (void)
+{
+    scheduler = milter_manager_connection_check_scheduler_new(&funcs, NULL);
+    leaders = NULL;
+    checked = g_string_new(NULL);
+    n_prepared = 0;
+}
+
+static void
+free_leader (gpointer data, gpointer user_data)
+{
+    Leader *leader = data;
+
+    g_list_free(leader->remove_on_check);
+    g_free(leader);
+}
+
+void
+teardown (void)
+{
+    if (scheduler)
+        milter_manager_connection_check_scheduler_free(scheduler);
+    if (leaders) {
+        g_list_foreach(leaders, free_leader, NULL);
+        g_list_free(leaders);
+    }
+    if (checked)
+        g_string_free(checked, TRUE);
+}
+
+static Leader *
+add_leader (const gchar *name, gboolean waiting)
+{
+    Leader *leader;
+
+    leader = g_new0(Leader, 1);
+    leader->name = name;
+    leader->waiting = waiting;
+    leader->entry = milter_manager_connection_check_scheduler_add(scheduler,
+                                                                  leader);
+    leaders = g_list_append(leaders, leader);
+
+    return leader;
+}
+
+static void
+run_ticks (guint n_ticks, guint interval)
+{
+    guint i;
+
+    for (i = 0; i < n_ticks; i++) {
+        cut_assert_true(milter_manager_connection_check_scheduler_run(scheduler,
+                                                                      interval,
+                                                                      0));
+    }
+}
+
+void
+test_check_after_interval (void)
+{
+    add_leader("a", TRUE);
+
+    run_ticks(3, 3);
+    cut_assert_equal_string("", checked->str);
+    cut_assert_equal_uint(0, n_prepared);
+
+    run_ticks(1, 3);
+    cut_assert_equal_string("a@4 ", checked->str);
+    cut_assert_equal_uint(1, n_prepared);
+
+    run_ticks(3, 3);
+    cut_assert_equal_string("a@4 a@7 ", checked->str);
+    cut_assert_equal_uint(2, n_prepared);
+}
+
+void
+test_not_waiting (void)
+{
+    Leader *leader;
+
+    leader = add_leader("a", FALSE);
+    run_ticks(5, 2);
+    cut_assert_equal_string("", checked->str);
+    cut_assert_equal_uint(0, n_prepared);
+
+    leader->waiting = TRUE;
+    run_ticks(2, 2);
+    cut_assert_equal_string("", checked->str);
+    run_ticks(1, 2);
+    cut_assert_equal_string("a@8 ", checked->str);
+}
+
+void
+test_interval_longer_than_wheel (void)
+{
+    add_leader("a", TRUE);
+
+    run_ticks(100, 100);
+    cut_assert_equal_string("", checked->str);
+
+    run_ticks(1, 100);
+    cut_assert_equal_string("a@101 ", checked->str);
+}
+
+void
+test_budget_carry_over (void)
+{
+    Leader *a, *b, *c;
+
+    a = add_leader("a", TRUE);
+    b = add_leader("b", TRUE);
+    c = add_leader("c", TRUE);
+    a->check_usec = b->check_usec = c->check_usec = 20 * 1000;
+
+    cut_assert_true(milter_manager_connection_check_scheduler_run(scheduler,
+                                                                  1, 10));
+    cut_assert_equal_string("", checked->str);
+
+    cut_assert_false(milter_manager_connection_check_scheduler_run(scheduler,
+                                                                   1, 10));
+    cut_assert_equal_string("a@2 ", checked->str);
+    cut_assert_equal_uint(
+        1,
+        milter_manager_connection_check_scheduler_get_n_behind_ticks(scheduler));
+
+    cut_assert_false(milter_manager_connection_check_scheduler_run(scheduler,
+                                                                   1, 10));
+    cut_assert_equal_string("a@2 b@3 ", checked->str);
+    cut_assert_equal_uint(
+        2,
+        milter_manager_connection_check_scheduler_get_n_behind_ticks(scheduler));
+
+    cut_assert_false(milter_manager_connection_check_scheduler_run(scheduler,
+                                                                   1, 10));
+    cut_assert_equal_string("a@2 b@3 c@4 ", checked->str);
+    cut_assert_equal_uint(3, n_prepared);
+
+    a->check_usec = b->check_usec = c->check_usec = 0;
+    cut_assert_true(milter_manager_connection_check_scheduler_run(scheduler,
+                                                                  1, 10));
+    cut_assert_equal_string("a@2 b@3 c@4 a@5 b@5 c@5 ", checked->str);
+    cut_assert_equal_uint(
+        0,
+        milter_manager_connection_check_scheduler_get_n_behind_ticks(scheduler));
+}
+
+void
+test_remove_self_while_checking (void)
+{
+    Leader *a, *b;
+
+    a = add_leader("a", TRUE);
+    b = add_leader("b", TRUE);
+    add_leader("c", TRUE);
+    a->remove_on_check = g_list_append(a->remove_on_check, a);
+    a->remove_on_check = g_list_append(a->remove_on_check, b);
+
+    run_ticks(2, 1);
+    cut_assert_equal_string("a@2 c@2 ", checked->str);
+    cut_assert_equal_uint(
+        1,
+        milter_manager_connection_check_scheduler_get_n_entries(scheduler));
+
+    run_ticks(1, 1);
+    cut_assert_equal_string("a@2 c@2 c@3 ", checked->str);
+}
+
+void
+test_remove_rest_of_bucket_while_checking (void)
+{
+    Leader *a, *b, *c;
+
+    a = add_leader("a", TRUE);
+    b = add_leader("b", TRUE);
+    c = add_leader("c", TRUE);
+    a->remove_on_check = g_list_append(a->remove_on_check, b);
+    a->remove_on_check = g_list_append(a->remove_on_check, c);
+
+    run_ticks(2, 1);
+    cut_assert_equal_string("a@2 ", checked->str);
+    cut_assert_equal_uint(
+        1,
+        milter_manager_connection_check_scheduler_get_n_entries(scheduler));
+
+    g_list_free(a->remove_on_check);
+    a->remove_on_check = NULL;
+    run_ticks(1, 1);
+    cut_assert_equal_string("a@2 a@3 ", checked->str);
+}
+
+/*
+vi:ts=4:nowrap:ai:expandtab:sw=4
+*/
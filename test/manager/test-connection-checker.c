@@ -0,0 +1,239 @@
+/* -*- Mode: C; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+/*
+ *  Copyright (C) 2026  Kouhei Sutou <kou@clear-code.com>
+ *
+ *  This library is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with this library.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <string.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#include <milter/manager/milter-manager-connection-checker.h>
+
+#include <milter-manager-test-utils.h>
+
+#include <gcutter.h>
+
+void data_is_connected_from_proc (void);
+void test_is_connected_from_proc (gconstpointer data);
+void test_unknown_port (void);
+void test_no_proc_file (void);
+
+#define CLOSE_WAIT 0x08
+#define LAST_ACK 0x09
+#define ESTABLISHED 0x01
+
+static MilterManagerConnectionChecker *checker;
+static gchar *tmp_dir;
+static gchar *tcp_path;
+static gchar *tcp6_path;
+static GError *actual_error;
+
+void
+setup (void)
+{
+    tmp_dir = g_build_filename(milter_test_get_base_dir(),
+                               "tmp",
+                               NULL);
+    cut_remove_path(tmp_dir, NULL);
+    if (g_mkdir_with_parents(tmp_dir, 0700) == -1)
+        cut_assert_errno();
+
+    tcp_path = g_build_filename(tmp_dir, "tcp", NULL);
+    tcp6_path = g_build_filename(tmp_dir, "tcp6", NULL);
+    checker = milter_manager_connection_checker_new();
+    actual_error = NULL;
+}
+
+void
+teardown (void)
+{
+    if (checker)
+        milter_manager_connection_checker_unref(checker);
+
+    if (tmp_dir) {
+        cut_remove_path(tmp_dir, NULL);
+        g_free(tmp_dir);
+    }
+    if (tcp_path)
+        g_free(tcp_path);
+    if (tcp6_path)
+        g_free(tcp6_path);
+    if (actual_error)
+        g_error_free(actual_error);
+}
+
+/* Formats an address as the kernel does: 32bit words in host order. */
+static void
+append_proc_address (GString *line, const guint8 *address, gsize size,
+                     guint16 port)
+{
+    gsize i;
+
+    for (i = 0; i < size; i += 4) {
+        guint32 word;
+        memcpy(&word, address + i, 4);
+        g_string_append_printf(line, "%08X", word);
+    }
+    g_string_append_printf(line, ":%04X", port);
+}
+
+static void
+append_proc_line (GString *content, gint family, const gchar *remote,
+                  guint16 port, guint state)
+{
+    guint8 local_address[16], remote_address[16];
+    gsize size;
+
+    size = family == AF_INET ? 4 : 16;
+    memset(local_address, 0, sizeof(local_address));
+    inet_pton(family, remote, remote_address);
+
+    g_string_append(content, "   0: ");
+    append_proc_address(content, local_address, size, 25);
+    g_string_append(content, " ");
+    append_proc_address(content, remote_address, size, port);
+    g_string_append_printf(content,
+                           " %02X 00000000:00000000 00:00000000 00000000"
+                           "     0        0 12345 1 0000000000000000 "
+                           "20 4 30 10 -1\n",
+                           state);
+}
+
+static void
+write_proc_files (void)
+{
+    GString *tcp, *tcp6;
+    GError *error = NULL;
+
+    tcp = g_string_new("  sl  local_address rem_address   st tx_queue "
+                       "rx_queue tr tm->when retrnsmt   uid  timeout inode\n");
+    tcp6 = g_string_new(tcp->str);
+
+    append_proc_line(tcp, AF_INET, "192.0.2.1", 50001, CLOSE_WAIT);
+    append_proc_line(tcp, AF_INET, "192.0.2.2", 50002, ESTABLISHED);
+    append_proc_line(tcp6, AF_INET6, "::ffff:192.0.2.3", 50003, CLOSE_WAIT);
+    append_proc_line(tcp6, AF_INET6, "2001:db8::1", 50004, LAST_ACK);
+    append_proc_line(tcp6, AF_INET6, "2001:db8::2", 50005, ESTABLISHED);
+
+    g_file_set_contents(tcp_path, tcp->str, tcp->len, &error);
+    gcut_assert_error(error);
+    g_file_set_contents(tcp6_path, tcp6->str, tcp6->len, &error);
+    gcut_assert_error(error);
+    g_string_free(tcp, TRUE);
+    g_string_free(tcp6, TRUE);
+}
+
+void
+data_is_connected_from_proc (void)
+{
+#define ADD(label, expected, family, address, port)                     \
+    gcut_add_datum(label,                                               \
+                   "expected", G_TYPE_BOOLEAN, expected,                \
+                   "family", G_TYPE_INT, family,                        \
+                   "address", G_TYPE_STRING, address,                   \
+                   "port", G_TYPE_UINT, port,                           \
+                   NULL)
+
+    ADD("IPv4 - close wait", FALSE, AF_INET, "192.0.2.1", 50001);
+    ADD("IPv4 - established", TRUE, AF_INET, "192.0.2.2", 50002);
+    ADD("IPv4 - other port", TRUE, AF_INET, "192.0.2.1", 50009);
+    ADD("IPv4 - not found", TRUE, AF_INET, "192.0.2.9", 50001);
+    ADD("IPv4 - mapped", FALSE, AF_INET, "192.0.2.3", 50003);
+    ADD("IPv6 - last ack", FALSE, AF_INET6, "2001:db8::1", 50004);
+    ADD("IPv6 - established", TRUE, AF_INET6, "2001:db8::2", 50005);
+
+#undef ADD
+}
+
+void
+test_is_connected_from_proc (gconstpointer data)
+{
+    gint family;
+    const gchar *address;
+    guint port;
+    struct sockaddr_in address_inet;
+    struct sockaddr_in6 address_inet6;
+    struct sockaddr *socket_address;
+    socklen_t socket_address_length;
+
+    write_proc_files();
+    milter_manager_connection_checker_update_from_proc(checker,
+                                                       tcp_path, tcp6_path,
+                                                       &actual_error);
+    gcut_assert_error(actual_error);
+
+    family = gcut_data_get_int(data, "family");
+    address = gcut_data_get_string(data, "address");
+    port = gcut_data_get_uint(data, "port");
+    if (family == AF_INET) {
+        memset(&address_inet, 0, sizeof(address_inet));
+        address_inet.sin_family = AF_INET;
+        address_inet.sin_port = g_htons(port);
+        inet_pton(AF_INET, address, &(address_inet.sin_addr));
+        socket_address = (struct sockaddr *)&address_inet;
+        socket_address_length = sizeof(address_inet);
+    } else {
+        memset(&address_inet6, 0, sizeof(address_inet6));
+        address_inet6.sin6_family = AF_INET6;
+        address_inet6.sin6_port = g_htons(port);
+        inet_pton(AF_INET6, address, &(address_inet6.sin6_addr));
+        socket_address = (struct sockaddr *)&address_inet6;
+        socket_address_length = sizeof(address_inet6);
+    }
+
+    cut_assert_equal_boolean(
+        gcut_data_get_boolean(data, "expected"),
+        milter_manager_connection_checker_is_connected(checker,
+                                                       socket_address,
+                                                       socket_address_length));
+}
+
+void
+test_unknown_port (void)
+{
+    struct sockaddr_in address;
+
+    write_proc_files();
+    milter_manager_connection_checker_update_from_proc(checker,
+                                                       tcp_path, tcp6_path,
+                                                       &actual_error);
+    gcut_assert_error(actual_error);
+
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_port = 0;
+    inet_pton(AF_INET, "192.0.2.1", &(address.sin_addr));
+    cut_assert_true(
+        milter_manager_connection_checker_is_connected(checker,
+                                                       (struct sockaddr *)&address,
+                                                       sizeof(address)));
+}
+
+void
+test_no_proc_file (void)
+{
+    cut_assert_false(
+        milter_manager_connection_checker_update_from_proc(checker,
+                                                           tcp_path, tcp6_path,
+                                                           &actual_error));
+    cut_assert_equal_int(MILTER_MANAGER_CONNECTION_CHECKER_ERROR_NOT_SUPPORTED,
+                         actual_error->code);
+}
+
+/*
+vi:ts=4:nowrap:ai:expandtab:sw=4
+*/
@@ -25,6 +25,7 @@
 #include <milter/manager/milter-manager-control-command-encoder.h>
 #include <milter/manager/milter-manager-control-reply-encoder.h>
 #include <milter/manager/milter-manager-enum-types.h>
+#include <milter/manager/milter-manager-metrics.h>
 
 #include <milter-test-utils.h>
 #include <milter-manager-test-utils.h>
@@ -36,6 +37,7 @@
 void test_set_configuration (void);
 void test_set_configuration_failed (void);
 void test_reload (void);
+void test_get_status (void);
 
 static MilterEventLoop *loop;
 
@@ -133,6 +135,8 @@ cut_setup (void)
     custom_config_path = g_build_filename(tmp_dir,
                                           CUSTOM_CONFIG_FILE_NAME,
                                           NULL);
+
+    milter_manager_metrics_reset();
 }
 
 void
@@ -169,6 +173,8 @@ cut_teardown (void)
 
     if (custom_config_path)
         g_free(custom_config_path);
+
+    milter_manager_metrics_reset();
 }
 
 static void
@@ -308,6 +314,40 @@ test_reload (void)
                             output->str, output->len);
 }
 
+void
+test_get_status (void)
+{
+    const gchar *packet;
+    gsize packet_size;
+    GString *output;
+    GString *status;
+
+    milter_manager_metrics_record_reply("milter@10026",
+                                        MILTER_SERVER_CONTEXT_STATE_CONNECT,
+                                        MILTER_STATUS_CONTINUE,
+                                        0.1);
+    milter_manager_metrics_session_started();
+
+    milter_manager_control_command_encoder_encode_get_status(command_encoder,
+                                                             &packet,
+                                                             &packet_size);
+    cut_trace(write_packet(packet, packet_size));
+    pump_all_events();
+
+    status = gcut_take_new_string(NULL);
+    milter_manager_metrics_format(status);
+    cut_assert_match("milter_manager_sessions_in_flight\\{worker=\"0\"\\} 1",
+                     status->str);
+
+    milter_manager_control_reply_encoder_encode_status(reply_encoder,
+                                                       &packet, &packet_size,
+                                                       status->str,
+                                                       status->len);
+    output = gcut_string_io_channel_get_string(output_channel);
+    cut_assert_equal_memory(packet, packet_size,
+                            output->str, output->len);
+}
+
 /*
 vi:ts=4:nowrap:ai:expandtab:sw=4
 */
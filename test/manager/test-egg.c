@@ -18,6 +18,8 @@
  */
 
 #include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
 
 #include <milter-test-utils.h>
 #include <milter-manager-test-utils.h>
@@ -51,6 +53,10 @@ void test_command (void);
 void test_command_options (void);
 void test_fallback_status (void);
 void test_evaluation_mode (void);
+void test_parallel_group (void);
+void test_connection_pool (void);
+void test_connection_pool_option_mismatch (void);
+void test_connection_pool_closed (void);
 void test_merge (void);
 void test_applicable_condition (void);
 void test_attach_applicable_conditions (void);
@@ -70,6 +76,14 @@ static GList *expected_applicable_conditions;
 
 static gchar *actual_xml;
 
+static gint pool_fds[2];
+static GIOChannel *pool_channel;
+static GIOChannel *leased_channel;
+static MilterOption *pool_option;
+static MilterOption *pool_reply_option;
+static MilterOption *leased_reply_option;
+static MilterMacrosRequests *leased_macros_requests;
+
 
 static const gchar *milter_log_level;
 
@@ -90,6 +104,15 @@ setup (void)
 
     actual_xml = NULL;
 
+    pool_fds[0] = -1;
+    pool_fds[1] = -1;
+    pool_channel = NULL;
+    leased_channel = NULL;
+    pool_option = NULL;
+    pool_reply_option = NULL;
+    leased_reply_option = NULL;
+    leased_macros_requests = NULL;
+
     milter_log_level = g_getenv("MILTER_LOG_LEVEL");
 }
 
@@ -123,6 +146,23 @@ teardown (void)
     if (actual_xml)
         g_free(actual_xml);
 
+    if (pool_channel)
+        g_io_channel_unref(pool_channel);
+    if (leased_channel)
+        g_io_channel_unref(leased_channel);
+    if (pool_fds[0] != -1)
+        close(pool_fds[0]);
+    if (pool_fds[1] != -1)
+        close(pool_fds[1]);
+    if (pool_option)
+        g_object_unref(pool_option);
+    if (pool_reply_option)
+        g_object_unref(pool_reply_option);
+    if (leased_reply_option)
+        g_object_unref(leased_reply_option);
+    if (leased_macros_requests)
+        g_object_unref(leased_macros_requests);
+
     if (milter_log_level)
         g_setenv("MILTER_LOG_LEVEL", milter_log_level, TRUE);
 }
@@ -392,6 +432,32 @@ test_evaluation_mode (void)
     cut_assert_true(milter_manager_child_is_evaluation_mode(child));
 }
 
+void
+test_parallel_group (void)
+{
+    const gchar spec[] = "inet:9999@127.0.0.1";
+    GError *error = NULL;
+
+    egg = milter_manager_egg_new("child-milter");
+    milter_manager_egg_set_connection_spec(egg, spec, &error);
+    gcut_assert_error(error);
+
+    cut_assert_null(milter_manager_egg_get_parallel_group(egg));
+    child = milter_manager_egg_hatch(egg);
+    cut_assert_not_null(child);
+    cut_assert_null(milter_manager_child_get_parallel_group(child));
+
+    milter_manager_egg_set_parallel_group(egg, "scanners");
+    cut_assert_equal_string("scanners",
+                            milter_manager_egg_get_parallel_group(egg));
+
+    g_object_unref(child);
+    child = milter_manager_egg_hatch(egg);
+    cut_assert_not_null(child);
+    cut_assert_equal_string("scanners",
+                            milter_manager_child_get_parallel_group(child));
+}
+
 void
 test_applicable_condition (void)
 {
@@ -456,6 +522,7 @@ test_merge (void)
     milter_manager_egg_set_command_options(egg, "-s inet:2929@localhost");
     milter_manager_egg_set_connection_spec(egg, "inet:2929@localhost", &error);
     gcut_assert_error(error);
+    milter_manager_egg_set_parallel_group(egg, "scanners");
 
     s25r = milter_manager_applicable_condition_new("S25R");
     remote_network = milter_manager_applicable_condition_new("remote-network");
@@ -497,6 +564,8 @@ test_merge (void)
                             milter_manager_egg_get_command_options(merged_egg));
     cut_assert_equal_string("inet:2929@localhost",
                             milter_manager_egg_get_connection_spec(merged_egg));
+    cut_assert_equal_string("scanners",
+                            milter_manager_egg_get_parallel_group(merged_egg));
 
     gcut_assert_equal_list_object_custom(
         expected_applicable_conditions,
@@ -538,6 +607,103 @@ test_to_xml (void)
                             actual_xml);
 }
 
+static void
+setup_pooled_connection (void)
+{
+    cut_assert_equal_int(0, socketpair(AF_UNIX, SOCK_STREAM, 0, pool_fds));
+    pool_channel = g_io_channel_unix_new(pool_fds[0]);
+    pool_fds[0] = -1;
+    g_io_channel_set_close_on_unref(pool_channel, TRUE);
+
+    pool_option = milter_option_new(6,
+                                    MILTER_ACTION_ADD_HEADERS,
+                                    MILTER_STEP_NO_HELO);
+    pool_reply_option = milter_option_new(6,
+                                          MILTER_ACTION_ADD_HEADERS,
+                                          MILTER_STEP_NO_HELO |
+                                          MILTER_STEP_NO_BODY);
+
+    egg = milter_manager_egg_new("child-milter");
+    milter_manager_egg_set_connection_pool_size(egg, 1);
+}
+
+void
+test_connection_pool (void)
+{
+    setup_pooled_connection();
+
+    cut_assert_true(milter_manager_egg_is_connection_pool_available(egg));
+    cut_assert_true(milter_manager_egg_release_connection(egg,
+                                                          pool_channel,
+                                                          pool_option,
+                                                          pool_reply_option,
+                                                          NULL));
+    cut_assert_equal_uint(1, milter_manager_egg_get_n_pooled_connections(egg));
+    cut_assert_false(milter_manager_egg_is_connection_pool_available(egg));
+    cut_assert_false(milter_manager_egg_release_connection(egg,
+                                                           pool_channel,
+                                                           pool_option,
+                                                           pool_reply_option,
+                                                           NULL));
+
+    cut_assert_true(milter_manager_egg_lease_connection(egg,
+                                                        pool_option,
+                                                        &leased_channel,
+                                                        &leased_reply_option,
+                                                        &leased_macros_requests));
+    cut_assert_equal_pointer(pool_channel, leased_channel);
+    gcut_assert_equal_object_custom(pool_reply_option, leased_reply_option,
+                                    (GEqualFunc)milter_option_equal);
+    cut_assert_null(leased_macros_requests);
+    cut_assert_equal_uint(0, milter_manager_egg_get_n_pooled_connections(egg));
+}
+
+void
+test_connection_pool_option_mismatch (void)
+{
+    MilterOption *other_option;
+
+    setup_pooled_connection();
+
+    cut_assert_true(milter_manager_egg_release_connection(egg,
+                                                          pool_channel,
+                                                          pool_option,
+                                                          pool_reply_option,
+                                                          NULL));
+
+    other_option = milter_option_new(2,
+                                     MILTER_ACTION_ADD_HEADERS,
+                                     MILTER_STEP_NO_HELO);
+    gcut_take_object(G_OBJECT(other_option));
+    cut_assert_false(milter_manager_egg_lease_connection(egg,
+                                                         other_option,
+                                                         &leased_channel,
+                                                         &leased_reply_option,
+                                                         &leased_macros_requests));
+    cut_assert_equal_uint(1, milter_manager_egg_get_n_pooled_connections(egg));
+}
+
+void
+test_connection_pool_closed (void)
+{
+    setup_pooled_connection();
+
+    cut_assert_true(milter_manager_egg_release_connection(egg,
+                                                          pool_channel,
+                                                          pool_option,
+                                                          pool_reply_option,
+                                                          NULL));
+    close(pool_fds[1]);
+    pool_fds[1] = -1;
+
+    cut_assert_false(milter_manager_egg_lease_connection(egg,
+                                                         pool_option,
+                                                         &leased_channel,
+                                                         &leased_reply_option,
+                                                         &leased_macros_requests));
+    cut_assert_equal_uint(0, milter_manager_egg_get_n_pooled_connections(egg));
+}
+
 /*
 vi:ts=4:nowrap:ai:expandtab:sw=4
 */
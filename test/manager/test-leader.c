@@ -38,6 +38,7 @@ void data_large_body (void);
 void test_large_body (gconstpointer data);
 
 void test_configuration (void);
+void test_is_waiting_reply_before_negotiate (void);
 
 static gchar *scenario_dir;
 static MilterManagerTestScenario *main_scenario;
@@ -1579,6 +1580,14 @@ data_scenario_end_of_message_action (void)
 
     cut_add_data("progress", g_strdup("progress.txt"), g_free,
                  NULL);
+
+    cut_add_data("parallel - add-header",
+                 g_strdup("parallel-add-header.txt"), g_free,
+                 "parallel - change-header",
+                 g_strdup("parallel-change-header.txt"), g_free,
+                 "parallel - replace-body",
+                 g_strdup("parallel-replace-body.txt"), g_free,
+                 NULL);
 }
 
 static void
@@ -1895,6 +1904,12 @@ test_configuration (void)
                              milter_manager_leader_get_configuration(leader));
 }
 
+void
+test_is_waiting_reply_before_negotiate (void)
+{
+    cut_assert_false(milter_manager_leader_is_waiting_reply(leader));
+}
+
 /*
 vi:ts=4:nowrap:ai:expandtab:sw=4
 */
@@ -0,0 +1,193 @@
+/* -*- Mode: C; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+/*
+ *  Copyright (C) 2026  Kouhei Sutou <kou@clear-code.com>
+ *
+ *  This library is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with this library.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <string.h>
+
+#include <milter/manager/milter-manager-metrics.h>
+
+#include <milter-manager-test-utils.h>
+
+#include <gcutter.h>
+
+void test_reply (void);
+void test_reply_status (void);
+void test_timeout (void);
+void test_session (void);
+void test_body_spool_size (void);
+
+void
+setup (void)
+{
+    milter_manager_metrics_reset();
+}
+
+void
+teardown (void)
+{
+    milter_manager_metrics_reset();
+}
+
+static const gchar *
+format (void)
+{
+    GString *output;
+
+    output = g_string_new(NULL);
+    milter_manager_metrics_format(output);
+    return cut_take_string(g_string_free(output, FALSE));
+}
+
+#define assert_have_line(line)                          \
+    cut_trace_with_info_expression(                     \
+        assert_have_line_helper(line),                  \
+        assert_have_line(line))
+
+static void
+assert_have_line_helper (const gchar *line)
+{
+    const gchar *escaped_line;
+
+    escaped_line = cut_take_string(g_regex_escape_string(line, -1));
+    cut_assert_match(cut_take_printf("(?m)^%s$", escaped_line), format());
+}
+
+#define BUCKET(le, count)                                       \
+    "milter_manager_child_reply_duration_seconds_bucket"        \
+    "{worker=\"0\",child=\"milter@10026\",stage=\"connect\","   \
+    "le=\"" le "\"} " count "\n"
+
+void
+test_reply (void)
+{
+    milter_manager_metrics_record_reply("milter@10026",
+                                        MILTER_SERVER_CONTEXT_STATE_CONNECT,
+                                        MILTER_STATUS_CONTINUE,
+                                        0.25);
+    cut_assert_equal_string(
+        "# HELP milter_manager_child_reply_duration_seconds "
+        "Round trip time of child milter replies.\n"
+        "# TYPE milter_manager_child_reply_duration_seconds histogram\n"
+        BUCKET("0.001", "0")
+        BUCKET("0.005", "0")
+        BUCKET("0.01", "0")
+        BUCKET("0.05", "0")
+        BUCKET("0.1", "0")
+        BUCKET("0.5", "1")
+        BUCKET("1", "1")
+        BUCKET("5", "1")
+        BUCKET("10", "1")
+        BUCKET("30", "1")
+        BUCKET("+Inf", "1")
+        "milter_manager_child_reply_duration_seconds_sum"
+        "{worker=\"0\",child=\"milter@10026\",stage=\"connect\"} 0.25\n"
+        "milter_manager_child_reply_duration_seconds_count"
+        "{worker=\"0\",child=\"milter@10026\",stage=\"connect\"} 1\n"
+        "# HELP milter_manager_child_replies_total "
+        "Replies from child milters by status.\n"
+        "# TYPE milter_manager_child_replies_total counter\n"
+        "milter_manager_child_replies_total"
+        "{worker=\"0\",child=\"milter@10026\",status=\"continue\"} 1\n"
+        "# HELP milter_manager_child_timeouts_total "
+        "Timeouts of child milters.\n"
+        "# TYPE milter_manager_child_timeouts_total counter\n"
+        "# HELP milter_manager_sessions_in_flight "
+        "Sessions being processed.\n"
+        "# TYPE milter_manager_sessions_in_flight gauge\n"
+        "milter_manager_sessions_in_flight{worker=\"0\"} 0\n"
+        "# HELP milter_manager_sessions_total "
+        "Finished sessions by status.\n"
+        "# TYPE milter_manager_sessions_total counter\n"
+        "# HELP milter_manager_body_spool_bytes "
+        "Bytes of spooled message bodies.\n"
+        "# TYPE milter_manager_body_spool_bytes gauge\n"
+        "milter_manager_body_spool_bytes{worker=\"0\"} 0\n",
+        format());
+}
+#undef BUCKET
+
+void
+test_reply_status (void)
+{
+    milter_manager_metrics_record_reply("milter@10026",
+                                        MILTER_SERVER_CONTEXT_STATE_HELO,
+                                        MILTER_STATUS_REJECT,
+                                        0.0);
+    milter_manager_metrics_record_reply("milter@10026",
+                                        MILTER_SERVER_CONTEXT_STATE_ENVELOPE_FROM,
+                                        MILTER_STATUS_REJECT,
+                                        0.0);
+    milter_manager_metrics_record_reply("milter@10027",
+                                        MILTER_SERVER_CONTEXT_STATE_HELO,
+                                        MILTER_STATUS_ACCEPT,
+                                        0.0);
+
+    assert_have_line("milter_manager_child_replies_total"
+                     "{worker=\"0\",child=\"milter@10026\","
+                     "status=\"reject\"} 2");
+    assert_have_line("milter_manager_child_replies_total"
+                     "{worker=\"0\",child=\"milter@10027\","
+                     "status=\"accept\"} 1");
+    assert_have_line("milter_manager_child_reply_duration_seconds_count"
+                     "{worker=\"0\",child=\"milter@10026\","
+                     "stage=\"envelope-from\"} 1");
+}
+
+void
+test_timeout (void)
+{
+    milter_manager_metrics_record_timeout(
+        "milter@10026", MILTER_MANAGER_METRICS_TIMEOUT_READING);
+    milter_manager_metrics_record_timeout(
+        "milter@10026", MILTER_MANAGER_METRICS_TIMEOUT_READING);
+    milter_manager_metrics_record_timeout(
+        "milter@10026", MILTER_MANAGER_METRICS_TIMEOUT_END_OF_MESSAGE);
+
+    assert_have_line("milter_manager_child_timeouts_total"
+                     "{worker=\"0\",child=\"milter@10026\","
+                     "type=\"reading\"} 2");
+    assert_have_line("milter_manager_child_timeouts_total"
+                     "{worker=\"0\",child=\"milter@10026\","
+                     "type=\"end-of-message\"} 1");
+}
+
+void
+test_session (void)
+{
+    milter_manager_metrics_session_started();
+    milter_manager_metrics_session_started();
+    milter_manager_metrics_session_finished(MILTER_STATUS_ACCEPT);
+
+    assert_have_line("milter_manager_sessions_in_flight{worker=\"0\"} 1");
+    assert_have_line("milter_manager_sessions_total"
+                     "{worker=\"0\",status=\"accept\"} 1");
+}
+
+void
+test_body_spool_size (void)
+{
+    milter_manager_metrics_add_body_spool_size(8192);
+    milter_manager_metrics_add_body_spool_size(1024);
+    milter_manager_metrics_add_body_spool_size(-8192);
+
+    assert_have_line("milter_manager_body_spool_bytes{worker=\"0\"} 1024");
+}
+
+/*
+vi:ts=4:nowrap:ai:expandtab:sw=4
+*/
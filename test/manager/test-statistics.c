@@ -0,0 +1,211 @@
+/* -*- Mode: C; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+/*
+ *  Copyright (C) 2026  Kouhei Sutou <kou@clear-code.com>
+ *
+ *  This library is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with this library.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <string.h>
+
+#include <milter/manager/milter-manager-statistics.h>
+
+#include <milter-manager-test-utils.h>
+
+#include <gcutter.h>
+
+void test_parse_record (void);
+void test_parse_record_invalid (void);
+void test_record_and_read (void);
+void test_worker_path (void);
+void test_rotate (void);
+
+static gchar *tmp_dir;
+static gchar *statistics_path;
+static GString *records;
+static GError *expected_error;
+static GError *actual_error;
+
+void
+setup (void)
+{
+    tmp_dir = g_build_filename(milter_test_get_base_dir(),
+                               "tmp",
+                               NULL);
+    cut_remove_path(tmp_dir, NULL);
+    if (g_mkdir_with_parents(tmp_dir, 0700) == -1)
+        cut_assert_errno();
+
+    statistics_path = g_build_filename(tmp_dir, "statistics.log", NULL);
+    records = g_string_new(NULL);
+    expected_error = NULL;
+    actual_error = NULL;
+}
+
+void
+teardown (void)
+{
+    milter_manager_statistics_close();
+
+    if (tmp_dir) {
+        cut_remove_path(tmp_dir, NULL);
+        g_free(tmp_dir);
+    }
+    if (statistics_path)
+        g_free(statistics_path);
+    if (records)
+        g_string_free(records, TRUE);
+    if (expected_error)
+        g_error_free(expected_error);
+    if (actual_error)
+        g_error_free(actual_error);
+}
+
+static gboolean
+collect_record (const MilterManagerStatisticsRecord *record,
+                gpointer user_data)
+{
+    g_string_append_printf(records,
+                           "%d:%s:%s:%s:%g\n",
+                           record->type,
+                           record->name ? record->name : "-",
+                           record->state ? record->state : "-",
+                           record->status ? record->status : "-",
+                           record->elapsed);
+    return TRUE;
+}
+
+void
+test_parse_record (void)
+{
+    MilterManagerStatisticsRecord record;
+    gchar *line;
+
+    line = cut_take_strdup("{\"type\":\"message\",\"time\":1285046400.5,"
+                           "\"worker\":2,\"state\":\"end-of-message\","
+                           "\"status\":\"accept\",\"elapsed\":0.25,"
+                           "\"from\":\"<kou@example.com>\","
+                           "\"recipients\":3,\"rejected_recipients\":1,"
+                           "\"temporary_failed_recipients\":0,"
+                           "\"body_size\":8192,\"added_headers\":2,"
+                           "\"removed_headers\":1,\"quarantine\":true}");
+    milter_manager_statistics_parse_record(line, &record, &actual_error);
+    gcut_assert_error(actual_error);
+
+    cut_assert_equal_int(MILTER_MANAGER_STATISTICS_RECORD_MESSAGE,
+                         record.type);
+    cut_assert_equal_double(1285046400.5, 0.001, record.time);
+    cut_assert_equal_uint(2, record.worker);
+    cut_assert_equal_string("end-of-message", record.state);
+    cut_assert_equal_string("accept", record.status);
+    cut_assert_equal_double(0.25, 0.001, record.elapsed);
+    cut_assert_equal_string("<kou@example.com>", record.from);
+    cut_assert_equal_uint(3, record.n_recipients);
+    cut_assert_equal_uint(1, record.n_rejected_recipients);
+    cut_assert_equal_uint(0, record.n_temporary_failed_recipients);
+    cut_assert_equal_uint(8192, record.body_size);
+    cut_assert_equal_uint(2, record.n_added_headers);
+    cut_assert_equal_uint(1, record.n_removed_headers);
+    cut_assert_true(record.quarantine);
+}
+
+void
+test_parse_record_invalid (void)
+{
+    MilterManagerStatisticsRecord record;
+
+    expected_error = g_error_new(MILTER_MANAGER_STATISTICS_ERROR,
+                                 MILTER_MANAGER_STATISTICS_ERROR_PARSE,
+                                 "invalid statistics record: "
+                                 "':' is expected: at 8");
+    cut_assert_false(
+        milter_manager_statistics_parse_record(
+            cut_take_strdup("{\"type\" \"session\"}"),
+            &record,
+            &actual_error));
+    gcut_assert_equal_error(expected_error, actual_error);
+}
+
+void
+test_record_and_read (void)
+{
+    milter_manager_statistics_open(statistics_path, 0, 0, &actual_error);
+    gcut_assert_error(actual_error);
+    cut_assert_true(milter_manager_statistics_is_opened());
+
+    milter_manager_statistics_record_milter("milter@10026",
+                                            "envelope-from",
+                                            "reject",
+                                            0.5);
+    milter_manager_statistics_record_session("end-of-message",
+                                             "accept",
+                                             1.5);
+    milter_manager_statistics_close();
+    cut_assert_false(milter_manager_statistics_is_opened());
+
+    milter_manager_statistics_read(statistics_path,
+                                   collect_record, NULL,
+                                   &actual_error);
+    gcut_assert_error(actual_error);
+    cut_assert_equal_string(
+        cut_take_printf("%d:milter@10026:envelope-from:reject:0.5\n"
+                        "%d:-:end-of-message:accept:1.5\n",
+                        MILTER_MANAGER_STATISTICS_RECORD_MILTER,
+                        MILTER_MANAGER_STATISTICS_RECORD_SESSION),
+        records->str);
+}
+
+void
+test_worker_path (void)
+{
+    milter_manager_statistics_open(statistics_path, 0, 2, &actual_error);
+    gcut_assert_error(actual_error);
+    milter_manager_statistics_record_session("connect", "reject", 0.0);
+    milter_manager_statistics_close();
+
+    cut_assert_false(g_file_test(statistics_path, G_FILE_TEST_EXISTS));
+    cut_assert_true(g_file_test(cut_take_printf("%s-2", statistics_path),
+                                G_FILE_TEST_EXISTS));
+}
+
+void
+test_rotate (void)
+{
+    gint i;
+
+    milter_manager_statistics_open(statistics_path, 1, 0, &actual_error);
+    gcut_assert_error(actual_error);
+    for (i = 0; i < 3; i++) {
+        milter_manager_statistics_record_session("connect", "accept", i);
+    }
+    milter_manager_statistics_close();
+
+    cut_assert_true(g_file_test(cut_take_printf("%s.1", statistics_path),
+                                G_FILE_TEST_EXISTS));
+    cut_assert_true(g_file_test(cut_take_printf("%s.2", statistics_path),
+                                G_FILE_TEST_EXISTS));
+
+    milter_manager_statistics_read(statistics_path,
+                                   collect_record, NULL,
+                                   &actual_error);
+    gcut_assert_error(actual_error);
+    cut_assert_equal_string(
+        cut_take_printf("%d:-:connect:accept:2\n",
+                        MILTER_MANAGER_STATISTICS_RECORD_SESSION),
+        records->str);
+}
+
+/*
+vi:ts=4:nowrap:ai:expandtab:sw=4
+*/
@@ -20,6 +20,7 @@
 #include <errno.h>
 
 #include <sys/socket.h>
+#include <sys/time.h>
 #include <netinet/in.h>
 #include <sys/un.h>
 #include <arpa/inet.h>
@@ -49,8 +50,13 @@ void test_state (void);
 void test_last_state (void);
 void test_macro (void);
 void test_macros_hash_table (void);
+void test_macro_layers (void);
+void test_share_macros_hash_table (void);
+void test_clear_message_related_macros (void);
 void data_has_accepted_recipient (void);
 void test_has_accepted_recipient (gconstpointer data);
+void test_detach_connection (void);
+void test_detach_connection_partial_write (void);
 
 static MilterEventLoop *loop;
 
@@ -70,6 +76,9 @@ static gboolean connection_timeout_received;
 
 static MilterMessageResult *message_result;
 
+static gint context_fd;
+static gint peer_fd;
+
 static GError *actual_error;
 static GError *expected_error;
 
@@ -289,6 +298,9 @@ cut_setup (void)
     connection_timeout_received = FALSE;
 
     message_result = NULL;
+
+    context_fd = -1;
+    peer_fd = -1;
 }
 
 void
@@ -308,6 +320,9 @@ cut_teardown (void)
     if (message_result)
         g_object_unref(message_result);
 
+    if (peer_fd != -1)
+        close(peer_fd);
+
     if (context)
         g_object_unref(context);
     if (actual_error)
@@ -798,6 +813,108 @@ test_macros_hash_table (void)
         milter_protocol_agent_get_available_macros(agent));
 }
 
+void
+test_macro_layers (void)
+{
+    MilterProtocolAgent *agent;
+
+    agent = MILTER_PROTOCOL_AGENT(context);
+    milter_protocol_agent_set_macros(agent, MILTER_COMMAND_CONNECT,
+                                     "{daemon_name}", "mail.example.com",
+                                     "v", "Postfix 2.5.5",
+                                     NULL);
+    milter_protocol_agent_set_macro(agent, MILTER_COMMAND_HELO,
+                                    "v", "Sendmail");
+
+    milter_protocol_agent_set_macro_context(agent, MILTER_COMMAND_CONNECT);
+    cut_assert_equal_string("mail.example.com",
+                            milter_protocol_agent_get_macro(agent,
+                                                            "daemon_name"));
+    cut_assert_equal_string("mail.example.com",
+                            milter_protocol_agent_get_macro(agent,
+                                                            "{daemon_name}"));
+    cut_assert_equal_string("Postfix 2.5.5",
+                            milter_protocol_agent_get_macro(agent, "v"));
+
+    milter_protocol_agent_set_macro_context(agent, MILTER_COMMAND_HELO);
+    cut_assert_equal_string("Sendmail",
+                            milter_protocol_agent_get_macro(agent, "v"));
+    gcut_assert_equal_hash_table_string_string(
+        gcut_hash_table_string_string_new("daemon_name", "mail.example.com",
+                                          "v", "Sendmail",
+                                          NULL),
+        milter_protocol_agent_get_available_macros(agent));
+
+    milter_protocol_agent_clear_macros(agent, MILTER_COMMAND_HELO);
+    cut_assert_equal_string("Postfix 2.5.5",
+                            milter_protocol_agent_get_macro(agent, "v"));
+}
+
+void
+test_share_macros_hash_table (void)
+{
+    MilterProtocolAgent *agent;
+    GHashTable *macros;
+
+    agent = MILTER_PROTOCOL_AGENT(context);
+    milter_protocol_agent_set_macro_context(agent, MILTER_COMMAND_CONNECT);
+
+    macros = gcut_take_new_hash_table_string_string("if_name", "localhost",
+                                                    NULL);
+    milter_protocol_agent_share_macros_hash_table(agent,
+                                                  MILTER_COMMAND_CONNECT,
+                                                  macros);
+    cut_assert_equal_pointer(macros, milter_protocol_agent_get_macros(agent));
+
+    milter_protocol_agent_set_macro(agent, MILTER_COMMAND_CONNECT,
+                                    "if_addr", "IPv6:::1");
+    cut_assert_true(macros != milter_protocol_agent_get_macros(agent));
+    gcut_assert_equal_hash_table_string_string(
+        gcut_hash_table_string_string_new("if_name", "localhost",
+                                          NULL),
+        macros);
+    gcut_assert_equal_hash_table_string_string(
+        gcut_hash_table_string_string_new("if_name", "localhost",
+                                          "if_addr", "IPv6:::1",
+                                          NULL),
+        milter_protocol_agent_get_macros(agent));
+}
+
+void
+test_clear_message_related_macros (void)
+{
+    MilterProtocolAgent *agent;
+
+    agent = MILTER_PROTOCOL_AGENT(context);
+    milter_protocol_agent_set_macro(agent, MILTER_COMMAND_CONNECT,
+                                    "if_name", "localhost");
+    milter_protocol_agent_set_macros(agent, MILTER_COMMAND_ENVELOPE_FROM,
+                                     "mail_addr", "sender@example.com",
+                                     "i", "69FDD42DF4A",
+                                     NULL);
+    milter_protocol_agent_set_macro(agent, MILTER_COMMAND_ENVELOPE_FROM,
+                                    "i", "8D6D42C1A3B");
+
+    milter_protocol_agent_set_macro_context(agent,
+                                            MILTER_COMMAND_ENVELOPE_FROM);
+    gcut_assert_equal_hash_table_string_string(
+        gcut_hash_table_string_string_new("if_name", "localhost",
+                                          "mail_addr", "sender@example.com",
+                                          "i", "8D6D42C1A3B",
+                                          NULL),
+        milter_protocol_agent_get_available_macros(agent));
+
+    milter_protocol_agent_clear_message_related_macros(agent);
+    cut_assert_null(milter_protocol_agent_get_macro(agent, "i"));
+    cut_assert_equal_string("localhost",
+                            milter_protocol_agent_get_macro(agent, "if_name"));
+
+    milter_protocol_agent_set_macro(agent, MILTER_COMMAND_ENVELOPE_FROM,
+                                    "i", "A1B2C3D4E5F");
+    cut_assert_equal_string("A1B2C3D4E5F",
+                            milter_protocol_agent_get_macro(agent, "i"));
+}
+
 void
 data_has_accepted_recipient (void)
 {
@@ -874,6 +991,87 @@ test_has_accepted_recipient (gconstpointer data)
     }
 }
 
+static void
+attach_socket_pair (void)
+{
+    gint fds[2];
+    GIOChannel *channel;
+    GError *error = NULL;
+
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds) == -1)
+        cut_error_errno();
+    context_fd = fds[0];
+    peer_fd = fds[1];
+    channel = g_io_channel_unix_new(context_fd);
+    g_io_channel_set_close_on_unref(channel, TRUE);
+    g_io_channel_set_encoding(channel, NULL, NULL);
+    g_io_channel_set_flags(channel, G_IO_FLAG_NONBLOCK, &error);
+    gcut_assert_error(error);
+
+    milter_server_context_attach_connection(context, channel,
+                                            option, option, NULL,
+                                            &error);
+    g_io_channel_unref(channel);
+    gcut_assert_error(error);
+}
+
+void
+test_detach_connection (void)
+{
+    MilterEncoder *command_encoder;
+    GIOChannel *channel;
+    const gchar *packet;
+    gsize packet_size;
+    gchar data[64];
+    gssize read_size;
+
+    cut_trace(attach_socket_pair());
+
+    channel = milter_server_context_detach_connection(context);
+    cut_assert_not_null(channel);
+    g_io_channel_unref(channel);
+    cut_assert_true(milter_server_context_is_quitted(context));
+
+    command_encoder = milter_command_encoder_new();
+    gcut_take_object(G_OBJECT(command_encoder));
+    milter_command_encoder_encode_quit_new_connection(
+        MILTER_COMMAND_ENCODER(command_encoder), &packet, &packet_size);
+    read_size = read(peer_fd, data, sizeof(data));
+    cut_assert_equal_memory(packet, packet_size, data, read_size);
+}
+
+void
+test_detach_connection_partial_write (void)
+{
+    gchar data[4096];
+    gssize size;
+    struct timeval timeout;
+
+    cut_trace(attach_socket_pair());
+
+    memset(data, 'x', sizeof(data));
+    do {
+        size = write(context_fd, data, sizeof(data));
+    } while (size > 0);
+    if (errno != EAGAIN && errno != EWOULDBLOCK)
+        cut_error_errno();
+
+    cut_assert_null(milter_server_context_detach_connection(context));
+    cut_assert_true(milter_server_context_is_quitted(context));
+
+    timeout.tv_sec = 1;
+    timeout.tv_usec = 0;
+    if (setsockopt(peer_fd, SOL_SOCKET, SO_RCVTIMEO,
+                   &timeout, sizeof(timeout)) == -1)
+        cut_error_errno();
+    do {
+        size = read(peer_fd, data, sizeof(data));
+    } while (size > 0);
+    if (size == -1)
+        cut_error_errno();
+    cut_assert_equal_int(0, size);
+}
+
 /*
 vi:ts=4:nowrap:ai:expandtab:sw=4
 */
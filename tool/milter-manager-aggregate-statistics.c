@@ -0,0 +1,233 @@
+/* -*- Mode: C; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+/*
+ *  Copyright (C) 2026  Kouhei Sutou <kou@clear-code.com>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifdef HAVE_CONFIG_H
+#  include "../config.h"
+#endif /* HAVE_CONFIG_H */
+
+#include <stdlib.h>
+#include <string.h>
+#include <glib/gi18n.h>
+
+#ifdef HAVE_LOCALE_H
+#  include <locale.h>
+#endif
+
+#include <milter/core.h>
+#include <milter/manager/milter-manager-statistics.h>
+
+#define DEFAULT_STEP 60
+
+static gint step = DEFAULT_STEP;
+static gdouble since = 0.0;
+static gdouble until = 0.0;
+
+typedef struct _Counter
+{
+    guint n_records;
+    gdouble elapsed;
+} Counter;
+
+typedef struct _Aggregator
+{
+    GHashTable *counters;
+    GString *key;
+} Aggregator;
+
+static const gchar *
+record_type_name (MilterManagerStatisticsRecordType type)
+{
+    switch (type) {
+    case MILTER_MANAGER_STATISTICS_RECORD_SESSION:
+        return "session";
+    case MILTER_MANAGER_STATISTICS_RECORD_MILTER:
+        return "milter";
+    case MILTER_MANAGER_STATISTICS_RECORD_MESSAGE:
+        return "message";
+    default:
+        return "unknown";
+    }
+}
+
+static gboolean
+aggregate (const MilterManagerStatisticsRecord *record, gpointer user_data)
+{
+    Aggregator *aggregator = user_data;
+    Counter *counter;
+    gint64 bucket;
+
+    if (since > 0.0 && record->time < since)
+        return TRUE;
+    if (until > 0.0 && record->time >= until)
+        return TRUE;
+
+    bucket = (gint64)record->time;
+    bucket -= bucket % step;
+
+    g_string_printf(aggregator->key,
+                    "%012" G_GINT64_FORMAT "\t%s\t%s\t%s",
+                    bucket,
+                    record_type_name(record->type),
+                    record->name ? record->name : "-",
+                    record->status ? record->status : "-");
+    counter = g_hash_table_lookup(aggregator->counters, aggregator->key->str);
+    if (!counter) {
+        counter = g_new0(Counter, 1);
+        g_hash_table_insert(aggregator->counters,
+                            g_strdup(aggregator->key->str),
+                            counter);
+    }
+    counter->n_records++;
+    counter->elapsed += record->elapsed;
+
+    return TRUE;
+}
+
+static void
+print_counters (Aggregator *aggregator)
+{
+    GList *keys, *node;
+
+    keys = g_hash_table_get_keys(aggregator->counters);
+    keys = g_list_sort(keys, (GCompareFunc)strcmp);
+
+    g_print("# time\ttype\tname\tstatus\tcount\taverage-elapsed\n");
+    for (node = keys; node; node = g_list_next(node)) {
+        const gchar *key = node->data;
+        Counter *counter;
+        gchar *end;
+        GTimeVal time_value;
+        gchar *time_string;
+
+        counter = g_hash_table_lookup(aggregator->counters, key);
+        time_value.tv_sec = g_ascii_strtoll(key, &end, 10);
+        time_value.tv_usec = 0;
+        time_string = g_time_val_to_iso8601(&time_value);
+        g_print("%s%s\t%u\t%g\n",
+                time_string, end,
+                counter->n_records,
+                counter->elapsed / counter->n_records);
+        g_free(time_string);
+    }
+    g_list_free(keys);
+}
+
+static gboolean
+parse_time_arg (const gchar *option_name,
+                const gchar *value,
+                gpointer data,
+                GError **error)
+{
+    GTimeVal time_value;
+    gdouble *time;
+
+    if (strcmp(option_name, "--since") == 0)
+        time = &since;
+    else
+        time = &until;
+
+    if (!g_time_val_from_iso8601(value, &time_value)) {
+        g_set_error(error,
+                    G_OPTION_ERROR,
+                    G_OPTION_ERROR_BAD_VALUE,
+                    _("Invalid ISO 8601 time: %s"), value);
+        return FALSE;
+    }
+    *time = time_value.tv_sec + time_value.tv_usec / 1000000.0;
+    return TRUE;
+}
+
+static const GOptionEntry option_entries[] =
+{
+    {"step", 0, 0, G_OPTION_ARG_INT, &step,
+     N_("Aggregate records per SECONDS seconds. "
+        "(" G_STRINGIFY(DEFAULT_STEP) ")"),
+     "SECONDS"},
+    {"since", 0, 0, G_OPTION_ARG_CALLBACK, parse_time_arg,
+     N_("Ignore records before TIME. (ISO 8601)"), "TIME"},
+    {"until", 0, 0, G_OPTION_ARG_CALLBACK, parse_time_arg,
+     N_("Ignore records at and after TIME. (ISO 8601)"), "TIME"},
+    {NULL}
+};
+
+int
+main (int argc, char *argv[])
+{
+    gboolean success = TRUE;
+    GError *error = NULL;
+    GOptionContext *option_context;
+    Aggregator aggregator;
+    gint i;
+
+#ifdef HAVE_LOCALE_H
+    setlocale(LC_ALL, "");
+#endif
+
+    milter_init();
+
+    option_context = g_option_context_new(_("[STATISTICS_FILE...]"));
+    g_option_context_add_main_entries(option_context, option_entries, NULL);
+    if (!g_option_context_parse(option_context, &argc, &argv, &error)) {
+        g_print("%s\n", error->message);
+        g_error_free(error);
+        g_option_context_free(option_context);
+        milter_quit();
+        exit(EXIT_FAILURE);
+    }
+    g_option_context_free(option_context);
+
+    if (step <= 0) {
+        g_print(_("--step must be positive: %d\n"), step);
+        milter_quit();
+        exit(EXIT_FAILURE);
+    }
+
+    aggregator.counters = g_hash_table_new_full(g_str_hash, g_str_equal,
+                                                g_free, g_free);
+    aggregator.key = g_string_new(NULL);
+
+    if (argc == 1) {
+        success = milter_manager_statistics_read("-", aggregate, &aggregator,
+                                                 &error);
+    } else {
+        for (i = 1; success && i < argc; i++) {
+            success = milter_manager_statistics_read(argv[i],
+                                                     aggregate, &aggregator,
+                                                     &error);
+        }
+    }
+
+    if (success) {
+        print_counters(&aggregator);
+    } else {
+        g_printerr("%s\n", error->message);
+        g_error_free(error);
+    }
+
+    g_string_free(aggregator.key, TRUE);
+    g_hash_table_unref(aggregator.counters);
+
+    milter_quit();
+
+    return success ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+/*
+vi:ts=4:nowrap:ai:expandtab:sw=4
+*/
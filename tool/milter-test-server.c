@@ -44,6 +44,9 @@
 
 #define DEFAULT_NEGOTIATE_VERSION 6
 #define MILTER_TEST_SERVER_ALL_TIMEOUTS_UNSPECIFIED -1.0
+#define DEFAULT_BENCHMARK_SESSIONS 1000
+#define DEFAULT_BENCHMARK_CONCURRENCY 10
+#define BENCHMARK_RETRY_INTERVAL 0.1
 
 static gboolean verbose = FALSE;
 static gboolean output_message = FALSE;
@@ -75,6 +78,13 @@ static gdouble writing_timeout = MILTER_SERVER_CONTEXT_DEFAULT_WRITING_TIMEOUT;
 static gdouble reading_timeout = MILTER_SERVER_CONTEXT_DEFAULT_READING_TIMEOUT;
 static gdouble end_of_message_timeout = MILTER_SERVER_CONTEXT_DEFAULT_END_OF_MESSAGE_TIMEOUT;
 static gdouble all_timeouts = MILTER_TEST_SERVER_ALL_TIMEOUTS_UNSPECIFIED;
+static gboolean benchmark = FALSE;
+static GPtrArray *benchmark_mails = NULL;
+static gint benchmark_n_sessions = 0;
+static gdouble benchmark_duration = 0.0;
+static gint benchmark_concurrency = DEFAULT_BENCHMARK_CONCURRENCY;
+static gdouble benchmark_rate = 0.0;
+static gint benchmark_n_event_loops = 1;
 
 #define MILTER_TEST_SERVER_ERROR                                \
     (g_quark_from_static_string("milter-test-server-error-quark"))
@@ -86,6 +96,14 @@ typedef enum
     MILTER_TEST_SERVER_ERROR_TIMEOUT
 } MilterTestServerError;
 
+typedef struct _Mail
+{
+    gchar *envelope_from;
+    gchar **recipients;
+    MilterHeaders *headers;
+    gchar **body_chunks;
+} Mail;
+
 typedef struct _Message
 {
     gchar *envelope_from;
@@ -98,6 +116,54 @@ typedef struct _Message
     GString *replaced_body_string;
 } Message;
 
+/* Latencies are kept in microseconds: exact up to 64us, then 32
+ * sub-buckets per power of two, so percentiles are within ~3%. */
+#define LATENCY_EXACT_BUCKET_BITS 6
+#define LATENCY_SUB_BUCKET_BITS 5
+#define LATENCY_N_EXACT_BUCKETS (1 << LATENCY_EXACT_BUCKET_BITS)
+#define LATENCY_N_SUB_BUCKETS (1 << LATENCY_SUB_BUCKET_BITS)
+#define LATENCY_N_BUCKETS                                               \
+    (LATENCY_N_EXACT_BUCKETS +                                          \
+     (32 - LATENCY_EXACT_BUCKET_BITS) * LATENCY_N_SUB_BUCKETS)
+
+typedef struct _Latency
+{
+    guint64 count;
+    guint64 max;
+    gdouble total;
+    guint64 buckets[LATENCY_N_BUCKETS];
+} Latency;
+
+#define N_BENCHMARK_STAGES (MILTER_SERVER_CONTEXT_STATE_END_OF_MESSAGE + 1)
+
+typedef struct _BenchmarkResult
+{
+    Latency stages[N_BENCHMARK_STAGES];
+    Latency session;
+    guint n_sessions;
+    guint n_errors;
+    guint n_timeouts;
+    guint n_dropped;
+    GHashTable *statuses;
+} BenchmarkResult;
+
+typedef struct _BenchmarkRunner
+{
+    guint id;
+    MilterEventLoop *loop;
+    GTimer *timer;
+    GPtrArray *mails;
+    guint max_sessions;
+    guint concurrency;
+    gdouble rate;
+    guint tick_id;
+    guint retry_id;
+    guint n_started;
+    guint n_running;
+    guint n_alive;
+    BenchmarkResult result;
+} BenchmarkRunner;
+
 typedef struct _ProcessData
 {
     MilterEventLoop *loop;
@@ -114,8 +180,22 @@ typedef struct _ProcessData
     gint current_body_chunk;
     Message *message;
     GError *error;
+    Mail *mail;
+    BenchmarkRunner *runner;
+    gboolean ready;
+    MilterServerContextState sent_state;
+    gdouble sent_time;
 } ProcessData;
 
+/* data must be the first member: callbacks only receive ProcessData. */
+typedef struct _BenchmarkSession
+{
+    ProcessData data;
+    MilterServerContext *context;
+    gdouble started_time;
+    gboolean finished;
+} BenchmarkSession;
+
 #define RED_COLOR "\033[01;31m"
 #define RED_BACK_COLOR "\033[41m"
 #define GREEN_COLOR "\033[01;32m"
@@ -129,6 +209,120 @@ typedef struct _ProcessData
 #define NORMAL_COLOR "\033[00m"
 #define NO_COLOR ""
 
+static void benchmark_session_finished (MilterServerContext *context,
+                                        ProcessData *data);
+
+static guint
+latency_bucket_index (guint64 value)
+{
+    guint msb;
+
+    if (value < LATENCY_N_EXACT_BUCKETS)
+        return value;
+    if (value > G_MAXUINT32)
+        value = G_MAXUINT32;
+
+    msb = g_bit_storage((gulong)value) - 1;
+    return LATENCY_N_EXACT_BUCKETS +
+        (msb - LATENCY_EXACT_BUCKET_BITS) * LATENCY_N_SUB_BUCKETS +
+        ((value >> (msb - LATENCY_SUB_BUCKET_BITS)) - LATENCY_N_SUB_BUCKETS);
+}
+
+static guint64
+latency_bucket_value (guint index)
+{
+    guint range, sub_bucket;
+
+    if (index < LATENCY_N_EXACT_BUCKETS)
+        return index;
+
+    range = (index - LATENCY_N_EXACT_BUCKETS) / LATENCY_N_SUB_BUCKETS;
+    sub_bucket = (index - LATENCY_N_EXACT_BUCKETS) % LATENCY_N_SUB_BUCKETS;
+    return ((guint64)(LATENCY_N_SUB_BUCKETS + sub_bucket + 1) <<
+            (range + LATENCY_EXACT_BUCKET_BITS - LATENCY_SUB_BUCKET_BITS)) - 1;
+}
+
+static void
+latency_add (Latency *latency, gdouble elapsed)
+{
+    guint64 value;
+
+    value = elapsed > 0.0 ? (guint64)(elapsed * 1000000.0 + 0.5) : 0;
+    latency->count++;
+    latency->total += elapsed;
+    if (value > latency->max)
+        latency->max = value;
+    latency->buckets[latency_bucket_index(value)]++;
+}
+
+static void
+latency_merge (Latency *latency, const Latency *other)
+{
+    guint i;
+
+    latency->count += other->count;
+    latency->total += other->total;
+    if (other->max > latency->max)
+        latency->max = other->max;
+    for (i = 0; i < LATENCY_N_BUCKETS; i++) {
+        latency->buckets[i] += other->buckets[i];
+    }
+}
+
+static gdouble
+latency_percentile (const Latency *latency, gdouble percentile)
+{
+    guint i;
+    guint64 target, n_values = 0;
+
+    if (latency->count == 0)
+        return 0.0;
+
+    target = (guint64)(latency->count * percentile / 100.0);
+    if (target < latency->count * percentile / 100.0)
+        target++;
+    if (target == 0)
+        target = 1;
+
+    for (i = 0; i < LATENCY_N_BUCKETS; i++) {
+        n_values += latency->buckets[i];
+        if (n_values >= target)
+            return MIN(latency_bucket_value(i), latency->max) / 1000000.0;
+    }
+
+    return latency->max / 1000000.0;
+}
+
+static void
+record_sent (ProcessData *data, MilterServerContextState state)
+{
+    if (!data->runner)
+        return;
+
+    if (MILTER_SERVER_CONTEXT_STATE_NEGOTIATE <= state &&
+        state <= MILTER_SERVER_CONTEXT_STATE_END_OF_MESSAGE) {
+        data->sent_state = state;
+        data->sent_time = g_timer_elapsed(data->runner->timer, NULL);
+    } else {
+        data->sent_state = MILTER_SERVER_CONTEXT_STATE_INVALID;
+    }
+}
+
+static void
+record_reply (ProcessData *data)
+{
+    BenchmarkRunner *runner = data->runner;
+
+    if (!runner)
+        return;
+    if (data->sent_state == MILTER_SERVER_CONTEXT_STATE_INVALID)
+        return;
+
+    latency_add(&(runner->result.stages[data->sent_state]),
+                g_timer_elapsed(runner->timer, NULL) - data->sent_time);
+    data->sent_state = MILTER_SERVER_CONTEXT_STATE_INVALID;
+}
+
 static void
 remove_recipient (GList **recipients, const gchar *recipient)
 {
@@ -302,7 +496,7 @@ send_envelope_from (MilterServerContext *context, ProcessData *data)
     if (milter_option_get_step(data->option) & MILTER_STEP_NO_ENVELOPE_FROM)
         return FALSE;
 
-    milter_server_context_envelope_from(context, envelope_from);
+    milter_server_context_envelope_from(context, data->mail->envelope_from);
     return TRUE;
 }
 
@@ -311,7 +505,7 @@ send_envelope_recipient (MilterServerContext *context, ProcessData *data)
 {
     gchar *recipient;
 
-    recipient = recipients[data->current_recipient];
+    recipient = data->mail->recipients[data->current_recipient];
     if (!recipient)
         return FALSE;
 
@@ -413,6 +607,7 @@ cb_continue (MilterServerContext *context, gpointer user_data)
 {
     ProcessData *data = user_data;
 
+    record_reply(data);
     switch (milter_server_context_get_state(context)) {
     case MILTER_SERVER_CONTEXT_STATE_NEGOTIATE:
         if (send_connect(context, data))
@@ -466,6 +661,7 @@ cb_negotiate_reply (MilterServerContext *context, MilterOption *option,
 {
     ProcessData *data = user_data;
 
+    record_reply(data);
     if (data->option) {
         milter_error("duplicated negotiate");
         send_abort(context, data);
@@ -484,12 +680,13 @@ cb_temporary_failure (MilterServerContext *context, gpointer user_data)
     ProcessData *data = user_data;
     MilterServerContextState state;
 
+    record_reply(data);
     state = milter_server_context_get_state(context);
 
     switch (state) {
     case MILTER_SERVER_CONTEXT_STATE_ENVELOPE_RECIPIENT:
         remove_recipient(&(data->message->recipients),
-                         *(recipients + data->current_recipient - 1));
+                         data->mail->recipients[data->current_recipient - 1]);
         if (data->message->recipients) {
             cb_continue(context, user_data);
             break;
@@ -507,12 +704,13 @@ cb_reject (MilterServerContext *context, gpointer user_data)
     ProcessData *data = user_data;
     MilterServerContextState state;
 
+    record_reply(data);
     state = milter_server_context_get_state(context);
 
     switch (state) {
     case MILTER_SERVER_CONTEXT_STATE_ENVELOPE_RECIPIENT:
         remove_recipient(&(data->message->recipients),
-                         *(recipients + data->current_recipient - 1));
+                         data->mail->recipients[data->current_recipient - 1]);
         if (data->message->recipients) {
             cb_continue(context, user_data);
             break;
@@ -533,6 +731,7 @@ cb_reply_code (MilterServerContext *context,
 {
     ProcessData *data = user_data;
 
+    record_reply(data);
     data->reply_code = code;
     if (data->reply_extended_code)
         g_free(data->reply_extended_code);
@@ -552,6 +751,7 @@ cb_accept (MilterServerContext *context, gpointer user_data)
 {
     ProcessData *data = user_data;
 
+    record_reply(data);
     send_abort(context, data);
     data->success = TRUE;
 }
@@ -561,6 +761,7 @@ cb_discard (MilterServerContext *context, gpointer user_data)
 {
     ProcessData *data = user_data;
 
+    record_reply(data);
     send_abort(context, data);
     data->success = FALSE;
 }
@@ -696,6 +897,8 @@ static void
 cb_skip (MilterServerContext *context, gpointer user_data)
 {
     ProcessData *data = user_data;
+
+    record_reply(data);
     while (data->body_chunks[data->current_body_chunk])
         data->current_body_chunk++;
 
@@ -718,6 +921,10 @@ cb_finished (MilterFinishedEmittable *emittable, gpointer user_data)
     ProcessData *data = user_data;
 
     g_timer_stop(data->timer);
+    if (data->runner) {
+        benchmark_session_finished(MILTER_SERVER_CONTEXT(emittable), data);
+        return;
+    }
     milter_event_loop_quit(data->loop);
 }
 
@@ -778,6 +985,7 @@ cb_state_transited (MilterServerContext *context,
     if (data->option)
         step = milter_option_get_step(data->option);
 
+    record_sent(data, state);
     switch (state) {
     case MILTER_SERVER_CONTEXT_STATE_CONNECT:
         if (!(step & MILTER_STEP_NO_REPLY_CONNECT))
@@ -920,6 +1128,7 @@ static void
 cb_ready (MilterServerContext *context, gpointer user_data)
 {
     ProcessData *data = user_data;
+    data->ready = TRUE;
     setup(context, data);
     g_timer_start(data->timer);
     negotiate(context);
@@ -930,11 +1139,36 @@ cb_connection_error (MilterErrorEmittable *emittable, GError *error, gpointer us
 {
     ProcessData *data = user_data;
 
+    if (data->runner) {
+        if (data->ready)
+            return;
+        data->success = FALSE;
+        data->error = g_error_copy(error);
+        benchmark_session_finished(MILTER_SERVER_CONTEXT(emittable), data);
+        return;
+    }
+
     data->success = FALSE;
     data->error = g_error_copy(error);
     milter_event_loop_quit(data->loop);
 }
 
+static void
+cb_benchmark_connection_timeout (MilterServerContext *context,
+                                 gpointer user_data)
+{
+    ProcessData *data = user_data;
+
+    if (data->ready)
+        return;
+
+    data->success = FALSE;
+    data->error = g_error_new(MILTER_TEST_SERVER_ERROR,
+                              MILTER_TEST_SERVER_ERROR_TIMEOUT,
+                              "connection timeout");
+    benchmark_session_finished(context, data);
+}
+
 static gboolean
 set_name (const gchar *option_name,
           const gchar *value,
@@ -1179,7 +1413,7 @@ extract_path_from_mail_address (const gchar *mail_address, GError **error)
 }
 
 static gboolean
-parse_header (const gchar *name, const gchar *value,
+parse_header (Mail *mail, const gchar *name, const gchar *value,
               GList **recipient_list, GError **error)
 {
     if (strcmp(name, "From") == 0) {
@@ -1188,8 +1422,9 @@ parse_header (const gchar *name, const gchar *value,
         reverse_path = extract_path_from_mail_address(value, error);
         if (!reverse_path)
             return FALSE;
-        set_envelope_from(reverse_path);
-        g_free(reverse_path);
+        if (mail->envelope_from)
+            g_free(mail->envelope_from);
+        mail->envelope_from = reverse_path;
     } else if (strcmp(name, "To") == 0) {
         gchar *forward_path;
 
@@ -1292,6 +1527,7 @@ parse_mail_contents_header_part_collect_headers (gchar ***lines_,
 
 static gboolean
 parse_mail_contents_header_part_parse_headers (MilterHeaders *headers,
+                                               Mail *mail,
                                                GError **error)
 {
     const GList *header_list;
@@ -1300,7 +1536,7 @@ parse_mail_contents_header_part_parse_headers (MilterHeaders *headers,
     header_list = milter_headers_get_list(headers);
     for (; header_list; header_list = g_list_next(header_list)) {
         MilterHeader *header = header_list->data;
-        if (!parse_header(header->name, header->value,
+        if (!parse_header(mail, header->name, header->value,
                           &recipient_list, error)) {
             return FALSE;
         }
@@ -1311,11 +1547,11 @@ parse_mail_contents_header_part_parse_headers (MilterHeaders *headers,
         GList *node;
 
         length = g_list_length(recipient_list);
-        recipients = g_new0(gchar *, length + 1);
+        mail->recipients = g_new0(gchar *, length + 1);
         for (i = 0, node = recipient_list; node; i++, node = g_list_next(node)) {
-            recipients[i] = node->data;
+            mail->recipients[i] = node->data;
         }
-        recipients[length] = NULL;
+        mail->recipients[length] = NULL;
         g_list_free(recipient_list);
     }
 
@@ -1323,7 +1559,7 @@ parse_mail_contents_header_part_parse_headers (MilterHeaders *headers,
 }
 
 static gboolean
-parse_mail_contents_header_part (gchar ***lines_, GError **error)
+parse_mail_contents_header_part (gchar ***lines_, Mail *mail, GError **error)
 {
     MilterHeaders *headers;
     const GList *header_list;
@@ -1336,7 +1572,7 @@ parse_mail_contents_header_part (gchar ***lines_, GError **error)
         return FALSE;
     }
 
-    if (!parse_mail_contents_header_part_parse_headers(headers, error)) {
+    if (!parse_mail_contents_header_part_parse_headers(headers, mail, error)) {
         g_object_unref(headers);
         return FALSE;
     }
@@ -1344,7 +1580,7 @@ parse_mail_contents_header_part (gchar ***lines_, GError **error)
     header_list = milter_headers_get_list(headers);
     for (; header_list; header_list = g_list_next(header_list)) {
         MilterHeader *header = header_list->data;
-        milter_headers_append_header(option_headers,
+        milter_headers_append_header(mail->headers,
                                      header->name, header->value);
     }
 
@@ -1354,7 +1590,7 @@ parse_mail_contents_header_part (gchar ***lines_, GError **error)
 }
 
 static gboolean
-parse_mail_contents_body_part (gchar ***lines_, GError **error)
+parse_mail_contents_body_part (gchar ***lines_, Mail *mail, GError **error)
 {
     gchar **lines = *lines_;
     GString *body_string;
@@ -1391,13 +1627,15 @@ parse_mail_contents_body_part (gchar ***lines_, GError **error)
     }
     g_string_free(body_string, TRUE);
     g_ptr_array_add(chunks, NULL);
-    body_chunks = (gchar **)g_ptr_array_free(chunks, FALSE);
+    if (mail->body_chunks)
+        g_strfreev(mail->body_chunks);
+    mail->body_chunks = (gchar **)g_ptr_array_free(chunks, FALSE);
 
     return TRUE;
 }
 
 static gboolean
-parse_mail_contents (const gchar *contents, GError **error)
+parse_mail_contents (const gchar *contents, Mail *mail, GError **error)
 {
     gchar **lines, **first_lines;
 
@@ -1408,12 +1646,12 @@ parse_mail_contents (const gchar *contents, GError **error)
     if (g_str_has_prefix(*lines, "From "))
         lines++;
 
-    if (!parse_mail_contents_header_part(&lines, error)) {
+    if (!parse_mail_contents_header_part(&lines, mail, error)) {
         g_strfreev(first_lines);
         return FALSE;
     }
 
-    if (!parse_mail_contents_body_part(&lines, error)) {
+    if (!parse_mail_contents_body_part(&lines, mail, error)) {
         g_strfreev(first_lines);
         return FALSE;
     }
@@ -1433,6 +1671,7 @@ parse_mail_file_arg (const gchar *option_name,
     gsize length;
     GError *internal_error = NULL;
     GIOChannel *io_channel;
+    Mail mail;
 
     if (g_str_equal(value, "-")) {
         io_channel = g_io_channel_unix_new(STDIN_FILENO);
@@ -1469,7 +1708,11 @@ parse_mail_file_arg (const gchar *option_name,
     }
     g_io_channel_unref(io_channel);
 
-    if (!parse_mail_contents(contents, &internal_error)) {
+    mail.envelope_from = NULL;
+    mail.recipients = NULL;
+    mail.headers = option_headers;
+    mail.body_chunks = NULL;
+    if (!parse_mail_contents(contents, &mail, &internal_error)) {
         g_set_error(error,
                     G_OPTION_ERROR,
                     G_OPTION_ERROR_FAILED,
@@ -1478,10 +1721,184 @@ parse_mail_file_arg (const gchar *option_name,
         return FALSE;
     }
 
+    if (mail.envelope_from) {
+        set_envelope_from(mail.envelope_from);
+        g_free(mail.envelope_from);
+    }
+    if (mail.recipients)
+        recipients = mail.recipients;
+    body_chunks = mail.body_chunks;
+
     g_free(contents);
     return TRUE;
 }
 
+static Mail *
+mail_new (void)
+{
+    Mail *mail;
+
+    mail = g_new0(Mail, 1);
+    mail->headers = milter_headers_new();
+
+    return mail;
+}
+
+static void
+mail_free (Mail *mail)
+{
+    if (mail->envelope_from)
+        g_free(mail->envelope_from);
+    if (mail->recipients)
+        g_strfreev(mail->recipients);
+    if (mail->headers)
+        g_object_unref(mail->headers);
+    if (mail->body_chunks)
+        g_strfreev(mail->body_chunks);
+
+    g_free(mail);
+}
+
+static Mail *
+mail_copy (const gchar *envelope_from, gchar **recipients,
+           MilterHeaders *headers, gchar **body_chunks)
+{
+    Mail *mail;
+    const GList *node;
+
+    mail = mail_new();
+    mail->envelope_from = g_strdup(envelope_from);
+    mail->recipients = g_strdupv(recipients);
+    mail->body_chunks = g_strdupv(body_chunks);
+
+    /* Header entries are shared by milter_headers_copy() without
+     * locking, so each event loop thread needs its own entries. */
+    for (node = milter_headers_get_list(headers);
+         node;
+         node = g_list_next(node)) {
+        MilterHeader *header = node->data;
+        milter_headers_append_header(mail->headers,
+                                     header->name, header->value);
+    }
+
+    return mail;
+}
+
+static gboolean
+parse_benchmark_mails (const gchar *path, gchar *contents, GError **error)
+{
+    gchar *message;
+
+    message = contents;
+    while (message && message[0]) {
+        gchar *next_message;
+        Mail *mail;
+        GError *internal_error = NULL;
+
+        next_message = strstr(message, "\nFrom ");
+        if (next_message) {
+            next_message[0] = '\0';
+            next_message++;
+        }
+
+        mail = mail_new();
+        if (!parse_mail_contents(message, mail, &internal_error)) {
+            g_set_error(error,
+                        G_OPTION_ERROR,
+                        G_OPTION_ERROR_FAILED,
+                        "%s: %s", path, internal_error->message);
+            g_error_free(internal_error);
+            mail_free(mail);
+            return FALSE;
+        }
+        g_ptr_array_add(benchmark_mails, mail);
+
+        message = next_message;
+    }
+
+    return TRUE;
+}
+
+static gboolean
+load_benchmark_mail_file (const gchar *path, GError **error)
+{
+    gchar *contents = NULL;
+    GError *internal_error = NULL;
+    gboolean success;
+
+    if (!g_file_get_contents(path, &contents, NULL, &internal_error)) {
+        g_set_error(error,
+                    G_OPTION_ERROR,
+                    G_OPTION_ERROR_FAILED,
+                    _("Loading from %s failed.: %s"),
+                    path, internal_error->message);
+        g_error_free(internal_error);
+        return FALSE;
+    }
+
+    success = parse_benchmark_mails(path, contents, error);
+    g_free(contents);
+
+    return success;
+}
+
+static gboolean
+parse_benchmark_corpus_arg (const gchar *option_name,
+                            const gchar *value,
+                            gpointer data,
+                            GError **error)
+{
+    GDir *dir;
+    GList *paths = NULL, *node;
+    const gchar *name;
+    GError *internal_error = NULL;
+    gboolean success = TRUE;
+
+    if (!benchmark_mails)
+        benchmark_mails = g_ptr_array_new();
+
+    if (!g_file_test(value, G_FILE_TEST_IS_DIR)) {
+        if (!g_file_test(value, G_FILE_TEST_EXISTS)) {
+            g_set_error(error,
+                        G_OPTION_ERROR,
+                        G_OPTION_ERROR_BAD_VALUE,
+                        _("%s does not exist."), value);
+            return FALSE;
+        }
+        return load_benchmark_mail_file(value, error);
+    }
+
+    dir = g_dir_open(value, 0, &internal_error);
+    if (!dir) {
+        g_set_error(error,
+                    G_OPTION_ERROR,
+                    G_OPTION_ERROR_FAILED,
+                    _("Loading from %s failed.: %s"),
+                    value, internal_error->message);
+        g_error_free(internal_error);
+        return FALSE;
+    }
+    while ((name = g_dir_read_name(dir))) {
+        gchar *path;
+
+        path = g_build_filename(value, name, NULL);
+        if (g_file_test(path, G_FILE_TEST_IS_REGULAR))
+            paths = g_list_prepend(paths, path);
+        else
+            g_free(path);
+    }
+    g_dir_close(dir);
+
+    paths = g_list_sort(paths, (GCompareFunc)strcmp);
+    for (node = paths; success && node; node = g_list_next(node)) {
+        success = load_benchmark_mail_file(node->data, error);
+    }
+    g_list_foreach(paths, (GFunc)g_free, NULL);
+    g_list_free(paths);
+
+    return success;
+}
+
 static gboolean
 parse_color_arg (const gchar *option_name, const gchar *value,
                  gpointer data, GError **error)
@@ -1611,6 +2028,32 @@ static const GOptionEntry option_entries[] =
      "SECONDS"},
     {"threads", 't', 0, G_OPTION_ARG_INT, &n_threads,
      N_("Create N threads."), "N"},
+    {"benchmark", 0, 0, G_OPTION_ARG_NONE, &benchmark,
+     N_("Run many sessions and report latency and throughput."), NULL},
+    {"benchmark-corpus", 0, 0, G_OPTION_ARG_CALLBACK,
+     parse_benchmark_corpus_arg,
+     N_("Replay mails in PATH on benchmark. "
+        "PATH is a directory that has a mail per file or an mbox file. "
+        "To use N corpora, use --benchmark-corpus option N times."),
+     "PATH"},
+    {"benchmark-sessions", 0, 0, G_OPTION_ARG_INT, &benchmark_n_sessions,
+     N_("Run N sessions on benchmark. "
+        "(" G_STRINGIFY(DEFAULT_BENCHMARK_SESSIONS) " "
+        "without --benchmark-duration)"),
+     "N"},
+    {"benchmark-duration", 0, 0, G_OPTION_ARG_DOUBLE, &benchmark_duration,
+     N_("Start sessions for SECONDS seconds on benchmark."), "SECONDS"},
+    {"benchmark-concurrency", 0, 0, G_OPTION_ARG_INT, &benchmark_concurrency,
+     N_("Run N sessions concurrently on benchmark. "
+        "With --benchmark-rate, sessions over N are dropped. "
+        "(" G_STRINGIFY(DEFAULT_BENCHMARK_CONCURRENCY) ")"),
+     "N"},
+    {"benchmark-rate", 0, 0, G_OPTION_ARG_DOUBLE, &benchmark_rate,
+     N_("Start RATE sessions per second on benchmark. "
+        "0 starts a new session when a session is finished. (0)"),
+     "RATE"},
+    {"benchmark-event-loops", 0, 0, G_OPTION_ARG_INT, &benchmark_n_event_loops,
+     N_("Run sessions on N event loops on benchmark. (1)"), "N"},
     {"verbose", 'v', 0, G_OPTION_ARG_NONE, &verbose,
      N_("Be verbose"), NULL},
     {"version", 0, G_OPTION_FLAG_NO_ARG, G_OPTION_ARG_CALLBACK, print_version,
@@ -1619,28 +2062,29 @@ static const GOptionEntry option_entries[] =
 };
 
 static Message *
-message_new (void)
+message_new (Mail *mail)
 {
     Message *message;
     gint i;
 
     message = g_new0(Message, 1);
-    message->envelope_from = g_strdup(envelope_from);
-    message->original_envelope_from = g_strdup(envelope_from);
+    message->envelope_from = g_strdup(mail->envelope_from);
+    message->original_envelope_from = g_strdup(mail->envelope_from);
     message->recipients = NULL;
     message->original_recipients = NULL;
-    for (i = 0; i < g_strv_length(recipients); i++) {
+    for (i = 0; i < g_strv_length(mail->recipients); i++) {
         message->recipients = \
-            g_list_append(message->recipients, g_strdup(recipients[i]));
+            g_list_append(message->recipients, g_strdup(mail->recipients[i]));
         message->original_recipients = \
-            g_list_append(message->original_recipients, g_strdup(recipients[i]));
+            g_list_append(message->original_recipients,
+                          g_strdup(mail->recipients[i]));
     }
-    message->headers = milter_headers_copy(option_headers);
-    message->original_headers = milter_headers_copy(option_headers);
+    message->headers = milter_headers_copy(mail->headers);
+    message->original_headers = milter_headers_copy(mail->headers);
 
     message->body_string = g_string_new(NULL);
-    for (i = 0; i < g_strv_length(body_chunks); i++)
-        g_string_append(message->body_string, g_strdup(body_chunks[i]));
+    for (i = 0; i < g_strv_length(mail->body_chunks); i++)
+        g_string_append(message->body_string, g_strdup(mail->body_chunks[i]));
     message->replaced_body_string = g_string_new(NULL);
 
     return message;
@@ -1672,22 +2116,27 @@ free_message (Message *message)
 }
 
 static void
-init_process_data (ProcessData *data)
+init_process_data (ProcessData *data, MilterEventLoop *loop, Mail *mail)
 {
-    data->loop = milter_glib_event_loop_new(NULL);
+    data->loop = loop;
     data->timer = g_timer_new();
     data->success = TRUE;
     data->quarantine_reason = NULL;
     data->option = NULL;
-    data->option_headers = milter_headers_copy(option_headers);
-    data->body_chunks = g_strdupv(body_chunks);
+    data->option_headers = milter_headers_copy(mail->headers);
+    data->body_chunks = g_strdupv(mail->body_chunks);
     data->current_body_chunk = 0;
     data->current_recipient = 0;
     data->reply_code = 0;
     data->reply_extended_code = NULL;
     data->reply_message = NULL;
-    data->message = message_new();
+    data->message = message_new(mail);
     data->error = NULL;
+    data->mail = mail;
+    data->runner = NULL;
+    data->ready = FALSE;
+    data->sent_state = MILTER_SERVER_CONTEXT_STATE_INVALID;
+    data->sent_time = 0.0;
 }
 
 static void
@@ -1911,6 +2360,11 @@ free_option_values (void)
         g_hash_table_unref(end_of_header_macros);
     if (end_of_message_macros)
         g_hash_table_unref(end_of_message_macros);
+
+    if (benchmark_mails) {
+        g_ptr_array_foreach(benchmark_mails, (GFunc)mail_free, NULL);
+        g_ptr_array_free(benchmark_mails, TRUE);
+    }
 }
 
 static void
@@ -2195,8 +2649,8 @@ print_message (Message *message)
     print_body(message);
 }
 
-static void
-print_status (MilterServerContext *context, ProcessData *data)
+static const gchar *
+get_status_name (MilterServerContext *context)
 {
     MilterStatus status;
     const gchar *status_name;
@@ -2214,7 +2668,13 @@ print_status (MilterServerContext *context, ProcessData *data)
         g_type_class_unref(enum_class);
     }
 
-    g_print("status: %s", status_name);
+    return status_name;
+}
+
+static void
+print_status (MilterServerContext *context, ProcessData *data)
+{
+    g_print("status: %s", get_status_name(context));
     if (data->reply_code > 0 ||
         data->reply_extended_code ||
         data->reply_message) {
@@ -2266,6 +2726,10 @@ setup_context (MilterServerContext *context, ProcessData *process_data)
 
     g_signal_connect(context, "ready", G_CALLBACK(cb_ready), process_data);
     g_signal_connect(context, "error", G_CALLBACK(cb_connection_error), process_data);
+    if (process_data->runner)
+        g_signal_connect(context, "connection-timeout",
+                         G_CALLBACK(cb_benchmark_connection_timeout),
+                         process_data);
 }
 
 static gboolean
@@ -2308,6 +2772,467 @@ test_server_thread (gpointer data)
     return GINT_TO_POINTER(success);
 }
 
+static void
+benchmark_result_init (BenchmarkResult *result)
+{
+    memset(result, 0, sizeof(*result));
+    result->statuses = g_hash_table_new(g_str_hash, g_str_equal);
+}
+
+static void
+benchmark_result_count_status (BenchmarkResult *result,
+                               const gchar *status_name, guint n)
+{
+    guint current;
+
+    current = GPOINTER_TO_UINT(g_hash_table_lookup(result->statuses,
+                                                   status_name));
+    g_hash_table_insert(result->statuses,
+                        (gpointer)status_name,
+                        GUINT_TO_POINTER(current + n));
+}
+
+static void
+merge_status (gpointer key, gpointer value, gpointer user_data)
+{
+    BenchmarkResult *result = user_data;
+
+    benchmark_result_count_status(result, key, GPOINTER_TO_UINT(value));
+}
+
+static void
+benchmark_result_merge (BenchmarkResult *result, BenchmarkResult *other)
+{
+    guint i;
+
+    for (i = 0; i < N_BENCHMARK_STAGES; i++) {
+        latency_merge(&(result->stages[i]), &(other->stages[i]));
+    }
+    latency_merge(&(result->session), &(other->session));
+    result->n_sessions += other->n_sessions;
+    result->n_errors += other->n_errors;
+    result->n_timeouts += other->n_timeouts;
+    result->n_dropped += other->n_dropped;
+    g_hash_table_foreach(other->statuses, merge_status, result);
+}
+
+static gboolean
+benchmark_runner_can_start (BenchmarkRunner *runner)
+{
+    if (runner->n_started >= runner->max_sessions)
+        return FALSE;
+    if (benchmark_duration > 0.0 &&
+        g_timer_elapsed(runner->timer, NULL) >= benchmark_duration)
+        return FALSE;
+    return TRUE;
+}
+
+static void
+benchmark_runner_quit_if_done (BenchmarkRunner *runner)
+{
+    if (runner->n_alive > 0)
+        return;
+    if (benchmark_runner_can_start(runner))
+        return;
+    if (runner->retry_id > 0) {
+        milter_event_loop_remove(runner->loop, runner->retry_id);
+        runner->retry_id = 0;
+    }
+    milter_event_loop_quit(runner->loop);
+}
+
+static gboolean
+cb_benchmark_free_session (gpointer user_data)
+{
+    BenchmarkSession *session = user_data;
+    BenchmarkRunner *runner = session->data.runner;
+
+    g_signal_handlers_disconnect_matched(session->context,
+                                         G_SIGNAL_MATCH_DATA,
+                                         0, 0, NULL, NULL,
+                                         &(session->data));
+    g_object_unref(session->context);
+    free_process_data(&(session->data));
+    g_free(session);
+
+    runner->n_alive--;
+    benchmark_runner_quit_if_done(runner);
+
+    return FALSE;
+}
+
+static void
+benchmark_finish_session (BenchmarkSession *session)
+{
+    BenchmarkRunner *runner = session->data.runner;
+    BenchmarkResult *result = &(runner->result);
+    GError *error = session->data.error;
+
+    session->finished = TRUE;
+    runner->n_running--;
+
+    result->n_sessions++;
+    if (error) {
+        if (g_error_matches(error,
+                            MILTER_TEST_SERVER_ERROR,
+                            MILTER_TEST_SERVER_ERROR_TIMEOUT)) {
+            result->n_timeouts++;
+        } else {
+            result->n_errors++;
+        }
+        milter_debug("[test-server][benchmark][error] %s", error->message);
+    } else {
+        latency_add(&(result->session),
+                    g_timer_elapsed(runner->timer, NULL) -
+                    session->started_time);
+        benchmark_result_count_status(result,
+                                      get_status_name(session->context), 1);
+    }
+
+    milter_event_loop_add_idle(runner->loop,
+                               cb_benchmark_free_session, session);
+}
+
+static gboolean
+benchmark_start_session (BenchmarkRunner *runner)
+{
+    BenchmarkSession *session;
+    Mail *mail;
+    GError *error = NULL;
+    gboolean success;
+
+    mail = g_ptr_array_index(runner->mails,
+                             (runner->id +
+                              runner->n_started * benchmark_n_event_loops) %
+                             runner->mails->len);
+    runner->n_started++;
+    runner->n_running++;
+    runner->n_alive++;
+
+    session = g_new0(BenchmarkSession, 1);
+    init_process_data(&(session->data), g_object_ref(runner->loop), mail);
+    session->data.runner = runner;
+    session->started_time = g_timer_elapsed(runner->timer, NULL);
+    session->context = milter_server_context_new();
+    setup_context(session->context, &(session->data));
+
+    success = milter_server_context_set_connection_spec(session->context,
+                                                        spec, &error);
+    if (success)
+        success = milter_server_context_establish_connection(session->context,
+                                                             &error);
+    if (!success) {
+        session->data.success = FALSE;
+        session->data.error = error;
+        benchmark_finish_session(session);
+    }
+
+    return success;
+}
+
+static void benchmark_runner_fill (BenchmarkRunner *runner);
+
+static gboolean
+cb_benchmark_retry (gpointer user_data)
+{
+    BenchmarkRunner *runner = user_data;
+
+    runner->retry_id = 0;
+    benchmark_runner_fill(runner);
+    benchmark_runner_quit_if_done(runner);
+
+    return FALSE;
+}
+
+static void
+benchmark_runner_fill (BenchmarkRunner *runner)
+{
+    while (runner->n_running < runner->concurrency &&
+           benchmark_runner_can_start(runner)) {
+        if (benchmark_start_session(runner))
+            continue;
+
+        /* Connecting fails immediately (e.g. the milter isn't
+         * listening): wait instead of spinning until the deadline. */
+        if (runner->n_running == 0 && runner->retry_id == 0) {
+            runner->retry_id =
+                milter_event_loop_add_timeout(runner->loop,
+                                              BENCHMARK_RETRY_INTERVAL,
+                                              cb_benchmark_retry,
+                                              runner);
+        }
+        break;
+    }
+}
+
+static void
+benchmark_session_finished (MilterServerContext *context, ProcessData *data)
+{
+    BenchmarkSession *session = (BenchmarkSession *)data;
+    BenchmarkRunner *runner = data->runner;
+
+    if (session->finished)
+        return;
+
+    benchmark_finish_session(session);
+    if (runner->rate <= 0.0)
+        benchmark_runner_fill(runner);
+}
+
+static gboolean
+benchmark_runner_tick (BenchmarkRunner *runner)
+{
+    guint n_due;
+
+    n_due = (guint)(g_timer_elapsed(runner->timer, NULL) * runner->rate) + 1;
+    while (runner->n_started < n_due && benchmark_runner_can_start(runner)) {
+        if (runner->n_running >= runner->concurrency) {
+            runner->n_started++;
+            runner->result.n_dropped++;
+            continue;
+        }
+        benchmark_start_session(runner);
+    }
+
+    return benchmark_runner_can_start(runner);
+}
+
+static gboolean
+cb_benchmark_tick (gpointer user_data)
+{
+    BenchmarkRunner *runner = user_data;
+
+    if (benchmark_runner_tick(runner))
+        return TRUE;
+
+    runner->tick_id = 0;
+    benchmark_runner_quit_if_done(runner);
+    return FALSE;
+}
+
+static void
+benchmark_runner_init (BenchmarkRunner *runner, guint id)
+{
+    guint i;
+
+    runner->id = id;
+    runner->loop = milter_libev_event_loop_new();
+    runner->timer = g_timer_new();
+
+    runner->mails = g_ptr_array_new();
+    for (i = 0; i < benchmark_mails->len; i++) {
+        Mail *mail = g_ptr_array_index(benchmark_mails, i);
+        g_ptr_array_add(runner->mails,
+                        mail_copy(mail->envelope_from,
+                                  mail->recipients,
+                                  mail->headers,
+                                  mail->body_chunks));
+    }
+
+    if (benchmark_n_sessions > 0) {
+        runner->max_sessions = benchmark_n_sessions / benchmark_n_event_loops;
+        if (id < (guint)(benchmark_n_sessions % benchmark_n_event_loops))
+            runner->max_sessions++;
+    } else {
+        runner->max_sessions = G_MAXUINT;
+    }
+    runner->concurrency = benchmark_concurrency / benchmark_n_event_loops;
+    if (id < (guint)(benchmark_concurrency % benchmark_n_event_loops))
+        runner->concurrency++;
+    if (runner->concurrency == 0)
+        runner->concurrency = 1;
+    runner->rate = benchmark_rate / benchmark_n_event_loops;
+
+    benchmark_result_init(&(runner->result));
+}
+
+static void
+benchmark_runner_free (BenchmarkRunner *runner)
+{
+    g_object_unref(runner->loop);
+    g_timer_destroy(runner->timer);
+    g_ptr_array_foreach(runner->mails, (GFunc)mail_free, NULL);
+    g_ptr_array_free(runner->mails, TRUE);
+    g_hash_table_unref(runner->result.statuses);
+}
+
+static gpointer
+benchmark_runner_run (gpointer data)
+{
+    BenchmarkRunner *runner = data;
+
+    g_timer_start(runner->timer);
+    if (runner->rate > 0.0) {
+        if (benchmark_runner_tick(runner)) {
+            runner->tick_id =
+                milter_event_loop_add_timeout(runner->loop,
+                                              CLAMP(1.0 / runner->rate,
+                                                    0.001, 0.01),
+                                              cb_benchmark_tick,
+                                              runner);
+        }
+    } else {
+        benchmark_runner_fill(runner);
+    }
+
+    if (runner->n_alive > 0 || benchmark_runner_can_start(runner))
+        milter_event_loop_run(runner->loop);
+
+    return NULL;
+}
+
+static void
+print_latency (const gchar *label, Latency *latency)
+{
+    if (latency->count == 0)
+        return;
+
+    g_print("  %-20s %10" G_GUINT64_FORMAT " %10.3f %10.3f %10.3f %10.3f\n",
+            label,
+            latency->count,
+            latency_percentile(latency, 50.0) * 1000.0,
+            latency_percentile(latency, 99.0) * 1000.0,
+            latency_percentile(latency, 99.9) * 1000.0,
+            latency->max / 1000.0);
+}
+
+static void
+print_benchmark_status (gpointer key, gpointer value, gpointer user_data)
+{
+    g_print("  %-20s %10u\n", (const gchar *)key, GPOINTER_TO_UINT(value));
+}
+
+static void
+print_benchmark_result (BenchmarkResult *result, gdouble elapsed)
+{
+    MilterServerContextState state;
+
+    g_print("sessions: %u\n", result->n_sessions);
+    g_print("errors: %u\n", result->n_errors);
+    g_print("timeouts: %u\n", result->n_timeouts);
+    g_print("dropped: %u\n", result->n_dropped);
+    g_print("elapsed-time: %g seconds\n", elapsed);
+    g_print("throughput: %g sessions/second\n",
+            elapsed > 0.0 ? result->n_sessions / elapsed : 0.0);
+
+    g_print("status:\n");
+    g_hash_table_foreach(result->statuses, print_benchmark_status, NULL);
+
+    g_print("latency: (milliseconds)\n");
+    g_print("  %-20s %10s %10s %10s %10s %10s\n",
+            "stage", "count", "p50", "p99", "p999", "max");
+    for (state = MILTER_SERVER_CONTEXT_STATE_NEGOTIATE;
+         state <= MILTER_SERVER_CONTEXT_STATE_END_OF_MESSAGE;
+         state++) {
+        gchar *state_name;
+
+        state_name =
+            milter_utils_get_enum_nick_name(MILTER_TYPE_SERVER_CONTEXT_STATE,
+                                            state);
+        print_latency(state_name, &(result->stages[state]));
+        g_free(state_name);
+    }
+    print_latency("session", &(result->session));
+}
+
+static gboolean
+run_benchmark (void)
+{
+    BenchmarkRunner *runners;
+    BenchmarkResult result;
+    GTimer *timer;
+    GError *error = NULL;
+    gint i;
+    gboolean success;
+    gboolean thread_error = FALSE;
+
+    if (!milter_connection_parse_spec(spec, NULL, NULL, NULL, &error)) {
+        g_print("%s\n", error->message);
+        g_error_free(error);
+        return FALSE;
+    }
+    if (benchmark_n_event_loops <= 0 || benchmark_concurrency <= 0) {
+        g_print(_("--benchmark-event-loops and --benchmark-concurrency "
+                  "must be positive\n"));
+        return FALSE;
+    }
+    if (benchmark_n_sessions <= 0 && benchmark_duration <= 0.0)
+        benchmark_n_sessions = DEFAULT_BENCHMARK_SESSIONS;
+
+    if (!benchmark_mails)
+        benchmark_mails = g_ptr_array_new();
+    if (benchmark_mails->len == 0) {
+        g_ptr_array_add(benchmark_mails,
+                        mail_copy(envelope_from, recipients,
+                                  option_headers, body_chunks));
+    }
+    for (i = 0; i < benchmark_mails->len; i++) {
+        Mail *mail = g_ptr_array_index(benchmark_mails, i);
+
+        if (!mail->envelope_from)
+            mail->envelope_from = g_strdup(envelope_from);
+        if (!mail->recipients)
+            mail->recipients = g_strdupv(recipients);
+        if (!mail->body_chunks)
+            mail->body_chunks = g_new0(gchar *, 1);
+        if (!milter_headers_lookup_by_name(mail->headers, "From"))
+            milter_headers_append_header(mail->headers,
+                                         "From", mail->envelope_from);
+        if (!milter_headers_lookup_by_name(mail->headers, "To"))
+            milter_headers_append_header(mail->headers,
+                                         "To", mail->recipients[0]);
+    }
+
+    runners = g_new0(BenchmarkRunner, benchmark_n_event_loops);
+    for (i = 0; i < benchmark_n_event_loops; i++) {
+        benchmark_runner_init(&runners[i], i);
+    }
+
+    timer = g_timer_new();
+    if (benchmark_n_event_loops == 1) {
+        benchmark_runner_run(&runners[0]);
+    } else {
+        GThread **threads;
+
+        threads = g_new0(GThread *, benchmark_n_event_loops);
+        for (i = 0; i < benchmark_n_event_loops; i++) {
+            threads[i] = g_thread_try_new("benchmark_runner",
+                                          benchmark_runner_run,
+                                          &runners[i],
+                                          &error);
+            if (!threads[i]) {
+                g_print("failed to start event loop thread <%d>: %s\n",
+                        i, error->message);
+                g_error_free(error);
+                error = NULL;
+                thread_error = TRUE;
+            }
+        }
+        for (i = 0; i < benchmark_n_event_loops; i++) {
+            if (threads[i])
+                g_thread_join(threads[i]);
+        }
+        g_free(threads);
+    }
+    g_timer_stop(timer);
+
+    benchmark_result_init(&result);
+    for (i = 0; i < benchmark_n_event_loops; i++) {
+        benchmark_result_merge(&result, &(runners[i].result));
+        benchmark_runner_free(&runners[i]);
+    }
+    g_free(runners);
+
+    print_benchmark_result(&result, g_timer_elapsed(timer, NULL));
+    success = (!thread_error &&
+               result.n_errors == 0 && result.n_timeouts == 0);
+
+    g_hash_table_unref(result.statuses);
+    g_timer_destroy(timer);
+
+    return success;
+}
+
 int
 main (int argc, char *argv[])
 {
@@ -2315,6 +3240,7 @@ main (int argc, char *argv[])
     GError *error = NULL;
     GOptionContext *option_context;
     GOptionGroup *main_group;
+    Mail mail;
 
 #ifdef HAVE_LOCALE_H
     setlocale(LC_ALL, "");
@@ -2341,7 +3267,14 @@ main (int argc, char *argv[])
     if (verbose)
         g_setenv("MILTER_LOG_LEVEL", "all", FALSE);
 
-    if (n_threads > 0) {
+    mail.envelope_from = envelope_from;
+    mail.recipients = recipients;
+    mail.headers = option_headers;
+    mail.body_chunks = body_chunks;
+
+    if (benchmark) {
+        success = run_benchmark();
+    } else if (n_threads > 0) {
         GThread **threads;
         ProcessData *process_data;
         gint i;
@@ -2349,7 +3282,9 @@ main (int argc, char *argv[])
         threads = g_new0(GThread *, n_threads);
         process_data = g_new0(ProcessData, n_threads);
         for (i = 0; i < n_threads; i++) {
-            init_process_data(&process_data[i]);
+            init_process_data(&process_data[i],
+                              milter_glib_event_loop_new(NULL),
+                              &mail);
             threads[i] = g_thread_try_new("test_server_thread",
                                           test_server_thread,
                                           &process_data[i],
@@ -2365,7 +3300,8 @@ main (int argc, char *argv[])
         g_free(threads);
     } else {
         ProcessData process_data;
-        init_process_data(&process_data);
+        init_process_data(&process_data, milter_glib_event_loop_new(NULL),
+                          &mail);
         success = GPOINTER_TO_INT(test_server_thread(&process_data));
         free_process_data(&process_data);
     }